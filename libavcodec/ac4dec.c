@@ -37,10 +37,12 @@
 #include "codec_internal.h"
 #include "decode.h"
 #include "kbdwin.h"
+#include "sbrdsp.h"
 #include "unary.h"
 
 #define MAX_QMF_TSLOTS 32
 #define MAX_QMF_BANDS 64
+#define QMF_SYNTHESIS_BUF_SIZE ((MAX_QMF_BANDS*20 - MAX_QMF_BANDS*2) * 2)
 #define MAX_SBG_NOISE 6
 #define MAX_ASPX_SIGNAL 5
 
@@ -118,6 +120,7 @@ typedef struct SubstreamChannel {
     int     sap_mode;
     int     N_prev;
     int     idx_prev;
+    int     qsyn_offset;
 
     uint8_t ms_used[16][128];
     uint8_t sap_coeff_used[16][128];
@@ -255,10 +258,10 @@ typedef struct SubstreamChannel {
     DECLARE_ALIGNED(32, float, imdct_out)[4096];
     DECLARE_ALIGNED(32, float, overlap)[4096];
 
-    DECLARE_ALIGNED(32, float, qana_filt)[MAX_QMF_BANDS*10];
+    DECLARE_ALIGNED(32, float, qana_filt)[MAX_QMF_BANDS*9 + MAX_QMF_TSLOTS*MAX_QMF_BANDS];
     DECLARE_ALIGNED(32, float, qmf_sine)[2][MAX_QMF_TSLOTS][MAX_QMF_BANDS];
     DECLARE_ALIGNED(32, float, qmf_noise)[2][MAX_QMF_TSLOTS][MAX_QMF_BANDS];
-    DECLARE_ALIGNED(32, float, qsyn_filt)[MAX_QMF_BANDS*20];
+    DECLARE_ALIGNED(32, float, qsyn_filt)[QMF_SYNTHESIS_BUF_SIZE];
     DECLARE_ALIGNED(32, float, L)[MAX_QMF_TSLOTS];
     DECLARE_ALIGNED(32, float, g)[MAX_QMF_TSLOTS];
     DECLARE_ALIGNED(32, float, E)[MAX_QMF_TSLOTS][MAX_QMF_BANDS];
@@ -416,10 +419,21 @@ typedef struct PresentationInfo {
     SubstreamInfo ssinfo;
 } PresentationInfo;
 
+typedef struct AC4ThreadContext {
+    av_tx_fn        tx_fn[5];
+    AVTXContext    *tx_ctx[5];
+
+    av_tx_fn        qmf_ana_fn;
+    AVTXContext    *qmf_ana_ctx;
+    av_tx_fn        qmf_syn_fn;
+    AVTXContext    *qmf_syn_ctx;
+} AC4ThreadContext;
+
 typedef struct AC4DecodeContext {
     AVClass        *class;                  ///< class for AVOptions
     AVCodecContext *avctx;                  ///< parent context
     AVFloatDSPContext *fdsp;
+    SBRDSPContext   sbrdsp;
     GetBitContext   gbc;                    ///< bitstream reader
 
     int             target_presentation;
@@ -451,18 +465,14 @@ typedef struct AC4DecodeContext {
     int             substream_type[32];
     int             ch_map[256];
 
-    av_tx_fn        tx_fn[8][5];
-    AVTXContext    *tx_ctx[8][5];
+    AC4ThreadContext *td;                   ///< per-thread transforms
+    int             nb_threads;
+    int             tx_idx;                 ///< frame_len_base_idx the transforms are set up for
 
     DECLARE_ALIGNED(32, float, kbd_window)[8][5][2048];
 
     float           quant_lut[8192];
 
-    DECLARE_ALIGNED(32, float, cos_atab)[MAX_QMF_BANDS][MAX_QMF_BANDS*2];
-    DECLARE_ALIGNED(32, float, sin_atab)[MAX_QMF_BANDS][MAX_QMF_BANDS*2];
-    DECLARE_ALIGNED(32, float, cos_stab)[MAX_QMF_BANDS*2][MAX_QMF_BANDS];
-    DECLARE_ALIGNED(32, float, sin_stab)[MAX_QMF_BANDS*2][MAX_QMF_BANDS];
-
     PresentationInfo   pinfo[8];
     SubstreamGroupInfo ssgroup[8];
     Substream          substream;
@@ -763,46 +773,79 @@ static av_cold int ac4_decode_init(AVCodecContext *avctx)
 
     s->avctx = avctx;
     s->first_frame = 1;
+    s->tx_idx = -1;
 
     avctx->sample_fmt = AV_SAMPLE_FMT_FLTP;
 
     for (int j = 0; j < 8; j++) {
-        const uint16_t *transf_lengths = transf_length_48khz[j];
-
-        for (int i = 0; i < 5; i++) {
-            int N_w = transf_lengths[i];
-            float alpha = kbd_window_alpha[j][i];
-            float scale = 1.f / N_w;
-
-            if ((ret = av_tx_init(&s->tx_ctx[j][i], &s->tx_fn[j][i],
-                                  AV_TX_FLOAT_MDCT, 1, N_w, &scale, AV_TX_FULL_IMDCT)))
-                return ret;
-
-            ff_kbd_window_init(s->kbd_window[j][i], alpha, N_w);
-        }
+        for (int i = 0; i < 5; i++)
+            ff_kbd_window_init(s->kbd_window[j][i], kbd_window_alpha[j][i],
+                               transf_length_48khz[j][i]);
     }
 
     for (int i = 0; i < 8192; i++)
         s->quant_lut[i] = powf(i, 4.f / 3.f);
 
-    for (int i = 0; i < MAX_QMF_BANDS; i++) {
-        for (int n = 0; n < MAX_QMF_BANDS*2; n++) {
-            s->cos_atab[i][n] = cosf((M_PI/(MAX_QMF_BANDS*2))*(i+0.5)*(2*n-1));
-            s->sin_atab[i][n] = sinf((M_PI/(MAX_QMF_BANDS*2))*(i+0.5)*(2*n-1));
-            s->cos_stab[n][i] = cosf((M_PI/(MAX_QMF_BANDS*2))*(i+0.5)*(2*n-255)) / MAX_QMF_BANDS;
-            s->sin_stab[n][i] = sinf((M_PI/(MAX_QMF_BANDS*2))*(i+0.5)*(2*n-255)) / MAX_QMF_BANDS;
-        }
+    s->nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ? avctx->thread_count : 1;
+    s->td = av_calloc(s->nb_threads, sizeof(*s->td));
+    if (!s->td)
+        return AVERROR(ENOMEM);
+
+    for (int n = 0; n < s->nb_threads; n++) {
+        AC4ThreadContext *td = &s->td[n];
+        float scale = 1.f / 32768.f;
+
+        /* both QMF banks are evaluated as DCT-IV/DST-IV pairs of size 64 */
+        if ((ret = av_tx_init(&td->qmf_ana_ctx, &td->qmf_ana_fn,
+                              AV_TX_FLOAT_MDCT, 1, MAX_QMF_BANDS, &scale, 0)) < 0)
+            return ret;
+
+        scale = 1.f / MAX_QMF_BANDS;
+        if ((ret = av_tx_init(&td->qmf_syn_ctx, &td->qmf_syn_fn,
+                              AV_TX_FLOAT_MDCT, 1, MAX_QMF_BANDS, &scale, 0)) < 0)
+            return ret;
     }
 
     s->fdsp = avpriv_float_dsp_alloc(avctx->flags & AV_CODEC_FLAG_BITEXACT);
     if (!s->fdsp)
         return AVERROR(ENOMEM);
 
+    ff_sbrdsp_init(&s->sbrdsp);
+
     ff_thread_once(&init_static_once, ac4_init_static);
 
     return 0;
 }
 
+static int init_transforms(AC4DecodeContext *s)
+{
+    const uint16_t *transf_lengths = transf_length_48khz[s->frame_len_base_idx];
+    int ret;
+
+    if (s->tx_idx == s->frame_len_base_idx)
+        return 0;
+
+    /* the IMDCTs are not reentrant, so every thread gets its own set,
+     * and only the set for the current base frame length is kept around */
+    s->tx_idx = -1;
+    for (int n = 0; n < s->nb_threads; n++) {
+        AC4ThreadContext *td = &s->td[n];
+
+        for (int i = 0; i < 5; i++) {
+            const int N_w = transf_lengths[i];
+            const float scale = 1.f / N_w;
+
+            av_tx_uninit(&td->tx_ctx[i]);
+            if ((ret = av_tx_init(&td->tx_ctx[i], &td->tx_fn[i],
+                                  AV_TX_FLOAT_MDCT, 1, N_w, &scale, AV_TX_FULL_IMDCT)) < 0)
+                return ret;
+        }
+    }
+    s->tx_idx = s->frame_len_base_idx;
+
+    return 0;
+}
+
 static int variable_bits(GetBitContext *gb, int bits)
 {
     int value = 0;
@@ -5078,8 +5121,9 @@ static void spectral_reordering(AC4DecodeContext *s, SubstreamChannel *ssch)
     }
 }
 
-static void scale_spec(AC4DecodeContext *s, int ch)
+static int scale_spec(AVCodecContext *avctx, void *arg, int ch, int threadnr)
 {
+    AC4DecodeContext *s = avctx->priv_data;
     Substream *ss = &s->substream;
     SubstreamChannel *ssch = &ss->ssch[ch];
     const float *quant_lut = s->quant_lut;
@@ -5097,6 +5141,8 @@ static void scale_spec(AC4DecodeContext *s, int ch)
         av_assert2(FFABS(x) < FF_ARRAY_ELEMS(s->quant_lut));
         ssch->scaled_spec[k] = ssch->sf_gain[g][sfb] * copysignf(quant_lut[FFABS(x)], x);
     }
+
+    return 0;
 }
 
 static int two_channel_processing(AC4DecodeContext *s, Substream *ss,
@@ -5225,79 +5271,97 @@ static int m5channel_processing(AC4DecodeContext *s, Substream *ss)
     return 0;
 }
 
-static void qmf_analysis(AC4DecodeContext *s, SubstreamChannel *ssch)
+static void qmf_analysis(AC4DecodeContext *s, AC4ThreadContext *td,
+                         SubstreamChannel *ssch)
 {
+    const int history = MAX_QMF_BANDS*9;
+    const int nb_samples = s->num_qmf_timeslots * MAX_QMF_BANDS;
     float *qana_filt = ssch->qana_filt;
-    float *pcm = ssch->pcm;
     LOCAL_ALIGNED_32(float, u, [MAX_QMF_BANDS*2]);
     LOCAL_ALIGNED_32(float, z, [MAX_QMF_BANDS*10]);
+    LOCAL_ALIGNED_32(float, a, [MAX_QMF_BANDS]);
+    LOCAL_ALIGNED_32(float, b, [MAX_QMF_BANDS]);
+    LOCAL_ALIGNED_32(float, t, [MAX_QMF_BANDS]);
 
-    for (int ts = 0; ts < s->num_qmf_timeslots; ts++) {
-        /* shift time-domain input samples by MAX_QMF_BANDS */
-        memmove(qana_filt + MAX_QMF_BANDS, qana_filt, sizeof(*qana_filt) * (MAX_QMF_BANDS*10 - MAX_QMF_BANDS));
-
-        /* feed new audio samples */
-        for (int sb = MAX_QMF_BANDS-1; sb >= 0; sb--)
-            qana_filt[sb] = pcm[ts * MAX_QMF_BANDS + MAX_QMF_BANDS-1 - sb] / 32768.f;
+    /* time-domain input samples are kept in ascending order,
+     * preceded by the last MAX_QMF_BANDS*9 samples of the previous frame */
+    memcpy(qana_filt + history, ssch->pcm, nb_samples * sizeof(*qana_filt));
 
+    for (int ts = 0; ts < s->num_qmf_timeslots; ts++) {
         /* multiply input samples by window coefficients */
-        s->fdsp->vector_fmul(z, qana_filt, qwin, MAX_QMF_BANDS*10);
+        s->fdsp->vector_fmul_reverse(z, qwin, qana_filt + ts * MAX_QMF_BANDS, MAX_QMF_BANDS*10);
 
         /* sum the samples to create vector u */
-        for (int n = 0; n < MAX_QMF_BANDS*2; n++) {
-            u[n] = z[n];
-            for (int k = 1; k < 5; k++)
-                u[n] += z[n + k * MAX_QMF_BANDS*2];
+        for (int n = 0; n < MAX_QMF_BANDS*2; n++)
+            u[n] = z[n] + z[n + 128] + z[n + 256] + z[n + 384] + z[n + 512];
+
+        /* fold u so that the cosine and sine modulations become
+         * a DCT-IV and a DST-IV of size MAX_QMF_BANDS */
+        a[0] = u[0] + u[1];
+        b[0] = u[1] - u[0];
+        for (int n = 1; n < MAX_QMF_BANDS; n++) {
+            a[n] = u[n + 1] - u[MAX_QMF_BANDS*2 - n];
+            b[n] = u[n + 1] + u[MAX_QMF_BANDS*2 - n];
+            if (n & 1)
+                b[n] = -b[n];
         }
 
-        /* compute MAX_QMF_BANDS new subband samples */
-        for (int sb = 0; sb < MAX_QMF_BANDS; sb++) {
-            const float *cos_atab = s->cos_atab[sb];
-            const float *sin_atab = s->sin_atab[sb];
+        td->qmf_ana_fn(td->qmf_ana_ctx, t, a, sizeof(float));
+        td->qmf_ana_fn(td->qmf_ana_ctx, ssch->Q[1][ts], b, sizeof(float));
 
-            ssch->Q[0][ts][sb] = s->fdsp->scalarproduct_float(u, cos_atab, MAX_QMF_BANDS*2);
-            ssch->Q[1][ts][sb] = s->fdsp->scalarproduct_float(u, sin_atab, MAX_QMF_BANDS*2);
-        }
+        for (int sb = 0; sb < MAX_QMF_BANDS; sb++)
+            ssch->Q[0][ts][sb] = t[MAX_QMF_BANDS-1 - sb];
     }
+
+    memmove(qana_filt, qana_filt + nb_samples, history * sizeof(*qana_filt));
 }
 
-static void qmf_synthesis(AC4DecodeContext *s, SubstreamChannel *ssch, float *pcm)
+static void qmf_synthesis(AC4DecodeContext *s, AC4ThreadContext *td,
+                          SubstreamChannel *ssch, float *pcm)
 {
+    const int saved_samples = MAX_QMF_BANDS*20 - MAX_QMF_BANDS*2;
     float *qsyn_filt = ssch->qsyn_filt;
-    LOCAL_ALIGNED_32(float, g, [MAX_QMF_BANDS*10]);
-    LOCAL_ALIGNED_32(float, w, [MAX_QMF_BANDS*10]);
+    LOCAL_ALIGNED_32(float, x1, [MAX_QMF_BANDS]);
+    LOCAL_ALIGNED_32(float, t0, [MAX_QMF_BANDS]);
+    LOCAL_ALIGNED_32(float, t1, [MAX_QMF_BANDS]);
 
     for (int ts = 0; ts < s->num_qmf_timeslots; ts++) {
-        /* shift samples by MAX_QMF_BANDS*2 */
-        memmove(qsyn_filt + MAX_QMF_BANDS*2, qsyn_filt, sizeof(*qsyn_filt) * (MAX_QMF_BANDS*20 - MAX_QMF_BANDS*2));
-
-        for (int n = 0; n < MAX_QMF_BANDS*2; n++) {
-            const float *cos_stab = s->cos_stab[n];
-            const float *sin_stab = s->sin_stab[n];
-
-            qsyn_filt[n] = s->fdsp->scalarproduct_float(ssch->Q[0][ts], cos_stab, MAX_QMF_BANDS) -
-                           s->fdsp->scalarproduct_float(ssch->Q[1][ts], sin_stab, MAX_QMF_BANDS);
-        }
-
-        for (int n = 0; n < 5; n++) {
-            memcpy(g + MAX_QMF_BANDS*2 * n, qsyn_filt + 256 * n, MAX_QMF_BANDS * sizeof(float));
-            memcpy(g + MAX_QMF_BANDS*2 * n + MAX_QMF_BANDS, qsyn_filt + 256 * n + 192, MAX_QMF_BANDS * sizeof(float));
+        float *out = pcm + ts * MAX_QMF_BANDS;
+        float *v;
+
+        /* qsyn_filt is a ring buffer, newest samples come first */
+        if (ssch->qsyn_offset < MAX_QMF_BANDS*2) {
+            memcpy(qsyn_filt + QMF_SYNTHESIS_BUF_SIZE - saved_samples, qsyn_filt,
+                   saved_samples * sizeof(*qsyn_filt));
+            ssch->qsyn_offset = QMF_SYNTHESIS_BUF_SIZE - saved_samples - MAX_QMF_BANDS*2;
+        } else {
+            ssch->qsyn_offset -= MAX_QMF_BANDS*2;
         }
-        /* multiply by window coefficients */
-        s->fdsp->vector_fmul(w, g, qwin, MAX_QMF_BANDS*10);
+        v = qsyn_filt + ssch->qsyn_offset;
 
-        /* compute MAX_QMF_BANDS new time-domain output samples */
-        for (int sb = 0; sb < MAX_QMF_BANDS; sb++) {
-            float temp = 0;
+        /* same matrixing as the SBR synthesis filterbank */
+        memcpy(x1, ssch->Q[1][ts], sizeof(x1[0]) * MAX_QMF_BANDS);
+        s->sbrdsp.neg_odd_64(x1);
+        td->qmf_syn_fn(td->qmf_syn_ctx, t0, ssch->Q[0][ts], sizeof(float));
+        td->qmf_syn_fn(td->qmf_syn_ctx, t1, x1, sizeof(float));
+        s->sbrdsp.qmf_deint_bfly(v, t1, t0);
 
-            for (int n = 0; n < 10; n++)
-                temp += w[MAX_QMF_BANDS*n + sb];
-            pcm[ts*MAX_QMF_BANDS + sb] = temp;
-        }
+        /* multiply by window coefficients and compute MAX_QMF_BANDS new time-domain output samples */
+        s->fdsp->vector_fmul    (out, v       , qwin      , MAX_QMF_BANDS);
+        s->fdsp->vector_fmul_add(out, v +  192, qwin +  64, out, MAX_QMF_BANDS);
+        s->fdsp->vector_fmul_add(out, v +  256, qwin + 128, out, MAX_QMF_BANDS);
+        s->fdsp->vector_fmul_add(out, v +  448, qwin + 192, out, MAX_QMF_BANDS);
+        s->fdsp->vector_fmul_add(out, v +  512, qwin + 256, out, MAX_QMF_BANDS);
+        s->fdsp->vector_fmul_add(out, v +  704, qwin + 320, out, MAX_QMF_BANDS);
+        s->fdsp->vector_fmul_add(out, v +  768, qwin + 384, out, MAX_QMF_BANDS);
+        s->fdsp->vector_fmul_add(out, v +  960, qwin + 448, out, MAX_QMF_BANDS);
+        s->fdsp->vector_fmul_add(out, v + 1024, qwin + 512, out, MAX_QMF_BANDS);
+        s->fdsp->vector_fmul_add(out, v + 1216, qwin + 576, out, MAX_QMF_BANDS);
     }
 }
 
-static void spectral_synthesis(AC4DecodeContext *s, SubstreamChannel *ssch)
+static void spectral_synthesis(AC4DecodeContext *s, AC4ThreadContext *td,
+                               SubstreamChannel *ssch)
 {
     LOCAL_ALIGNED_32(float, swinl, [2048]);
     LOCAL_ALIGNED_32(float, swinr, [2048]);
@@ -5334,9 +5398,9 @@ static void spectral_synthesis(AC4DecodeContext *s, SubstreamChannel *ssch)
             swinr[wnskip_prev + N_w + n] = 1.f;
 
         for (int w = 0; w < ssch->scp.num_win_in_group[g]; w++) {
-            s->tx_fn[midx][idx](s->tx_ctx[midx][idx], imdct_out,
-                                ssch->spec_reord + win_offset[win + w],
-                                sizeof(float));
+            td->tx_fn[idx](td->tx_ctx[idx], imdct_out,
+                           ssch->spec_reord + win_offset[win + w],
+                           sizeof(float));
 
             s->fdsp->vector_fmul(imdct_out, imdct_out, swinl, N);
             if (!(N_prev & 15))
@@ -5555,15 +5619,19 @@ static int get_qnoise_scale_factors(AC4DecodeContext *s, Substream *ss, int ch_i
     return 0;
 }
 
-static void prepare_channel(AC4DecodeContext *s, int ch)
+static int prepare_channel(AVCodecContext *avctx, void *arg, int ch, int threadnr)
 {
+    AC4DecodeContext *s = avctx->priv_data;
+    AC4ThreadContext *td = &s->td[threadnr];
     Substream *ss = &s->substream;
     SubstreamChannel *ssch = &ss->ssch[ch];
 
     spectral_reordering(s, ssch);
-    spectral_synthesis(s, ssch);
+    spectral_synthesis(s, td, ssch);
+
+    qmf_analysis(s, td, ssch);
 
-    qmf_analysis(s, ssch);
+    return 0;
 }
 
 static void aspx_processing(AC4DecodeContext *s, Substream *ss, int ch_id)
@@ -6352,29 +6420,59 @@ static void assemble_hf_signal(AC4DecodeContext *s, Substream *ss, int ch_id)
     }
 }
 
-static int channels_aspx_processing(AC4DecodeContext *s, Substream *ss, int nb_ch)
+static int aspx_dequant_channel(AVCodecContext *avctx, void *arg, int ch, int threadnr)
 {
+    AC4DecodeContext *s = avctx->priv_data;
+    Substream *ss = &s->substream;
+
+    aspx_processing(s, ss, ch);
+    get_qsignal_scale_factors(s, ss, ch);
+    get_qnoise_scale_factors(s, ss, ch);
+
+    if (ss->ssch[ch].aspx_balance == 0) {
+        mono_deq_signal_factors(s, ss, ch);
+        mono_deq_noise_factors(s, ss, ch);
+    }
+
+    return 0;
+}
+
+static int aspx_hfgen_channel(AVCodecContext *avctx, void *arg, int ch, int threadnr)
+{
+    AC4DecodeContext *s = avctx->priv_data;
+    Substream *ss = &s->substream;
     int ret;
 
-    if (s->substream.codec_mode < CM_ASPX)
-        return 0;
+    preflattening(s, ss, ch);
+    get_covariance(s, ss, ch);
+    get_alphas(s, ss, ch);
+    get_chirps(s, ss, ch);
+    create_high_signal(s, ss, ch);
+    estimate_spectral_envelopes(s, ss, ch);
+    map_signoise(s, ss, ch);
+    add_sinusoids(s, ss, ch);
 
-    for (int ch = 0; ch < nb_ch; ch++)
-        aspx_processing(s, ss, ch);
-    for (int ch = 0; ch < nb_ch; ch++)
-        get_qsignal_scale_factors(s, ss, ch);
-    for (int ch = 0; ch < nb_ch; ch++)
-        get_qnoise_scale_factors(s, ss, ch);
+    ret = generate_tones(s, ss, ch);
+    if (ret < 0)
+        return ret;
+    ret = generate_noise(s, ss, ch);
+    if (ret < 0)
+        return ret;
 
-    for (int ch = 0; ch < nb_ch; ch++) {
-        if (ss->ssch[ch].aspx_balance == 0)
-            mono_deq_signal_factors(s, ss, ch);
-    }
+    assemble_hf_signal(s, ss, ch);
 
-    for (int ch = 0; ch < nb_ch; ch++) {
-        if (ss->ssch[ch].aspx_balance == 0)
-            mono_deq_noise_factors(s, ss, ch);
-    }
+    return 0;
+}
+
+static int channels_aspx_processing(AC4DecodeContext *s, Substream *ss, int nb_ch)
+{
+    int rets[FF_ARRAY_ELEMS(ss->ssch)];
+
+    if (s->substream.codec_mode < CM_ASPX)
+        return 0;
+
+    /* only the joint dequantization of balanced pairs crosses channels */
+    s->avctx->execute2(s->avctx, aspx_dequant_channel, NULL, NULL, nb_ch);
 
     for (int ch = 0; ch < nb_ch; ch++) {
         if (ss->ssch[ch].aspx_balance) {
@@ -6383,34 +6481,11 @@ static int channels_aspx_processing(AC4DecodeContext *s, Substream *ss, int nb_c
         }
     }
 
-    for (int ch = 0; ch < nb_ch; ch++)
-        preflattening(s, ss, ch);
-    for (int ch = 0; ch < nb_ch; ch++)
-        get_covariance(s, ss, ch);
-    for (int ch = 0; ch < nb_ch; ch++)
-        get_alphas(s, ss, ch);
-    for (int ch = 0; ch < nb_ch; ch++)
-        get_chirps(s, ss, ch);
-    for (int ch = 0; ch < nb_ch; ch++)
-        create_high_signal(s, ss, ch);
-    for (int ch = 0; ch < nb_ch; ch++)
-        estimate_spectral_envelopes(s, ss, ch);
-    for (int ch = 0; ch < nb_ch; ch++)
-        map_signoise(s, ss, ch);
-    for (int ch = 0; ch < nb_ch; ch++)
-        add_sinusoids(s, ss, ch);
-    for (int ch = 0; ch < nb_ch; ch++) {
-        ret = generate_tones(s, ss, ch);
-        if (ret < 0)
-            return ret;
-    }
+    s->avctx->execute2(s->avctx, aspx_hfgen_channel, NULL, rets, nb_ch);
     for (int ch = 0; ch < nb_ch; ch++) {
-        ret = generate_noise(s, ss, ch);
-        if (ret < 0)
-            return ret;
+        if (rets[ch] < 0)
+            return rets[ch];
     }
-    for (int ch = 0; ch < nb_ch; ch++)
-        assemble_hf_signal(s, ss, ch);
 
     return 0;
 }
@@ -6520,12 +6595,17 @@ static void channels_companding(AC4DecodeContext *s, Substream *ss, int nb_ch)
     }
 }
 
-static void decode_channel(AC4DecodeContext *s, int ch, float *pcm)
+static int decode_channel(AVCodecContext *avctx, void *arg, int ch, int threadnr)
 {
-    Substream *ss = &s->substream;
-    SubstreamChannel *ssch = &ss->ssch[ch];
+    AC4DecodeContext *s = avctx->priv_data;
+    AVFrame *frame = arg;
+    const int sch = av_channel_layout_channel_from_index(&avctx->ch_layout, ch);
+    const int dch = s->ch_map[sch];
+    SubstreamChannel *ssch = &s->substream.ssch[dch];
+
+    qmf_synthesis(s, &s->td[threadnr], ssch, (float *)frame->extended_data[ch]);
 
-    qmf_synthesis(s, ssch, pcm);
+    return 0;
 }
 
 static int ac4_decode_frame(AVCodecContext *avctx, AVFrame *frame,
@@ -6611,8 +6691,10 @@ static int ac4_decode_frame(AVCodecContext *avctx, AVFrame *frame,
     if (get_bits_left(gb) < 0)
         av_log(s->avctx, AV_LOG_WARNING, "overread\n");
 
-    for (int ch = 0; ch < avctx->ch_layout.nb_channels; ch++)
-        scale_spec(s, ch);
+    if ((ret = init_transforms(s)) < 0)
+        return ret;
+
+    avctx->execute2(avctx, scale_spec, NULL, NULL, avctx->ch_layout.nb_channels);
 
     switch (ssinfo->channel_mode) {
     case 0:
@@ -6627,8 +6709,7 @@ static int ac4_decode_frame(AVCodecContext *avctx, AVFrame *frame,
         break;
     }
 
-    for (int ch = 0; ch < avctx->ch_layout.nb_channels; ch++)
-        prepare_channel(s, ch);
+    avctx->execute2(avctx, prepare_channel, NULL, NULL, avctx->ch_layout.nb_channels);
 
     channels_companding(s, &s->substream, avctx->ch_layout.nb_channels);
 
@@ -6639,12 +6720,7 @@ static int ac4_decode_frame(AVCodecContext *avctx, AVFrame *frame,
     if (get_bits_left(gb) > 0)
         av_log(s->avctx, AV_LOG_DEBUG, "underread %d\n", get_bits_left(gb));
 
-    for (int ch = 0; ch < avctx->ch_layout.nb_channels; ch++) {
-        const int sch = av_channel_layout_channel_from_index(&avctx->ch_layout, ch);
-        const int dch = s->ch_map[sch];
-
-        decode_channel(s, dch, (float *)frame->extended_data[ch]);
-    }
+    avctx->execute2(avctx, decode_channel, frame, NULL, avctx->ch_layout.nb_channels);
 
     if (s->iframe_global)
         frame->flags |= AV_FRAME_FLAG_KEY;
@@ -6670,9 +6746,15 @@ static av_cold int ac4_decode_end(AVCodecContext *avctx)
 
     av_freep(&s->fdsp);
 
-    for (int j = 0; j < 8; j++)
+    for (int n = 0; s->td && n < s->nb_threads; n++) {
+        AC4ThreadContext *td = &s->td[n];
+
         for (int i = 0; i < 5; i++)
-            av_tx_uninit(&s->tx_ctx[j][i]);
+            av_tx_uninit(&td->tx_ctx[i]);
+        av_tx_uninit(&td->qmf_ana_ctx);
+        av_tx_uninit(&td->qmf_syn_ctx);
+    }
+    av_freep(&s->td);
 
     return 0;
 }
@@ -6703,6 +6785,7 @@ const FFCodec ff_ac4_decoder = {
     .close          = ac4_decode_end,
     FF_CODEC_DECODE_CB(ac4_decode_frame),
     .flush          = ac4_flush,
-    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_CHANNEL_CONF,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_CHANNEL_CONF |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP,
 };
@@ -37,9 +37,12 @@
 #include "decode.h"
 #include "internal.h"
 #include "mlz.h"
+#include "thread.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/refstruct.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/threadprogress.h"
 #include "libavutil/crc.h"
 #include "libavutil/softfloat_ieee754.h"
 #include "libavutil/intreadwrite.h"
@@ -242,9 +245,32 @@ typedef struct ALSDecContext {
     int *nbits;                     ///< contains the number of bits to read for masked lz decompression for all samples
     int highest_decoded_channel;
     int user_max_order;             ///< user specified maximum prediction order
+    unsigned int max_blocks;        ///< maximum number of blocks per channel in a frame
+    struct ALSBlockData *block_data; ///< blocks of all channels, read ahead of their reconstruction
+    struct ALSBlockParams *block_params; ///< parameters of the blocks read ahead
+    int32_t *block_quant_cof;       ///< quantized parcor coefficients of the blocks read ahead
+    int32_t *channel_scratch;       ///< per-channel scratch buffers for the reconstruction
+    struct ALSDecodeJob *jobs;      ///< channels and channel pairs to be reconstructed
+    int nb_jobs;                    ///< number of jobs for the current frame
+    /* Random access frames may still predict from the carryover samples of
+     * the previous frame, so with frame threading they wait for them only
+     * if they do. */
+    struct ALSCarryover *curr_carryover, *prev_carryover; ///< RefStruct references
+    AVRefStructPool *carryover_pool; ///< RefStruct reference
+    int carryover_channels;         ///< number of channels whose carryover samples were updated by the current frame
+    int carryover_imported;         ///< true if the carryover samples of the previous frame were taken over
 } ALSDecContext;
 
 
+/** Carryover samples of all channels after a frame, shared between
+ *  frame threads.
+ */
+typedef struct ALSCarryover {
+    ThreadProgress progress;
+    int32_t samples[];
+} ALSCarryover;
+
+
 typedef struct ALSBlockData {
     unsigned int block_length;      ///< number of samples within the block
     unsigned int ra_block;          ///< if true, this is a random access block
@@ -261,9 +287,35 @@ typedef struct ALSBlockData {
     int32_t      *raw_samples;      ///< decoded raw samples / residuals for this block
     int32_t      *prev_raw_samples; ///< contains unshifted raw samples from the previous block
     int32_t      *raw_other;        ///< decoded raw samples of the other channel of a channel pair
+    int32_t      *lpc_cof_reversed; ///< temporary buffer to set up a reversed version of lpc_cof
 } ALSBlockData;
 
 
+/** Parameters of a block that is read before it is reconstructed.
+ */
+typedef struct ALSBlockParams {
+    int          const_block;
+    unsigned int shift_lsbs;
+    unsigned int opt_order;
+    int          store_prev_samples;
+    int          use_ltp;
+    int          ltp_lag;
+    int          ltp_gain[5];
+} ALSBlockParams;
+
+
+/** A channel, or a channel pair, whose blocks have been read and which can
+ *  be reconstructed independently of the other channels.
+ */
+typedef struct ALSDecodeJob {
+    unsigned int channel;           ///< first channel
+    int          pair;              ///< if true, the next channel is decoded jointly
+    unsigned int num_blocks;        ///< number of blocks in the frame
+    unsigned int blocks_read;       ///< number of blocks read without errors
+    unsigned int div_blocks[32];    ///< block sizes
+} ALSDecodeJob;
+
+
 static av_cold void dprint_specific_config(ALSDecContext *ctx)
 {
 #ifdef DEBUG
@@ -932,7 +984,7 @@ static int decode_var_block_data(ALSDecContext *ctx, ALSBlockData *bd)
     int32_t *lpc_cof          = bd->lpc_cof;
     int32_t *raw_samples      = bd->raw_samples;
     int32_t *raw_samples_end  = bd->raw_samples + bd->block_length;
-    int32_t *lpc_cof_reversed = ctx->lpc_cof_reversed_buffer;
+    int32_t *lpc_cof_reversed = bd->lpc_cof_reversed;
 
     // reverse long-term prediction
     if (*bd->use_ltp) {
@@ -1017,8 +1069,9 @@ static int decode_var_block_data(ALSDecContext *ctx, ALSBlockData *bd)
 
     raw_samples = bd->raw_samples;
 
-    // restore previous samples in case that they have been altered
-    if (*bd->store_prev_samples)
+    // restore previous samples in case that they have been altered,
+    // random access blocks do not store them
+    if (*bd->store_prev_samples && !bd->ra_block)
         memcpy(raw_samples - sconf->max_order, bd->prev_raw_samples,
                sizeof(*raw_samples) * sconf->max_order);
 
@@ -1079,19 +1132,6 @@ static int decode_block(ALSDecContext *ctx, ALSBlockData *bd)
 }
 
 
-/** Read and decode block data successively.
- */
-static int read_decode_block(ALSDecContext *ctx, ALSBlockData *bd)
-{
-    int ret;
-
-    if ((ret = read_block(ctx, bd)) < 0)
-        return ret;
-
-    return decode_block(ctx, bd);
-}
-
-
 /** Compute the number of samples left to decode for the current frame and
  *  sets these samples to zero.
  */
@@ -1108,132 +1148,209 @@ static void zero_remaining(unsigned int b, unsigned int b_max,
 }
 
 
-/** Decode blocks independently.
+/** Set up the block data of a block that is read ahead.
  */
-static int decode_blocks_ind(ALSDecContext *ctx, unsigned int ra_frame,
-                             unsigned int c, const unsigned int *div_blocks,
-                             unsigned int *js_blocks)
+static ALSBlockData *get_block_data(ALSDecContext *ctx, unsigned int c,
+                                    unsigned int b, unsigned int ra_block,
+                                    unsigned int offset,
+                                    unsigned int block_length)
 {
+    ALSSpecificConfig *sconf = &ctx->sconf;
+    ALSBlockData     *bd     = &ctx->block_data  [c * ctx->max_blocks + b];
+    ALSBlockParams   *bp     = &ctx->block_params[c * ctx->max_blocks + b];
+    int32_t          *tmp    = ctx->channel_scratch + c * 3 * sconf->max_order;
+
+    bp->use_ltp = 0;
+
+    bd->block_length       = block_length;
+    bd->ra_block           = ra_block;
+    bd->const_block        = &bp->const_block;
+    bd->js_blocks          = 0;
+    bd->shift_lsbs         = &bp->shift_lsbs;
+    bd->opt_order          = &bp->opt_order;
+    bd->store_prev_samples = &bp->store_prev_samples;
+    bd->use_ltp            = &bp->use_ltp;
+    bd->ltp_lag            = &bp->ltp_lag;
+    bd->ltp_gain           = bp->ltp_gain;
+    bd->quant_cof          = ctx->block_quant_cof +
+                             (c * ctx->max_blocks + b) * sconf->max_order;
+    bd->lpc_cof            = tmp;
+    bd->lpc_cof_reversed   = tmp + sconf->max_order;
+    bd->prev_raw_samples   = tmp + sconf->max_order * 2;
+    bd->raw_samples        = ctx->raw_samples[c] + offset;
+    bd->raw_other          = NULL;
+
+    return bd;
+}
+
+
+/** Read the blocks of a channel that is decoded independently.
+ */
+static int read_blocks_ind(ALSDecContext *ctx, unsigned int ra_frame,
+                           ALSDecodeJob *job)
+{
+    unsigned int offset = 0;
     int ret;
-    unsigned int b;
-    ALSBlockData bd = { 0 };
-
-    bd.ra_block         = ra_frame;
-    bd.const_block      = ctx->const_block;
-    bd.shift_lsbs       = ctx->shift_lsbs;
-    bd.opt_order        = ctx->opt_order;
-    bd.store_prev_samples = ctx->store_prev_samples;
-    bd.use_ltp          = ctx->use_ltp;
-    bd.ltp_lag          = ctx->ltp_lag;
-    bd.ltp_gain         = ctx->ltp_gain[0];
-    bd.quant_cof        = ctx->quant_cof[0];
-    bd.lpc_cof          = ctx->lpc_cof[0];
-    bd.prev_raw_samples = ctx->prev_raw_samples;
-    bd.raw_samples      = ctx->raw_samples[c];
-
-
-    for (b = 0; b < ctx->num_blocks; b++) {
-        bd.block_length     = div_blocks[b];
-
-        if ((ret = read_decode_block(ctx, &bd)) < 0) {
-            // damaged block, write zero for the rest of the frame
-            zero_remaining(b, ctx->num_blocks, div_blocks, bd.raw_samples);
+
+    for (job->blocks_read = 0; job->blocks_read < job->num_blocks; job->blocks_read++) {
+        unsigned int b   = job->blocks_read;
+        ALSBlockData *bd = get_block_data(ctx, job->channel, b, ra_frame && !b,
+                                          offset, job->div_blocks[b]);
+
+        if ((ret = read_block(ctx, bd)) < 0)
             return ret;
-        }
-        bd.raw_samples += div_blocks[b];
-        bd.ra_block     = 0;
+        offset += job->div_blocks[b];
     }
 
     return 0;
 }
 
 
-/** Decode blocks dependently.
+/** Read the blocks of a channel pair that is decoded dependently.
  */
-static int decode_blocks(ALSDecContext *ctx, unsigned int ra_frame,
-                         unsigned int c, const unsigned int *div_blocks,
-                         unsigned int *js_blocks)
+static int read_blocks(ALSDecContext *ctx, unsigned int ra_frame,
+                       ALSDecodeJob *job)
 {
-    ALSSpecificConfig *sconf = &ctx->sconf;
     unsigned int offset = 0;
-    unsigned int b;
     int ret;
-    ALSBlockData bd[2] = { { 0 } };
-
-    bd[0].ra_block         = ra_frame;
-    bd[0].const_block      = ctx->const_block;
-    bd[0].shift_lsbs       = ctx->shift_lsbs;
-    bd[0].opt_order        = ctx->opt_order;
-    bd[0].store_prev_samples = ctx->store_prev_samples;
-    bd[0].use_ltp          = ctx->use_ltp;
-    bd[0].ltp_lag          = ctx->ltp_lag;
-    bd[0].ltp_gain         = ctx->ltp_gain[0];
-    bd[0].quant_cof        = ctx->quant_cof[0];
-    bd[0].lpc_cof          = ctx->lpc_cof[0];
-    bd[0].prev_raw_samples = ctx->prev_raw_samples;
-    bd[0].js_blocks        = *js_blocks;
-
-    bd[1].ra_block         = ra_frame;
-    bd[1].const_block      = ctx->const_block;
-    bd[1].shift_lsbs       = ctx->shift_lsbs;
-    bd[1].opt_order        = ctx->opt_order;
-    bd[1].store_prev_samples = ctx->store_prev_samples;
-    bd[1].use_ltp          = ctx->use_ltp;
-    bd[1].ltp_lag          = ctx->ltp_lag;
-    bd[1].ltp_gain         = ctx->ltp_gain[0];
-    bd[1].quant_cof        = ctx->quant_cof[0];
-    bd[1].lpc_cof          = ctx->lpc_cof[0];
-    bd[1].prev_raw_samples = ctx->prev_raw_samples;
-    bd[1].js_blocks        = *(js_blocks + 1);
-
-    // decode all blocks
-    for (b = 0; b < ctx->num_blocks; b++) {
-        unsigned int s;
-
-        bd[0].block_length = div_blocks[b];
-        bd[1].block_length = div_blocks[b];
-
-        bd[0].raw_samples  = ctx->raw_samples[c    ] + offset;
-        bd[1].raw_samples  = ctx->raw_samples[c + 1] + offset;
-
-        bd[0].raw_other    = bd[1].raw_samples;
-        bd[1].raw_other    = bd[0].raw_samples;
-
-        if ((ret = read_decode_block(ctx, &bd[0])) < 0 ||
-            (ret = read_decode_block(ctx, &bd[1])) < 0)
-            goto fail;
+
+    for (job->blocks_read = 0; job->blocks_read < job->num_blocks; job->blocks_read++) {
+        unsigned int b = job->blocks_read;
+        ALSBlockData *bd[2];
+
+        bd[0] = get_block_data(ctx, job->channel,     b, ra_frame && !b,
+                               offset, job->div_blocks[b]);
+        bd[1] = get_block_data(ctx, job->channel + 1, b, ra_frame && !b,
+                               offset, job->div_blocks[b]);
+
+        bd[0]->raw_other = bd[1]->raw_samples;
+        bd[1]->raw_other = bd[0]->raw_samples;
+
+        if ((ret = read_block(ctx, bd[0])) < 0 ||
+            (ret = read_block(ctx, bd[1])) < 0)
+            return ret;
+        offset += job->div_blocks[b];
+    }
+
+    return 0;
+}
+
+
+/** Reconstruct the blocks of a channel or a channel pair that were read.
+ */
+static int decode_channels(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    ALSDecContext *ctx       = avctx->priv_data;
+    ALSSpecificConfig *sconf = &ctx->sconf;
+    ALSDecodeJob *job        = (ALSDecodeJob *)arg + jobnr;
+    ALSBlockData *bd[2]      = { ctx->block_data +  job->channel      * ctx->max_blocks,
+                                 ctx->block_data + (job->channel + 1) * ctx->max_blocks };
+    unsigned int b, s;
+    int ret = 0;
+
+    for (b = 0; b < job->blocks_read; b++) {
+        if ((ret = decode_block(ctx, &bd[0][b])) < 0)
+            break;
+        if (!job->pair)
+            continue;
+        if ((ret = decode_block(ctx, &bd[1][b])) < 0)
+            break;
 
         // reconstruct joint-stereo blocks
-        if (bd[0].js_blocks) {
-            if (bd[1].js_blocks)
-                av_log(ctx->avctx, AV_LOG_WARNING, "Invalid channel pair.\n");
-
-            for (s = 0; s < div_blocks[b]; s++)
-                bd[0].raw_samples[s] = bd[1].raw_samples[s] - (unsigned)bd[0].raw_samples[s];
-        } else if (bd[1].js_blocks) {
-            for (s = 0; s < div_blocks[b]; s++)
-                bd[1].raw_samples[s] = bd[1].raw_samples[s] + (unsigned)bd[0].raw_samples[s];
+        if (bd[0][b].js_blocks) {
+            if (bd[1][b].js_blocks)
+                av_log(avctx, AV_LOG_WARNING, "Invalid channel pair.\n");
+
+            for (s = 0; s < job->div_blocks[b]; s++)
+                bd[0][b].raw_samples[s] = bd[1][b].raw_samples[s] - (unsigned)bd[0][b].raw_samples[s];
+        } else if (bd[1][b].js_blocks) {
+            for (s = 0; s < job->div_blocks[b]; s++)
+                bd[1][b].raw_samples[s] = bd[1][b].raw_samples[s] + (unsigned)bd[0][b].raw_samples[s];
         }
+    }
 
-        offset  += div_blocks[b];
-        bd[0].ra_block = 0;
-        bd[1].ra_block = 0;
+    if (b < job->num_blocks) {
+        // damaged block, write zero for the rest of the frame
+        for (int i = 0; i <= job->pair; i++)
+            zero_remaining(b, job->num_blocks, job->div_blocks, bd[i][b].raw_samples);
+        return ret;
     }
 
-    // store carryover raw samples,
-    // the others channel raw samples are stored by the calling function.
-    memmove(ctx->raw_samples[c] - sconf->max_order,
-            ctx->raw_samples[c] - sconf->max_order + sconf->frame_length,
-            sizeof(*ctx->raw_samples[c]) * sconf->max_order);
+    // store carryover raw samples
+    for (int i = 0; i <= job->pair; i++) {
+        int32_t *raw_samples = ctx->raw_samples[job->channel + i];
+
+        memmove(raw_samples - sconf->max_order,
+                raw_samples - sconf->max_order + sconf->frame_length,
+                sizeof(*raw_samples) * sconf->max_order);
+    }
 
     return 0;
-fail:
-    // damaged block, write zero for the rest of the frame
-    zero_remaining(b, ctx->num_blocks, div_blocks, bd[0].raw_samples);
-    zero_remaining(b, ctx->num_blocks, div_blocks, bd[1].raw_samples);
-    return ret;
 }
 
+/** Return whether any of the blocks read predicts from samples before
+ *  the start of the frame.
+ */
+static int blocks_need_carryover(ALSDecContext *ctx)
+{
+    for (int j = 0; j < ctx->nb_jobs; j++) {
+        const ALSDecodeJob *job = &ctx->jobs[j];
+
+        for (int i = 0; i <= job->pair; i++) {
+            unsigned int c   = job->channel + i;
+            ALSBlockData *bd = ctx->block_data + c * ctx->max_blocks;
+
+            for (int b = 0; b < job->blocks_read; b++) {
+                if (!bd[b].ra_block && !*bd[b].const_block &&
+                    bd[b].raw_samples - ctx->raw_samples[c] < *bd[b].opt_order)
+                    return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/** Take over the carryover samples of the previous frame from the given
+ *  channel on, waiting for them with frame threading.
+ */
+static void import_carryover(ALSDecContext *ctx, int channel)
+{
+    unsigned int max_order = ctx->sconf.max_order;
+    int channels           = ctx->avctx->ch_layout.nb_channels;
+
+    if (!ctx->prev_carryover)
+        return;
+
+    ff_thread_progress_await(&ctx->prev_carryover->progress, INT_MAX);
+    for (; channel < channels; channel++)
+        memcpy(ctx->raw_samples[channel] - max_order,
+               ctx->prev_carryover->samples + channel * max_order,
+               sizeof(*ctx->raw_samples[channel]) * max_order);
+}
+
+
+/** Make the carryover samples of the current frame available to the next
+ *  one with frame threading.
+ */
+static void report_carryover(ALSDecContext *ctx)
+{
+    unsigned int max_order = ctx->sconf.max_order;
+    int channels           = ctx->avctx->ch_layout.nb_channels;
+
+    // channels that were not decoded keep the carryover samples they had
+    if (!ctx->carryover_imported)
+        import_carryover(ctx, ctx->carryover_channels);
+
+    for (int c = 0; c < channels; c++)
+        memcpy(ctx->curr_carryover->samples + c * max_order,
+               ctx->raw_samples[c] - max_order,
+               sizeof(*ctx->raw_samples[c]) * max_order);
+    ff_thread_progress_report(&ctx->curr_carryover->progress, INT_MAX);
+}
+
+
 static inline int als_weighting(GetBitContext *gb, int k, int off)
 {
     int idx = av_clip(decode_rice(gb, k) + off,
@@ -1651,8 +1768,8 @@ static int read_frame_data(ALSDecContext *ctx, unsigned int ra_frame)
     AVCodecContext *avctx    = ctx->avctx;
     GetBitContext *gb = &ctx->gb;
     unsigned int div_blocks[32];                ///< block sizes.
+    unsigned int offset = 0;
     int c;
-    unsigned int js_blocks[2];
     int channels = avctx->ch_layout.nb_channels;
     uint32_t bs_info = 0;
     int ret;
@@ -1668,13 +1785,20 @@ static int read_frame_data(ALSDecContext *ctx, unsigned int ra_frame)
 
     if (!sconf->mc_coding || ctx->js_switch) {
         int independent_bs = !sconf->joint_stereo;
-        if (get_bits_left(gb) < 7*channels*ctx->num_blocks)
+        // every channel has at least one block, the number of blocks of
+        // the previous frame is not known with frame threading
+        if (get_bits_left(gb) < 7*channels)
             return AVERROR_INVALIDDATA;
+
+        // read all channels first, they are then reconstructed in parallel
+        ctx->nb_jobs = 0;
+        ret = 0;
         for (c = 0; c < channels; c++) {
-            js_blocks[0] = 0;
-            js_blocks[1] = 0;
+            ALSDecodeJob *job = &ctx->jobs[ctx->nb_jobs++];
 
-            get_block_sizes(ctx, div_blocks, &bs_info);
+            get_block_sizes(ctx, job->div_blocks, &bs_info);
+            job->channel    = c;
+            job->num_blocks = ctx->num_blocks;
 
             // if joint_stereo and block_switching is set, independent decoding
             // is signaled via the first bit of bs_info
@@ -1687,30 +1811,41 @@ static int read_frame_data(ALSDecContext *ctx, unsigned int ra_frame)
                 independent_bs = 1;
 
             if (independent_bs) {
-                ret = decode_blocks_ind(ctx, ra_frame, c,
-                                        div_blocks, js_blocks);
-                if (ret < 0)
-                    return ret;
+                job->pair = 0;
+                ret = read_blocks_ind(ctx, ra_frame, job);
                 independent_bs--;
             } else {
-                ret = decode_blocks(ctx, ra_frame, c, div_blocks, js_blocks);
-                if (ret < 0)
-                    return ret;
-
+                job->pair = 1;
+                ret = read_blocks(ctx, ra_frame, job);
                 c++;
             }
+            if (ret < 0)
+                break;
 
-            // store carryover raw samples
-            memmove(ctx->raw_samples[c] - sconf->max_order,
-                    ctx->raw_samples[c] - sconf->max_order + sconf->frame_length,
-                    sizeof(*ctx->raw_samples[c]) * sconf->max_order);
             ctx->highest_decoded_channel = c;
         }
+
+        if (ctx->prev_carryover && blocks_need_carryover(ctx)) {
+            import_carryover(ctx, 0);
+            ctx->carryover_imported = 1;
+        }
+
+        avctx->execute2(avctx, decode_channels, ctx->jobs, NULL, ctx->nb_jobs);
+        if (ret < 0) {
+            const ALSDecodeJob *job = &ctx->jobs[ctx->nb_jobs - 1];
+
+            // write zero for the channels that were not read
+            for (c = job->channel + job->pair + 1; c < channels; c++)
+                memset(ctx->raw_samples[c], 0,
+                       sizeof(*ctx->raw_samples[c]) * sconf->frame_length);
+            ctx->carryover_channels = job->channel;
+            return ret;
+        }
+        ctx->carryover_channels = channels;
     } else { // multi-channel coding
         ALSBlockData   bd = { 0 };
-        int            b, ret;
+        int            b;
         int            *reverted_channels = ctx->reverted_channels;
-        unsigned int   offset             = 0;
 
         for (c = 0; c < channels; c++)
             if (ctx->chan_data[c] < ctx->chan_data_buffer) {
@@ -1722,6 +1857,11 @@ static int read_frame_data(ALSDecContext *ctx, unsigned int ra_frame)
 
         bd.ra_block         = ra_frame;
         bd.prev_raw_samples = ctx->prev_raw_samples;
+        bd.lpc_cof_reversed = ctx->lpc_cof_reversed_buffer;
+
+        // blocks are reconstructed as they are read
+        import_carryover(ctx, 0);
+        ctx->carryover_imported = 1;
 
         get_block_sizes(ctx, div_blocks, &bs_info);
 
@@ -1748,16 +1888,16 @@ static int read_frame_data(ALSDecContext *ctx, unsigned int ra_frame)
                 bd.raw_other   = NULL;
 
                 if ((ret = read_block(ctx, &bd)) < 0)
-                    return ret;
+                    goto fail;
                 if ((ret = read_channel_data(ctx, ctx->chan_data[c], c)) < 0)
-                    return ret;
+                    goto fail;
             }
 
             for (c = 0; c < channels; c++) {
                 ret = revert_channel_correlation(ctx, &bd, ctx->chan_data,
                                                  reverted_channels, offset, c);
                 if (ret < 0)
-                    return ret;
+                    goto fail;
             }
             for (c = 0; c < channels; c++) {
                 bd.const_block = ctx->const_block + c;
@@ -1772,7 +1912,7 @@ static int read_frame_data(ALSDecContext *ctx, unsigned int ra_frame)
                 bd.raw_samples = ctx->raw_samples[c] + offset;
 
                 if ((ret = decode_block(ctx, &bd)) < 0)
-                    return ret;
+                    goto fail;
 
                 ctx->highest_decoded_channel = FFMAX(ctx->highest_decoded_channel, c);
             }
@@ -1787,6 +1927,7 @@ static int read_frame_data(ALSDecContext *ctx, unsigned int ra_frame)
             memmove(ctx->raw_samples[c] - sconf->max_order,
                     ctx->raw_samples[c] - sconf->max_order + sconf->frame_length,
                     sizeof(*ctx->raw_samples[c]) * sconf->max_order);
+        ctx->carryover_channels = channels;
     }
 
     if (sconf->floating) {
@@ -1799,6 +1940,26 @@ static int read_frame_data(ALSDecContext *ctx, unsigned int ra_frame)
     }
 
     return 0;
+
+fail:
+    // damaged block in multi-channel coding, write zero for the rest of the frame
+    for (c = 0; c < channels; c++)
+        memset(ctx->raw_samples[c] + offset, 0,
+               sizeof(*ctx->raw_samples[c]) * (sconf->frame_length - offset));
+    return ret;
+}
+
+
+/** Return whether the frame following the current one can be decoded
+ *  without the decoder state after the current one.
+ */
+static int next_frame_is_independent(const ALSDecContext *ctx)
+{
+    const ALSSpecificConfig *sconf = &ctx->sconf;
+
+    // the CRC is computed over the whole stream
+    return !ctx->crc_table && sconf->ra_distance &&
+           !(ctx->frame_id % sconf->ra_distance);
 }
 
 
@@ -1831,25 +1992,43 @@ static int decode_frame(AVCodecContext *avctx, AVFrame *frame,
     else
         ctx->cur_frame_length = sconf->frame_length;
 
+    /* get output buffer */
+    frame->nb_samples = ctx->cur_frame_length;
+    if ((ret = ff_thread_get_buffer(avctx, frame, 0)) < 0)
+        return ret;
+
+    if (ctx->carryover_pool) {
+        av_refstruct_unref(&ctx->prev_carryover);
+        ctx->prev_carryover = av_refstruct_pool_get(ctx->carryover_pool);
+        if (!ctx->prev_carryover)
+            return AVERROR(ENOMEM);
+        FFSWAP(ALSCarryover*, ctx->prev_carryover, ctx->curr_carryover);
+    }
+    ctx->carryover_channels = 0;
+    ctx->carryover_imported = 0;
+
+    ctx->frame_id++;
+
+    // with frame threading, the next frame waits for this one unless it is
+    // a random access frame
+    if (next_frame_is_independent(ctx))
+        ff_thread_finish_setup(avctx);
+
     ctx->highest_decoded_channel = -1;
     // decode the frame data
     if ((invalid_frame = read_frame_data(ctx, ra_frame)) < 0)
         av_log(ctx->avctx, AV_LOG_WARNING,
                "Reading frame data failed. Skipping RA unit.\n");
 
+    if (ctx->curr_carryover)
+        report_carryover(ctx);
+
     if (ctx->highest_decoded_channel == -1) {
         av_log(ctx->avctx, AV_LOG_WARNING,
                "No channel data decoded.\n");
         return AVERROR_INVALIDDATA;
     }
 
-    ctx->frame_id++;
-
-    /* get output buffer */
-    frame->nb_samples = ctx->cur_frame_length;
-    if ((ret = ff_get_buffer(avctx, frame, 0)) < 0)
-        return ret;
-
     // transform decoded frame into output format
     #define INTERLEAVE_OUTPUT(bps)                                                   \
     {                                                                                \
@@ -1936,10 +2115,74 @@ static int decode_frame(AVCodecContext *avctx, AVFrame *frame,
     bytes_read = invalid_frame ? buffer_size :
                                  (get_bits_count(&ctx->gb) + 7) >> 3;
 
+    // with frame threading, the setup of the next frame may already be
+    // finished, so the packet cannot contain another frame
+    if (avctx->active_thread_type & FF_THREAD_FRAME)
+        bytes_read = buffer_size;
+
     return bytes_read;
 }
 
 
+#if HAVE_THREADS
+static int update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    ALSDecContext *fsrc      = src->priv_data;
+    ALSDecContext *fdst      = dst->priv_data;
+    ALSSpecificConfig *sconf = &fsrc->sconf;
+    int channels             = src->ch_layout.nb_channels;
+
+    fdst->frame_id = fsrc->frame_id;
+    fdst->crc      = fsrc->crc;
+    av_refstruct_replace(&fdst->curr_carryover, fsrc->curr_carryover);
+
+    // otherwise the source is done with its frame, take over the state
+    // the next frame is decoded from
+    if (next_frame_is_independent(fsrc))
+        return 0;
+
+    for (int c = 0; c < channels; c++)
+        memcpy(fdst->raw_samples[c] - sconf->max_order,
+               fsrc->raw_samples[c] - sconf->max_order,
+               sizeof(*fdst->raw_samples[c]) * sconf->max_order);
+
+    if (sconf->floating) {
+        MLZDict *dict = fdst->mlz->dict;
+        void *context = fdst->mlz->context;
+
+        memcpy(fdst->last_acf_mantissa, fsrc->last_acf_mantissa,
+               channels * sizeof(*fdst->last_acf_mantissa));
+        memcpy(fdst->last_shift_value, fsrc->last_shift_value,
+               channels * sizeof(*fdst->last_shift_value));
+        *fdst->mlz          = *fsrc->mlz;
+        fdst->mlz->dict     = dict;
+        fdst->mlz->context  = context;
+        memcpy(dict, fsrc->mlz->dict, TABLE_SIZE * sizeof(*dict));
+    }
+
+    return 0;
+}
+
+static av_cold int carryover_pool_init_cb(AVRefStructOpaque opaque, void *obj)
+{
+    ALSCarryover *carryover = obj;
+    return ff_thread_progress_init(&carryover->progress, 1);
+}
+
+static void carryover_pool_reset_cb(AVRefStructOpaque opaque, void *obj)
+{
+    ALSCarryover *carryover = obj;
+    ff_thread_progress_reset(&carryover->progress);
+}
+
+static av_cold void carryover_pool_free_entry_cb(AVRefStructOpaque opaque, void *obj)
+{
+    ALSCarryover *carryover = obj;
+    ff_thread_progress_destroy(&carryover->progress);
+}
+#endif
+
+
 /** Uninitialize the ALS decoder.
  */
 static av_cold int decode_end(AVCodecContext *avctx)
@@ -1987,6 +2230,14 @@ static av_cold int decode_end(AVCodecContext *avctx)
     }
     av_freep(&ctx->larray);
     av_freep(&ctx->nbits);
+    av_freep(&ctx->block_data);
+    av_freep(&ctx->block_params);
+    av_freep(&ctx->block_quant_cof);
+    av_freep(&ctx->channel_scratch);
+    av_freep(&ctx->jobs);
+    av_refstruct_pool_uninit(&ctx->carryover_pool);
+    av_refstruct_unref(&ctx->curr_carryover);
+    av_refstruct_unref(&ctx->prev_carryover);
 
     return 0;
 }
@@ -2091,6 +2342,35 @@ static av_cold int decode_init(AVCodecContext *avctx)
     for (c = 0; c < num_buffers; c++)
         ctx->ltp_gain[c] = ctx->ltp_gain_buffer + c * 5;
 
+    // allocate the buffers for reading all blocks of a frame ahead of
+    // their reconstruction
+    ctx->max_blocks      = sconf->block_switching ? 1 << (sconf->block_switching + 2) : 1;
+    ctx->block_data      = av_calloc(channels * ctx->max_blocks, sizeof(*ctx->block_data));
+    ctx->block_params    = av_calloc(channels * ctx->max_blocks, sizeof(*ctx->block_params));
+    ctx->block_quant_cof = av_malloc_array(channels * ctx->max_blocks * sconf->max_order,
+                                           sizeof(*ctx->block_quant_cof));
+    ctx->channel_scratch = av_malloc_array(channels * 3 * sconf->max_order,
+                                           sizeof(*ctx->channel_scratch));
+    ctx->jobs            = av_malloc_array(channels, sizeof(*ctx->jobs));
+
+    if (!ctx->block_data || !ctx->block_params || !ctx->block_quant_cof ||
+        !ctx->channel_scratch || !ctx->jobs)
+        return AVERROR(ENOMEM);
+
+#if HAVE_THREADS
+    if (ff_thread_sync_ref(avctx, offsetof(ALSDecContext, carryover_pool)) == FF_THREAD_IS_FIRST_THREAD) {
+        ctx->carryover_pool = av_refstruct_pool_alloc_ext(sizeof(*ctx->curr_carryover) +
+                                                          channels * sconf->max_order *
+                                                          sizeof(*ctx->curr_carryover->samples),
+                                                          AV_REFSTRUCT_POOL_FLAG_FREE_ON_INIT_ERROR, NULL,
+                                                          carryover_pool_init_cb,
+                                                          carryover_pool_reset_cb,
+                                                          carryover_pool_free_entry_cb, NULL);
+        if (!ctx->carryover_pool)
+            return AVERROR(ENOMEM);
+    }
+#endif
+
     // allocate and assign channel data buffer for mcc mode
     if (sconf->mc_coding) {
         ctx->chan_data_buffer  = av_calloc(num_buffers * num_buffers,
@@ -2200,6 +2480,8 @@ const FFCodec ff_als_decoder = {
     FF_CODEC_DECODE_CB(decode_frame),
     .p.priv_class   = &als_class,
     .flush          = flush,
-    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_CHANNEL_CONF,
+    UPDATE_THREAD_CONTEXT(update_thread_context),
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_CHANNEL_CONF |
+                      AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS,
     .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP,
 };
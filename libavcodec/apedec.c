@@ -34,6 +34,7 @@
 #include "codec_internal.h"
 #include "decode.h"
 #include "get_bits.h"
+#include "thread.h"
 #include "unary.h"
 
 /**
@@ -320,6 +321,11 @@ static av_cold int ape_decode_init(AVCodecContext *avctx)
         s->predictor_decode_stereo = predictor_decode_stereo_3950;
     }
 
+    /* Frames restart the predictor and the filters, so they can be decoded
+     * in parallel, but each packet then has to be decoded at once. */
+    if (avctx->active_thread_type & FF_THREAD_FRAME)
+        s->blocks_per_loop = INT_MAX;
+
     ff_bswapdsp_init(&s->bdsp);
     ff_llauddsp_init(&s->adsp);
     av_channel_layout_uninit(&avctx->ch_layout);
@@ -1539,7 +1545,7 @@ static int ape_decode_frame(AVCodecContext *avctx, AVFrame *frame,
     int16_t *sample16;
     int32_t *sample24;
     int i, ch, ret;
-    int blockstodecode;
+    int blockstodecode, interim_known;
     uint64_t decoded_buffer_size;
 
     /* this should never be negative, but bad things will happen if it is, so
@@ -1628,7 +1634,7 @@ static int ape_decode_frame(AVCodecContext *avctx, AVFrame *frame,
 
     /* get output buffer */
     frame->nb_samples = blockstodecode;
-    if ((ret = ff_get_buffer(avctx, frame, 0)) < 0) {
+    if ((ret = ff_thread_get_buffer(avctx, frame, 0)) < 0) {
         s->samples=0;
         return ret;
     }
@@ -1655,11 +1661,20 @@ static int ape_decode_frame(AVCodecContext *avctx, AVFrame *frame,
 
     s->error=0;
 
+    /* The interim mode of 24-bit files is found while decoding the first
+     * frames and then kept, the next frame thread waits until it is known. */
+    interim_known = s->interim_mode >= 0;
+    if (interim_known)
+        ff_thread_finish_setup(avctx);
+
     if ((s->channels == 1) || (s->frameflags & APE_FRAMECODE_PSEUDO_STEREO))
         ape_unpack_mono(s, blockstodecode);
     else
         ape_unpack_stereo(s, blockstodecode);
 
+    if (!interim_known)
+        ff_thread_finish_setup(avctx);
+
     if (s->error) {
         s->samples=0;
         av_log(avctx, AV_LOG_ERROR, "Error decoding frame\n");
@@ -1729,6 +1744,18 @@ static int ape_decode_frame(AVCodecContext *avctx, AVFrame *frame,
     return !s->samples ? avpkt->size : 0;
 }
 
+#if HAVE_THREADS
+static int update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    const APEContext *fsrc = src->priv_data;
+    APEContext *fdst       = dst->priv_data;
+
+    fdst->interim_mode = fsrc->interim_mode;
+
+    return 0;
+}
+#endif
+
 static void ape_flush(AVCodecContext *avctx)
 {
     APEContext *s = avctx->priv_data;
@@ -1759,9 +1786,11 @@ const FFCodec ff_ape_decoder = {
     .close          = ape_decode_close,
     FF_CODEC_DECODE_CB(ape_decode_frame),
     .p.capabilities = AV_CODEC_CAP_DELAY |
-                      AV_CODEC_CAP_DR1,
+                      AV_CODEC_CAP_DR1 |
+                      AV_CODEC_CAP_FRAME_THREADS,
     .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP,
     .flush          = ape_flush,
+    UPDATE_THREAD_CONTEXT(update_thread_context),
     CODEC_SAMPLEFMTS(AV_SAMPLE_FMT_U8P, AV_SAMPLE_FMT_S16P, AV_SAMPLE_FMT_S32P),
     .p.priv_class   = &ape_decoder_class,
 };
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "libavutil/mem.h"
 #include "libavutil/mem_internal.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
@@ -161,11 +162,16 @@ static const uint8_t ac_table[194][2] = {
 static VLCElem dc_vlc[544];
 static VLCElem ac_vlc[2474];
 
+typedef struct TileContext {
+    GetBitContext     gbit;
+    int               x, y;
+    int               blocks_w, blocks_h;
+} TileContext;
+
 typedef struct BRAWContext {
     const AVClass    *class;
 
     GetByteContext    gb;
-    GetBitContext     gbit;
 
     uint32_t          header_size;
 
@@ -176,16 +182,15 @@ typedef struct BRAWContext {
     int               tile_size_w[256];
     int               tile_offset_w[257];
     int               tile_size_h;
-    int               blocks_w_in_tile;
-    int               blocks_h_in_tile;
+
+    TileContext      *tiles;
+    unsigned int      tiles_size;
+    int               tile_ret[1024];
 
     int               qscale;
     int               qscale2;
     int               qscale3;
     int               quant[2][64];
-
-    DECLARE_ALIGNED(32, int16_t, block)[4][64];
-    DECLARE_ALIGNED(32, uint8_t, out)[4][128];
 } BRAWContext;
 
 static int parse_frame_metadata(AVCodecContext *avctx)
@@ -204,13 +209,11 @@ static int parse_frame_metadata(AVCodecContext *avctx)
     return 0;
 }
 
-static int decode_block(AVCodecContext *avctx,
+static int decode_block(GetBitContext *gbit,
                         int16_t *dst, const int *quant,
                         int *prev_dc, int max,
                         const uint8_t *scan)
 {
-    BRAWContext *s = avctx->priv_data;
-    GetBitContext *gbit = &s->gbit;
     int dc_idx, sgnbit = 0, sign, len, val, code;
 
     memset(dst, 0, 64 * 2);
@@ -249,6 +252,33 @@ static int decode_block(AVCodecContext *avctx,
     return 0;
 }
 
+static int ac_is_zero(const int16_t *in, int step, int n)
+{
+    int ac = 0;
+
+    for (int i = 1; i < n; i++)
+        ac |= in[i * step];
+
+    return !ac;
+}
+
+/* what idct8()/idct4() produce when only in[0] is set */
+static void idct8_dc(int16_t *in, int step)
+{
+    const int16_t d = in[0] * 0.353553390593274f;
+
+    for (int i = 0; i < 8; i++)
+        in[i * step] = d;
+}
+
+static void idct4_dc(int16_t *in, int step)
+{
+    const int16_t d = in[0] * 0.5f;
+
+    for (int i = 0; i < 4; i++)
+        in[i * step] = d;
+}
+
 static void idct4(int16_t *in, int step)
 {
     const float a = 0.270598050073099f;
@@ -345,10 +375,18 @@ static void idct4_put(uint8_t *ddst, ptrdiff_t stride, int16_t *block)
 {
     uint16_t *dst = (uint16_t *)ddst;
 
-    for (int i = 0; i < 4; i++)
-        idct8(block + i * 8, 1);
-    for (int i = 0; i < 8; i++)
-        idct4(block + i, 8);
+    for (int i = 0; i < 4; i++) {
+        if (ac_is_zero(block + i * 8, 1, 8))
+            idct8_dc(block + i * 8, 1);
+        else
+            idct8(block + i * 8, 1);
+    }
+    for (int i = 0; i < 8; i++) {
+        if (ac_is_zero(block + i, 8, 4))
+            idct4_dc(block + i, 8);
+        else
+            idct4(block + i, 8);
+    }
 
     for (int i = 0; i < 4; i++) {
         for (int j = 0; j < 8; j++)
@@ -362,10 +400,17 @@ static void idct8_put(uint8_t *ddst, ptrdiff_t stride, int16_t *block)
 {
     uint16_t *dst = (uint16_t *)ddst;
 
-    for (int i = 0; i < 8; i++)
-        idct8(block + i, 8);
     for (int i = 0; i < 8; i++) {
-        idct8(block, 1);
+        if (ac_is_zero(block + i, 8, 8))
+            idct8_dc(block + i, 8);
+        else
+            idct8(block + i, 8);
+    }
+    for (int i = 0; i < 8; i++) {
+        if (ac_is_zero(block, 1, 8))
+            idct8_dc(block, 1);
+        else
+            idct8(block, 1);
         for (int j = 0; j < 8; j++)
             dst[j] = av_clip_uintp2(block[j] + 2048, 12);
         block += 8;
@@ -373,49 +418,50 @@ static void idct8_put(uint8_t *ddst, ptrdiff_t stride, int16_t *block)
     }
 }
 
-static int decode_tile(AVCodecContext *avctx, AVFrame *frame, int tile_x, int tile_y,
-                       int blocks_w_in_tile, int blocks_h_in_tile)
+static int decode_tile(AVCodecContext *avctx, TileContext *tile, AVFrame *frame)
 {
     BRAWContext *s = avctx->priv_data;
-    GetBitContext *gbit = &s->gbit;
+    GetBitContext *gbit = &tile->gbit;
+    LOCAL_ALIGNED_32(int16_t, block, [4], [64]);
+    LOCAL_ALIGNED_32(uint8_t, out, [4], [128]);
     int prev_dc[3];
     int ret = 0;
 
     prev_dc[0] = prev_dc[1] = prev_dc[2] = 0;
 
-    for (int y = 0; y < blocks_h_in_tile; y++) {
-        int pos_y = y * 8 + tile_y * s->tile_size_h;
+    for (int y = 0; y < tile->blocks_h; y++) {
+        int pos_y = y * 8 + tile->y * s->tile_size_h;
 
-        for (int x = 0; x < blocks_w_in_tile; x++) {
-            int pos_x = s->tile_offset_w[tile_x] + x * 16;
+        for (int x = 0; x < tile->blocks_w; x++) {
+            int pos_x = s->tile_offset_w[tile->x] + x * 16;
 
-            ret = decode_block(avctx, s->block[0], s->quant[0], &prev_dc[0], 64, ff_zigzag_direct);
+            ret = decode_block(gbit, block[0], s->quant[0], &prev_dc[0], 64, ff_zigzag_direct);
             if (ret < 0)
                 return ret;
-            ret = decode_block(avctx, s->block[1], s->quant[0], &prev_dc[0], 64, ff_zigzag_direct);
+            ret = decode_block(gbit, block[1], s->quant[0], &prev_dc[0], 64, ff_zigzag_direct);
             if (ret < 0)
                 return ret;
-            ret = decode_block(avctx, s->block[2], s->quant[1], &prev_dc[1], 32, half_scan);
+            ret = decode_block(gbit, block[2], s->quant[1], &prev_dc[1], 32, half_scan);
             if (ret < 0)
                 return ret;
-            ret = decode_block(avctx, s->block[3], s->quant[1], &prev_dc[2], 32, half_scan);
+            ret = decode_block(gbit, block[3], s->quant[1], &prev_dc[2], 32, half_scan);
             if (ret < 0)
                 return ret;
 
-            idct8_put(s->out[0], 8, s->block[0]);
-            idct8_put(s->out[1], 8, s->block[1]);
+            idct8_put(out[0], 8, block[0]);
+            idct8_put(out[1], 8, block[1]);
 
-            idct4_put(s->out[2], 8, s->block[2]);
-            idct4_put(s->out[3], 8, s->block[3]);
+            idct4_put(out[2], 8, block[2]);
+            idct4_put(out[3], 8, block[3]);
 
             {
                 uint16_t *g = (uint16_t *)(frame->data[0] + pos_y * frame->linesize[0] + pos_x * 2);
                 uint16_t *b = (uint16_t *)(frame->data[1] + pos_y * frame->linesize[1] + pos_x * 2);
                 uint16_t *r = (uint16_t *)(frame->data[2] + pos_y * frame->linesize[2] + pos_x * 2);
-                const uint16_t *Y0 = (const uint16_t *)s->out[0];
-                const uint16_t *Y1 = (const uint16_t *)s->out[1];
-                const uint16_t *B  = (const uint16_t *)s->out[2];
-                const uint16_t *R  = (const uint16_t *)s->out[3];
+                const uint16_t *Y0 = (const uint16_t *)out[0];
+                const uint16_t *Y1 = (const uint16_t *)out[1];
+                const uint16_t *B  = (const uint16_t *)out[2];
+                const uint16_t *R  = (const uint16_t *)out[3];
                 int bv, rv, gv;
 
                 for (int yy = 0; yy < 8; yy++) {
@@ -465,6 +511,16 @@ static int decode_tile(AVCodecContext *avctx, AVFrame *frame, int tile_x, int ti
     return ret;
 }
 
+static int decode_tiles_thread(AVCodecContext *avctx, void *arg,
+                               int n, int thread_nb)
+{
+    BRAWContext *s = avctx->priv_data;
+    TileContext *tile = &s->tiles[n];
+    AVFrame *frame = arg;
+
+    return decode_tile(avctx, tile, frame);
+}
+
 static int get_offset(AVCodecContext *avctx, int x)
 {
     BRAWContext *s = avctx->priv_data;
@@ -533,10 +589,9 @@ static int decode_quants(AVCodecContext *avctx)
 static int decode_tiles(AVCodecContext *avctx, AVFrame *frame)
 {
     BRAWContext *s = avctx->priv_data;
-    GetBitContext *gbit = &s->gbit;
     GetByteContext *gb = &s->gb;
     uint32_t braw_size;
-    int version, ret, w, h;
+    int version, ret, w, h, nb_tiles;
 
     if (bytestream2_get_le32(gb) != MKTAG('b','r','a','w'))
         return AVERROR_INVALIDDATA;
@@ -609,10 +664,14 @@ static int decode_tiles(AVCodecContext *avctx, AVFrame *frame)
 
     bytestream2_seek(gb, 0x180, SEEK_SET);
 
-    for (int x = 0; x < s->nb_tiles_w; x++) {
-        s->blocks_w_in_tile = s->tile_size_w[x] / 16;
+    nb_tiles = s->nb_tiles_w * s->nb_tiles_h;
+    av_fast_mallocz(&s->tiles, &s->tiles_size, nb_tiles * sizeof(*s->tiles));
+    if (!s->tiles)
+        return AVERROR(ENOMEM);
 
+    for (int x = 0; x < s->nb_tiles_w; x++) {
         for (int y = 0; y < s->nb_tiles_h; y++) {
+            TileContext *tile = &s->tiles[x * s->nb_tiles_h + y];
             uint32_t tile_offset = bytestream2_get_be32(gb);
             int last_tile = (x == (s->nb_tiles_w - 1)) && (y == (s->nb_tiles_h - 1));
             int tile_size = last_tile ? bytestream2_size(gb) - tile_offset - s->header_size : bytestream2_peek_be32(gb) - tile_offset;
@@ -621,21 +680,27 @@ static int decode_tiles(AVCodecContext *avctx, AVFrame *frame)
                 return AVERROR_INVALIDDATA;
 
             av_log(avctx, AV_LOG_DEBUG, "%dx%d: tile_bitstream_size: 0x%X, tile_bitstream_offset: 0x%X\n", x, y, tile_size, tile_offset + s->header_size);
-            ret = init_get_bits8(gbit, gb->buffer_start + tile_offset + s->header_size, tile_size);
+            ret = init_get_bits8(&tile->gbit, gb->buffer_start + tile_offset + s->header_size, tile_size);
             if (ret < 0)
                 return ret;
 
+            tile->x = x;
+            tile->y = y;
+            tile->blocks_w = s->tile_size_w[x] / 16;
             if (y == s->nb_tiles_h - 1)
-                s->blocks_h_in_tile = (h - y * s->tile_size_h) / 8;
+                tile->blocks_h = (h - y * s->tile_size_h) / 8;
             else
-                s->blocks_h_in_tile = s->tile_size_h / 8;
-
-            ret = decode_tile(avctx, frame, x, y, s->blocks_w_in_tile, s->blocks_h_in_tile);
-            if (ret < 0)
-                return ret;
+                tile->blocks_h = s->tile_size_h / 8;
         }
     }
 
+    avctx->execute2(avctx, decode_tiles_thread, frame, s->tile_ret, nb_tiles);
+
+    for (int n = 0; n < nb_tiles; n++) {
+        if (s->tile_ret[n] < 0)
+            return s->tile_ret[n];
+    }
+
     return 0;
 }
 
@@ -687,6 +752,15 @@ static av_cold int braw_decode_init(AVCodecContext *avctx)
     return 0;
 }
 
+static av_cold int braw_decode_end(AVCodecContext *avctx)
+{
+    BRAWContext *s = avctx->priv_data;
+
+    av_freep(&s->tiles);
+
+    return 0;
+}
+
 static const AVOption options[] = {
     { NULL },
 };
@@ -705,9 +779,11 @@ const FFCodec ff_braw_decoder = {
     .p.id             = AV_CODEC_ID_BRAW,
     .priv_data_size   = sizeof(BRAWContext),
     .init             = braw_decode_init,
+    .close            = braw_decode_end,
     FF_CODEC_DECODE_CB(braw_decode_frame),
     .p.capabilities   = AV_CODEC_CAP_DR1 |
-                        AV_CODEC_CAP_FRAME_THREADS,
+                        AV_CODEC_CAP_FRAME_THREADS |
+                        AV_CODEC_CAP_SLICE_THREADS,
     .caps_internal    = FF_CODEC_CAP_INIT_CLEANUP,
     .p.priv_class     = &braw_decoder_class,
 };
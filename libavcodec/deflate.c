@@ -18,12 +18,44 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
+
+#include "libavutil/intmath.h"
 
 #define BITSTREAM_WRITER_LE
 #include "put_bits.h"
 
 #include "deflate.h"
 
+#define MIN_MATCH   3
+#define MAX_MATCH   258
+#define MAX_BLOCK   UINT16_MAX
+#define WINDOW_MASK (DEFLATE_WINDOW_SIZE - 1)
+/* matches of the minimum length further away than this are not worth it */
+#define TOO_FAR     4096
+
+typedef struct DeflateLevel {
+    uint16_t good_len;  ///< reduce the search when the previous match is this long
+    uint16_t max_lazy;  ///< do not look for a better match after one this long
+    uint16_t nice_len;  ///< stop searching at a match this long
+    uint16_t max_chain; ///< maximum number of hash chain entries to search
+    uint8_t  lazy;      ///< 0: take the first match, 1: evaluate the next one
+} DeflateLevel;
+
+/* Same trade-offs as the zlib levels */
+static const DeflateLevel levels[10] = {
+    {  0,   0,   0,    0, 0 },
+    {  4,   4,   8,    4, 0 },
+    {  4,   5,  16,    8, 0 },
+    {  4,   6,  32,   32, 0 },
+    {  4,   4,  16,   16, 1 },
+    {  8,  16,  32,   32, 1 },
+    {  8,  16, 128,  128, 1 },
+    {  8,  32, 128,  256, 1 },
+    { 32, 128, 258, 1024, 1 },
+    { 32, 258, 258, 4096, 1 },
+};
+
 static const uint16_t run_len[256] = {
      3,  4,  5,  6,  7,  8,  9, 10, 11, 11, 13, 13, 15, 15, 17, 17,
     19, 19, 19, 19, 23, 23, 23, 23, 27, 27, 27, 27, 31, 31, 31, 31,
@@ -88,7 +120,7 @@ static const uint8_t dst_extra[512] = {
 };
 
 static const uint8_t large_dst_sym[128] = {
-    18, 18, 19, 19, 20, 20, 21, 21, 22, 22, 22, 22, 23, 23, 23, 23, 24, 24, 24, 24, 24, 24, 24, 24, 25, 25, 25, 25, 25, 25, 25, 25,
+     0,  0, 18, 19, 20, 20, 21, 21, 22, 22, 22, 22, 23, 23, 23, 23, 24, 24, 24, 24, 24, 24, 24, 24, 25, 25, 25, 25, 25, 25, 25, 25,
     26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27,
     28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28,
     29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29, 29
@@ -111,8 +143,8 @@ static uint32_t get_adler32(uint32_t adler, const uint8_t *src,
 
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width;) {
-            size_t n = FFMIN(width, max_chunk_len & ~3);
-            const uint8_t *p = src + y * linesize;
+            size_t n = FFMIN(width - x, max_chunk_len & ~3);
+            const uint8_t *p = src + y * linesize + x;
 
             x += n;
             do {
@@ -158,36 +190,17 @@ static void aligned_copy_bits(PutBitContext *pb, const uint8_t *src, int length)
     skip_put_bytes(pb, length);
 }
 
-static void deflate_raw_block(DeflateContext *s, int len)
+static void deflate_raw_block(DeflateContext *s, const uint8_t *src, int len)
 {
-    const ptrdiff_t linesize = s->linesize;
     PutBitContext *pb = &s->pb;
-    const uint8_t *src = s->src;
-    const int width = s->width;
-    int y = s->y, x = s->x;
 
     put_bits(pb, 2, 0);
     align_put_bits(pb);
     put_bits(pb, 16, len);
     put_bits(pb, 16, ~len);
-    align_put_bits(pb);
     flush_put_bits(pb);
 
-    do {
-        const int ilen = FFMIN(len, width - x);
-
-        aligned_copy_bits(pb, src + y * linesize + x, ilen);
-
-        x += ilen;
-        len -= ilen;
-        if (x >= width) {
-            y++;
-            x = 0;
-        }
-    } while (len > 0);
-
-    s->y = y;
-    s->x = x;
+    aligned_copy_bits(pb, src, len);
 }
 
 typedef struct DeflateSymFreq {
@@ -416,7 +429,7 @@ static void deflate_block(PutBitContext *pb, int len,
             }
 
             d--;
-            if (d <= 512) {
+            if (d < 512) {
                 extra_distance_size = dst_extra[d];
             } else {
                 extra_distance_size = large_dst_extra[d>>8];
@@ -432,7 +445,30 @@ static void deflate_block(PutBitContext *pb, int len,
     put_bits(pb, code_sizes[256], codes[256]);
 }
 
-static void deflate_dynamic_block(DeflateContext *s, int len)
+/* Number of bits of the symbols of a block, using the given code sizes */
+static int64_t block_bits(const DeflateContext *s, const uint8_t *code_sizes,
+                          const uint8_t *dst_code_sizes)
+{
+    int64_t bits = 0;
+
+    for (int i = 0; i < 286; i++) {
+        const int extra = i >= 265 && i < 285 ? (i - 261) >> 2 : 0;
+        bits += s->lit_count[i] * (code_sizes[i] + extra);
+    }
+    for (int i = 0; i < 30; i++) {
+        const int extra = i >= 4 ? (i >> 1) - 1 : 0;
+        bits += s->dst_count[i] * (dst_code_sizes[i] + extra);
+    }
+
+    return bits;
+}
+
+/**
+ * Write a block with dynamic codes, unless it would take more than max_bits.
+ *
+ * @return the size of the block in bits, without the BFINAL bit
+ */
+static int64_t deflate_dynamic_block(DeflateContext *s, int len, int64_t max_bits)
 {
     PutBitContext *pb = &s->pb;
     static const uint8_t swizzle[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
@@ -449,6 +485,7 @@ static void deflate_dynamic_block(DeflateContext *s, int len)
     const uint8_t *run = s->run;
     int rle_repeat_count = 0;
     int rle_z_count = 0;
+    int64_t bits;
 
     optimize_huffman(s, s->lit_count, s->lit_code_sizes[1], s->lit_codes[1], 288, 15, 0);
     optimize_huffman(s, s->dst_count, s->dst_code_sizes[1], s->dst_codes[1], 32, 15, 0);
@@ -494,15 +531,30 @@ static void deflate_dynamic_block(DeflateContext *s, int len)
 
     optimize_huffman(s, s->huf_count, s->huf_code_sizes[1], s->huf_codes[1], 19, 7, 0);
 
+    for (num_bit_lengths = 18; num_bit_lengths >= 0; num_bit_lengths--)
+        if (s->huf_code_sizes[1][swizzle[num_bit_lengths]])
+            break;
+    num_bit_lengths = FFMAX(4, (num_bit_lengths + 1));
+
+    bits = 2 + 5 + 5 + 4 + 3 * num_bit_lengths;
+    for (packed_code_sizes_index = 0; packed_code_sizes_index < num_packed_code_sizes;) {
+        unsigned code = packed_code_sizes[packed_code_sizes_index++];
+
+        bits += s->huf_code_sizes[1][code];
+        if (code >= 16) {
+            bits += "\02\03\07"[code - 16];
+            packed_code_sizes_index++;
+        }
+    }
+    bits += block_bits(s, code_sizes, dst_code_sizes);
+    if (bits > max_bits)
+        return bits;
+
     put_bits(pb, 2, 2);
 
     put_bits(pb, 5, num_lit_codes - 257);
     put_bits(pb, 5, num_dist_codes - 1);
 
-    for (num_bit_lengths = 18; num_bit_lengths >= 0; num_bit_lengths--)
-        if (s->huf_code_sizes[1][swizzle[num_bit_lengths]])
-            break;
-    num_bit_lengths = FFMAX(4, (num_bit_lengths + 1));
     put_bits(pb, 4, num_bit_lengths - 4);
     for (int i = 0; i < num_bit_lengths; i++)
         put_bits(pb, 3, s->huf_code_sizes[1][swizzle[i]]);
@@ -517,20 +569,13 @@ static void deflate_dynamic_block(DeflateContext *s, int len)
     }
 
     deflate_block(pb, len, lit, dst, dsc, run, code_sizes, codes, dst_code_sizes, dst_codes);
+
+    return bits;
 }
 
-static void deflate_static_block(DeflateContext *s, int len)
+static void init_fixed_codes(DeflateContext *s)
 {
-    uint8_t *dst_code_sizes = s->dst_code_sizes[0];
-    uint8_t *code_sizes = s->lit_code_sizes[0];
-    uint16_t *dst_codes = s->dst_codes[0];
-    uint16_t *codes = s->lit_codes[0];
     uint8_t *p = s->lit_code_sizes[0];
-    const uint16_t *lit = s->lit;
-    const uint16_t *dst = s->dst;
-    const uint8_t *dsc = s->dsc;
-    const uint8_t *run = s->run;
-    PutBitContext *pb = &s->pb;
 
     if (!s->fixed_cb_initialized) {
         for (int i = 0; i < 144; i++)
@@ -548,6 +593,21 @@ static void deflate_static_block(DeflateContext *s, int len)
         optimize_huffman(s, s->dst_count, s->dst_code_sizes[0], s->dst_codes[0], 32, 15, 1);
         s->fixed_cb_initialized = 1;
     }
+}
+
+static void deflate_static_block(DeflateContext *s, int len)
+{
+    uint8_t *dst_code_sizes = s->dst_code_sizes[0];
+    uint8_t *code_sizes = s->lit_code_sizes[0];
+    uint16_t *dst_codes = s->dst_codes[0];
+    uint16_t *codes = s->lit_codes[0];
+    const uint16_t *lit = s->lit;
+    const uint16_t *dst = s->dst;
+    const uint8_t *dsc = s->dsc;
+    const uint8_t *run = s->run;
+    PutBitContext *pb = &s->pb;
+
+    init_fixed_codes(s);
 
     put_bits(pb, 2, 1);
 
@@ -558,32 +618,28 @@ static uint8_t get_distance_code(int dist)
 {
     dist--;
 
-    if (dist <= 512) {
+    if (dist < 512) {
         return dst_sym[dist];
     } else {
         return large_dst_sym[dist>>8];
     }
 }
 
-static int mmcmp(const uint8_t *a, const uint8_t *b, int len)
+/* Length of the common prefix of a and b, compared 8 bytes at a time */
+static av_always_inline int mmcmp(const uint8_t *a, const uint8_t *b, int len)
 {
     int pos = 0;
 
-    while (len >= 8) {
-        if (AV_RN64(a+pos) != AV_RN64(b+pos))
-            break;
+    while (pos + 8 <= len) {
+        const uint64_t diff = AV_RL64(a+pos) ^ AV_RL64(b+pos);
 
+        if (diff)
+            return pos + (ff_ctzll(diff) >> 3);
         pos += 8;
-        len -= 8;
     }
 
-    while (len > 0) {
-        if (a[pos] != b[pos])
-            break;
-
-        pos += 1;
-        len -= 1;
-    }
+    while (pos < len && a[pos] == b[pos])
+        pos++;
 
     return pos;
 }
@@ -641,13 +697,12 @@ static int get_runlen(const uint8_t *src, int len, int back, int *dist)
     return max_run;
 }
 
-static void deflate_import(DeflateContext *s, int len)
+static void deflate_import(DeflateContext *s, uint8_t *dst, int len)
 {
     const ptrdiff_t linesize = s->linesize;
     int y = s->y, x = s->x, j = 0;
     const uint8_t *src = s->src;
     const int width = s->width;
-    uint8_t *dst = s->val;
 
     do {
         const int ilen = FFMIN(len, width - x);
@@ -746,16 +801,223 @@ static void deflate_count(DeflateContext *s, int len)
     clit[256] = 1;
 }
 
-int ff_deflate(DeflateContext *s,
-               uint8_t *dst, int dst_len,
-               const uint8_t *src, int height,
-               int width, ptrdiff_t linesize)
+static av_always_inline unsigned hash3(const uint8_t *p)
+{
+    return (AV_RL24(p) * 0x9E3779B1U) >> (32 - DEFLATE_HASH_BITS);
+}
+
+static void window_reset(DeflateContext *s)
+{
+    s->win_len  = 0;
+    s->win_base = 0;
+    s->hashed   = 0;
+    memset(s->head, 0xFF, sizeof(s->head));
+}
+
+/* Append the next len bytes of input to the window, keeping the previous
+ * DEFLATE_WINDOW_SIZE bytes before them */
+static const uint8_t *window_import(DeflateContext *s, int len)
+{
+    if (s->win_len > DEFLATE_WINDOW_SIZE) {
+        const int shift = s->win_len - DEFLATE_WINDOW_SIZE;
+
+        memmove(s->win, s->win + shift, DEFLATE_WINDOW_SIZE);
+        s->win_base += shift;
+        s->win_len   = DEFLATE_WINDOW_SIZE;
+    }
+
+    deflate_import(s, s->win + s->win_len, len);
+    s->win_len += len;
+
+    return s->win + s->win_len - len;
+}
+
+/* Insert the strings at stream positions up to and including end */
+static av_always_inline void insert_strings(DeflateContext *s, int end)
+{
+    const int last = FFMIN(end, s->win_base + s->win_len - MIN_MATCH);
+
+    for (int pos = s->hashed; pos <= last; pos++) {
+        const unsigned h = hash3(s->win + pos - s->win_base);
+
+        s->prev[pos & WINDOW_MASK] = s->head[h];
+        s->head[h] = pos;
+    }
+    s->hashed = FFMAX(s->hashed, last + 1);
+}
+
+/**
+ * Find the longest match for the string at window index i, of at most
+ * max_len bytes. Only matches longer than best_len are returned.
+ */
+static int longest_match(DeflateContext *s, const DeflateLevel *lvl, int i,
+                         int max_len, int best_len, int *dist)
+{
+    const uint8_t *cur = s->win + i;
+    const int pos   = s->win_base + i;
+    const int limit = pos - DEFLATE_WINDOW_SIZE;
+    const int nice  = FFMIN(lvl->nice_len, max_len);
+    int chain = best_len >= lvl->good_len ? lvl->max_chain >> 2 : lvl->max_chain;
+    int cand;
+
+    insert_strings(s, pos - 1);
+    cand = s->head[hash3(cur)];
+    insert_strings(s, pos);
+
+    *dist = 0;
+    while (cand >= 0 && cand >= limit && chain--) {
+        const uint8_t *match = s->win + cand - s->win_base;
+        int next;
+
+        if (match[best_len] == cur[best_len] && AV_RN16(match) == AV_RN16(cur)) {
+            const int len = mmcmp(match, cur, max_len);
+
+            if (len > best_len) {
+                best_len = len;
+                *dist = pos - cand;
+                if (len >= nice)
+                    break;
+            }
+        }
+
+        next = s->prev[cand & WINDOW_MASK];
+        if (next >= cand)
+            break;
+        cand = next;
+    }
+
+    if (!*dist || (best_len == MIN_MATCH && *dist > TOO_FAR)) {
+        *dist = 0;
+        return 0;
+    }
+    return best_len;
+}
+
+static av_always_inline void put_literal(DeflateContext *s, int j, int c)
+{
+    s->lit[j] = c;
+    s->dst[j] = 0;
+    s->run[j] = 0;
+    s->dsc[j] = 0;
+}
+
+static av_always_inline void put_match(DeflateContext *s, int j, int len, int dist)
+{
+    s->run[j] = len - MIN_MATCH;
+    s->lit[j] = run_sym[len - MIN_MATCH];
+    s->dst[j] = dist;
+    s->dsc[j] = get_distance_code(dist);
+}
+
+/**
+ * Parse the block of len bytes at the end of the window into literals and
+ * matches, with lazy evaluation of the matches at the higher levels.
+ */
+static void deflate_lz77(DeflateContext *s, int len)
+{
+    const DeflateLevel *lvl = &levels[s->level];
+    const int end = s->win_len;
+    int i = end - len, j = 0;
+    int next_len = -1, next_dist = 0;
+
+    while (i < end) {
+        const int max_len = FFMIN(MAX_MATCH, end - i);
+        int mlen, dist;
+
+        if (max_len < MIN_MATCH) {
+            put_literal(s, j++, s->win[i++]);
+            continue;
+        }
+
+        if (next_len >= 0) {
+            mlen = next_len;
+            dist = next_dist;
+            next_len = -1;
+        } else {
+            mlen = longest_match(s, lvl, i, max_len, MIN_MATCH - 1, &dist);
+        }
+
+        if (lvl->lazy && mlen && mlen < lvl->max_lazy &&
+            FFMIN(MAX_MATCH, end - i - 1) > mlen) {
+            next_len = longest_match(s, lvl, i + 1, FFMIN(MAX_MATCH, end - i - 1),
+                                     mlen, &next_dist);
+            if (next_len) {
+                put_literal(s, j++, s->win[i++]);
+                continue;
+            }
+            next_len = -1;
+        }
+
+        if (mlen) {
+            put_match(s, j++, mlen, dist);
+            /* skip hashing inside long matches at the fast levels */
+            if (!lvl->lazy && mlen > lvl->max_lazy)
+                s->hashed = FFMAX(s->hashed, s->win_base + i + mlen);
+            i += mlen;
+        } else {
+            put_literal(s, j++, s->win[i++]);
+        }
+    }
+
+    s->nb_literals = j;
+}
+
+/* Compress the input set up by deflate_setup() into a sequence of blocks,
+ * the last of which is marked as final if last is set */
+static void deflate_blocks(DeflateContext *s, int last)
 {
     PutBitContext *pb = &s->pb;
-    unsigned level_hint;
-    uint16_t hdr;
-    int y, x;
+    const int level = s->level;
+    const int height = s->height;
+    const int width = s->width;
+    int y = s->y, x = s->x;
+
+    do {
+        const unsigned remain_len = (height - y) * width - x;
+        const int len = FFMIN(MAX_BLOCK, remain_len);
+        const int bfinal = last && len == remain_len;
+        const uint8_t *block;
+
+        if (level > 0) {
+            block = window_import(s, len);
+            deflate_lz77(s, len);
+        } else {
+            block = s->val;
+            deflate_import(s, s->val, len);
+            if (level < 0)
+                deflate_read(s, len);
+        }
+
+        put_bits(pb, 1, bfinal);
+        if (level) {
+            /* use the cheapest block type */
+            const int64_t stored_bits = 2 + (-(put_bits_count(pb) + 2) & 7) + 32 + 8LL * len;
+            int64_t static_bits = INT64_MAX;
+
+            deflate_count(s, s->nb_literals);
+            if (level > 0) {
+                init_fixed_codes(s);
+                static_bits = 2 + block_bits(s, s->lit_code_sizes[0], s->dst_code_sizes[0]);
+            }
 
+            if (deflate_dynamic_block(s, s->nb_literals,
+                                      FFMIN(stored_bits, static_bits) - 1) >= FFMIN(stored_bits, static_bits)) {
+                if (static_bits < stored_bits)
+                    deflate_static_block(s, s->nb_literals);
+                else
+                    deflate_raw_block(s, block, len);
+            }
+        } else {
+            deflate_raw_block(s, block, len);
+        }
+
+        y = s->y, x = s->x;
+    } while (y < height);
+}
+
+static void deflate_setup(DeflateContext *s, const uint8_t *src, int height,
+                          int width, ptrdiff_t linesize)
+{
     s->x = 0;
     s->y = 0;
     s->src = src;
@@ -763,48 +1025,71 @@ int ff_deflate(DeflateContext *s,
     s->height = height;
     s->nb_literals = 0;
     s->linesize = linesize;
+    if (s->level > 0)
+        window_reset(s);
+}
+
+int ff_deflate(DeflateContext *s,
+               uint8_t *dst, int dst_len,
+               const uint8_t *src, int height,
+               int width, ptrdiff_t linesize)
+{
+    PutBitContext *pb = &s->pb;
+    const int level = s->level;
+    unsigned level_hint;
+    uint16_t hdr;
+
+    if (level < DEFLATE_LEVEL_LINES || level > 9)
+        return AVERROR(EINVAL);
+
+    deflate_setup(s, src, height, width, linesize);
 
     init_put_bits(pb, dst, dst_len);
 
     hdr = (8 << 8) | (7 << 12);
-    level_hint = 3;
+    level_hint = level < 0 ? 3 : level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
     hdr |= level_hint << 6;
     hdr |= 31 - (hdr % 31);
 
     put_bits(pb, 16, av_bswap16(hdr));
 
-    y = s->y, x = s->x;
-    do {
-        const unsigned remain_len = (height - y) * width - x;
-        int len = FFMIN(UINT16_MAX, remain_len);
-        const int bfinal = len == remain_len;
-        int btype = 2;
+    deflate_blocks(s, 1);
+
+    align_put_bits(pb);
+    put_bits32(pb, av_bswap32(get_adler32(1, src, height, width, linesize)));
+    flush_put_bits(pb);
 
-        deflate_import(s, len);
-        deflate_read(s, len);
-        deflate_count(s, s->nb_literals);
+    return put_bytes_output(pb);
+}
 
-        put_bits(pb, 1, bfinal);
+int ff_deflate_raw(DeflateContext *s, uint8_t *dst, int dst_len,
+                   const uint8_t *dict, int dict_len,
+                   const uint8_t *src, int len, int last)
+{
+    PutBitContext *pb = &s->pb;
 
-        switch (btype) {
-        case 0:
-            deflate_raw_block(s, len);
-            break;
-        case 1:
-            deflate_static_block(s, s->nb_literals);
-            break;
-        case 2:
-            deflate_dynamic_block(s, s->nb_literals);
-            break;
-        default:
-            return AVERROR_BUG;
-        }
+    if (s->level < DEFLATE_LEVEL_LINES || s->level > 9)
+        return AVERROR(EINVAL);
 
-        y = s->y, x = s->x;
-    } while (y < height);
+    deflate_setup(s, src, 1, len, len);
+    /* matches may reference the dictionary, which is hashed on demand */
+    if (s->level > 0) {
+        const int n = FFMIN(dict_len, DEFLATE_WINDOW_SIZE);
 
-    align_put_bits(pb);
-    put_bits32(pb, av_bswap32(get_adler32(1, src, height, width, linesize)));
+        memcpy(s->win, dict + dict_len - n, n);
+        s->win_len = n;
+    }
+
+    init_put_bits(pb, dst, dst_len);
+
+    deflate_blocks(s, last);
+
+    if (!last) {
+        /* empty stored block */
+        put_bits(pb, 3, 0);
+        align_put_bits(pb);
+        put_bits32(pb, 0xFFFF0000);
+    }
     flush_put_bits(pb);
 
     return put_bytes_output(pb);
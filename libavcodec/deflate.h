@@ -24,9 +24,33 @@
 #define BITSTREAM_WRITER_LE
 #include "put_bits.h"
 
+#define DEFLATE_WINDOW_SIZE 32768
+#define DEFLATE_HASH_BITS   15
+
+/**
+ * Compression level for ff_deflate() which only searches runs of up to 8
+ * bytes and the previous line, as done originally.
+ */
+#define DEFLATE_LEVEL_LINES -1
+
+/**
+ * Deflate implementations, for the encoders which can use either the
+ * system zlib or ff_deflate().
+ */
+enum DeflateImpl {
+    DEFLATE_IMPL_ZLIB,
+    DEFLATE_IMPL_LAVC,
+};
+
 typedef struct DeflateContext {
     PutBitContext pb;
 
+    /**
+     * Compression level, from 0 (stored) to 9 (slowest), or
+     * DEFLATE_LEVEL_LINES. Must be set before calling ff_deflate().
+     */
+    int level;
+
     int x, y;
     int nb_literals;
     int height, width;
@@ -52,11 +76,42 @@ typedef struct DeflateContext {
 
     uint8_t  huf_code_sizes[2][19];
     uint16_t huf_codes[2][19];
+
+    /* LZ77 match finder: the last window of input, followed by the current
+     * block, and hash chains of the positions of 3-byte strings in it */
+    uint8_t  win[DEFLATE_WINDOW_SIZE + 65536];
+    int      win_len;
+    int      win_base;     ///< stream position of win[0]
+    int      hashed;       ///< stream position of the next string to hash
+    int32_t  head[1 << DEFLATE_HASH_BITS];
+    int32_t  prev[DEFLATE_WINDOW_SIZE];
 } DeflateContext;
 
+/**
+ * Compress an image into a zlib stream.
+ *
+ * @return number of bytes written to dst, which must be at least
+ *         ff_deflate_bound() bytes, or a negative error code
+ */
 int ff_deflate(DeflateContext *s, uint8_t *dst, int dst_len,
                const uint8_t *src, int height, int width, ptrdiff_t linesize);
 
+/**
+ * Compress len contiguous bytes into a raw deflate segment, without the
+ * zlib header and checksum. Segments can be concatenated into one stream.
+ *
+ * @param dict     data preceding src in the stream, which matches may
+ *                 reference; only its last DEFLATE_WINDOW_SIZE bytes are used,
+ *                 and it is ignored at levels 0 and DEFLATE_LEVEL_LINES
+ * @param last     if set, the segment ends the stream; otherwise it ends with
+ *                 an empty stored block, which aligns it to a byte boundary
+ * @return number of bytes written to dst, which must be at least
+ *         ff_deflate_bound() bytes, or a negative error code
+ */
+int ff_deflate_raw(DeflateContext *s, uint8_t *dst, int dst_len,
+                   const uint8_t *dict, int dict_len,
+                   const uint8_t *src, int len, int last);
+
 size_t ff_deflate_bound(const size_t in_size);
 
 #endif /* AVCODEC_DEFLATE_H */
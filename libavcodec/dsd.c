@@ -23,6 +23,7 @@
 
 #include <string.h>
 #include "libavutil/attributes.h"
+#include "libavutil/macros.h"
 #include "libavutil/reverse.h"
 #include "libavutil/thread.h"
 #include "dsd.h"
@@ -95,40 +96,54 @@ av_cold void ff_init_dsd_data(void)
     ff_thread_once(&init_static_once, dsd_ctables_tableinit);
 }
 
+#define HISTORY (CTABLES * 2 - 1) /** number of past bytes the filter reads */
+#define BLOCK   256
+
 void ff_dsd2pcm_translate(DSDContext* s, size_t samples, int lsbf,
                           const uint8_t *src, ptrdiff_t src_stride,
                           float *dst, ptrdiff_t dst_stride)
 {
-    uint8_t buf[FIFOSIZE];
-    unsigned pos, i;
-    uint8_t* p;
-    double sum;
-    const double (*const ctables)[256] = lsbf ? ctables_lsbf : ctables_msbf;
+    /* The input in bit order, with the filter history in front of it. */
+    uint8_t buf[HISTORY + BLOCK];
+    unsigned pos = s->pos;
+    /* The older half of the taps sees the bits in reverse order, which is
+     * the same as looking them up in the table of the other bit order. */
+    const double (*const ctables_a)[256] = lsbf ? ctables_lsbf : ctables_msbf;
+    const double (*const ctables_b)[256] = lsbf ? ctables_msbf : ctables_lsbf;
+
+    /* The FIFO keeps the bytes that are older than CTABLES reversed. */
+    for (int d = HISTORY; d > 0; d--) {
+        uint8_t v = s->buf[(pos - d) & FIFOMASK];
+        buf[HISTORY - d] = d > CTABLES ? ff_reverse[v] : v;
+    }
 
-    pos = s->pos;
+    while (samples > 0) {
+        const int len = FFMIN(samples, BLOCK);
 
-    memcpy(buf, s->buf, sizeof(buf));
+        for (int n = 0; n < len; n++) {
+            buf[HISTORY + n] = *src;
+            src += src_stride;
+        }
 
-    while (samples-- > 0) {
-        buf[pos] = *src;
-        src += src_stride;
+        for (int n = 0; n < len; n++) {
+            const uint8_t *p = buf + n;
+            double sum = 0.0;
 
-        p = buf + ((pos - CTABLES) & FIFOMASK);
-        *p = ff_reverse[*p];
+            for (int i = 0; i < CTABLES; i++)
+                sum += ctables_a[i][p[HISTORY - i]] + ctables_b[i][p[i]];
 
-        sum = 0.0;
-        for (i = 0; i < CTABLES; i++) {
-            uint8_t a = buf[(pos                   - i) & FIFOMASK];
-            uint8_t b = buf[(pos - (CTABLES*2 - 1) + i) & FIFOMASK];
-            sum += ctables[i][a] + ctables[i][b];
+            *dst = (float)sum;
+            dst += dst_stride;
         }
 
-        *dst = (float)sum;
-        dst += dst_stride;
-
-        pos = (pos + 1) & FIFOMASK;
+        memmove(buf, buf + len, HISTORY);
+        samples -= len;
+        pos = (pos + len) & FIFOMASK;
     }
 
+    for (int d = HISTORY; d > 0; d--) {
+        uint8_t v = buf[HISTORY - d];
+        s->buf[(pos - d) & FIFOMASK] = d > CTABLES ? ff_reverse[v] : v;
+    }
     s->pos = pos;
-    memcpy(s->buf, buf, sizeof(buf));
 }
@@ -27,12 +27,15 @@
 
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem_internal.h"
+#include "libavutil/refstruct.h"
 #include "libavutil/reverse.h"
+#include "libavutil/threadprogress.h"
 #include "codec_internal.h"
 #include "decode.h"
 #include "get_bits.h"
 #include "avcodec.h"
 #include "golomb.h"
+#include "thread.h"
 #include "dsd.h"
 
 #define DST_MAX_CHANNELS 6
@@ -73,9 +76,44 @@ typedef struct DSTContext {
     Table fsets, probs;
     DECLARE_ALIGNED(16, uint8_t, status)[DST_MAX_CHANNELS][16];
     DECLARE_ALIGNED(16, int16_t, filter)[DST_MAX_ELEMENTS][16][256];
-    DSDContext dsdctx[DST_MAX_CHANNELS];
+    DSDContext *dsdctx; ///< RefStruct reference
+    /* The DSD to PCM conversion continues from the previous frame, so with
+     * frame threading it waits for the previous frame to be converted. */
+    ThreadProgress *curr_progress, *prev_progress; ///< RefStruct references
+    AVRefStructPool *progress_pool; ///< RefStruct reference
 } DSTContext;
 
+#if HAVE_THREADS
+static int update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    DSTContext *fsrc = src->priv_data;
+    DSTContext *fdst = dst->priv_data;
+
+    av_refstruct_replace(&fdst->curr_progress, fsrc->curr_progress);
+    av_refstruct_replace(&fdst->dsdctx, fsrc->dsdctx);
+
+    return 0;
+}
+
+static av_cold int progress_pool_init_cb(AVRefStructOpaque opaque, void *obj)
+{
+    ThreadProgress *progress = obj;
+    return ff_thread_progress_init(progress, 1);
+}
+
+static void progress_pool_reset_cb(AVRefStructOpaque opaque, void *obj)
+{
+    ThreadProgress *progress = obj;
+    ff_thread_progress_reset(progress);
+}
+
+static av_cold void progress_pool_free_entry_cb(AVRefStructOpaque opaque, void *obj)
+{
+    ThreadProgress *progress = obj;
+    ff_thread_progress_destroy(progress);
+}
+#endif
+
 static av_cold int decode_init(AVCodecContext *avctx)
 {
     DSTContext *s = avctx->priv_data;
@@ -98,11 +136,39 @@ static av_cold int decode_init(AVCodecContext *avctx)
 
     avctx->sample_fmt = AV_SAMPLE_FMT_FLT;
 
+    s->dsdctx = av_refstruct_allocz(DST_MAX_CHANNELS * sizeof(*s->dsdctx));
+    if (!s->dsdctx)
+        return AVERROR(ENOMEM);
+
     for (i = 0; i < avctx->ch_layout.nb_channels; i++)
         memset(s->dsdctx[i].buf, 0x69, sizeof(s->dsdctx[i].buf));
 
     ff_init_dsd_data();
 
+#if HAVE_THREADS
+    if (ff_thread_sync_ref(avctx, offsetof(DSTContext, progress_pool)) == FF_THREAD_IS_FIRST_THREAD) {
+        s->progress_pool = av_refstruct_pool_alloc_ext(sizeof(*s->curr_progress),
+                                                       AV_REFSTRUCT_POOL_FLAG_FREE_ON_INIT_ERROR, NULL,
+                                                       progress_pool_init_cb,
+                                                       progress_pool_reset_cb,
+                                                       progress_pool_free_entry_cb, NULL);
+        if (!s->progress_pool)
+            return AVERROR(ENOMEM);
+    }
+#endif
+
+    return 0;
+}
+
+static av_cold int decode_close(AVCodecContext *avctx)
+{
+    DSTContext *s = avctx->priv_data;
+
+    av_refstruct_pool_uninit(&s->progress_pool);
+    av_refstruct_unref(&s->curr_progress);
+    av_refstruct_unref(&s->prev_progress);
+    av_refstruct_unref(&s->dsdctx);
+
     return 0;
 }
 
@@ -239,8 +305,7 @@ static int build_filter(int16_t table[DST_MAX_ELEMENTS][16][256], const Table *f
     return 0;
 }
 
-static int decode_frame(AVCodecContext *avctx, AVFrame *frame,
-                        int *got_frame_ptr, AVPacket *avpkt)
+static int decode_dst(AVCodecContext *avctx, AVFrame *frame, const AVPacket *avpkt)
 {
     unsigned samples_per_frame = DST_SAMPLES_PER_FRAME(avctx->sample_rate);
     unsigned map_ch_to_felem[DST_MAX_CHANNELS];
@@ -251,19 +316,9 @@ static int decode_frame(AVCodecContext *avctx, AVFrame *frame,
     DSTContext *s = avctx->priv_data;
     GetBitContext *gb = &s->gb;
     ArithCoder *ac = &s->ac;
-    uint8_t *dsd;
-    float *pcm;
+    uint8_t *dsd = frame->data[0];
     int ret;
 
-    if (avpkt->size <= 1)
-        return AVERROR_INVALIDDATA;
-
-    frame->nb_samples = samples_per_frame / 8;
-    if ((ret = ff_get_buffer(avctx, frame, 0)) < 0)
-        return ret;
-    dsd = frame->data[0];
-    pcm = (float *)frame->data[0];
-
     if ((ret = init_get_bits8(gb, avpkt->data, avpkt->size)) < 0)
         return ret;
 
@@ -271,8 +326,12 @@ static int decode_frame(AVCodecContext *avctx, AVFrame *frame,
         skip_bits1(gb);
         if (get_bits(gb, 6))
             return AVERROR_INVALIDDATA;
-        memcpy(frame->data[0], avpkt->data + 1, FFMIN(avpkt->size - 1, frame->nb_samples * channels));
-        goto dsd;
+        /* the DSD bytes go where the coded path puts them, in place of the
+         * floats that they are converted to */
+        memset(dsd, 0, frame->nb_samples * 4 * channels);
+        for (i = 0; i < FFMIN(avpkt->size - 1, frame->nb_samples * channels); i++)
+            dsd[i << 2] = avpkt->data[i + 1];
+        return 0;
     }
 
     /* Segmentation (10.4, 10.5, 10.6) */
@@ -371,13 +430,55 @@ static int decode_frame(AVCodecContext *avctx, AVFrame *frame,
         }
     }
 
-dsd:
-    for (i = 0; i < channels; i++) {
-        ff_dsd2pcm_translate(&s->dsdctx[i], frame->nb_samples, 0,
-                             frame->data[0] + i * 4,
-                             channels * 4, pcm + i, channels);
+    return 0;
+}
+
+static int dsd_channel(AVCodecContext *avctx, void *frmptr, int jobnr, int threadnr)
+{
+    const DSTContext *s = avctx->priv_data;
+    const int channels = avctx->ch_layout.nb_channels;
+    AVFrame *frame = frmptr;
+
+    ff_dsd2pcm_translate(&s->dsdctx[jobnr], frame->nb_samples, 0,
+                         frame->data[0] + jobnr * 4, channels * 4,
+                         (float *)frame->data[0] + jobnr, channels);
+
+    return 0;
+}
+
+static int decode_frame(AVCodecContext *avctx, AVFrame *frame,
+                        int *got_frame_ptr, AVPacket *avpkt)
+{
+    DSTContext *s = avctx->priv_data;
+    int ret;
+
+    if (avpkt->size <= 1)
+        return AVERROR_INVALIDDATA;
+
+    frame->nb_samples = DST_SAMPLES_PER_FRAME(avctx->sample_rate) / 8;
+    if ((ret = ff_thread_get_buffer(avctx, frame, 0)) < 0)
+        return ret;
+
+    if (s->progress_pool) {
+        av_refstruct_unref(&s->prev_progress);
+        s->prev_progress = av_refstruct_pool_get(s->progress_pool);
+        if (!s->prev_progress)
+            return AVERROR(ENOMEM);
+        FFSWAP(ThreadProgress*, s->prev_progress, s->curr_progress);
+        ff_thread_finish_setup(avctx);
     }
 
+    ret = decode_dst(avctx, frame, avpkt);
+
+    if (s->prev_progress)
+        ff_thread_progress_await(s->prev_progress, INT_MAX);
+    if (ret >= 0)
+        avctx->execute2(avctx, dsd_channel, frame, NULL, avctx->ch_layout.nb_channels);
+    if (s->curr_progress)
+        ff_thread_progress_report(s->curr_progress, INT_MAX);
+    if (ret < 0)
+        return ret;
+
     *got_frame_ptr = 1;
 
     return avpkt->size;
@@ -390,7 +491,11 @@ const FFCodec ff_dst_decoder = {
     .p.id           = AV_CODEC_ID_DST,
     .priv_data_size = sizeof(DSTContext),
     .init           = decode_init,
+    .close          = decode_close,
     FF_CODEC_DECODE_CB(decode_frame),
-    .p.capabilities = AV_CODEC_CAP_DR1,
+    UPDATE_THREAD_CONTEXT(update_thread_context),
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS,
+    .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP,
     CODEC_SAMPLEFMTS(AV_SAMPLE_FMT_FLT),
 };
@@ -31,8 +31,9 @@
  *  http://openexr.com/
  */
 
+#define CACHED_BITSTREAM_READER !ARCH_X86_32
+
 #include <float.h>
-#include <zlib.h>
 
 #include "libavutil/avassert.h"
 #include "libavutil/common.h"
@@ -55,6 +56,7 @@
 #include "decode.h"
 #include "exrdsp.h"
 #include "get_bits.h"
+#include "inflate.h"
 #include "mathops.h"
 #include "thread.h"
 
@@ -115,6 +117,8 @@ typedef struct EXRThreadData {
     uint8_t *uncompressed_data;
     int uncompressed_size;
 
+    InflateContext ic;
+
     uint8_t *tmp;
     int tmp_size;
 
@@ -197,14 +201,29 @@ typedef struct EXRContext {
     Float2HalfTables f2h_tables;
 } EXRContext;
 
+/* Decompress a zlib stream, which must fill dst exactly */
+static int exr_inflate(EXRThreadData *td, uint8_t *dst, int64_t dst_len,
+                       const uint8_t *src, int64_t src_len)
+{
+    int ret;
+
+    if (dst_len > INT_MAX || src_len > INT_MAX)
+        return AVERROR_INVALIDDATA;
+
+    ret = ff_inflate(&td->ic, src, src_len, dst, 1, dst_len, dst_len);
+    if (ret < 0)
+        return ret;
+
+    return td->ic.x == dst_len ? 0 : AVERROR_INVALIDDATA;
+}
+
 static int zip_uncompress(const EXRContext *s, const uint8_t *src, int compressed_size,
                           int uncompressed_size, EXRThreadData *td)
 {
-    unsigned long dest_len = uncompressed_size;
+    int ret = exr_inflate(td, td->tmp, uncompressed_size, src, compressed_size);
 
-    if (uncompress(td->tmp, &dest_len, src, compressed_size) != Z_OK ||
-        dest_len != uncompressed_size)
-        return AVERROR_INVALIDDATA;
+    if (ret < 0)
+        return ret;
 
     av_assert1(uncompressed_size % 2 == 0);
 
@@ -682,10 +701,10 @@ static int pxr24_uncompress(const EXRContext *s, const uint8_t *src,
                             int compressed_size, int uncompressed_size,
                             EXRThreadData *td)
 {
-    unsigned long dest_len, expected_len = 0;
+    unsigned long expected_len = 0;
     const uint8_t *in = td->tmp;
     uint8_t *out;
-    int c, i, j;
+    int c, i, j, ret;
 
     for (i = 0; i < s->nb_channels; i++) {
         if (s->channels[i].pixel_type == EXR_FLOAT) {
@@ -697,13 +716,9 @@ static int pxr24_uncompress(const EXRContext *s, const uint8_t *src,
         }
     }
 
-    dest_len = expected_len;
-
-    if (uncompress(td->tmp, &dest_len, src, compressed_size) != Z_OK) {
-        return AVERROR_INVALIDDATA;
-    } else if (dest_len != expected_len) {
-        return AVERROR_INVALIDDATA;
-    }
+    ret = exr_inflate(td, td->tmp, expected_len, src, compressed_size);
+    if (ret < 0)
+        return ret;
 
     out = td->uncompressed_data;
     for (i = 0; i < td->ysize; i++)
@@ -1050,9 +1065,9 @@ static int dwa_uncompress(const EXRContext *s, const uint8_t *src, int compresse
                 return ret;
             break;
         case 1:
-            if (uncompress(td->ac_data, &dest_len, agb.buffer, ac_size) != Z_OK ||
-                dest_len != ac_count * 2LL)
-                return AVERROR_INVALIDDATA;
+            ret = exr_inflate(td, td->ac_data, dest_len, agb.buffer, ac_size);
+            if (ret < 0)
+                return ret;
             break;
         default:
             return AVERROR_INVALIDDATA;
@@ -1076,9 +1091,10 @@ static int dwa_uncompress(const EXRContext *s, const uint8_t *src, int compresse
         if (!td->dc_data)
             return AVERROR(ENOMEM);
 
-        if (uncompress(td->dc_data + FFALIGN(dest_len, 64), &dest_len, agb.buffer, dc_size) != Z_OK ||
-            (dest_len != dc_count * 2LL))
-            return AVERROR_INVALIDDATA;
+        ret = exr_inflate(td, td->dc_data + FFALIGN(dest_len, 64), dest_len,
+                          agb.buffer, dc_size);
+        if (ret < 0)
+            return ret;
 
         s->dsp.predictor(td->dc_data + FFALIGN(dest_len, 64), dest_len);
         s->dsp.reorder_pixels(td->dc_data, td->dc_data + FFALIGN(dest_len, 64), dest_len);
@@ -1087,8 +1103,6 @@ static int dwa_uncompress(const EXRContext *s, const uint8_t *src, int compresse
     }
 
     if (rle_raw_size > 0 && rle_csize > 0 && rle_usize > 0) {
-        unsigned long dest_len = rle_usize;
-
         av_fast_padded_malloc(&td->rle_data, &td->rle_size, rle_usize);
         if (!td->rle_data)
             return AVERROR(ENOMEM);
@@ -1100,9 +1114,9 @@ static int dwa_uncompress(const EXRContext *s, const uint8_t *src, int compresse
         if (!td->rle_raw_data)
             return AVERROR(ENOMEM);
 
-        if (uncompress(td->rle_data, &dest_len, gb.buffer, rle_csize) != Z_OK ||
-            (dest_len != rle_usize))
-            return AVERROR_INVALIDDATA;
+        ret = exr_inflate(td, td->rle_data, rle_usize, gb.buffer, rle_csize);
+        if (ret < 0)
+            return ret;
 
         ret = rle(td->rle_raw_data, td->rle_data, rle_usize, rle_raw_size);
         if (ret < 0)
@@ -2337,6 +2351,7 @@ static av_cold int decode_end(AVCodecContext *avctx)
         av_freep(&td->rle_data);
         av_freep(&td->rle_raw_data);
         ff_vlc_free(&td->vlc);
+        ff_inflate(&td->ic, NULL, 0, NULL, 0, 0, 0);
     }
 
     av_freep(&s->thread_data);
@@ -24,7 +24,11 @@
  */
 
 #include <float.h>
+
+#include "config.h"
+#if CONFIG_ZLIB
 #include <zlib.h>
+#endif
 
 #include "libavutil/avassert.h"
 #include "libavutil/intfloat.h"
@@ -35,6 +39,7 @@
 #include "avcodec.h"
 #include "bytestream.h"
 #include "codec_internal.h"
+#include "deflate.h"
 #include "encode.h"
 
 enum ExrCompr {
@@ -81,6 +86,8 @@ typedef struct EXRContext {
     int nb_scanlines;
     int scanline_height;
     float gamma;
+    int deflate_impl;
+    DeflateContext *dc;
     const char *ch_names;
     const uint8_t *ch_order;
     PutByteContext pb;
@@ -135,6 +142,20 @@ static av_cold int encode_init(AVCodecContext *avctx)
     if (!s->scanline)
         return AVERROR(ENOMEM);
 
+    if (s->compression == EXR_ZIP1 || s->compression == EXR_ZIP16) {
+        if (!CONFIG_ZLIB && s->deflate_impl == DEFLATE_IMPL_ZLIB) {
+            av_log(avctx, AV_LOG_ERROR, "ZIP compression with zlib needs zlib compiled in\n");
+            return AVERROR(ENOSYS);
+        }
+        if (s->deflate_impl == DEFLATE_IMPL_LAVC) {
+            s->dc = av_mallocz(sizeof(*s->dc));
+            if (!s->dc)
+                return AVERROR(ENOMEM);
+            s->dc->level = avctx->compression_level == FF_COMPRESSION_DEFAULT ?
+                           6 : av_clip(avctx->compression_level, 0, 9);
+        }
+    }
+
     return 0;
 }
 
@@ -151,6 +172,7 @@ static av_cold int encode_close(AVCodecContext *avctx)
     }
 
     av_freep(&s->scanline);
+    av_freep(&s->dc);
 
     return 0;
 }
@@ -284,8 +306,8 @@ static int encode_scanline_zip(EXRContext *s, const AVFrame *frame)
         EXRScanlineData *scanline = &s->scanline[y];
         const int scanline_height = FFMIN(s->scanline_height, frame->height - y * s->scanline_height);
         int64_t tmp_size = element_size * s->planes * frame->width * scanline_height;
-        int64_t max_compressed_size = tmp_size * 3 / 2;
-        unsigned long actual_size, source_size;
+        int64_t max_compressed_size = FFMAX(tmp_size * 3 / 2, ff_deflate_bound(tmp_size));
+        int64_t actual_size, source_size;
 
         av_fast_padded_malloc(&scanline->uncompressed_data, &scanline->uncompressed_size, tmp_size);
         if (!scanline->uncompressed_data)
@@ -332,9 +354,20 @@ static int encode_scanline_zip(EXRContext *s, const AVFrame *frame)
         reorder_pixels(scanline->tmp, scanline->uncompressed_data, tmp_size);
         predictor(scanline->tmp, tmp_size);
         source_size = tmp_size;
-        actual_size = max_compressed_size;
-        compress(scanline->compressed_data, &actual_size,
-                 scanline->tmp, source_size);
+        if (s->deflate_impl == DEFLATE_IMPL_LAVC) {
+            actual_size = ff_deflate(s->dc, scanline->compressed_data, max_compressed_size,
+                                     scanline->tmp, 1, source_size, source_size);
+            if (actual_size < 0)
+                return actual_size;
+        } else {
+#if CONFIG_ZLIB
+            unsigned long zlen = max_compressed_size;
+
+            compress(scanline->compressed_data, &zlen,
+                     scanline->tmp, source_size);
+            actual_size = zlen;
+#endif
+        }
 
         scanline->actual_size = actual_size;
         if (scanline->actual_size >= tmp_size) {
@@ -441,7 +474,9 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         break;
     case EXR_ZIP16:
     case EXR_ZIP1:
-        encode_scanline_zip(s, frame);
+        ret = encode_scanline_zip(s, frame);
+        if (ret < 0)
+            return ret;
         break;
     default:
         av_assert0(0);
@@ -530,6 +565,9 @@ static const AVOption options[] = {
     { "half" ,       NULL,                   0,                   AV_OPT_TYPE_CONST, {.i64=EXR_HALF},  0, 0, VE, .unit = "pixel" },
     { "float",       NULL,                   0,                   AV_OPT_TYPE_CONST, {.i64=EXR_FLOAT}, 0, 0, VE, .unit = "pixel" },
     { "gamma", "set gamma", OFFSET(gamma), AV_OPT_TYPE_FLOAT, {.dbl=1.f}, 0.001, FLT_MAX, VE },
+    { "deflate_impl", "set the deflate implementation", OFFSET(deflate_impl), AV_OPT_TYPE_INT, {.i64=CONFIG_ZLIB ? DEFLATE_IMPL_ZLIB : DEFLATE_IMPL_LAVC}, DEFLATE_IMPL_ZLIB, DEFLATE_IMPL_LAVC, VE, .unit = "deflate_impl" },
+    { "zlib",        "system zlib",          0,                   AV_OPT_TYPE_CONST, {.i64=DEFLATE_IMPL_ZLIB}, 0, 0, VE, .unit = "deflate_impl" },
+    { "lavc",        "built-in encoder",     0,                   AV_OPT_TYPE_CONST, {.i64=DEFLATE_IMPL_LAVC}, 0, 0, VE, .unit = "deflate_impl" },
     { NULL},
 };
 
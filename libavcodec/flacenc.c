@@ -91,11 +91,22 @@ typedef struct FlacSubframe {
 
     int32_t samples[FLAC_MAX_BLOCKSIZE];
     int32_t residual[FLAC_MAX_BLOCKSIZE+11];
+
+    /* LPC prediction order search, see encode_residual_ch() */
+    int32_t lpc_coefs[MAX_LPC_ORDER][MAX_LPC_ORDER];
+    int lpc_shift[MAX_LPC_ORDER];
+    int opt_order;
+    int nb_orders;                      ///< candidate orders left to evaluate
+    int orders[MAX_LPC_ORDER];
+    uint64_t order_bits[MAX_LPC_ORDER];
+    int bits;                           ///< coded size, 0 while the search is pending
 } FlacSubframe;
 
 typedef struct FlacFrame {
     FlacSubframe subframes[FLAC_MAX_CHANNELS];
     int64_t samples_33bps[FLAC_MAX_BLOCKSIZE];
+    PutBitContext pb;
+    uint32_t number;
     int blocksize;
     int bs_code[2];
     uint8_t crc8;
@@ -103,9 +114,19 @@ typedef struct FlacFrame {
     int verbatim_only;
 } FlacFrame;
 
+/**
+ * A frame in flight. With frame threading, a batch of them is encoded in
+ * parallel, and the packets are returned in order.
+ */
+typedef struct FlacEncodeJob {
+    FlacFrame *frame;
+    AVFrame *in;
+    AVPacket *pkt;
+    int ret;
+} FlacEncodeJob;
+
 typedef struct FlacEncodeContext {
     AVClass *class;
-    PutBitContext pb;
     int channels;
     int samplerate;
     int sr_code[2];
@@ -117,16 +138,27 @@ typedef struct FlacEncodeContext {
     uint32_t frame_count;
     uint64_t sample_count;
     uint8_t md5sum[16];
-    FlacFrame frame;
     CompressionOptions options;
     AVCodecContext *avctx;
-    LPCContext lpc_ctx;
     struct AVMD5 *md5ctx;
     uint8_t *md5_buffer;
     unsigned int md5_buffer_size;
     BswapDSPContext bdsp;
     FLACEncDSPContext flac_dsp;
 
+    /* one per slice thread */
+    LPCContext *lpc_ctx;
+    FlacSubframe **tmp_subframes;   ///< for the intra-frame LPC order search
+    int nb_threads;
+
+    int frame_batch;                ///< encode a batch of frames in parallel
+    FlacEncodeJob *jobs;
+    int nb_jobs;
+    int first;                      ///< oldest frame in flight
+    int nb_queued;                  ///< number of frames in flight
+    int nb_encoded;                 ///< number of them already encoded
+    int eof;
+
     int flushed;
     int64_t next_pts;
 } FlacEncodeContext;
@@ -464,24 +496,60 @@ static av_cold int flac_encode_init(AVCodecContext *avctx)
         }
     }
 
-    ret = ff_lpc_init(&s->lpc_ctx, avctx->frame_size,
-                      s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+    /* By default the LPC order search of each frame is split across the
+     * threads, which adds no delay. On request, a batch of frames is encoded
+     * in parallel instead, which delays the output and keeps a copy of the
+     * input and of the frame state per thread. */
+    s->nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ? avctx->thread_count : 1;
+    s->nb_jobs    = 1;
+    if (s->nb_threads > 1 && s->frame_batch &&
+        !(avctx->flags & AV_CODEC_FLAG_LOW_DELAY))
+        s->nb_jobs = s->nb_threads;
+
+    s->lpc_ctx = av_calloc(s->nb_threads, sizeof(*s->lpc_ctx));
+    s->jobs    = av_calloc(s->nb_jobs,    sizeof(*s->jobs));
+    if (!s->lpc_ctx || !s->jobs)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < s->nb_threads; i++) {
+        ret = ff_lpc_init(&s->lpc_ctx[i], avctx->frame_size,
+                          s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (s->nb_threads > 1 && s->nb_jobs == 1) {
+        s->tmp_subframes = av_calloc(s->nb_threads, sizeof(*s->tmp_subframes));
+        if (!s->tmp_subframes)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < s->nb_threads; i++) {
+            s->tmp_subframes[i] = av_mallocz(sizeof(*s->tmp_subframes[i]));
+            if (!s->tmp_subframes[i])
+                return AVERROR(ENOMEM);
+        }
+    }
+
+    for (i = 0; i < s->nb_jobs; i++) {
+        FlacEncodeJob *job = &s->jobs[i];
+        job->frame = av_mallocz(sizeof(*job->frame));
+        job->in    = av_frame_alloc();
+        job->pkt   = av_packet_alloc();
+        if (!job->frame || !job->in || !job->pkt)
+            return AVERROR(ENOMEM);
+    }
 
     ff_bswapdsp_init(&s->bdsp);
     ff_flacencdsp_init(&s->flac_dsp);
 
     dprint_compression_options(s);
 
-    return ret;
+    return 0;
 }
 
 
-static void init_frame(FlacEncodeContext *s, int nb_samples)
+static void init_frame(FlacEncodeContext *s, FlacFrame *frame, int nb_samples)
 {
     int i, ch;
-    FlacFrame *frame;
-
-    frame = &s->frame;
 
     for (i = 0; i < 16; i++) {
         if (nb_samples == ff_flac_blocksize_table[i]) {
@@ -521,15 +589,13 @@ static void init_frame(FlacEncodeContext *s, int nb_samples)
 /**
  * Copy channel-interleaved input samples into separate subframes.
  */
-static void copy_samples(FlacEncodeContext *s, const void *samples)
+static void copy_samples(FlacEncodeContext *s, FlacFrame *frame, const void *samples)
 {
     int i, j, ch;
-    FlacFrame *frame;
 
 #define COPY_SAMPLES(bits, shift0) do {                             \
     const int ## bits ## _t *samples0 = samples;                    \
     const int shift = shift0;                                       \
-    frame = &s->frame;                                              \
     for (i = 0, j = 0; i < frame->blocksize; i++)                   \
         for (ch = 0; ch < s->channels; ch++, j++)                   \
             frame->subframes[ch].samples[i] = samples0[j] >> shift; \
@@ -555,8 +621,8 @@ static uint64_t rice_count_exact(const int32_t *res, int n, int k)
 }
 
 
-static uint64_t subframe_count_exact(FlacEncodeContext *s, FlacSubframe *sub,
-                                     int pred_order)
+static uint64_t subframe_count_exact(FlacEncodeContext *s, FlacFrame *frame,
+                                     FlacSubframe *sub, int pred_order)
 {
     int p, porder, psize;
     int i, part_end;
@@ -572,7 +638,7 @@ static uint64_t subframe_count_exact(FlacEncodeContext *s, FlacSubframe *sub,
     if (sub->type == FLAC_SUBFRAME_CONSTANT) {
         count += sub->obits;
     } else if (sub->type == FLAC_SUBFRAME_VERBATIM) {
-        count += s->frame.blocksize * sub->obits;
+        count += frame->blocksize * sub->obits;
     } else {
         /* warm-up samples */
         count += pred_order * sub->obits;
@@ -586,7 +652,7 @@ static uint64_t subframe_count_exact(FlacEncodeContext *s, FlacSubframe *sub,
 
         /* partition order */
         porder = sub->rc.porder;
-        psize  = s->frame.blocksize >> porder;
+        psize  = frame->blocksize >> porder;
         count += 4;
 
         /* residual */
@@ -597,7 +663,7 @@ static uint64_t subframe_count_exact(FlacEncodeContext *s, FlacSubframe *sub,
             count += sub->rc.coding_mode;
             count += rice_count_exact(&sub->residual[i], part_end - i, k);
             i = part_end;
-            part_end = FFMIN(s->frame.blocksize, part_end + psize);
+            part_end = FFMIN(frame->blocksize, part_end + psize);
         }
     }
 
@@ -758,19 +824,19 @@ static int get_max_p_order(int max_porder, int n, int order)
 }
 
 
-static uint64_t find_subframe_rice_params(FlacEncodeContext *s,
+static uint64_t find_subframe_rice_params(FlacEncodeContext *s, FlacFrame *frame,
                                           FlacSubframe *sub, int pred_order)
 {
     int pmin = get_max_p_order(s->options.min_partition_order,
-                               s->frame.blocksize, pred_order);
+                               frame->blocksize, pred_order);
     int pmax = get_max_p_order(s->options.max_partition_order,
-                               s->frame.blocksize, pred_order);
+                               frame->blocksize, pred_order);
 
     uint64_t bits = 8 + pred_order * sub->obits + 2 + sub->rc.coding_mode;
     if (sub->type == FLAC_SUBFRAME_LPC)
         bits += 4 + 5 + pred_order * s->options.lpc_coeff_precision;
     bits += calc_rice_params(&sub->rc, sub->rc_udata, sub->rc_sums, pmin, pmax, sub->residual,
-                             s->frame.blocksize, pred_order, s->options.exact_rice_parameters);
+                             frame->blocksize, pred_order, s->options.exact_rice_parameters);
     return bits;
 }
 
@@ -947,27 +1013,32 @@ static int lpc_encode_choose_datapath(FlacEncodeContext *s, int32_t bps,
     sub->type = sub->type_code = FLAC_SUBFRAME_VERBATIM;    \
     if (sub->obits <= 32)                                   \
         memcpy(res, smp, n * sizeof(int32_t));              \
-    return subframe_count_exact(s, sub, 0);                 \
+    return subframe_count_exact(s, frame, sub, 0);          \
 }
 
-static int encode_residual_ch(FlacEncodeContext *s, int ch)
+/**
+ * First stage of encode_residual_ch(). Encode the subframe, unless it uses
+ * LPC and its prediction order search compares independent candidates:
+ * these are then listed in sub->orders, for encode_residual_lpc_order().
+ * @return subframe size in bits, or 0 if the order search is pending
+ */
+static int encode_residual_ch_init(FlacEncodeContext *s, FlacFrame *frame,
+                                   LPCContext *lpc, int ch)
 {
     int i, n;
     int min_order, max_order, opt_order, omethod;
-    FlacFrame *frame;
     FlacSubframe *sub;
-    int32_t coefs[MAX_LPC_ORDER][MAX_LPC_ORDER];
-    int shift[MAX_LPC_ORDER];
     int32_t *res, *smp;
     int64_t *smp_33bps;
 
-    frame     = &s->frame;
     sub       = &frame->subframes[ch];
     res       = sub->residual;
     smp       = sub->samples;
     smp_33bps = frame->samples_33bps;
     n         = frame->blocksize;
 
+    sub->nb_orders = 0;
+
     /* CONSTANT */
     if (sub->obits > 32) {
         for (i = 1; i < n; i++)
@@ -975,7 +1046,7 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
                 break;
         if (i == n) {
             sub->type = sub->type_code = FLAC_SUBFRAME_CONSTANT;
-            return subframe_count_exact(s, sub, 0);
+            return subframe_count_exact(s, frame, sub, 0);
         }
     } else {
         for (i = 1; i < n; i++)
@@ -984,7 +1055,7 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
         if (i == n) {
             sub->type = sub->type_code = FLAC_SUBFRAME_CONSTANT;
             res[0] = smp[0];
-            return subframe_count_exact(s, sub, 0);
+            return subframe_count_exact(s, frame, sub, 0);
         }
     }
 
@@ -1015,7 +1086,7 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
                     continue;
             } else
                 encode_residual_fixed(res, smp, n, i);
-            bits[i] = find_subframe_rice_params(s, sub, i);
+            bits[i] = find_subframe_rice_params(s, frame, sub, i);
             if (bits[i] < bits[opt_order])
                 opt_order = i;
         }
@@ -1033,9 +1104,9 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
                 encode_residual_fixed_with_residual_limit(res, smp, n, sub->order);
             else
                 encode_residual_fixed(res, smp, n, sub->order);
-            find_subframe_rice_params(s, sub, sub->order);
+            find_subframe_rice_params(s, frame, sub, sub->order);
         }
-        return subframe_count_exact(s, sub, sub->order);
+        return subframe_count_exact(s, frame, sub, sub->order);
     }
 
     /* LPC */
@@ -1048,48 +1119,28 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
         for (i = 0; i < n; i++)
             smp[i] = smp_33bps[i] >> 1;
 
-    opt_order = ff_lpc_calc_coefs(&s->lpc_ctx, smp, n, min_order, max_order,
-                                  s->options.lpc_coeff_precision, coefs, shift, s->options.lpc_type,
-                                  s->options.lpc_passes, omethod,
-                                  MIN_LPC_SHIFT, MAX_LPC_SHIFT, 0);
+    sub->opt_order = ff_lpc_calc_coefs(lpc, smp, n, min_order, max_order,
+                                       s->options.lpc_coeff_precision, sub->lpc_coefs,
+                                       sub->lpc_shift, s->options.lpc_type,
+                                       s->options.lpc_passes, omethod,
+                                       MIN_LPC_SHIFT, MAX_LPC_SHIFT, 0);
 
     if (omethod == ORDER_METHOD_2LEVEL ||
         omethod == ORDER_METHOD_4LEVEL ||
         omethod == ORDER_METHOD_8LEVEL) {
         int levels = 1 << omethod;
-        uint64_t bits[1 << ORDER_METHOD_8LEVEL];
-        int order       = -1;
-        int opt_index   = levels-1;
-        opt_order       = max_order-1;
-        bits[opt_index] = UINT32_MAX;
+        int order  = -1;
         for (i = levels-1; i >= 0; i--) {
             int last_order = order;
             order = min_order + (((max_order-min_order+1) * (i+1)) / levels)-1;
             order = av_clip(order, min_order - 1, max_order - 1);
-            if (order == last_order)
-                continue;
-            if(lpc_encode_choose_datapath(s, sub->obits, res, smp, smp_33bps, n, order+1, coefs[order], shift[order]))
-                continue;
-            bits[i] = find_subframe_rice_params(s, sub, order+1);
-            if (bits[i] < bits[opt_index]) {
-                opt_index = i;
-                opt_order = order;
-            }
+            if (order != last_order)
+                sub->orders[sub->nb_orders++] = order;
         }
-        opt_order++;
     } else if (omethod == ORDER_METHOD_SEARCH) {
         // brute-force optimal order search
-        uint64_t bits[MAX_LPC_ORDER];
-        opt_order = 0;
-        bits[0]   = UINT32_MAX;
-        for (i = min_order-1; i < max_order; i++) {
-            if(lpc_encode_choose_datapath(s, sub->obits, res, smp, smp_33bps, n, i+1, coefs[i], shift[i]))
-                continue;
-            bits[i] = find_subframe_rice_params(s, sub, i+1);
-            if (bits[i] < bits[opt_order])
-                opt_order = i;
-        }
-        opt_order++;
+        for (i = min_order-1; i < max_order; i++)
+            sub->orders[sub->nb_orders++] = i;
     } else if (omethod == ORDER_METHOD_LOG) {
         uint64_t bits[MAX_LPC_ORDER];
         int step;
@@ -1102,13 +1153,67 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
             for (i = last-step; i <= last+step; i += step) {
                 if (i < min_order-1 || i >= max_order || bits[i] < UINT32_MAX)
                     continue;
-                if(lpc_encode_choose_datapath(s, sub->obits, res, smp, smp_33bps, n, i+1, coefs[i], shift[i]))
+                if(lpc_encode_choose_datapath(s, sub->obits, res, smp, smp_33bps, n, i+1, sub->lpc_coefs[i], sub->lpc_shift[i]))
                     continue;
-                bits[i] = find_subframe_rice_params(s, sub, i+1);
+                bits[i] = find_subframe_rice_params(s, frame, sub, i+1);
                 if (bits[i] < bits[opt_order])
                     opt_order = i;
             }
         }
+        sub->opt_order = opt_order + 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Evaluate candidate k of the LPC order search of sub, using the residual
+ * and rice parameter buffers of tmp, which may be sub itself.
+ */
+static void encode_residual_lpc_order(FlacEncodeContext *s, FlacFrame *frame,
+                                      FlacSubframe *sub, FlacSubframe *tmp, int k)
+{
+    int order = sub->orders[k];
+
+    if (lpc_encode_choose_datapath(s, sub->obits, tmp->residual, sub->samples,
+                                   frame->samples_33bps, frame->blocksize, order+1,
+                                   sub->lpc_coefs[order], sub->lpc_shift[order]))
+        sub->order_bits[k] = UINT64_MAX;
+    else
+        sub->order_bits[k] = find_subframe_rice_params(s, frame, tmp, order+1);
+}
+
+/**
+ * Last stage of encode_residual_ch(): pick the best evaluated order, refine
+ * its coefficients and encode the LPC subframe.
+ */
+static int encode_residual_ch_finish(FlacEncodeContext *s, FlacFrame *frame, int ch)
+{
+    int i, n;
+    int opt_order;
+    FlacSubframe *sub;
+    int32_t *res, *smp;
+    int64_t *smp_33bps;
+
+    sub       = &frame->subframes[ch];
+    res       = sub->residual;
+    smp       = sub->samples;
+    smp_33bps = frame->samples_33bps;
+    n         = frame->blocksize;
+
+    opt_order = sub->opt_order;
+    if (sub->nb_orders) {
+        /* candidates are compared in search order, so that the first of
+         * equally good ones wins */
+        uint64_t best = UINT32_MAX;
+        opt_order = s->options.prediction_order_method == ORDER_METHOD_SEARCH ?
+                    0 : s->options.max_prediction_order - 1;
+        for (i = 0; i < sub->nb_orders; i++) {
+            if (sub->order_bits[i] < best) {
+                best      = sub->order_bits[i];
+                opt_order = sub->orders[i];
+            }
+        }
         opt_order++;
     }
 
@@ -1133,19 +1238,19 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
 
                 for (i=0; i<opt_order; i++) {
                     int diff = ((tmp + 1) % 3) - 1;
-                    lpc_try[i] = av_clip(coefs[opt_order - 1][i] + diff, -qmax, qmax);
+                    lpc_try[i] = av_clip(sub->lpc_coefs[opt_order - 1][i] + diff, -qmax, qmax);
                     tmp /= 3;
                     diffsum += !!diff;
                 }
                 if (diffsum >8)
                     continue;
 
-                if(lpc_encode_choose_datapath(s, sub->obits, res, smp, smp_33bps, n, opt_order, lpc_try, shift[opt_order-1]))
+                if(lpc_encode_choose_datapath(s, sub->obits, res, smp, smp_33bps, n, opt_order, lpc_try, sub->lpc_shift[opt_order-1]))
                     continue;
-                score = find_subframe_rice_params(s, sub, opt_order);
+                score = find_subframe_rice_params(s, frame, sub, opt_order);
                 if (score < best_score) {
                     best_score = score;
-                    memcpy(coefs[opt_order-1], lpc_try, sizeof(*coefs));
+                    memcpy(sub->lpc_coefs[opt_order-1], lpc_try, sizeof(*sub->lpc_coefs));
                     improved=1;
                 }
             }
@@ -1154,9 +1259,9 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
 
     sub->order     = opt_order;
     sub->type_code = sub->type | (sub->order-1);
-    sub->shift     = shift[sub->order-1];
+    sub->shift     = sub->lpc_shift[sub->order-1];
     for (i = 0; i < sub->order; i++)
-        sub->coefs[i] = coefs[sub->order-1][i];
+        sub->coefs[i] = sub->lpc_coefs[sub->order-1][i];
 
     if(lpc_encode_choose_datapath(s, sub->obits, res, smp, smp_33bps, n, sub->order, sub->coefs, sub->shift)) {
         /* No predictor found with residuals within <INT32_MIN,INT32_MAX],
@@ -1164,13 +1269,26 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
         DEFAULT_TO_VERBATIM();
     }
 
-    find_subframe_rice_params(s, sub, sub->order);
+    find_subframe_rice_params(s, frame, sub, sub->order);
+
+    return subframe_count_exact(s, frame, sub, sub->order);
+}
 
-    return subframe_count_exact(s, sub, sub->order);
+static int encode_residual_ch(FlacEncodeContext *s, FlacFrame *frame,
+                              LPCContext *lpc, int ch)
+{
+    FlacSubframe *sub = &frame->subframes[ch];
+    int bits = encode_residual_ch_init(s, frame, lpc, ch);
+
+    if (bits)
+        return bits;
+    for (int k = 0; k < sub->nb_orders; k++)
+        encode_residual_lpc_order(s, frame, sub, sub, k);
+    return encode_residual_ch_finish(s, frame, ch);
 }
 
 
-static int count_frame_header(FlacEncodeContext *s)
+static int count_frame_header(FlacEncodeContext *s, FlacFrame *frame)
 {
     uint8_t av_unused tmp;
     int count;
@@ -1188,12 +1306,12 @@ static int count_frame_header(FlacEncodeContext *s)
     count = 32;
 
     /* coded frame number */
-    PUT_UTF8(s->frame_count, tmp, count += 8;)
+    PUT_UTF8(frame->number, tmp, count += 8;)
 
     /* explicit block size */
-    if (s->frame.bs_code[0] == 6)
+    if (frame->bs_code[0] == 6)
         count += 8;
-    else if (s->frame.bs_code[0] == 7)
+    else if (frame->bs_code[0] == 7)
         count += 16;
 
     /* explicit sample rate */
@@ -1206,15 +1324,72 @@ static int count_frame_header(FlacEncodeContext *s)
 }
 
 
-static int encode_frame(FlacEncodeContext *s)
+static int encode_channel_init_thread(AVCodecContext *avctx, void *arg,
+                                      int ch, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacFrame *frame = arg;
+
+    frame->subframes[ch].bits = encode_residual_ch_init(s, frame, &s->lpc_ctx[threadnr], ch);
+    return 0;
+}
+
+static int encode_lpc_order_thread(AVCodecContext *avctx, void *arg,
+                                   int jobnr, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacFrame *frame = arg;
+    FlacSubframe *sub = frame->subframes;
+    FlacSubframe *tmp = s->tmp_subframes[threadnr];
+
+    /* the candidates of all channels, one after the other */
+    while (jobnr >= sub->nb_orders)
+        jobnr -= sub++->nb_orders;
+
+    tmp->type           = sub->type;
+    tmp->obits          = sub->obits;
+    tmp->rc.coding_mode = sub->rc.coding_mode;
+    encode_residual_lpc_order(s, frame, sub, tmp, jobnr);
+    return 0;
+}
+
+static int encode_channel_finish_thread(AVCodecContext *avctx, void *arg,
+                                        int ch, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacFrame *frame = arg;
+    FlacSubframe *sub = &frame->subframes[ch];
+
+    if (!sub->bits)
+        sub->bits = encode_residual_ch_finish(s, frame, ch);
+    return 0;
+}
+
+static int encode_frame(FlacEncodeContext *s, FlacFrame *frame, int threadnr)
 {
     int ch;
     uint64_t count;
 
-    count = count_frame_header(s);
+    count = count_frame_header(s, frame);
 
-    for (ch = 0; ch < s->channels; ch++)
-        count += encode_residual_ch(s, ch);
+    if (s->tmp_subframes) {
+        /* intra-frame threading: analyse the channels, then evaluate the
+         * candidate LPC orders of all of them, then finish the subframes */
+        AVCodecContext *avctx = s->avctx;
+        int nb_orders = 0;
+
+        avctx->execute2(avctx, encode_channel_init_thread, frame, NULL, s->channels);
+        for (ch = 0; ch < s->channels; ch++)
+            nb_orders += frame->subframes[ch].nb_orders;
+        avctx->execute2(avctx, encode_lpc_order_thread, frame, NULL, nb_orders);
+        avctx->execute2(avctx, encode_channel_finish_thread, frame, NULL, s->channels);
+
+        for (ch = 0; ch < s->channels; ch++)
+            count += frame->subframes[ch].bits;
+    } else {
+        for (ch = 0; ch < s->channels; ch++)
+            count += encode_residual_ch(s, frame, &s->lpc_ctx[threadnr], ch);
+    }
 
     count += (8 - (count & 7)) & 7; // byte alignment
     count += 16;                    // CRC-16
@@ -1226,17 +1401,17 @@ static int encode_frame(FlacEncodeContext *s)
 }
 
 
-static void remove_wasted_bits(FlacEncodeContext *s)
+static void remove_wasted_bits(FlacEncodeContext *s, FlacFrame *frame)
 {
     int ch, i, wasted_bits;
 
     for (ch = 0; ch < s->channels; ch++) {
-        FlacSubframe *sub = &s->frame.subframes[ch];
+        FlacSubframe *sub = &frame->subframes[ch];
 
         if (sub->obits > 32) {
             int64_t v = 0;
-            for (i = 0; i < s->frame.blocksize; i++) {
-                v |= s->frame.samples_33bps[i];
+            for (i = 0; i < frame->blocksize; i++) {
+                v |= frame->samples_33bps[i];
                 if (v & 1)
                     break;
             }
@@ -1248,12 +1423,12 @@ static void remove_wasted_bits(FlacEncodeContext *s)
 
             /* If any wasted bits are found, samples are moved
              * from frame.samples_33bps to frame.subframes[ch] */
-            for (i = 0; i < s->frame.blocksize; i++)
-                sub->samples[i] = s->frame.samples_33bps[i] >> v;
+            for (i = 0; i < frame->blocksize; i++)
+                sub->samples[i] = frame->samples_33bps[i] >> v;
             wasted_bits = v;
         } else {
             int32_t v = 0;
-            for (i = 0; i < s->frame.blocksize; i++) {
+            for (i = 0; i < frame->blocksize; i++) {
                 v |= sub->samples[i];
                 if (v & 1)
                     break;
@@ -1264,7 +1439,7 @@ static void remove_wasted_bits(FlacEncodeContext *s)
 
             v = ff_ctz(v);
 
-            for (i = 0; i < s->frame.blocksize; i++)
+            for (i = 0; i < frame->blocksize; i++)
                 sub->samples[i] >>= v;
             wasted_bits = v;
         }
@@ -1336,14 +1511,12 @@ static int estimate_stereo_mode(const int32_t *left_ch, const int32_t *right_ch,
 /**
  * Perform stereo channel decorrelation.
  */
-static void channel_decorrelation(FlacEncodeContext *s)
+static void channel_decorrelation(FlacEncodeContext *s, FlacFrame *frame)
 {
-    FlacFrame *frame;
     int32_t *left, *right;
     int64_t *side_33bps;
     int n;
 
-    frame      = &s->frame;
     n          = frame->blocksize;
     left       = frame->subframes[0].samples;
     right      = frame->subframes[1].samples;
@@ -1410,40 +1583,37 @@ static void write_utf8(PutBitContext *pb, uint32_t val)
 }
 
 
-static void write_frame_header(FlacEncodeContext *s)
+static void write_frame_header(FlacEncodeContext *s, FlacFrame *frame)
 {
-    FlacFrame *frame;
     int crc;
 
-    frame = &s->frame;
-
-    put_bits(&s->pb, 16, 0xFFF8);
-    put_bits(&s->pb, 4, frame->bs_code[0]);
-    put_bits(&s->pb, 4, s->sr_code[0]);
+    put_bits(&frame->pb, 16, 0xFFF8);
+    put_bits(&frame->pb, 4, frame->bs_code[0]);
+    put_bits(&frame->pb, 4, s->sr_code[0]);
 
     if (frame->ch_mode == FLAC_CHMODE_INDEPENDENT)
-        put_bits(&s->pb, 4, s->channels-1);
+        put_bits(&frame->pb, 4, s->channels-1);
     else
-        put_bits(&s->pb, 4, frame->ch_mode + FLAC_MAX_CHANNELS - 1);
+        put_bits(&frame->pb, 4, frame->ch_mode + FLAC_MAX_CHANNELS - 1);
 
-    put_bits(&s->pb, 3, s->bps_code);
-    put_bits(&s->pb, 1, 0);
-    write_utf8(&s->pb, s->frame_count);
+    put_bits(&frame->pb, 3, s->bps_code);
+    put_bits(&frame->pb, 1, 0);
+    write_utf8(&frame->pb, frame->number);
 
     if (frame->bs_code[0] == 6)
-        put_bits(&s->pb, 8, frame->bs_code[1]);
+        put_bits(&frame->pb, 8, frame->bs_code[1]);
     else if (frame->bs_code[0] == 7)
-        put_bits(&s->pb, 16, frame->bs_code[1]);
+        put_bits(&frame->pb, 16, frame->bs_code[1]);
 
     if (s->sr_code[0] == 12)
-        put_bits(&s->pb, 8, s->sr_code[1]);
+        put_bits(&frame->pb, 8, s->sr_code[1]);
     else if (s->sr_code[0] > 12)
-        put_bits(&s->pb, 16, s->sr_code[1]);
+        put_bits(&frame->pb, 16, s->sr_code[1]);
 
-    flush_put_bits(&s->pb);
-    crc = av_crc(av_crc_get_table(AV_CRC_8_ATM), 0, s->pb.buf,
-                 put_bytes_output(&s->pb));
-    put_bits(&s->pb, 8, crc);
+    flush_put_bits(&frame->pb);
+    crc = av_crc(av_crc_get_table(AV_CRC_8_ATM), 0, frame->pb.buf,
+                 put_bytes_output(&frame->pb));
+    put_bits(&frame->pb, 8, crc);
 }
 
 
@@ -1466,83 +1636,83 @@ static inline void set_sr_golomb_flac(PutBitContext *pb, int i, int k)
 }
 
 
-static void write_subframes(FlacEncodeContext *s)
+static void write_subframes(FlacEncodeContext *s, FlacFrame *frame)
 {
     int ch;
 
     for (ch = 0; ch < s->channels; ch++) {
-        FlacSubframe *sub = &s->frame.subframes[ch];
+        FlacSubframe *sub = &frame->subframes[ch];
         int p, porder, psize;
         int32_t *part_end;
         int32_t *res       =  sub->residual;
-        int32_t *frame_end = &sub->residual[s->frame.blocksize];
+        int32_t *frame_end = &sub->residual[frame->blocksize];
 
         /* subframe header */
-        put_bits(&s->pb, 1, 0);
-        put_bits(&s->pb, 6, sub->type_code);
-        put_bits(&s->pb, 1, !!sub->wasted);
+        put_bits(&frame->pb, 1, 0);
+        put_bits(&frame->pb, 6, sub->type_code);
+        put_bits(&frame->pb, 1, !!sub->wasted);
         if (sub->wasted)
-            put_bits(&s->pb, sub->wasted, 1);
+            put_bits(&frame->pb, sub->wasted, 1);
 
         /* subframe */
         if (sub->type == FLAC_SUBFRAME_CONSTANT) {
             if(sub->obits == 33)
-                put_sbits63(&s->pb, 33, s->frame.samples_33bps[0]);
+                put_sbits63(&frame->pb, 33, frame->samples_33bps[0]);
             else if(sub->obits == 32)
-                put_bits32(&s->pb, res[0]);
+                put_bits32(&frame->pb, res[0]);
             else
-                put_sbits(&s->pb, sub->obits, res[0]);
+                put_sbits(&frame->pb, sub->obits, res[0]);
         } else if (sub->type == FLAC_SUBFRAME_VERBATIM) {
             if (sub->obits == 33) {
-                int64_t *res64 = s->frame.samples_33bps;
-                int64_t *frame_end64 = &s->frame.samples_33bps[s->frame.blocksize];
+                int64_t *res64 = frame->samples_33bps;
+                int64_t *frame_end64 = &frame->samples_33bps[frame->blocksize];
                 while (res64 < frame_end64)
-                    put_sbits63(&s->pb, 33, (*res64++));
+                    put_sbits63(&frame->pb, 33, (*res64++));
             } else if (sub->obits == 32) {
                 while (res < frame_end)
-                    put_bits32(&s->pb, *res++);
+                    put_bits32(&frame->pb, *res++);
             } else {
                 while (res < frame_end)
-                    put_sbits(&s->pb, sub->obits, *res++);
+                    put_sbits(&frame->pb, sub->obits, *res++);
             }
         } else {
             /* warm-up samples */
             if (sub->obits == 33) {
                 for (int i = 0; i < sub->order; i++)
-                    put_sbits63(&s->pb, 33, s->frame.samples_33bps[i]);
+                    put_sbits63(&frame->pb, 33, frame->samples_33bps[i]);
                 res += sub->order;
             } else if (sub->obits == 32) {
                 for (int i = 0; i < sub->order; i++)
-                    put_bits32(&s->pb, *res++);
+                    put_bits32(&frame->pb, *res++);
             } else {
                 for (int i = 0; i < sub->order; i++)
-                    put_sbits(&s->pb, sub->obits, *res++);
+                    put_sbits(&frame->pb, sub->obits, *res++);
             }
 
             /* LPC coefficients */
             if (sub->type == FLAC_SUBFRAME_LPC) {
                 int cbits = s->options.lpc_coeff_precision;
-                put_bits( &s->pb, 4, cbits-1);
-                put_sbits(&s->pb, 5, sub->shift);
+                put_bits( &frame->pb, 4, cbits-1);
+                put_sbits(&frame->pb, 5, sub->shift);
                 for (int i = 0; i < sub->order; i++)
-                    put_sbits(&s->pb, cbits, sub->coefs[i]);
+                    put_sbits(&frame->pb, cbits, sub->coefs[i]);
             }
 
             /* rice-encoded block */
-            put_bits(&s->pb, 2, sub->rc.coding_mode - 4);
+            put_bits(&frame->pb, 2, sub->rc.coding_mode - 4);
 
             /* partition order */
             porder  = sub->rc.porder;
-            psize   = s->frame.blocksize >> porder;
-            put_bits(&s->pb, 4, porder);
+            psize   = frame->blocksize >> porder;
+            put_bits(&frame->pb, 4, porder);
 
             /* residual */
             part_end  = &sub->residual[psize];
             for (p = 0; p < 1 << porder; p++) {
                 int k = sub->rc.params[p];
-                put_bits(&s->pb, sub->rc.coding_mode, k);
+                put_bits(&frame->pb, sub->rc.coding_mode, k);
                 while (res < part_end)
-                    set_sr_golomb_flac(&s->pb, *res++, k);
+                    set_sr_golomb_flac(&frame->pb, *res++, k);
                 part_end = FFMIN(frame_end, part_end + psize);
             }
         }
@@ -1550,31 +1720,31 @@ static void write_subframes(FlacEncodeContext *s)
 }
 
 
-static void write_frame_footer(FlacEncodeContext *s)
+static void write_frame_footer(FlacEncodeContext *s, FlacFrame *frame)
 {
     int crc;
-    flush_put_bits(&s->pb);
-    crc = av_bswap16(av_crc(av_crc_get_table(AV_CRC_16_ANSI), 0, s->pb.buf,
-                            put_bytes_output(&s->pb)));
-    put_bits(&s->pb, 16, crc);
-    flush_put_bits(&s->pb);
+    flush_put_bits(&frame->pb);
+    crc = av_bswap16(av_crc(av_crc_get_table(AV_CRC_16_ANSI), 0, frame->pb.buf,
+                            put_bytes_output(&frame->pb)));
+    put_bits(&frame->pb, 16, crc);
+    flush_put_bits(&frame->pb);
 }
 
 
-static int write_frame(FlacEncodeContext *s, AVPacket *avpkt)
+static int write_frame(FlacEncodeContext *s, FlacFrame *frame, AVPacket *avpkt)
 {
-    init_put_bits(&s->pb, avpkt->data, avpkt->size);
-    write_frame_header(s);
-    write_subframes(s);
-    write_frame_footer(s);
-    return put_bytes_output(&s->pb);
+    init_put_bits(&frame->pb, avpkt->data, avpkt->size);
+    write_frame_header(s, frame);
+    write_subframes(s, frame);
+    write_frame_footer(s, frame);
+    return put_bytes_output(&frame->pb);
 }
 
 
-static int update_md5_sum(FlacEncodeContext *s, const void *samples)
+static int update_md5_sum(FlacEncodeContext *s, const void *samples, int nb_samples)
 {
     const uint8_t *buf;
-    int buf_size = s->frame.blocksize * s->channels *
+    int buf_size = nb_samples * s->channels *
                    ((s->avctx->bits_per_raw_sample + 7) / 8);
 
     if (s->avctx->bits_per_raw_sample > 16 || HAVE_BIGENDIAN) {
@@ -1595,7 +1765,7 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
         const int32_t *samples0 = samples;
         uint8_t *tmp            = s->md5_buffer;
 
-        for (i = 0; i < s->frame.blocksize * s->channels; i++) {
+        for (i = 0; i < nb_samples * s->channels; i++) {
             int32_t v = samples0[i] >> 8;
             AV_WL24(tmp + 3*i, v);
         }
@@ -1606,7 +1776,7 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
         const int32_t *samples0 = samples;
         uint8_t *tmp            = s->md5_buffer;
 
-        for (i = 0; i < s->frame.blocksize * s->channels; i++)
+        for (i = 0; i < nb_samples * s->channels; i++)
             AV_WL32(tmp + 4*i, samples0[i]);
         buf = s->md5_buffer;
     }
@@ -1616,86 +1786,167 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
 }
 
 
-static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
-                             const AVFrame *frame, int *got_packet_ptr)
+/**
+ * Encode the frame of a job into its packet. With frame threading, this runs
+ * on the slice threads, for a batch of jobs at once.
+ */
+static int encode_job(AVCodecContext *avctx, FlacEncodeJob *job, int threadnr)
 {
-    FlacEncodeContext *s;
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacFrame *frame = job->frame;
+    const AVFrame *in = job->in;
+    int max_framesize = s->max_framesize;
     int frame_bytes, out_bytes, ret;
 
-    s = avctx->priv_data;
-
-    /* when the last block is reached, update the header in extradata */
-    if (!frame) {
-        s->max_framesize = s->max_encoded_framesize;
-        av_md5_final(s->md5ctx, s->md5sum);
-        write_streaminfo(s, avctx->extradata);
-
-        if (!s->flushed) {
-            uint8_t *side_data = av_packet_new_side_data(avpkt, AV_PKT_DATA_NEW_EXTRADATA,
-                                                         avctx->extradata_size);
-            if (!side_data)
-                return AVERROR(ENOMEM);
-            memcpy(side_data, avctx->extradata, avctx->extradata_size);
-
-            avpkt->pts = s->next_pts;
-
-            *got_packet_ptr = 1;
-            s->flushed = 1;
-        }
-
-        return 0;
-    }
-
     /* change max_framesize for small final frame */
-    if (frame->nb_samples < s->frame.blocksize) {
-        s->max_framesize = flac_get_max_frame_size(frame->nb_samples,
-                                                   s->channels,
-                                                   avctx->bits_per_raw_sample);
+    if (in->nb_samples < avctx->frame_size) {
+        max_framesize = flac_get_max_frame_size(in->nb_samples,
+                                                s->channels,
+                                                avctx->bits_per_raw_sample);
     }
 
-    init_frame(s, frame->nb_samples);
+    init_frame(s, frame, in->nb_samples);
 
-    copy_samples(s, frame->data[0]);
+    copy_samples(s, frame, in->data[0]);
 
-    channel_decorrelation(s);
+    channel_decorrelation(s, frame);
 
-    remove_wasted_bits(s);
+    remove_wasted_bits(s, frame);
 
-    frame_bytes = encode_frame(s);
+    frame_bytes = encode_frame(s, frame, threadnr);
 
     /* Fall back on verbatim mode if the compressed frame is larger than it
        would be if encoded uncompressed. */
-    if (frame_bytes < 0 || frame_bytes > s->max_framesize) {
-        s->frame.verbatim_only = 1;
-        frame_bytes = encode_frame(s);
+    if (frame_bytes < 0 || frame_bytes > max_framesize) {
+        frame->verbatim_only = 1;
+        frame_bytes = encode_frame(s, frame, threadnr);
         if (frame_bytes < 0) {
             av_log(avctx, AV_LOG_ERROR, "Bad frame count\n");
             return frame_bytes;
         }
     }
 
-    if ((ret = ff_get_encode_buffer(avctx, avpkt, frame_bytes, 0)) < 0)
+    if ((ret = ff_get_encode_buffer(avctx, job->pkt, frame_bytes, 0)) < 0)
         return ret;
 
-    out_bytes = write_frame(s, avpkt);
+    out_bytes = write_frame(s, frame, job->pkt);
+
+    av_shrink_packet(job->pkt, out_bytes);
+
+    return 0;
+}
+
+static int encode_job_thread(AVCodecContext *avctx, void *arg,
+                             int jobnr, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacEncodeJob *job = &s->jobs[(s->first + jobnr) % s->nb_jobs];
 
-    s->frame_count++;
-    s->sample_count += frame->nb_samples;
-    if ((ret = update_md5_sum(s, frame->data[0])) < 0) {
+    job->ret = encode_job(avctx, job, threadnr);
+    return 0;
+}
+
+/**
+ * Return the packet of an encoded job. The stream statistics and the MD5
+ * checksum are updated here, in frame order.
+ */
+static int output_job(AVCodecContext *avctx, FlacEncodeJob *job, AVPacket *avpkt)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    AVFrame *in = job->in;
+    int out_bytes = job->pkt->size;
+    int ret = job->ret;
+
+    if (ret < 0)
+        goto end;
+
+    s->sample_count += in->nb_samples;
+    if ((ret = update_md5_sum(s, in->data[0], in->nb_samples)) < 0) {
         av_log(avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
-        return ret;
+        goto end;
     }
     if (out_bytes > s->max_encoded_framesize)
         s->max_encoded_framesize = out_bytes;
     if (out_bytes < s->min_framesize)
         s->min_framesize = out_bytes;
 
-    s->next_pts = frame->pts + ff_samples_to_time_base(avctx, frame->nb_samples);
+    ret = ff_encode_reordered_opaque(avctx, job->pkt, in);
+    if (ret < 0)
+        goto end;
 
-    av_shrink_packet(avpkt, out_bytes);
+    job->pkt->pts      = in->pts;
+    job->pkt->dts      = in->pts;
+    job->pkt->duration = in->duration ? in->duration :
+                         ff_samples_to_time_base(avctx, in->nb_samples);
 
-    *got_packet_ptr = 1;
-    return 0;
+    s->next_pts = in->pts + ff_samples_to_time_base(avctx, in->nb_samples);
+
+    av_packet_move_ref(avpkt, job->pkt);
+
+end:
+    av_frame_unref(in);
+    av_packet_unref(job->pkt);
+    return ret;
+}
+
+static int flac_receive_packet(AVCodecContext *avctx, AVPacket *avpkt)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacEncodeJob *job;
+    int ret;
+
+    if (!s->nb_encoded) {
+        /* gather a batch of frames, and encode them */
+        while (!s->eof && s->nb_queued < s->nb_jobs) {
+            job = &s->jobs[(s->first + s->nb_queued) % s->nb_jobs];
+            ret = ff_encode_get_frame(avctx, job->in);
+            if (ret == AVERROR_EOF) {
+                s->eof = 1;
+            } else if (ret < 0) {
+                return ret;
+            } else {
+                job->frame->number = s->frame_count++;
+                s->nb_queued++;
+            }
+        }
+
+        if (!s->nb_queued) {
+            uint8_t *side_data;
+
+            if (s->flushed)
+                return AVERROR_EOF;
+
+            /* when the last block is reached, update the header in extradata */
+            s->max_framesize = s->max_encoded_framesize;
+            av_md5_final(s->md5ctx, s->md5sum);
+            write_streaminfo(s, avctx->extradata);
+
+            side_data = av_packet_new_side_data(avpkt, AV_PKT_DATA_NEW_EXTRADATA,
+                                                avctx->extradata_size);
+            if (!side_data)
+                return AVERROR(ENOMEM);
+            memcpy(side_data, avctx->extradata, avctx->extradata_size);
+
+            avpkt->pts = s->next_pts;
+            avpkt->dts = s->next_pts;
+
+            s->flushed = 1;
+            return 0;
+        }
+
+        if (s->nb_jobs > 1)
+            avctx->execute2(avctx, encode_job_thread, NULL, NULL, s->nb_queued);
+        else
+            s->jobs[0].ret = encode_job(avctx, &s->jobs[0], 0);
+        s->nb_encoded = s->nb_queued;
+    }
+
+    job = &s->jobs[s->first];
+    s->first = (s->first + 1) % s->nb_jobs;
+    s->nb_queued--;
+    s->nb_encoded--;
+
+    return output_job(avctx, job, avpkt);
 }
 
 
@@ -1705,7 +1956,24 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
 
     av_freep(&s->md5ctx);
     av_freep(&s->md5_buffer);
-    ff_lpc_end(&s->lpc_ctx);
+    if (s->lpc_ctx) {
+        for (int i = 0; i < s->nb_threads; i++)
+            ff_lpc_end(&s->lpc_ctx[i]);
+    }
+    av_freep(&s->lpc_ctx);
+    if (s->tmp_subframes) {
+        for (int i = 0; i < s->nb_threads; i++)
+            av_freep(&s->tmp_subframes[i]);
+    }
+    av_freep(&s->tmp_subframes);
+    if (s->jobs) {
+        for (int i = 0; i < s->nb_jobs; i++) {
+            av_freep(&s->jobs[i].frame);
+            av_frame_free(&s->jobs[i].in);
+            av_packet_free(&s->jobs[i].pkt);
+        }
+    }
+    av_freep(&s->jobs);
     return 0;
 }
 
@@ -1737,6 +2005,7 @@ static const AVOption options[] = {
 { "multi_dim_quant",       "Multi-dimensional quantization",    offsetof(FlacEncodeContext, options.multi_dim_quant),       AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
 { "min_prediction_order", NULL, offsetof(FlacEncodeContext, options.min_prediction_order), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, MAX_LPC_ORDER, FLAGS },
 { "max_prediction_order", NULL, offsetof(FlacEncodeContext, options.max_prediction_order), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, MAX_LPC_ORDER, FLAGS },
+{ "frame_batch", "Encode a batch of frames in parallel when threaded", offsetof(FlacEncodeContext, frame_batch), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
 
 { NULL },
 };
@@ -1753,13 +2022,13 @@ const FFCodec ff_flac_encoder = {
     .p.type         = AVMEDIA_TYPE_AUDIO,
     .p.id           = AV_CODEC_ID_FLAC,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
-                      AV_CODEC_CAP_SMALL_LAST_FRAME |
+                      AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_SLICE_THREADS |
                       AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE,
     .priv_data_size = sizeof(FlacEncodeContext),
     .init           = flac_encode_init,
-    FF_CODEC_ENCODE_CB(flac_encode_frame),
+    FF_CODEC_RECEIVE_PACKET_CB(flac_receive_packet),
     .close          = flac_encode_close,
     CODEC_SAMPLEFMTS(AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S32),
     .p.priv_class   = &flac_encoder_class,
-    .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP | FF_CODEC_CAP_EOF_FLUSH,
+    .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP,
 };
@@ -2745,7 +2745,14 @@ static void hls_decode_neighbour(HEVCLocalContext *lc,
     lc->ctb_up_left_flag = ((x_ctb > 0) && (y_ctb > 0)  && (ctb_addr_in_slice-1 >= sps->ctb_width) && (pps->tile_id[ctb_addr_ts] == pps->tile_id[pps->ctb_addr_rs_to_ts[ctb_addr_rs-1 - sps->ctb_width]]));
 }
 
-static int hls_decode_entry(HEVCContext *s, GetBitContext *gb)
+/**
+ * Decode the CTBs of a slice segment in tile scan order.
+ *
+ * @param filter_jobs if set, the in-loop filters are left to the row jobs of
+ *                    hls_slice_data_filter_rows() and only the parsing
+ *                    progress is reported
+ */
+static int hls_decode_entry(HEVCContext *s, GetBitContext *gb, int filter_jobs)
 {
     HEVCLocalContext *const lc = &s->local_ctx[0];
     const HEVCLayerContext *const l = &s->layers[s->cur_layer];
@@ -2789,10 +2796,17 @@ static int hls_decode_entry(HEVCContext *s, GetBitContext *gb)
 
         ctb_addr_ts++;
         ff_hevc_save_states(lc, pps, ctb_addr_ts);
+        if (filter_jobs) {
+            atomic_store_explicit(&s->filter_ctb_end, ctb_addr_rs + 1,
+                                  memory_order_relaxed);
+            ff_thread_progress_report(&s->wpp_progress[0], ctb_addr_rs + 1);
+            continue;
+        }
         ff_hevc_hls_filters(lc, l, pps, x_ctb, y_ctb, ctb_size);
     }
 
-    if (x_ctb + ctb_size >= sps->width &&
+    if (!filter_jobs &&
+        x_ctb + ctb_size >= sps->width &&
         y_ctb + ctb_size >= sps->height)
         ff_hevc_hls_filter(lc, l, pps, x_ctb, y_ctb, ctb_size);
 
@@ -2920,27 +2934,10 @@ static int wpp_progress_init(HEVCContext *s, unsigned count)
     return 0;
 }
 
-static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
+static int local_ctx_alloc(HEVCContext *s, unsigned count)
 {
-    const HEVCPPS *const pps = s->pps;
-    const HEVCSPS *const sps = pps->sps;
-    const uint8_t *data = nal->data;
-    int length          = nal->size;
-    int *ret;
-    int64_t offset;
-    int64_t startheader, cmpt = 0;
-    int i, j, res = 0;
-
-    if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * sps->ctb_width >= sps->ctb_width * sps->ctb_height) {
-        av_log(s->avctx, AV_LOG_ERROR, "WPP ctb addresses are wrong (%d %d %d %d)\n",
-            s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets,
-            sps->ctb_width, sps->ctb_height
-        );
-        return AVERROR_INVALIDDATA;
-    }
-
-    if (s->avctx->thread_count > s->nb_local_ctx) {
-        HEVCLocalContext *tmp = av_malloc_array(s->avctx->thread_count, sizeof(*s->local_ctx));
+    if (count > s->nb_local_ctx) {
+        HEVCLocalContext *tmp = av_malloc_array(count, sizeof(*s->local_ctx));
 
         if (!tmp)
             return AVERROR(ENOMEM);
@@ -2949,7 +2946,7 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
         av_free(s->local_ctx);
         s->local_ctx = tmp;
 
-        for (unsigned i = s->nb_local_ctx; i < s->avctx->thread_count; i++) {
+        for (unsigned i = s->nb_local_ctx; i < count; i++) {
             tmp = &s->local_ctx[i];
 
             memset(tmp, 0, sizeof(*tmp));
@@ -2959,9 +2956,35 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
             tmp->common_cabac_state = &s->cabac;
         }
 
-        s->nb_local_ctx = s->avctx->thread_count;
+        s->nb_local_ctx = count;
     }
 
+    return 0;
+}
+
+static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
+{
+    const HEVCPPS *const pps = s->pps;
+    const HEVCSPS *const sps = pps->sps;
+    const uint8_t *data = nal->data;
+    int length          = nal->size;
+    int *ret;
+    int64_t offset;
+    int64_t startheader, cmpt = 0;
+    int i, j, res = 0;
+
+    if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * sps->ctb_width >= sps->ctb_width * sps->ctb_height) {
+        av_log(s->avctx, AV_LOG_ERROR, "WPP ctb addresses are wrong (%d %d %d %d)\n",
+            s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets,
+            sps->ctb_width, sps->ctb_height
+        );
+        return AVERROR_INVALIDDATA;
+    }
+
+    res = local_ctx_alloc(s, s->avctx->thread_count);
+    if (res < 0)
+        return res;
+
     offset = s->sh.data_offset;
 
     for (j = 0, cmpt = 0, startheader = offset + s->sh.entry_point_offset[0]; j < nal->skipped_bytes; j++) {
@@ -3022,6 +3045,119 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
     return res;
 }
 
+/**
+ * Return the raster scan address of the CTB after whose decoding the serial
+ * path runs ff_hevc_hls_filter() on the CTB at (x_ctb, y_ctb), see
+ * ff_hevc_hls_filters().
+ */
+static int filter_ctb_trigger(const HEVCSPS *sps, int x_ctb, int y_ctb)
+{
+    int x_end = x_ctb == sps->ctb_width  - 1;
+    int y_end = y_ctb == sps->ctb_height - 1;
+
+    return (y_ctb + !y_end) * sps->ctb_width + x_ctb + !x_end;
+}
+
+/**
+ * In-loop filter job for one CTB row. Each CTB is filtered as soon as the
+ * serial path would have filtered it and once the CTB up-right of it has been
+ * filtered by the job of the row above, so that deblocking and SAO run in
+ * exactly the same order relative to each other as in the serial path.
+ */
+static int hls_filter_ctb_row(AVCodecContext *avctx, void *arg, int job, int thread)
+{
+    const HEVCContext *const s = avctx->priv_data;
+    HEVCLocalContext *lc = &((HEVCLocalContext*)arg)[thread + 1];
+    const HEVCLayerContext *const l = &s->layers[s->cur_layer];
+    const HEVCPPS   *const pps = s->pps;
+    const HEVCSPS   *const sps = pps->sps;
+    const int ctb_size  = 1 << sps->log2_ctb_size;
+    const int slice_row = s->sh.slice_ctb_addr_rs / sps->ctb_width;
+    const int y_ctb     = FFMAX(slice_row - 1, 0) + job - 1;
+    /* Casting const away here is safe, because these are only touched
+     * through thread-safe operations. */
+    ThreadProgress *progress = (ThreadProgress*)&s->wpp_progress[job];
+
+    for (int x_ctb = 0; x_ctb < sps->ctb_width; x_ctb++) {
+        int trigger = filter_ctb_trigger(sps, x_ctb, y_ctb);
+
+        if (trigger >= s->sh.slice_ctb_addr_rs) {
+            ff_thread_progress_await(&s->wpp_progress[0], trigger + 1);
+            if (trigger >= atomic_load_explicit((atomic_int*)&s->filter_ctb_end,
+                                                memory_order_relaxed))
+                break;
+
+            if (job > 1)
+                ff_thread_progress_await(&s->wpp_progress[job - 1],
+                                         FFMIN(x_ctb + 2, sps->ctb_width));
+
+            ff_hevc_hls_filter(lc, l, pps, x_ctb << sps->log2_ctb_size,
+                               y_ctb << sps->log2_ctb_size, ctb_size);
+        }
+
+        ff_thread_progress_report(progress, x_ctb + 1);
+    }
+
+    ff_thread_progress_report(progress, INT_MAX);
+
+    return 0;
+}
+
+static int hls_decode_entry_filter_rows(AVCodecContext *avctx, void *arg,
+                                        int job, int thread)
+{
+    HEVCContext *s = avctx->priv_data;
+    int ret;
+
+    if (job)
+        return hls_filter_ctb_row(avctx, s->local_ctx, job, thread);
+
+    ret = hls_decode_entry(s, arg, 1);
+    ff_thread_progress_report(&s->wpp_progress[0], INT_MAX);
+
+    return ret;
+}
+
+/**
+ * Decode a slice segment without WPP substreams, running the in-loop filters
+ * of already decoded CTB rows in parallel with the parsing and reconstruction
+ * of the following ones.
+ */
+static int hls_slice_data_filter_rows(HEVCContext *s, GetBitContext *gb)
+{
+    const HEVCSPS *const sps = s->pps->sps;
+    int first_row = FFMAX(s->sh.slice_ctb_addr_rs / sps->ctb_width - 1, 0);
+    /* one parsing job and one filter job per row from the one above the
+     * segment to the bottom of the picture, as the end of the segment is only
+     * known once it is parsed; the jobs of the rows past it stop as soon as
+     * parsing is done */
+    int nb_jobs   = 1 + sps->ctb_height - first_row;
+    int *ret;
+    int res;
+
+    /* local_ctx[0] parses the slice, the others are used by the filter jobs */
+    res = local_ctx_alloc(s, s->avctx->thread_count + 1);
+    if (res < 0)
+        return res;
+
+    res = wpp_progress_init(s, nb_jobs);
+    if (res < 0)
+        return res;
+
+    atomic_store_explicit(&s->filter_ctb_end, s->sh.slice_ctb_addr_rs,
+                          memory_order_relaxed);
+
+    ret = av_calloc(nb_jobs, sizeof(*ret));
+    if (!ret)
+        return AVERROR(ENOMEM);
+
+    s->avctx->execute2(s->avctx, hls_decode_entry_filter_rows, gb, ret, nb_jobs);
+
+    res = ret[0];
+    av_free(ret);
+    return res;
+}
+
 static int decode_slice_data(HEVCContext *s, const HEVCLayerContext *l,
                              const H2645NAL *nal, GetBitContext *gb)
 {
@@ -3073,7 +3209,12 @@ static int decode_slice_data(HEVCContext *s, const HEVCLayerContext *l,
         pps->num_tile_rows == 1 && pps->num_tile_columns == 1)
         return hls_slice_data_wpp(s, nal);
 
-    return hls_decode_entry(s, gb);
+    if (s->avctx->active_thread_type == FF_THREAD_SLICE &&
+        s->avctx->thread_count > 1                       &&
+        pps->num_tile_rows == 1 && pps->num_tile_columns == 1)
+        return hls_slice_data_filter_rows(s, gb);
+
+    return hls_decode_entry(s, gb, 0);
 }
 
 static int set_side_data(HEVCContext *s)
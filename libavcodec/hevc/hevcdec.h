@@ -551,6 +551,10 @@ typedef struct HEVCContext {
 
     atomic_int wpp_err;
 
+    /** CTB address past the last CTB of the current slice segment whose
+     *  decoding has finished, as seen by the in-loop filter row jobs */
+    atomic_int filter_ctb_end;
+
     const uint8_t *data;
 
     H2645Packet pkt;
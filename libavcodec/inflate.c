@@ -17,7 +17,9 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 
+#include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
 #define CACHED_BITSTREAM_READER !ARCH_X86_32
 #define BITSTREAM_READER_LE
@@ -56,6 +58,58 @@ static int build_vlc(InflateTree *t, const int nb,
                                     symbols, 2, 2, 0, VLC_INIT_OUTPUT_LE, NULL);
 }
 
+/**
+ * Fill the lookup table of a literal/length code. Pairs of literals whose
+ * codes fit together in the table are decoded with a single lookup.
+ */
+static void build_lut(InflateTree *t, const uint8_t *lengths, int num)
+{
+    const int size = 1 << INFLATE_LUT_BITS;
+    unsigned count[16] = { 0 }, next[16], code = 0;
+
+    memset(t->lut, 0, sizeof(t->lut));
+
+    for (int i = 0; i < num; i++)
+        count[lengths[i]]++;
+    count[0] = 0;
+    for (int i = 1; i < 16; i++) {
+        code = (code + count[i - 1]) << 1;
+        next[i] = code;
+    }
+
+    for (int i = 0; i < num; i++) {
+        const int len = lengths[i];
+        unsigned rev = 0;
+
+        if (!len)
+            continue;
+        code = next[len]++;
+        if (len > INFLATE_LUT_BITS)
+            continue;
+
+        /* the codes are stored starting from their most significant bit */
+        for (int j = 0; j < len; j++)
+            rev |= ((code >> j) & 1) << (len - 1 - j);
+        for (int j = rev; j < size; j += 1 << len)
+            t->lut[j] = (InflateEntry){ .sym = i, .len = len, .num = 1 };
+    }
+
+    /* in decreasing order, so that the second entry is still a single one */
+    for (int j = size - 1; j >= 0; j--) {
+        const InflateEntry first = t->lut[j];
+        InflateEntry second;
+
+        if (first.num != 1 || first.sym > 255)
+            continue;
+        second = t->lut[j >> first.len];
+        if (second.num != 1 || second.sym > 255 ||
+            first.len + second.len > INFLATE_LUT_BITS)
+            continue;
+        t->lut[j] = (InflateEntry){ .sym = first.sym | (second.sym << 8),
+                                    .len = first.len + second.len, .num = 2 };
+    }
+}
+
 static int build_fixed_trees(InflateTree *lt, InflateTree *dt)
 {
     uint16_t symbols[288] = { 0 };
@@ -88,6 +142,10 @@ static int build_fixed_trees(InflateTree *lt, InflateTree *dt)
     if (ret < 0)
         return ret;
 
+    for (int i = 0; i < 288; i++)
+        lens[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+    build_lut(lt, lens, 288);
+
     for (int i = 0; i < 32; i++) {
         symbols[i] = i;
         lens[i] = 5;
@@ -108,6 +166,29 @@ static av_always_inline uint32_t get_bits_base(GetBitContext *gb, int bits, int
     return base + get_bitsz(gb, bits);
 }
 
+/**
+ * Copy a match of len bytes from dist bytes back. If there are at least 8
+ * bytes of room after it, whole words are copied, possibly past its end.
+ */
+static av_always_inline void copy_match(uint8_t *dst, int dist, int len, int room)
+{
+    const uint8_t *src = dst - dist;
+
+    if (dist >= 8 && room >= 8) {
+        const uint8_t *const end = dst + len;
+
+        do {
+            AV_COPY64U(dst, src);
+            dst += 8;
+            src += 8;
+        } while (dst < end);
+    } else if (dist >= len) {
+        memcpy(dst, src, len);
+    } else {
+        av_memcpy_backptr(dst, dist, len);
+    }
+}
+
 static int inflate_block_datax(InflateContext *s, InflateTree *lt, InflateTree *dt)
 {
     const ptrdiff_t linesize = s->linesize;
@@ -120,20 +201,43 @@ static int inflate_block_datax(InflateContext *s, InflateTree *lt, InflateTree *
     const int lt_max_sym = lt->max_sym;
     const VLCElem *dt_tab = dt->vlc.table;
     const VLCElem *lt_tab = lt->vlc.table;
+    const InflateEntry *lut = lt->lut;
     const unsigned history_size = FF_ARRAY_ELEMS(s->history);
     const unsigned history_mask = history_size-1;
     unsigned history_pos = s->history_pos;
     uint8_t *history = s->history;
 
     for (;;) {
-        int sym = decode_symbol(gb, lt_tab);
+        const InflateEntry e = lut[show_bits(gb, INFLATE_LUT_BITS)];
+        int sym;
+
+        if (e.num == 2 && width - x >= 2) {
+            AV_WL16(dst + x, e.sym);
+            history[history_pos] = e.sym;
+            history[(history_pos + 1) & history_mask] = e.sym >> 8;
+            history_pos = (history_pos + 2) & history_mask;
+            skip_bits(gb, e.len);
+            sym = -1;
+            x += 2;
+        } else if (e.num == 1) {
+            sym = e.sym;
+            skip_bits(gb, e.len);
+        } else {
+            sym = decode_symbol(gb, lt_tab);
+            if (sym < 0) {
+                ret = AVERROR_INVALIDDATA;
+                goto fail;
+            }
+        }
 
         if (sym < 256) {
-            dst[x] = sym;
-            history[history_pos++] = sym;
-            history_pos &= history_mask;
+            if (sym >= 0) {
+                dst[x] = sym;
+                history[history_pos++] = sym;
+                history_pos &= history_mask;
+                x++;
+            }
 
-            x++;
             if (x >= width) {
                 s->row_fun(s->priv_data, s->dst, linesize, s->tmp, &y, &width, height);
                 dst = s->tmp;
@@ -339,6 +443,7 @@ static int decode_trees(InflateContext *s, InflateTree *lt, InflateTree *dt)
     ret = build_tree(lt, lengths, hlit);
     if (ret < 0)
         return ret;
+    build_lut(lt, lengths, hlit);
 
     return build_tree(dt, lengths + hlit, hdist);
 }
@@ -397,7 +502,7 @@ static int inflate_raw_blockx(InflateContext *s)
 
         memcpy(dst + x, gb->buffer + (get_bits_count(gb) >> 3), ilen);
         for (int i = 0; i < ilen; i++) {
-            history[history_pos++] = dst[i];
+            history[history_pos++] = dst[x + i];
             history_pos &= history_mask;
         }
 
@@ -447,7 +552,7 @@ static int inflate_raw_block(InflateContext *s)
         memcpy(dst + linesize * y + x, gb->buffer + (get_bits_count(gb) >> 3), ilen);
 
         x += ilen;
-        if (x >= width) {
+        if (x >= width && height > 1) {
             x = 0;
             y++;
         }
@@ -475,14 +580,32 @@ static int inflate_block_data(InflateContext *s, InflateTree *lt, InflateTree *d
     const int lt_max_sym = lt->max_sym;
     const VLCElem *dt_tab = dt->vlc.table;
     const VLCElem *lt_tab = lt->vlc.table;
+    const InflateEntry *lut = lt->lut;
 
     for (;;) {
-        int sym = decode_symbol(gb, lt_tab);
+        const InflateEntry e = lut[show_bits(gb, INFLATE_LUT_BITS)];
+        int sym;
+
+        if (e.num == 2 && width - x >= 2) {
+            AV_WL16(dst + x, e.sym);
+            skip_bits(gb, e.len);
+            sym = -1;
+            x += 2;
+        } else if (e.num == 1) {
+            sym = e.sym;
+            skip_bits(gb, e.len);
+        } else {
+            sym = decode_symbol(gb, lt_tab);
+            if (sym < 0) {
+                ret = AVERROR_INVALIDDATA;
+                goto fail;
+            }
+        }
 
         if (sym < 256) {
-            dst[x] = sym;
+            if (sym >= 0)
+                dst[x++] = sym;
 
-            x++;
             if (x >= width) {
                 dst += linesize;
                 x = 0;
@@ -572,6 +695,159 @@ fail:
     return ret;
 }
 
+/**
+ * Bit reader of the single row decoder, holding up to 64 bits, which is
+ * refilled a word at a time. A refill leaves at least 56 bits, enough for
+ * a whole length/distance pair.
+ */
+typedef struct WordReader {
+    const uint8_t *ptr, *end;
+    uint64_t bits;
+    unsigned left;
+} WordReader;
+
+static av_always_inline void wr_refill(WordReader *wr)
+{
+    if (wr->end - wr->ptr >= 8) {
+        wr->bits |= AV_RL64(wr->ptr) << wr->left;
+        wr->ptr  += (63 - wr->left) >> 3;
+        wr->left |= 56;
+    } else {
+        /* past the end of the input, read zeros like the get_bits API */
+        while (wr->left <= 56) {
+            if (wr->ptr < wr->end)
+                wr->bits |= (uint64_t)*wr->ptr << wr->left;
+            wr->ptr++;
+            wr->left += 8;
+        }
+    }
+}
+
+static av_always_inline unsigned wr_show(const WordReader *wr, int n)
+{
+    return wr->bits & ((1U << n) - 1);
+}
+
+static av_always_inline void wr_skip(WordReader *wr, int n)
+{
+    wr->bits >>= n;
+    wr->left  -= n;
+}
+
+static av_always_inline unsigned wr_get(WordReader *wr, int n)
+{
+    const unsigned v = wr_show(wr, n);
+
+    wr_skip(wr, n);
+    return v;
+}
+
+/* Same as get_vlc2(gb, tab, 10, 2) */
+static av_always_inline int wr_vlc(WordReader *wr, const VLCElem *tab)
+{
+    int idx = wr_show(wr, 10);
+    int n = tab[idx].len;
+
+    if (n < 0) {
+        wr_skip(wr, 10);
+        idx = tab[idx].sym + wr_show(wr, -n);
+        n = tab[idx].len;
+    }
+    wr_skip(wr, n);
+
+    return tab[idx].sym;
+}
+
+/**
+ * Decode a block into an output of a single row, which is how the whole
+ * output is decoded when its size is known in advance.
+ */
+static int inflate_block_flat(InflateContext *s, InflateTree *lt, InflateTree *dt)
+{
+    GetBitContext *gb = &s->gb;
+    uint8_t *const dst = s->dst;
+    const int end = s->width;
+    const int dt_max_sym = dt->max_sym;
+    const int lt_max_sym = lt->max_sym;
+    const VLCElem *dt_tab = dt->vlc.table;
+    const VLCElem *lt_tab = lt->vlc.table;
+    const InflateEntry *lut = lt->lut;
+    const int start = get_bits_count(gb);
+    WordReader wr;
+    int ret = 0, pos = s->x;
+
+    wr.ptr  = gb->buffer + (start >> 3);
+    wr.end  = gb->buffer_end;
+    wr.bits = 0;
+    wr.left = 0;
+    wr_refill(&wr);
+    wr_skip(&wr, start & 7);
+
+    /* keep going at the end of the output, to read the end of block code */
+    for (;;) {
+        InflateEntry e;
+        int sym, len, dist;
+
+        wr_refill(&wr);
+        e = lut[wr_show(&wr, INFLATE_LUT_BITS)];
+
+        if (e.num == 2 && end - pos >= 2) {
+            AV_WL16(dst + pos, e.sym);
+            wr_skip(&wr, e.len);
+            pos += 2;
+            continue;
+        } else if (e.num == 1) {
+            sym = e.sym;
+            wr_skip(&wr, e.len);
+        } else {
+            sym = wr_vlc(&wr, lt_tab);
+            if (sym < 0) {
+                ret = AVERROR_INVALIDDATA;
+                break;
+            }
+        }
+
+        if (sym < 256) {
+            if (pos >= end)
+                break;
+            dst[pos++] = sym;
+            continue;
+        } else if (sym == 256) {
+            break;
+        } else if (sym > lt_max_sym || sym > 285) {
+            ret = AVERROR_INVALIDDATA;
+            break;
+        }
+
+        sym -= 257;
+        len = length_base[sym] + wr_get(&wr, length_bits[sym]);
+        if (len > end - pos) {
+            ret = AVERROR_INVALIDDATA;
+            break;
+        }
+
+        dist = wr_vlc(&wr, dt_tab);
+        if (dist < 0 || dist > dt_max_sym || dist > 29) {
+            ret = AVERROR_INVALIDDATA;
+            break;
+        }
+
+        dist = dist_base[dist] + wr_get(&wr, dist_bits[dist]);
+        if (dist > pos) {
+            ret = AVERROR_INVALIDDATA;
+            break;
+        }
+
+        copy_match(dst + pos, dist, len, end - pos - len);
+        pos += len;
+    }
+
+    skip_bits_long(gb, (wr.ptr - gb->buffer) * 8 - wr.left - start);
+    s->x = pos;
+
+    return ret;
+}
+
 static int inflate_fixed_block(InflateContext *s)
 {
     if (!s->fixed_cb_initialized) {
@@ -583,6 +859,8 @@ static int inflate_fixed_block(InflateContext *s)
         s->fixed_cb_initialized = 1;
     }
 
+    if (s->height == 1)
+        return inflate_block_flat(s, &s->fixed_ltree, &s->fixed_dtree);
     return inflate_block_data(s, &s->fixed_ltree, &s->fixed_dtree);
 }
 
@@ -593,6 +871,8 @@ static int inflate_dynamic_block(InflateContext *s)
     if (ret < 0)
         return ret;
 
+    if (s->height == 1)
+        return inflate_block_flat(s, &s->dynamic_ltree, &s->dynamic_dtree);
     return inflate_block_data(s, &s->dynamic_ltree, &s->dynamic_dtree);
 }
 
@@ -602,6 +882,7 @@ int ff_inflate(InflateContext *s,
                int width, ptrdiff_t linesize)
 {
     GetBitContext *gb = &s->gb;
+    const int rows = height;
     int ret, cm, cinfo;
     int bfinal, bmode;
     uint16_t hdr;
@@ -626,6 +907,12 @@ int ff_inflate(InflateContext *s,
     s->row_fun = NULL;
     s->tmp = NULL;
 
+    /* a contiguous output is decoded as a single row */
+    if (height > 1 && linesize == width && (int64_t)height * width <= INT_MAX) {
+        s->width  = height * width;
+        s->height = 1;
+    }
+
     ret = init_get_bits8(gb, src, src_len);
     if (ret < 0)
         goto end;
@@ -663,12 +950,22 @@ int ff_inflate(InflateContext *s,
             ret = AVERROR_INVALIDDATA;
             break;
         }
+
+        if (s->y >= s->height || s->x >= s->width)
+            break;
     } while (!bfinal);
 
 end:
     ff_vlc_free(&s->dynamic_ltree.vlc);
     ff_vlc_free(&s->dynamic_dtree.vlc);
 
+    if (s->height != rows) {
+        s->y = s->x / width;
+        s->x = s->x % width;
+        s->width  = width;
+        s->height = rows;
+    }
+
     if (ret < 0)
         return ret;
 
@@ -25,9 +25,22 @@
 #define BITSTREAM_READER_LE
 #include "get_bits.h"
 
+#define INFLATE_LUT_BITS 11
+
+/**
+ * Entry of the lookup table of a literal/length code, for the next
+ * INFLATE_LUT_BITS bits of input.
+ */
+typedef struct InflateEntry {
+    uint16_t sym;   ///< the symbol, or two literals, the first in the low byte
+    uint8_t  len;   ///< number of bits of the symbols
+    uint8_t  num;   ///< number of symbols, 0 if the code is longer than the table
+} InflateEntry;
+
 typedef struct InflateTree {
     VLC vlc;
     int max_sym;
+    InflateEntry lut[1 << INFLATE_LUT_BITS];
 } InflateTree;
 
 typedef struct InflateContext {
@@ -51,6 +64,13 @@ typedef struct InflateContext {
     InflateTree dynamic_ltree, dynamic_dtree;
 } InflateContext;
 
+/**
+ * Decompress a zlib or raw deflate stream into height rows of width bytes.
+ * A contiguous output (linesize == width) is decoded at once, which is the
+ * fastest. On return, s->y and s->x are the position reached in the output.
+ *
+ * @return the number of bytes of src used, or a negative error code
+ */
 int ff_inflate(InflateContext *s, const uint8_t *src, int src_len,
                uint8_t *dst, int height, int width, ptrdiff_t linesize);
 
@@ -100,6 +100,8 @@ static av_cold int encode_init(AVCodecContext *avctx)
     c->compression = avctx->compression_level == FF_COMPRESSION_DEFAULT ?
                             COMP_ZLIB_NORMAL :
                             av_clip(avctx->compression_level, 0, 9);
+    c->dc.level = avctx->compression_level == FF_COMPRESSION_DEFAULT ?
+                  DEFLATE_LEVEL_LINES : c->compression;
     c->flags = 0;
     c->imgtype = IMGTYPE_RGB24;
     avctx->bits_per_coded_sample= 24;
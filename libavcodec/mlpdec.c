@@ -138,6 +138,8 @@ typedef struct SubStream {
     uint16_t    blocksize;
     /// Number of PCM samples decoded so far in this frame.
     uint16_t    blockpos;
+    /// Number of PCM samples of this frame already run through the filters.
+    uint16_t    filtered_pos;
 
     /// Left shift to apply to decoded PCM values to get final 24-bit output.
     int8_t      output_shift[MAX_CHANNELS];
@@ -145,6 +147,12 @@ typedef struct SubStream {
     /// Running XOR of all output samples.
     int32_t     lossless_check_data;
 
+    /// Number of matrix and filter changes in the current access unit.
+    int         matrix_changed;
+    int         filter_changed[MAX_CHANNELS][NUM_FILTERS];
+
+    /// LSBs bypassing the matrices, read along with the residuals.
+    int8_t      bypassed_lsbs[MAX_BLOCKSIZE][MAX_CHANNELS];
 } SubStream;
 
 typedef struct MLPDecodeContext {
@@ -186,11 +194,7 @@ typedef struct MLPDecodeContext {
 
     SubStream   substream[MAX_SUBSTREAMS];
 
-    int         matrix_changed;
-    int         filter_changed[MAX_CHANNELS][NUM_FILTERS];
-
     int8_t      noise_buffer[MAX_BLOCKSIZE_POW2];
-    int8_t      bypassed_lsbs[MAX_BLOCKSIZE][MAX_CHANNELS];
     DECLARE_ALIGNED(32, int32_t, sample_buffer)[MAX_BLOCKSIZE][MAX_CHANNELS];
 
     MLPDSPContext dsp;
@@ -204,6 +208,12 @@ typedef struct MLPDecodeContext {
                            int is32);
 } MLPDecodeContext;
 
+typedef struct SubStreamJob {
+    const uint8_t *buf;
+    int         data_len;
+    int         parity_present;
+} SubStreamJob;
+
 static const enum AVChannel thd_channel_order[] = {
     AV_CHAN_FRONT_LEFT, AV_CHAN_FRONT_RIGHT,                     // LR
     AV_CHAN_FRONT_CENTER,                                        // C
@@ -288,7 +298,7 @@ static inline int read_huff_channels(MLPDecodeContext *m, GetBitContext *gbp,
 
     for (mat = 0; mat < s->num_primitive_matrices; mat++)
         if (s->lsb_bypass[mat])
-            m->bypassed_lsbs[pos + s->blockpos][mat] = get_bits(gbp, s->lsb_bypass[mat]);
+            s->bypassed_lsbs[pos + s->blockpos][mat] = get_bits(gbp, s->lsb_bypass[mat]);
 
     for (channel = s->min_channel; channel <= s->max_channel; channel++) {
         ChannelParams *cp = &s->channel_params[channel];
@@ -751,7 +761,7 @@ static int read_filter_params(MLPDecodeContext *m, GetBitContext *gbp,
     // Filter is 0 for FIR, 1 for IIR.
     av_assert0(filter < 2);
 
-    if (m->filter_changed[channel][filter]++ > 1) {
+    if (s->filter_changed[channel][filter]++ > 1) {
         av_log(m->avctx, AV_LOG_ERROR, "Filters may change only once per access unit.\n");
         return AVERROR_INVALIDDATA;
     }
@@ -847,7 +857,7 @@ static int read_31ea_31eb_matrix_params(MLPDecodeContext *m, unsigned int substr
                                      ? MAX_MATRICES_MLP
                                      : get_max_nb_primitive_matrices(m, substr);
 
-    if (++m->matrix_changed > 1) {
+    if (++s->matrix_changed > 1) {
         av_log(m->avctx, AV_LOG_ERROR, "Matrices may change only once per access unit.\n");
         return AVERROR_INVALIDDATA;
     }
@@ -916,7 +926,7 @@ static int read_31ec_matrix_params(MLPDecodeContext *m, unsigned int substr, Get
 
     const int max_primitive_matrices = get_max_nb_primitive_matrices(m, substr);
 
-    if (++m->matrix_changed > 1) {
+    if (++s->matrix_changed > 1) {
         av_log(m->avctx, AV_LOG_ERROR, "Matrices may change only once per access unit.\n");
         return AVERROR_INVALIDDATA;
     }
@@ -1176,7 +1186,8 @@ fail:
 #define MSB_MASK(bits)  (-(1 << (bits)))
 
 /** Generate PCM samples using the prediction filters and residual values
- *  read from the data stream, and update the filter state. */
+ *  read from the data stream, and update the filter state. All samples read
+ *  since the filters were last run are processed at once. */
 
 static void filter_channel(MLPDecodeContext *m, unsigned int substr,
                            unsigned int channel)
@@ -1190,17 +1201,54 @@ static void filter_channel(MLPDecodeContext *m, unsigned int substr,
     FilterParams *iir = &s->channel_params[channel].filter_params[IIR];
     unsigned int filter_shift = fir->shift;
     int32_t mask = MSB_MASK(s->quant_step_size[channel]);
+    int count = s->blockpos - s->filtered_pos;
 
     memcpy(firbuf, fir->state, MAX_FIR_ORDER * sizeof(int32_t));
     memcpy(iirbuf, iir->state, MAX_IIR_ORDER * sizeof(int32_t));
 
     m->dsp.mlp_filter_channel(firbuf, fircoeff,
                               fir->order, iir->order,
-                              filter_shift, mask, s->blocksize,
-                              &m->sample_buffer[s->blockpos][channel]);
+                              filter_shift, mask, count,
+                              &m->sample_buffer[s->filtered_pos][channel]);
+
+    memcpy(fir->state, firbuf - count, MAX_FIR_ORDER * sizeof(int32_t));
+    memcpy(iir->state, iirbuf - count, MAX_IIR_ORDER * sizeof(int32_t));
+}
+
+static int filter_channel_thread(AVCodecContext *avctx, void *arg,
+                                 int jobnr, int threadnr)
+{
+    MLPDecodeContext *m = avctx->priv_data;
+    unsigned int substr = *(unsigned int *)arg;
+
+    filter_channel(m, substr, m->substream[substr].min_channel + jobnr);
+
+    return 0;
+}
+
+/** Run the prediction filters over the samples read so far. This has to be
+ *  done before the filter parameters or the quantization step sizes change.
+ *  The channels are independent and are filtered in parallel unless the
+ *  caller already runs as a slice job. */
+
+static void filter_pending(MLPDecodeContext *m, unsigned int substr,
+                           int threaded)
+{
+    SubStream *s = &m->substream[substr];
+    int nb_channels = s->max_channel - s->min_channel + 1;
+
+    if (s->filtered_pos >= s->blockpos)
+        return;
+
+    if (threaded && nb_channels > 1) {
+        m->avctx->execute2(m->avctx, filter_channel_thread, &substr,
+                           NULL, nb_channels);
+    } else {
+        for (unsigned int ch = s->min_channel; ch <= s->max_channel; ch++)
+            filter_channel(m, substr, ch);
+    }
 
-    memcpy(fir->state, firbuf - s->blocksize, MAX_FIR_ORDER * sizeof(int32_t));
-    memcpy(iir->state, iirbuf - s->blocksize, MAX_IIR_ORDER * sizeof(int32_t));
+    s->filtered_pos = s->blockpos;
 }
 
 /** Read a block of PCM residual data (or actual if no filtering active). */
@@ -1209,7 +1257,7 @@ static int read_block_data(MLPDecodeContext *m, GetBitContext *gbp,
                            unsigned int substr)
 {
     SubStream *s = &m->substream[substr];
-    unsigned int i, ch, expected_stream_pos = 0;
+    unsigned int i, expected_stream_pos = 0;
     int ret;
 
     if (s->data_check_present) {
@@ -1224,16 +1272,13 @@ static int read_block_data(MLPDecodeContext *m, GetBitContext *gbp,
         return AVERROR_INVALIDDATA;
     }
 
-    memset(&m->bypassed_lsbs[s->blockpos][0], 0,
-           s->blocksize * sizeof(m->bypassed_lsbs[0]));
+    memset(&s->bypassed_lsbs[s->blockpos][0], 0,
+           s->blocksize * sizeof(s->bypassed_lsbs[0]));
 
     for (i = 0; i < s->blocksize; i++)
         if ((ret = read_huff_channels(m, gbp, substr, i)) < 0)
             return ret;
 
-    for (ch = s->min_channel; ch <= s->max_channel; ch++)
-        filter_channel(m, substr, ch);
-
     s->blockpos += s->blocksize;
 
     if (s->data_check_present) {
@@ -1399,7 +1444,7 @@ static int output_data(MLPDecodeContext *m, unsigned int substr,
             /* Single primitive matrices */
             m->dsp.mlp_rematrix_channel(&m->sample_buffer[0][0],
                                         s->matrix_coeff[mat],
-                                        &m->bypassed_lsbs[0][mat],
+                                        &s->bypassed_lsbs[0][mat],
                                         m->noise_buffer,
                                         s->num_primitive_matrices - mat,
                                         dest_ch,
@@ -1414,7 +1459,7 @@ static int output_data(MLPDecodeContext *m, unsigned int substr,
             m->dsp.mlp_rematrix_interp_channel(&m->sample_buffer[0][0],
                                                s->matrix_coeff[mat],
                                                s->delta_matrix_coeff[mat],
-                                               &m->bypassed_lsbs[0][mat],
+                                               &s->bypassed_lsbs[0][mat],
                                                m->noise_buffer,
                                                s->num_primitive_matrices - mat,
                                                dest_ch,
@@ -1463,6 +1508,185 @@ static int output_data(MLPDecodeContext *m, unsigned int substr,
     return 0;
 }
 
+/** Check whether the channels of a substream overlap those of the previous
+ *  or the final decoded substream, in which case its audio data is skipped. */
+
+static int substream_overlaps(MLPDecodeContext *m, unsigned int substr,
+                              int verbose)
+{
+    AVCodecContext *avctx = m->avctx;
+    SubStream *s = &m->substream[substr];
+
+    if (((avctx->ch_layout.nb_channels == 6 &&
+          ((m->substream_info >> 2) & 0x3) != 0x3) ||
+         (avctx->ch_layout.nb_channels == 8 &&
+          ((m->substream_info >> 4) & 0x7) != 0x7 &&
+          ((m->substream_info >> 4) & 0x7) != 0x6 &&
+          ((m->substream_info >> 4) & 0x7) != 0x4 &&
+          ((m->substream_info >> 4) & 0x7) != 0x3)) &&
+        substr > 0 && substr < m->max_decoded_substream &&
+        (s->min_channel <= m->substream[substr - 1].max_channel)) {
+        if (verbose)
+            av_log(avctx, AV_LOG_DEBUG,
+                   "Previous substream(%d) channels overlaps current substream(%d) channels, skipping.\n",
+                   substr - 1, substr);
+        return 1;
+    }
+
+    if (substr != m->max_decoded_substream &&
+        ((s->coded_channels & m->substream[m->max_decoded_substream].coded_channels) != 0)) {
+        if (verbose)
+            av_log(avctx, AV_LOG_DEBUG,
+                   "Current substream(%d) channels overlaps final substream(%d) channels, skipping.\n",
+                   substr, m->max_decoded_substream);
+        return 1;
+    }
+
+    return 0;
+}
+
+/** Check whether the substreams of an access unit without restart headers
+ *  write disjoint sets of channels, so that they can be decoded in parallel. */
+
+static int substreams_independent(MLPDecodeContext *m)
+{
+    uint64_t coded_channels = 0;
+
+    for (unsigned int substr = 0; substr <= m->max_decoded_substream; substr++) {
+        SubStream *s = &m->substream[substr];
+
+        if (!s->restart_seen || substream_overlaps(m, substr, 0))
+            continue;
+        if (coded_channels & s->coded_channels)
+            return 0;
+        coded_channels |= s->coded_channels;
+    }
+
+    return 1;
+}
+
+/** Read the blocks of one substream of an access unit.
+ *  @param threaded set if the prediction filters may use slice threads
+ *  @return negative on error, 0 otherwise */
+
+static int read_substream(MLPDecodeContext *m, unsigned int substr,
+                          const uint8_t *buf, int data_len,
+                          int parity_present, int threaded)
+{
+    SubStream *s = &m->substream[substr];
+    GetBitContext gb;
+    int ret;
+
+    init_get_bits(&gb, buf, data_len * 8);
+
+    s->matrix_changed = 0;
+    memset(s->filter_changed, 0, sizeof(s->filter_changed));
+
+    s->blockpos     = 0;
+    s->filtered_pos = 0;
+    do {
+        if (get_bits1(&gb)) {
+            filter_pending(m, substr, threaded);
+
+            if (get_bits1(&gb)) {
+                /* A restart header should be present. */
+                if (!m->is_major_sync_unit) {
+                    av_log(m->avctx, AV_LOG_ERROR,
+                           "Restart header in non-restart substream %d.\n",
+                           substr);
+                    goto next_substr;
+                }
+                if (read_restart_header(m, &gb, buf, substr) < 0)
+                    goto next_substr;
+                s->restart_seen = 1;
+            }
+
+            if (!s->restart_seen)
+                goto next_substr;
+            if (read_decoding_params(m, &gb, substr) < 0)
+                goto next_substr;
+        }
+
+        if (!s->restart_seen)
+            goto next_substr;
+
+        if (substream_overlaps(m, substr, 1))
+            goto next_substr;
+
+        if ((ret = read_block_data(m, &gb, substr)) < 0) {
+            filter_pending(m, substr, threaded);
+            return ret;
+        }
+
+        if (get_bits_count(&gb) >= data_len * 8)
+            goto substream_length_mismatch;
+
+    } while (!get_bits1(&gb));
+
+    filter_pending(m, substr, threaded);
+
+    skip_bits(&gb, (-get_bits_count(&gb)) & 15);
+
+    if (data_len * 8 - get_bits_count(&gb) >= 32) {
+        int shorten_by;
+
+        if (get_bits(&gb, 16) != 0xD234)
+            return AVERROR_INVALIDDATA;
+
+        shorten_by = get_bits(&gb, 16);
+        if      (m->avctx->codec_id == AV_CODEC_ID_TRUEHD && shorten_by  & 0x2000)
+            s->blockpos -= FFMIN(shorten_by & 0x1FFF, s->blockpos);
+        else if (m->avctx->codec_id == AV_CODEC_ID_MLP    && shorten_by != 0xD234)
+            return AVERROR_INVALIDDATA;
+
+        av_log(m->avctx, AV_LOG_DEBUG, "End of stream indicated.\n");
+        s->end_of_stream = 1;
+    }
+
+    if (parity_present) {
+        uint8_t parity, checksum;
+
+        if (data_len * 8 - get_bits_count(&gb) != 16)
+            goto substream_length_mismatch;
+
+        parity   = ff_mlp_calculate_parity(buf, data_len - 2);
+        checksum = ff_mlp_checksum8       (buf, data_len - 2);
+
+        if ((get_bits(&gb, 8) ^ parity) != 0xa9    )
+            av_log(m->avctx, AV_LOG_ERROR, "Substream %d parity check failed.\n", substr);
+        if ( get_bits(&gb, 8)           != checksum)
+            av_log(m->avctx, AV_LOG_ERROR, "Substream %d checksum failed.\n"    , substr);
+    }
+
+    if (data_len * 8 != get_bits_count(&gb))
+        goto substream_length_mismatch;
+
+next_substr:
+    filter_pending(m, substr, threaded);
+
+    if (!s->restart_seen)
+        av_log(m->avctx, AV_LOG_ERROR,
+               "No restart header present in substream %d.\n", substr);
+
+    return 0;
+
+substream_length_mismatch:
+    filter_pending(m, substr, threaded);
+
+    av_log(m->avctx, AV_LOG_ERROR, "substream %d length mismatch\n", substr);
+    return AVERROR_INVALIDDATA;
+}
+
+static int read_substream_thread(AVCodecContext *avctx, void *arg,
+                                 int jobnr, int threadnr)
+{
+    MLPDecodeContext *m = avctx->priv_data;
+    const SubStreamJob *job = &((const SubStreamJob *)arg)[jobnr];
+
+    return read_substream(m, jobnr, job->buf, job->data_len,
+                          job->parity_present, 0);
+}
+
 /** Read an access unit from the stream.
  *  @return negative on error, 0 if not enough data is present in the input stream,
  *  otherwise the number of bytes consumed. */
@@ -1575,106 +1799,34 @@ static int read_access_unit(AVCodecContext *avctx, AVFrame *frame,
 
     buf += header_size + substr_header_size;
 
-    for (substr = 0; substr <= m->max_decoded_substream; substr++) {
-        SubStream *s = &m->substream[substr];
-
-        init_get_bits(&gb, buf, substream_data_len[substr] * 8);
-
-        m->matrix_changed = 0;
-        memset(m->filter_changed, 0, sizeof(m->filter_changed));
-
-        s->blockpos = 0;
-        do {
-            if (get_bits1(&gb)) {
-                if (get_bits1(&gb)) {
-                    /* A restart header should be present. */
-                    if (read_restart_header(m, &gb, buf, substr) < 0)
-                        goto next_substr;
-                    s->restart_seen = 1;
-                }
-
-                if (!s->restart_seen)
-                    goto next_substr;
-                if (read_decoding_params(m, &gb, substr) < 0)
-                    goto next_substr;
-            }
-
-            if (!s->restart_seen)
-                goto next_substr;
-
-            if (((avctx->ch_layout.nb_channels == 6 &&
-                  ((m->substream_info >> 2) & 0x3) != 0x3) ||
-                 (avctx->ch_layout.nb_channels == 8 &&
-                  ((m->substream_info >> 4) & 0x7) != 0x7 &&
-                  ((m->substream_info >> 4) & 0x7) != 0x6 &&
-                  ((m->substream_info >> 4) & 0x7) != 0x4 &&
-                  ((m->substream_info >> 4) & 0x7) != 0x3)) &&
-                substr > 0 && substr < m->max_decoded_substream &&
-                (s->min_channel <= m->substream[substr - 1].max_channel)) {
-                av_log(avctx, AV_LOG_DEBUG,
-                       "Previous substream(%d) channels overlaps current substream(%d) channels, skipping.\n",
-                       substr - 1, substr);
-                goto next_substr;
-            }
-
-            if (substr != m->max_decoded_substream &&
-                ((s->coded_channels & m->substream[m->max_decoded_substream].coded_channels) != 0)) {
-                av_log(avctx, AV_LOG_DEBUG,
-                       "Current substream(%d) channels overlaps final substream(%d) channels, skipping.\n",
-                       substr, m->max_decoded_substream);
-                goto next_substr;
-            }
-
-            if ((ret = read_block_data(m, &gb, substr)) < 0)
-                return ret;
-
-            if (get_bits_count(&gb) >= substream_data_len[substr] * 8)
-                goto substream_length_mismatch;
-
-        } while (!get_bits1(&gb));
-
-        skip_bits(&gb, (-get_bits_count(&gb)) & 15);
-
-        if (substream_data_len[substr] * 8 - get_bits_count(&gb) >= 32) {
-            int shorten_by;
-
-            if (get_bits(&gb, 16) != 0xD234)
-                return AVERROR_INVALIDDATA;
-
-            shorten_by = get_bits(&gb, 16);
-            if      (m->avctx->codec_id == AV_CODEC_ID_TRUEHD && shorten_by  & 0x2000)
-                s->blockpos -= FFMIN(shorten_by & 0x1FFF, s->blockpos);
-            else if (m->avctx->codec_id == AV_CODEC_ID_MLP    && shorten_by != 0xD234)
-                return AVERROR_INVALIDDATA;
-
-            av_log(m->avctx, AV_LOG_DEBUG, "End of stream indicated.\n");
-            s->end_of_stream = 1;
+    if (!m->is_major_sync_unit && m->max_decoded_substream > 0 &&
+        (avctx->active_thread_type & FF_THREAD_SLICE) &&
+        substreams_independent(m)) {
+        SubStreamJob jobs[MAX_SUBSTREAMS];
+        int rets[MAX_SUBSTREAMS];
+
+        for (substr = 0; substr <= m->max_decoded_substream; substr++) {
+            jobs[substr].buf            = buf;
+            jobs[substr].data_len       = substream_data_len[substr];
+            jobs[substr].parity_present = substream_parity_present[substr];
+            buf += substream_data_len[substr];
         }
 
-        if (substream_parity_present[substr]) {
-            uint8_t parity, checksum;
-
-            if (substream_data_len[substr] * 8 - get_bits_count(&gb) != 16)
-                goto substream_length_mismatch;
+        avctx->execute2(avctx, read_substream_thread, jobs, rets,
+                        m->max_decoded_substream + 1);
 
-            parity   = ff_mlp_calculate_parity(buf, substream_data_len[substr] - 2);
-            checksum = ff_mlp_checksum8       (buf, substream_data_len[substr] - 2);
+        for (substr = 0; substr <= m->max_decoded_substream; substr++)
+            if (rets[substr] < 0)
+                return rets[substr];
+    } else {
+        for (substr = 0; substr <= m->max_decoded_substream; substr++) {
+            ret = read_substream(m, substr, buf, substream_data_len[substr],
+                                 substream_parity_present[substr], 1);
+            if (ret < 0)
+                return ret;
 
-            if ((get_bits(&gb, 8) ^ parity) != 0xa9    )
-                av_log(m->avctx, AV_LOG_ERROR, "Substream %d parity check failed.\n", substr);
-            if ( get_bits(&gb, 8)           != checksum)
-                av_log(m->avctx, AV_LOG_ERROR, "Substream %d checksum failed.\n"    , substr);
+            buf += substream_data_len[substr];
         }
-
-        if (substream_data_len[substr] * 8 != get_bits_count(&gb))
-            goto substream_length_mismatch;
-
-next_substr:
-        if (!s->restart_seen)
-            av_log(m->avctx, AV_LOG_ERROR,
-                   "No restart header present in substream %d.\n", substr);
-
-        buf += substream_data_len[substr];
     }
 
     if ((ret = output_data(m, m->max_decoded_substream, frame, got_frame_ptr)) < 0)
@@ -1692,10 +1844,6 @@ next_substr:
 
     return length;
 
-substream_length_mismatch:
-    av_log(m->avctx, AV_LOG_ERROR, "substream %d length mismatch\n", substr);
-    return AVERROR_INVALIDDATA;
-
 error:
     m->params_valid = 0;
     return AVERROR_INVALIDDATA;
@@ -1747,7 +1895,8 @@ const FFCodec ff_mlp_decoder = {
     .init           = mlp_decode_init,
     FF_CODEC_DECODE_CB(read_access_unit),
     .flush          = mlp_decode_flush,
-    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_CHANNEL_CONF,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_CHANNEL_CONF |
+                      AV_CODEC_CAP_SLICE_THREADS,
 };
 #endif
 #if CONFIG_TRUEHD_DECODER
@@ -1761,7 +1910,8 @@ const FFCodec ff_truehd_decoder = {
     .init           = mlp_decode_init,
     FF_CODEC_DECODE_CB(read_access_unit),
     .flush          = mlp_decode_flush,
-    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_CHANNEL_CONF,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_CHANNEL_CONF |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .p.profiles     = NULL_IF_CONFIG_SMALL(ff_truehd_profiles),
 };
 #endif /* CONFIG_TRUEHD_DECODER */
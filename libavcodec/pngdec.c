@@ -119,6 +119,8 @@ typedef struct PNGDecContext {
     unsigned int tmp_row_size;
     uint8_t *buffer;
     int buffer_size;
+    uint8_t *rows;
+    unsigned int rows_size;
     int pass;
     int crow_size; /* compressed row size (include filter type) */
     int row_size; /* decompressed row size */
@@ -457,6 +459,31 @@ static int png_decode_idats(PNGDecContext *s,
     InflateContext *ic = &s->ic;
     int ret;
 
+    /* the size of a non-interlaced image is known, so it is decompressed
+     * at once, which is faster than row by row */
+    if (!s->interlace_type && s->cur_h <= INT_MAX / s->crow_size) {
+        const int size = s->crow_size * s->cur_h;
+        int y = 0, w = s->crow_size, rows;
+
+        av_fast_padded_malloc(&s->rows, &s->rows_size, size);
+        if (!s->rows)
+            return AVERROR(ENOMEM);
+
+        ret = ff_inflate(ic, s->idats, s->idats_size, s->rows, 1, size, size);
+
+        rows = ic->x / s->crow_size;
+        while (y < rows) {
+            memcpy(s->crow_buf, s->rows + y * s->crow_size, s->crow_size);
+            png_handle_row(s, dst, dst_stride, s->crow_buf, &y, &w, s->cur_h);
+        }
+        if (ret < 0)
+            return ret;
+
+        s->idats_size = 0;
+
+        return 0;
+    }
+
     ret = ff_inflatex(ic, s->idats, s->idats_size, dst, s->cur_h,
                       s->crow_size, dst_stride, s,
                       s->crow_buf, png_handle_row);
@@ -1905,6 +1932,8 @@ static av_cold int png_dec_end(AVCodecContext *avctx)
     ff_progress_frame_unref(&s->picture);
     av_freep(&s->buffer);
     s->buffer_size = 0;
+    av_freep(&s->rows);
+    s->rows_size = 0;
     av_freep(&s->idats);
     s->idats_size = 0;
     av_freep(&s->last_row);
@@ -23,6 +23,7 @@
 #include "codec_internal.h"
 #include "encode.h"
 #include "bytestream.h"
+#include "deflate.h"
 #include "lossless_videoencdsp.h"
 #include "png.h"
 #include "apng.h"
@@ -41,6 +42,8 @@
 #include <zlib.h>
 
 #define IOBUF_SIZE 4096
+#define MAX_BANDS  256
+#define DICT_SIZE  32768
 
 typedef struct APNGFctlChunk {
     uint32_t sequence_number;
@@ -50,6 +53,23 @@ typedef struct APNGFctlChunk {
     uint8_t dispose_op, blend_op;
 } APNGFctlChunk;
 
+/**
+ * A band of rows compressed independently of the others, as a raw deflate
+ * segment primed with the end of the previous band.
+ */
+typedef struct PNGEncBand {
+    FFZStream zstream;
+    DeflateContext *dc;          ///< set if compressed by ff_deflate_raw()
+    uint8_t *crow_base;          ///< filter scratch buffer
+    unsigned int crow_size;
+    uint8_t *buf;                ///< compressed data
+    unsigned int buf_size;
+    size_t len;
+    uint32_t adler;              ///< Adler-32 of the filtered rows
+    int y, h;
+    int ret;
+} PNGEncBand;
+
 typedef struct PNGEncContext {
     AVClass *class;
     LLVidEncDSPContext llvidencdsp;
@@ -62,6 +82,22 @@ typedef struct PNGEncContext {
 
     FFZStream zstream;
     uint8_t buf[IOBUF_SIZE];
+    int compression_level;
+
+    // slice threading
+    PNGEncBand *bands;
+    int nb_bands;
+    int cur_bands;               ///< number of bands of the current image
+    int row_size;
+    uint8_t *filtered;           ///< filtered rows of the current image
+    unsigned int filtered_size;
+    size_t filtered_len;
+
+    int deflate_impl;
+    DeflateContext *dc;          ///< set if the rows are compressed by ff_deflate()
+    uint8_t *zbuf;
+    unsigned int zbuf_size;
+
     int dpi;                     ///< Physical pixel density, in dots per inch, if set
     int dpm;                     ///< Physical pixel density, in dots per meter, if set
 
@@ -280,6 +316,13 @@ static int png_write_row(AVCodecContext *avctx, const uint8_t *data, int size)
     z_stream *const zstream = &s->zstream.zstream;
     int ret;
 
+    /* ff_deflate() compresses all rows at once, in png_deflate_rows() */
+    if (s->dc) {
+        memcpy(s->filtered + s->filtered_len, data, size);
+        s->filtered_len += size;
+        return 0;
+    }
+
     zstream->avail_in = size;
     zstream->next_in  = data;
     while (zstream->avail_in > 0) {
@@ -506,6 +549,182 @@ static int encode_headers(AVCodecContext *avctx, const AVFrame *pict)
     return 0;
 }
 
+static int filter_band(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    PNGEncContext *s       = avctx->priv_data;
+    const AVFrame *const p = arg;
+    PNGEncBand *b          = &s->bands[jobnr];
+    const int row_size     = s->row_size;
+    // pixel data should be aligned, but there's a control byte before it
+    uint8_t *crow_buf      = b->crow_base + 15;
+    const uint8_t *top     = b->y ? p->data[0] + (b->y - 1) * p->linesize[0] : NULL;
+
+    for (int y = b->y; y < b->y + b->h; y++) {
+        const uint8_t *ptr = p->data[0] + y * p->linesize[0];
+        const uint8_t *crow = png_choose_filter(s, crow_buf, ptr, top,
+                                                row_size, s->bits_per_pixel >> 3);
+        memcpy(s->filtered + y * (size_t)(row_size + 1), crow, row_size + 1);
+        top = ptr;
+    }
+    return 0;
+}
+
+/* Compress a band with zlib, returning the end of the compressed data */
+static uint8_t *deflate_band_zlib(PNGEncBand *b, const uint8_t *data, size_t len,
+                                  size_t dict, uint8_t *dst, size_t dst_size, int last)
+{
+    z_stream *const zstream = &b->zstream.zstream;
+    int ret;
+
+    deflateReset(zstream);
+    if (dict)
+        deflateSetDictionary(zstream, data - dict, dict);
+
+    zstream->next_in   = data;
+    zstream->avail_in  = len;
+    zstream->next_out  = dst;
+    zstream->avail_out = dst_size;
+    /* all bands but the last end with an empty stored block, which aligns
+     * them to a byte boundary without marking the end of the stream */
+    ret = deflate(zstream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    if (ret != (last ? Z_STREAM_END : Z_OK) || zstream->avail_in || !zstream->avail_out)
+        return NULL;
+
+    return zstream->next_out;
+}
+
+static int deflate_band(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    PNGEncContext *s        = avctx->priv_data;
+    PNGEncBand *b           = &s->bands[jobnr];
+    const size_t stride     = s->row_size + 1;
+    const uint8_t *data     = s->filtered + b->y * stride;
+    const size_t len        = b->h * stride;
+    const size_t dict       = FFMIN(b->y * stride, DICT_SIZE);
+    const int last          = jobnr == s->cur_bands - 1;
+    /* room for the zlib header before the first band and the checksum
+     * after the last one */
+    uint8_t *dst            = b->buf + (jobnr ? 0 : 2);
+    const size_t dst_size   = b->buf_size - 6;
+
+    if (b->dc) {
+        int ret = ff_deflate_raw(b->dc, dst, dst_size, data - dict, dict,
+                                 data, len, last);
+        if (ret < 0) {
+            b->ret = ret;
+            return ret;
+        }
+        dst += ret;
+    } else {
+        dst = deflate_band_zlib(b, data, len, dict, dst, dst_size, last);
+        if (!dst) {
+            b->ret = AVERROR_EXTERNAL;
+            return b->ret;
+        }
+    }
+
+    b->len   = dst - b->buf;
+    b->adler = adler32(adler32(0, NULL, 0), data, len);
+    b->ret   = 0;
+    return 0;
+}
+
+/* zlib stream header, as deflate() writes it for this compression level */
+static void png_write_zlib_header(uint8_t *dst, int level)
+{
+    const int flevel = level == Z_DEFAULT_COMPRESSION ? 2 :
+                       level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+    int header = (0x78 << 8) | (flevel << 6);
+
+    header += 31 - header % 31;
+    AV_WB16(dst, header);
+}
+
+/**
+ * Filter and compress bands of rows in parallel. The bands are concatenated
+ * into a single zlib stream, whose checksum is combined from theirs.
+ */
+static int encode_frame_bands(AVCodecContext *avctx, const AVFrame *pict,
+                              int row_size)
+{
+    PNGEncContext *s    = avctx->priv_data;
+    const int nb_bands  = FFMIN(s->nb_bands, pict->height);
+    const size_t stride = row_size + 1;
+    uint32_t adler;
+
+    if (pict->height * stride > UINT_MAX)
+        return AVERROR(ENOMEM);
+    av_fast_malloc(&s->filtered, &s->filtered_size, pict->height * stride);
+    if (!s->filtered)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < nb_bands; i++) {
+        PNGEncBand *b = &s->bands[i];
+        size_t bound;
+
+        b->y  = (int64_t)pict->height *  i      / nb_bands;
+        b->h  = (int64_t)pict->height * (i + 1) / nb_bands - b->y;
+        bound = b->dc ? ff_deflate_bound(b->h * stride)
+                      : deflateBound(&b->zstream.zstream, b->h * stride);
+        /* zlib header and checksum, and the sync flush marker */
+        if (bound > UINT_MAX - 16)
+            return AVERROR(ENOMEM);
+        av_fast_malloc(&b->buf, &b->buf_size, bound + 16);
+        av_fast_malloc(&b->crow_base, &b->crow_size,
+                       (row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
+        if (!b->buf || !b->crow_base)
+            return AVERROR(ENOMEM);
+    }
+    s->row_size  = row_size;
+    s->cur_bands = nb_bands;
+
+    avctx->execute2(avctx, filter_band, (void *)pict, NULL, nb_bands);
+    avctx->execute2(avctx, deflate_band, NULL, NULL, nb_bands);
+
+    png_write_zlib_header(s->bands[0].buf, s->compression_level);
+    adler = s->bands[0].adler;
+    for (int i = 0; i < nb_bands; i++) {
+        const PNGEncBand *b = &s->bands[i];
+        if (b->ret < 0)
+            return b->ret;
+        if (i)
+            adler = adler32_combine(adler, b->adler, b->h * stride);
+    }
+    AV_WB32(s->bands[nb_bands - 1].buf + s->bands[nb_bands - 1].len, adler);
+    s->bands[nb_bands - 1].len += 4;
+
+    for (int i = 0; i < nb_bands; i++) {
+        const PNGEncBand *b = &s->bands[i];
+        if (s->bytestream_end - s->bytestream < b->len + 100)
+            return AVERROR_BUG;
+        png_write_image_data(avctx, b->buf, b->len);
+    }
+
+    return 0;
+}
+
+static int png_deflate_rows(AVCodecContext *avctx)
+{
+    PNGEncContext *s = avctx->priv_data;
+    const size_t bound = ff_deflate_bound(s->filtered_len);
+    int len;
+
+    if (bound > INT_MAX)
+        return AVERROR(ENOMEM);
+    av_fast_malloc(&s->zbuf, &s->zbuf_size, bound);
+    if (!s->zbuf)
+        return AVERROR(ENOMEM);
+
+    len = ff_deflate(s->dc, s->zbuf, bound, s->filtered, 1, s->filtered_len, s->filtered_len);
+    if (len < 0)
+        return len;
+    if (s->bytestream_end - s->bytestream < len + 100)
+        return AVERROR_BUG;
+    png_write_image_data(avctx, s->zbuf, len);
+
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
 {
     PNGEncContext *s       = avctx->priv_data;
@@ -520,6 +739,22 @@ static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
 
     row_size = (pict->width * s->bits_per_pixel + 7) >> 3;
 
+    if (!s->is_progressive && s->nb_bands > 1 && pict->height > 1)
+        return encode_frame_bands(avctx, pict, row_size);
+
+    if (s->dc) {
+        /* an interlaced row takes at most two more bytes per pass, for the
+         * rounding of its size and the filter type */
+        const size_t size = pict->height * (size_t)(row_size + 1 + 2 * NB_PASSES);
+
+        if (size > INT_MAX)
+            return AVERROR(ENOMEM);
+        av_fast_malloc(&s->filtered, &s->filtered_size, size);
+        if (!s->filtered)
+            return AVERROR(ENOMEM);
+        s->filtered_len = 0;
+    }
+
     crow_base = av_malloc((row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
     if (!crow_base) {
         ret = AVERROR(ENOMEM);
@@ -572,6 +807,11 @@ static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
             top = ptr;
         }
     }
+    if (s->dc) {
+        ret = png_deflate_rows(avctx);
+        goto the_end;
+    }
+
     /* compress last bytes */
     for (;;) {
         ret = deflate(zstream, Z_FINISH);
@@ -1184,6 +1424,38 @@ static av_cold int png_enc_init(AVCodecContext *avctx)
     compression_level = avctx->compression_level == FF_COMPRESSION_DEFAULT
                       ? Z_DEFAULT_COMPRESSION
                       : av_clip(avctx->compression_level, 0, 9);
+    s->compression_level = compression_level;
+
+    if (s->deflate_impl == DEFLATE_IMPL_LAVC) {
+        s->dc = av_mallocz(sizeof(*s->dc));
+        if (!s->dc)
+            return AVERROR(ENOMEM);
+        s->dc->level = compression_level == Z_DEFAULT_COMPRESSION ? 6 : compression_level;
+    }
+    /* only split when asked to, so the output does not depend on the number of threads */
+    if (avctx->slices > 0)
+        s->nb_bands = FFMIN(avctx->slices, MAX_BANDS);
+    if (s->nb_bands > 1 && !s->is_progressive) {
+        s->bands = av_calloc(s->nb_bands, sizeof(*s->bands));
+        if (!s->bands)
+            return AVERROR(ENOMEM);
+        for (int i = 0; i < s->nb_bands; i++) {
+            PNGEncBand *b = &s->bands[i];
+            int ret;
+
+            if (s->dc) {
+                b->dc = av_mallocz(sizeof(*b->dc));
+                if (!b->dc)
+                    return AVERROR(ENOMEM);
+                b->dc->level = s->dc->level;
+                continue;
+            }
+            ret = ff_deflate_init2(&b->zstream, compression_level, -MAX_WBITS, avctx);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
     return ff_deflate_init(&s->zstream, compression_level, avctx);
 }
 
@@ -1192,6 +1464,16 @@ static av_cold int png_enc_close(AVCodecContext *avctx)
     PNGEncContext *s = avctx->priv_data;
 
     ff_deflate_end(&s->zstream);
+    for (int i = 0; i < s->nb_bands && s->bands; i++) {
+        ff_deflate_end(&s->bands[i].zstream);
+        av_freep(&s->bands[i].dc);
+        av_freep(&s->bands[i].crow_base);
+        av_freep(&s->bands[i].buf);
+    }
+    av_freep(&s->bands);
+    av_freep(&s->filtered);
+    av_freep(&s->dc);
+    av_freep(&s->zbuf);
     av_frame_free(&s->last_frame);
     av_frame_free(&s->prev_frame);
     av_freep(&s->last_frame_packet);
@@ -1212,6 +1494,9 @@ static const AVOption options[] = {
         { "avg",   NULL, 0, AV_OPT_TYPE_CONST, { .i64 = PNG_FILTER_VALUE_AVG },   INT_MIN, INT_MAX, VE, .unit = "pred" },
         { "paeth", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = PNG_FILTER_VALUE_PAETH }, INT_MIN, INT_MAX, VE, .unit = "pred" },
         { "mixed", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = PNG_FILTER_VALUE_MIXED }, INT_MIN, INT_MAX, VE, .unit = "pred" },
+    { "deflate_impl", "Deflate implementation", OFFSET(deflate_impl), AV_OPT_TYPE_INT, { .i64 = DEFLATE_IMPL_ZLIB }, DEFLATE_IMPL_ZLIB, DEFLATE_IMPL_LAVC, VE, .unit = "deflate_impl" },
+        { "zlib", "system zlib",      0, AV_OPT_TYPE_CONST, { .i64 = DEFLATE_IMPL_ZLIB }, INT_MIN, INT_MAX, VE, .unit = "deflate_impl" },
+        { "lavc", "built-in encoder", 0, AV_OPT_TYPE_CONST, { .i64 = DEFLATE_IMPL_LAVC }, INT_MIN, INT_MAX, VE, .unit = "deflate_impl" },
     { NULL},
 };
 
@@ -1227,6 +1512,7 @@ const FFCodec ff_png_encoder = {
     .p.type         = AVMEDIA_TYPE_VIDEO,
     .p.id           = AV_CODEC_ID_PNG,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS |
                       AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE,
     .priv_data_size = sizeof(PNGEncContext),
     .init           = png_enc_init,
@@ -1248,6 +1534,7 @@ const FFCodec ff_apng_encoder = {
     .p.type         = AVMEDIA_TYPE_VIDEO,
     .p.id           = AV_CODEC_ID_APNG,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
+                      AV_CODEC_CAP_SLICE_THREADS |
                       AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE,
     .priv_data_size = sizeof(PNGEncContext),
     .init           = png_enc_init,
@@ -0,0 +1,135 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavcodec/deflate.h"
+#include "libavcodec/inflate.h"
+
+#define WIDTH    999
+#define HEIGHT   300
+#define LINESIZE 1024
+
+enum {
+    PATTERN_RANDOM,
+    PATTERN_SMOOTH,
+    PATTERN_REPEAT,
+    PATTERN_CONSTANT,
+    NB_PATTERNS
+};
+
+static void fill(uint8_t *buf, int pattern, AVLFG *lfg)
+{
+    for (int y = 0; y < HEIGHT; y++) {
+        uint8_t *row = buf + y * LINESIZE;
+
+        for (int x = 0; x < WIDTH; x++) {
+            switch (pattern) {
+            case PATTERN_RANDOM:   row[x] = av_lfg_get(lfg);                   break;
+            case PATTERN_SMOOTH:   row[x] = (x * 3 + y * 5) >> 2;              break;
+            case PATTERN_REPEAT:   row[x] = "librempeg"[(x + y / 7) % 9];      break;
+            case PATTERN_CONSTANT: row[x] = 0x55;                              break;
+            }
+        }
+        /* sprinkle some noise over the structured patterns */
+        if (pattern != PATTERN_RANDOM && pattern != PATTERN_CONSTANT)
+            row[av_lfg_get(lfg) % WIDTH] = av_lfg_get(lfg);
+    }
+}
+
+static int check(DeflateContext *dc, InflateContext *ic, const uint8_t *src,
+                 uint8_t *out, uint8_t *cmp, int pattern, int level)
+{
+    const size_t bound = ff_deflate_bound(WIDTH * HEIGHT);
+    uint32_t adler = av_adler32_update(1, NULL, 0);
+    int len, ret;
+
+    dc->level = level;
+    len = ff_deflate(dc, out, bound, src, HEIGHT, WIDTH, LINESIZE);
+    if (len < 0 || len > bound) {
+        printf("pattern %d level %d: compression failed (%d)\n", pattern, level, len);
+        return 1;
+    }
+
+    /* into a contiguous output, decoded at once, and one with padded rows */
+    for (int stride = WIDTH; stride <= LINESIZE; stride += LINESIZE - WIDTH) {
+        memset(cmp, 0, LINESIZE * HEIGHT);
+        ret = ff_inflate(ic, out, len, cmp, HEIGHT, WIDTH, stride);
+        if (ret != len) {
+            printf("pattern %d level %d stride %d: decompression failed (%d)\n",
+                   pattern, level, stride, ret);
+            return 1;
+        }
+
+        for (int y = 0; y < HEIGHT; y++) {
+            if (memcmp(src + y * LINESIZE, cmp + y * stride, WIDTH)) {
+                printf("pattern %d level %d stride %d: mismatch in row %d\n",
+                       pattern, level, stride, y);
+                return 1;
+            }
+        }
+    }
+
+    for (int y = 0; y < HEIGHT; y++)
+        adler = av_adler32_update(adler, src + y * LINESIZE, WIDTH);
+
+    if (AV_RB32(out + len - 4) != adler) {
+        printf("pattern %d level %d: wrong checksum\n", pattern, level);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(void)
+{
+    DeflateContext *dc = av_mallocz(sizeof(*dc));
+    InflateContext *ic = av_mallocz(sizeof(*ic));
+    uint8_t *src = av_malloc(LINESIZE * HEIGHT);
+    uint8_t *out = av_malloc(ff_deflate_bound(WIDTH * HEIGHT));
+    uint8_t *cmp = av_malloc(LINESIZE * HEIGHT);
+    AVLFG lfg;
+    int ret = 0;
+
+    if (!dc || !ic || !src || !out || !cmp) {
+        ret = 1;
+        goto end;
+    }
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    for (int pattern = 0; pattern < NB_PATTERNS; pattern++) {
+        fill(src, pattern, &lfg);
+        for (int level = DEFLATE_LEVEL_LINES; level <= 9; level++)
+            ret |= check(dc, ic, src, out, cmp, pattern, level);
+    }
+
+end:
+    if (ic)
+        ff_inflate(ic, NULL, 0, NULL, 0, 0, 0);
+    av_free(dc);
+    av_free(ic);
+    av_free(src);
+    av_free(out);
+    av_free(cmp);
+    return ret;
+}
@@ -24,10 +24,9 @@
  * @author Konstantin Shishkov
  */
 
+#define CACHED_BITSTREAM_READER !ARCH_X86_32
+
 #include "config.h"
-#if CONFIG_ZLIB
-#include <zlib.h>
-#endif
 #if CONFIG_LZMA
 #define LZMA_API_STATIC
 #include <lzma.h>
@@ -55,6 +54,7 @@
 #include "mjpegdec.h"
 #include "thread.h"
 #include "get_bits.h"
+#include "inflate.h"
 
 typedef struct TiffContext {
     AVClass *class;
@@ -109,6 +109,7 @@ typedef struct TiffContext {
     int sot;
     int stripsizesoff, stripsize, stripoff, strippos;
     LZWState *lzw;
+    InflateContext ic;
 
     /* Tile support */
     int is_tiled;
@@ -494,36 +495,13 @@ static void unpack_yuv(TiffContext *s, AVFrame *p,
     }
 }
 
-#if CONFIG_ZLIB
-static int tiff_uncompress(uint8_t *dst, unsigned long *len, const uint8_t *src,
-                           int size)
-{
-    z_stream zstream = { 0 };
-    int zret;
-
-    zstream.next_in   = src;
-    zstream.avail_in  = size;
-    zstream.next_out  = dst;
-    zstream.avail_out = *len;
-    zret              = inflateInit(&zstream);
-    if (zret != Z_OK) {
-        av_log(NULL, AV_LOG_ERROR, "Inflate init error: %d\n", zret);
-        return zret;
-    }
-    zret = inflate(&zstream, Z_SYNC_FLUSH);
-    inflateEnd(&zstream);
-    *len = zstream.total_out;
-    return zret == Z_STREAM_END ? Z_OK : zret;
-}
-
 static int tiff_unpack_zlib(TiffContext *s, AVFrame *p, uint8_t *dst, int stride,
                             const uint8_t *src, int size, int width, int lines,
                             int strip_start, int is_yuv)
 {
+    const int outlen = width * lines;
     uint8_t *zbuf;
-    unsigned long outlen;
     int ret, line;
-    outlen = width * lines;
     zbuf   = av_malloc(outlen);
     if (!zbuf)
         return AVERROR(ENOMEM);
@@ -534,13 +512,13 @@ static int tiff_unpack_zlib(TiffContext *s, AVFrame *p, uint8_t *dst, int stride
         }
         src = s->deinvert_buf;
     }
-    ret = tiff_uncompress(zbuf, &outlen, src, size);
-    if (ret != Z_OK) {
+    ret = ff_inflate(&s->ic, src, size, zbuf, 1, outlen, outlen);
+    if (ret < 0) {
         av_log(s->avctx, AV_LOG_ERROR,
-               "Uncompressing failed (%lu of %lu) with error %d\n", outlen,
-               (unsigned long)width * lines, ret);
+               "Uncompressing failed (%d of %d) with error %d\n", s->ic.x,
+               outlen, ret);
         av_free(zbuf);
-        return AVERROR_UNKNOWN;
+        return ret;
     }
     src = zbuf;
     for (line = 0; line < lines; line++) {
@@ -559,7 +537,6 @@ static int tiff_unpack_zlib(TiffContext *s, AVFrame *p, uint8_t *dst, int stride
     av_free(zbuf);
     return 0;
 }
-#endif
 
 #if CONFIG_LZMA
 static int tiff_uncompress_lzma(uint8_t *dst, uint64_t *len, const uint8_t *src,
@@ -786,17 +763,9 @@ static int tiff_unpack_strip(TiffContext *s, AVFrame *p, uint8_t *dst, int strid
         stride = 0;
     }
 
-    if (s->compr == TIFF_DEFLATE || s->compr == TIFF_ADOBE_DEFLATE) {
-#if CONFIG_ZLIB
+    if (s->compr == TIFF_DEFLATE || s->compr == TIFF_ADOBE_DEFLATE)
         return tiff_unpack_zlib(s, p, dst, stride, src, size, width, lines,
                                 strip_start, is_yuv);
-#else
-        av_log(s->avctx, AV_LOG_ERROR,
-               "zlib support not enabled, "
-               "deflate compression not supported\n");
-        return AVERROR(ENOSYS);
-#endif
-    }
     if (s->compr == TIFF_LZMA) {
 #if CONFIG_LZMA
         return tiff_unpack_lzma(s, p, dst, stride, src, size, width, lines,
@@ -1365,12 +1334,7 @@ static int tiff_decode_tag(TiffContext *s, AVFrame *frame)
             break;
         case TIFF_DEFLATE:
         case TIFF_ADOBE_DEFLATE:
-#if CONFIG_ZLIB
             break;
-#else
-            av_log(s->avctx, AV_LOG_ERROR, "Deflate: ZLib not compiled in\n");
-            return AVERROR(ENOSYS);
-#endif
         case TIFF_JPEG:
         case TIFF_NEWJPEG:
             s->is_jpeg = 1;
@@ -2452,6 +2416,7 @@ static av_cold int tiff_end(AVCodecContext *avctx)
     free_geotags(s);
 
     ff_lzw_decode_close(&s->lzw);
+    ff_inflate(&s->ic, NULL, 0, NULL, 0, 0, 0);
     av_freep(&s->deinvert_buf);
     s->deinvert_buf_size = 0;
     av_freep(&s->yuv_line);
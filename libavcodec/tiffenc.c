@@ -37,6 +37,7 @@
 #include "avcodec.h"
 #include "bytestream.h"
 #include "codec_internal.h"
+#include "deflate.h"
 #include "encode.h"
 #include "lzw.h"
 #include "rle.h"
@@ -77,6 +78,8 @@ typedef struct TiffEncoderContext {
     uint16_t subsampling[2];                ///< YUV subsampling factors
     struct LZWEncodeState *lzws;            ///< LZW encode state
     uint32_t dpi;                           ///< image resolution in DPI
+    int deflate_impl;                       ///< DeflateImpl used for deflate compression
+    DeflateContext *dc;
 } TiffEncoderContext;
 
 /**
@@ -173,18 +176,25 @@ static int encode_strip(TiffEncoderContext *s, const int8_t *src,
                         uint8_t *dst, int n, int compr)
 {
     switch (compr) {
-#if CONFIG_ZLIB
     case TIFF_DEFLATE:
     case TIFF_ADOBE_DEFLATE:
     {
         unsigned long zlen = s->buf_size - (*s->buf - s->buf_start);
+        if (s->deflate_impl == DEFLATE_IMPL_LAVC) {
+            if (check_size(s, ff_deflate_bound(n)))
+                return AVERROR(EINVAL);
+            return ff_deflate(s->dc, dst, zlen, src, 1, n, n);
+        }
+#if CONFIG_ZLIB
         if (compress(dst, &zlen, src, n) != Z_OK) {
             av_log(s->avctx, AV_LOG_ERROR, "Compressing failed\n");
             return AVERROR_EXTERNAL;
         }
         return zlen;
-    }
+#else
+        return AVERROR(ENOSYS);
 #endif
+    }
     case TIFF_RAW:
         if (check_size(s, n))
             return AVERROR(EINVAL);
@@ -376,7 +386,6 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         }
     }
 
-#if CONFIG_ZLIB
     if (s->compr == TIFF_DEFLATE || s->compr == TIFF_ADOBE_DEFLATE) {
         uint8_t *zbuf;
         int zlen, zn;
@@ -408,9 +417,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         }
         ptr           += ret;
         s->strip_sizes[0] = ptr - pkt->data - s->strip_offsets[0];
-    } else
-#endif
-    {
+    } else {
     if (s->compr == TIFF_LZW) {
         s->lzws = av_malloc(ff_lzw_encode_state_size);
         if (!s->lzws) {
@@ -526,13 +533,20 @@ static av_cold int encode_init(AVCodecContext *avctx)
 {
     TiffEncoderContext *s = avctx->priv_data;
 
-#if !CONFIG_ZLIB
     if (s->compr == TIFF_DEFLATE) {
-        av_log(avctx, AV_LOG_ERROR,
-               "Deflate compression needs zlib compiled in\n");
-        return AVERROR(ENOSYS);
+        if (!CONFIG_ZLIB && s->deflate_impl == DEFLATE_IMPL_ZLIB) {
+            av_log(avctx, AV_LOG_ERROR,
+                   "Deflate compression with zlib needs zlib compiled in\n");
+            return AVERROR(ENOSYS);
+        }
+        if (s->deflate_impl == DEFLATE_IMPL_LAVC) {
+            s->dc = av_mallocz(sizeof(*s->dc));
+            if (!s->dc)
+                return AVERROR(ENOMEM);
+            s->dc->level = avctx->compression_level == FF_COMPRESSION_DEFAULT ?
+                           6 : av_clip(avctx->compression_level, 0, 9);
+        }
     }
-#endif
 
     s->avctx = avctx;
 
@@ -546,6 +560,7 @@ static av_cold int encode_close(AVCodecContext *avctx)
     av_freep(&s->strip_sizes);
     av_freep(&s->strip_offsets);
     av_freep(&s->yuv_line);
+    av_freep(&s->dc);
 
     return 0;
 }
@@ -559,6 +574,9 @@ static const AVOption options[] = {
     { "raw",              NULL, 0,             AV_OPT_TYPE_CONST, { .i64 = TIFF_RAW      }, 0,        0,            VE, .unit = "compression_algo" },
     { "lzw",              NULL, 0,             AV_OPT_TYPE_CONST, { .i64 = TIFF_LZW      }, 0,        0,            VE, .unit = "compression_algo" },
     { "deflate",          NULL, 0,             AV_OPT_TYPE_CONST, { .i64 = TIFF_DEFLATE  }, 0,        0,            VE, .unit = "compression_algo" },
+    { "deflate_impl", "set the deflate implementation", OFFSET(deflate_impl), AV_OPT_TYPE_INT, { .i64 = CONFIG_ZLIB ? DEFLATE_IMPL_ZLIB : DEFLATE_IMPL_LAVC }, DEFLATE_IMPL_ZLIB, DEFLATE_IMPL_LAVC, VE, .unit = "deflate_impl" },
+    { "zlib",             "system zlib",           0, AV_OPT_TYPE_CONST, { .i64 = DEFLATE_IMPL_ZLIB }, 0, 0, VE, .unit = "deflate_impl" },
+    { "lavc",             "built-in encoder",      0, AV_OPT_TYPE_CONST, { .i64 = DEFLATE_IMPL_LAVC }, 0, 0, VE, .unit = "deflate_impl" },
     { NULL },
 };
 
@@ -178,3 +178,120 @@ SCALARPRODUCT_LOOP 0
     HADDD   m6, m0
     movd   eax, m6
     RET
+
+; The AVX2 and AVX-512 versions use unaligned accesses for all vectors. order
+; is a multiple of 16, so the AVX-512 versions start with an odd half vector
+; if needed.
+
+%macro SCALARPRODUCT_AND_MADD_INT16 0
+; int ff_scalarproduct_and_madd_int16(int16_t *v1, int16_t *v2, int16_t *v3,
+;                                     int order, int mul)
+cglobal scalarproduct_and_madd_int16, 4,4,5, v1, v2, v3, order, mul
+    shl          orderd, 1
+    movd         xm3, mulm
+    vpbroadcastw m3, xm3
+    pxor         xm2, xm2
+    add          v1q, orderq
+    add          v2q, orderq
+    add          v3q, orderq
+    neg          orderq
+%if mmsize == 64
+    test         orderd, 32
+    jz .loop
+    movu         ym0, [v1q + orderq]
+    pmaddwd      ym1, ym0, [v2q + orderq]
+    pmullw       ym4, ym3, [v3q + orderq]
+    paddd        ym2, ym1
+    paddw        ym0, ym4
+    movu         [v1q + orderq], ym0
+    add          orderq, 32
+    jz .end
+%endif
+.loop:
+    movu         m0, [v1q + orderq]
+    pmaddwd      m1, m0, [v2q + orderq]
+    pmullw       m4, m3, [v3q + orderq]
+    paddd        m2, m1
+    paddw        m0, m4
+    movu         [v1q + orderq], m0
+    add          orderq, mmsize
+    jl .loop
+.end:
+%if mmsize == 64
+    vextracti64x4 ym1, m2, 1
+    paddd        ym2, ym1
+%endif
+    vextracti128 xm1, ym2, 1
+    paddd        xm2, xm1
+    movhlps      xm1, xm2
+    paddd        xm2, xm1
+    pshuflw      xm1, xm2, q0032
+    paddd        xm2, xm1
+    movd         eax, xm2
+    RET
+%endmacro
+
+%macro SCALARPRODUCT_AND_MADD_INT32 0
+; int ff_scalarproduct_and_madd_int32(int16_t *v1, int32_t *v2, int16_t *v3,
+;                                     int order, int mul)
+cglobal scalarproduct_and_madd_int32, 4,4,6, v1, v2, v3, order, mul
+    shl          orderd, 1
+    movd         xm5, mulm
+    vpbroadcastw m5, xm5
+    pxor         xm4, xm4
+    add          v1q, orderq
+    lea          v2q, [v2q + 2*orderq]
+    add          v3q, orderq
+    neg          orderq
+%if mmsize == 64
+    test         orderd, 32
+    jz .loop
+    pmovsxwd     m0, [v1q + orderq]
+    pmulld       m0, [v2q + 2*orderq]
+    movu         ym2, [v1q + orderq]
+    pmullw       ym3, ym5, [v3q + orderq]
+    paddd        m4, m0
+    paddw        ym2, ym3
+    movu         [v1q + orderq], ym2
+    add          orderq, 32
+    jz .end
+%endif
+.loop:
+    pmovsxwd     m0, [v1q + orderq]
+    pmovsxwd     m1, [v1q + orderq + mmsize/2]
+    pmulld       m0, [v2q + 2*orderq]
+    pmulld       m1, [v2q + 2*orderq + mmsize]
+    movu         m2, [v1q + orderq]
+    pmullw       m3, m5, [v3q + orderq]
+    paddd        m4, m0
+    paddd        m4, m1
+    paddw        m2, m3
+    movu         [v1q + orderq], m2
+    add          orderq, mmsize
+    jl .loop
+.end:
+%if mmsize == 64
+    vextracti64x4 ym1, m4, 1
+    paddd        ym4, ym1
+%endif
+    vextracti128 xm1, ym4, 1
+    paddd        xm4, xm1
+    movhlps      xm1, xm4
+    paddd        xm4, xm1
+    pshuflw      xm1, xm4, q0032
+    paddd        xm4, xm1
+    movd         eax, xm4
+    RET
+%endmacro
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+SCALARPRODUCT_AND_MADD_INT16
+SCALARPRODUCT_AND_MADD_INT32
+%endif
+
+%if HAVE_AVX512_EXTERNAL
+INIT_ZMM avx512
+SCALARPRODUCT_AND_MADD_INT16
+SCALARPRODUCT_AND_MADD_INT32
+%endif
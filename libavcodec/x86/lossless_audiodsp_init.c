@@ -31,6 +31,18 @@ int32_t ff_scalarproduct_and_madd_int16_ssse3(int16_t *v1, const int16_t *v2,
 int32_t ff_scalarproduct_and_madd_int32_sse4(int16_t *v1, const int32_t *v2,
                                              const int16_t *v3,
                                              int order, int mul);
+int32_t ff_scalarproduct_and_madd_int16_avx2(int16_t *v1, const int16_t *v2,
+                                             const int16_t *v3,
+                                             int order, int mul);
+int32_t ff_scalarproduct_and_madd_int32_avx2(int16_t *v1, const int32_t *v2,
+                                             const int16_t *v3,
+                                             int order, int mul);
+int32_t ff_scalarproduct_and_madd_int16_avx512(int16_t *v1, const int16_t *v2,
+                                               const int16_t *v3,
+                                               int order, int mul);
+int32_t ff_scalarproduct_and_madd_int32_avx512(int16_t *v1, const int32_t *v2,
+                                               const int16_t *v3,
+                                               int order, int mul);
 
 av_cold void ff_llauddsp_init_x86(LLAudDSPContext *c)
 {
@@ -46,5 +58,15 @@ av_cold void ff_llauddsp_init_x86(LLAudDSPContext *c)
 
     if (EXTERNAL_SSE4(cpu_flags))
         c->scalarproduct_and_madd_int32 = ff_scalarproduct_and_madd_int32_sse4;
+
+    if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+        c->scalarproduct_and_madd_int16 = ff_scalarproduct_and_madd_int16_avx2;
+        c->scalarproduct_and_madd_int32 = ff_scalarproduct_and_madd_int32_avx2;
+    }
+
+    if (EXTERNAL_AVX512(cpu_flags)) {
+        c->scalarproduct_and_madd_int16 = ff_scalarproduct_and_madd_int16_avx512;
+        c->scalarproduct_and_madd_int32 = ff_scalarproduct_and_madd_int32_avx512;
+    }
 #endif
 }
@@ -0,0 +1,1228 @@
+; /*
+; * Provide SIMD deblocking functions for VVC decoding
+; *
+; * This file is part of Librempeg.
+; *
+; * Librempeg is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU Lesser General Public
+; * License as published by the Free Software Foundation; either
+; * version 2.1 of the License, or (at your option) any later version.
+; *
+; * Librempeg is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; * Lesser General Public License for more details.
+; *
+; * You should have received a copy of the GNU Lesser General Public
+; * License along with Librempeg; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+; */
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA
+
+; pshufb masks broadcasting the first and the last line of each segment of
+; 4 lines, then of 2 lines, to the word lanes of the segment
+seg_shuf:     db 0, 1, 0, 1, 0, 1, 0, 1, 8, 9, 8, 9, 8, 9, 8, 9
+              db 6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15
+              db 0, 1, 0, 1, 4, 5, 4, 5, 8, 9, 8, 9, 12, 13, 12, 13
+              db 2, 3, 2, 3, 6, 7, 6, 7, 10, 11, 10, 11, 14, 15, 14, 15
+
+pw_7:         times 8 dw 7
+pw_10:        times 8 dw 10
+pw_9_m3:      times 4 dw 9, -3
+pd_8:         times 4 dd 8
+pw_pixel_max_12: times 8 dw ((1 << 12) - 1)
+
+; weights of p6 .. p0, q0 .. q6 in 16 * m of the long luma filters, for the
+; 9 combinations of the max filter lengths (3, 5, 7) of the p and the q side
+%macro LARGE_M 14
+%rep 14
+    times 4 dw %1
+    %rotate 1
+%endrep
+%endmacro
+
+large_m:
+    LARGE_M 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0 ; 3, 3 (unused)
+    LARGE_M 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0 ; 3, 5
+    LARGE_M 0, 0, 0, 0, 2, 3, 3, 2, 1, 1, 1, 1, 1, 1 ; 3, 7
+    LARGE_M 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0 ; 5, 3
+    LARGE_M 0, 0, 1, 1, 2, 2, 2, 2, 2, 2, 1, 1, 0, 0 ; 5, 5
+    LARGE_M 0, 1, 1, 1, 1, 2, 2, 2, 2, 1, 1, 1, 1, 0 ; 5, 7
+    LARGE_M 1, 1, 1, 1, 1, 1, 2, 3, 3, 2, 0, 0, 0, 0 ; 7, 3
+    LARGE_M 0, 1, 1, 1, 1, 2, 2, 2, 2, 1, 1, 1, 1, 0 ; 7, 5
+    LARGE_M 1, 1, 1, 1, 1, 1, 2, 2, 1, 1, 1, 1, 1, 1 ; 7, 7
+
+; per sample of one side of the long luma filters, for the max filter lengths
+; 3, 5 and 7: the weights of m and of the reference sample, and the tc multiplier
+%macro LARGE_SIDE 14
+%rep 7
+    dw %1, 64 - %1, 0, 0, %2, %2, %2, %2
+    %rotate 2
+%endrep
+%endmacro
+
+large_side:
+    LARGE_SIDE 53, 6, 32, 4, 11, 2,  0, 0,  0, 0,  0, 0, 0, 0
+    LARGE_SIDE 58, 6, 45, 5, 32, 4, 19, 3,  6, 2,  0, 0, 0, 0
+    LARGE_SIDE 59, 6, 50, 5, 41, 4, 32, 3, 23, 2, 14, 1, 5, 1
+
+cextern pw_1
+cextern pw_2
+cextern pw_3
+cextern pw_4
+cextern pw_5
+cextern pw_8
+cextern pw_255
+cextern pw_1023
+cextern pd_32
+
+%define pw_pixel_max_8  pw_255
+%define pw_pixel_max_10 pw_1023
+
+SECTION .text
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_XMM avx2
+
+; stack layout: the rows across the edge as 8 words, one per line along the
+; edge, from p7 to q7, the filtered rows, vectors and per segment scalars
+%define ROW(k)          [rsp + (k) * 16]
+%define ROWP(i)         ROW(7 - (i))
+%define ROWQ(i)         ROW(8 + (i))
+%define OUT(k)          [rsp + 256 + (k) * 16]
+%define OUTP(i)         OUT(7 - (i))
+%define OUTQ(i)         OUT(8 + (i))
+%define VAR(n)          [rsp + 512 + (n) * 16]
+%define SCAL            rsp + 800
+%define STACK_SIZE      832
+
+%define V_TC            VAR(0)
+%define V_BETA          VAR(1)
+%define V_MLP           VAR(2)
+%define V_MLQ           VAR(3)
+%define V_NOP           VAR(4)  ; lanes that may modify the p side
+%define V_NOQ           VAR(5)  ; lanes that may modify the q side
+%define V_ON            VAR(6)
+%define V_LARGE         VAR(7)
+%define V_STRONG        VAR(8)
+%define V_WEAK          VAR(9)
+%define V_NDP           VAR(10)
+%define V_NDQ           VAR(11)
+%define V_SH0           VAR(12)
+%define V_SH1           VAR(13)
+%define V_TC25          VAR(14)
+%define V_MLPE          VAR(15)
+%define V_MLQE          VAR(16)
+%define V_ONESIDE       VAR(17)
+
+; scalars: rows to store on the p side per segment, on the q side, then
+; for luma the p and q side lengths (0, 1, 2 for 3, 5, 7) of the long filters
+%define NP(s)           [SCAL + s]
+%define NQ(s)           [SCAL + 4 + s]
+%define IP(s)           [SCAL + 8 + s]
+%define IQ(s)           [SCAL + 10 + s]
+
+%macro BD_DEFINES 1
+%if %1 == 8
+    %define PS     1
+    %define TC_MIN 2 ; the smallest tc not rounded to 0
+%else
+    %define PS     2
+    %define TC_MIN 1
+%endif
+%define BD %1
+%define pw_pixel_max pw_pixel_max_ %+ %1
+%endmacro
+
+; %1 = sum of the first and the last line of each segment of %2
+%macro SEG_SUM 2
+    pshufb              m15, %2, V_SH0
+    pshufb               %1, %2, V_SH1
+    paddw                %1, m15
+%endmacro
+
+; %1 = lanes of the segments in which the first and the last line of %2 are set
+%macro SEG_ALL 2
+    pshufb              m15, %2, V_SH0
+    pshufb               %1, %2, V_SH1
+    pand                 %1, m15
+%endmacro
+
+; %1 = |%2 - %3|
+%macro ABSDIFF 3
+    mova                 %1, %2
+    psubw                %1, %3
+    pabsw                %1, %1
+%endmacro
+
+; %1 = |%2 - 2 * %3 + %4|
+%macro ABS2ND 4
+    mova                 %1, %3
+    paddw                %1, %1
+    mova               m15, %2
+    paddw              m15, %4
+    psubw              m15, %1
+    pabsw                %1, m15
+%endmacro
+
+; %1 = clamp(%1, %2 - %3, %2 + %3), %3 is a register, uses m15
+%macro CLAMP_TC 3
+    mova               m15, %2
+    paddw              m15, %3
+    pminsw               %1, m15
+    mova               m15, %2
+    psubw              m15, %3
+    pmaxsw               %1, m15
+%endmacro
+
+; %1 = %2 where %3 is set, uses m15
+%macro BLEND_OUT 3
+    mova               m15, %1
+    vpblendvb          m15, m15, %2, %3
+    mova                 %1, m15
+%endmacro
+
+; the 2 or 4 dwords at %2 as words repeated over the %3 lanes of each segment
+%macro SEG_DWORDS 3
+%if %3 == 4
+    movq                 %1, [%2]
+    packssdw             %1, %1
+    punpcklwd            %1, %1
+    punpckldq            %1, %1
+%else
+    movu                 %1, [%2]
+    packssdw             %1, %1
+    punpcklwd            %1, %1
+%endif
+%endmacro
+
+; the 2 or 4 bytes at %2 as words repeated over the %3 lanes of each segment
+; m14 must be zero
+%macro SEG_BYTES 3
+%if %3 == 4
+    movzx             cntd, word [%2]
+    movd                 %1, cntd
+    punpcklbw            %1, m14
+    punpcklwd            %1, %1
+    punpckldq            %1, %1
+%else
+    movd                 %1, [%2]
+    punpcklbw            %1, m14
+    punpcklwd            %1, %1
+%endif
+%endmacro
+
+; per segment vectors of segments of %1 lines, m14 must be zero
+%macro SEG_PARAMS 1
+    SEG_DWORDS           m0, tcq, %1
+%if BD == 8
+    paddw                m0, [pw_2]
+    psrlw                m0, 2
+%elif BD == 12
+    psllw                m0, 2
+%endif
+    mova               V_TC, m0
+    pcmpeqw              m1, m0, m14
+    pcmpeqw              m2, m2
+    pxor                 m1, m2
+    mova               V_ON, m1
+    pmullw               m2, m0, [pw_5]
+    paddw                m2, [pw_1]
+    psraw                m2, 1
+    mova             V_TC25, m2
+    SEG_DWORDS           m2, betaq, %1
+%if BD > 8
+    psllw                m2, BD - 8
+%endif
+    mova             V_BETA, m2
+    SEG_BYTES            m3, max_len_pq, %1
+    mova              V_MLP, m3
+    SEG_BYTES            m3, max_len_qq, %1
+    mova              V_MLQ, m3
+    SEG_BYTES            m3, no_pq, %1
+    pcmpeqw              m3, m14
+    pand                 m3, m1
+    mova              V_NOP, m3
+    SEG_BYTES            m3, no_qq, %1
+    pcmpeqw              m3, m14
+    pand                 m3, m1
+    mova              V_NOQ, m3
+%if %1 == 4
+    mova                 m3, [seg_shuf]
+    mova              V_SH0, m3
+    mova                 m3, [seg_shuf + 16]
+    mova              V_SH1, m3
+%else
+    mova                 m3, [seg_shuf + 32]
+    mova              V_SH0, m3
+    mova                 m3, [seg_shuf + 48]
+    mova              V_SH1, m3
+%endif
+%endmacro
+
+; load the %2 rows from ROW(%1) of a horizontal edge
+%macro LOAD_ROWS_H 2
+    imul               cntq, strideq, %1 - 8
+    add                cntq, pixq
+%assign k %1
+%rep %2
+%if PS == 1
+    pmovzxbw             m0, [cntq]
+%else
+    movu                 m0, [cntq]
+%endif
+    mova             ROW(k), m0
+    add                cntq, strideq
+%assign k k + 1
+%endrep
+%endmacro
+
+; load the columns p3 .. q3 of the 8 lines of a vertical edge, as rows
+%macro LOAD_COLS_V 0
+    lea                srcq, [pixq - 4 * PS]
+%if PS == 1
+    pmovzxbw             m0, [srcq]
+    pmovzxbw             m1, [srcq + strideq]
+    pmovzxbw             m2, [srcq + strideq * 2]
+    pmovzxbw             m3, [srcq + stride3q]
+    lea                srcq, [srcq + strideq * 4]
+    pmovzxbw             m4, [srcq]
+    pmovzxbw             m5, [srcq + strideq]
+    pmovzxbw             m6, [srcq + strideq * 2]
+    pmovzxbw             m7, [srcq + stride3q]
+%else
+    movu                 m0, [srcq]
+    movu                 m1, [srcq + strideq]
+    movu                 m2, [srcq + strideq * 2]
+    movu                 m3, [srcq + stride3q]
+    lea                srcq, [srcq + strideq * 4]
+    movu                 m4, [srcq]
+    movu                 m5, [srcq + strideq]
+    movu                 m6, [srcq + strideq * 2]
+    movu                 m7, [srcq + stride3q]
+%endif
+    TRANSPOSE8x8W         0, 1, 2, 3, 4, 5, 6, 7, 8
+%assign k 0
+%rep 8
+    mova         ROW(4 + k), m %+ k
+%assign k k + 1
+%endrep
+%endmacro
+
+; load the 4 p columns of the line at %2 into the low half of m%1 and the
+; 4 q columns into the high half
+%macro LOAD_OUTER_LINE 2
+%if PS == 1
+    movd                m%1, [tmpq + %2]
+    pinsrd              m%1, [dstq + %2], 1
+    pmovzxbw            m%1, m%1
+%else
+    movq                m%1, [tmpq + %2]
+    movhps              m%1, [dstq + %2]
+%endif
+%endmacro
+
+; load the columns p7 .. p4 and q4 .. q7 of the 8 lines of a vertical edge as
+; rows, the sides without long filter are read from the edge instead, as the
+; columns may be outside of the picture
+%macro LOAD_OUTER_COLS_V 0
+    mov                tmpq, pixq
+    lea                cntq, [pixq - 8 * PS]
+    cmp         word IP(0), 0
+    cmovne             tmpq, cntq
+    mov                dstq, pixq
+    lea                cntq, [pixq + 4 * PS]
+    cmp         word IQ(0), 0
+    cmovne             dstq, cntq
+    LOAD_OUTER_LINE       0, 0
+    LOAD_OUTER_LINE       1, strideq
+    LOAD_OUTER_LINE       2, strideq * 2
+    LOAD_OUTER_LINE       3, stride3q
+    lea                tmpq, [tmpq + strideq * 4]
+    lea                dstq, [dstq + strideq * 4]
+    LOAD_OUTER_LINE       4, 0
+    LOAD_OUTER_LINE       5, strideq
+    LOAD_OUTER_LINE       6, strideq * 2
+    LOAD_OUTER_LINE       7, stride3q
+    TRANSPOSE8x8W         0, 1, 2, 3, 4, 5, 6, 7, 8
+    mova             ROW(0), m0
+    mova             ROW(1), m1
+    mova             ROW(2), m2
+    mova             ROW(3), m3
+    mova            ROW(12), m4
+    mova            ROW(13), m5
+    mova            ROW(14), m6
+    mova            ROW(15), m7
+%endmacro
+
+; OUT = ROW for the rows p(%1 - 1) .. q(%1 - 1)
+%macro COPY_ROWS 1
+%assign k 8 - %1
+%rep 2 * %1
+    mova                 m0, ROW(k)
+    mova             OUT(k), m0
+%assign k k + 1
+%endrep
+%endmacro
+
+; store the %2 rows from OUT(%1) of a horizontal edge
+%macro STORE_ROWS_H 2
+    imul               srcq, strideq, %1 - 8
+    add                srcq, pixq
+%assign k %1
+%rep %2
+    mova                 m0, OUT(k)
+%if PS == 1
+    packuswb             m0, m0
+    movq             [srcq], m0
+%else
+    movu             [srcq], m0
+%endif
+    add                srcq, strideq
+%assign k k + 1
+%endrep
+%endmacro
+
+; store the 4 p columns of the line at %2 from the low half of m%1
+%macro STORE_OUTER 2
+%if PS == 1
+    movd         [srcq + %2], m%1
+%else
+    movq         [srcq + %2], m%1
+%endif
+%endmacro
+
+; store the 4 q columns of the line at %2 from the high half of m%1
+%macro STORE_OUTER_Q 2
+%if PS == 1
+    pextrd       [srcq + %2], m%1, 1
+%else
+    movhps       [srcq + %2], m%1
+%endif
+%endmacro
+
+; store the line at %2 of m%1, in 16-bit
+%macro STORE_LINE 2
+    movu         [srcq + %2], m%1
+%endmacro
+
+; store the columns p3 .. q3 of the 8 lines of a vertical edge and, with the
+; long filters of the luma (%1 == 8), the columns p7 .. p4 and q4 .. q7
+; the samples that are not filtered are written back unchanged, no other edge
+; modifies these columns
+%macro STORE_COLS_V 1
+    mova                 m0, OUT(4)
+    mova                 m1, OUT(5)
+    mova                 m2, OUT(6)
+    mova                 m3, OUT(7)
+    mova                 m4, OUT(8)
+    mova                 m5, OUT(9)
+    mova                 m6, OUT(10)
+    mova                 m7, OUT(11)
+    TRANSPOSE8x8W         0, 1, 2, 3, 4, 5, 6, 7, 8
+    lea                srcq, [pixq - 4 * PS]
+%if PS == 1
+    packuswb             m0, m1
+    packuswb             m2, m3
+    packuswb             m4, m5
+    packuswb             m6, m7
+    movq             [srcq], m0
+    movhps [srcq + strideq], m0
+    movq [srcq + strideq * 2], m2
+    movhps [srcq + stride3q], m2
+    lea                srcq, [srcq + strideq * 4]
+    movq             [srcq], m4
+    movhps [srcq + strideq], m4
+    movq [srcq + strideq * 2], m6
+    movhps [srcq + stride3q], m6
+%else
+    STORE_LINE            0, 0
+    STORE_LINE            1, strideq
+    STORE_LINE            2, strideq * 2
+    STORE_LINE            3, stride3q
+    lea                srcq, [srcq + strideq * 4]
+    STORE_LINE            4, 0
+    STORE_LINE            5, strideq
+    STORE_LINE            6, strideq * 2
+    STORE_LINE            7, stride3q
+%endif
+%if %1 == 8
+    cmp          dword IP(0), 0
+    je .stored
+    mova                 m0, OUT(0)
+    mova                 m1, OUT(1)
+    mova                 m2, OUT(2)
+    mova                 m3, OUT(3)
+    mova                 m4, OUT(12)
+    mova                 m5, OUT(13)
+    mova                 m6, OUT(14)
+    mova                 m7, OUT(15)
+    TRANSPOSE8x8W         0, 1, 2, 3, 4, 5, 6, 7, 8
+%if PS == 1
+%assign j 0
+%rep 8
+    packuswb        m %+ j, m %+ j
+%assign j j + 1
+%endrep
+%endif
+    cmp         word IP(0), 0
+    je .stored_p
+    lea                srcq, [pixq - 8 * PS]
+    STORE_OUTER           0, 0
+    STORE_OUTER           1, strideq
+    STORE_OUTER           2, strideq * 2
+    STORE_OUTER           3, stride3q
+    lea                srcq, [srcq + strideq * 4]
+    STORE_OUTER           4, 0
+    STORE_OUTER           5, strideq
+    STORE_OUTER           6, strideq * 2
+    STORE_OUTER           7, stride3q
+.stored_p:
+    cmp         word IQ(0), 0
+    je .stored
+    lea                srcq, [pixq + 4 * PS]
+    STORE_OUTER_Q         0, 0
+    STORE_OUTER_Q         1, strideq
+    STORE_OUTER_Q         2, strideq * 2
+    STORE_OUTER_Q         3, stride3q
+    lea                srcq, [srcq + strideq * 4]
+    STORE_OUTER_Q         4, 0
+    STORE_OUTER_Q         5, strideq
+    STORE_OUTER_Q         6, strideq * 2
+    STORE_OUTER_Q         7, stride3q
+.stored:
+%endif
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void ff_vvc_%1_loop_filter_luma_%2_avx2(uint8_t *pix, ptrdiff_t stride,
+;     const int32_t *beta, const int32_t *tc, const uint8_t *no_p, const uint8_t *no_q,
+;     const uint8_t *max_len_p, const uint8_t *max_len_q, int hor_ctu_edge)
+;-----------------------------------------------------------------------------
+%macro LOOP_FILTER_LUMA 2
+BD_DEFINES %2
+cglobal vvc_%1_loop_filter_luma_%2, 9, 15, 16, STACK_SIZE, pix, stride, beta, tc, no_p, no_q, max_len_p, max_len_q, hor, s, cnt, src, dst, tmp, stride3
+    ; per segment scalars
+    xor                  sd, sd
+.seg_loop:
+    movzx              srcd, byte [max_len_pq + sq]
+    movzx              dstd, byte [max_len_qq + sq]
+    ; lengths 3, 5, 7 of the long filters as 0, 1, 2
+    xor                tmpd, tmpd
+    test               hord, hord
+    jnz .ip_done
+    cmp                srcd, 3
+    jbe .ip_done
+    mov                tmpd, 1
+    cmp                srcd, 7
+    jne .ip_done
+    mov                tmpd, 2
+.ip_done:
+    mov              IP(sq), tmpb
+    xor            stride3d, stride3d
+    cmp                dstd, 3
+    jbe .iq_done
+    mov            stride3d, 1
+    cmp                dstd, 7
+    jne .iq_done
+    mov            stride3d, 2
+.iq_done:
+    mov              IQ(sq), stride3b
+    ; rows written by the filters: the length of a long filter, 3 if only the
+    ; other side is long, else up to 3
+    mov                cntd, 3
+    cmp                srcd, 3
+    cmova              srcd, cntd
+    cmp                dstd, 3
+    cmova              dstd, cntd
+    test           stride3d, stride3d
+    cmovnz             srcd, cntd
+    test               tmpd, tmpd
+    cmovnz             dstd, cntd
+    lea                cntd, [tmpq * 2 + 3]
+    test               tmpd, tmpd
+    cmovnz             srcd, cntd
+    lea                cntd, [stride3q * 2 + 3]
+    test           stride3d, stride3d
+    cmovnz             dstd, cntd
+    xor                tmpd, tmpd
+    cmp      dword [tcq + sq * 4], TC_MIN
+    cmovb              srcd, tmpd
+    cmovb              dstd, tmpd
+    cmp       byte [no_pq + sq], 0
+    cmovne             srcd, tmpd
+    cmp       byte [no_qq + sq], 0
+    cmovne             dstd, tmpd
+    mov              NP(sq), srcb
+    mov              NQ(sq), dstb
+    inc                  sd
+    cmp                  sd, 2
+    jl .seg_loop
+    movzx              cntd, word NP(0)
+    or                 cntw, word NQ(0)
+    jz .end
+
+    lea            stride3q, [strideq * 3]
+    ; p7 .. p4 and q4 .. q7 are only read for the long filters, the edges are
+    ; on a grid of 4 samples
+%ifidn %1, h
+    LOAD_ROWS_H           4, 8
+    cmp         word IP(0), 0
+    je .p_loaded
+    LOAD_ROWS_H           0, 4
+.p_loaded:
+    cmp         word IQ(0), 0
+    je .q_loaded
+    LOAD_ROWS_H          12, 4
+.q_loaded:
+%else
+    LOAD_COLS_V
+    LOAD_OUTER_COLS_V
+%endif
+
+    pxor                m14, m14
+    SEG_PARAMS            4
+
+    ; decisions
+    ABS2ND               m8, ROWP(2), ROWP(1), ROWP(0)      ; dp
+    ABS2ND               m9, ROWQ(2), ROWQ(1), ROWQ(0)      ; dq
+    movd                m13, hord
+    vpbroadcastw        m13, m13
+    pcmpeqw             m13, m14
+    mova                m10, V_MLP
+    pcmpgtw             m10, [pw_3]
+    pand                m10, m13                            ; large p
+    mova                m11, V_MLQ
+    pcmpgtw             m11, [pw_3]                         ; large q
+    por                 m12, m10, m11
+    mova                 m0, [pw_3]
+    vpblendvb            m1, m0, V_MLP, m10
+    mova                 m2, V_MLP
+    vpblendvb            m1, m2, m1, m12
+    mova             V_MLPE, m1
+    vpblendvb            m1, m0, V_MLQ, m11
+    mova                 m2, V_MLQ
+    vpblendvb            m1, m2, m1, m12
+    mova             V_MLQE, m1
+
+    pand                 m0, m12, V_ON
+    mova            V_LARGE, m0
+    ptest                m0, m0
+    jz .large_decided
+    ABS2ND               m1, ROWP(5), ROWP(4), ROWP(3)
+    pavgw                m1, m8
+    vpblendvb            m1, m8, m1, m10                    ; dpl
+    ABS2ND               m2, ROWQ(5), ROWQ(4), ROWQ(3)
+    pavgw                m2, m9
+    vpblendvb            m2, m9, m2, m11                    ; dql
+    paddw                m1, m2                             ; dl
+    SEG_SUM              m2, m1
+    mova                 m3, V_BETA
+    pcmpgtw              m2, m3, m2
+    pand                 m2, V_LARGE                        ; d0l + d3l < beta
+    paddw                m1, m1
+    psraw                m4, m3, 4
+    pcmpgtw              m4, m1                             ; 2 * dl < beta >> 4
+    ABSDIFF              m5, ROWP(0), ROWQ(0)
+    mova                 m6, V_TC25
+    pcmpgtw              m6, m5
+    pand                 m4, m6                             ; |p0 - q0| < tc25
+    ; sp
+    ABSDIFF              m5, ROWP(3), ROWP(0)
+    mova                 m6, ROWP(7)
+    psubw                m6, ROWP(6)
+    psubw                m6, ROWP(5)
+    paddw                m6, ROWP(4)
+    pabsw                m6, m6
+    mova                 m7, V_MLPE
+    pcmpeqw              m7, [pw_7]
+    pand                 m6, m7
+    paddw                m5, m6
+    mova                 m6, ROWP(5)
+    vpblendvb            m6, m6, ROWP(7), m7
+    psubw                m6, ROWP(3)
+    pabsw                m6, m6
+    pavgw                m6, m5
+    vpblendvb            m5, m5, m6, m10
+    ; sq
+    ABSDIFF              m6, ROWQ(3), ROWQ(0)
+    mova                 m7, ROWQ(7)
+    psubw                m7, ROWQ(6)
+    psubw                m7, ROWQ(5)
+    paddw                m7, ROWQ(4)
+    pabsw                m7, m7
+    mova                 m0, V_MLQE
+    pcmpeqw              m0, [pw_7]
+    pand                 m7, m0
+    paddw                m6, m7
+    mova                 m7, ROWQ(5)
+    vpblendvb            m7, m7, ROWQ(7), m0
+    psubw                m7, ROWQ(3)
+    pabsw                m7, m7
+    pavgw                m7, m6
+    vpblendvb            m6, m6, m7, m11
+    paddw                m5, m6
+    pmullw               m3, [pw_3]
+    psraw                m3, 5
+    pcmpgtw              m3, m5                             ; sp + sq < (beta * 3) >> 5
+    pand                 m4, m3
+    SEG_ALL              m3, m4
+    pand                 m2, m3
+    mova            V_LARGE, m2
+.large_decided:
+
+    paddw                m0, m8, m9                         ; d
+    SEG_SUM              m1, m0
+    mova                 m2, V_BETA
+    pcmpgtw              m1, m2, m1
+    pand                 m1, V_ON
+    mova                 m3, V_LARGE
+    pandn                m1, m3, m1                         ; normal filters
+    paddw                m0, m0
+    psraw                m3, m2, 2
+    pcmpgtw              m3, m0                             ; 2 * d < beta >> 2
+    ABSDIFF              m4, ROWP(3), ROWP(0)
+    ABSDIFF              m5, ROWQ(3), ROWQ(0)
+    paddw                m4, m5
+    psraw                m5, m2, 3
+    pcmpgtw              m5, m4
+    pand                 m3, m5                             ; |p3 - p0| + |q3 - q0| < beta >> 3
+    ABSDIFF              m4, ROWP(0), ROWQ(0)
+    mova                 m5, V_TC25
+    pcmpgtw              m5, m4
+    pand                 m3, m5                             ; |p0 - q0| < tc25
+    SEG_ALL              m4, m3
+    mova                 m5, V_MLPE
+    pcmpgtw              m5, [pw_2]
+    pand                 m4, m5
+    mova                 m5, V_MLQE
+    pcmpgtw              m5, [pw_2]
+    pand                 m4, m5
+    pand                 m5, m4, m1
+    mova           V_STRONG, m5
+    pandn                m4, m4, m1
+    mova             V_WEAK, m4
+    psraw                m3, m2, 1
+    paddw                m3, m2
+    psraw                m3, 3                              ; (beta + (beta >> 1)) >> 3
+    SEG_SUM              m4, m8
+    pcmpgtw              m5, m3, m4
+    SEG_SUM              m4, m9
+    pcmpgtw              m6, m3, m4
+    mova                 m4, V_MLPE
+    pcmpgtw              m4, [pw_1]
+    mova                 m7, V_MLQE
+    pcmpgtw              m7, [pw_1]
+    pand                 m4, m7
+    pand                 m5, m4
+    mova              V_NDP, m5
+    pand                 m6, m4
+    mova              V_NDQ, m6
+
+    COPY_ROWS             8
+
+    ; weak filter
+    mova                 m0, ROWQ(0)
+    psubw                m0, ROWP(0)
+    mova                 m1, ROWQ(1)
+    psubw                m1, ROWP(1)
+    punpcklwd            m2, m0, m1
+    punpckhwd            m0, m1
+    pmaddwd              m2, [pw_9_m3]
+    pmaddwd              m0, [pw_9_m3]
+    paddd                m2, [pd_8]
+    paddd                m0, [pd_8]
+    psrad                m2, 4
+    psrad                m0, 4
+    packssdw             m2, m0                             ; delta0
+    mova                 m3, V_TC
+    pmullw               m4, m3, [pw_10]
+    pabsw                m5, m2
+    pcmpgtw              m4, m5
+    pand                 m4, V_WEAK
+    psubw                m5, m14, m3
+    pminsw               m2, m3
+    pmaxsw               m2, m5
+    mova                 m0, ROWP(0)
+    paddw                m0, m2
+    CLIPW                m0, m14, [pw_pixel_max]
+    pand                 m6, m4, V_NOP
+    BLEND_OUT       OUTP(0), m0, m6
+    mova                 m0, ROWQ(0)
+    psubw                m0, m2
+    CLIPW                m0, m14, [pw_pixel_max]
+    pand                 m7, m4, V_NOQ
+    BLEND_OUT       OUTQ(0), m0, m7
+    psraw                m3, 1                              ; tc >> 1
+    psubw                m5, m14, m3
+    mova                 m0, ROWP(2)
+    pavgw                m0, ROWP(0)
+    psubw                m0, ROWP(1)
+    paddw                m0, m2
+    psraw                m0, 1
+    pminsw               m0, m3
+    pmaxsw               m0, m5
+    paddw                m0, ROWP(1)
+    CLIPW                m0, m14, [pw_pixel_max]
+    pand                 m6, V_NDP
+    BLEND_OUT       OUTP(1), m0, m6
+    mova                 m0, ROWQ(2)
+    pavgw                m0, ROWQ(0)
+    psubw                m0, ROWQ(1)
+    psubw                m0, m2
+    psraw                m0, 1
+    pminsw               m0, m3
+    pmaxsw               m0, m5
+    paddw                m0, ROWQ(1)
+    CLIPW                m0, m14, [pw_pixel_max]
+    pand                 m7, V_NDQ
+    BLEND_OUT       OUTQ(1), m0, m7
+
+    ; strong filter
+    mova                 m0, V_STRONG
+    ptest                m0, m0
+    jz .strong_done
+    pand                 m6, m0, V_NOP
+    pand                 m7, m0, V_NOQ
+    mova                 m1, V_TC
+    paddw                m2, m1, m1
+    paddw                m3, m2, m1
+    ; p0 = (p2 + 2 * p1 + 2 * p0 + 2 * q0 + q1 + 4) >> 3
+    mova                 m0, ROWP(1)
+    paddw                m0, ROWP(0)
+    paddw                m0, ROWQ(0)
+    paddw                m0, m0
+    paddw                m0, ROWP(2)
+    paddw                m0, ROWQ(1)
+    paddw                m0, [pw_4]
+    psrlw                m0, 3
+    CLAMP_TC             m0, ROWP(0), m3
+    BLEND_OUT       OUTP(0), m0, m6
+    ; q0 = (p1 + 2 * p0 + 2 * q0 + 2 * q1 + q2 + 4) >> 3
+    mova                 m0, ROWP(0)
+    paddw                m0, ROWQ(0)
+    paddw                m0, ROWQ(1)
+    paddw                m0, m0
+    paddw                m0, ROWP(1)
+    paddw                m0, ROWQ(2)
+    paddw                m0, [pw_4]
+    psrlw                m0, 3
+    CLAMP_TC             m0, ROWQ(0), m3
+    BLEND_OUT       OUTQ(0), m0, m7
+    ; p1 = (p2 + p1 + p0 + q0 + 2) >> 2
+    mova                 m4, ROWP(0)
+    paddw                m4, ROWQ(0)                        ; p0 + q0
+    paddw                m0, m4, ROWP(2)
+    paddw                m0, ROWP(1)
+    paddw                m0, [pw_2]
+    psrlw                m0, 2
+    CLAMP_TC             m0, ROWP(1), m2
+    BLEND_OUT       OUTP(1), m0, m6
+    ; q1 = (p0 + q0 + q1 + q2 + 2) >> 2
+    paddw                m0, m4, ROWQ(1)
+    paddw                m0, ROWQ(2)
+    paddw                m0, [pw_2]
+    psrlw                m0, 2
+    CLAMP_TC             m0, ROWQ(1), m2
+    BLEND_OUT       OUTQ(1), m0, m7
+    ; p2 = (2 * p3 + 3 * p2 + p1 + p0 + q0 + 4) >> 3
+    mova                 m0, ROWP(3)
+    paddw                m0, ROWP(2)
+    paddw                m0, m0
+    paddw                m0, ROWP(2)
+    paddw                m0, ROWP(1)
+    paddw                m0, m4
+    paddw                m0, [pw_4]
+    psrlw                m0, 3
+    CLAMP_TC             m0, ROWP(2), m1
+    BLEND_OUT       OUTP(2), m0, m6
+    ; q2 = (2 * q3 + 3 * q2 + q1 + q0 + p0 + 4) >> 3
+    mova                 m0, ROWQ(3)
+    paddw                m0, ROWQ(2)
+    paddw                m0, m0
+    paddw                m0, ROWQ(2)
+    paddw                m0, ROWQ(1)
+    paddw                m0, m4
+    paddw                m0, [pw_4]
+    psrlw                m0, 3
+    CLAMP_TC             m0, ROWQ(2), m1
+    BLEND_OUT       OUTQ(2), m0, m7
+.strong_done:
+
+    ; long filters
+    mova                 m0, V_LARGE
+    ptest                m0, m0
+    jz .large_done
+    DEFINE_ARGS pix, stride, tab, ip0, ip1, iq0, iq1, off0, off1, s, cnt, src, dst, tmp, stride3
+    movzx              ip0d, byte IP(0)
+    movzx              ip1d, byte IP(1)
+    movzx              iq0d, byte IQ(0)
+    movzx              iq1d, byte IQ(1)
+    lea               off0q, [ip0q * 3]
+    add               off0q, iq0q
+    imul              off0q, 14 * 8
+    lea               off1q, [ip1q * 3]
+    add               off1q, iq1q
+    imul              off1q, 14 * 8
+    lea                tabq, [large_m]
+    pxor                 m0, m0
+%assign k 0
+%rep 14
+    movq                 m1, [tabq + off0q + k * 8]
+    movhps               m1, [tabq + off1q + k * 8]
+    pmullw               m1, ROW(k + 1)
+    paddw                m0, m1
+%assign k k + 1
+%endrep
+    paddw                m0, [pw_8]
+    psrlw                m0, 4                              ; m
+    mova                 m4, V_TC
+    lea                tabq, [large_side]
+
+    ; p side, refp = (p(max_len_p) + p(max_len_p - 1) + 1) >> 1
+    imul              off0q, ip0q, -32
+    imul              off1q, ip1q, -32
+    movq                 m1, [rsp + off0q + 64]
+    movhps               m1, [rsp + off1q + 64 + 8]
+    movq                 m2, [rsp + off0q + 80]
+    movhps               m2, [rsp + off1q + 80 + 8]
+    pavgw                m1, m2
+    punpcklwd            m2, m0, m1
+    punpckhwd            m3, m0, m1
+    imul                ip0q, 7 * 16
+    imul                ip1q, 7 * 16
+    mova                 m5, V_LARGE
+    pand                 m5, V_NOP
+%assign i 0
+%rep 7
+    vpbroadcastd         m6, [tabq + ip0q + i * 16]
+    vpbroadcastd         m7, [tabq + ip1q + i * 16]
+    pmaddwd              m6, m2
+    pmaddwd              m7, m3
+    paddd                m6, [pd_32]
+    paddd                m7, [pd_32]
+    psrad                m6, 6
+    psrad                m7, 6
+    packssdw             m6, m7
+    movq                 m7, [tabq + ip0q + i * 16 + 8]
+    movhps               m7, [tabq + ip1q + i * 16 + 8]
+    pmullw               m7, m4
+    psrlw                m7, 1
+    CLAMP_TC             m6, ROWP(i), m7
+    BLEND_OUT       OUTP(i), m6, m5
+%assign i i + 1
+%endrep
+
+    ; q side, refq = (q(max_len_q) + q(max_len_q - 1) + 1) >> 1
+    imul              off0q, iq0q, 32
+    imul              off1q, iq1q, 32
+    movq                 m1, [rsp + off0q + 176]
+    movhps               m1, [rsp + off1q + 176 + 8]
+    movq                 m2, [rsp + off0q + 160]
+    movhps               m2, [rsp + off1q + 160 + 8]
+    pavgw                m1, m2
+    punpcklwd            m2, m0, m1
+    punpckhwd            m3, m0, m1
+    imul                iq0q, 7 * 16
+    imul                iq1q, 7 * 16
+    mova                 m5, V_LARGE
+    pand                 m5, V_NOQ
+%assign i 0
+%rep 7
+    vpbroadcastd         m6, [tabq + iq0q + i * 16]
+    vpbroadcastd         m7, [tabq + iq1q + i * 16]
+    pmaddwd              m6, m2
+    pmaddwd              m7, m3
+    paddd                m6, [pd_32]
+    paddd                m7, [pd_32]
+    psrad                m6, 6
+    psrad                m7, 6
+    packssdw             m6, m7
+    movq                 m7, [tabq + iq0q + i * 16 + 8]
+    movhps               m7, [tabq + iq1q + i * 16 + 8]
+    pmullw               m7, m4
+    psrlw                m7, 1
+    CLAMP_TC             m6, ROWQ(i), m7
+    BLEND_OUT       OUTQ(i), m6, m5
+%assign i i + 1
+%endrep
+.large_done:
+
+    DEFINE_ARGS pix, stride, beta, tc, no_p, no_q, max_len_p, max_len_q, hor, s, cnt, src, dst, tmp, stride3
+    ; whole rows, as for the columns in STORE_COLS_V
+%ifidn %1, h
+    STORE_ROWS_H          4, 8
+    cmp         word IP(0), 0
+    je .p_stored
+    STORE_ROWS_H          0, 4
+.p_stored:
+    cmp         word IQ(0), 0
+    je .end
+    STORE_ROWS_H         12, 4
+%else
+    STORE_COLS_V          8
+%endif
+.end:
+    RET
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void ff_vvc_%1_loop_filter_chroma_%2_avx2(uint8_t *pix, ptrdiff_t stride,
+;     const int32_t *beta, const int32_t *tc, const uint8_t *no_p, const uint8_t *no_q,
+;     const uint8_t *max_len_p, const uint8_t *max_len_q, int shift)
+;-----------------------------------------------------------------------------
+%macro LOOP_FILTER_CHROMA 2
+BD_DEFINES %2
+cglobal vvc_%1_loop_filter_chroma_%2, 9, 15, 16, STACK_SIZE, pix, stride, beta, tc, no_p, no_q, max_len_p, max_len_q, shift, s, cnt, src, dst, tmp, stride3
+    ; per segment scalars, the rows written by the filters
+    xor                  sd, sd
+.seg_loop:
+    movzx              srcd, byte [max_len_pq + sq]
+    movzx              dstd, byte [max_len_qq + sq]
+    xor                tmpd, tmpd
+    mov                cntd, 1
+    cmp                srcd, 3
+    cmovb              srcd, cntd
+    cmp                dstd, 3
+    cmovb              dstd, cntd
+    cmp  byte [max_len_pq + sq], 0
+    cmove              srcd, tmpd
+    cmove              dstd, tmpd
+    cmp  byte [max_len_qq + sq], 0
+    cmove              srcd, tmpd
+    cmove              dstd, tmpd
+    cmp      dword [tcq + sq * 4], TC_MIN
+    cmovb              srcd, tmpd
+    cmovb              dstd, tmpd
+    cmp       byte [no_pq + sq], 0
+    cmovne             srcd, tmpd
+    cmp       byte [no_qq + sq], 0
+    cmovne             dstd, tmpd
+    mov              NP(sq), srcb
+    mov              NQ(sq), dstb
+    inc                  sd
+    cmp                  sd, 4
+    jl .seg_loop
+    cmp          qword NP(0), 0
+    je .end
+
+    lea            stride3q, [strideq * 3]
+%ifidn %1, h
+    LOAD_ROWS_H           4, 8
+%else
+    LOAD_COLS_V
+%endif
+
+    pxor                m14, m14
+    test             shiftd, shiftd
+    jz .seg4
+    SEG_PARAMS            2
+    jmp .seg_done
+.seg4:
+    SEG_PARAMS            4
+.seg_done:
+
+    ; decisions, for the segments with a max filter length of 3 on the q side
+    mova                 m0, V_MLP
+    pcmpeqw              m0, [pw_1]
+    mova                 m1, ROWP(2)
+    vpblendvb            m1, m1, ROWP(1), m0                ; p2
+    mova                 m2, ROWP(3)
+    vpblendvb            m2, m2, ROWP(1), m0                ; p3
+    mova                 m3, ROWP(1)
+    paddw                m3, m3
+    paddw                m8, m1, ROWP(0)
+    psubw                m8, m3
+    pabsw                m8, m8                             ; dp
+    ABS2ND               m9, ROWQ(2), ROWQ(1), ROWQ(0)      ; dq
+    paddw                m8, m9                             ; d
+    SEG_SUM              m3, m8
+    mova                 m4, V_BETA
+    pcmpgtw              m3, m4, m3                         ; d0 + d1 < beta
+    paddw                m8, m8
+    psraw                m5, m4, 2
+    pcmpgtw              m5, m8                             ; 2 * d < beta >> 2
+    psubw                m2, ROWP(0)
+    pabsw                m2, m2
+    ABSDIFF              m6, ROWQ(0), ROWQ(3)
+    paddw                m2, m6
+    psraw                m6, m4, 3
+    pcmpgtw              m6, m2
+    pand                 m5, m6                             ; |p3 - p0| + |q0 - q3| < beta >> 3
+    ABSDIFF              m6, ROWP(0), ROWQ(0)
+    mova                 m7, V_TC25
+    pcmpgtw              m7, m6
+    pand                 m5, m7                             ; |p0 - q0| < tc25
+    SEG_ALL              m6, m5
+    pand                 m3, m6
+    mova                 m6, V_MLQ
+    pcmpeqw              m6, [pw_3]
+    pand                 m3, m6
+    mova                 m6, V_MLP
+    pcmpeqw              m6, m14
+    mova                 m7, V_MLQ
+    pcmpeqw              m7, m14
+    por                  m6, m7
+    pandn                m6, m6, V_ON                       ; tc && max_len_p && max_len_q
+    pand                 m3, m6                             ; keep the max filter lengths
+    mova                 m7, V_MLP
+    pcmpeqw              m7, [pw_3]
+    pand                 m7, m3
+    mova           V_STRONG, m7
+    pandn                m7, m7, m3
+    mova          V_ONESIDE, m7
+    pandn                m6, m3, m6
+    mova             V_WEAK, m6
+
+    COPY_ROWS             4
+
+    ; weak filter
+    mova                 m0, ROWQ(0)
+    psubw                m0, ROWP(0)
+    psllw                m0, 2
+    paddw                m0, ROWP(1)
+    psubw                m0, ROWQ(1)
+    paddw                m0, [pw_4]
+    psraw                m0, 3
+    mova                 m1, V_TC
+    psubw                m2, m14, m1
+    pminsw               m0, m1
+    pmaxsw               m0, m2                             ; delta0
+    mova                 m3, V_WEAK
+    mova                 m2, ROWP(0)
+    paddw                m2, m0
+    CLIPW                m2, m14, [pw_pixel_max]
+    pand                 m4, m3, V_NOP
+    BLEND_OUT       OUTP(0), m2, m4
+    mova                 m2, ROWQ(0)
+    psubw                m2, m0
+    CLIPW                m2, m14, [pw_pixel_max]
+    pand                 m4, m3, V_NOQ
+    BLEND_OUT       OUTQ(0), m2, m4
+
+    mova                 m6, V_STRONG
+    por                  m7, m6, V_ONESIDE
+    ptest                m7, m7
+    jz .strong_done
+    pand                 m6, V_NOP
+    mova                 m5, V_ONESIDE
+    pand                 m5, V_NOP
+    pand                 m7, V_NOQ
+    ; p0 = (p3 + p2 + p1 + 2 * p0 + q0 + q1 + q2 + 4) >> 3
+    mova                 m0, ROWP(0)
+    paddw                m0, m0
+    paddw                m0, ROWP(3)
+    paddw                m0, ROWP(2)
+    paddw                m0, ROWP(1)
+    paddw                m0, ROWQ(0)
+    paddw                m0, ROWQ(1)
+    paddw                m0, ROWQ(2)
+    paddw                m0, [pw_4]
+    psrlw                m0, 3
+    CLAMP_TC             m0, ROWP(0), m1
+    BLEND_OUT       OUTP(0), m0, m6
+    ; p0 = (3 * p1 + 2 * p0 + q0 + q1 + q2 + 4) >> 3 on one side
+    mova                 m0, ROWP(1)
+    paddw                m0, ROWP(0)
+    paddw                m0, m0
+    paddw                m0, ROWP(1)
+    paddw                m0, ROWQ(0)
+    paddw                m0, ROWQ(1)
+    paddw                m0, ROWQ(2)
+    paddw                m0, [pw_4]
+    psrlw                m0, 3
+    CLAMP_TC             m0, ROWP(0), m1
+    BLEND_OUT       OUTP(0), m0, m5
+    ; p1 = (2 * p3 + p2 + 2 * p1 + p0 + q0 + q1 + 4) >> 3
+    mova                 m0, ROWP(3)
+    paddw                m0, ROWP(1)
+    paddw                m0, m0
+    paddw                m0, ROWP(2)
+    paddw                m0, ROWP(0)
+    paddw                m0, ROWQ(0)
+    paddw                m0, ROWQ(1)
+    paddw                m0, [pw_4]
+    psrlw                m0, 3
+    CLAMP_TC             m0, ROWP(1), m1
+    BLEND_OUT       OUTP(1), m0, m6
+    ; p2 = (3 * p3 + 2 * p2 + p1 + p0 + q0 + 4) >> 3
+    mova                 m0, ROWP(3)
+    paddw                m0, ROWP(2)
+    paddw                m0, m0
+    paddw                m0, ROWP(3)
+    paddw                m0, ROWP(1)
+    paddw                m0, ROWP(0)
+    paddw                m0, ROWQ(0)
+    paddw                m0, [pw_4]
+    psrlw                m0, 3
+    CLAMP_TC             m0, ROWP(2), m1
+    BLEND_OUT       OUTP(2), m0, m6
+    ; q0 = (p2 + p1 + p0 + 2 * q0 + q1 + q2 + q3 + 4) >> 3, (2 * p1 + p0 + 2 * q0 + q1 + q2 + q3 + 4) >> 3 on one side
+    mova                 m0, ROWQ(0)
+    paddw                m0, m0
+    paddw                m0, ROWP(1)
+    paddw                m0, ROWP(0)
+    paddw                m0, ROWQ(1)
+    paddw                m0, ROWQ(2)
+    paddw                m0, ROWQ(3)
+    paddw                m0, [pw_4]
+    mova                 m3, V_ONESIDE
+    mova                 m2, ROWP(2)
+    vpblendvb            m2, m2, ROWP(1), m3
+    paddw                m0, m2
+    psrlw                m0, 3
+    CLAMP_TC             m0, ROWQ(0), m1
+    BLEND_OUT       OUTQ(0), m0, m7
+    ; q1 = (p1 + p0 + q0 + 2 * q1 + q2 + 2 * q3 + 4) >> 3
+    mova                 m0, ROWQ(1)
+    paddw                m0, ROWQ(3)
+    paddw                m0, m0
+    paddw                m0, ROWP(1)
+    paddw                m0, ROWP(0)
+    paddw                m0, ROWQ(0)
+    paddw                m0, ROWQ(2)
+    paddw                m0, [pw_4]
+    psrlw                m0, 3
+    CLAMP_TC             m0, ROWQ(1), m1
+    BLEND_OUT       OUTQ(1), m0, m7
+    ; q2 = (p0 + q0 + q1 + 2 * q2 + 3 * q3 + 4) >> 3
+    mova                 m0, ROWQ(2)
+    paddw                m0, ROWQ(3)
+    paddw                m0, m0
+    paddw                m0, ROWQ(3)
+    paddw                m0, ROWP(0)
+    paddw                m0, ROWQ(0)
+    paddw                m0, ROWQ(1)
+    paddw                m0, [pw_4]
+    psrlw                m0, 3
+    CLAMP_TC             m0, ROWQ(2), m1
+    BLEND_OUT       OUTQ(2), m0, m7
+.strong_done:
+
+%ifidn %1, h
+    STORE_ROWS_H          4, 8
+%else
+    STORE_COLS_V          4
+%endif
+.end:
+    RET
+%endmacro
+
+%macro LOOP_FILTER 1
+LOOP_FILTER_LUMA      h, %1
+LOOP_FILTER_LUMA      v, %1
+LOOP_FILTER_CHROMA    h, %1
+LOOP_FILTER_CHROMA    v, %1
+%endmacro
+
+LOOP_FILTER 8
+LOOP_FILTER 10
+LOOP_FILTER 12
+
+%endif
+%endif
@@ -27,7 +27,9 @@
 #include "libavutil/x86/cpu.h"
 #include "libavcodec/vvc/dec.h"
 #include "libavcodec/vvc/ctu.h"
+#include "libavcodec/vvc/data.h"
 #include "libavcodec/vvc/dsp.h"
+#include "libavcodec/vvc/intra.h"
 #include "libavcodec/x86/h26x/h2656dsp.h"
 
 #if ARCH_X86_64
@@ -76,6 +78,108 @@ OF_FUNC(10, avx2)
 OF_FUNC(12, avx2)
 
 #define OF_INIT(bd) c->inter.apply_bdof = vvc_apply_bdof_##bd##_avx2
+
+void ff_vvc_add_residual_8_avx2(uint8_t *dst, const int *res, int w, int h, ptrdiff_t stride);
+void ff_vvc_add_residual_16bpc_avx2(uint8_t *dst, const int *res, int w, int h, ptrdiff_t stride,
+                                    int pixel_max);
+
+#define ADD_RESIDUAL_FUNC(bd, opt)                                                                  \
+static void vvc_add_residual_##bd##_##opt(uint8_t *dst, const int *res,                             \
+    int w, int h, ptrdiff_t stride)                                                                 \
+{                                                                                                   \
+    ff_vvc_add_residual_16bpc_##opt(dst, res, w, h, stride, (1 << bd) - 1);                         \
+}                                                                                                   \
+
+ADD_RESIDUAL_FUNC(10, avx2)
+ADD_RESIDUAL_FUNC(12, avx2)
+
+#define ITX_PROTOTYPES(type, opt)                                                                   \
+void ff_vvc_inv_##type##_4_##opt(int *coeffs, ptrdiff_t stride, size_t nz);                         \
+void ff_vvc_inv_##type##_8_##opt(int *coeffs, ptrdiff_t stride, size_t nz);                         \
+void ff_vvc_inv_##type##_16_##opt(int *coeffs, ptrdiff_t stride, size_t nz);                        \
+void ff_vvc_inv_##type##_32_##opt(int *coeffs, ptrdiff_t stride, size_t nz);                        \
+
+ITX_PROTOTYPES(dst7, avx2)
+ITX_PROTOTYPES(dct8, avx2)
+void ff_vvc_inv_dct2_8_avx2(int *coeffs, ptrdiff_t stride, size_t nz);
+void ff_vvc_inv_dct2_16_avx2(int *coeffs, ptrdiff_t stride, size_t nz);
+void ff_vvc_inv_dct2_32_avx2(int *coeffs, ptrdiff_t stride, size_t nz);
+void ff_vvc_inv_dct2_64_avx2(int *coeffs, ptrdiff_t stride, size_t nz);
+
+#define ITX_TYPE_INIT(TYPE, type) do {                                     \
+    c->itx.itx[VVC_##TYPE][VVC_TX_SIZE_4]  = ff_vvc_inv_##type##_4_avx2;   \
+    c->itx.itx[VVC_##TYPE][VVC_TX_SIZE_8]  = ff_vvc_inv_##type##_8_avx2;   \
+    c->itx.itx[VVC_##TYPE][VVC_TX_SIZE_16] = ff_vvc_inv_##type##_16_avx2;  \
+    c->itx.itx[VVC_##TYPE][VVC_TX_SIZE_32] = ff_vvc_inv_##type##_32_avx2;  \
+} while (0)
+
+#define ITX_INIT(add_residual_fn) do {                                     \
+    c->itx.add_residual = add_residual_fn;                                 \
+    c->itx.itx[VVC_DCT2][VVC_TX_SIZE_8]  = ff_vvc_inv_dct2_8_avx2;         \
+    c->itx.itx[VVC_DCT2][VVC_TX_SIZE_16] = ff_vvc_inv_dct2_16_avx2;        \
+    c->itx.itx[VVC_DCT2][VVC_TX_SIZE_32] = ff_vvc_inv_dct2_32_avx2;        \
+    c->itx.itx[VVC_DCT2][VVC_TX_SIZE_64] = ff_vvc_inv_dct2_64_avx2;        \
+    ITX_TYPE_INIT(DST7, dst7);                                             \
+    ITX_TYPE_INIT(DCT8, dct8);                                             \
+} while (0)
+
+typedef struct VVCPDPCParams {
+    DECLARE_ALIGNED(32, int16_t, weight)[16];   ///< wl[x] << 9, 0 past the filtered columns
+    int32_t offset[16];                         ///< (256 + inv_angle * (x + 1)) >> 9
+} VVCPDPCParams;
+
+#define INTRA_BPC_PROTOTYPES(bpc, opt)                                                              \
+void BF(ff_vvc_pred_planar, bpc, opt)(uint8_t *src, const uint8_t *top, const uint8_t *left,        \
+    int w, int h, ptrdiff_t stride);                                                                \
+void BF(ff_vvc_pred_dc, bpc, opt)(uint8_t *src, const uint8_t *top, const uint8_t *left,            \
+    int w, int h, ptrdiff_t stride);                                                                \
+void BF(ff_vvc_pred_v, bpc, opt)(uint8_t *src, const uint8_t *top, int w, int h, ptrdiff_t stride); \
+void BF(ff_vvc_pred_h, bpc, opt)(uint8_t *src, const uint8_t *left, int w, int h, ptrdiff_t stride);\
+void BF(ff_vvc_pred_angular_v, bpc, opt)(uint8_t *src, const uint8_t *top, const uint8_t *left,     \
+    int w, int h, ptrdiff_t stride, const int8_t *filter, int angle, int pos,                       \
+    const VVCPDPCParams *pdpc, int pixel_max);                                                      \
+
+INTRA_BPC_PROTOTYPES( 8, avx2)
+INTRA_BPC_PROTOTYPES(16, avx2)
+
+static void vvc_pdpc_params_init(VVCPDPCParams *pdpc, const int w, const int h,
+    const int mode, const int intra_pred_angle)
+{
+    const int inv_angle = ff_vvc_intra_inv_angle_derive(intra_pred_angle);
+    const int nscale    = ff_vvc_nscale_derive(w, h, mode);
+    const int n         = FFMIN(w, 3 << nscale);
+
+    for (int x = 0; x < FF_ARRAY_ELEMS(pdpc->weight); x++) {
+        pdpc->weight[x] = x < n ? (32 >> ((x << 1) >> nscale)) << 9 : 0;
+        pdpc->offset[x] = x < n ? (256 + inv_angle * (x + 1)) >> 9 : 0;
+    }
+}
+
+#define PRED_ANGULAR_V_FUNC(bd, bpc, opt)                                                           \
+static void vvc_pred_angular_v_##bd##_##opt(uint8_t *src, const uint8_t *top, const uint8_t *left,  \
+    int w, int h, ptrdiff_t stride, int c_idx, int mode, int ref_idx, int filter_flag, int need_pdpc)\
+{                                                                                                   \
+    const int angle = ff_vvc_intra_pred_angle_derive(mode);                                         \
+    VVCPDPCParams pdpc;                                                                             \
+                                                                                                    \
+    if (need_pdpc)                                                                                  \
+        vvc_pdpc_params_init(&pdpc, w, h, mode, angle);                                             \
+    BF(ff_vvc_pred_angular_v, bpc, opt)(src, top, left, w, h, stride,                               \
+        c_idx ? NULL : ff_vvc_intra_luma_filter[filter_flag][0], angle, (1 + ref_idx) * angle,      \
+        need_pdpc ? &pdpc : NULL, (1 << bd) - 1);                                                   \
+}                                                                                                   \
+
+PRED_ANGULAR_V_FUNC( 8,  8, avx2)
+PRED_ANGULAR_V_FUNC(10, 16, avx2)
+PRED_ANGULAR_V_FUNC(12, 16, avx2)
+
+#define INTRA_INIT(bd, bpc) do {                                           \
+    c->intra.pred_planar    = BF(ff_vvc_pred_planar, bpc, avx2);           \
+    c->intra.pred_dc        = BF(ff_vvc_pred_dc, bpc, avx2);               \
+    c->intra.pred_v         = BF(ff_vvc_pred_v, bpc, avx2);                \
+    c->intra.pred_h         = BF(ff_vvc_pred_h, bpc, avx2);                \
+    c->intra.pred_angular_v = vvc_pred_angular_v_##bd##_avx2;              \
+} while (0)
 #endif
 
 #define ALF_BPC_PROTOTYPES(bpc, opt)                                                                                     \
@@ -93,6 +197,21 @@ void BF(ff_vvc_alf_classify, bpc, opt)(int *class_idx, int *transpose_idx, const
 ALF_BPC_PROTOTYPES(8,  avx2)
 ALF_BPC_PROTOTYPES(16, avx2)
 
+#define LF_PROTOTYPE(dir, type, bd, opt)                                                            \
+void bf(ff_vvc_##dir##_loop_filter_##type, bd, opt)(uint8_t *pix, ptrdiff_t stride,                 \
+    const int32_t *beta, const int32_t *tc, const uint8_t *no_p, const uint8_t *no_q,               \
+    const uint8_t *max_len_p, const uint8_t *max_len_q, int hor_ctu_edge_or_shift);
+
+#define LF_PROTOTYPES(bd, opt)                                                                      \
+    LF_PROTOTYPE(h, luma,   bd, opt)                                                                \
+    LF_PROTOTYPE(v, luma,   bd, opt)                                                                \
+    LF_PROTOTYPE(h, chroma, bd, opt)                                                                \
+    LF_PROTOTYPE(v, chroma, bd, opt)
+
+LF_PROTOTYPES( 8, avx2)
+LF_PROTOTYPES(10, avx2)
+LF_PROTOTYPES(12, avx2)
+
 #if ARCH_X86_64
 #define FW_PUT(name, depth, opt) \
 static void vvc_put_ ## name ## _ ## depth ## _##opt(int16_t *dst, const uint8_t *src, ptrdiff_t srcstride,    \
@@ -339,6 +458,13 @@ int ff_vvc_sad_avx2(const int16_t *src0, const int16_t *src1, int dx, int dy, in
     c->alf.classify       = vvc_alf_classify_##bd##_avx2;            \
 } while (0)
 
+#define LF_INIT(bd) do {                                              \
+    c->lf.filter_luma[0]   = ff_vvc_h_loop_filter_luma_##bd##_avx2;   \
+    c->lf.filter_luma[1]   = ff_vvc_v_loop_filter_luma_##bd##_avx2;   \
+    c->lf.filter_chroma[0] = ff_vvc_h_loop_filter_chroma_##bd##_avx2; \
+    c->lf.filter_chroma[1] = ff_vvc_v_loop_filter_chroma_##bd##_avx2; \
+} while (0)
+
 #endif
 
 
@@ -365,8 +491,15 @@ void ff_vvc_dsp_init_x86(VVCDSPContext *const c, const int bd)
             OF_INIT(8);
             SAD_INIT();
 
+            // itx
+            ITX_INIT(ff_vvc_add_residual_8_avx2);
+
+            // intra
+            INTRA_INIT(8, 8);
+
             // filter
             ALF_INIT(8);
+            LF_INIT(8);
             SAO_INIT(8, avx2);
         }
 #endif
@@ -387,8 +520,15 @@ void ff_vvc_dsp_init_x86(VVCDSPContext *const c, const int bd)
             OF_INIT(10);
             SAD_INIT();
 
+            // itx
+            ITX_INIT(vvc_add_residual_10_avx2);
+
+            // intra
+            INTRA_INIT(10, 16);
+
             // filter
             ALF_INIT(10);
+            LF_INIT(10);
             SAO_INIT(10, avx2);
         }
 #endif
@@ -409,8 +549,15 @@ void ff_vvc_dsp_init_x86(VVCDSPContext *const c, const int bd)
             OF_INIT(12);
             SAD_INIT();
 
+            // itx
+            ITX_INIT(vvc_add_residual_12_avx2);
+
+            // intra
+            INTRA_INIT(12, 16);
+
             // filter
             ALF_INIT(12);
+            LF_INIT(12);
             SAO_INIT(12, avx2);
         }
 #endif
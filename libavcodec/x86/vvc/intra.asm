@@ -0,0 +1,552 @@
+; /*
+; * Provide SIMD intra prediction functions for VVC decoding
+; *
+; * This file is part of Librempeg.
+; *
+; * Librempeg is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU Lesser General Public
+; * License as published by the Free Software Foundation; either
+; * version 2.1 of the License, or (at your option) any later version.
+; *
+; * Librempeg is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; * Lesser General Public License for more details.
+; *
+; * You should have received a copy of the GNU Lesser General Public
+; * License along with Librempeg; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+; */
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+pd_0to7:      dd 0, 1, 2, 3, 4, 5, 6, 7
+pd_0xff:      times 8 dd 0xff
+pd_0xffff:    times 8 dd 0xffff
+
+; ((32 - f) * p[1] + f * p[2] + 16) >> 5 of the chroma angular prediction,
+; with doubled weights to share the rounding of the 4-tap luma filters
+chroma_filter:
+%assign f 0
+%rep 32
+    db 0, 64 - 2 * f, 2 * f, 0
+    %assign f f + 1
+%endrep
+
+cextern pw_1
+cextern pd_32
+
+SECTION .text
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_YMM avx2
+
+%macro BPC_DEFINES 1
+%if %1 == 8
+    %define PS 1
+    %define PX byte
+    %define VPBROADCASTPX vpbroadcastb
+    %define PMOVZXPD pmovzxbd
+    %define PD_MASK pd_0xff
+%else
+    %define PS 2
+    %define PX word
+    %define VPBROADCASTPX vpbroadcastw
+    %define PMOVZXPD pmovzxwd
+    %define PD_MASK pd_0xffff
+%endif
+%endmacro
+
+; store the first wd bytes of m0-m3, 4 to 128, to hd rows
+%macro STORE_ROWS 0
+    cmp                  wd, 16
+    jg .w32
+    je .w16
+    cmp                  wd, 8
+    je .w8
+.w4:
+    movd           [srcq], xm0
+    add                srcq, strideq
+    dec                  hd
+    jg .w4
+    RET
+.w8:
+    movq           [srcq], xm0
+    add                srcq, strideq
+    dec                  hd
+    jg .w8
+    RET
+.w16:
+    movu           [srcq], xm0
+    add                srcq, strideq
+    dec                  hd
+    jg .w16
+    RET
+.w32:
+    cmp                  wd, 64
+    jg .w128
+    je .w64
+.w32_loop:
+    movu           [srcq], m0
+    add                srcq, strideq
+    dec                  hd
+    jg .w32_loop
+    RET
+.w64:
+    movu           [srcq], m0
+    movu      [srcq + 32], m1
+    add                srcq, strideq
+    dec                  hd
+    jg .w64
+    RET
+.w128:
+    movu           [srcq], m0
+    movu      [srcq + 32], m1
+    movu      [srcq + 64], m2
+    movu      [srcq + 96], m3
+    add                srcq, strideq
+    dec                  hd
+    jg .w128
+    RET
+%endmacro
+
+; the strides of the prediction functions are in pixels, as in the C functions
+
+; void ff_vvc_pred_v_%1bpc_avx2(uint8_t *src, const uint8_t *top, int w, int h, ptrdiff_t stride)
+%macro PRED_V 1
+cglobal vvc_pred_v_%1bpc, 5, 5, 4, src, top, w, h, stride
+%if %1 == 16
+    add                  wd, wd
+    add             strideq, strideq
+%endif
+    movu                 m0, [topq]
+    movu                 m1, [topq + 32]
+    movu                 m2, [topq + 64]
+    movu                 m3, [topq + 96]
+    STORE_ROWS
+%endmacro
+
+; void ff_vvc_pred_h_%1bpc_avx2(uint8_t *src, const uint8_t *left, int w, int h, ptrdiff_t stride)
+%macro PRED_H 1
+BPC_DEFINES %1
+cglobal vvc_pred_h_%1bpc, 5, 5, 1, src, left, w, h, stride
+%if %1 == 16
+    add                  wd, wd
+    add             strideq, strideq
+%endif
+    cmp                  wd, 16
+    jg .w32
+    je .w16
+    cmp                  wd, 8
+    je .w8
+.w4:
+    VPBROADCASTPX       xm0, [leftq]
+    movd           [srcq], xm0
+    add               leftq, PS
+    add                srcq, strideq
+    dec                  hd
+    jg .w4
+    RET
+.w8:
+    VPBROADCASTPX       xm0, [leftq]
+    movq           [srcq], xm0
+    add               leftq, PS
+    add                srcq, strideq
+    dec                  hd
+    jg .w8
+    RET
+.w16:
+    VPBROADCASTPX       xm0, [leftq]
+    movu           [srcq], xm0
+    add               leftq, PS
+    add                srcq, strideq
+    dec                  hd
+    jg .w16
+    RET
+.w32:
+    cmp                  wd, 64
+    jg .w128
+    je .w64
+.w32_loop:
+    VPBROADCASTPX        m0, [leftq]
+    movu           [srcq], m0
+    add               leftq, PS
+    add                srcq, strideq
+    dec                  hd
+    jg .w32_loop
+    RET
+.w64:
+    VPBROADCASTPX        m0, [leftq]
+    movu           [srcq], m0
+    movu      [srcq + 32], m0
+    add               leftq, PS
+    add                srcq, strideq
+    dec                  hd
+    jg .w64
+    RET
+.w128:
+    VPBROADCASTPX        m0, [leftq]
+    movu           [srcq], m0
+    movu      [srcq + 32], m0
+    movu      [srcq + 64], m0
+    movu      [srcq + 96], m0
+    add               leftq, PS
+    add                srcq, strideq
+    dec                  hd
+    jg .w128
+    RET
+%endmacro
+
+; add the sum of the cntd pixels at %1, 4 to 64, to the dwords of xm3
+; xm4 must be zero
+%macro SUM_EDGE 1
+%if PS == 2
+    add                cntd, cntd
+%endif
+    cmp                cntd, 8
+    jg %%loop_init
+    je %%b8
+    movd                xm0, [%1]
+    jmp %%last
+%%b8:
+    movq                xm0, [%1]
+    jmp %%last
+%%loop_init:
+    xor                  iq, iq
+%%loop:
+    movu                xm0, [%1 + iq]
+%if PS == 1
+    psadbw              xm0, xm4
+%else
+    pmaddwd             xm0, [pw_1]
+%endif
+    paddd               xm3, xm0
+    add                  iq, 16
+    cmp                  id, cntd
+    jl %%loop
+    jmp %%done
+%%last:
+%if PS == 1
+    psadbw              xm0, xm4
+%else
+    pmaddwd             xm0, [pw_1]
+%endif
+    paddd               xm3, xm0
+%%done:
+%endmacro
+
+; void ff_vvc_pred_dc_%1bpc_avx2(uint8_t *src, const uint8_t *top, const uint8_t *left,
+;     int w, int h, ptrdiff_t stride)
+%macro PRED_DC 1
+BPC_DEFINES %1
+cglobal vvc_pred_dc_%1bpc, 6, 9, 5, src, top, left, w, h, stride, cnt, i, tmp
+%if PS == 2
+    add             strideq, strideq
+%endif
+    pxor                xm3, xm3
+    pxor                xm4, xm4
+    cmp                  wd, hd
+    jl .left
+    mov                cntd, wd
+    SUM_EDGE           topq
+    cmp                  wd, hd
+    jg .sum_done
+.left:
+    mov                cntd, hd
+    SUM_EDGE          leftq
+.sum_done:
+    ; dc = (sum + offset / 2) >> log2(offset), offset = w == h ? 2 * w : max(w, h)
+    mov                tmpd, wd
+    cmp                  wd, hd
+    cmovl              tmpd, hd
+    lea                cntd, [tmpq * 2]
+    cmove              tmpd, cntd
+    bsf                cntd, tmpd
+    shr                tmpd, 1
+    pshufd              xm0, xm3, q1032
+    paddd               xm3, xm0
+    pshufd              xm0, xm3, q2301
+    paddd               xm3, xm0
+    movd                xm0, tmpd
+    paddd               xm3, xm0
+    movd                xm0, cntd
+    psrld               xm3, xm0
+    VPBROADCASTPX        m0, xm3
+    mova                 m1, m0
+    mova                 m2, m0
+    mova                 m3, m0
+%if %1 == 16
+    add                  wd, wd
+%endif
+    STORE_ROWS
+%endmacro
+
+; one row of 8 planar predictions at dstq, from the dwords of m0
+%macro PLANAR_STORE 1 ; w == 4
+    vextracti128        xm1, m0, 1
+    packusdw            xm0, xm1
+%if PS == 1
+    packuswb            xm0, xm0
+%if %1
+    movd           [dstq], xm0
+%else
+    movq           [dstq], xm0
+%endif
+%else
+%if %1
+    movq           [dstq], xm0
+%else
+    movu           [dstq], xm0
+%endif
+%endif
+%endmacro
+
+; pred[x, y] = (((h - 1 - y) * top[x] + (y + 1) * left[h]) << log2(w) +
+;               ((w - 1 - x) * left[y] + (x + 1) * top[w]) << log2(h) + w * h) >> (log2(w) + log2(h) + 1)
+; computed 8 columns at a time, with the vertical term updated row by row
+; void ff_vvc_pred_planar_%1bpc_avx2(uint8_t *src, const uint8_t *top, const uint8_t *left,
+;     int w, int h, ptrdiff_t stride)
+%macro PRED_PLANAR 1
+BPC_DEFINES %1
+cglobal vvc_pred_planar_%1bpc, 6, 11, 14, src, top, left, w, h, stride, x, y, dst, tmp, tmp2
+%if PS == 2
+    add             strideq, strideq
+%endif
+    movsxdifnidn         wq, wd
+    movsxdifnidn         hq, hd
+    bsf                tmpd, wd
+    bsf               tmp2d, hd
+    movd                xm6, tmpd
+    movd                xm7, tmp2d
+    lea                tmpd, [tmpq + tmp2q + 1]
+    movd                xm8, tmpd
+    movzx              tmpd, PX [leftq + hq * PS]
+    movd               xm10, tmpd
+    vpbroadcastd        m10, xm10
+    movzx              tmpd, PX [topq + wq * PS]
+    movd               xm11, tmpd
+    vpbroadcastd        m11, xm11
+    mov                tmpd, wd
+    imul               tmpd, hd
+    movd               xm12, tmpd
+    vpbroadcastd        m12, xm12
+    lea                tmpd, [hq - 1]
+    movd               xm13, tmpd
+    vpbroadcastd        m13, xm13
+    mova                 m9, [pd_0to7]
+    xor                  xq, xq
+.col:
+    PMOVZXPD             m0, [topq + xq * PS]
+    pmulld               m4, m0, m13
+    paddd                m4, m10
+    pslld                m4, xm6
+    psubd                m5, m10, m0
+    pslld                m5, xm6
+    lea                tmpd, [wq - 1]
+    sub                tmpd, xd
+    movd                xm2, tmpd
+    vpbroadcastd         m2, xm2
+    psubd                m2, m9
+    pslld                m2, xm7
+    lea                tmpd, [xq + 1]
+    movd                xm3, tmpd
+    vpbroadcastd         m3, xm3
+    paddd                m3, m9
+    pmulld               m3, m11
+    pslld                m3, xm7
+    paddd                m3, m12
+    lea                dstq, [srcq + xq * PS]
+    xor                  yq, yq
+.row:
+    movzx              tmpd, PX [leftq + yq * PS]
+    movd                xm0, tmpd
+    vpbroadcastd         m0, xm0
+    pmulld               m0, m2
+    paddd                m0, m3
+    paddd                m0, m4
+    psrld                m0, xm8
+    paddd                m4, m5
+    cmp                  wd, 4
+    je .w4
+    PLANAR_STORE          0
+    jmp .next
+.w4:
+    PLANAR_STORE          1
+.next:
+    add                dstq, strideq
+    inc                  yd
+    cmp                  yd, hd
+    jl .row
+    add                  xd, 8
+    cmp                  xd, wd
+    jl .col
+    RET
+%endmacro
+
+; filter 8 (%1 == xm) or 16 (%1 == m) pixels at column colq of the reference row pq
+; into the words of %1 0, with the taps (f0, f1) in m14 and (f2, f3) in m15
+%macro ANGULAR_FILTER 1
+%if PS == 1
+    pmovzxbw        %1 %+ 0, [pq + colq]
+    pmovzxbw        %1 %+ 1, [pq + colq + 1]
+    pmovzxbw        %1 %+ 2, [pq + colq + 2]
+    pmovzxbw        %1 %+ 3, [pq + colq + 3]
+%else
+    movu            %1 %+ 0, [pq + colq * 2]
+    movu            %1 %+ 1, [pq + colq * 2 + 2]
+    movu            %1 %+ 2, [pq + colq * 2 + 4]
+    movu            %1 %+ 3, [pq + colq * 2 + 6]
+%endif
+    punpckhwd       %1 %+ 4, %1 %+ 0, %1 %+ 1
+    punpcklwd       %1 %+ 0, %1 %+ 1
+    punpckhwd       %1 %+ 5, %1 %+ 2, %1 %+ 3
+    punpcklwd       %1 %+ 2, %1 %+ 3
+    pmaddwd         %1 %+ 0, %1 %+ 14
+    pmaddwd         %1 %+ 4, %1 %+ 14
+    pmaddwd         %1 %+ 2, %1 %+ 15
+    pmaddwd         %1 %+ 5, %1 %+ 15
+    paddd           %1 %+ 0, %1 %+ 2
+    paddd           %1 %+ 4, %1 %+ 5
+    paddd           %1 %+ 0, %1 %+ 13
+    paddd           %1 %+ 4, %1 %+ 13
+    psrad           %1 %+ 0, 6
+    psrad           %1 %+ 4, 6
+    packusdw        %1 %+ 0, %1 %+ 4
+    pminuw          %1 %+ 0, %1 %+ 12
+%endmacro
+
+; pred += ((left[y + offset[x]] - pred) * weight[x] + 32) >> 6 on the words of %1 0,
+; with weight[x] << 9 in m9, and the offsets in m8 for the xm version or in m10
+; and m11, ordered for packusdw, for the m version
+%macro ANGULAR_PDPC 1
+    pcmpeqd              m7, m7
+%ifidn %1, xm
+    vpgatherdd           m5, [leftq + m8 * PS], m7
+    pand                 m5, [PD_MASK]
+    vextracti128        xm6, m5, 1
+    packusdw            xm5, xm6
+%else
+    vpgatherdd           m5, [leftq + m10 * PS], m7
+    pcmpeqd              m7, m7
+    vpgatherdd           m6, [leftq + m11 * PS], m7
+    pand                 m5, [PD_MASK]
+    pand                 m6, [PD_MASK]
+    packusdw             m5, m6
+%endif
+    psubw           %1 %+ 5, %1 %+ 0
+    pmulhrsw        %1 %+ 5, %1 %+ 9
+    paddw           %1 %+ 0, %1 %+ 5
+%endmacro
+
+; store the 16 words of m0 at column colq
+%macro ANGULAR_STORE16 0
+%if PS == 1
+    vextracti128        xm1, m0, 1
+    packuswb            xm0, xm1
+    movu      [srcq + colq], xm0
+%else
+    movu  [srcq + colq * 2], m0
+%endif
+%endmacro
+
+; void ff_vvc_pred_angular_v_%1bpc_avx2(uint8_t *src, const uint8_t *top, const uint8_t *left,
+;     int w, int h, ptrdiff_t stride, const int8_t *filter, int angle, int pos,
+;     const VVCPDPCParams *pdpc, int pixel_max)
+%macro PRED_ANGULAR_V 1
+BPC_DEFINES %1
+cglobal vvc_pred_angular_v_%1bpc, 11, 14, 16, src, top, left, w, h, stride, filter, angle, pos, pdpc, pixel_max, p, col, tmp
+%if PS == 2
+    add             strideq, strideq
+%endif
+    movd               xm12, pixel_maxd
+    vpbroadcastw        m12, xm12
+    vpbroadcastd        m13, [pd_32]
+    test            filterq, filterq
+    jnz .luma
+    lea             filterq, [chroma_filter]
+.luma:
+    test              pdpcq, pdpcq
+    jz .row
+    movu                 m9, [pdpcq]
+    movu                 m8, [pdpcq + 32]
+    movu                 m0, [pdpcq + 64]
+    vperm2i128          m10, m8, m0, 0x20
+    vperm2i128          m11, m8, m0, 0x31
+.row:
+    movsxd             tmpq, posd
+    sar                tmpq, 5
+    lea                  pq, [topq + tmpq * PS - PS]
+    mov                tmpd, posd
+    and                tmpd, 31
+    movd                xm0, [filterq + tmpq * 4]
+    pmovsxbw            xm0, xm0
+    vpbroadcastd        m14, xm0
+    pshufd              xm0, xm0, q1111
+    vpbroadcastd        m15, xm0
+    xor                  colq, colq
+    cmp                  wd, 8
+    jg .w16
+    ANGULAR_FILTER       xm
+    test              pdpcq, pdpcq
+    jz .w8_store
+    ANGULAR_PDPC         xm
+.w8_store:
+%if PS == 1
+    packuswb            xm0, xm0
+    cmp                  wd, 4
+    je .w4_store
+    movq           [srcq], xm0
+    jmp .next
+.w4_store:
+    movd           [srcq], xm0
+%else
+    cmp                  wd, 4
+    je .w4_store
+    movu           [srcq], xm0
+    jmp .next
+.w4_store:
+    movq           [srcq], xm0
+%endif
+    jmp .next
+.w16:
+    ANGULAR_FILTER        m
+    test              pdpcq, pdpcq
+    jz .w16_store
+    ANGULAR_PDPC          m
+.w16_store:
+    ANGULAR_STORE16
+    add                  cold, 16
+    cmp                  cold, wd
+    jge .next
+.w16_loop:
+    ANGULAR_FILTER        m
+    ANGULAR_STORE16
+    add                  cold, 16
+    cmp                  cold, wd
+    jl .w16_loop
+.next:
+    add                srcq, strideq
+    add               leftq, PS
+    add                posd, angled
+    dec                  hd
+    jg .row
+    RET
+%endmacro
+
+PRED_V                8
+PRED_V               16
+PRED_H                8
+PRED_H               16
+PRED_DC               8
+PRED_DC              16
+PRED_PLANAR           8
+PRED_PLANAR          16
+PRED_ANGULAR_V        8
+PRED_ANGULAR_V       16
+
+%endif
+%endif
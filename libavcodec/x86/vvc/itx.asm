@@ -0,0 +1,499 @@
+; /*
+; * Provide SIMD inverse transform functions for VVC decoding
+; *
+; * This file is part of Librempeg.
+; *
+; * Librempeg is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU Lesser General Public
+; * License as published by the Free Software Foundation; either
+; * version 2.1 of the License, or (at your option) any later version.
+; *
+; * Librempeg is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; * Lesser General Public License for more details.
+; *
+; * You should have received a copy of the GNU Lesser General Public
+; * License along with Librempeg; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+; */
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+reverse_d: dd 7, 6, 5, 4, 3, 2, 1, 0
+
+; left halves of the DCT-2 matrices, row j holds the weights of input j for
+; the first size / 2 outputs. The even rows are symmetric and the odd ones
+; antisymmetric, which gives the right halves. Only the first 32 inputs of
+; the 64-point transform can be non-zero, so it has 32 rows.
+vvc_dct2_8:
+    db  64,  64,  64,  64
+    db  89,  75,  50,  18
+    db  83,  36, -36, -83
+    db  75, -18, -89, -50
+    db  64, -64, -64,  64
+    db  50, -89,  18,  75
+    db  36, -83,  83, -36
+    db  18, -50,  75, -89
+
+vvc_dct2_16:
+    db  64,  64,  64,  64,  64,  64,  64,  64
+    db  90,  87,  80,  70,  57,  43,  25,   9
+    db  89,  75,  50,  18, -18, -50, -75, -89
+    db  87,  57,   9, -43, -80, -90, -70, -25
+    db  83,  36, -36, -83, -83, -36,  36,  83
+    db  80,   9, -70, -87, -25,  57,  90,  43
+    db  75, -18, -89, -50,  50,  89,  18, -75
+    db  70, -43, -87,   9,  90,  25, -80, -57
+    db  64, -64, -64,  64,  64, -64, -64,  64
+    db  57, -80, -25,  90,  -9, -87,  43,  70
+    db  50, -89,  18,  75, -75, -18,  89, -50
+    db  43, -90,  57,  25, -87,  70,   9, -80
+    db  36, -83,  83, -36, -36,  83, -83,  36
+    db  25, -70,  90, -80,  43,   9, -57,  87
+    db  18, -50,  75, -89,  89, -75,  50, -18
+    db   9, -25,  43, -57,  70, -80,  87, -90
+
+vvc_dct2_32:
+    db  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64
+    db  90,  90,  88,  85,  82,  78,  73,  67,  61,  54,  46,  38,  31,  22,  13,   4
+    db  90,  87,  80,  70,  57,  43,  25,   9,  -9, -25, -43, -57, -70, -80, -87, -90
+    db  90,  82,  67,  46,  22,  -4, -31, -54, -73, -85, -90, -88, -78, -61, -38, -13
+    db  89,  75,  50,  18, -18, -50, -75, -89, -89, -75, -50, -18,  18,  50,  75,  89
+    db  88,  67,  31, -13, -54, -82, -90, -78, -46,  -4,  38,  73,  90,  85,  61,  22
+    db  87,  57,   9, -43, -80, -90, -70, -25,  25,  70,  90,  80,  43,  -9, -57, -87
+    db  85,  46, -13, -67, -90, -73, -22,  38,  82,  88,  54,  -4, -61, -90, -78, -31
+    db  83,  36, -36, -83, -83, -36,  36,  83,  83,  36, -36, -83, -83, -36,  36,  83
+    db  82,  22, -54, -90, -61,  13,  78,  85,  31, -46, -90, -67,   4,  73,  88,  38
+    db  80,   9, -70, -87, -25,  57,  90,  43, -43, -90, -57,  25,  87,  70,  -9, -80
+    db  78,  -4, -82, -73,  13,  85,  67, -22, -88, -61,  31,  90,  54, -38, -90, -46
+    db  75, -18, -89, -50,  50,  89,  18, -75, -75,  18,  89,  50, -50, -89, -18,  75
+    db  73, -31, -90, -22,  78,  67, -38, -90, -13,  82,  61, -46, -88,  -4,  85,  54
+    db  70, -43, -87,   9,  90,  25, -80, -57,  57,  80, -25, -90,  -9,  87,  43, -70
+    db  67, -54, -78,  38,  85, -22, -90,   4,  90,  13, -88, -31,  82,  46, -73, -61
+    db  64, -64, -64,  64,  64, -64, -64,  64,  64, -64, -64,  64,  64, -64, -64,  64
+    db  61, -73, -46,  82,  31, -88, -13,  90,  -4, -90,  22,  85, -38, -78,  54,  67
+    db  57, -80, -25,  90,  -9, -87,  43,  70, -70, -43,  87,   9, -90,  25,  80, -57
+    db  54, -85,  -4,  88, -46, -61,  82,  13, -90,  38,  67, -78, -22,  90, -31, -73
+    db  50, -89,  18,  75, -75, -18,  89, -50, -50,  89, -18, -75,  75,  18, -89,  50
+    db  46, -90,  38,  54, -90,  31,  61, -88,  22,  67, -85,  13,  73, -82,   4,  78
+    db  43, -90,  57,  25, -87,  70,   9, -80,  80,  -9, -70,  87, -25, -57,  90, -43
+    db  38, -88,  73,  -4, -67,  90, -46, -31,  85, -78,  13,  61, -90,  54,  22, -82
+    db  36, -83,  83, -36, -36,  83, -83,  36,  36, -83,  83, -36, -36,  83, -83,  36
+    db  31, -78,  90, -61,   4,  54, -88,  82, -38, -22,  73, -90,  67, -13, -46,  85
+    db  25, -70,  90, -80,  43,   9, -57,  87, -87,  57,  -9, -43,  80, -90,  70, -25
+    db  22, -61,  85, -90,  73, -38,  -4,  46, -78,  90, -82,  54, -13, -31,  67, -88
+    db  18, -50,  75, -89,  89, -75,  50, -18, -18,  50, -75,  89, -89,  75, -50,  18
+    db  13, -38,  61, -78,  88, -90,  85, -73,  54, -31,   4,  22, -46,  67, -82,  90
+    db   9, -25,  43, -57,  70, -80,  87, -90,  90, -87,  80, -70,  57, -43,  25,  -9
+    db   4, -13,  22, -31,  38, -46,  54, -61,  67, -73,  78, -82,  85, -88,  90, -90
+
+vvc_dct2_64:
+    db  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64
+    db  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64,  64
+    db  91,  90,  90,  90,  88,  87,  86,  84,  83,  81,  79,  77,  73,  71,  69,  65
+    db  62,  59,  56,  52,  48,  44,  41,  37,  33,  28,  24,  20,  15,  11,   7,   2
+    db  90,  90,  88,  85,  82,  78,  73,  67,  61,  54,  46,  38,  31,  22,  13,   4
+    db  -4, -13, -22, -31, -38, -46, -54, -61, -67, -73, -78, -82, -85, -88, -90, -90
+    db  90,  88,  84,  79,  71,  62,  52,  41,  28,  15,   2, -11, -24, -37, -48, -59
+    db -69, -77, -83, -87, -90, -91, -90, -86, -81, -73, -65, -56, -44, -33, -20,  -7
+    db  90,  87,  80,  70,  57,  43,  25,   9,  -9, -25, -43, -57, -70, -80, -87, -90
+    db -90, -87, -80, -70, -57, -43, -25,  -9,   9,  25,  43,  57,  70,  80,  87,  90
+    db  90,  84,  73,  59,  41,  20,  -2, -24, -44, -62, -77, -86, -90, -90, -83, -71
+    db -56, -37, -15,   7,  28,  48,  65,  79,  87,  91,  88,  81,  69,  52,  33,  11
+    db  90,  82,  67,  46,  22,  -4, -31, -54, -73, -85, -90, -88, -78, -61, -38, -13
+    db  13,  38,  61,  78,  88,  90,  85,  73,  54,  31,   4, -22, -46, -67, -82, -90
+    db  90,  79,  59,  33,   2, -28, -56, -77, -88, -90, -81, -62, -37,  -7,  24,  52
+    db  73,  87,  90,  83,  65,  41,  11, -20, -48, -71, -86, -91, -84, -69, -44, -15
+    db  89,  75,  50,  18, -18, -50, -75, -89, -89, -75, -50, -18,  18,  50,  75,  89
+    db  89,  75,  50,  18, -18, -50, -75, -89, -89, -75, -50, -18,  18,  50,  75,  89
+    db  88,  71,  41,   2, -37, -69, -87, -90, -73, -44,  -7,  33,  65,  86,  90,  77
+    db  48,  11, -28, -62, -84, -90, -79, -52, -15,  24,  59,  83,  91,  81,  56,  20
+    db  88,  67,  31, -13, -54, -82, -90, -78, -46,  -4,  38,  73,  90,  85,  61,  22
+    db -22, -61, -85, -90, -73, -38,   4,  46,  78,  90,  82,  54,  13, -31, -67, -88
+    db  87,  62,  20, -28, -69, -90, -84, -56, -11,  37,  73,  90,  81,  48,   2, -44
+    db -79, -91, -77, -41,   7,  52,  83,  90,  71,  33, -15, -59, -86, -88, -65, -24
+    db  87,  57,   9, -43, -80, -90, -70, -25,  25,  70,  90,  80,  43,  -9, -57, -87
+    db -87, -57,  -9,  43,  80,  90,  70,  25, -25, -70, -90, -80, -43,   9,  57,  87
+    db  86,  52,  -2, -56, -87, -84, -48,   7,  59,  88,  83,  44, -11, -62, -90, -81
+    db -41,  15,  65,  90,  79,  37, -20, -69, -90, -77, -33,  24,  71,  91,  73,  28
+    db  85,  46, -13, -67, -90, -73, -22,  38,  82,  88,  54,  -4, -61, -90, -78, -31
+    db  31,  78,  90,  61,   4, -54, -88, -82, -38,  22,  73,  90,  67,  13, -46, -85
+    db  84,  41, -24, -77, -90, -56,   7,  65,  91,  69,  11, -52, -88, -79, -28,  37
+    db  83,  86,  44, -20, -73, -90, -59,   2,  62,  90,  71,  15, -48, -87, -81, -33
+    db  83,  36, -36, -83, -83, -36,  36,  83,  83,  36, -36, -83, -83, -36,  36,  83
+    db  83,  36, -36, -83, -83, -36,  36,  83,  83,  36, -36, -83, -83, -36,  36,  83
+    db  83,  28, -44, -88, -73, -11,  59,  91,  62,  -7, -71, -90, -48,  24,  81,  84
+    db  33, -41, -87, -77, -15,  56,  90,  65,  -2, -69, -90, -52,  20,  79,  86,  37
+    db  82,  22, -54, -90, -61,  13,  78,  85,  31, -46, -90, -67,   4,  73,  88,  38
+    db -38, -88, -73,  -4,  67,  90,  46, -31, -85, -78, -13,  61,  90,  54, -22, -82
+    db  81,  15, -62, -90, -44,  37,  88,  69,  -7, -77, -84, -24,  56,  91,  52, -28
+    db -86, -73,  -2,  71,  87,  33, -48, -90, -59,  20,  83,  79,  11, -65, -90, -41
+    db  80,   9, -70, -87, -25,  57,  90,  43, -43, -90, -57,  25,  87,  70,  -9, -80
+    db -80,  -9,  70,  87,  25, -57, -90, -43,  43,  90,  57, -25, -87, -70,   9,  80
+    db  79,   2, -77, -81,  -7,  73,  83,  11, -71, -84, -15,  69,  86,  20, -65, -87
+    db -24,  62,  88,  28, -59, -90, -33,  56,  90,  37, -52, -90, -41,  48,  91,  44
+    db  78,  -4, -82, -73,  13,  85,  67, -22, -88, -61,  31,  90,  54, -38, -90, -46
+    db  46,  90,  38, -54, -90, -31,  61,  88,  22, -67, -85, -13,  73,  82,   4, -78
+    db  77, -11, -86, -62,  33,  90,  44, -52, -90, -24,  69,  83,   2, -81, -71,  20
+    db  88,  56, -41, -91, -37,  59,  87,  15, -73, -79,   7,  84,  65, -28, -90, -48
+    db  75, -18, -89, -50,  50,  89,  18, -75, -75,  18,  89,  50, -50, -89, -18,  75
+    db  75, -18, -89, -50,  50,  89,  18, -75, -75,  18,  89,  50, -50, -89, -18,  75
+    db  73, -24, -90, -37,  65,  81, -11, -88, -48,  56,  86,   2, -84, -59,  44,  90
+    db  15, -79, -69,  33,  91,  28, -71, -77,  20,  90,  41, -62, -83,   7,  87,  52
+    db  73, -31, -90, -22,  78,  67, -38, -90, -13,  82,  61, -46, -88,  -4,  85,  54
+    db -54, -85,   4,  88,  46, -61, -82,  13,  90,  38, -67, -78,  22,  90,  31, -73
+    db  71, -37, -90,  -7,  86,  48, -62, -79,  24,  91,  20, -81, -59,  52,  84, -11
+    db -90, -33,  73,  69, -41, -88,  -2,  87,  44, -65, -77,  28,  90,  15, -83, -56
+    db  70, -43, -87,   9,  90,  25, -80, -57,  57,  80, -25, -90,  -9,  87,  43, -70
+    db -70,  43,  87,  -9, -90, -25,  80,  57, -57, -80,  25,  90,   9, -87, -43,  70
+    db  69, -48, -83,  24,  90,   2, -90, -28,  81,  52, -65, -71,  44,  84, -20, -90
+    db  -7,  88,  33, -79, -56,  62,  73, -41, -86,  15,  91,  11, -87, -37,  77,  59
+    db  67, -54, -78,  38,  85, -22, -90,   4,  90,  13, -88, -31,  82,  46, -73, -61
+    db  61,  73, -46, -82,  31,  88, -13, -90,  -4,  90,  22, -85, -38,  78,  54, -67
+    db  65, -59, -71,  52,  77, -44, -81,  37,  84, -28, -87,  20,  90, -11, -90,   2
+    db  91,   7, -90, -15,  88,  24, -86, -33,  83,  41, -79, -48,  73,  56, -69, -62
+
+cextern vvc_dst7_4x4
+cextern vvc_dst7_8x8
+cextern vvc_dst7_16x16
+cextern vvc_dst7_32x32
+cextern vvc_dct8_4x4
+cextern vvc_dct8_8x8
+cextern vvc_dct8_16x16
+cextern vvc_dct8_32x32
+
+SECTION .text
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_YMM avx2
+
+; dst[x] = clip(dst[x] + res[x]), res is packed with a stride of width
+; %1: bits per component of dst, 8 or 16
+; for 16 bpc, m2 holds the broadcast pixel max
+%macro ADD_RESIDUAL_8PX 1
+%if %1 == 8
+    pmovzxbd             m0, [dstq + colq]
+%else
+    pmovzxwd             m0, [dstq + colq * 2]
+%endif
+    paddd                m0, [resq]
+    vextracti128        xm1, m0, 1
+%if %1 == 8
+    packssdw            xm0, xm1
+    packuswb            xm0, xm0
+    movq     [dstq + colq], xm0
+%else
+    packusdw            xm0, xm1
+    pminuw              xm0, xm2
+    movu [dstq + colq * 2], xm0
+%endif
+%endmacro
+
+%macro ADD_RESIDUAL_4PX 1
+%if %1 == 8
+    pmovzxbd            xm0, [dstq]
+%else
+    pmovzxwd            xm0, [dstq]
+%endif
+    paddd               xm0, [resq]
+%if %1 == 8
+    packssdw            xm0, xm0
+    packuswb            xm0, xm0
+    movd             [dstq], xm0
+%else
+    packusdw            xm0, xm0
+    pminuw              xm0, xm2
+    movq             [dstq], xm0
+%endif
+%endmacro
+
+%macro ADD_RESIDUAL_1PX 1
+%if %1 == 8
+    movzx              tmpd, byte [dstq + colq]
+%else
+    movzx              tmpd, word [dstq + colq * 2]
+%endif
+    movd                xm0, tmpd
+    movd                xm1, [resq]
+    paddd               xm0, xm1
+%if %1 == 8
+    packssdw            xm0, xm0
+    packuswb            xm0, xm0
+    movd               tmpd, xm0
+    mov     [dstq + colq], tmpb
+%else
+    packusdw            xm0, xm0
+    pminuw              xm0, xm2
+    movd               tmpd, xm0
+    mov [dstq + colq * 2], tmpw
+%endif
+%endmacro
+
+; void ff_vvc_add_residual_8_avx2(uint8_t *dst, const int *res, int w, int h, ptrdiff_t stride)
+; void ff_vvc_add_residual_16bpc_avx2(uint8_t *dst, const int *res, int w, int h, ptrdiff_t stride, int pixel_max)
+%macro ADD_RESIDUAL 1
+%if %1 == 8
+cglobal vvc_add_residual_8, 5, 7, 2, dst, res, w, h, stride, col, tmp
+%else
+cglobal vvc_add_residual_16bpc, 6, 8, 3, dst, res, w, h, stride, pixel_max, col, tmp
+    movd                xm2, pixel_maxd
+    vpbroadcastw        xm2, xm2
+%endif
+    cmp                  wd, 4
+    jl .loop_w1
+    je .loop_w4
+
+.loop_y:
+    xor                colq, colq
+.loop_x:
+    ADD_RESIDUAL_8PX     %1
+    add                resq, 32
+    add                colq, 8
+    cmp                cold, wd
+    jl .loop_x
+    add                dstq, strideq
+    dec                  hd
+    jg .loop_y
+    RET
+
+.loop_w4:
+    ADD_RESIDUAL_4PX     %1
+    add                resq, 16
+    add                dstq, strideq
+    dec                  hd
+    jg .loop_w4
+    RET
+
+.loop_w1:
+    xor                colq, colq
+.loop_w1_x:
+    ADD_RESIDUAL_1PX     %1
+    add                resq, 4
+    inc                colq
+    cmp                cold, wd
+    jl .loop_w1_x
+    add                dstq, strideq
+    dec                  hd
+    jg .loop_w1
+    RET
+%endmacro
+
+ADD_RESIDUAL  8
+ADD_RESIDUAL 16
+
+%macro STORE_4D 1
+    movd                  [coeffsq], %1
+    pextrd      [coeffsq + strideq], %1, 1
+    pextrd  [coeffsq + strideq * 2], %1, 2
+    pextrd     [coeffsq + stride3q], %1, 3
+    lea                     coeffsq, [coeffsq + strideq * 4]
+%endmacro
+
+; DST-7 and DCT-8 as a matrix multiplication, out[i] = sum(in[j] * matrix[j][i], j < nz)
+; only the first 16 inputs can be non-zero, so the sum is accumulated row by row
+; over the transposed matrix with one dword broadcast per input coefficient
+; void ff_vvc_inv_%1_%2_avx2(int *coeffs, ptrdiff_t stride, size_t nz)
+; %1: dst7 or dct8
+; %2: size, 4, 8, 16 or 32
+%macro INV_MATRIX 2
+%if %2 == 4
+    %define ACC_REGS 1
+%else
+    %define ACC_REGS %2 / 8
+%endif
+cglobal vvc_inv_%1_%2, 3, 6, 2 + ACC_REGS, coeffs, stride, nz, mat, src, stride3
+    lea                matq, [vvc_%{1}_%{2}x%{2}]
+    shl             strideq, 2
+    mov                srcq, coeffsq
+%assign k 0
+%rep ACC_REGS
+    %assign acc k + 2
+    pxor             m %+ acc, m %+ acc
+    %assign k k + 1
+%endrep
+
+.loop:
+%if %2 == 4
+    vpbroadcastd        xm0, [srcq]
+    pmovsxbd            xm1, [matq]
+    pmulld              xm1, xm0
+    paddd               xm2, xm1
+%else
+    vpbroadcastd         m0, [srcq]
+%assign k 0
+%rep ACC_REGS
+    %assign acc k + 2
+    pmovsxbd             m1, [matq + k * 8]
+    pmulld               m1, m0
+    paddd            m %+ acc, m1
+    %assign k k + 1
+%endrep
+%endif
+    add                srcq, strideq
+    add                matq, %2
+    dec                 nzq
+    jg .loop
+
+    cmp             strideq, 4
+    jne .strided
+%if %2 == 4
+    movu          [coeffsq], xm2
+%else
+%assign k 0
+%rep ACC_REGS
+    %assign acc k + 2
+    movu [coeffsq + k * mmsize], m %+ acc
+    %assign k k + 1
+%endrep
+%endif
+    RET
+
+.strided:
+    lea            stride3q, [strideq * 3]
+%assign k 0
+%rep ACC_REGS
+    %assign acc k + 2
+    STORE_4D         xm %+ acc
+%if %2 > 4
+    vextracti128     xm %+ acc, m %+ acc, 1
+    STORE_4D         xm %+ acc
+%endif
+    %assign k k + 1
+%endrep
+    RET
+%undef ACC_REGS
+%endmacro
+
+; DCT-2 with one even-odd decomposition step, out[i] = e[i] + o[i] and
+; out[size - 1 - i] = e[i] - o[i] for i < size / 2, where e sums the even and
+; o the odd inputs, each over the left half of their matrix row
+; void ff_vvc_inv_dct2_%1_avx2(int *coeffs, ptrdiff_t stride, size_t nz)
+; %1: size, 8, 16, 32 or 64
+%macro INV_DCT2 1
+%if %1 == 8
+    %define HALF_REGS 1
+%else
+    %define HALF_REGS %1 / 16
+%endif
+cglobal vvc_inv_dct2_%1, 3, 6, 2 + 2 * HALF_REGS, coeffs, stride, nz, mat, src, stride3
+    lea                matq, [vvc_dct2_%1]
+    shl             strideq, 2
+    mov                srcq, coeffsq
+%assign k 0
+%rep 2 * HALF_REGS
+    %assign acc k + 2
+    pxor             m %+ acc, m %+ acc
+    %assign k k + 1
+%endrep
+
+.loop:
+%assign half 0
+%rep 2
+%if %1 == 8
+    vpbroadcastd        xm0, [srcq]
+    pmovsxbd            xm1, [matq + half * 4]
+    pmulld              xm1, xm0
+    %assign acc 2 + half
+    paddd           xm %+ acc, xm1
+%else
+    vpbroadcastd         m0, [srcq]
+%assign k 0
+%rep HALF_REGS
+    %assign acc 2 + half * HALF_REGS + k
+    pmovsxbd             m1, [matq + half * %1 / 2 + k * 8]
+    pmulld               m1, m0
+    paddd            m %+ acc, m1
+    %assign k k + 1
+%endrep
+%endif
+    add                srcq, strideq
+    dec                 nzq
+%if half == 0
+    jz .butterfly
+%endif
+    %assign half half + 1
+%endrep
+    add                matq, %1
+    test                nzq, nzq
+    jg .loop
+
+; the even sums end up holding the reversed right half
+.butterfly:
+%if %1 == 8
+    psubd               xm0, xm2, xm3
+    paddd               xm3, xm2
+    pshufd              xm2, xm0, q0123
+%else
+    mova                 m1, [reverse_d]
+%assign k 0
+%rep HALF_REGS
+    %assign ev 2 + k
+    %assign od 2 + HALF_REGS + k
+    psubd                m0, m %+ ev, m %+ od
+    paddd            m %+ od, m %+ ev
+    vpermd           m %+ ev, m1, m0
+    %assign k k + 1
+%endrep
+%endif
+
+    cmp             strideq, 4
+    jne .strided
+%if %1 == 8
+    movu          [coeffsq], xm3
+    movu     [coeffsq + 16], xm2
+%else
+%assign k 0
+%rep HALF_REGS
+    %assign od 2 + HALF_REGS + k
+    %assign ev 2 + HALF_REGS - 1 - k
+    movu [coeffsq + k * mmsize], m %+ od
+    movu [coeffsq + (HALF_REGS + k) * mmsize], m %+ ev
+    %assign k k + 1
+%endrep
+%endif
+    RET
+
+.strided:
+    lea            stride3q, [strideq * 3]
+%if %1 == 8
+    STORE_4D            xm3
+    STORE_4D            xm2
+%else
+%assign k 0
+%rep 2 * HALF_REGS
+%if k < HALF_REGS
+    %assign acc 2 + HALF_REGS + k
+%else
+    %assign acc 2 + 2 * HALF_REGS - 1 - k
+%endif
+    STORE_4D         xm %+ acc
+    vextracti128     xm %+ acc, m %+ acc, 1
+    STORE_4D         xm %+ acc
+    %assign k k + 1
+%endrep
+%endif
+    RET
+%undef HALF_REGS
+%endmacro
+
+INV_DCT2  8
+INV_DCT2 16
+INV_DCT2 32
+INV_DCT2 64
+
+INV_MATRIX dst7,  4
+INV_MATRIX dst7,  8
+INV_MATRIX dst7, 16
+INV_MATRIX dst7, 32
+INV_MATRIX dct8,  4
+INV_MATRIX dct8,  8
+INV_MATRIX dct8, 16
+INV_MATRIX dct8, 32
+
+%endif
+%endif
@@ -161,7 +161,8 @@ typedef struct SelectContext {
     ptrdiff_t width[4];
     ptrdiff_t height[4];
     int do_scene_detect;            ///< 1 if the expression requires scene detection variables, 0 otherwise
-    ff_scene_sad_fn sad;            ///< Sum of the absolute difference function (scene detect only)
+    int scene_mode;                 ///< resolution of the frame difference      (scene detect only)
+    SceneSADContext scene;          ///< Sum of the absolute difference context  (scene detect only)
     double prev_mafd;               ///< previous MAFD                           (scene detect only)
     AVFrame *prev_picref;           ///< previous frame                          (scene detect only)
     double select;
@@ -176,6 +177,9 @@ static const AVOption filt_name##_options[] = {                     \
     { "e",    "set an expression to use for selecting frames", OFFSET(expr_str), AV_OPT_TYPE_STRING, { .str = "1" }, .flags=FLAGS }, \
     { "outputs", "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
     { "n",       "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
+    { "scene_mode", "set the resolution of the scene detection", OFFSET(scene_mode), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, .flags=FLAGS, .unit = "scene_mode" }, \
+        { "full", "compare the full frames",      0, AV_OPT_TYPE_CONST, {.i64 = 0}, .flags=FLAGS, .unit = "scene_mode" }, \
+        { "fast", "compare 4x4 decimated frames", 0, AV_OPT_TYPE_CONST, {.i64 = 1}, .flags=FLAGS, .unit = "scene_mode" }, \
     { NULL }                                                            \
 }
 
@@ -272,9 +276,11 @@ static int config_input(AVFilterLink *inlink)
         inlink->type == AVMEDIA_TYPE_AUDIO ? inlink->sample_rate : NAN;
 
     if (CONFIG_SELECT_FILTER && select->do_scene_detect) {
-        select->sad = ff_scene_sad_get_fn(select->bitdepth);
-        if (!select->sad)
-            return AVERROR(EINVAL);
+        int ret = ff_scene_sad_init(inlink->dst, &select->scene, select->nb_planes,
+                                    select->width, select->height, select->bitdepth,
+                                    is_yuv ? 1 : desc->comp[0].step, select->scene_mode);
+        if (ret < 0)
+            return ret;
     }
     return 0;
 }
@@ -285,29 +291,38 @@ static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
     SelectContext *select = ctx->priv;
     AVFrame *prev_picref = select->prev_picref;
 
-    if (prev_picref &&
-        frame->height == prev_picref->height &&
-        frame->width  == prev_picref->width) {
-        uint64_t sad = 0;
-        double mafd, diff;
-        uint64_t count = 0;
-
-        for (int plane = 0; plane < select->nb_planes; plane++) {
-            uint64_t plane_sad;
-            select->sad(prev_picref->data[plane], prev_picref->linesize[plane],
-                    frame->data[plane], frame->linesize[plane],
-                    select->width[plane], select->height[plane], &plane_sad);
-            sad += plane_sad;
-            count += select->width[plane] * select->height[plane];
+    uint64_t sad, count;
+    int have_sad = 0;
+
+    if (select->scene.fast) {
+        /* the thumbnails are sized for the link, start over on other frames */
+        if (frame->width  == ctx->inputs[0]->w &&
+            frame->height == ctx->inputs[0]->h)
+            have_sad = ff_scene_sad_thumb(ctx, &select->scene, frame, &sad, &count);
+        else
+            select->scene.have_thumb = 0;
+    } else {
+        if (prev_picref &&
+            frame->height == prev_picref->height &&
+            frame->width  == prev_picref->width) {
+            sad = ff_scene_sad_frames(ctx, &select->scene, prev_picref, frame, &count);
+            have_sad = 1;
         }
+        av_frame_free(&select->prev_picref);
+        select->prev_picref = av_frame_clone(frame);
+    }
+
+    if (have_sad) {
+        double mafd, diff;
 
         mafd = (double)sad / count / (1ULL << (select->bitdepth - 8));
         diff = fabs(mafd - select->prev_mafd);
         ret  = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
         select->prev_mafd = mafd;
-        av_frame_free(&prev_picref);
+    } else {
+        /* no previous frame to compare with, forget its mafd too */
+        select->prev_mafd = 0.;
     }
-    select->prev_picref = av_frame_clone(frame);
     return ret;
 }
 
@@ -487,6 +502,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     if (select->do_scene_detect) {
         av_frame_free(&select->prev_picref);
+        ff_scene_sad_uninit(&select->scene);
     }
 }
 
@@ -585,6 +601,7 @@ const FFFilter ff_vf_select = {
     .activate      = activate,
     FILTER_INPUTS(select_inputs),
     FILTER_QUERY_FUNC2(query_formats),
-    .p.flags       = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_METADATA_ONLY,
+    .p.flags       = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_METADATA_ONLY |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif /* CONFIG_SELECT_FILTER */
@@ -0,0 +1,61 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef AVFILTER_PF2PF_H
+#define AVFILTER_PF2PF_H
+
+#include <stdint.h>
+
+/**
+ * Row kernels for the conversions that do not need the per-component
+ * generic path. Shuffle masks follow pshufb semantics: an entry with the
+ * high bit set produces a zero byte, any other entry is a byte index.
+ */
+typedef struct PF2PFDSPContext {
+    /**
+     * Permute the bytes of every block of `block` (12 or 16) bytes of src
+     * according to `mask`. len is the row size in bytes.
+     */
+    void (*shuffle)(uint8_t *dst, const uint8_t *src, int len,
+                    const uint8_t *mask, int block);
+
+    /**
+     * Split a row of w packed 8-bit pixels of `step` (3 or 4) bytes into
+     * nb_planes (3 or 4) planes. mask[4 * k + p] is the byte of the 4-pixel
+     * group that holds pixel p of plane k.
+     */
+    void (*deinterleave)(uint8_t *const dst[4], const uint8_t *src, int w,
+                         const uint8_t *mask, int step, int nb_planes);
+
+    /**
+     * Inverse of deinterleave: mask[i] is 4 * k + p for byte i of the
+     * 4-pixel group, taken from pixel p of plane k.
+     */
+    void (*interleave)(uint8_t *dst, const uint8_t *const src[4], int w,
+                       const uint8_t *mask, int step, int nb_planes);
+
+    /* Depth changes between native endian 8 and 16-bit samples */
+    void (*widen)(uint16_t *dst, const uint8_t *src, int len, int shift);
+    void (*narrow)(uint8_t *dst, const uint16_t *src, int len, int shift);
+    void (*shift16)(uint16_t *dst, const uint16_t *src, int len,
+                    int lshift, int rshift);
+} PF2PFDSPContext;
+
+void ff_pf2pf_dsp_init_x86(PF2PFDSPContext *dsp);
+
+#endif /* AVFILTER_PF2PF_H */
@@ -21,6 +21,9 @@
  * Scene SAD functions
  */
 
+#include "libavutil/mem.h"
+
+#include "filters.h"
 #include "scene_sad.h"
 
 void ff_scene_sad16_c(SCENE_SAD_PARAMS)
@@ -70,3 +73,234 @@ ff_scene_sad_fn ff_scene_sad_get_fn(int depth)
     }
     return sad;
 }
+
+int ff_scene_sad_init(AVFilterContext *ctx, SceneSADContext *s, int nb_planes,
+                      const ptrdiff_t *width, const ptrdiff_t *height,
+                      int depth, int step, int fast)
+{
+    const int f = 1 << SCENE_THUMB_LOG2;
+
+    s->nb_planes = nb_planes;
+    s->depth = depth;
+    s->step = step;
+    s->cur = 0;
+    s->have_thumb = 0;
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+
+    s->sad = ff_scene_sad_get_fn(depth);
+    s->thumb_sad = ff_scene_sad_get_fn(16);
+    if (!s->sad || !s->thumb_sad)
+        return AVERROR(EINVAL);
+
+    /* the sums of a block have to fit into 16 bits */
+    s->fast = fast && depth + 2 * SCENE_THUMB_LOG2 <= 16;
+    for (int p = 0; p < nb_planes; p++) {
+        s->width[p] = width[p];
+        s->height[p] = height[p];
+        s->thumb_width[p] = (width[p] / step / f) * step;
+        s->thumb_height[p] = height[p] / f;
+        if (!s->thumb_width[p] || !s->thumb_height[p])
+            s->fast = 0;
+    }
+
+    av_freep(&s->job_sad);
+    s->job_sad = av_calloc(s->nb_threads, sizeof(*s->job_sad));
+    if (!s->job_sad)
+        return AVERROR(ENOMEM);
+
+    for (int p = 0; p < 4; p++) {
+        av_freep(&s->thumb[0][p]);
+        av_freep(&s->thumb[1][p]);
+    }
+    if (!s->fast)
+        return 0;
+
+    for (int p = 0; p < nb_planes; p++) {
+        for (int i = 0; i < 2; i++) {
+            s->thumb[i][p] = av_malloc_array(s->thumb_width[p] * s->thumb_height[p],
+                                             sizeof(**s->thumb));
+            if (!s->thumb[i][p])
+                return AVERROR(ENOMEM);
+        }
+    }
+
+    return 0;
+}
+
+void ff_scene_sad_uninit(SceneSADContext *s)
+{
+    for (int p = 0; p < 4; p++) {
+        av_freep(&s->thumb[0][p]);
+        av_freep(&s->thumb[1][p]);
+    }
+    av_freep(&s->job_sad);
+}
+
+typedef struct ThreadData {
+    SceneSADContext *s;
+    const AVFrame *prev, *cur;
+} ThreadData;
+
+static int sad_frames_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+    SceneSADContext *s = td->s;
+    uint64_t sum = 0;
+
+    for (int p = 0; p < s->nb_planes; p++) {
+        const int slice_start = (s->height[p] *  jobnr     ) / nb_jobs;
+        const int slice_end   = (s->height[p] * (jobnr + 1)) / nb_jobs;
+        const ptrdiff_t stride1 = td->prev->linesize[p];
+        const ptrdiff_t stride2 = td->cur->linesize[p];
+        uint64_t plane_sad;
+
+        if (slice_end <= slice_start)
+            continue;
+        s->sad(td->prev->data[p] + slice_start * stride1, stride1,
+               td->cur->data[p]  + slice_start * stride2, stride2,
+               s->width[p], slice_end - slice_start, &plane_sad);
+        sum += plane_sad;
+    }
+    s->job_sad[jobnr] = sum;
+
+    return 0;
+}
+
+static void decimate_row(uint16_t *dst, const uint8_t *src, ptrdiff_t linesize,
+                         int width, int step, int depth)
+{
+    const int f = 1 << SCENE_THUMB_LOG2;
+
+    memset(dst, 0, width * sizeof(*dst));
+    for (int y = 0; y < f; y++) {
+        if (depth > 8) {
+            const uint16_t *src16 = (const uint16_t *)src;
+
+            for (int x = 0; x < width; x += step) {
+                for (int c = 0; c < step; c++) {
+                    const uint16_t *p = src16 + x * f + c;
+                    unsigned sum = 0;
+
+                    for (int i = 0; i < f; i++)
+                        sum += p[i * step];
+                    dst[x + c] += sum;
+                }
+            }
+        } else {
+            for (int x = 0; x < width; x += step) {
+                for (int c = 0; c < step; c++) {
+                    const uint8_t *p = src + x * f + c;
+                    unsigned sum = 0;
+
+                    for (int i = 0; i < f; i++)
+                        sum += p[i * step];
+                    dst[x + c] += sum;
+                }
+            }
+        }
+        src += linesize;
+    }
+}
+
+static int sad_thumb_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+    SceneSADContext *s = td->s;
+    const int f = 1 << SCENE_THUMB_LOG2;
+    uint64_t sum = 0;
+
+    for (int p = 0; p < s->nb_planes; p++) {
+        const int slice_start = (s->thumb_height[p] *  jobnr     ) / nb_jobs;
+        const int slice_end   = (s->thumb_height[p] * (jobnr + 1)) / nb_jobs;
+        const ptrdiff_t linesize = td->cur->linesize[p];
+        const int tw = s->thumb_width[p];
+        uint16_t *cur  = s->thumb[s->cur][p];
+        uint16_t *prev = s->thumb[!s->cur][p];
+        uint64_t plane_sad;
+
+        if (slice_end <= slice_start)
+            continue;
+
+        for (int y = slice_start; y < slice_end; y++)
+            decimate_row(cur + y * tw, td->cur->data[p] + y * f * linesize,
+                         linesize, tw, s->step, s->depth);
+
+        if (!s->have_thumb)
+            continue;
+        s->thumb_sad((const uint8_t *)(prev + slice_start * tw), tw * sizeof(*prev),
+                     (const uint8_t *)(cur  + slice_start * tw), tw * sizeof(*cur),
+                     tw, slice_end - slice_start, &plane_sad);
+        sum += plane_sad;
+    }
+    s->job_sad[jobnr] = sum;
+
+    return 0;
+}
+
+uint64_t ff_scene_sad_frames(AVFilterContext *ctx, SceneSADContext *s,
+                             const AVFrame *prev, const AVFrame *cur,
+                             uint64_t *count)
+{
+    ThreadData td = { .s = s, .prev = prev, .cur = cur };
+    const int nb_jobs = FFMIN(s->height[0], s->nb_threads);
+    uint64_t sad = 0;
+
+    ff_filter_execute(ctx, sad_frames_slice, &td, NULL, nb_jobs);
+
+    for (int j = 0; j < nb_jobs; j++)
+        sad += s->job_sad[j];
+
+    *count = 0;
+    for (int p = 0; p < s->nb_planes; p++)
+        *count += s->width[p] * s->height[p];
+
+    return sad;
+}
+
+int ff_scene_sad_thumb(AVFilterContext *ctx, SceneSADContext *s,
+                       const AVFrame *frame, uint64_t *sad, uint64_t *count)
+{
+    ThreadData td = { .s = s, .cur = frame };
+    const int nb_jobs = FFMIN(s->thumb_height[0], s->nb_threads);
+    int ret = s->have_thumb;
+
+    s->cur = !s->cur;
+    ff_filter_execute(ctx, sad_thumb_slice, &td, NULL, nb_jobs);
+    s->have_thumb = 1;
+
+    *sad = 0;
+    for (int j = 0; j < nb_jobs && ret; j++)
+        *sad += s->job_sad[j];
+    /* The block sums hide the differences within the blocks, which leaves
+     * cuts at about 96% of their full mode SAD, scale them back to it. */
+    *sad = *sad * 25 / 24;
+
+    /* each thumbnail sample holds the sum of a block */
+    *count = 0;
+    for (int p = 0; p < s->nb_planes; p++)
+        *count += (uint64_t)s->thumb_width[p] * s->thumb_height[p] << (2 * SCENE_THUMB_LOG2);
+
+    return ret;
+}
+
+double ff_scene_sad_thumb_histdist(const SceneSADContext *s)
+{
+    const int shift = s->depth + 2 * SCENE_THUMB_LOG2 - 6;
+    const int n = s->thumb_width[0] * s->thumb_height[0];
+    const uint16_t *cur  = s->thumb[s->cur][0];
+    const uint16_t *prev = s->thumb[!s->cur][0];
+    int hist[64] = { 0 };
+    uint64_t dist = 0;
+
+    if (!s->fast || !s->have_thumb || !n)
+        return 0.;
+
+    for (int i = 0; i < n; i++) {
+        hist[cur[i]  >> shift]++;
+        hist[prev[i] >> shift]--;
+    }
+    for (int i = 0; i < 64; i++)
+        dist += FFABS(hist[i]);
+
+    return dist / (2. * n);
+}
@@ -41,4 +41,65 @@ ff_scene_sad_fn ff_scene_sad_get_fn_x86(int depth);
 
 ff_scene_sad_fn ff_scene_sad_get_fn(int depth);
 
+/* log2 of the decimation factor of the thumbnails in both directions */
+#define SCENE_THUMB_LOG2 2
+
+/**
+ * Frame differences for scene change detection, computed either on the
+ * full frames or on thumbnails holding the sums of 4x4 blocks.
+ */
+typedef struct SceneSADContext {
+    ff_scene_sad_fn sad;
+    ff_scene_sad_fn thumb_sad;
+    int nb_planes;
+    int depth;
+    int step;               ///< distance of the samples of one component
+    ptrdiff_t width[4];     ///< plane widths in samples
+    ptrdiff_t height[4];
+    int fast;               ///< compare thumbnails instead of frames
+    int thumb_width[4];     ///< thumbnail widths in samples
+    int thumb_height[4];
+    uint16_t *thumb[2][4];  ///< thumbnails of the current and previous frame
+    int cur;
+    int have_thumb;         ///< whether there is a previous thumbnail
+    int nb_threads;
+    uint64_t *job_sad;
+} SceneSADContext;
+
+/**
+ * @param width  plane widths in samples
+ * @param step   distance between the samples of one component in packed formats
+ * @param fast   work on thumbnails, falls back to the full frames if they are too small
+ */
+int ff_scene_sad_init(AVFilterContext *ctx, SceneSADContext *s, int nb_planes,
+                      const ptrdiff_t *width, const ptrdiff_t *height,
+                      int depth, int step, int fast);
+
+void ff_scene_sad_uninit(SceneSADContext *s);
+
+/**
+ * Slice threaded SAD of two frames.
+ * @param count set to the number of compared samples
+ */
+uint64_t ff_scene_sad_frames(AVFilterContext *ctx, SceneSADContext *s,
+                             const AVFrame *prev, const AVFrame *cur,
+                             uint64_t *count);
+
+/**
+ * Create the thumbnail of a frame and compare it with the previous one. The
+ * SAD is in units of full resolution samples and scaled to match the SAD of
+ * the full frames on cuts. As it is taken over block sums, it is markedly
+ * lower than the full one for motion and fine detail.
+ * The frame must have the dimensions the context was initialised with.
+ * @return 1 if a SAD was computed, 0 for the first frame
+ */
+int ff_scene_sad_thumb(AVFilterContext *ctx, SceneSADContext *s,
+                       const AVFrame *frame, uint64_t *sad, uint64_t *count);
+
+/**
+ * @return the distance of the histograms of the current and previous
+ *         thumbnail of the first plane, between 0 and 1
+ */
+double ff_scene_sad_thumb_histdist(const SceneSADContext *s);
+
 #endif /* AVFILTER_SCENE_SAD_H */
@@ -50,6 +50,13 @@ enum formats {
     NB_FORMATS
 };
 
+enum index_mode {
+    INDEX_OFF,
+    INDEX_BUILD,
+    INDEX_LOOKUP,
+    NB_INDEX_MODE
+};
+
 typedef struct Point {
     uint8_t x;
     uint8_t y;
@@ -121,8 +128,25 @@ typedef struct StreamContext {
     uint32_t lastindex; /* helper to store amount of frames */
 
     int exported; /* boolean whether stream already exported */
+
+    int blockx[33]; /* first column of each of the 32 block columns */
 } StreamContext;
 
+/* catalogue of stored signatures with an inverted index over the coarse words */
+typedef struct SignatureIndex {
+    int nb_clips;
+    char **names;
+    StreamContext *clips;
+
+    int nb_segments;
+    CoarseSignature **segments;
+    int *segment_clip;
+
+    /* segments containing word w in bag i */
+    uint32_t nb_postings[5][243];
+    uint32_t *postings[5][243];
+} SignatureIndex;
+
 typedef struct SignatureContext {
     const AVClass *class;
     /* input parameters */
@@ -134,11 +158,20 @@ typedef struct SignatureContext {
     int thcomposdist;
     int thl1;
     int thdi;
-    int thit;
+    double thit;
+    char *index_filename;
+    int index_mode;
+    char *clipname;
     /* end input parameters */
 
+    SignatureIndex *index;
+    int index_done;
+
     uint8_t l1distlut[243*242/2]; /* 243 + 242 + 241 ... */
     StreamContext* streamcontexts;
+
+    int nb_threads;
+    uint64_t (*intpic)[32][32]; /* partial block sums of each job */
 } SignatureContext;
 
 
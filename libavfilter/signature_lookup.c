@@ -295,7 +295,7 @@ static MatchingInfo* get_matching_parameters(AVFilterContext *ctx, SignatureCont
     if (hmax > 0) {
         hmax = (int) (0.7*hmax);
         for (i = 0; i < MAX_FRAMERATE; i++) {
-            for (j = 0; j < HOUGH_MAX_OFFSET; j++) {
+            for (j = 0; j < 2 * HOUGH_MAX_OFFSET + 1; j++) {
                 if (hmax < hspace[i][j].score) {
                     c->next = av_malloc(sizeof(MatchingInfo));
                     c = c->next;
@@ -305,7 +305,7 @@ static MatchingInfo* get_matching_parameters(AVFilterContext *ctx, SignatureCont
                     }
                     c->framerateratio = (i+1.0) / 30;
                     c->score = hspace[i][j].score;
-                    c->offset = j-90;
+                    c->offset = j - HOUGH_MAX_OFFSET;
                     c->first = hspace[i][j].a;
                     c->second = hspace[i][j].b;
                     c->next = NULL;
@@ -580,3 +580,92 @@ static MatchingInfo lookup_signatures(AVFilterContext *ctx, SignatureContext *sc
     return bestmatch;
 
 }
+
+/**
+ * matches a stream against all clips of a catalogue, only coarse signatures
+ * sharing enough words with a query segment are evaluated
+ * @param best one entry per clip of the catalogue, score is 0 if no match is found
+ */
+static int lookup_index(AVFilterContext *ctx, SignatureContext *sc, StreamContext *query,
+                        const SignatureIndex *idx, MatchingInfo *best, int mode)
+{
+    const int minbags = sc->thworddist > (1 << 16) ? 0 : 3;
+    CoarseSignature *cs;
+    MatchingInfo *infos;
+    uint32_t *touched;
+    uint8_t *bags;
+    int i, w, nb_touched;
+
+    for (i = 0; i < idx->nb_clips; i++) {
+        best[i].score = 0;
+        best[i].meandist = 99999;
+        best[i].whole = 0;
+    }
+
+    if (!idx->nb_segments)
+        return 0;
+
+    bags = av_calloc(idx->nb_segments, sizeof(*bags));
+    touched = av_malloc_array(idx->nb_segments, sizeof(*touched));
+    if (!bags || !touched) {
+        av_freep(&bags);
+        av_freep(&touched);
+        return AVERROR(ENOMEM);
+    }
+
+    fill_l1distlut(sc->l1distlut);
+
+    for (cs = query->coarsesiglist; cs; cs = cs->next) {
+        if (!cs->first)
+            continue;
+
+        /* stage 0: collect the segments sharing words with this one */
+        nb_touched = 0;
+        if (minbags) {
+            for (i = 0; i < 5; i++) {
+                for (w = 0; w < 243; w++) {
+                    if (!(cs->data[i][w/8] & (1 << (7 - w%8))))
+                        continue;
+                    for (uint32_t p = 0; p < idx->nb_postings[i][w]; p++) {
+                        uint32_t seg = idx->postings[i][w][p];
+                        if (!bags[seg])
+                            touched[nb_touched++] = seg;
+                        bags[seg] |= 1 << i;
+                    }
+                }
+            }
+        } else {
+            for (nb_touched = 0; nb_touched < idx->nb_segments; nb_touched++)
+                touched[nb_touched] = nb_touched;
+        }
+
+        for (i = 0; i < nb_touched; i++) {
+            const uint32_t seg = touched[i];
+            const int clip = idx->segment_clip[seg];
+            CoarseSignature *cs2 = idx->segments[seg];
+            const int nb_bags = av_popcount(bags[seg]);
+
+            bags[seg] = 0;
+            /* a jaccard distance below thworddist needs a common word in the bag */
+            if (nb_bags < minbags || best[clip].whole)
+                continue;
+            /* stage 1: coarsesignature matching */
+            if (!get_jaccarddist(sc, cs, cs2))
+                continue;
+            av_log(ctx, AV_LOG_DEBUG, "Stage 1: got coarsesignature pair with clip %d. "
+                   "indices of first frame: %"PRIu32" and %"PRIu32"\n",
+                   clip, cs->first->index, cs2->first->index);
+            /* stage 2: l1-distance and hough-transform */
+            infos = get_matching_parameters(ctx, sc, cs->first, cs2->first);
+            /* stage 3: evaluation */
+            if (infos) {
+                best[clip] = evaluate_parameters(ctx, sc, infos, best[clip], mode);
+                sll_free(&infos);
+            }
+        }
+    }
+
+    av_freep(&bags);
+    av_freep(&touched);
+    return 0;
+}
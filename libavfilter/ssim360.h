@@ -0,0 +1,40 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef AVFILTER_SSIM360_H
+#define AVFILTER_SSIM360_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct SSIM360DSPContext {
+    void (*ssim_4x4_line)(const uint8_t *buf, ptrdiff_t buf_stride,
+                          const uint8_t *ref, ptrdiff_t ref_stride,
+                          int (*sums)[4], int w);
+    /**
+     * Store the unweighted SSIM of w overlapping 8x8 blocks into ssim.
+     * ssim must have room for FFALIGN(w, 4) entries.
+     */
+    void (*ssim_end_line)(const int (*sum0)[4], const int (*sum1)[4],
+                          float *ssim, int w);
+} SSIM360DSPContext;
+
+void ff_ssim360_init(SSIM360DSPContext *dsp);
+void ff_ssim360_init_x86(SSIM360DSPContext *dsp);
+
+#endif /* AVFILTER_SSIM360_H */
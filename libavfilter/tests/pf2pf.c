@@ -0,0 +1,177 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Check that every conversion handled by the specialised row kernels gives
+ * the same output as the generic per-component path.
+ */
+
+#include <stdio.h>
+
+#include "libavutil/frame.h"
+#include "libavutil/lfg.h"
+#include "libavfilter/vf_pf2pf.c"
+
+#define W 67
+#define H 35
+
+static int usable(const AVPixFmtDescriptor *desc)
+{
+    return !(desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL |
+                            AV_PIX_FMT_FLAG_BITSTREAM));
+}
+
+static AVFrame *alloc_frame(enum AVPixelFormat fmt)
+{
+    AVFrame *frame = av_frame_alloc();
+    if (!frame)
+        return NULL;
+    frame->format = fmt;
+    frame->width  = W;
+    frame->height = H;
+    if (av_frame_get_buffer(frame, 0) < 0)
+        av_frame_free(&frame);
+    return frame;
+}
+
+/* Random but valid samples, X components included, other padding cleared */
+static void fill_frame(AVFrame *frame, AVLFG *lfg)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    uint32_t line[W];
+
+    for (int p = 0; p < 4 && frame->buf[p]; p++)
+        memset(frame->buf[p]->data, 0, frame->buf[p]->size);
+
+    for (int c = 0; c < 4 && desc->comp[c].depth; c++) {
+        const int sw = c == 1 || c == 2 ? desc->log2_chroma_w : 0;
+        const int sh = c == 1 || c == 2 ? desc->log2_chroma_h : 0;
+        const int depth = desc->comp[c].depth;
+
+        for (int y = 0; y < AV_CEIL_RSHIFT(H, sh); y++) {
+            for (int x = 0; x < AV_CEIL_RSHIFT(W, sw); x++)
+                line[x] = av_lfg_get(lfg) & (depth < 32 ? (1U << depth) - 1 : UINT32_MAX);
+            av_write_image_line2(line, frame->data, frame->linesize, desc,
+                                 0, y, c, AV_CEIL_RSHIFT(W, sw), 4);
+        }
+    }
+}
+
+static void convert(PF2PFContext *s, AVFrame *out, AVFrame *in, int nb_jobs)
+{
+    AVFilterContext ctx = { .priv = s };
+    ThreadData td = { .in = in, .out = out };
+
+    for (int i = 0; i < nb_jobs; i++)
+        do_pf2pf(&ctx, &td, i, nb_jobs);
+}
+
+static int frames_equal(const AVFrame *a, const AVFrame *b)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(a->format);
+    int linesize[4];
+
+    av_image_fill_linesizes(linesize, a->format, a->width);
+    for (int p = 0; p < 4 && a->data[p]; p++) {
+        const int h = p == 1 || p == 2 ? AV_CEIL_RSHIFT(a->height, desc->log2_chroma_h)
+                                       : a->height;
+        for (int y = 0; y < h; y++) {
+            if (memcmp(a->data[p] + y * a->linesize[p],
+                       b->data[p] + y * b->linesize[p], linesize[p]))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static int test_pair(enum AVPixelFormat src_fmt, enum AVPixelFormat dst_fmt, AVLFG *lfg)
+{
+    PF2PFContext s = { 0 };
+    AVFrame *in, *out_ops, *out_generic;
+    int ret = 0;
+
+    s.dst_desc = av_pix_fmt_desc_get(dst_fmt);
+    s.src_desc = av_pix_fmt_desc_get(src_fmt);
+    config_funcs(&s);
+    if (!s.nb_ops)
+        return 0;
+    for (int i = 0; i < s.dst_desc->nb_components; i++) {
+        if (has_comp(s.src_desc, i) && !s.special[i] && !s.generic[i])
+            return 0;
+    }
+    if (av_image_fill_linesizes(s.linesize, dst_fmt, W) < 0)
+        return AVERROR(EINVAL);
+
+    in          = alloc_frame(src_fmt);
+    out_ops     = alloc_frame(dst_fmt);
+    out_generic = alloc_frame(dst_fmt);
+    if (!in || !out_ops || !out_generic) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    fill_frame(in, lfg);
+    convert(&s, out_ops, in, 3);
+    s.nb_ops = 0;
+    convert(&s, out_generic, in, 1);
+
+    if (!frames_equal(out_ops, out_generic)) {
+        printf("%s -> %s: MISMATCH\n", av_get_pix_fmt_name(src_fmt),
+               av_get_pix_fmt_name(dst_fmt));
+        ret = 1;
+    }
+
+end:
+    av_frame_free(&in);
+    av_frame_free(&out_ops);
+    av_frame_free(&out_generic);
+    return ret;
+}
+
+int main(void)
+{
+    const AVPixFmtDescriptor *src_desc, *dst_desc;
+    AVLFG lfg;
+    int ret = 0;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+
+    for (int src = 0; src_desc = av_pix_fmt_desc_get(src); src++) {
+        if (!usable(src_desc))
+            continue;
+        for (int dst = 0; dst_desc = av_pix_fmt_desc_get(dst); dst++) {
+            int err;
+
+            if (dst == src || !usable(dst_desc) ||
+                dst_desc->log2_chroma_w != src_desc->log2_chroma_w ||
+                dst_desc->log2_chroma_h != src_desc->log2_chroma_h ||
+                (dst_desc->flags & AV_PIX_FMT_FLAG_RGB) != (src_desc->flags & AV_PIX_FMT_FLAG_RGB))
+                continue;
+
+            err = test_pair(src, dst, &lfg);
+            if (err < 0) {
+                fprintf(stderr, "%s -> %s failed: %s\n", av_get_pix_fmt_name(src),
+                        av_get_pix_fmt_name(dst), av_err2str(err));
+                return 1;
+            }
+            ret |= err;
+        }
+    }
+
+    return ret;
+}
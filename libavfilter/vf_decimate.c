@@ -50,7 +50,8 @@ typedef struct DecimateContext {
     int depth;
     int nxblocks, nyblocks;
     int bdiffsize;
-    int64_t *bdiffs;
+    int64_t *bdiffs;        ///< block diffs of each frame of the cycle
+    int nb_threads;
     AVRational in_tb;       // input time-base
     AVRational nondec_tb;   // non-decimated time-base
     AVRational dec_tb;      // decimated time-base
@@ -84,32 +85,46 @@ static const AVOption decimate_options[] = {
 
 AVFILTER_DEFINE_CLASS(decimate);
 
-static void calc_diffs(const DecimateContext *dm, struct qitem *q,
-                       const AVFrame *f1, const AVFrame *f2)
+typedef struct ThreadData {
+    const AVFrame *f1, *f2;
+    int64_t *bdiffs;
+} ThreadData;
+
+static void calc_diffs_slice(const DecimateContext *dm, const ThreadData *td,
+                             int jobnr, int nb_jobs)
 {
-    int64_t maxdiff = -1;
-    int64_t *bdiffs = dm->bdiffs;
-    int plane, i, j;
+    const AVFrame *f1 = td->f1, *f2 = td->f2;
+    int64_t *bdiffs = td->bdiffs;
+    const int by_start = (dm->nyblocks *  jobnr     ) / nb_jobs;
+    const int by_end   = (dm->nyblocks * (jobnr + 1)) / nb_jobs;
+    int plane;
 
-    memset(bdiffs, 0, dm->bdiffsize * sizeof(*bdiffs));
+    memset(bdiffs + by_start * dm->nxblocks, 0,
+           (by_end - by_start) * dm->nxblocks * sizeof(*bdiffs));
 
     for (plane = 0; plane < (dm->chroma && f1->data[2] ? 3 : 1); plane++) {
         int x, y, xl;
         const int linesize1 = f1->linesize[plane];
         const int linesize2 = f2->linesize[plane];
-        const uint8_t *f1p = f1->data[plane];
-        const uint8_t *f2p = f2->data[plane];
         int width    = plane ? AV_CEIL_RSHIFT(f1->width,  dm->hsub) : f1->width;
         int height   = plane ? AV_CEIL_RSHIFT(f1->height, dm->vsub) : f1->height;
         int hblockx  = dm->blockx / 2;
         int hblocky  = dm->blocky / 2;
+        int y_start, y_end;
+        const uint8_t *f1p, *f2p;
 
         if (plane) {
             hblockx >>= dm->hsub;
             hblocky >>= dm->vsub;
         }
 
-        for (y = 0; y < height; y++) {
+        /* each job owns whole rows of blocks */
+        y_start = FFMIN(by_start * hblocky, height);
+        y_end   = jobnr == nb_jobs - 1 ? height : FFMIN(by_end * hblocky, height);
+        f1p = f1->data[plane] + y_start * linesize1;
+        f2p = f2->data[plane] + y_start * linesize2;
+
+        for (y = y_start; y < y_end; y++) {
             int ydest = y / hblocky;
             int xdest = 0;
 
@@ -131,6 +146,24 @@ static void calc_diffs(const DecimateContext *dm, struct qitem *q,
             f2p += linesize2;
         }
     }
+}
+
+static int calc_diffs_slices(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const DecimateContext *dm = ctx->priv;
+    const ThreadData *td = arg;
+    const int nb_slices = FFMIN(dm->nyblocks, dm->nb_threads);
+
+    /* the jobs of all frames of the cycle are run at once */
+    calc_diffs_slice(dm, &td[jobnr / nb_slices], jobnr % nb_slices, nb_slices);
+    return 0;
+}
+
+static void calc_diffs(const DecimateContext *dm, struct qitem *q,
+                       const int64_t *bdiffs)
+{
+    int64_t maxdiff = -1;
+    int i, j;
 
     for (i = 0; i < dm->nyblocks - 1; i++) {
         for (j = 0; j < dm->nxblocks - 1; j++) {
@@ -149,6 +182,43 @@ static void calc_diffs(const DecimateContext *dm, struct qitem *q,
     q->maxbdiff = maxdiff;
 }
 
+/**
+ * Compute the metrics of the first nb_frames frames of the queue, the block
+ * differences of all frames are computed concurrently.
+ */
+static void calc_cycle_diffs(AVFilterContext *ctx, int nb_frames)
+{
+    DecimateContext *dm = ctx->priv;
+    const int nb_slices = FFMIN(dm->nyblocks, dm->nb_threads);
+    ThreadData td[25]; /* maximum cycle */
+    int nb_td = 0;
+
+    for (int i = 0; i < nb_frames; i++) {
+        const AVFrame *prv = i ? dm->queue[i - 1].frame : dm->last;
+
+        if (!prv)
+            continue;
+        td[nb_td].f1 = prv;
+        td[nb_td].f2 = dm->queue[i].frame;
+        td[nb_td].bdiffs = dm->bdiffs + i * dm->bdiffsize;
+        nb_td++;
+    }
+
+    if (nb_td)
+        ff_filter_execute(ctx, calc_diffs_slices, td, NULL, nb_td * nb_slices);
+
+    for (int i = 0; i < nb_frames; i++) {
+        const AVFrame *prv = i ? dm->queue[i - 1].frame : dm->last;
+
+        if (!prv) {
+            dm->queue[i].maxbdiff = INT64_MAX;
+            dm->queue[i].totdiff  = INT64_MAX;
+        } else {
+            calc_diffs(dm, &dm->queue[i], dm->bdiffs + i * dm->bdiffsize);
+        }
+    }
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     int scpos = -1, duppos = -1;
@@ -156,7 +226,6 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     AVFilterContext *ctx  = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
     DecimateContext *dm   = ctx->priv;
-    AVFrame *prv;
 
     /* update frames queue(s) */
     if (FF_INLINK_IDX(inlink) == INPUT_MAIN) {
@@ -174,16 +243,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
         in = dm->queue[dm->fid].frame;
 
     if (in) {
-        /* update frame metrics */
-        prv = dm->fid ? dm->queue[dm->fid - 1].frame : dm->last;
-        if (!prv) {
-            dm->queue[dm->fid].maxbdiff = INT64_MAX;
-            dm->queue[dm->fid].totdiff  = INT64_MAX;
-        } else {
-            calc_diffs(dm, &dm->queue[dm->fid], prv, in);
-        }
         if (++dm->fid != dm->cycle)
             return 0;
+        /* update frame metrics */
+        calc_cycle_diffs(ctx, dm->cycle);
         av_frame_free(&dm->last);
         dm->last = av_frame_clone(in);
         dm->fid = 0;
@@ -208,6 +271,8 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 
     /* metrics debug */
     if (av_log_get_level() >= AV_LOG_DEBUG) {
+        if (!in)
+            calc_cycle_diffs(ctx, dm->fid);
         av_log(ctx, AV_LOG_DEBUG, "1/%d frame drop:\n", dm->cycle);
         for (i = 0; i < dm->cycle && dm->queue[i].frame; i++) {
             av_log(ctx, AV_LOG_DEBUG,"  #%d: totdiff=%08"PRIx64" maxbdiff=%08"PRIx64"%s%s%s%s\n",
@@ -400,7 +465,8 @@ static int config_output(AVFilterLink *outlink)
     dm->nxblocks  = (w + dm->blockx/2 - 1) / (dm->blockx/2);
     dm->nyblocks  = (h + dm->blocky/2 - 1) / (dm->blocky/2);
     dm->bdiffsize = dm->nxblocks * dm->nyblocks;
-    dm->bdiffs    = av_malloc_array(dm->bdiffsize, sizeof(*dm->bdiffs));
+    dm->bdiffs    = av_malloc_array(dm->bdiffsize, dm->cycle * sizeof(*dm->bdiffs));
+    dm->nb_threads = ff_filter_get_nb_threads(ctx);
     dm->queue     = av_calloc(dm->cycle, sizeof(*dm->queue));
     dm->in_tb     = inlink->time_base;
     dm->nondec_tb = av_inv_q(fps);
@@ -454,7 +520,7 @@ const FFFilter ff_vf_decimate = {
     .p.name        = "decimate",
     .p.description = NULL_IF_CONFIG_SMALL("Decimate frames (post field matching filter)."),
     .p.priv_class  = &decimate_class,
-    .p.flags       = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .p.flags       = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
     .init          = decimate_init,
     .activate      = activate,
     .uninit        = decimate_uninit,
@@ -65,6 +65,7 @@
 enum SearchMethod {
     EXHAUSTIVE,        ///< Search all possible positions
     SMART_EXHAUSTIVE,  ///< Search most possible positions (faster)
+    PYRAMID,           ///< Search at quarter resolution and refine
     SEARCH_COUNT
 };
 
@@ -85,12 +86,30 @@ typedef struct Transform {
 } Transform;
 
 #define MAX_R 64
+#define PYR_LEVELS 3
+
+/**
+ * Results of the motion search of one slice job
+ */
+typedef struct DeshakeJob {
+    int counts[2*MAX_R+1][2*MAX_R+1];
+    double *angles;            ///< Block angles, points into the shared buffer
+    int pos;                   ///< Number of block angles
+    int center_x;
+    int center_y;
+} DeshakeJob;
 
 typedef struct DeshakeContext {
     const AVClass *class;
     int counts[2*MAX_R+1][2*MAX_R+1]; ///< Scratch buffer for motion search
     double *angles;            ///< Scratch buffer for block angles
     unsigned angles_size;
+    DeshakeJob *jobs;
+    int nb_threads;
+    uint8_t *pyr[2][PYR_LEVELS]; ///< Reference and current frame at 1/1, 1/2 and 1/4 resolution
+    int pyr_linesize[PYR_LEVELS];
+    unsigned pyr_size[2][PYR_LEVELS];
+    av_pixelutils_sad_fn pyr_sad[PYR_LEVELS]; ///< SAD of 16x16, 8x8 and 4x4 blocks
     AVFrame *ref;              ///< Previous frame
     int rx;                    ///< Maximum horizontal shift
     int ry;                    ///< Maximum vertical shift
@@ -134,6 +153,7 @@ static const AVOption deshake_options[] = {
     { "search",  "set search strategy", OFFSET(search), AV_OPT_TYPE_INT, {.i64=EXHAUSTIVE}, EXHAUSTIVE, SEARCH_COUNT-1, FLAGS, .unit = "smode" },
         { "exhaustive", "exhaustive search",      0, AV_OPT_TYPE_CONST, {.i64=EXHAUSTIVE},       0, 0, FLAGS, .unit = "smode" },
         { "less",       "less exhaustive search", 0, AV_OPT_TYPE_CONST, {.i64=SMART_EXHAUSTIVE}, 0, 0, FLAGS, .unit = "smode" },
+        { "pyramid",    "multi-resolution search", 0, AV_OPT_TYPE_CONST, {.i64=PYRAMID},         0, 0, FLAGS, .unit = "smode" },
     { "filename", "set motion search detailed log file name", OFFSET(filename), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = FLAGS },
     { "opencl", "ignored",                              OFFSET(opencl), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
     { NULL }
@@ -230,10 +250,101 @@ static void find_block_motion(DeshakeContext *deshake, uint8_t *src1,
         mv->x = -1;
         mv->y = -1;
     }
+    #undef CMP
     //av_log(NULL, AV_LOG_ERROR, "%d\n", smallest);
     //av_log(NULL, AV_LOG_ERROR, "Final: (%d, %d) = %d x %d\n", cx, cy, mv->x, mv->y);
 }
 
+/**
+ * Downscale the search area by 2 in both directions.
+ */
+static void downscale(uint8_t *dst, int dst_linesize, const uint8_t *src,
+                      int src_linesize, int width, int height)
+{
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++)
+            dst[x] = (src[2 * x] + src[2 * x + 1] +
+                      src[2 * x + src_linesize] + src[2 * x + src_linesize + 1] + 2) >> 2;
+        dst += dst_linesize;
+        src += 2 * src_linesize;
+    }
+}
+
+/**
+ * Build the lower resolution levels of the search area of both frames.
+ * The buffers have enough padding for the reads past the search area
+ * done by the SAD of the lowest blocks.
+ */
+static int build_pyramids(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
+                          int width, int height, int stride)
+{
+    uint8_t *src[2] = { src1, src2 };
+
+    for (int i = 0; i < 2; i++) {
+        for (int l = 1; l < PYR_LEVELS; l++) {
+            const int w = width >> l, h = height >> l;
+            const int linesize = FFALIGN(w + 16, 16);
+            const uint8_t *prev = l > 1 ? deshake->pyr[i][l - 1] : src[i];
+            const int prev_linesize = l > 1 ? deshake->pyr_linesize[l - 1] : stride;
+
+            av_fast_malloc(&deshake->pyr[i][l], &deshake->pyr_size[i][l],
+                           linesize * (h + 16));
+            if (!deshake->pyr[i][l])
+                return AVERROR(ENOMEM);
+            memset(deshake->pyr[i][l] + h * linesize, 0, 16 * linesize);
+            deshake->pyr_linesize[l] = linesize;
+            downscale(deshake->pyr[i][l], linesize, prev, prev_linesize, w, h);
+        }
+        deshake->pyr[i][0] = src[i];
+    }
+    deshake->pyr_linesize[0] = stride;
+
+    return 0;
+}
+
+/**
+ * Find the most likely shift of a 16x16 block with an exhaustive search at
+ * a quarter of the resolution, refined at half and full resolution.
+ */
+static void find_block_motion_pyramid(DeshakeContext *deshake, int cx, int cy,
+                                      IntMotionVector *mv)
+{
+    int smallest = INT_MAX;
+    int bx = 0, by = 0;
+
+    for (int l = PYR_LEVELS - 1; l >= 0; l--) {
+        const int stride = deshake->pyr_linesize[l];
+        const uint8_t *src1 = deshake->pyr[0][l];
+        const uint8_t *src2 = deshake->pyr[1][l];
+        const int rx = deshake->rx >> l, ry = deshake->ry >> l;
+        const int x0 = cx >> l, y0 = cy >> l;
+        const int r = l == PYR_LEVELS - 1 ? FFMAX(rx, ry) : 1;
+        int best_x = bx, best_y = by;
+
+        smallest = INT_MAX;
+        for (int y = FFMAX(by - r, -ry); y <= FFMIN(by + r, ry); y++) {
+            for (int x = FFMAX(bx - r, -rx); x <= FFMIN(bx + r, rx); x++) {
+                int diff = deshake->pyr_sad[l](src1 + y0 * stride + x0, stride,
+                                               src2 + (y0 - y) * stride + (x0 - x), stride);
+                if (diff < smallest) {
+                    smallest = diff;
+                    best_x = x;
+                    best_y = y;
+                }
+            }
+        }
+        bx = best_x * (l ? 2 : 1);
+        by = best_y * (l ? 2 : 1);
+    }
+
+    mv->x = bx;
+    mv->y = by;
+    if (smallest > 512) {
+        mv->x = -1;
+        mv->y = -1;
+    }
+}
+
 /**
  * Find the contrast of a given block. When searching for global motion we
  * really only care about the high contrast blocks, so using this method we
@@ -277,6 +388,65 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
            diff;
 }
 
+typedef struct ThreadData {
+    uint8_t *src1, *src2;
+    int width, height, stride;
+    int nb_rows, nb_cols;
+} ThreadData;
+
+/**
+ * Find the motion of the blocks of a range of block rows.
+ */
+static int find_motion_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DeshakeContext *deshake = ctx->priv;
+    ThreadData *td = arg;
+    DeshakeJob *job = &deshake->jobs[jobnr];
+    const int bh = deshake->blocksize * 2;
+    const int row_start = (td->nb_rows *  jobnr     ) / nb_jobs;
+    const int row_end   = (td->nb_rows * (jobnr + 1)) / nb_jobs;
+    IntMotionVector mv = {0, 0};
+    int x, y, contrast;
+
+    // Reset counts to zero
+    for (x = 0; x < deshake->rx * 2 + 1; x++) {
+        for (y = 0; y < deshake->ry * 2 + 1; y++) {
+            job->counts[x][y] = 0;
+        }
+    }
+    job->angles = deshake->angles + row_start * td->nb_cols;
+    job->pos = 0;
+    job->center_x = 0;
+    job->center_y = 0;
+
+    // Find motion for every block and store the motion vector in the counts
+    for (int row = row_start; row < row_end; row++) {
+        y = deshake->ry + row * bh;
+        // We use a width of 16 here to match the sad function
+        for (x = deshake->rx; x < td->width - deshake->rx - 16; x += 16) {
+            // If the contrast is too low, just skip this block as it probably
+            // won't be very useful to us.
+            contrast = block_contrast(td->src2, x, y, td->stride, deshake->blocksize);
+            if (contrast > deshake->contrast) {
+                if (deshake->search == PYRAMID)
+                    find_block_motion_pyramid(deshake, x, y, &mv);
+                else
+                    find_block_motion(deshake, td->src1, td->src2, x, y, td->stride, &mv);
+                if (mv.x != -1 && mv.y != -1) {
+                    job->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
+                    if (x > deshake->rx && y > deshake->ry)
+                        job->angles[job->pos++] = block_angle(x, y, 0, 0, &mv);
+
+                    job->center_x += mv.x;
+                    job->center_y += mv.y;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Find the estimated global motion for a scene given the most likely shift
  * for each block in the frame. The global motion is estimated to be the
@@ -284,19 +454,34 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
  * move one pixel to the right and two pixels down, this would yield a
  * motion vector (1, -2).
  */
-static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
-                        int width, int height, int stride, Transform *t)
+static int find_motion(AVFilterContext *ctx, uint8_t *src1, uint8_t *src2,
+                       int width, int height, int stride, Transform *t)
 {
+    DeshakeContext *deshake = ctx->priv;
     int x, y;
-    IntMotionVector mv = {0, 0};
     int count_max_value = 0;
-    int contrast;
+    const int bh = deshake->blocksize * 2;
+    const int nb_rows = FFMAX((height - deshake->ry - bh - deshake->ry + bh - 1) / bh, 0);
+    const int nb_cols = FFMAX((width - deshake->rx - 16 - deshake->rx + 15) / 16, 0);
+    const int nb_jobs = FFMAX(FFMIN(nb_rows, deshake->nb_threads), 1);
+    ThreadData td = { src1, src2, width, height, stride, nb_rows, nb_cols };
 
     int pos;
     int center_x = 0, center_y = 0;
     double p_x, p_y;
 
-    av_fast_malloc(&deshake->angles, &deshake->angles_size, width * height / (16 * deshake->blocksize) * sizeof(*deshake->angles));
+    av_fast_malloc(&deshake->angles, &deshake->angles_size,
+                   FFMAX(nb_rows * nb_cols, 1) * sizeof(*deshake->angles));
+    if (!deshake->angles)
+        return AVERROR(ENOMEM);
+
+    if (deshake->search == PYRAMID) {
+        int ret = build_pyramids(deshake, src1, src2, width, height, stride);
+        if (ret < 0)
+            return ret;
+    }
+
+    ff_filter_execute(ctx, find_motion_slice, &td, NULL, nb_jobs);
 
     // Reset counts to zero
     for (x = 0; x < deshake->rx * 2 + 1; x++) {
@@ -305,27 +490,20 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
         }
     }
 
+    // Merge the results of the jobs
     pos = 0;
-    // Find motion for every block and store the motion vector in the counts
-    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2) {
-        // We use a width of 16 here to match the sad function
-        for (x = deshake->rx; x < width - deshake->rx - 16; x += 16) {
-            // If the contrast is too low, just skip this block as it probably
-            // won't be very useful to us.
-            contrast = block_contrast(src2, x, y, stride, deshake->blocksize);
-            if (contrast > deshake->contrast) {
-                //av_log(NULL, AV_LOG_ERROR, "%d\n", contrast);
-                find_block_motion(deshake, src1, src2, x, y, stride, &mv);
-                if (mv.x != -1 && mv.y != -1) {
-                    deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
-                    if (x > deshake->rx && y > deshake->ry)
-                        deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
+    for (int j = 0; j < nb_jobs; j++) {
+        const DeshakeJob *job = &deshake->jobs[j];
 
-                    center_x += mv.x;
-                    center_y += mv.y;
-                }
+        for (x = 0; x < deshake->rx * 2 + 1; x++) {
+            for (y = 0; y < deshake->ry * 2 + 1; y++) {
+                deshake->counts[x][y] += job->counts[x][y];
             }
         }
+        memmove(deshake->angles + pos, job->angles, job->pos * sizeof(*deshake->angles));
+        pos += job->pos;
+        center_x += job->center_x;
+        center_y += job->center_y;
     }
 
     if (pos) {
@@ -362,6 +540,7 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
     t->angle = av_clipf(t->angle, -0.1, 0.1);
 
     //av_log(NULL, AV_LOG_ERROR, "%d x %d\n", avg->x, avg->y);
+    return 0;
 }
 
 static int deshake_transform_c(AVFilterContext *ctx,
@@ -434,6 +613,12 @@ static int config_props(AVFilterLink *link)
 {
     DeshakeContext *deshake = link->dst->priv;
 
+    deshake->nb_threads = ff_filter_get_nb_threads(link->dst);
+    av_freep(&deshake->jobs);
+    deshake->jobs = av_calloc(deshake->nb_threads, sizeof(*deshake->jobs));
+    if (!deshake->jobs)
+        return AVERROR(ENOMEM);
+
     deshake->ref = NULL;
     deshake->last.vec.x = 0;
     deshake->last.vec.y = 0;
@@ -449,6 +634,11 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&deshake->ref);
     av_freep(&deshake->angles);
     deshake->angles_size = 0;
+    av_freep(&deshake->jobs);
+    for (int i = 0; i < 2; i++) {
+        for (int l = 1; l < PYR_LEVELS; l++)
+            av_freep(&deshake->pyr[i][l]);
+    }
     if (deshake->fp)
         fclose(deshake->fp);
 }
@@ -482,10 +672,19 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         ret = AVERROR(EINVAL);
         goto fail;
     }
+    if (deshake->search == PYRAMID) {
+        deshake->pyr_sad[0] = deshake->sad;
+        deshake->pyr_sad[1] = av_pixelutils_get_sad_fn(3, 3, 0, deshake); // 8x8
+        deshake->pyr_sad[2] = av_pixelutils_get_sad_fn(2, 2, 0, deshake); // 4x4
+        if (!deshake->pyr_sad[1] || !deshake->pyr_sad[2]) {
+            ret = AVERROR(EINVAL);
+            goto fail;
+        }
+    }
 
     if (deshake->cx < 0 || deshake->cy < 0 || deshake->cw < 0 || deshake->ch < 0) {
         // Find the most likely global motion for the current frame
-        find_motion(deshake, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
+        ret = find_motion(link->dst, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
     } else {
         uint8_t *src1 = (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0];
         uint8_t *src2 = in->data[0];
@@ -502,8 +701,10 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         src1 += deshake->cy * in->linesize[0] + deshake->cx;
         src2 += deshake->cy * in->linesize[0] + deshake->cx;
 
-        find_motion(deshake, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+        ret = find_motion(link->dst, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
     }
+    if (ret < 0)
+        goto fail;
 
 
     // Copy transform so we can output it later to compare to the smoothed value
@@ -576,6 +777,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
 
     return ff_filter_frame(outlink, out);
 fail:
+    av_frame_free(&in);
     av_frame_free(&out);
     return ret;
 }
@@ -593,6 +795,7 @@ const FFFilter ff_vf_deshake = {
     .p.name        = "deshake",
     .p.description = NULL_IF_CONFIG_SMALL("Stabilize shaky video."),
     .p.priv_class  = &deshake_class,
+    .p.flags       = AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(DeshakeContext),
     .init          = init,
     .uninit        = uninit,
@@ -111,6 +111,8 @@ typedef struct FieldMatchContext {
     int *c_array;
     int tpitchy, tpitchuv;
     uint8_t *tbuffer;
+    int nb_threads;
+    uint64_t (*accum)[6];           ///< per-job metric accumulators
 } FieldMatchContext;
 
 #define OFFSET(x) offsetof(FieldMatchContext, x)
@@ -165,23 +167,44 @@ static int get_height(const FieldMatchContext *fm, const AVFrame *f, int plane,
     return plane ? AV_CEIL_RSHIFT(f->height, fm->vsub[input]) : f->height;
 }
 
-static int64_t luma_abs_diff(const AVFrame *f1, const AVFrame *f2)
+typedef struct LumaDiffData {
+    const AVFrame *f1, *f2;
+} LumaDiffData;
+
+static int luma_abs_diff_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int x, y;
-    const uint8_t *srcp1 = f1->data[0];
-    const uint8_t *srcp2 = f2->data[0];
+    FieldMatchContext *fm = ctx->priv;
+    const LumaDiffData *td = arg;
+    const AVFrame *f1 = td->f1, *f2 = td->f2;
     const int src1_linesize = f1->linesize[0];
     const int src2_linesize = f2->linesize[0];
-    const int width  = f1->width;
-    const int height = f1->height;
+    const int width   = f1->width;
+    const int y_start = (f1->height *  jobnr     ) / nb_jobs;
+    const int y_end   = (f1->height * (jobnr + 1)) / nb_jobs;
+    const uint8_t *srcp1 = f1->data[0] + y_start * src1_linesize;
+    const uint8_t *srcp2 = f2->data[0] + y_start * src2_linesize;
     int64_t acc = 0;
 
-    for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++)
+    for (int y = y_start; y < y_end; y++) {
+        for (int x = 0; x < width; x++)
             acc += abs(srcp1[x] - srcp2[x]);
         srcp1 += src1_linesize;
         srcp2 += src2_linesize;
     }
+    fm->accum[jobnr][0] = acc;
+    return 0;
+}
+
+static int64_t luma_abs_diff(AVFilterContext *ctx, const AVFrame *f1, const AVFrame *f2)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const int nb_jobs = FFMIN(f1->height, fm->nb_threads);
+    LumaDiffData td = { .f1 = f1, .f2 = f2 };
+    int64_t acc = 0;
+
+    ff_filter_execute(ctx, luma_abs_diff_slice, &td, NULL, nb_jobs);
+    for (int i = 0; i < nb_jobs; i++)
+        acc += fm->accum[i][0];
     return acc;
 }
 
@@ -195,25 +218,33 @@ static void fill_buf(uint8_t *data, int w, int h, int linesize, uint8_t v)
     }
 }
 
-static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
+typedef struct CombData {
+    const AVFrame *src;
+} CombData;
+
+static int build_cmask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int x, y, plane, max_v = 0;
+    const FieldMatchContext *fm = ctx->priv;
+    const CombData *td = arg;
+    const AVFrame *src = td->src;
     const int cthresh = fm->cthresh;
     const int cthresh6 = cthresh * 6;
 
-    for (plane = 0; plane < (fm->chroma ? 3 : 1); plane++) {
-        const uint8_t *srcp = src->data[plane];
+    for (int plane = 0; plane < (fm->chroma ? 3 : 1); plane++) {
         const int src_linesize = src->linesize[plane];
         const int width  = get_width (fm, src, plane, INPUT_MAIN);
         const int height = get_height(fm, src, plane, INPUT_MAIN);
-        uint8_t *cmkp = fm->cmask_data[plane];
         const int cmk_linesize = fm->cmask_linesize[plane];
+        const int y_start = (height *  jobnr     ) / nb_jobs;
+        const int y_end   = (height * (jobnr + 1)) / nb_jobs;
+        const uint8_t *srcp = src->data[plane] + y_start * src_linesize;
+        uint8_t *cmkp = fm->cmask_data[plane] + y_start * cmk_linesize;
 
         if (cthresh < 0) {
-            fill_buf(cmkp, width, height, cmk_linesize, 0xff);
+            fill_buf(cmkp, width, y_end - y_start, cmk_linesize, 0xff);
             continue;
         }
-        fill_buf(cmkp, width, height, cmk_linesize, 0);
+        fill_buf(cmkp, width, y_end - y_start, cmk_linesize, 0);
 
         /* [1 -3 4 -3 1] vertical filter */
 #define FILTER(xm2, xm1, xp1, xp2) \
@@ -221,54 +252,62 @@ static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
              -3 * (srcp[x + (xm1)*src_linesize] + srcp[x + (xp1)*src_linesize]) \
              +    (srcp[x + (xm2)*src_linesize] + srcp[x + (xp2)*src_linesize])) > cthresh6
 
-        /* first line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && FILTER(2, 1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* second line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(2, -1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* all lines minus first two and last two */
-        for (y = 2; y < height-2; y++) {
-            for (x = 0; x < width; x++) {
-                const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-                const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-                if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, 2))
-                    cmkp[x] = 0xff;
+        for (int y = y_start; y < y_end; y++) {
+            if (y == 0) {
+                /* first line */
+                for (int x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x + src_linesize]);
+                    if (s1 > cthresh && FILTER(2, 1, 1, 2))
+                        cmkp[x] = 0xff;
+                }
+            } else if (y == 1) {
+                /* second line */
+                for (int x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                    const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
+                    if (s1 > cthresh && s2 > cthresh && FILTER(2, -1, 1, 2))
+                        cmkp[x] = 0xff;
+                }
+            } else if (y == height - 1) {
+                /* last line */
+                for (int x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                    if (s1 > cthresh && FILTER(-2, -1, -1, -2))
+                        cmkp[x] = 0xff;
+                }
+            } else if (y == height - 2) {
+                /* before-last line */
+                for (int x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                    const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
+                    if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, -2))
+                        cmkp[x] = 0xff;
+                }
+            } else {
+                /* all lines minus first two and last two */
+                for (int x = 0; x < width; x++) {
+                    const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
+                    const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
+                    if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, 2))
+                        cmkp[x] = 0xff;
+                }
             }
             srcp += src_linesize;
             cmkp += cmk_linesize;
         }
-
-        /* before-last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, -2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            if (s1 > cthresh && FILTER(-2, -1, -1, -2))
-                cmkp[x] = 0xff;
-        }
     }
+    return 0;
+}
+
+static int calc_combed_score(AVFilterContext *ctx, const AVFrame *src)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    CombData td = { .src = src };
+    int x, y, max_v = 0;
+
+    ff_filter_execute(ctx, build_cmask_slice, &td, NULL,
+                      FFMIN(AV_CEIL_RSHIFT(src->height, fm->chroma ? fm->vsub[INPUT_MAIN] : 0),
+                            fm->nb_threads));
 
     if (fm->chroma) {
         uint8_t *cmkp  = fm->cmask_data[0];
@@ -412,22 +451,17 @@ static void build_abs_diff_mask(const uint8_t *prvp, int prv_linesize,
 }
 
 /**
- * Build a map over which pixels differ a lot/a little
+ * Build a map over which pixels differ a lot/a little, for the field lines
+ * y_start to y_end (exclusive, in steps of 2) from the absolute difference
+ * mask dp
  */
-static void build_diff_map(FieldMatchContext *fm,
-                           const uint8_t *prvp, int prv_linesize,
-                           const uint8_t *nxtp, int nxt_linesize,
+static void build_diff_map(const uint8_t *dp, int tpitch,
                            uint8_t *dstp, int dst_linesize, int height,
-                           int width, int plane)
+                           int width, int y_start, int y_end)
 {
     int x, y, u, diff, count;
-    int tpitch = plane ? fm->tpitchuv : fm->tpitchy;
-    const uint8_t *dp = fm->tbuffer + tpitch;
-
-    build_abs_diff_mask(prvp, prv_linesize, nxtp, nxt_linesize,
-                        fm->tbuffer, tpitch, width, height>>1);
 
-    for (y = 2; y < height - 2; y += 2) {
+    for (y = y_start; y < y_end; y += 2) {
         for (x = 1; x < width - 1; x++) {
             diff = dp[x];
             if (diff > 3) {
@@ -486,8 +520,130 @@ static AVFrame *select_frame(FieldMatchContext *fm, int match)
     else  /* match == mC */              return fm->src;
 }
 
-static int compare_fields(FieldMatchContext *fm, int match1, int match2, int field)
+typedef struct CompareData {
+    int width, height, tpitch;
+    int startx, stopx, y0a, y1a;
+    uint8_t *map;                   ///< start of the map plane
+    int map_linesize;
+    const uint8_t *mprvp, *mnxtp;   ///< fields the diff map is built from
+    int mprv_linesize, mnxt_linesize;
+    uint8_t *dmapp;                 ///< first line written by build_diff_map()
+    uint8_t *mapp;                  ///< first map line of the compared field
+    int mapf_linesize;
+    const uint8_t *srcpf, *srcf, *srcnf;
+    const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
+    int srcf_linesize, prvf_linesize, nxtf_linesize;
+} CompareData;
+
+/* number of field lines processed by build_diff_map() and the matching */
+static int nb_field_lines(int height)
+{
+    return FFMAX((height - 3) / 2, 0);
+}
+
+static int abs_diff_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const CompareData *td = arg;
+    const int hh = td->height >> 1;
+    const int h_start = (hh *  jobnr     ) / nb_jobs;
+    const int h_end   = (hh * (jobnr + 1)) / nb_jobs;
+    const int y_start = (td->height *  jobnr     ) / nb_jobs;
+    const int y_end   = (td->height * (jobnr + 1)) / nb_jobs;
+
+    fill_buf(td->map + y_start * td->map_linesize, td->width,
+             y_end - y_start, td->map_linesize, 0);
+    build_abs_diff_mask(td->mprvp + h_start * td->mprv_linesize, td->mprv_linesize,
+                        td->mnxtp + h_start * td->mnxt_linesize, td->mnxt_linesize,
+                        fm->tbuffer + h_start * td->tpitch, td->tpitch,
+                        td->width, h_end - h_start);
+    return 0;
+}
+
+static int diff_map_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const CompareData *td = arg;
+    const int nb_lines = nb_field_lines(td->height);
+    const int l_start = (nb_lines *  jobnr     ) / nb_jobs;
+    const int l_end   = (nb_lines * (jobnr + 1)) / nb_jobs;
+
+    build_diff_map(fm->tbuffer + (l_start + 1) * td->tpitch, td->tpitch,
+                   td->dmapp + l_start * td->mapf_linesize, td->mapf_linesize,
+                   td->height, td->width, 2 + 2 * l_start, 2 + 2 * l_end);
+    return 0;
+}
+
+static int match_fields_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const CompareData *td = arg;
+    const int nb_lines = nb_field_lines(td->height);
+    const int l_start = (nb_lines *  jobnr     ) / nb_jobs;
+    const int l_end   = (nb_lines * (jobnr + 1)) / nb_jobs;
+    const int map_linesize = td->mapf_linesize;
+    const uint8_t *mapp  = td->mapp  + l_start * map_linesize;
+    const uint8_t *srcpf = td->srcpf + l_start * td->srcf_linesize;
+    const uint8_t *srcf  = td->srcf  + l_start * td->srcf_linesize;
+    const uint8_t *srcnf = td->srcnf + l_start * td->srcf_linesize;
+    const uint8_t *prvpf = td->prvpf + l_start * td->prvf_linesize;
+    const uint8_t *prvnf = td->prvnf + l_start * td->prvf_linesize;
+    const uint8_t *nxtpf = td->nxtpf + l_start * td->nxtf_linesize;
+    const uint8_t *nxtnf = td->nxtnf + l_start * td->nxtf_linesize;
+    uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
+    uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
+    int x, y, temp1, temp2;
+
+    for (y = 2 + 2 * l_start; y < 2 + 2 * l_end; y += 2) {
+        if (td->y0a == td->y1a || y < td->y0a || y > td->y1a) {
+            for (x = td->startx; x < td->stopx; x++) {
+                if (mapp[x] > 0 || mapp[x + map_linesize] > 0) {
+                    temp1 = srcpf[x] + (srcf[x] << 2) + srcnf[x]; // [1 4 1]
+
+                    temp2 = abs(3 * (prvpf[x] + prvnf[x]) - temp1);
+                    if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
+                        accumPc += temp2;
+                    if (temp2 > 42) {
+                        if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
+                            accumPm += temp2;
+                        if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
+                            accumPml += temp2;
+                    }
+
+                    temp2 = abs(3 * (nxtpf[x] + nxtnf[x]) - temp1);
+                    if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
+                        accumNc += temp2;
+                    if (temp2 > 42) {
+                        if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
+                            accumNm += temp2;
+                        if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
+                            accumNml += temp2;
+                    }
+                }
+            }
+        }
+        prvpf += td->prvf_linesize;
+        prvnf += td->prvf_linesize;
+        srcpf += td->srcf_linesize;
+        srcf  += td->srcf_linesize;
+        srcnf += td->srcf_linesize;
+        nxtpf += td->nxtf_linesize;
+        nxtnf += td->nxtf_linesize;
+        mapp  += map_linesize;
+    }
+
+    fm->accum[jobnr][0] += accumPc;
+    fm->accum[jobnr][1] += accumPm;
+    fm->accum[jobnr][2] += accumPml;
+    fm->accum[jobnr][3] += accumNc;
+    fm->accum[jobnr][4] += accumNm;
+    fm->accum[jobnr][5] += accumNml;
+    return 0;
+}
+
+static int compare_fields(AVFilterContext *ctx, int match1, int match2, int field)
 {
+    FieldMatchContext *fm = ctx->priv;
     int plane, ret;
     uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
     uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
@@ -495,92 +651,75 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
     float c1, c2, mr;
     const AVFrame *src = fm->src;
 
+    memset(fm->accum, 0, fm->nb_threads * sizeof(*fm->accum));
+
     for (plane = 0; plane < (fm->mchroma ? 3 : 1); plane++) {
-        int x, y, temp1, temp2, fbase;
+        CompareData td;
+        int fbase, nb_jobs;
         const AVFrame *prev, *next;
-        uint8_t *mapp    = fm->map_data[plane];
-        int map_linesize = fm->map_linesize[plane];
         const uint8_t *srcp = src->data[plane];
-        const int src_linesize  = src->linesize[plane];
-        const int srcf_linesize = src_linesize << 1;
-        int prv_linesize,  nxt_linesize;
-        int prvf_linesize, nxtf_linesize;
-        const int width  = get_width (fm, src, plane, INPUT_MAIN);
-        const int height = get_height(fm, src, plane, INPUT_MAIN);
-        const int y0a = fm->y0 >> (plane ? fm->vsub[INPUT_MAIN] : 0);
-        const int y1a = fm->y1 >> (plane ? fm->vsub[INPUT_MAIN] : 0);
-        const int startx = (plane == 0 ? 8 : 8 >> fm->hsub[INPUT_MAIN]);
-        const int stopx  = width - startx;
-        const uint8_t *srcpf, *srcf, *srcnf;
-        const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
-
-        fill_buf(mapp, width, height, map_linesize, 0);
+        const int src_linesize = src->linesize[plane];
+        int prv_linesize, nxt_linesize;
+
+        td.width  = get_width (fm, src, plane, INPUT_MAIN);
+        td.height = get_height(fm, src, plane, INPUT_MAIN);
+        td.tpitch = plane ? fm->tpitchuv : fm->tpitchy;
+        td.y0a    = fm->y0 >> (plane ? fm->vsub[INPUT_MAIN] : 0);
+        td.y1a    = fm->y1 >> (plane ? fm->vsub[INPUT_MAIN] : 0);
+        td.startx = (plane == 0 ? 8 : 8 >> fm->hsub[INPUT_MAIN]);
+        td.stopx  = td.width - td.startx;
+        td.map           = fm->map_data[plane];
+        td.map_linesize  = fm->map_linesize[plane];
+        td.mapf_linesize = td.map_linesize << 1;
 
         /* match1 */
         fbase = get_field_base(match1, field);
-        srcf  = srcp + (fbase + 1) * src_linesize;
-        srcpf = srcf - srcf_linesize;
-        srcnf = srcf + srcf_linesize;
-        mapp  = mapp + fbase * map_linesize;
+        td.srcf_linesize = src_linesize << 1;
+        td.srcf  = srcp + (fbase + 1) * src_linesize;
+        td.srcpf = td.srcf - td.srcf_linesize;
+        td.srcnf = td.srcf + td.srcf_linesize;
+        td.mapp  = td.map + fbase * td.map_linesize;
         prev = select_frame(fm, match1);
-        prv_linesize  = prev->linesize[plane];
-        prvf_linesize = prv_linesize << 1;
-        prvpf = prev->data[plane] + fbase * prv_linesize;   // previous frame, previous field
-        prvnf = prvpf + prvf_linesize;                      // previous frame, next     field
+        prv_linesize     = prev->linesize[plane];
+        td.prvf_linesize = prv_linesize << 1;
+        td.prvpf = prev->data[plane] + fbase * prv_linesize;   // previous frame, previous field
+        td.prvnf = td.prvpf + td.prvf_linesize;                // previous frame, next     field
 
         /* match2 */
         fbase = get_field_base(match2, field);
         next = select_frame(fm, match2);
-        nxt_linesize  = next->linesize[plane];
-        nxtf_linesize = nxt_linesize << 1;
-        nxtpf = next->data[plane] + fbase * nxt_linesize;   // next frame, previous field
-        nxtnf = nxtpf + nxtf_linesize;                      // next frame, next     field
-
-        map_linesize <<= 1;
-        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1))
-            build_diff_map(fm, prvpf, prvf_linesize, nxtpf, nxtf_linesize,
-                           mapp, map_linesize, height, width, plane);
-        else
-            build_diff_map(fm, prvnf, prvf_linesize, nxtnf, nxtf_linesize,
-                           mapp + map_linesize, map_linesize, height, width, plane);
-
-        for (y = 2; y < height - 2; y += 2) {
-            if (y0a == y1a || y < y0a || y > y1a) {
-                for (x = startx; x < stopx; x++) {
-                    if (mapp[x] > 0 || mapp[x + map_linesize] > 0) {
-                        temp1 = srcpf[x] + (srcf[x] << 2) + srcnf[x]; // [1 4 1]
-
-                        temp2 = abs(3 * (prvpf[x] + prvnf[x]) - temp1);
-                        if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
-                            accumPc += temp2;
-                        if (temp2 > 42) {
-                            if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
-                                accumPm += temp2;
-                            if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
-                                accumPml += temp2;
-                        }
-
-                        temp2 = abs(3 * (nxtpf[x] + nxtnf[x]) - temp1);
-                        if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
-                            accumNc += temp2;
-                        if (temp2 > 42) {
-                            if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
-                                accumNm += temp2;
-                            if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
-                                accumNml += temp2;
-                        }
-                    }
-                }
-            }
-            prvpf += prvf_linesize;
-            prvnf += prvf_linesize;
-            srcpf += srcf_linesize;
-            srcf  += srcf_linesize;
-            srcnf += srcf_linesize;
-            nxtpf += nxtf_linesize;
-            nxtnf += nxtf_linesize;
-            mapp  += map_linesize;
+        nxt_linesize     = next->linesize[plane];
+        td.nxtf_linesize = nxt_linesize << 1;
+        td.nxtpf = next->data[plane] + fbase * nxt_linesize;   // next frame, previous field
+        td.nxtnf = td.nxtpf + td.nxtf_linesize;                // next frame, next     field
+
+        td.mprv_linesize = td.prvf_linesize;
+        td.mnxt_linesize = td.nxtf_linesize;
+        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1)) {
+            td.mprvp = td.prvpf;
+            td.mnxtp = td.nxtpf;
+            td.dmapp = td.mapp;
+        } else {
+            td.mprvp = td.prvnf;
+            td.mnxtp = td.nxtnf;
+            td.dmapp = td.mapp + td.mapf_linesize;
         }
+
+        /* every pass reads lines written by neighbouring jobs of the previous one */
+        nb_jobs = FFMIN(FFMAX(td.height >> 1, 1), fm->nb_threads);
+        ff_filter_execute(ctx, abs_diff_mask_slice, &td, NULL, nb_jobs);
+        nb_jobs = FFMIN(FFMAX(nb_field_lines(td.height), 1), fm->nb_threads);
+        ff_filter_execute(ctx, diff_map_slice, &td, NULL, nb_jobs);
+        ff_filter_execute(ctx, match_fields_slice, &td, NULL, nb_jobs);
+    }
+
+    for (int i = 0; i < fm->nb_threads; i++) {
+        accumPc  += fm->accum[i][0];
+        accumPm  += fm->accum[i][1];
+        accumPml += fm->accum[i][2];
+        accumNc  += fm->accum[i][3];
+        accumNm  += fm->accum[i][4];
+        accumNml += fm->accum[i][5];
     }
 
     if (accumPm < 500 && accumNm < 500 && (accumPml >= 500 || accumNml >= 500) &&
@@ -659,7 +798,7 @@ static int checkmm(AVFilterContext *ctx, int *combs, int m1, int m2,
             gen_frames[mid] = create_weave_frame(ctx, mid, field,               \
                                                  fm->prv, fm->src, fm->nxt,     \
                                                  INPUT_MAIN);                   \
-        combs[mid] = calc_combed_score(fm, gen_frames[mid]);                    \
+        combs[mid] = calc_combed_score(ctx, gen_frames[mid]);                    \
     }                                                                           \
 } while (0)
 
@@ -734,7 +873,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
                 ret = AVERROR(ENOMEM);
                 goto fail;
             }
-            combs[i] = calc_combed_score(fm, gen_frames[i]);
+            combs[i] = calc_combed_score(ctx, gen_frames[i]);
         }
         av_log(ctx, AV_LOG_INFO, "COMBS: %3d %3d %3d %3d %3d\n",
                combs[0], combs[1], combs[2], combs[3], combs[4]);
@@ -747,22 +886,22 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
 
     /* p/c selection and optional 3-way p/c/n matches */
-    match = compare_fields(fm, fxo[mC], fxo[mP], field);
+    match = compare_fields(ctx, fxo[mC], fxo[mP], field);
     if (fm->mode == MODE_PCN || fm->mode == MODE_PCN_UB)
-        match = compare_fields(fm, match, fxo[mN], field);
+        match = compare_fields(ctx, match, fxo[mN], field);
 
     /* scene change check */
     if (fm->combmatch == COMBMATCH_SC) {
         if (fm->lastn == outl->frame_count_in - 1) {
             if (fm->lastscdiff > fm->scthresh)
                 sc = 1;
-        } else if (luma_abs_diff(fm->prv, fm->src) > fm->scthresh) {
+        } else if (luma_abs_diff(ctx, fm->prv, fm->src) > fm->scthresh) {
             sc = 1;
         }
 
         if (!sc) {
             fm->lastn = outl->frame_count_in;
-            fm->lastscdiff = luma_abs_diff(fm->src, fm->nxt);
+            fm->lastscdiff = luma_abs_diff(ctx, fm->src, fm->nxt);
             sc = fm->lastscdiff > fm->scthresh;
         }
     }
@@ -973,10 +1112,12 @@ static int config_input(AVFilterLink *inlink)
     fm->tpitchuv = FFALIGN(w >> 1, 16);
 
     fm->tbuffer = av_calloc((h/2 + 4) * fm->tpitchy, sizeof(*fm->tbuffer));
+    fm->nb_threads = ff_filter_get_nb_threads(ctx);
+    fm->accum = av_calloc(fm->nb_threads, sizeof(*fm->accum));
     fm->c_array = av_malloc_array((((w + fm->blockx/2)/fm->blockx)+1) *
                             (((h + fm->blocky/2)/fm->blocky)+1),
                             4 * sizeof(*fm->c_array));
-    if (!fm->tbuffer || !fm->c_array)
+    if (!fm->tbuffer || !fm->c_array || !fm->accum)
         return AVERROR(ENOMEM);
 
     return 0;
@@ -1034,6 +1175,7 @@ static av_cold void fieldmatch_uninit(AVFilterContext *ctx)
     av_freep(&fm->cmask_data[0]);
     av_freep(&fm->tbuffer);
     av_freep(&fm->c_array);
+    av_freep(&fm->accum);
 }
 
 static int config_output(AVFilterLink *outlink)
@@ -1067,7 +1209,7 @@ const FFFilter ff_vf_fieldmatch = {
     .p.name         = "fieldmatch",
     .p.description  = NULL_IF_CONFIG_SMALL("Field matching for inverse telecine."),
     .p.priv_class   = &fieldmatch_class,
-    .p.flags        = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .p.flags        = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
     .priv_size      = sizeof(FieldMatchContext),
     .init           = fieldmatch_init,
     .activate       = activate,
@@ -24,6 +24,9 @@
  * Rich Felker.
  */
 
+#include <stdatomic.h>
+
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/pixelutils.h"
@@ -51,6 +54,11 @@ typedef struct DecimateContext {
     int hsub, vsub;                ///< chroma subsampling values
     AVFrame *ref;                  ///< reference picture
     av_pixelutils_sad_fn sad;      ///< sum of absolute difference function
+
+    int nb_threads;
+    int *counts;                   ///< per-job number of blocks over the low threshold
+    int *hi_diffs;                 ///< per-job difference over the high threshold, or -1
+    atomic_int done;               ///< set once a job found the planes to be different
 } DecimateContext;
 
 #define OFFSET(x) offsetof(DecimateContext, x)
@@ -69,40 +77,86 @@ static const AVOption mpdecimate_options[] = {
 
 AVFILTER_DEFINE_CLASS(mpdecimate);
 
-/**
- * Return 1 if the two planes are different, 0 otherwise.
- */
-static int diff_planes(AVFilterContext *ctx,
-                       uint8_t *cur, int cur_linesize,
-                       uint8_t *ref, int ref_linesize,
-                       int w, int h)
+typedef struct ThreadData {
+    const uint8_t *cur, *ref;
+    int cur_linesize, ref_linesize;
+    int w, h, t;
+} ThreadData;
+
+static int diff_planes_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     DecimateContext *decimate = ctx->priv;
+    const ThreadData *td = arg;
+    const int nb_rows = (td->h - 7 + 3) / 4;
+    const int y_start = 4 * ((nb_rows *  jobnr     ) / nb_jobs);
+    const int y_end   = 4 * ((nb_rows * (jobnr + 1)) / nb_jobs);
+    int x, y, d, c = 0;
 
-    int x, y;
-    int d, c = 0;
-    int t = (w/16)*(h/16)*decimate->frac;
+    decimate->hi_diffs[jobnr] = -1;
 
     /* compute difference for blocks of 8x8 bytes */
-    for (y = 0; y < h-7; y += 4) {
-        for (x = 8; x < w-7; x += 4) {
-            d = decimate->sad(cur + y*cur_linesize + x, cur_linesize,
-                              ref + y*ref_linesize + x, ref_linesize);
+    for (y = y_start; y < y_end; y += 4) {
+        /* the result is already known if another job got over a threshold */
+        if (atomic_load_explicit(&decimate->done, memory_order_relaxed))
+            break;
+        for (x = 8; x < td->w-7; x += 4) {
+            d = decimate->sad(td->cur + y*td->cur_linesize + x, td->cur_linesize,
+                              td->ref + y*td->ref_linesize + x, td->ref_linesize);
             if (d > decimate->hi) {
-                av_log(ctx, AV_LOG_DEBUG, "%d>=hi ", d);
-                return 1;
+                decimate->hi_diffs[jobnr] = d;
+                atomic_store_explicit(&decimate->done, 1, memory_order_relaxed);
+                goto end;
             }
             if (d > decimate->lo) {
                 c++;
-                if (c > t) {
-                    av_log(ctx, AV_LOG_DEBUG, "lo:%d>=%d ", c, t);
-                    return 1;
+                if (c > td->t) {
+                    atomic_store_explicit(&decimate->done, 1, memory_order_relaxed);
+                    goto end;
                 }
             }
         }
     }
 
-    av_log(ctx, AV_LOG_DEBUG, "lo:%d<%d ", c, t);
+end:
+    decimate->counts[jobnr] = c;
+    return 0;
+}
+
+/**
+ * Return 1 if the two planes are different, 0 otherwise.
+ */
+static int diff_planes(AVFilterContext *ctx,
+                       uint8_t *cur, int cur_linesize,
+                       uint8_t *ref, int ref_linesize,
+                       int w, int h)
+{
+    DecimateContext *decimate = ctx->priv;
+    ThreadData td = {
+        .cur = cur, .cur_linesize = cur_linesize,
+        .ref = ref, .ref_linesize = ref_linesize,
+        .w = w, .h = h,
+        .t = (w/16)*(h/16)*decimate->frac,
+    };
+    const int nb_jobs = FFMIN(FFMAX((h - 7 + 3) / 4, 1), decimate->nb_threads);
+    int c = 0;
+
+    atomic_init(&decimate->done, 0);
+    ff_filter_execute(ctx, diff_planes_slice, &td, NULL, nb_jobs);
+
+    for (int i = 0; i < nb_jobs; i++) {
+        if (decimate->hi_diffs[i] >= 0) {
+            av_log(ctx, AV_LOG_DEBUG, "%d>=hi ", decimate->hi_diffs[i]);
+            return 1;
+        }
+        c += decimate->counts[i];
+    }
+
+    if (c > td.t) {
+        av_log(ctx, AV_LOG_DEBUG, "lo:%d>=%d ", c, td.t);
+        return 1;
+    }
+
+    av_log(ctx, AV_LOG_DEBUG, "lo:%d<%d ", c, td.t);
     return 0;
 }
 
@@ -166,6 +220,8 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     DecimateContext *decimate = ctx->priv;
     av_frame_free(&decimate->ref);
+    av_freep(&decimate->counts);
+    av_freep(&decimate->hi_diffs);
 }
 
 static const enum AVPixelFormat pix_fmts[] = {
@@ -192,6 +248,12 @@ static int config_input(AVFilterLink *inlink)
     decimate->hsub = pix_desc->log2_chroma_w;
     decimate->vsub = pix_desc->log2_chroma_h;
 
+    decimate->nb_threads = ff_filter_get_nb_threads(ctx);
+    decimate->counts   = av_calloc(decimate->nb_threads, sizeof(*decimate->counts));
+    decimate->hi_diffs = av_calloc(decimate->nb_threads, sizeof(*decimate->hi_diffs));
+    if (!decimate->counts || !decimate->hi_diffs)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
@@ -241,6 +303,7 @@ const FFFilter ff_vf_mpdecimate = {
     .p.name        = "mpdecimate",
     .p.description = NULL_IF_CONFIG_SMALL("Remove near-duplicate frames."),
     .p.priv_class  = &mpdecimate_class,
+    .p.flags       = AVFILTER_FLAG_SLICE_THREADS,
     .init          = init,
     .uninit        = uninit,
     .priv_size     = sizeof(DecimateContext),
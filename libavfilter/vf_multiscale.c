@@ -0,0 +1,407 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file
+ * scale one input video to several output sizes at once
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "video.h"
+
+typedef struct MultiScaleContext {
+    const AVClass *class;
+
+    char *sizes_str;
+    char *flags_str;
+    int format;
+    int cascade;
+    int out_primaries;
+    int out_transfer;
+
+    SwsContext *sws;
+    int *w, *h;
+    AVFrame **frames; /* per output, NULL if the output is closed */
+    AVFrame **dsts;   /* frames of the open outputs */
+} MultiScaleContext;
+
+static av_cold int preinit(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+
+    s->sws = sws_alloc_context();
+    if (!s->sws)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink);
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+    char *p, *arg, *saveptr = NULL;
+    int ret, nb_sizes = 1;
+
+    if (!s->sizes_str || !*s->sizes_str) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified.\n");
+        return AVERROR(EINVAL);
+    }
+
+    for (p = s->sizes_str; *p; p++)
+        nb_sizes += *p == '|';
+
+    s->w      = av_calloc(nb_sizes, sizeof(*s->w));
+    s->h      = av_calloc(nb_sizes, sizeof(*s->h));
+    s->frames = av_calloc(nb_sizes, sizeof(*s->frames));
+    s->dsts   = av_calloc(nb_sizes, sizeof(*s->dsts));
+    if (!s->w || !s->h || !s->frames || !s->dsts)
+        return AVERROR(ENOMEM);
+
+    p = s->sizes_str;
+    for (int i = 0; i < nb_sizes; i++) {
+        AVFilterPad pad = {
+            .type         = AVMEDIA_TYPE_VIDEO,
+            .config_props = config_output,
+        };
+
+        if (!(arg = av_strtok(p, "|", &saveptr)))
+            break;
+        p = NULL;
+
+        ret = av_parse_video_size(&s->w[i], &s->h[i], arg);
+        if (ret < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid size '%s'\n", arg);
+            return ret;
+        }
+
+        pad.name = av_asprintf("output%d", i);
+        if (!pad.name)
+            return AVERROR(ENOMEM);
+
+        if ((ret = ff_append_outpad_free_name(ctx, &pad)) < 0)
+            return ret;
+    }
+
+    if (s->out_primaries != -1 && !sws_test_primaries(s->out_primaries, 1)) {
+        av_log(ctx, AV_LOG_ERROR, "Unsupported output primaries '%s'\n",
+               av_color_primaries_name(s->out_primaries));
+        return AVERROR(EINVAL);
+    }
+
+    if (s->out_transfer != -1 && !sws_test_transfer(s->out_transfer, 1)) {
+        av_log(ctx, AV_LOG_ERROR, "Unsupported output transfer '%s'\n",
+               av_color_transfer_name(s->out_transfer));
+        return AVERROR(EINVAL);
+    }
+
+    if (s->flags_str && *s->flags_str) {
+        ret = av_opt_set(s->sws, "sws_flags", s->flags_str, 0);
+        if (ret < 0)
+            return ret;
+    }
+    if (s->cascade)
+        s->sws->flags |= SWS_CASCADE;
+    s->sws->threads = ff_filter_get_nb_threads(ctx);
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MultiScaleContext *s = ctx->priv;
+
+    sws_free_context(&s->sws);
+    av_freep(&s->w);
+    av_freep(&s->h);
+    av_freep(&s->frames);
+    av_freep(&s->dsts);
+}
+
+static AVFilterFormats *supported_colorspaces(int output)
+{
+    AVFilterFormats *formats = ff_all_color_spaces();
+
+    for (int i = 0; formats && i < formats->nb_formats; i++) {
+        if (!sws_test_colorspace(formats->formats[i], output)) {
+            for (int j = i--; j + 1 < formats->nb_formats; j++)
+                formats->formats[j] = formats->formats[j + 1];
+            formats->nb_formats--;
+        }
+    }
+
+    return formats;
+}
+
+static AVFilterFormats *supported_formats(int output)
+{
+    const AVPixFmtDescriptor *desc = NULL;
+    AVFilterFormats *formats = NULL;
+
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+        if (sws_test_format(pix_fmt, output) &&
+            ff_add_format(&formats, pix_fmt) < 0)
+            return NULL;
+    }
+
+    return formats;
+}
+
+static int query_formats(const AVFilterContext *ctx,
+                         AVFilterFormatsConfig **cfg_in,
+                         AVFilterFormatsConfig **cfg_out)
+{
+    const MultiScaleContext *s = ctx->priv;
+    int ret;
+
+    if ((ret = ff_formats_ref(supported_formats(0), &cfg_in[0]->formats)) < 0)
+        return ret;
+    if ((ret = ff_formats_ref(supported_colorspaces(0), &cfg_in[0]->color_spaces)) < 0)
+        return ret;
+    if ((ret = ff_formats_ref(ff_all_color_ranges(), &cfg_in[0]->color_ranges)) < 0)
+        return ret;
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        AVFilterFormats *formats = s->format != AV_PIX_FMT_NONE
+                                 ? ff_make_formats_list_singleton(s->format)
+                                 : supported_formats(1);
+
+        if ((ret = ff_formats_ref(formats, &cfg_out[i]->formats)) < 0)
+            return ret;
+        if ((ret = ff_formats_ref(supported_colorspaces(1), &cfg_out[i]->color_spaces)) < 0)
+            return ret;
+        if ((ret = ff_formats_ref(ff_all_color_ranges(), &cfg_out[i]->color_ranges)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    MultiScaleContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+    const int idx = FF_OUTLINK_IDX(outlink);
+
+    outlink->w = s->w[idx];
+    outlink->h = s->h[idx];
+
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){outlink->h * inlink->w,
+                                                             outlink->w * inlink->h},
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    av_log(ctx, AV_LOG_VERBOSE, "output%d: w:%d h:%d fmt:%s -> w:%d h:%d fmt:%s\n",
+           idx, inlink->w, inlink->h, av_get_pix_fmt_name(inlink->format),
+           outlink->w, outlink->h, av_get_pix_fmt_name(outlink->format));
+
+    if (inlink->w != outlink->w || inlink->h != outlink->h) {
+        av_frame_side_data_remove_by_props(&outlink->side_data, &outlink->nb_side_data,
+                                           AV_SIDE_DATA_PROP_SIZE_DEPENDENT);
+    }
+
+    if (s->out_primaries != -1 || s->out_transfer != -1) {
+        av_frame_side_data_remove_by_props(&outlink->side_data, &outlink->nb_side_data,
+                                           AV_SIDE_DATA_PROP_COLOR_DEPENDENT);
+    }
+
+    return 0;
+}
+
+static int filter_frame(AVFilterContext *ctx, AVFrame *in)
+{
+    MultiScaleContext *s = ctx->priv;
+    int ret = 0, nb_frames = 0;
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        AVFrame *out;
+
+        if (ff_outlink_get_status(outlink))
+            continue;
+
+        out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        s->frames[i] = s->dsts[nb_frames++] = out;
+
+        ret = av_frame_copy_props(out, in);
+        if (ret < 0)
+            goto fail;
+        out->color_range = outlink->color_range;
+        out->colorspace  = outlink->colorspace;
+        out->sample_aspect_ratio = outlink->sample_aspect_ratio;
+        if (s->out_primaries != -1)
+            out->color_primaries = s->out_primaries;
+        if (s->out_transfer != -1)
+            out->color_trc = s->out_transfer;
+
+        if (out->width != in->width || out->height != in->height) {
+            av_frame_side_data_remove_by_props(&out->side_data, &out->nb_side_data,
+                                               AV_SIDE_DATA_PROP_SIZE_DEPENDENT);
+        }
+
+        if (in->color_primaries != out->color_primaries || in->color_trc != out->color_trc) {
+            av_frame_side_data_remove_by_props(&out->side_data, &out->nb_side_data,
+                                               AV_SIDE_DATA_PROP_COLOR_DEPENDENT);
+        }
+    }
+
+    ret = sws_scale_frames(s->sws, s->dsts, nb_frames, in);
+    if (ret < 0)
+        goto fail;
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        AVFrame *out = s->frames[i];
+
+        if (!out)
+            continue;
+        s->frames[i] = NULL;
+
+        ret = ff_filter_frame(ctx->outputs[i], out);
+        if (ret < 0)
+            goto fail;
+    }
+
+fail:
+    for (int i = 0; i < ctx->nb_outputs; i++)
+        av_frame_free(&s->frames[i]);
+    av_frame_free(&in);
+    return ret;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFrame *in;
+    int status, ret, nb_eofs = 0;
+    int64_t pts;
+
+    for (int i = 0; i < ctx->nb_outputs; i++)
+        nb_eofs += ff_outlink_get_status(ctx->outputs[i]) == AVERROR_EOF;
+
+    if (nb_eofs == ctx->nb_outputs) {
+        ff_inlink_set_status(inlink, AVERROR_EOF);
+        return 0;
+    }
+
+    ret = ff_inlink_consume_frame(inlink, &in);
+    if (ret < 0)
+        return ret;
+    if (ret > 0)
+        return filter_frame(ctx, in);
+
+    if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+        for (int i = 0; i < ctx->nb_outputs; i++) {
+            if (ff_outlink_get_status(ctx->outputs[i]))
+                continue;
+            ff_outlink_set_status(ctx->outputs[i], status, pts);
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        if (ff_outlink_get_status(ctx->outputs[i]))
+            continue;
+
+        if (ff_outlink_frame_wanted(ctx->outputs[i])) {
+            ff_inlink_request_frame(inlink);
+            return 0;
+        }
+    }
+
+    return FFERROR_NOT_READY;
+}
+
+#define OFFSET(x) offsetof(MultiScaleContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption multiscale_options[] = {
+    { "sizes",   "set '|'-separated list of output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, FLAGS },
+    { "s",       "set '|'-separated list of output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, FLAGS },
+    { "format",  "set output pixel format",     OFFSET(format),    AV_OPT_TYPE_PIXEL_FMT, {.i64 = AV_PIX_FMT_NONE}, -1, INT_MAX, FLAGS },
+    { "flags",   "Flags to pass to libswscale", OFFSET(flags_str), AV_OPT_TYPE_STRING, {.str = ""}, 0, 0, FLAGS },
+    { "cascade", "scale smaller outputs from larger ones", OFFSET(cascade), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, FLAGS },
+    { "out_primaries", "set output primaries",      OFFSET(out_primaries), AV_OPT_TYPE_INT, {.i64 = -1}, -1, AVCOL_PRI_NB-1, FLAGS, .unit = "primaries" },
+        { "auto",        NULL, 0, AV_OPT_TYPE_CONST, {.i64=-1},                     0, 0, FLAGS, .unit = "primaries" },
+        { "bt709",       NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_PRI_BT709},        0, 0, FLAGS, .unit = "primaries" },
+        { "bt470m",      NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_PRI_BT470M},       0, 0, FLAGS, .unit = "primaries" },
+        { "bt470bg",     NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_PRI_BT470BG},      0, 0, FLAGS, .unit = "primaries" },
+        { "smpte170m",   NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_PRI_SMPTE170M},    0, 0, FLAGS, .unit = "primaries" },
+        { "smpte240m",   NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_PRI_SMPTE240M},    0, 0, FLAGS, .unit = "primaries" },
+        { "film",        NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_PRI_FILM},         0, 0, FLAGS, .unit = "primaries" },
+        { "bt2020",      NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_PRI_BT2020},       0, 0, FLAGS, .unit = "primaries" },
+        { "smpte428",    NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_PRI_SMPTE428},     0, 0, FLAGS, .unit = "primaries" },
+        { "smpte431",    NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_PRI_SMPTE431},     0, 0, FLAGS, .unit = "primaries" },
+        { "smpte432",    NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_PRI_SMPTE432},     0, 0, FLAGS, .unit = "primaries" },
+        { "jedec-p22",   NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_PRI_JEDEC_P22},    0, 0, FLAGS, .unit = "primaries" },
+        { "ebu3213",     NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_PRI_EBU3213},      0, 0, FLAGS, .unit = "primaries" },
+    { "out_transfer", "set output color transfer",  OFFSET(out_transfer), AV_OPT_TYPE_INT, {.i64 = -1}, -1, AVCOL_TRC_NB-1, FLAGS, .unit = "transfer" },
+        { "auto",         NULL, 0, AV_OPT_TYPE_CONST, {.i64=-1},                     0, 0, FLAGS, .unit = "transfer" },
+        { "bt709",        NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_BT709},        0, 0, FLAGS, .unit = "transfer" },
+        { "bt470m",       NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_GAMMA22},      0, 0, FLAGS, .unit = "transfer" },
+        { "gamma22",      NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_GAMMA22},      0, 0, FLAGS, .unit = "transfer" },
+        { "bt470bg",      NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_GAMMA28},      0, 0, FLAGS, .unit = "transfer" },
+        { "gamma28",      NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_GAMMA28},      0, 0, FLAGS, .unit = "transfer" },
+        { "smpte170m",    NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_SMPTE170M},    0, 0, FLAGS, .unit = "transfer" },
+        { "smpte240m",    NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_SMPTE240M},    0, 0, FLAGS, .unit = "transfer" },
+        { "linear",       NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_LINEAR},       0, 0, FLAGS, .unit = "transfer" },
+        { "iec61966-2-1", NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_IEC61966_2_1}, 0, 0, FLAGS, .unit = "transfer" },
+        { "srgb",         NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_IEC61966_2_1}, 0, 0, FLAGS, .unit = "transfer" },
+        { "iec61966-2-4", NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_IEC61966_2_4}, 0, 0, FLAGS, .unit = "transfer" },
+        { "xvycc",        NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_IEC61966_2_4}, 0, 0, FLAGS, .unit = "transfer" },
+        { "bt1361e",      NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_BT1361_ECG},   0, 0, FLAGS, .unit = "transfer" },
+        { "bt2020-10",    NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_BT2020_10},    0, 0, FLAGS, .unit = "transfer" },
+        { "bt2020-12",    NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_BT2020_12},    0, 0, FLAGS, .unit = "transfer" },
+        { "smpte2084",    NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_SMPTE2084},    0, 0, FLAGS, .unit = "transfer" },
+        { "smpte428",     NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_SMPTE428},     0, 0, FLAGS, .unit = "transfer" },
+        { "arib-std-b67", NULL, 0, AV_OPT_TYPE_CONST, {.i64=AVCOL_TRC_ARIB_STD_B67}, 0, 0, FLAGS, .unit = "transfer" },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(multiscale);
+
+const FFFilter ff_vf_multiscale = {
+    .p.name        = "multiscale",
+    .p.description = NULL_IF_CONFIG_SMALL("Scale the input video to several output sizes."),
+    .p.priv_class  = &multiscale_class,
+    .p.flags       = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+    .priv_size     = sizeof(MultiScaleContext),
+    .preinit       = preinit,
+    .init          = init,
+    .uninit        = uninit,
+    .activate      = activate,
+    FILTER_INPUTS(ff_video_default_filterpad),
+    FILTER_QUERY_FUNC2(query_formats),
+};
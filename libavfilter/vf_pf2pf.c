@@ -25,6 +25,8 @@
 #include "video.h"
 #include "filters.h"
 #include "formats.h"
+#include "pf2pf.h"
+#include "vf_pf2pf_init.h"
 
 static const int8_t step_offset_tab[][2] = {
     {  1, 0 }, {  2, -1 },
@@ -70,6 +72,30 @@ typedef void (*pf2pf_special_fun)(uint8_t **dstp,
                                   const int src_shift,
                                   const int src_depth);
 
+enum PF2PFOpType {
+    OP_ZERO,
+    OP_COPY,
+    OP_SHUFFLE,
+    OP_DEINTERLEAVE,
+    OP_INTERLEAVE,
+    OP_WIDEN,
+    OP_NARROW,
+    OP_SHIFT16,
+};
+
+/* Conversion of whole rows of one or more planes by one specialised kernel */
+typedef struct PF2PFOp {
+    enum PF2PFOpType type;
+    int dst_plane[4];
+    int src_plane[4];
+    int nb_planes;   /* planes on the planar side of (de)interleave */
+    int bytes;       /* bytes per sample for zero/copy */
+    int step;        /* bytes per pixel of the packed side */
+    int block;
+    int lshift, rshift;
+    uint8_t mask[16];
+} PF2PFOp;
+
 typedef struct PF2PFContext {
     const AVClass *class;
 
@@ -79,6 +105,10 @@ typedef struct PF2PFContext {
     int format;
     int pass;
 
+    PF2PFDSPContext dsp;
+    PF2PFOp ops[4];
+    int nb_ops;
+
     void (*special[4])(uint8_t **dstp,
                        const uint8_t **srcp,
                        const int *dst_linesizep,
@@ -228,21 +258,288 @@ static pf2pf_generic_fun generic[4][2][4][2] = {
 #include "pf2pf_dst_endian_entry_generic.c"
 };
 
-static int config_output(AVFilterLink *outlink)
+static int comp_bytes(const AVComponentDescriptor *comp)
 {
-    AVFilterContext *ctx = outlink->src;
-    AVFilterLink *inlink = ctx->inputs[0];
-    PF2PFContext *s = ctx->priv;
-    int ret;
+    return (comp->depth + 7) / 8;
+}
 
-    if (outlink->format == inlink->format) {
-        s->pass = 1;
+static int plane_comps(const AVPixFmtDescriptor *desc, int plane, int *comps)
+{
+    int nb = 0;
+
+    for (int i = 0; i < desc->nb_components; i++) {
+        if (desc->comp[i].plane == plane)
+            comps[nb++] = i;
+    }
+
+    return nb;
+}
+
+/* Padding such as the X of rgb0 is described past nb_components */
+static int has_comp(const AVPixFmtDescriptor *desc, int c)
+{
+    return c < desc->nb_components && desc->comp[c].depth;
+}
+
+/* Some bytes of the plane hold parts of more than one component */
+static int shares_bytes(const AVPixFmtDescriptor *desc, int plane)
+{
+    int comps[4], nb;
+
+    nb = plane_comps(desc, plane, comps);
+    for (int i = 0; i < nb; i++) {
+        const AVComponentDescriptor *a = &desc->comp[comps[i]];
+
+        for (int j = i + 1; j < nb; j++) {
+            const AVComponentDescriptor *b = &desc->comp[comps[j]];
+
+            if (a->offset < b->offset + comp_bytes(b) &&
+                b->offset < a->offset + comp_bytes(a))
+                return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* A plane that holds exactly one component, with no padding */
+static int is_planar(const AVPixFmtDescriptor *desc, int plane)
+{
+    int comps[4];
+
+    if (plane_comps(desc, plane, comps) != 1)
+        return 0;
+
+    return desc->comp[comps[0]].step == comp_bytes(&desc->comp[comps[0]]);
+}
+
+/* Whole bytes of one 8-bit component, or one sample per element otherwise */
+static int is_byte_aligned(const AVComponentDescriptor *comp)
+{
+    return comp->shift + comp->depth <= comp_bytes(comp) * 8;
+}
+
+static int is_8bit(const AVComponentDescriptor *comp)
+{
+    return comp->depth == 8 && !comp->shift;
+}
+
+static int is_native(const AVPixFmtDescriptor *desc)
+{
+    return !(desc->flags & AV_PIX_FMT_FLAG_BE) == !HAVE_BIGENDIAN;
+}
+
+static int setup_planar_op(PF2PFContext *s, PF2PFOp *op, int c)
+{
+    const AVPixFmtDescriptor *dd = s->dst_desc, *sd = s->src_desc;
+    const AVComponentDescriptor *dc = &dd->comp[c], *sc = &sd->comp[c];
+    const int dbytes = comp_bytes(dc), sbytes = comp_bytes(sc);
+    const int swap = !(dd->flags & AV_PIX_FMT_FLAG_BE) != !(sd->flags & AV_PIX_FMT_FLAG_BE);
+
+    op->dst_plane[0] = dc->plane;
+    op->src_plane[0] = sc->plane;
+
+    if (!is_byte_aligned(dc) || !is_byte_aligned(sc))
         return 0;
+
+    if (dc->depth == sc->depth && dc->shift == sc->shift) {
+        op->bytes = dbytes;
+        if (!swap || dbytes == 1) {
+            op->type = OP_COPY;
+            return 1;
+        }
+        if (dbytes != 2 && dbytes != 4)
+            return 0;
+        op->type  = OP_SHUFFLE;
+        op->step  = dbytes;
+        op->block = 16;
+        for (int i = 0; i < 16; i++)
+            op->mask[i] = (i & ~(dbytes - 1)) + dbytes - 1 - (i & (dbytes - 1));
+        return 1;
     }
 
-    s->dst_desc = av_pix_fmt_desc_get(outlink->format);
-    s->src_desc = av_pix_fmt_desc_get(inlink->format);
+    if ((dd->flags | sd->flags) & AV_PIX_FMT_FLAG_FLOAT ||
+        (dbytes > 1 && !is_native(dd)) || (sbytes > 1 && !is_native(sd)))
+        return 0;
+
+    op->lshift = dc->shift + FFMAX(dc->depth - sc->depth, 0);
+    op->rshift = sc->shift + FFMAX(sc->depth - dc->depth, 0);
+    if (sbytes == 1 && dbytes == 2 && !op->rshift)
+        op->type = OP_WIDEN;
+    else if (sbytes == 2 && dbytes == 1 && !op->lshift)
+        op->type = OP_NARROW;
+    else if (sbytes == 2 && dbytes == 2)
+        op->type = OP_SHIFT16;
+    else
+        return 0;
+
+    return 1;
+}
+
+/* Split the packed 8-bit source plane sp into the planar destination planes */
+static int setup_deinterleave_op(PF2PFContext *s, PF2PFOp *op, int sp, unsigned *done)
+{
+    const AVPixFmtDescriptor *dd = s->dst_desc, *sd = s->src_desc;
+    int comps[4], nb;
+
+    nb = plane_comps(sd, sp, comps);
+    op->type = OP_DEINTERLEAVE;
+    op->src_plane[0] = sp;
+    op->step = sd->comp[comps[0]].step;
+    op->nb_planes = 0;
+    memset(op->mask, 0x80, sizeof(op->mask));
+    if (op->step < 2 || op->step > 4)
+        return 0;
+
+    for (int i = 0; i < nb; i++) {
+        const int c = comps[i];
+        const int dp = dd->comp[c].plane;
+
+        if (!is_8bit(&sd->comp[c]) || sd->comp[c].step != op->step)
+            return 0;
+        if (c >= dd->nb_components)
+            continue;
+        if (!is_8bit(&dd->comp[c]) || !is_planar(dd, dp))
+            return 0;
+
+        for (int p = 0; p < 4; p++)
+            op->mask[4 * op->nb_planes + p] = p * op->step + sd->comp[c].offset;
+        op->dst_plane[op->nb_planes++] = dp;
+        *done |= 1 << dp;
+    }
+
+    return op->nb_planes > 0;
+}
+
+static int setup_packed_op(PF2PFContext *s, PF2PFOp *op, int dp)
+{
+    const AVPixFmtDescriptor *dd = s->dst_desc, *sd = s->src_desc;
+    const int swap = !(dd->flags & AV_PIX_FMT_FLAG_BE) != !(sd->flags & AV_PIX_FMT_FLAG_BE);
+    int comps[4], nb, sp = -1, planar = 1, packed = 1;
+
+    nb = plane_comps(dd, dp, comps);
+    op->dst_plane[0] = dp;
+    op->step = dd->comp[comps[0]].step;
+    memset(op->mask, 0x80, sizeof(op->mask));
+
+    for (int i = 0; i < nb; i++) {
+        const AVComponentDescriptor *dc = &dd->comp[comps[i]];
+        const AVComponentDescriptor *sc = &sd->comp[comps[i]];
+
+        if (dc->step != op->step || !is_byte_aligned(dc))
+            return 0;
+        if (!has_comp(sd, comps[i]))
+            continue;
+        if (sp < 0)
+            sp = sc->plane;
+        if (sc->plane != sp || sc->step != op->step || sc->depth != dc->depth ||
+            sc->shift != dc->shift || !is_byte_aligned(sc))
+            packed = 0;
+        if (!is_8bit(dc) || !is_8bit(sc) || !is_planar(sd, sc->plane))
+            planar = 0;
+    }
+
+    if (sp < 0) {
+        op->type  = OP_ZERO;
+        op->bytes = op->step;
+        return 1;
+    }
+
+    if (packed && (16 % op->step == 0 || 12 % op->step == 0) &&
+        !shares_bytes(dd, dp) && !shares_bytes(sd, sp)) {
+        op->type  = OP_SHUFFLE;
+        op->block = 16 % op->step == 0 ? 16 : 12;
+        op->src_plane[0] = sp;
+        for (int i = 0; i < nb; i++) {
+            const AVComponentDescriptor *dc = &dd->comp[comps[i]];
+            const AVComponentDescriptor *sc = &sd->comp[comps[i]];
+            const int bytes = comp_bytes(dc);
+
+            if (!has_comp(sd, comps[i]))
+                continue;
+            for (int p = 0; p < op->block; p += op->step) {
+                for (int b = 0; b < bytes; b++)
+                    op->mask[p + dc->offset + b] = p + sc->offset + (swap ? bytes - 1 - b : b);
+            }
+        }
+        return 1;
+    }
+
+    if (planar && op->step >= 2 && op->step <= 4) {
+        op->type = OP_INTERLEAVE;
+        op->nb_planes = 0;
+        for (int i = 0; i < nb; i++) {
+            const AVComponentDescriptor *dc = &dd->comp[comps[i]];
+            const AVComponentDescriptor *sc = &sd->comp[comps[i]];
+            const int k = op->nb_planes++;
+
+            if (!has_comp(sd, comps[i])) {
+                op->nb_planes--;
+                continue;
+            }
+            op->src_plane[k] = sc->plane;
+            for (int p = 0; p < 4; p++)
+                op->mask[p * op->step + dc->offset] = 4 * k + p;
+        }
+        return 1;
+    }
 
+    return 0;
+}
+
+/*
+ * Map the conversion onto specialised row kernels, plane by plane. Returns 0
+ * if some plane needs the generic per-component path.
+ */
+static int setup_ops(PF2PFContext *s)
+{
+    const AVPixFmtDescriptor *dd = s->dst_desc, *sd = s->src_desc;
+    const int nb_planes = av_pix_fmt_count_planes(av_pix_fmt_desc_get_id(dd));
+    unsigned done = 0;
+    int nb_ops = 0;
+
+    s->nb_ops = 0;
+    if (dd->log2_chroma_w != sd->log2_chroma_w ||
+        dd->log2_chroma_h != sd->log2_chroma_h)
+        return 0;
+
+    for (int dp = 0; dp < nb_planes; dp++) {
+        PF2PFOp *op = &s->ops[nb_ops];
+        int comps[4], nb;
+
+        if (done & (1 << dp))
+            continue;
+
+        memset(op, 0, sizeof(*op));
+        nb = plane_comps(dd, dp, comps);
+        if (nb == 1 && is_planar(dd, dp)) {
+            const int c = comps[0];
+
+            if (!has_comp(sd, c)) {
+                op->type = OP_ZERO;
+                op->dst_plane[0] = dp;
+                op->bytes = dd->comp[c].step;
+            } else if (is_planar(sd, sd->comp[c].plane)) {
+                if (!setup_planar_op(s, op, c))
+                    return 0;
+            } else if (!setup_deinterleave_op(s, op, sd->comp[c].plane, &done)) {
+                return 0;
+            }
+        } else if (!setup_packed_op(s, op, dp)) {
+            return 0;
+        }
+
+        done |= 1 << dp;
+        nb_ops++;
+    }
+
+    s->nb_ops = nb_ops;
+    return 1;
+}
+
+/* Pick the row kernels or the per-component functions for src_desc -> dst_desc */
+static void config_funcs(PF2PFContext *s)
+{
     for (int i = 0; i < s->dst_desc->nb_components; i++) {
         unsigned dst_be = !!(s->dst_desc->flags & AV_PIX_FMT_FLAG_BE);
         unsigned src_be = !!(s->src_desc->flags & AV_PIX_FMT_FLAG_BE);
@@ -250,6 +547,9 @@ static int config_output(AVFilterLink *outlink)
         unsigned src_by = ((s->src_desc->comp[i].depth + 7) / 8) - 1;
         unsigned dst_so = UINT_MAX, src_so = UINT_MAX;
 
+        if (!has_comp(s->src_desc, i))
+            continue;
+
         for (int j = 0; j < FF_ARRAY_ELEMS(step_offset_tab); j++) {
             if (step_offset_tab[j][0] == s->dst_desc->comp[i].step &&
                 step_offset_tab[j][1] == s->dst_desc->comp[i].offset) {
@@ -280,12 +580,86 @@ static int config_output(AVFilterLink *outlink)
         s->special[i] = special[src_by][src_be][src_so][dst_by][dst_be][dst_so];
     }
 
+    ff_pf2pf_dsp_init(&s->dsp);
+    setup_ops(s);
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    PF2PFContext *s = ctx->priv;
+    int ret;
+
+    if (outlink->format == inlink->format) {
+        s->pass = 1;
+        return 0;
+    }
+
+    s->dst_desc = av_pix_fmt_desc_get(outlink->format);
+    s->src_desc = av_pix_fmt_desc_get(inlink->format);
+    config_funcs(s);
+
     if ((ret = av_image_fill_linesizes(s->linesize, outlink->format, inlink->w)) < 0)
         return ret;
 
     return 0;
 }
 
+static void run_ops(PF2PFContext *s, AVFrame *out, const AVFrame *in, int start, int end)
+{
+    const PF2PFDSPContext *dsp = &s->dsp;
+
+    for (int n = 0; n < s->nb_ops; n++) {
+        const PF2PFOp *op = &s->ops[n];
+        const int dp = op->dst_plane[0];
+        const int sp = op->src_plane[0];
+        const int dst_sw = (dp == 1 || dp == 2) ? s->dst_desc->log2_chroma_w : 0;
+        const int dst_sh = (dp == 1 || dp == 2) ? s->dst_desc->log2_chroma_h : 0;
+        const int cw = AV_CEIL_RSHIFT(in->width, dst_sw);
+        const int cstart = start >> dst_sh;
+        const int cend = (end == in->height) ? AV_CEIL_RSHIFT(in->height, dst_sh) : (end >> dst_sh);
+
+        for (int y = cstart; y < cend; y++) {
+            uint8_t *dst = out->data[dp] + y * out->linesize[dp];
+            const uint8_t *src = in->data[sp] + y * in->linesize[sp];
+            uint8_t *dst_planes[4] = { NULL };
+            const uint8_t *src_planes[4] = { NULL };
+
+            switch (op->type) {
+            case OP_ZERO:
+                memset(dst, 0, cw * op->bytes);
+                break;
+            case OP_COPY:
+                memcpy(dst, src, cw * op->bytes);
+                break;
+            case OP_SHUFFLE:
+                dsp->shuffle(dst, src, cw * op->step, op->mask, op->block);
+                break;
+            case OP_DEINTERLEAVE:
+                for (int k = 0; k < op->nb_planes; k++)
+                    dst_planes[k] = out->data[op->dst_plane[k]] + y * out->linesize[op->dst_plane[k]];
+                dsp->deinterleave(dst_planes, src, cw, op->mask, op->step, op->nb_planes);
+                break;
+            case OP_INTERLEAVE:
+                for (int k = 0; k < op->nb_planes; k++)
+                    src_planes[k] = in->data[op->src_plane[k]] + y * in->linesize[op->src_plane[k]];
+                dsp->interleave(dst, src_planes, cw, op->mask, op->step, op->nb_planes);
+                break;
+            case OP_WIDEN:
+                dsp->widen((uint16_t *)dst, src, cw, op->lshift);
+                break;
+            case OP_NARROW:
+                dsp->narrow(dst, (const uint16_t *)src, cw, op->rshift);
+                break;
+            case OP_SHIFT16:
+                dsp->shift16((uint16_t *)dst, (const uint16_t *)src, cw, op->lshift, op->rshift);
+                break;
+            }
+        }
+    }
+}
+
 static int do_pf2pf(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     PF2PFContext *s = ctx->priv;
@@ -299,11 +673,16 @@ static int do_pf2pf(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
     const int start = (h * jobnr) / nb_jobs;
     const int end = (h * (jobnr+1)) / nb_jobs;
 
+    if (s->nb_ops) {
+        run_ops(s, out, in, start, end);
+        return 0;
+    }
+
     for (int comp = 0; comp < nb_components; comp++) {
         if (out->data[comp]) {
-            const int dst_sh = (comp > 0) ? s->dst_desc->log2_chroma_h : 0;
+            const int dst_sh = (comp == 1 || comp == 2) ? s->dst_desc->log2_chroma_h : 0;
             const int cstart = start >> dst_sh;
-            const int cend = end >> dst_sh;
+            const int cend = (end == h) ? AV_CEIL_RSHIFT(h, dst_sh) : (end >> dst_sh);
             uint8_t *dst_data = out->data[comp] + cstart * out->linesize[comp];
 
             for (int y = cstart; y < cend; y++) {
@@ -324,12 +703,12 @@ static int do_pf2pf(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
         const int src_shift = s->src_desc->comp[comp].shift;
         const int src_offset= s->src_desc->comp[comp].offset;
         const int src_depth = s->src_desc->comp[comp].depth;
-        const int dst_sw = (comp > 0) ? s->dst_desc->log2_chroma_w : 0;
-        const int dst_sh = (comp > 0) ? s->dst_desc->log2_chroma_h : 0;
+        const int dst_sw = (comp == 1 || comp == 2) ? s->dst_desc->log2_chroma_w : 0;
+        const int dst_sh = (comp == 1 || comp == 2) ? s->dst_desc->log2_chroma_h : 0;
         uint8_t *dst_data[4] = {NULL}, *src_data[4] = {NULL};
         const int cstart = start >> dst_sh;
-        const int cend = end >> dst_sh;
-        const int cw = w >> dst_sw;
+        const int cend = (end == h) ? AV_CEIL_RSHIFT(h, dst_sh) : (end >> dst_sh);
+        const int cw = AV_CEIL_RSHIFT(w, dst_sw);
 
         for (int i = 0; i < 4; i++) {
             if (out->data[i])
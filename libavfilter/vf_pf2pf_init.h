@@ -0,0 +1,98 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef AVFILTER_PF2PF_INIT_H
+#define AVFILTER_PF2PF_INIT_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "pf2pf.h"
+
+static void pf2pf_shuffle_c(uint8_t *dst, const uint8_t *src, int len,
+                            const uint8_t *mask, int block)
+{
+    for (int x = 0; x < len; x += block) {
+        for (int i = 0; i < block && x + i < len; i++)
+            dst[x + i] = mask[i] & 0x80 ? 0 : src[x + mask[i]];
+    }
+}
+
+static void pf2pf_deinterleave_c(uint8_t *const dst[4], const uint8_t *src, int w,
+                                 const uint8_t *mask, int step, int nb_planes)
+{
+    for (int x = 0; x < w; x++) {
+        const uint8_t *group = src + (x >> 2) * 4 * step;
+
+        for (int k = 0; k < nb_planes; k++) {
+            const uint8_t m = mask[4 * k + (x & 3)];
+            dst[k][x] = m & 0x80 ? 0 : group[m];
+        }
+    }
+}
+
+static void pf2pf_interleave_c(uint8_t *dst, const uint8_t *const src[4], int w,
+                               const uint8_t *mask, int step, int nb_planes)
+{
+    for (int x = 0; x < w; x++) {
+        uint8_t *group = dst + (x >> 2) * 4 * step;
+        const int p = x & 3;
+
+        for (int i = p * step; i < (p + 1) * step; i++) {
+            const uint8_t m = mask[i];
+            group[i] = m & 0x80 ? 0 : src[m >> 2][(x & ~3) + (m & 3)];
+        }
+    }
+}
+
+static void pf2pf_widen_c(uint16_t *dst, const uint8_t *src, int len, int shift)
+{
+    for (int x = 0; x < len; x++)
+        dst[x] = src[x] << shift;
+}
+
+static void pf2pf_narrow_c(uint8_t *dst, const uint16_t *src, int len, int shift)
+{
+    for (int x = 0; x < len; x++)
+        dst[x] = av_clip_uint8(src[x] >> shift);
+}
+
+static void pf2pf_shift16_c(uint16_t *dst, const uint16_t *src, int len,
+                            int lshift, int rshift)
+{
+    for (int x = 0; x < len; x++)
+        dst[x] = (src[x] >> rshift) << lshift;
+}
+
+static av_unused void ff_pf2pf_dsp_init(PF2PFDSPContext *dsp)
+{
+    dsp->shuffle      = pf2pf_shuffle_c;
+    dsp->deinterleave = pf2pf_deinterleave_c;
+    dsp->interleave   = pf2pf_interleave_c;
+    dsp->widen        = pf2pf_widen_c;
+    dsp->narrow       = pf2pf_narrow_c;
+    dsp->shift16      = pf2pf_shift16_c;
+
+#if ARCH_X86
+    ff_pf2pf_dsp_init_x86(dsp);
+#endif
+}
+
+#endif /* AVFILTER_PF2PF_INIT_H */
@@ -522,7 +522,8 @@ static void pullup_release_frame(PullupFrame *f)
 
 static void compute_metric(PullupContext *s, int *dest,
                            PullupField *fa, int pa, PullupField *fb, int pb,
-                           int (*func)(const uint8_t *, const uint8_t *, ptrdiff_t))
+                           int (*func)(const uint8_t *, const uint8_t *, ptrdiff_t),
+                           int y_start, int y_end)
 {
     int mp = s->metric_plane;
     int xstep = 8;
@@ -536,21 +537,48 @@ static void compute_metric(PullupContext *s, int *dest,
         return;
 
     /* Shortcut for duplicate fields (e.g. from RFF flag) */
+    dest += y_start * s->metric_w;
+
     if (fa->buffer == fb->buffer && pa == pb) {
-        memset(dest, 0, s->metric_length * sizeof(*dest));
+        memset(dest, 0, (y_end - y_start) * s->metric_w * sizeof(*dest));
         return;
     }
 
-    a = fa->buffer->planes[mp] + pa * s->planewidth[mp] + s->metric_offset;
-    b = fb->buffer->planes[mp] + pb * s->planewidth[mp] + s->metric_offset;
+    a = fa->buffer->planes[mp] + pa * s->planewidth[mp] + s->metric_offset + y_start * ystep;
+    b = fb->buffer->planes[mp] + pb * s->planewidth[mp] + s->metric_offset + y_start * ystep;
 
-    for (y = 0; y < s->metric_h; y++) {
+    for (y = y_start; y < y_end; y++) {
         for (x = 0; x < w; x += xstep)
             *dest++ = func(a + x, b + x, stride);
         a += ystep; b += ystep;
     }
 }
 
+typedef struct ThreadData {
+    PullupField *fields[3]; ///< fields submitted from the same input frame
+    int nb_fields;
+    int nb_slices;
+} ThreadData;
+
+static int compute_metrics_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PullupContext *s = ctx->priv;
+    const ThreadData *td = arg;
+    PullupField *f = td->fields[jobnr / td->nb_slices];
+    const int parity = f->parity;
+    const int slice = jobnr % td->nb_slices;
+    const int y_start = (s->metric_h *  slice     ) / td->nb_slices;
+    const int y_end   = (s->metric_h * (slice + 1)) / td->nb_slices;
+
+    compute_metric(s, f->diffs, f, parity, f->prev->prev, parity, s->diff, y_start, y_end);
+    compute_metric(s, f->combs, parity ? f->prev : f, 0, parity ? f : f->prev, 1, s->comb,
+                   y_start, y_end);
+    compute_metric(s, f->vars, f, parity, f, -1, s->var, y_start, y_end);
+    emms_c();
+
+    return 0;
+}
+
 static int check_field_queue(PullupContext *s)
 {
     int ret;
@@ -575,17 +603,22 @@ static int check_field_queue(PullupContext *s)
     return 0;
 }
 
-static void pullup_submit_field(PullupContext *s, PullupBuffer *b, int parity)
+/**
+ * Queue a field, its metrics are computed by compute_metrics().
+ *
+ * @return the queued field, or NULL if it was dropped
+ */
+static PullupField *pullup_submit_field(PullupContext *s, PullupBuffer *b, int parity)
 {
     PullupField *f;
 
     /* Grow the circular list if needed */
     if (check_field_queue(s) < 0)
-        return;
+        return NULL;
 
     /* Cannot have two fields of same parity in a row; drop the new one */
     if (s->last && s->last->parity == parity)
-        return;
+        return NULL;
 
     f = s->head;
     f->parity   = parity;
@@ -594,17 +627,30 @@ static void pullup_submit_field(PullupContext *s, PullupBuffer *b, int parity)
     f->breaks   = 0;
     f->affinity = 0;
 
-    compute_metric(s, f->diffs, f, parity, f->prev->prev, parity, s->diff);
-    compute_metric(s, f->combs, parity ? f->prev : f, 0, parity ? f : f->prev, 1, s->comb);
-    compute_metric(s, f->vars, f, parity, f, -1, s->var);
-    emms_c();
-
     /* Advance the circular list */
     if (!s->first)
         s->first = s->head;
 
     s->last = s->head;
     s->head = s->head->next;
+
+    return f;
+}
+
+/**
+ * Compute the metrics of the fields queued from one input frame. They only
+ * read the field buffers, so all fields are computed concurrently.
+ */
+static void compute_metrics(AVFilterContext *ctx, ThreadData *td)
+{
+    PullupContext *s = ctx->priv;
+
+    if (!td->nb_fields)
+        return;
+
+    td->nb_slices = FFMIN(FFMAX(s->metric_h, 1), ff_filter_get_nb_threads(ctx));
+    ff_filter_execute(ctx, compute_metrics_slice, td, NULL,
+                      td->nb_fields * td->nb_slices);
 }
 
 static void copy_field(PullupContext *s,
@@ -656,6 +702,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     PullupContext *s = ctx->priv;
     PullupBuffer *b;
     PullupFrame *f;
+    ThreadData td = { 0 };
     AVFrame *out;
     int p, ret = 0;
 
@@ -673,11 +720,15 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 
     p = (in->flags & AV_FRAME_FLAG_INTERLACED) ?
         !(in->flags & AV_FRAME_FLAG_TOP_FIELD_FIRST) : 0;
-    pullup_submit_field(s, b, p  );
-    pullup_submit_field(s, b, p^1);
+    if ((td.fields[td.nb_fields] = pullup_submit_field(s, b, p  )))
+        td.nb_fields++;
+    if ((td.fields[td.nb_fields] = pullup_submit_field(s, b, p^1)))
+        td.nb_fields++;
+
+    if (in->repeat_pict && (td.fields[td.nb_fields] = pullup_submit_field(s, b, p)))
+        td.nb_fields++;
 
-    if (in->repeat_pict)
-        pullup_submit_field(s, b, p);
+    compute_metrics(ctx, &td);
 
     pullup_release_buffer(b, 2);
 
@@ -754,6 +805,7 @@ const FFFilter ff_vf_pullup = {
     .p.name        = "pullup",
     .p.description = NULL_IF_CONFIG_SMALL("Pullup from field sequence to frames."),
     .p.priv_class  = &pullup_class,
+    .p.flags       = AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(PullupContext),
     .uninit        = uninit,
     FILTER_INPUTS(pullup_inputs),
@@ -21,6 +21,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/pixfmt.h"
+#include "libswscale/swscale.h"
 #include "avfilter.h"
 #include "video.h"
 #include "filters.h"
@@ -29,6 +30,7 @@
 enum Interpolation {
     NEAREST,
     LINEAR,
+    AREA,
     NB_INTERP
 };
 
@@ -41,6 +43,9 @@ typedef struct ReScaleContext {
 
     int pass;
 
+    SwsContext *sws;
+    int area_fallback;
+
     int (*rescale_slice[NB_INTERP])(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
 } ReScaleContext;
 
@@ -53,6 +58,7 @@ static const AVOption rescale_options[] = {
     { "interpolation", "set interpolation", OFFSET(interpolation), AV_OPT_TYPE_INT, {.i64=LINEAR}, 0, NB_INTERP-1, .flags=TFLAGS, .unit="interp" },
     { "nearest", "nearest neighbor", 0, AV_OPT_TYPE_CONST, {.i64=NEAREST}, 0, 0, TFLAGS, .unit = "interp" },
     { "linear",  "bilinear", 0, AV_OPT_TYPE_CONST, {.i64=LINEAR},  0, 0, TFLAGS, .unit = "interp" },
+    { "area",    "area averaging", 0, AV_OPT_TYPE_CONST, {.i64=AREA}, 0, 0, TFLAGS, .unit = "interp" },
     {NULL}
 };
 
@@ -118,6 +124,7 @@ static int config_output(AVFilterLink *outlink)
     AVFilterContext *ctx = outlink->src;
     AVFilterLink *inlink = ctx->inputs[0];
     ReScaleContext *s = ctx->priv;
+    const int nb_threads = ff_filter_get_nb_threads(ctx);
 
     if (!s->w || !s->h) {
         outlink->w = inlink->w;
@@ -152,9 +159,39 @@ static int config_output(AVFilterLink *outlink)
         return AVERROR_BUG;
     }
 
+    /* area averaging is done by the box scaler of libswscale */
+    s->rescale_slice[AREA] = s->rescale_slice[LINEAR];
+    s->area_fallback = !sws_test_format(inlink->format, 0) ||
+                       !sws_test_format(outlink->format, 1);
+    if (s->area_fallback) {
+        av_log(ctx, AV_LOG_WARNING, "Area interpolation is not supported for "
+               "this pixel format, using linear interpolation instead.\n");
+        return 0;
+    }
+
+    sws_free_context(&s->sws);
+    s->sws = sws_alloc_context();
+    if (!s->sws)
+        return AVERROR(ENOMEM);
+    s->sws->flags   = SWS_BOX;
+    s->sws->threads = nb_threads;
+
     return 0;
 }
 
+static int rescale_area(AVFilterContext *ctx, AVFrame *out, const AVFrame *in)
+{
+    ReScaleContext *s = ctx->priv;
+    int ret;
+
+    /* keep the input color properties, so that only the size changes */
+    ret = av_frame_copy_props(out, in);
+    if (ret < 0)
+        return ret;
+
+    return sws_scale_frame(s->sws, out, in);
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -181,15 +218,24 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             return ret;
         }
 
-        td.in = in;
-        td.out = out;
+        if (s->interpolation == AREA && !s->area_fallback) {
+            ret = rescale_area(ctx, out, in);
+            if (ret < 0) {
+                av_frame_free(&out);
+                av_frame_free(&in);
+                return ret;
+            }
+        } else {
+            td.in = in;
+            td.out = out;
 
-        nb_jobs = out->height;
+            nb_jobs = out->height;
 
-        ff_filter_execute(ctx, s->rescale_slice[s->interpolation], &td, NULL,
-                          FFMIN(nb_jobs, ff_filter_get_nb_threads(ctx)));
+            ff_filter_execute(ctx, s->rescale_slice[s->interpolation], &td, NULL,
+                              FFMIN(nb_jobs, ff_filter_get_nb_threads(ctx)));
 
-        av_frame_copy_props(out, in);
+            av_frame_copy_props(out, in);
+        }
         av_frame_free(&in);
     }
 
@@ -222,6 +268,13 @@ static int transfer_state(AVFilterContext *dst, const AVFilterContext *src)
 }
 #endif
 
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    ReScaleContext *s = ctx->priv;
+
+    sws_free_context(&s->sws);
+}
+
 static const AVFilterPad inputs[] = {
     {
         .name          = "default",
@@ -244,6 +297,7 @@ const FFFilter ff_vf_rescale = {
     .p.description = NULL_IF_CONFIG_SMALL("Rescale Video stream."),
     .p.priv_class  = &rescale_class,
     .priv_size     = sizeof(ReScaleContext),
+    .uninit        = uninit,
 #if CONFIG_AVFILTER_THREAD_FRAME
     .transfer_state = transfer_state,
 #endif
@@ -35,6 +35,7 @@
 #include "scale_eval.h"
 #include "video.h"
 #include "libavutil/eval.h"
+#include "libavutil/fifo.h"
 #include "libavutil/imgutils_internal.h"
 #include "libavutil/internal.h"
 #include "libavutil/mem.h"
@@ -155,6 +156,9 @@ typedef struct ScaleContext {
 
     AVFrame *frame;
     AVFrame *frame_ref;
+
+    /* frames in flight in the scaler, if frame threading is used */
+    AVFifo *pending_flags;      ///< original flags of the frames in flight
 } ScaleContext;
 
 static int config_props(AVFilterLink *outlink);
@@ -385,6 +389,7 @@ static av_cold int init(AVFilterContext *ctx)
                                     ff_filter_get_nb_threads(ctx);
     if ((ctx->thread_type & AVFILTER_THREAD_FRAME_FILTER)) {
         scale->sws->threads = 1;
+        scale->sws->frame_threads = 1;
 
         // we are the main context - export thread count to generic code
         if (!ff_filter_is_frame_thread(ctx))
@@ -392,6 +397,12 @@ static av_cold int init(AVFilterContext *ctx)
     } else
         scale->sws->threads = threads;
 
+    if (scale->sws->frame_threads != 1) {
+        scale->pending_flags = av_fifo_alloc2(1, sizeof(int), AV_FIFO_FLAG_AUTO_GROW);
+        if (!scale->pending_flags)
+            return AVERROR(ENOMEM);
+    }
+
     if (scale->uses_ref) {
         AVFilterPad pad = {
             .name = "ref",
@@ -417,6 +428,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     ff_framesync_uninit(&scale->fs);
     sws_free_context(&scale->sws);
+    av_fifo_freep2(&scale->pending_flags);
 }
 
 static int query_formats(const AVFilterContext *ctx,
@@ -678,12 +690,88 @@ static int scale_transfer_state(AVFilterContext *dst, const AVFilterContext *src
 }
 #endif
 
+/* Output the frames that are done scaling, waiting for them if the scaler
+ * is full or being drained */
+static int scale_receive_frames(AVFilterContext *ctx)
+{
+    ScaleContext *scale = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+
+    while (1) {
+        AVFrame *out = av_frame_alloc();
+        int ret, flags;
+        if (!out)
+            return AVERROR(ENOMEM);
+
+        ret = sws_receive_frame(scale->sws, out);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            av_frame_free(&out);
+            return 0;
+        }
+
+        av_fifo_read(scale->pending_flags, &flags, 1);
+        if (ret < 0) {
+            av_frame_free(&out);
+            return ret;
+        }
+
+        out->flags  = flags;
+        out->format = outlink->format; /* undo PAL8 handling */
+        ret = ff_filter_frame(outlink, out);
+        if (ret < 0)
+            return ret;
+    }
+}
+
+/* Takes over ownership of out and in */
+static int scale_send_frame(AVFilterContext *ctx, AVFrame *out, AVFrame *in,
+                            int flags)
+{
+    ScaleContext *scale = ctx->priv;
+    int ret;
+
+    while ((ret = sws_send_frame(scale->sws, out, in)) == AVERROR(EAGAIN)) {
+        ret = scale_receive_frames(ctx);
+        if (ret < 0)
+            break;
+    }
+    av_frame_free(&out);
+    av_frame_free(&in);
+    if (ret < 0)
+        return ret;
+
+    ret = av_fifo_write(scale->pending_flags, &flags, 1);
+    if (ret < 0)
+        return ret;
+
+    return scale_receive_frames(ctx);
+}
+
+static int scale_flush(AVFilterContext *ctx)
+{
+    ScaleContext *scale = ctx->priv;
+    int ret;
+
+    if (!scale->pending_flags || !av_fifo_can_read(scale->pending_flags))
+        return 0;
+
+    ret = sws_send_frame(scale->sws, NULL, NULL);
+    if (ret < 0)
+        return ret;
+    return scale_receive_frames(ctx);
+}
+
 static int scale_filter_prepare(AVFilterContext *ctx)
 {
     ScaleContext *s = ctx->priv;
     int ret;
 
     ret = ff_framesync_filter_prepare(&s->fs);
+    if (ret == AVERROR_EOF) {
+        int err = scale_flush(ctx);
+        if (err < 0)
+            return err;
+    }
     if (ret < 0)
         return ret;
 
@@ -703,9 +791,11 @@ static int scale_filter_prepare(AVFilterContext *ctx)
     return 0;
 }
 
-/* Takes over ownership of *frame_in, passes ownership of *frame_out to caller */
+/* Takes over ownership of *frame_in, passes ownership of *frame_out to caller.
+ * With frame threading, *frame_out may be NULL, and the output frame is sent
+ * once it is done scaling. */
 static int scale_frame(AVFilterLink *link, AVFrame **frame_in,
-                       AVFrame **frame_out)
+                       AVFrame **frame_out, int64_t pts)
 {
     FilterLink *inl = ff_filter_link(link);
     AVFilterContext *ctx = link->dst;
@@ -801,6 +891,7 @@ scale:
         in->flags &= ~AV_FRAME_FLAG_INTERLACED;
 
     av_frame_copy_props(out, in);
+    out->pts    = pts;
     out->width  = outlink->w;
     out->height = outlink->h;
     out->color_range = outlink->color_range;
@@ -834,8 +925,10 @@ scale:
     if (sws_is_noop(out, in)) {
         av_frame_free(&out);
         in->flags = flags_orig;
+        in->pts   = pts;
         *frame_out = in;
-        return 0;
+        /* keep the frames in order */
+        return scale_flush(ctx);
     }
 
     if (out->format == AV_PIX_FMT_PAL8) {
@@ -843,6 +936,11 @@ scale:
         avpriv_set_systematic_pal2((uint32_t*) out->data[1], out->format);
     }
 
+    if (scale->pending_flags) {
+        *frame_out = NULL;
+        return scale_send_frame(ctx, out, in, flags_orig);
+    }
+
     ret = sws_scale_frame(scale->sws, out, in);
     av_frame_free(&in);
     out->flags = flags_orig;
@@ -863,7 +961,7 @@ static int do_scale(FFFrameSync *fs)
     ScaleContext *scale = ctx->priv;
     AVFilterLink *outlink = ctx->outputs[0];
     AVFrame *ref = scale->frame_ref;
-    AVFrame *out;
+    AVFrame *out = NULL;
     int ret = 0, frame_changed;
 
     if (ref) {
@@ -898,12 +996,15 @@ static int do_scale(FFFrameSync *fs)
         }
     }
 
-    ret = scale_frame(ctx->inputs[0], &scale->frame, &out);
-    if (ret < 0)
+    ret = scale_frame(ctx->inputs[0], &scale->frame, &out,
+                      av_rescale_q(fs->pts, fs->time_base, outlink->time_base));
+    if (ret < 0) {
+        av_frame_free(&out);
         goto err;
+    }
 
-    av_assert0(out);
-    out->pts = av_rescale_q(fs->pts, fs->time_base, outlink->time_base);
+    if (!out)
+        return 0;
     return ff_filter_frame(outlink, out);
 
 err:
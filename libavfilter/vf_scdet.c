@@ -38,12 +38,16 @@ typedef struct SCDetContext {
     ptrdiff_t height[4];
     int nb_planes;
     int bitdepth;
-    ff_scene_sad_fn sad;
+    SceneSADContext scene;
     double prev_mafd;
     double scene_score;
+    double hist_dist;
     AVFrame *prev_picref;
     double threshold;
     int sc_pass;
+    int mode;
+    double refine;
+    double hist_threshold;
 } SCDetContext;
 
 #define OFFSET(x) offsetof(SCDetContext, x)
@@ -55,6 +59,11 @@ static const AVOption scdet_options[] = {
     { "t",           "set scene change detect threshold",        OFFSET(threshold),  AV_OPT_TYPE_DOUBLE,   {.dbl = 10.},     0,  100., V|F },
     { "sc_pass",     "Set the flag to pass scene change frames", OFFSET(sc_pass),    AV_OPT_TYPE_BOOL,     {.i64 = 0  },     0,    1,  V|F },
     { "s",           "Set the flag to pass scene change frames", OFFSET(sc_pass),    AV_OPT_TYPE_BOOL,     {.i64 = 0  },     0,    1,  V|F },
+    { "mode",        "set the resolution of the frame difference", OFFSET(mode),     AV_OPT_TYPE_INT,      {.i64 = 0  },     0,    1,  V|F, .unit = "mode" },
+        { "full",    "compare the full frames",                  0,                  AV_OPT_TYPE_CONST,    {.i64 = 0  },     0,    0,  V|F, .unit = "mode" },
+        { "fast",    "compare 4x4 decimated frames",             0,                  AV_OPT_TYPE_CONST,    {.i64 = 1  },     0,    0,  V|F, .unit = "mode" },
+    { "refine",      "set the score range around the threshold checked with histograms", OFFSET(refine), AV_OPT_TYPE_DOUBLE, {.dbl = 0.}, 0, 100., V|F },
+    { "hist_threshold", "set the histogram distance threshold of refined scores", OFFSET(hist_threshold), AV_OPT_TYPE_DOUBLE, {.dbl = 25.}, 0, 100., V|F },
     {NULL}
 };
 
@@ -81,6 +90,7 @@ static int config_input(AVFilterLink *inlink)
     int is_yuv = !(desc->flags & AV_PIX_FMT_FLAG_RGB) &&
         (desc->flags & AV_PIX_FMT_FLAG_PLANAR) &&
         desc->nb_components >= 3;
+    int ret;
 
     s->bitdepth = desc->comp[0].depth;
     s->nb_planes = is_yuv ? 1 : av_pix_fmt_count_planes(inlink->format);
@@ -91,9 +101,10 @@ static int config_input(AVFilterLink *inlink)
         s->height[plane] = inlink->h >> ((plane == 1 || plane == 2) ? desc->log2_chroma_h : 0);
     }
 
-    s->sad = ff_scene_sad_get_fn(s->bitdepth);
-    if (!s->sad)
-        return AVERROR(EINVAL);
+    ret = ff_scene_sad_init(ctx, &s->scene, s->nb_planes, s->width, s->height,
+                            s->bitdepth, is_yuv ? 1 : desc->comp[0].step, s->mode);
+    if (ret < 0)
+        return ret;
 
     return 0;
 }
@@ -103,6 +114,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     SCDetContext *s = ctx->priv;
 
     av_frame_free(&s->prev_picref);
+    ff_scene_sad_uninit(&s->scene);
 }
 
 static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
@@ -110,29 +122,42 @@ static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
     double ret = 0;
     SCDetContext *s = ctx->priv;
     AVFrame *prev_picref = s->prev_picref;
+    uint64_t sad, count;
+    int have_sad = 0;
+
+    s->hist_dist = NAN;
+    if (s->scene.fast) {
+        /* the thumbnails are sized for the link, start over on other frames */
+        if (frame->width  == ctx->inputs[0]->w &&
+            frame->height == ctx->inputs[0]->h)
+            have_sad = ff_scene_sad_thumb(ctx, &s->scene, frame, &sad, &count);
+        else
+            s->scene.have_thumb = 0;
+    } else {
+        if (prev_picref && frame->height == prev_picref->height
+                        && frame->width  == prev_picref->width) {
+            sad = ff_scene_sad_frames(ctx, &s->scene, prev_picref, frame, &count);
+            have_sad = 1;
+        }
+        av_frame_free(&s->prev_picref);
+        s->prev_picref = av_frame_clone(frame);
+    }
 
-    if (prev_picref && frame->height == prev_picref->height
-                    && frame->width  == prev_picref->width) {
-        uint64_t sad = 0;
+    if (have_sad) {
         double mafd, diff;
-        uint64_t count = 0;
-
-        for (int plane = 0; plane < s->nb_planes; plane++) {
-            uint64_t plane_sad;
-            s->sad(prev_picref->data[plane], prev_picref->linesize[plane],
-                    frame->data[plane], frame->linesize[plane],
-                    s->width[plane], s->height[plane], &plane_sad);
-            sad += plane_sad;
-            count += s->width[plane] * s->height[plane];
-        }
 
         mafd = (double)sad * 100. / count / (1ULL << s->bitdepth);
         diff = fabs(mafd - s->prev_mafd);
         ret  = av_clipf(FFMIN(mafd, diff), 0, 100.);
         s->prev_mafd = mafd;
-        av_frame_free(&prev_picref);
+
+        /* scores close to the threshold are decided by the histograms */
+        if (s->scene.fast && s->refine > 0. && fabs(ret - s->threshold) < s->refine)
+            s->hist_dist = 100. * ff_scene_sad_thumb_histdist(&s->scene);
+    } else {
+        /* no previous frame to compare with, forget its mafd too */
+        s->prev_mafd = 0.;
     }
-    s->prev_picref = av_frame_clone(frame);
     return ret;
 }
 
@@ -157,20 +182,29 @@ static int activate(AVFilterContext *ctx)
 
     if (frame) {
         char buf[64];
+        int scene;
+
         s->scene_score = get_scene_score(ctx, frame);
         snprintf(buf, sizeof(buf), "%0.3f", s->prev_mafd);
         set_meta(s, frame, "lavfi.scd.mafd", buf);
         snprintf(buf, sizeof(buf), "%0.3f", s->scene_score);
         set_meta(s, frame, "lavfi.scd.score", buf);
 
-        if (s->scene_score >= s->threshold) {
+        scene = s->scene_score >= s->threshold;
+        if (!isnan(s->hist_dist)) {
+            snprintf(buf, sizeof(buf), "%0.3f", s->hist_dist);
+            set_meta(s, frame, "lavfi.scd.hist", buf);
+            scene = s->hist_dist >= s->hist_threshold;
+        }
+
+        if (scene) {
             av_log(ctx, AV_LOG_INFO, "lavfi.scd.score: %.3f, lavfi.scd.time: %s\n",
                     s->scene_score, av_ts2timestr(frame->pts, &inlink->time_base));
             set_meta(s, frame, "lavfi.scd.time",
                     av_ts2timestr(frame->pts, &inlink->time_base));
         }
         if (s->sc_pass) {
-            if (s->scene_score >= s->threshold)
+            if (scene)
                 return ff_filter_frame(outlink, frame);
             else {
                 av_frame_free(&frame);
@@ -197,7 +231,7 @@ const FFFilter ff_vf_scdet = {
     .p.name        = "scdet",
     .p.description = NULL_IF_CONFIG_SMALL("Detect video scene change"),
     .p.priv_class  = &scdet_class,
-    .p.flags       = AVFILTER_FLAG_METADATA_ONLY,
+    .p.flags       = AVFILTER_FLAG_METADATA_ONLY | AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(SCDetContext),
     .uninit        = uninit,
     FILTER_INPUTS(scdet_inputs),
@@ -24,12 +24,20 @@
  * @see http://epubs.surrey.ac.uk/531590/1/MPEG-7%20Video%20Signature%20Author%27s%20Copy.pdf
  */
 
+#include "config.h"
+
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include "libavcodec/put_bits.h"
 #include "libavformat/avformat.h"
+#include "libavformat/os_support.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/avstring.h"
 #include "libavutil/file_open.h"
+#include "libavutil/intreadwrite.h"
 #include "avfilter.h"
 #include "filters.h"
 #include "signature.h"
@@ -39,6 +47,11 @@
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM | AV_OPT_FLAG_VIDEO_PARAM
 #define BLOCK_LCM (int64_t) 476985600
 
+#define INDEX_MAGIC   MKTAG('L', 'V', 'S', 'I')
+#define INDEX_VERSION 1
+/* pts, confidence, words and framesignature of one frame */
+#define INDEX_FRAME_SIZE (8 + 1 + 5 + SIGELEM_SIZE/5)
+
 static const AVOption signature_options[] = {
     { "detectmode", "set the detectmode",
         OFFSET(mode),         AV_OPT_TYPE_INT,    {.i64 = MODE_OFF}, 0, NB_LOOKUP_MODE-1, FLAGS, .unit = "mode" },
@@ -63,6 +76,15 @@ static const AVOption signature_options[] = {
         OFFSET(thdi),         AV_OPT_TYPE_INT,    {.i64 = 0},        0, INT_MAX,          FLAGS },
     { "th_it",      "threshold for relation of good to all frames",
         OFFSET(thit),         AV_OPT_TYPE_DOUBLE, {.dbl = 0.5},    0.0, 1.0,              FLAGS },
+    { "index",      "filename of the signature catalogue",
+        OFFSET(index_filename), AV_OPT_TYPE_STRING, {.str = NULL},   0, 0,                FLAGS },
+    { "indexmode",  "set how the signature catalogue is used",
+        OFFSET(index_mode),   AV_OPT_TYPE_INT,    {.i64 = INDEX_OFF}, 0, NB_INDEX_MODE-1, FLAGS, .unit = "indexmode" },
+        { "off",    NULL, 0, AV_OPT_TYPE_CONST, {.i64 = INDEX_OFF},    0, 0, .flags = FLAGS, .unit = "indexmode" },
+        { "build",  NULL, 0, AV_OPT_TYPE_CONST, {.i64 = INDEX_BUILD},  0, 0, .flags = FLAGS, .unit = "indexmode" },
+        { "lookup", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = INDEX_LOOKUP}, 0, 0, .flags = FLAGS, .unit = "indexmode" },
+    { "clipname",   "name of the inputs in the signature catalogue",
+        OFFSET(clipname),     AV_OPT_TYPE_STRING, {.str = "clip%d"}, 0, 0,                FLAGS },
     { NULL }
 };
 
@@ -81,6 +103,45 @@ static const enum AVPixelFormat pix_fmts[] = {
     AV_PIX_FMT_NONE
 };
 
+static int stream_init(StreamContext *sc)
+{
+    sc->lastindex = 0;
+    sc->finesiglist = av_mallocz(sizeof(FineSignature));
+    if (!sc->finesiglist)
+        return AVERROR(ENOMEM);
+    sc->curfinesig = NULL;
+
+    sc->coarsesiglist = av_mallocz(sizeof(CoarseSignature));
+    if (!sc->coarsesiglist)
+        return AVERROR(ENOMEM);
+    sc->curcoarsesig1 = sc->coarsesiglist;
+    sc->coarseend = sc->coarsesiglist;
+    sc->coarsecount = 0;
+    sc->midcoarse = 0;
+    return 0;
+}
+
+static void stream_free(StreamContext *sc)
+{
+    FineSignature* finsig = sc->finesiglist;
+    CoarseSignature* cousig = sc->coarsesiglist;
+    void* tmp;
+
+    while (finsig) {
+        tmp = finsig;
+        finsig = finsig->next;
+        av_freep(&tmp);
+    }
+    sc->finesiglist = NULL;
+
+    while (cousig) {
+        tmp = cousig;
+        cousig = cousig->next;
+        av_freep(&tmp);
+    }
+    sc->coarsesiglist = NULL;
+}
+
 static int config_input(AVFilterLink *inlink)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -95,6 +156,15 @@ static int config_input(AVFilterLink *inlink)
     }
     sc->w = inlink->w;
     sc->h = inlink->h;
+    for (int i = 0; i <= 32; i++)
+        sc->blockx[i] = (i * inlink->w + 31) / 32;
+
+    if (!sic->intpic) {
+        sic->nb_threads = ff_filter_get_nb_threads(ctx);
+        sic->intpic = av_malloc_array(sic->nb_threads, sizeof(*sic->intpic));
+        if (!sic->intpic)
+            return AVERROR(ENOMEM);
+    }
     return 0;
 }
 
@@ -141,6 +211,105 @@ static void set_bit(uint8_t* data, size_t pos)
     data[pos/8] |= mask;
 }
 
+static FineSignature *new_finesig(StreamContext *sc)
+{
+    FineSignature *fs;
+
+    if (sc->curfinesig) {
+        fs = av_mallocz(sizeof(FineSignature));
+        if (!fs)
+            return NULL;
+        sc->curfinesig->next = fs;
+        fs->prev = sc->curfinesig;
+        sc->curfinesig = fs;
+    } else {
+        fs = sc->curfinesig = sc->finesiglist;
+        sc->curcoarsesig1->first = fs;
+    }
+
+    fs->index = sc->lastindex++;
+    return fs;
+}
+
+/**
+ * adds the words of a finished finesignature to the current coarsesignatures
+ */
+static int add_coarsesig(StreamContext *sc, FineSignature *fs)
+{
+    int i;
+
+    if (sc->coarsecount == 0) {
+        if (sc->curcoarsesig2) {
+            sc->curcoarsesig1 = av_mallocz(sizeof(CoarseSignature));
+            if (!sc->curcoarsesig1)
+                return AVERROR(ENOMEM);
+            sc->curcoarsesig1->first = fs;
+            sc->curcoarsesig2->next = sc->curcoarsesig1;
+            sc->coarseend = sc->curcoarsesig1;
+        }
+    }
+    if (sc->coarsecount == 45) {
+        sc->midcoarse = 1;
+        sc->curcoarsesig2 = av_mallocz(sizeof(CoarseSignature));
+        if (!sc->curcoarsesig2)
+            return AVERROR(ENOMEM);
+        sc->curcoarsesig2->first = fs;
+        sc->curcoarsesig1->next = sc->curcoarsesig2;
+        sc->coarseend = sc->curcoarsesig2;
+    }
+    for (i = 0; i < 5; i++) {
+        set_bit(sc->curcoarsesig1->data[i], fs->words[i]);
+    }
+    /* assuming the actual frame is the last */
+    sc->curcoarsesig1->last = fs;
+    if (sc->midcoarse) {
+        for (i = 0; i < 5; i++) {
+            set_bit(sc->curcoarsesig2->data[i], fs->words[i]);
+        }
+        sc->curcoarsesig2->last = fs;
+    }
+
+    sc->coarsecount = (sc->coarsecount+1)%90;
+    return 0;
+}
+
+typedef struct ThreadData {
+    const AVFrame *in;
+    const StreamContext *sc;
+} ThreadData;
+
+/**
+ * sums up the luma of the rows of one slice in the 32x32 blocks
+ */
+static int block_sums_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    SignatureContext *sic = ctx->priv;
+    ThreadData *td = arg;
+    const StreamContext *sc = td->sc;
+    const ptrdiff_t linesize = td->in->linesize[0];
+    const int slice_start = (sc->h *  jobnr     ) / nb_jobs;
+    const int slice_end   = (sc->h * (jobnr + 1)) / nb_jobs;
+    const uint8_t *p = td->in->data[0] + slice_start * linesize;
+    uint64_t (*intpic)[32] = sic->intpic[jobnr];
+
+    memset(intpic, 0, sizeof(sic->intpic[0]));
+
+    for (int i = slice_start; i < slice_end; i++) {
+        uint64_t *row = intpic[(i*32)/sc->h];
+
+        for (int j = 0; j < 32; j++) {
+            unsigned sum = 0;
+
+            for (int x = sc->blockx[j]; x < sc->blockx[j+1]; x++)
+                sum += p[x];
+            row[j] += sum;
+        }
+        p += linesize;
+    }
+
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -158,15 +327,14 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     uint8_t wordt2b[5] = { 0, 0, 0, 0, 0 }; /* word ternary to binary */
     uint64_t intpic[32][32];
     uint64_t rowcount;
-    uint8_t *p = picref->data[0];
-    int inti, intj;
-    int *intjlut;
+    ThreadData td = { .in = picref, .sc = sc };
+    const int nb_jobs = FFMIN(inlink->h, sic->nb_threads);
 
     uint64_t conflist[DIFFELEM_SIZE];
     int f = 0, g = 0, w = 0;
     int32_t dh1 = 1, dh2 = 1, dw1 = 1, dw2 = 1, a, b;
     int64_t denom;
-    int i, j, k, ternary;
+    int i, j, k, ternary, ret;
     uint64_t blocksum;
     int blocksize;
     int64_t th; /* threshold */
@@ -175,38 +343,21 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     int64_t precfactor = (sc->divide) ? 65536 : BLOCK_LCM;
 
     /* initialize fs */
-    if (sc->curfinesig) {
-        fs = av_mallocz(sizeof(FineSignature));
-        if (!fs)
-            return AVERROR(ENOMEM);
-        sc->curfinesig->next = fs;
-        fs->prev = sc->curfinesig;
-        sc->curfinesig = fs;
-    } else {
-        fs = sc->curfinesig = sc->finesiglist;
-        sc->curcoarsesig1->first = fs;
-    }
+    fs = new_finesig(sc);
+    if (!fs)
+        return AVERROR(ENOMEM);
 
     fs->pts = picref->pts;
-    fs->index = sc->lastindex++;
 
-    memset(intpic, 0, sizeof(uint64_t)*32*32);
-    intjlut = av_malloc_array(inlink->w, sizeof(int));
-    if (!intjlut)
-        return AVERROR(ENOMEM);
-    for (i = 0; i < inlink->w; i++) {
-        intjlut[i] = (i*32)/inlink->w;
-    }
+    ff_filter_execute(ctx, block_sums_slice, &td, NULL, nb_jobs);
 
-    for (i = 0; i < inlink->h; i++) {
-        inti = (i*32)/inlink->h;
-        for (j = 0; j < inlink->w; j++) {
-            intj = intjlut[j];
-            intpic[inti][intj] += p[j];
+    memcpy(intpic, sic->intpic[0], sizeof(intpic));
+    for (k = 1; k < nb_jobs; k++) {
+        for (i = 0; i < 32; i++) {
+            for (j = 0; j < 32; j++)
+                intpic[i][j] += sic->intpic[k][i][j];
         }
-        p += picref->linesize[0];
     }
-    av_freep(&intjlut);
 
     /* The following calculates a summed area table (intpic) and brings the numbers
      * in intpic to the same denominator.
@@ -311,38 +462,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     fs->confidence = FFMIN(conflist[DIFFELEM_SIZE/2], 255);
 
     /* coarsesignature */
-    if (sc->coarsecount == 0) {
-        if (sc->curcoarsesig2) {
-            sc->curcoarsesig1 = av_mallocz(sizeof(CoarseSignature));
-            if (!sc->curcoarsesig1)
-                return AVERROR(ENOMEM);
-            sc->curcoarsesig1->first = fs;
-            sc->curcoarsesig2->next = sc->curcoarsesig1;
-            sc->coarseend = sc->curcoarsesig1;
-        }
-    }
-    if (sc->coarsecount == 45) {
-        sc->midcoarse = 1;
-        sc->curcoarsesig2 = av_mallocz(sizeof(CoarseSignature));
-        if (!sc->curcoarsesig2)
-            return AVERROR(ENOMEM);
-        sc->curcoarsesig2->first = fs;
-        sc->curcoarsesig1->next = sc->curcoarsesig2;
-        sc->coarseend = sc->curcoarsesig2;
-    }
-    for (i = 0; i < 5; i++) {
-        set_bit(sc->curcoarsesig1->data[i], fs->words[i]);
-    }
-    /* assuming the actual frame is the last */
-    sc->curcoarsesig1->last = fs;
-    if (sc->midcoarse) {
-        for (i = 0; i < 5; i++) {
-            set_bit(sc->curcoarsesig2->data[i], fs->words[i]);
-        }
-        sc->curcoarsesig2->last = fs;
-    }
-
-    sc->coarsecount = (sc->coarsecount+1)%90;
+    ret = add_coarsesig(sc, fs);
+    if (ret < 0)
+        return ret;
 
     /* debug printing finesignature */
     if (av_log_get_level() == AV_LOG_DEBUG) {
@@ -574,6 +696,462 @@ static int export(AVFilterContext *ctx, StreamContext *sc, int input)
     }
 }
 
+static void index_free(SignatureIndex **pidx)
+{
+    SignatureIndex *idx = *pidx;
+
+    if (!idx)
+        return;
+
+    for (int i = 0; i < idx->nb_clips; i++) {
+        av_freep(&idx->names[i]);
+        stream_free(&idx->clips[i]);
+    }
+    av_freep(&idx->names);
+    av_freep(&idx->clips);
+    av_freep(&idx->segments);
+    av_freep(&idx->segment_clip);
+    for (int i = 0; i < 5; i++) {
+        for (int w = 0; w < 243; w++)
+            av_freep(&idx->postings[i][w]);
+    }
+    av_freep(pidx);
+}
+
+/**
+ * appends an empty clip to the catalogue
+ */
+static StreamContext *index_add_clip(SignatureIndex *idx, char *name)
+{
+    StreamContext *clips;
+    char **names;
+
+    if (!name)
+        return NULL;
+
+    clips = av_realloc_array(idx->clips, idx->nb_clips + 1, sizeof(*clips));
+    if (clips)
+        idx->clips = clips;
+    names = av_realloc_array(idx->names, idx->nb_clips + 1, sizeof(*names));
+    if (names)
+        idx->names = names;
+    if (!clips || !names) {
+        av_free(name);
+        return NULL;
+    }
+
+    memset(&clips[idx->nb_clips], 0, sizeof(*clips));
+    names[idx->nb_clips] = name;
+    return &clips[idx->nb_clips++];
+}
+
+/**
+ * lists the coarse signatures of all clips, their position in this list is
+ * the id used by the postings
+ */
+static int index_build_segments(SignatureIndex *idx)
+{
+    int nb_segments = 0;
+
+    av_freep(&idx->segments);
+    av_freep(&idx->segment_clip);
+
+    for (int i = 0; i < idx->nb_clips; i++) {
+        for (CoarseSignature *cs = idx->clips[i].coarsesiglist; cs; cs = cs->next)
+            nb_segments += !!cs->first;
+    }
+
+    idx->nb_segments = nb_segments;
+    if (!nb_segments)
+        return 0;
+
+    idx->segments = av_malloc_array(nb_segments, sizeof(*idx->segments));
+    idx->segment_clip = av_malloc_array(nb_segments, sizeof(*idx->segment_clip));
+    if (!idx->segments || !idx->segment_clip)
+        return AVERROR(ENOMEM);
+
+    nb_segments = 0;
+    for (int i = 0; i < idx->nb_clips; i++) {
+        for (CoarseSignature *cs = idx->clips[i].coarsesiglist; cs; cs = cs->next) {
+            if (!cs->first)
+                continue;
+            idx->segments[nb_segments] = cs;
+            idx->segment_clip[nb_segments++] = i;
+        }
+    }
+
+    return 0;
+}
+
+static int index_build_postings(SignatureIndex *idx)
+{
+    for (int i = 0; i < 5; i++) {
+        for (int w = 0; w < 243; w++) {
+            av_freep(&idx->postings[i][w]);
+            idx->nb_postings[i][w] = 0;
+        }
+    }
+
+    for (int s = 0; s < idx->nb_segments; s++) {
+        const CoarseSignature *cs = idx->segments[s];
+
+        for (int i = 0; i < 5; i++) {
+            for (int w = 0; w < 243; w++)
+                idx->nb_postings[i][w] += !!(cs->data[i][w/8] & (1 << (7 - w%8)));
+        }
+    }
+
+    for (int i = 0; i < 5; i++) {
+        for (int w = 0; w < 243; w++) {
+            if (!idx->nb_postings[i][w])
+                continue;
+            idx->postings[i][w] = av_malloc_array(idx->nb_postings[i][w], sizeof(uint32_t));
+            if (!idx->postings[i][w])
+                return AVERROR(ENOMEM);
+            idx->nb_postings[i][w] = 0;
+        }
+    }
+
+    for (int s = 0; s < idx->nb_segments; s++) {
+        const CoarseSignature *cs = idx->segments[s];
+
+        for (int i = 0; i < 5; i++) {
+            for (int w = 0; w < 243; w++) {
+                if (cs->data[i][w/8] & (1 << (7 - w%8)))
+                    idx->postings[i][w][idx->nb_postings[i][w]++] = s;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int read_u32(FILE *f, uint32_t *val)
+{
+    uint8_t buf[4];
+
+    if (fread(buf, 1, sizeof(buf), f) != sizeof(buf))
+        return AVERROR_INVALIDDATA;
+    *val = AV_RL32(buf);
+    return 0;
+}
+
+static int write_u32(FILE *f, uint32_t val)
+{
+    uint8_t buf[4];
+
+    AV_WL32(buf, val);
+    return fwrite(buf, 1, sizeof(buf), f) == sizeof(buf) ? 0 : AVERROR(EIO);
+}
+
+static int index_read_clip(FILE *f, SignatureIndex *idx)
+{
+    uint8_t frame[INDEX_FRAME_SIZE];
+    uint32_t len, num, den, nb_frames;
+    StreamContext *sc;
+    char *name;
+    int ret;
+
+    if ((ret = read_u32(f, &len)) < 0)
+        return ret;
+    if (len > 4096)
+        return AVERROR_INVALIDDATA;
+    name = av_malloc(len + 1);
+    if (!name)
+        return AVERROR(ENOMEM);
+    if (fread(name, 1, len, f) != len) {
+        av_free(name);
+        return AVERROR_INVALIDDATA;
+    }
+    name[len] = 0;
+
+    sc = index_add_clip(idx, name);
+    if (!sc)
+        return AVERROR(ENOMEM);
+    if ((ret = stream_init(sc)) < 0)
+        return ret;
+
+    if ((ret = read_u32(f, &num)) < 0 ||
+        (ret = read_u32(f, &den)) < 0 ||
+        (ret = read_u32(f, &nb_frames)) < 0)
+        return ret;
+    if (!num || !den || num > INT_MAX || den > INT_MAX)
+        return AVERROR_INVALIDDATA;
+    sc->time_base = av_make_q(num, den);
+
+    for (uint32_t i = 0; i < nb_frames; i++) {
+        FineSignature *fs;
+
+        if (fread(frame, 1, sizeof(frame), f) != sizeof(frame))
+            return AVERROR_INVALIDDATA;
+
+        fs = new_finesig(sc);
+        if (!fs)
+            return AVERROR(ENOMEM);
+        fs->pts = AV_RL64(frame);
+        fs->confidence = frame[8];
+        memcpy(fs->words, frame + 9, sizeof(fs->words));
+        memcpy(fs->framesig, frame + 14, sizeof(fs->framesig));
+        for (int j = 0; j < 5; j++) {
+            if (fs->words[j] >= 243)
+                return AVERROR_INVALIDDATA;
+        }
+
+        if ((ret = add_coarsesig(sc, fs)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+/**
+ * @param optional whether a missing file is treated as an empty catalogue
+ */
+static int index_load(AVFilterContext *ctx, SignatureIndex *idx, const char *filename, int optional)
+{
+    uint32_t tag, version, nb_clips, nb_segments;
+    FILE *f;
+    int ret;
+
+    f = avpriv_fopen_utf8(filename, "rb");
+    if (!f) {
+        ret = AVERROR(errno);
+        if (optional && ret == AVERROR(ENOENT))
+            return 0;
+        av_log(ctx, AV_LOG_ERROR, "cannot open index file %s: %s\n", filename, av_err2str(ret));
+        return ret;
+    }
+
+    if ((ret = read_u32(f, &tag)) < 0 ||
+        (ret = read_u32(f, &version)) < 0 ||
+        (ret = read_u32(f, &nb_clips)) < 0)
+        goto fail;
+    if (tag != INDEX_MAGIC || version != INDEX_VERSION) {
+        ret = AVERROR_INVALIDDATA;
+        goto fail;
+    }
+
+    for (uint32_t i = 0; i < nb_clips; i++) {
+        if ((ret = index_read_clip(f, idx)) < 0)
+            goto fail;
+    }
+
+    if ((ret = index_build_segments(idx)) < 0 ||
+        (ret = read_u32(f, &nb_segments)) < 0)
+        goto fail;
+    if (nb_segments != idx->nb_segments) {
+        ret = AVERROR_INVALIDDATA;
+        goto fail;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        for (int w = 0; w < 243; w++) {
+            uint32_t count;
+
+            if ((ret = read_u32(f, &count)) < 0)
+                goto fail;
+            if (count > nb_segments) {
+                ret = AVERROR_INVALIDDATA;
+                goto fail;
+            }
+            idx->nb_postings[i][w] = count;
+            if (!count)
+                continue;
+            idx->postings[i][w] = av_malloc_array(count, sizeof(uint32_t));
+            if (!idx->postings[i][w]) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            for (uint32_t p = 0; p < count; p++) {
+                if ((ret = read_u32(f, &idx->postings[i][w][p])) < 0)
+                    goto fail;
+                if (idx->postings[i][w][p] >= nb_segments) {
+                    ret = AVERROR_INVALIDDATA;
+                    goto fail;
+                }
+            }
+        }
+    }
+
+    av_log(ctx, AV_LOG_VERBOSE, "loaded %d clips with %d segments from %s\n",
+           idx->nb_clips, idx->nb_segments, filename);
+    fclose(f);
+    return 0;
+fail:
+    if (ret == AVERROR_INVALIDDATA)
+        av_log(ctx, AV_LOG_ERROR, "invalid index file %s\n", filename);
+    fclose(f);
+    return ret;
+}
+
+/**
+ * Write the catalogue to a temporary file next to filename and rename it over
+ * filename, so that a failed write leaves the previous catalogue intact.
+ */
+static int index_write(AVFilterContext *ctx, const SignatureIndex *idx, const char *filename)
+{
+    uint8_t frame[INDEX_FRAME_SIZE];
+    char *tmp_filename;
+    int ret = 0;
+    FILE *f;
+
+    tmp_filename = av_asprintf("%s.tmp", filename);
+    if (!tmp_filename)
+        return AVERROR(ENOMEM);
+
+    f = avpriv_fopen_utf8(tmp_filename, "wb");
+    if (!f) {
+        ret = AVERROR(errno);
+        av_log(ctx, AV_LOG_ERROR, "cannot open index file %s: %s\n", tmp_filename, av_err2str(ret));
+        av_free(tmp_filename);
+        return ret;
+    }
+
+    if ((ret = write_u32(f, INDEX_MAGIC)) < 0 ||
+        (ret = write_u32(f, INDEX_VERSION)) < 0 ||
+        (ret = write_u32(f, idx->nb_clips)) < 0)
+        goto end;
+
+    for (int i = 0; i < idx->nb_clips; i++) {
+        const StreamContext *sc = &idx->clips[i];
+        const size_t len = strlen(idx->names[i]);
+
+        if ((ret = write_u32(f, len)) < 0)
+            goto end;
+        if (fwrite(idx->names[i], 1, len, f) != len) {
+            ret = AVERROR(EIO);
+            goto end;
+        }
+        if ((ret = write_u32(f, sc->time_base.num)) < 0 ||
+            (ret = write_u32(f, sc->time_base.den)) < 0 ||
+            (ret = write_u32(f, sc->lastindex)) < 0)
+            goto end;
+
+        for (const FineSignature *fs = sc->finesiglist; fs && fs->index < sc->lastindex; fs = fs->next) {
+            AV_WL64(frame, fs->pts);
+            frame[8] = fs->confidence;
+            memcpy(frame + 9, fs->words, sizeof(fs->words));
+            memcpy(frame + 14, fs->framesig, sizeof(fs->framesig));
+            if (fwrite(frame, 1, sizeof(frame), f) != sizeof(frame)) {
+                ret = AVERROR(EIO);
+                goto end;
+            }
+        }
+    }
+
+    if ((ret = write_u32(f, idx->nb_segments)) < 0)
+        goto end;
+    for (int i = 0; i < 5; i++) {
+        for (int w = 0; w < 243; w++) {
+            if ((ret = write_u32(f, idx->nb_postings[i][w])) < 0)
+                goto end;
+            for (uint32_t p = 0; p < idx->nb_postings[i][w]; p++) {
+                if ((ret = write_u32(f, idx->postings[i][w][p])) < 0)
+                    goto end;
+            }
+        }
+    }
+
+end:
+    if (fclose(f) && ret >= 0)
+        ret = AVERROR(EIO);
+    if (ret >= 0 && rename(tmp_filename, filename) < 0)
+        ret = AVERROR(errno);
+    if (ret < 0) {
+        av_log(ctx, AV_LOG_ERROR, "cannot write index file %s: %s\n", filename, av_err2str(ret));
+        unlink(tmp_filename);
+    }
+    av_free(tmp_filename);
+    return ret;
+}
+
+static char *get_clipname(SignatureContext *sic, int input)
+{
+    char name[1024];
+
+    if (av_get_frame_filename(name, sizeof(name), sic->clipname, input) < 0)
+        return av_strdup(sic->clipname);
+    return av_strdup(name);
+}
+
+/**
+ * adds the inputs to the catalogue and stores it
+ */
+static int index_build(AVFilterContext *ctx)
+{
+    SignatureContext *sic = ctx->priv;
+    SignatureIndex *idx = sic->index;
+    int ret;
+
+    for (int i = 0; i < sic->nb_inputs; i++) {
+        StreamContext *sc = &sic->streamcontexts[i];
+        StreamContext *clip;
+
+        if (!sc->lastindex)
+            continue;
+
+        clip = index_add_clip(idx, get_clipname(sic, i));
+        if (!clip)
+            return AVERROR(ENOMEM);
+        /* the catalogue takes over the signature lists */
+        *clip = *sc;
+        sc->finesiglist = NULL;
+        sc->coarsesiglist = NULL;
+    }
+
+    if ((ret = index_build_segments(idx)) < 0 ||
+        (ret = index_build_postings(idx)) < 0)
+        return ret;
+
+    av_log(ctx, AV_LOG_INFO, "index %s has %d clips with %d segments\n",
+           sic->index_filename, idx->nb_clips, idx->nb_segments);
+
+    return index_write(ctx, idx, sic->index_filename);
+}
+
+static int index_lookup(AVFilterContext *ctx)
+{
+    SignatureContext *sic = ctx->priv;
+    SignatureIndex *idx = sic->index;
+    MatchingInfo *best;
+    int ret = 0;
+
+    best = av_calloc(FFMAX(idx->nb_clips, 1), sizeof(*best));
+    if (!best)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < sic->nb_inputs; i++) {
+        StreamContext *sc = &sic->streamcontexts[i];
+        int found = 0;
+
+        if (!sc->lastindex)
+            continue;
+
+        ret = lookup_index(ctx, sic, sc, idx, best, sic->mode == MODE_FAST ? MODE_FAST : MODE_FULL);
+        if (ret < 0)
+            break;
+
+        for (int j = 0; j < idx->nb_clips; j++) {
+            const StreamContext *clip = &idx->clips[j];
+
+            if (!best[j].score)
+                continue;
+            found = 1;
+            av_log(ctx, AV_LOG_INFO, "matching of video %d at %f and %s at %f, %d frames matching\n",
+                   i, ((double) best[j].first->pts * sc->time_base.num) / sc->time_base.den,
+                   idx->names[j], ((double) best[j].second->pts * clip->time_base.num) / clip->time_base.den,
+                   best[j].matchframes);
+            if (best[j].whole)
+                av_log(ctx, AV_LOG_INFO, "whole video matching\n");
+        }
+        if (!found)
+            av_log(ctx, AV_LOG_INFO, "no matching of video %d in index\n", i);
+    }
+
+    av_freep(&best);
+    return ret;
+}
+
 static int request_frame(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -627,6 +1205,19 @@ static int request_frame(AVFilterLink *outlink)
         }
     }
 
+    /* catalogue */
+    if (lookup && sic->index_mode != INDEX_OFF && !sic->index_done) {
+        int err;
+
+        sic->index_done = 1;
+        if (sic->index_mode == INDEX_BUILD)
+            err = index_build(ctx);
+        else
+            err = index_lookup(ctx);
+        if (err < 0)
+            return err;
+    }
+
     return ret;
 }
 
@@ -656,20 +1247,8 @@ static av_cold int init(AVFilterContext *ctx)
             return ret;
 
         sc = &(sic->streamcontexts[i]);
-
-        sc->lastindex = 0;
-        sc->finesiglist = av_mallocz(sizeof(FineSignature));
-        if (!sc->finesiglist)
-            return AVERROR(ENOMEM);
-        sc->curfinesig = NULL;
-
-        sc->coarsesiglist = av_mallocz(sizeof(CoarseSignature));
-        if (!sc->coarsesiglist)
-            return AVERROR(ENOMEM);
-        sc->curcoarsesig1 = sc->coarsesiglist;
-        sc->coarseend = sc->coarsesiglist;
-        sc->coarsecount = 0;
-        sc->midcoarse = 0;
+        if ((ret = stream_init(sc)) < 0)
+            return ret;
     }
 
     /* check filename */
@@ -678,6 +1257,28 @@ static av_cold int init(AVFilterContext *ctx)
         return AVERROR(EINVAL);
     }
 
+    /* load the catalogue */
+    if (sic->index_mode != INDEX_OFF) {
+        if (!sic->index_filename) {
+            av_log(ctx, AV_LOG_ERROR, "An index file is needed for the index mode.\n");
+            return AVERROR(EINVAL);
+        }
+        if (sic->index_mode == INDEX_BUILD && sic->nb_inputs > 1 &&
+            av_get_frame_filename(tmp, sizeof(tmp), sic->clipname, 0) == -1) {
+            av_log(ctx, AV_LOG_ERROR, "The clipname must contain %%d or %%0nd, if you have more than one input.\n");
+            return AVERROR(EINVAL);
+        }
+
+        sic->index = av_mallocz(sizeof(*sic->index));
+        if (!sic->index)
+            return AVERROR(ENOMEM);
+
+        /* a new catalogue is created if there is none yet */
+        ret = index_load(ctx, sic->index, sic->index_filename, sic->index_mode == INDEX_BUILD);
+        if (ret < 0)
+            return ret;
+    }
+
     return 0;
 }
 
@@ -686,34 +1287,15 @@ static av_cold int init(AVFilterContext *ctx)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     SignatureContext *sic = ctx->priv;
-    StreamContext *sc;
-    void* tmp;
-    FineSignature* finsig;
-    CoarseSignature* cousig;
     int i;
 
+    index_free(&sic->index);
+    av_freep(&sic->intpic);
 
     /* free the lists */
     if (sic->streamcontexts != NULL) {
-        for (i = 0; i < sic->nb_inputs; i++) {
-            sc = &(sic->streamcontexts[i]);
-            finsig = sc->finesiglist;
-            cousig = sc->coarsesiglist;
-
-            while (finsig) {
-                tmp = finsig;
-                finsig = finsig->next;
-                av_freep(&tmp);
-            }
-            sc->finesiglist = NULL;
-
-            while (cousig) {
-                tmp = cousig;
-                cousig = cousig->next;
-                av_freep(&tmp);
-            }
-            sc->coarsesiglist = NULL;
-        }
+        for (i = 0; i < sic->nb_inputs; i++)
+            stream_free(&sic->streamcontexts[i]);
         av_freep(&sic->streamcontexts);
     }
 }
@@ -748,7 +1330,7 @@ const FFFilter ff_vf_signature = {
     .p.description = NULL_IF_CONFIG_SMALL("Calculate the MPEG-7 video signature"),
     .p.priv_class  = &signature_class,
     .p.inputs      = NULL,
-    .p.flags       = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .p.flags       = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(SignatureContext),
     .init          = init,
     .uninit        = uninit,
@@ -43,6 +43,8 @@
 
 #include <math.h>
 
+#include "config.h"
+
 #include "libavutil/avstring.h"
 #include "libavutil/file_open.h"
 #include "libavutil/mem.h"
@@ -53,6 +55,7 @@
 #include "drawutils.h"
 #include "filters.h"
 #include "framesync.h"
+#include "ssim360.h"
 
 #define RIGHT   0
 #define LEFT    1
@@ -162,7 +165,17 @@ typedef struct SSIM360Context {
     // Standard SSIM computation configuration & workspace
     uint64_t frame_skip_ratio;
 
-    int *temp;
+    SSIM360DSPContext dsp;
+    int nb_threads;
+    uint8_t *temp;
+    size_t temp_stride;
+    float *ssim_line;
+    int ssim_line_stride;
+    double *row_ssim360;
+    double *row_weight;
+    int nb_tape_rows;
+    double *tape_ssim360;
+    float *tape_weight;
     uint64_t nb_ssim_frames;
     uint64_t nb_net_frames;
     double ssim360[4], ssim360_total;
@@ -192,13 +205,19 @@ typedef struct SSIM360Context {
     BilinearMap *ref_tape_map[4][2];
     BilinearMap *main_tape_map[4][2];
     float angular_resolution[4][2];
-    double (*ssim360_plane)(
-        uint8_t *main, int main_stride,
-        uint8_t *ref, int ref_stride,
-        int width, int height, void *temp,
-        int max, Map2D density);
 } SSIM360Context;
 
+typedef struct ThreadData {
+    const uint8_t *main;
+    const uint8_t *ref;
+    int main_stride;
+    int ref_stride;
+    int width, height;
+    const BilinearMap *main_maps;
+    const BilinearMap *ref_maps;
+    float angular_resolution;
+} ThreadData;
+
 #define OFFSET(x) offsetof(SSIM360Context, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 
@@ -439,7 +458,7 @@ static float ssim360_end1(int s1, int s2, int ss, int s12)
 static double
 ssim360_endn_16bit(const int64_t (*sum0)[4], const int64_t (*sum1)[4],
                    int width, int max,
-                   double *density_map, int map_width, double *total_weight)
+                   const double *density_map, int map_width, double *total_weight)
 {
     double ssim360 = 0.0, weight;
 
@@ -456,88 +475,132 @@ ssim360_endn_16bit(const int64_t (*sum0)[4], const int64_t (*sum1)[4],
     return ssim360;
 }
 
-static double
-ssim360_endn_8bit(const int (*sum0)[4], const int (*sum1)[4], int width,
-                  double *density_map, int map_width, double *total_weight)
+static void
+ssim360_end_line_8bit(const int (*sum0)[4], const int (*sum1)[4],
+                      float *ssim, int width)
 {
-    double ssim360 = 0.0, weight;
-
     for (int i = 0; i < width; i++) {
-        weight = density_map ? density_map[(int) ((0.5 + i) / width * map_width)] : 1.0;
-        ssim360 += weight * ssim360_end1(
+        ssim[i] = ssim360_end1(
             sum0[i][0] + sum0[i + 1][0] + sum1[i][0] + sum1[i + 1][0],
             sum0[i][1] + sum0[i + 1][1] + sum1[i][1] + sum1[i + 1][1],
             sum0[i][2] + sum0[i + 1][2] + sum1[i][2] + sum1[i + 1][2],
             sum0[i][3] + sum0[i + 1][3] + sum1[i][3] + sum1[i + 1][3]);
-        *total_weight += weight;
     }
-    return ssim360;
 }
 
-static double
-ssim360_plane_16bit(uint8_t *main, int main_stride,
-                    uint8_t *ref, int ref_stride,
-                    int width, int height, void *temp,
-                    int max, Map2D density)
+static const double *density_row(const Map2D *density, int y, int height)
 {
-    int z = 0;
-    double ssim360 = 0.0;
-    int64_t (*sum0)[4] = temp;
-    int64_t (*sum1)[4] = sum0 + (width >> 2) + 3;
-    double total_weight = 0.0;
+    if (!density->value)
+        return NULL;
+    return density->value + density->w * ((int) ((double) y / height * density->h));
+}
 
-    width >>= 2;
-    height >>= 2;
+static int ssim360_plane_16bit(AVFilterContext *ctx, void *arg,
+                               int jobnr, int nb_jobs)
+{
+    SSIM360Context *s = ctx->priv;
+    ThreadData *td = arg;
+    const int width = td->width >> 2;
+    const int height = td->height >> 2;
+    const int slice_start = 1 + ((height - 1) *  jobnr     ) / nb_jobs;
+    const int slice_end   = 1 + ((height - 1) * (jobnr + 1)) / nb_jobs;
+    int64_t (*sum0)[4] = (void *)(s->temp + jobnr * s->temp_stride);
+    int64_t (*sum1)[4] = sum0 + width + 3;
+    int z = slice_start - 1;
+
+    for (int y = slice_start; y < slice_end; y++) {
+        const double *density_map = density_row(&s->density, y, height);
+        double total_weight = 0.0;
 
-    for (int y = 1; y < height; y++) {
         for (; z <= y; z++) {
             FFSWAP(void*, sum0, sum1);
-            ssim360_4x4xn_16bit(&main[4 * z * main_stride], main_stride,
-                                &ref[4 * z * ref_stride], ref_stride,
+            ssim360_4x4xn_16bit(&td->main[4 * z * td->main_stride], td->main_stride,
+                                &td->ref[4 * z * td->ref_stride], td->ref_stride,
                                 sum0, width);
         }
-        ssim360 += ssim360_endn_16bit(
+        s->row_ssim360[y] = ssim360_endn_16bit(
             (const int64_t (*)[4])sum0, (const int64_t (*)[4])sum1,
-            width - 1, max,
-            density.value ? density.value + density.w * ((int) ((z - 1.0) / height * density.h)) : NULL,
-            density.w, &total_weight);
+            width - 1, s->max, density_map,
+            s->density.w, &total_weight);
+        s->row_weight[y] = total_weight;
     }
 
-    return (double) (ssim360 / total_weight);
+    return 0;
 }
 
-static double
-ssim360_plane_8bit(uint8_t *main, int main_stride,
-                   uint8_t *ref, int ref_stride,
-                   int width, int height, void *temp,
-                   int max, Map2D density)
+static int ssim360_plane_8bit(AVFilterContext *ctx, void *arg,
+                              int jobnr, int nb_jobs)
 {
-    int z = 0;
-    double ssim360 = 0.0;
-    int (*sum0)[4] = temp;
-    int (*sum1)[4] = sum0 + (width >> 2) + 3;
-    double total_weight = 0.0;
-
-    width >>= 2;
-    height >>= 2;
+    SSIM360Context *s = ctx->priv;
+    ThreadData *td = arg;
+    const int width = td->width >> 2;
+    const int height = td->height >> 2;
+    const int slice_start = 1 + ((height - 1) *  jobnr     ) / nb_jobs;
+    const int slice_end   = 1 + ((height - 1) * (jobnr + 1)) / nb_jobs;
+    int (*sum0)[4] = (void *)(s->temp + jobnr * s->temp_stride);
+    int (*sum1)[4] = sum0 + width + 3;
+    float *ssim = s->ssim_line + jobnr * s->ssim_line_stride;
+    int z = slice_start - 1;
+
+    for (int y = slice_start; y < slice_end; y++) {
+        const double *density_map = density_row(&s->density, y, height);
+        double ssim360 = 0.0, total_weight = 0.0;
 
-    for (int y = 1; y < height; y++) {
         for (; z <= y; z++) {
             FFSWAP(void*, sum0, sum1);
-            ssim360_4x4xn_8bit(
-                &main[4 * z * main_stride], main_stride,
-                &ref[4 * z * ref_stride], ref_stride,
-                sum0, width);
+            s->dsp.ssim_4x4_line(&td->main[4 * z * td->main_stride], td->main_stride,
+                                 &td->ref[4 * z * td->ref_stride], td->ref_stride,
+                                 sum0, width);
         }
-        ssim360 += ssim360_endn_8bit(
-            (const int (*)[4])sum0, (const int (*)[4])sum1, width - 1,
-            density.value ? density.value + density.w * ((int) ((z - 1.0) / height * density.h)) : NULL,
-            density.w, &total_weight);
+        s->dsp.ssim_end_line((const int (*)[4])sum0, (const int (*)[4])sum1,
+                             ssim, width - 1);
+        for (int i = 0; i < width - 1; i++) {
+            double weight = density_map ? density_map[(int) ((0.5 + i) / (width - 1) * s->density.w)] : 1.0;
+
+            ssim360 += weight * ssim[i];
+            total_weight += weight;
+        }
+        s->row_ssim360[y] = ssim360;
+        s->row_weight[y] = total_weight;
+    }
+
+    return 0;
+}
+
+static double ssim360_plane(AVFilterContext *ctx,
+                            uint8_t *main, int main_stride,
+                            uint8_t *ref, int ref_stride,
+                            int width, int height)
+{
+    SSIM360Context *s = ctx->priv;
+    ThreadData td = {
+        .main = main, .main_stride = main_stride,
+        .ref  = ref,  .ref_stride  = ref_stride,
+        .width = width, .height = height,
+    };
+    const int nb_rows = (height >> 2) - 1;
+    double ssim360 = 0.0, total_weight = 0.0;
+
+    ff_filter_execute(ctx, s->max > 255 ? ssim360_plane_16bit : ssim360_plane_8bit,
+                      &td, NULL, av_clip(nb_rows, 1, s->nb_threads));
+
+    for (int y = 1; y <= nb_rows; y++) {
+        ssim360 += s->row_ssim360[y];
+        total_weight += s->row_weight[y];
     }
 
     return (double) (ssim360 / total_weight);
 }
 
+av_cold void ff_ssim360_init(SSIM360DSPContext *dsp)
+{
+    dsp->ssim_4x4_line = ssim360_4x4xn_8bit;
+    dsp->ssim_end_line = ssim360_end_line_8bit;
+#if ARCH_X86
+    ff_ssim360_init_x86(dsp);
+#endif
+}
+
 static double ssim360_db(double ssim360, double weight)
 {
     return 10 * log10(weight / (weight - ssim360));
@@ -644,32 +707,30 @@ static float get_heat(HeatmapList *heatmaps, float angular_resoluation, float no
     return heatmaps->map.value[h * heatmaps->map.w + w];
 }
 
-static double
-ssim360_tape(uint8_t *main, BilinearMap *main_maps,
-             uint8_t *ref, BilinearMap *ref_maps,
-             int tape_length, int max_value, void *temp,
-             double *ssim360_hist, double *ssim360_hist_net,
-             float angular_resolution, HeatmapList *heatmaps)
+static int ssim360_tape_slice(AVFilterContext *ctx, void *arg,
+                              int jobnr, int nb_jobs)
 {
+    SSIM360Context *s = ctx->priv;
+    ThreadData *td = arg;
+    const int max_value = s->max;
+    const int vertical_block_count = td->height >> 2;
+    const int slice_start = 1 + ((vertical_block_count - 1) *  jobnr     ) / nb_jobs;
+    const int slice_end   = 1 + ((vertical_block_count - 1) * (jobnr + 1)) / nb_jobs;
     int horizontal_block_count = 2;
-    int vertical_block_count = tape_length >> 2;
-
-    int z = 0, y;
-    // Since the tape will be very long and we need to average over all 8x8 blocks, use double
-    double ssim360 = 0.0;
-    double sum_weight = 0.0;
-
-    int (*sum0)[4] = temp;
+    int (*sum0)[4] = (void *)(s->temp + jobnr * s->temp_stride);
     int (*sum1)[4] = sum0 + horizontal_block_count + 3;
+    int z = slice_start - 1;
 
-    for (y = 1; y < vertical_block_count; y++) {
-        int fs1, fs2, fss, fs12, hist_index;
-        float norm_tape_pos, weight;
+    for (int y = slice_start; y < slice_end; y++) {
+        int fs1, fs2, fss, fs12;
+        float norm_tape_pos;
         double sample_ssim360;
 
         for (; z <= y; z++) {
             FFSWAP(void*, sum0, sum1);
-            ssim360_4x4x2_tape(main, main_maps, ref, ref_maps, z*4, max_value, sum0);
+            ssim360_4x4x2_tape(td->main, (BilinearMap *)td->main_maps,
+                               td->ref, (BilinearMap *)td->ref_maps,
+                               z*4, max_value, sum0);
         }
 
         // Given we have only one 8x8 block, following sums fit within 26 bits even for 10bit videos
@@ -697,12 +758,47 @@ ssim360_tape(uint8_t *main, BilinearMap *main_maps,
                         / ((double)(fs1 * fs1 + fs2 * fs2 + ssim_c1) * (double)(vars + ssim_c2));
         }
 
+        norm_tape_pos = (y - 0.5f) / (vertical_block_count - 1.0f) - 0.5f;
+        // weight from an input heatmap if available, otherwise weight = 1.0
+        s->tape_ssim360[y] = sample_ssim360;
+        s->tape_weight[y] = get_heat(s->heatmaps, td->angular_resolution, norm_tape_pos);
+    }
+
+    return 0;
+}
+
+static double
+ssim360_tape(AVFilterContext *ctx,
+             uint8_t *main, BilinearMap *main_maps,
+             uint8_t *ref, BilinearMap *ref_maps,
+             int tape_length, double *ssim360_hist, double *ssim360_hist_net,
+             float angular_resolution)
+{
+    SSIM360Context *s = ctx->priv;
+    ThreadData td = {
+        .main = main, .main_maps = main_maps,
+        .ref  = ref,  .ref_maps  = ref_maps,
+        .height = tape_length,
+        .angular_resolution = angular_resolution,
+    };
+    int vertical_block_count = tape_length >> 2;
+
+    // Since the tape will be very long and we need to average over all 8x8 blocks, use double
+    double ssim360 = 0.0;
+    double sum_weight = 0.0;
+
+    ff_filter_execute(ctx, ssim360_tape_slice, &td, NULL,
+                      av_clip(vertical_block_count - 1, 1, s->nb_threads));
+
+    // Merge in tape order so the histogram does not depend on the thread count
+    for (int y = 1; y < vertical_block_count; y++) {
+        double sample_ssim360 = s->tape_ssim360[y];
+        float weight = s->tape_weight[y];
+        int hist_index;
+
         hist_index = (int)(sample_ssim360 * ((double)SSIM360_HIST_SIZE - .5));
         hist_index = av_clip(hist_index, 0, SSIM360_HIST_SIZE - 1);
 
-        norm_tape_pos = (y - 0.5f) / (vertical_block_count - 1.0f) - 0.5f;
-        // weight from an input heatmap if available, otherwise weight = 1.0
-        weight = get_heat(heatmaps, angular_resolution, norm_tape_pos);
         ssim360_hist[hist_index] += weight;
         *ssim360_hist_net += weight;
 
@@ -1151,29 +1247,35 @@ static int do_ssim360(FFFrameSync *fs)
         ret = generate_tape_maps(s, master, ref);
         if (ret < 0)
             return ret;
+
+        for (int i = 0; i < s->nb_components; i++)
+            s->nb_tape_rows = FFMAX(s->nb_tape_rows, s->tape_length[i] >> 2);
+        s->tape_ssim360 = av_calloc(s->nb_tape_rows, sizeof(*s->tape_ssim360));
+        s->tape_weight  = av_calloc(s->nb_tape_rows, sizeof(*s->tape_weight));
+        if (!s->tape_ssim360 || !s->tape_weight)
+            return AVERROR(ENOMEM);
     }
 
     for (int i = 0; i < s->nb_components; i++) {
         if (s->use_tape) {
-            c[i] = ssim360_tape(master->data[i], s->main_tape_map[i][0],
+            c[i] = ssim360_tape(ctx, master->data[i], s->main_tape_map[i][0],
                                 ref->data[i],    s->ref_tape_map [i][0],
-                                s->tape_length[i], s->max, s->temp,
+                                s->tape_length[i],
                                 s->ssim360_hist[i], &s->ssim360_hist_net[i],
-                                s->angular_resolution[i][0], s->heatmaps);
+                                s->angular_resolution[i][0]);
 
             if (s->ref_tape_map[i][1]) {
-                c[i] += ssim360_tape(master->data[i], s->main_tape_map[i][1],
+                c[i] += ssim360_tape(ctx, master->data[i], s->main_tape_map[i][1],
                                      ref->data[i],    s->ref_tape_map[i][1],
-                                     s->tape_length[i], s->max, s->temp,
+                                     s->tape_length[i],
                                      s->ssim360_hist[i], &s->ssim360_hist_net[i],
-                                     s->angular_resolution[i][1], s->heatmaps);
+                                     s->angular_resolution[i][1]);
                 c[i] /= 2.f;
             }
         } else {
-            c[i] = s->ssim360_plane(master->data[i], master->linesize[i],
-                                    ref->data[i],    ref->linesize[i],
-                                    s->ref_planewidth[i], s->ref_planeheight[i],
-                                    s->temp, s->max, s->density);
+            c[i] = ssim360_plane(ctx, master->data[i], master->linesize[i],
+                                 ref->data[i],    ref->linesize[i],
+                                 s->ref_planewidth[i], s->ref_planeheight[i]);
         }
 
         s->ssim360[i] += c[i];
@@ -1575,7 +1677,7 @@ static int config_input_ref(AVFilterLink *inlink)
 
     s->max = (1 << desc->comp[0].depth) - 1;
 
-    s->ssim360_plane = desc->comp[0].depth > 8 ? ssim360_plane_16bit : ssim360_plane_8bit;
+    ff_ssim360_init(&s->dsp);
 
     for (int i = 0; i < s->nb_components; i++)
         sum += s->ref_planeheight[i] * s->ref_planewidth[i];
@@ -1609,9 +1711,12 @@ static int config_output(AVFilterLink *outlink)
         return AVERROR(EINVAL);
     }
 
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+
     if (s->use_tape) {
         // s->temp will be allocated for the tape width = 8. The tape is long downwards
-        s->temp = av_malloc_array((2 * 8 + 12), sizeof(*s->temp));
+        s->temp_stride = FFALIGN((2 * 2 + 6) * sizeof(int[4]), 64);
+        s->temp = av_malloc_array(s->nb_threads, s->temp_stride);
         if (!s->temp)
             return AVERROR(ENOMEM);
 
@@ -1623,8 +1728,15 @@ static int config_output(AVFilterLink *outlink)
                 return AVERROR(ENOMEM);
         }
     } else {
-        s->temp = av_malloc_array((2 * reflink->w + 12), sizeof(*s->temp) * (1 + (desc->comp[0].depth > 8)));
-        if (!s->temp)
+        const int blocks = reflink->w >> 2;
+
+        s->temp_stride = FFALIGN((2 * blocks + 6) * sizeof(int[4]) * (1 + (desc->comp[0].depth > 8)), 64);
+        s->temp = av_malloc_array(s->nb_threads, s->temp_stride);
+        s->ssim_line_stride = FFALIGN(blocks + 3, 16);
+        s->ssim_line = av_malloc_array(s->nb_threads, s->ssim_line_stride * sizeof(*s->ssim_line));
+        s->row_ssim360 = av_calloc((reflink->h >> 2) + 1, sizeof(*s->row_ssim360));
+        s->row_weight  = av_calloc((reflink->h >> 2) + 1, sizeof(*s->row_weight));
+        if (!s->temp || !s->ssim_line || !s->row_ssim360 || !s->row_weight)
             return AVERROR(ENOMEM);
 
         if (!s->density.value) {
@@ -1709,6 +1821,11 @@ static av_cold void uninit(AVFilterContext *ctx)
         fclose(s->stats_file);
 
     av_freep(&s->temp);
+    av_freep(&s->ssim_line);
+    av_freep(&s->row_ssim360);
+    av_freep(&s->row_weight);
+    av_freep(&s->tape_ssim360);
+    av_freep(&s->tape_weight);
 }
 
 #define PF(suf) AV_PIX_FMT_YUV420##suf,  AV_PIX_FMT_YUV422##suf,  AV_PIX_FMT_YUV444##suf, AV_PIX_FMT_GBR##suf
@@ -1749,6 +1866,7 @@ const FFFilter ff_vf_ssim360 = {
     .p.name        = "ssim360",
     .p.description = NULL_IF_CONFIG_SMALL("Calculate the SSIM between two 360 video streams."),
     .p.priv_class  = &ssim360_class,
+    .p.flags       = AVFILTER_FLAG_SLICE_THREADS,
     .preinit       = ssim360_framesync_preinit,
     .init          = init,
     .uninit        = uninit,
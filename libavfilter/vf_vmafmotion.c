@@ -24,6 +24,8 @@
  * Calculate VMAF Motion score.
  */
 
+#include "config.h"
+
 #include "libavutil/file_open.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
@@ -61,146 +63,133 @@ static const AVOption vmafmotion_options[] = {
 
 AVFILTER_DEFINE_CLASS(vmafmotion);
 
-static uint64_t image_sad(const uint16_t *img1, const uint16_t *img2, int w,
-                          int h, ptrdiff_t _img1_stride, ptrdiff_t _img2_stride)
+static uint16_t convolution_x_edge(const uint16_t *filter, const uint16_t *src,
+                                   int w, int j)
 {
-    ptrdiff_t img1_stride = _img1_stride / sizeof(*img1);
-    ptrdiff_t img2_stride = _img2_stride / sizeof(*img2);
-    uint64_t sum = 0;
-    int i, j;
-
-    for (i = 0; i < h; i++) {
-        for (j = 0; j < w; j++) {
-            sum += abs(img1[j] - img2[j]);
+    int sum = 0;
+
+    for (int k = 0; k < 5; k++) {
+        int j_tap = FFABS(j - 2 + k);
+        if (j_tap >= w) {
+            j_tap = w - (j_tap - w + 1);
         }
-        img1 += img1_stride;
-        img2 += img2_stride;
+        sum += filter[k] * src[j_tap];
     }
 
-    return sum;
+    return sum >> BIT_SHIFT;
 }
 
-static void convolution_x(const uint16_t *filter, int filt_w, const uint16_t *src,
-                          uint16_t *dst, int w, int h, ptrdiff_t _src_stride,
-                          ptrdiff_t _dst_stride)
+void ff_vmafmotion_convolution_x_c(const uint16_t *filter, const uint16_t *src,
+                                   uint16_t *dst, int w)
 {
-    ptrdiff_t src_stride = _src_stride / sizeof(*src);
-    ptrdiff_t dst_stride = _dst_stride / sizeof(*dst);
-    int radius = filt_w / 2;
-    int borders_left = radius;
-    int borders_right = w - (filt_w - radius);
-    int i, j, k;
-
-    for (i = 0; i < h; i++) {
-        for (j = 0; j < borders_left; j++) {
-            int sum = 0;
-            for (k = 0; k < filt_w; k++) {
-                int j_tap = FFABS(j - radius + k);
-                if (j_tap >= w) {
-                    j_tap = w - (j_tap - w + 1);
-                }
-                sum += filter[k] * src[i * src_stride + j_tap];
-            }
-            dst[i * dst_stride + j] = sum >> BIT_SHIFT;
-        }
-
-        for (j = borders_left; j < borders_right; j++) {
-            int sum = 0;
-            for (k = 0; k < filt_w; k++) {
-                sum += filter[k] * src[i * src_stride + j - radius + k];
-            }
-            dst[i * dst_stride + j] = sum >> BIT_SHIFT;
-        }
-
-        for (j = borders_right; j < w; j++) {
-            int sum = 0;
-            for (k = 0; k < filt_w; k++) {
-                int j_tap = FFABS(j - radius + k);
-                if (j_tap >= w) {
-                    j_tap = w - (j_tap - w + 1);
-                }
-                sum += filter[k] * src[i * src_stride + j_tap];
-            }
-            dst[i * dst_stride + j] = sum >> BIT_SHIFT;
+    for (int j = 0; j < w; j++) {
+        int sum = 0;
+        for (int k = 0; k < 5; k++) {
+            sum += filter[k] * src[j - 2 + k];
         }
+        dst[j] = sum >> BIT_SHIFT;
     }
 }
 
 #define conv_y_fn(type, bits) \
-static void convolution_y_##bits##bit(const uint16_t *filter, int filt_w, \
-                                      const uint8_t *_src, uint16_t *dst, \
-                                      int w, int h, ptrdiff_t _src_stride, \
-                                      ptrdiff_t _dst_stride) \
+void ff_vmafmotion_convolution_y_##bits##bit_c(const uint16_t *filter, \
+                                               const uint8_t *const _src[5], \
+                                               uint16_t *dst, int w) \
 { \
-    const type *src = (const type *) _src; \
-    ptrdiff_t src_stride = _src_stride / sizeof(*src); \
-    ptrdiff_t dst_stride = _dst_stride / sizeof(*dst); \
-    int radius = filt_w / 2; \
-    int borders_top = radius; \
-    int borders_bottom = h - (filt_w - radius); \
-    int i, j, k; \
-    int sum = 0; \
+    const type *src[5]; \
     \
-    for (i = 0; i < borders_top; i++) { \
-        for (j = 0; j < w; j++) { \
-            sum = 0; \
-            for (k = 0; k < filt_w; k++) { \
-                int i_tap = FFABS(i - radius + k); \
-                if (i_tap >= h) { \
-                    i_tap = h - (i_tap - h + 1); \
-                } \
-                sum += filter[k] * src[i_tap * src_stride + j]; \
-            } \
-            dst[i * dst_stride + j] = sum >> bits; \
-        } \
-    } \
-    for (i = borders_top; i < borders_bottom; i++) { \
-        for (j = 0; j < w; j++) { \
-            sum = 0; \
-            for (k = 0; k < filt_w; k++) { \
-                sum += filter[k] * src[(i - radius + k) * src_stride + j]; \
-            } \
-            dst[i * dst_stride + j] = sum >> bits; \
-        } \
-    } \
-    for (i = borders_bottom; i < h; i++) { \
-        for (j = 0; j < w; j++) { \
-            sum = 0; \
-            for (k = 0; k < filt_w; k++) { \
-                int i_tap = FFABS(i - radius + k); \
-                if (i_tap >= h) { \
-                    i_tap = h - (i_tap - h + 1); \
-                } \
-                sum += filter[k] * src[i_tap * src_stride + j]; \
-            } \
-            dst[i * dst_stride + j] = sum >> bits; \
+    for (int k = 0; k < 5; k++) \
+        src[k] = (const type *)_src[k]; \
+    \
+    for (int j = 0; j < w; j++) { \
+        int sum = 0; \
+        for (int k = 0; k < 5; k++) { \
+            sum += filter[k] * src[k][j]; \
         } \
+        dst[j] = sum >> bits; \
     } \
 }
 
 conv_y_fn(uint8_t, 8)
 conv_y_fn(uint16_t, 10)
 
-static void vmafmotiondsp_init(VMAFMotionDSPContext *dsp, int bpp) {
-    dsp->convolution_x = convolution_x;
-    dsp->convolution_y = bpp == 10 ? convolution_y_10bit : convolution_y_8bit;
-    dsp->sad = image_sad;
+void ff_vmafmotion_init_dsp(VMAFMotionDSPContext *dsp, int bpp)
+{
+    dsp->convolution_x = ff_vmafmotion_convolution_x_c;
+    dsp->convolution_y = bpp == 10 ? ff_vmafmotion_convolution_y_10bit_c :
+                                     ff_vmafmotion_convolution_y_8bit_c;
+    /* the blurred planes always fit in 15 bits */
+    dsp->sad = ff_scene_sad_get_fn(15);
+#if ARCH_X86
+    ff_vmafmotion_init_x86(dsp, bpp);
+#endif
+}
+
+typedef struct ThreadData {
+    VMAFMotionData *s;
+    const AVFrame *ref;
+} ThreadData;
+
+static int blur_sad_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+    VMAFMotionData *s = td->s;
+    const VMAFMotionDSPContext *dsp = &s->vmafdsp;
+    const uint8_t *src = td->ref->data[0];
+    const ptrdiff_t src_stride = td->ref->linesize[0];
+    const ptrdiff_t stride = s->stride / sizeof(uint16_t);
+    const int w = s->width;
+    const int h = s->height;
+    const int slice_start = (h * jobnr) / nb_jobs;
+    const int slice_end = (h * (jobnr+1)) / nb_jobs;
+    uint16_t *temp = s->temp_data + jobnr * stride;
+
+    for (int i = slice_start; i < slice_end; i++) {
+        uint16_t *dst = s->blur_data[0] + i * stride;
+        const uint8_t *rows[5];
+
+        for (int k = 0; k < 5; k++) {
+            int i_tap = FFABS(i - 2 + k);
+            if (i_tap >= h) {
+                i_tap = h - (i_tap - h + 1);
+            }
+            rows[k] = src + i_tap * src_stride;
+        }
+
+        dsp->convolution_y(s->filter, rows, temp, w);
+
+        dst[0] = convolution_x_edge(s->filter, temp, w, 0);
+        dst[1] = convolution_x_edge(s->filter, temp, w, 1);
+        if (w > 4)
+            dsp->convolution_x(s->filter, temp + 2, dst + 2, w - 4);
+        dst[w - 2] = convolution_x_edge(s->filter, temp, w, w - 2);
+        dst[w - 1] = convolution_x_edge(s->filter, temp, w, w - 1);
+    }
+
+    s->sad[jobnr] = 0;
+    if (s->nb_frames && slice_end > slice_start)
+        dsp->sad((const uint8_t *)(s->blur_data[1] + slice_start * stride), s->stride,
+                 (const uint8_t *)(s->blur_data[0] + slice_start * stride), s->stride,
+                 w, slice_end - slice_start, &s->sad[jobnr]);
+
+    return 0;
 }
 
-double ff_vmafmotion_process(VMAFMotionData *s, AVFrame *ref)
+double ff_vmafmotion_process(AVFilterContext *ctx, VMAFMotionData *s, AVFrame *ref)
 {
+    ThreadData td = { .s = s, .ref = ref };
+    const int nb_jobs = FFMIN(s->height, s->nb_threads);
     double score;
 
-    s->vmafdsp.convolution_y(s->filter, 5, ref->data[0], s->temp_data,
-                             s->width, s->height, ref->linesize[0], s->stride);
-    s->vmafdsp.convolution_x(s->filter, 5, s->temp_data, s->blur_data[0],
-                             s->width, s->height, s->stride, s->stride);
+    ff_filter_execute(ctx, blur_sad_slice, &td, NULL, nb_jobs);
 
     if (!s->nb_frames) {
         score = 0.0;
     } else {
-        uint64_t sad = s->vmafdsp.sad(s->blur_data[1], s->blur_data[0],
-                                      s->width, s->height, s->stride, s->stride);
+        uint64_t sad = 0;
+
+        for (int j = 0; j < nb_jobs; j++)
+            sad += s->sad[j];
         // the output score is always normalized to 8 bits
         score = (double) (sad * 1.0 / (s->width * s->height << (BIT_SHIFT - 8)));
     }
@@ -224,7 +213,7 @@ static void do_vmafmotion(AVFilterContext *ctx, AVFrame *ref)
     VMAFMotionContext *s = ctx->priv;
     double score;
 
-    score = ff_vmafmotion_process(&s->data, ref);
+    score = ff_vmafmotion_process(ctx, &s->data, ref);
     set_meta(&ref->metadata, "lavfi.vmafmotion.score", score);
     if (s->stats_file) {
         fprintf(s->stats_file,
@@ -234,7 +223,8 @@ static void do_vmafmotion(AVFilterContext *ctx, AVFrame *ref)
 
 
 int ff_vmafmotion_init(VMAFMotionData *s,
-                       int w, int h, enum AVPixelFormat fmt)
+                       int w, int h, enum AVPixelFormat fmt,
+                       int nb_threads)
 {
     size_t data_sz;
     int i;
@@ -245,12 +235,15 @@ int ff_vmafmotion_init(VMAFMotionData *s,
 
     s->width = w;
     s->height = h;
+    s->depth = desc->comp[0].depth;
     s->stride = FFALIGN(w * sizeof(uint16_t), 32);
+    s->nb_threads = nb_threads;
 
     data_sz = (size_t) s->stride * h;
     if (!(s->blur_data[0] = av_malloc(data_sz)) ||
         !(s->blur_data[1] = av_malloc(data_sz)) ||
-        !(s->temp_data    = av_malloc(data_sz))) {
+        !(s->temp_data    = av_malloc_array(nb_threads, s->stride)) ||
+        !(s->sad          = av_calloc(nb_threads, sizeof(*s->sad)))) {
         return AVERROR(ENOMEM);
     }
 
@@ -258,7 +251,7 @@ int ff_vmafmotion_init(VMAFMotionData *s,
         s->filter[i] = lrint(FILTER_5[i] * (1 << BIT_SHIFT));
     }
 
-    vmafmotiondsp_init(&s->vmafdsp, desc->comp[0].depth);
+    ff_vmafmotion_init_dsp(&s->vmafdsp, s->depth);
 
     return 0;
 }
@@ -289,14 +282,16 @@ static int config_input_ref(AVFilterLink *inlink)
     VMAFMotionContext *s = ctx->priv;
 
     return ff_vmafmotion_init(&s->data, ctx->inputs[0]->w,
-                              ctx->inputs[0]->h, ctx->inputs[0]->format);
+                              ctx->inputs[0]->h, ctx->inputs[0]->format,
+                              ff_filter_get_nb_threads(ctx));
 }
 
 double ff_vmafmotion_uninit(VMAFMotionData *s)
 {
-    av_free(s->blur_data[0]);
-    av_free(s->blur_data[1]);
-    av_free(s->temp_data);
+    av_freep(&s->blur_data[0]);
+    av_freep(&s->blur_data[1]);
+    av_freep(&s->temp_data);
+    av_freep(&s->sad);
 
     return s->nb_frames > 0 ? s->motion_sum / s->nb_frames : 0.0;
 }
@@ -355,7 +350,7 @@ const FFFilter ff_vf_vmafmotion = {
     .p.name        = "vmafmotion",
     .p.description = NULL_IF_CONFIG_SMALL("Calculate the VMAF Motion score."),
     .p.priv_class  = &vmafmotion_class,
-    .p.flags       = AVFILTER_FLAG_METADATA_ONLY,
+    .p.flags       = AVFILTER_FLAG_METADATA_ONLY | AVFILTER_FLAG_SLICE_THREADS,
     .init          = init,
     .uninit        = uninit,
     .priv_size     = sizeof(VMAFMotionContext),
@@ -57,8 +57,10 @@ typedef struct XPSNRContext {
     uint8_t         rgba_map[4];
     FILE            *stats_file;
     char            *stats_file_str;
+    int             nb_threads;
     /* XPSNR specific variables */
     double          *sse_luma;
+    double          *sse_chroma[2];
     double          *weights;
     int16_t         *buf_org_m1;
     int16_t         *buf_org_m2;
@@ -77,7 +79,6 @@ typedef struct XPSNRContext {
 
 #define FLAGS     AV_OPT_FLAG_FILTERING_PARAM | AV_OPT_FLAG_VIDEO_PARAM
 #define OFFSET(x) offsetof(XPSNRContext, x)
-#define XPSNR_GAMMA 2
 
 static const AVOption xpsnr_options[] = {
     {"stats_file", "Set file where to store per-frame XPSNR information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, FLAGS},
@@ -89,61 +90,6 @@ FRAMESYNC_DEFINE_CLASS(xpsnr, XPSNRContext, fs);
 
 /* XPSNR function definitions */
 
-static uint64_t highds(const int x_act, const int y_act, const int w_act, const int h_act, const int16_t *o_m0, const int o)
-{
-    uint64_t sa_act = 0;
-
-    for (int y = y_act; y < h_act; y += 2) {
-        for (int x = x_act; x < w_act; x += 2) {
-            const int f = 12 * ((int)o_m0[ y   *o + x  ] + (int)o_m0[ y   *o + x+1] + (int)o_m0[(y+1)*o + x  ] + (int)o_m0[(y+1)*o + x+1])
-                         - 3 * ((int)o_m0[(y-1)*o + x  ] + (int)o_m0[(y-1)*o + x+1] + (int)o_m0[(y+2)*o + x  ] + (int)o_m0[(y+2)*o + x+1])
-                         - 3 * ((int)o_m0[ y   *o + x-1] + (int)o_m0[ y   *o + x+2] + (int)o_m0[(y+1)*o + x-1] + (int)o_m0[(y+1)*o + x+2])
-                         - 2 * ((int)o_m0[(y-1)*o + x-1] + (int)o_m0[(y-1)*o + x+2] + (int)o_m0[(y+2)*o + x-1] + (int)o_m0[(y+2)*o + x+2])
-                             - ((int)o_m0[(y-2)*o + x-1] + (int)o_m0[(y-2)*o + x  ] + (int)o_m0[(y-2)*o + x+1] + (int)o_m0[(y-2)*o + x+2]
-                              + (int)o_m0[(y+3)*o + x-1] + (int)o_m0[(y+3)*o + x  ] + (int)o_m0[(y+3)*o + x+1] + (int)o_m0[(y+3)*o + x+2]
-                              + (int)o_m0[(y-1)*o + x-2] + (int)o_m0[ y   *o + x-2] + (int)o_m0[(y+1)*o + x-2] + (int)o_m0[(y+2)*o + x-2]
-                              + (int)o_m0[(y-1)*o + x+3] + (int)o_m0[ y   *o + x+3] + (int)o_m0[(y+1)*o + x+3] + (int)o_m0[(y+2)*o + x+3]);
-            sa_act += (uint64_t) abs(f);
-        }
-    }
-    return sa_act;
-}
-
-static uint64_t diff1st(const uint32_t w_act, const uint32_t h_act, const int16_t *o_m0, int16_t *o_m1, const int o)
-{
-    uint64_t ta_act = 0;
-
-    for (uint32_t y = 0; y < h_act; y += 2) {
-        for (uint32_t x = 0; x < w_act; x += 2) {
-            const int t = (int)o_m0[y*o + x] + (int)o_m0[y*o + x+1] + (int)o_m0[(y+1)*o + x] + (int)o_m0[(y+1)*o + x+1]
-                       - ((int)o_m1[y*o + x] + (int)o_m1[y*o + x+1] + (int)o_m1[(y+1)*o + x] + (int)o_m1[(y+1)*o + x+1]);
-            ta_act += (uint64_t) abs(t);
-            o_m1[y*o + x  ] = o_m0[y*o + x  ];  o_m1[(y+1)*o + x  ] = o_m0[(y+1)*o + x  ];
-            o_m1[y*o + x+1] = o_m0[y*o + x+1];  o_m1[(y+1)*o + x+1] = o_m0[(y+1)*o + x+1];
-        }
-    }
-    return (ta_act * XPSNR_GAMMA);
-}
-
-static uint64_t diff2nd(const uint32_t w_act, const uint32_t h_act, const int16_t *o_m0, int16_t *o_m1, int16_t *o_m2, const int o)
-{
-    uint64_t ta_act = 0;
-
-    for (uint32_t y = 0; y < h_act; y += 2) {
-        for (uint32_t x = 0; x < w_act; x += 2) {
-            const int t = (int)o_m0[y*o + x] + (int)o_m0[y*o + x+1] + (int)o_m0[(y+1)*o + x] + (int)o_m0[(y+1)*o + x+1]
-                   - 2 * ((int)o_m1[y*o + x] + (int)o_m1[y*o + x+1] + (int)o_m1[(y+1)*o + x] + (int)o_m1[(y+1)*o + x+1])
-                        + (int)o_m2[y*o + x] + (int)o_m2[y*o + x+1] + (int)o_m2[(y+1)*o + x] + (int)o_m2[(y+1)*o + x+1];
-            ta_act += (uint64_t) abs(t);
-            o_m2[y*o + x  ] = o_m1[y*o + x  ];  o_m2[(y+1)*o + x  ] = o_m1[(y+1)*o + x  ];
-            o_m2[y*o + x+1] = o_m1[y*o + x+1];  o_m2[(y+1)*o + x+1] = o_m1[(y+1)*o + x+1];
-            o_m1[y*o + x  ] = o_m0[y*o + x  ];  o_m1[(y+1)*o + x  ] = o_m0[(y+1)*o + x  ];
-            o_m1[y*o + x+1] = o_m0[y*o + x+1];  o_m1[(y+1)*o + x+1] = o_m0[(y+1)*o + x+1];
-        }
-    }
-    return (ta_act * XPSNR_GAMMA);
-}
-
 static inline uint64_t calc_squared_error(XPSNRContext const *s,
                                           const int16_t *blk_org,     const uint32_t stride_org,
                                           const int16_t *blk_rec,     const uint32_t stride_rec,
@@ -191,10 +137,7 @@ static inline double calc_squared_error_and_weight (XPSNRContext const *s,
         return sse;
 
     if (b_val > 1) { /* highpass with downsampling */
-        if (w_act > 12)
-            sa_act = s->dsp.highds_func(x_act, y_act, w_act, h_act, o_m0, o);
-        else
-            highds(x_act, y_act, w_act, h_act, o_m0, o);
+        sa_act = s->dsp.highds_func(x_act, y_act, w_act, h_act, o_m0, o);
     } else { /* <=HD highpass without downsampling */
         for (int y = y_act; y < h_act; y++) {
             for (int x = x_act; x < w_act; x++) {
@@ -266,6 +209,114 @@ static inline double get_avg_xpsnr (const double sqrt_wsse_val,  const double su
     return sum_xpsnr_val / (double) num_frames_64; /* older log-domain average */
 }
 
+typedef struct ThreadData {
+    const AVFrame *master;
+    const AVFrame *ref;
+    int16_t      **org;
+    int16_t       *org_m1;
+    int16_t       *org_m2;
+    int16_t      **rec;
+    uint32_t       b;
+} ThreadData;
+
+static int convert_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    XPSNRContext *const s = ctx->priv;
+    ThreadData *const td = arg;
+
+    for (int c = 0; c < s->num_comps; c++) {
+        const int m = td->master->linesize[c]; /* master stride */
+        const int r = td->ref->linesize[c];    /* ref/c stride */
+        const int o = s->plane_width[c];       /* XPSNR stride */
+        const int slice_start = (s->plane_height[c] * jobnr) / nb_jobs;
+        const int slice_end = (s->plane_height[c] * (jobnr+1)) / nb_jobs;
+        const uint8_t *src_org = td->master->data[c];
+        const uint8_t *src_rec = td->ref->data[c];
+        int16_t *porg = td->org[c];
+        int16_t *prec = td->rec[c];
+
+        for (int y = slice_start; y < slice_end; y++) {
+            for (int x = 0; x < s->plane_width[c]; x++) {
+                porg[y * o + x] = (int16_t) src_org[y * m + x];
+                prec[y * o + x] = (int16_t) src_rec[y * r + x];
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int blocks_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    XPSNRContext *const  s = ctx->priv;
+    ThreadData *const   td = arg;
+    const uint32_t       w = s->plane_width [0];
+    const uint32_t       h = s->plane_height[0];
+    const uint32_t       b = td->b;
+    const uint32_t   w_blk = (w + b - 1) / b;
+    const uint32_t   h_blk = (h + b - 1) / b;
+    const int  *stride_org = (s->bpp == 1 ? s->plane_width : s->line_sizes);
+    const int16_t   *p_org = td->org[0];
+    const uint32_t   s_org = stride_org[0] / s->bpp;
+    const int16_t   *p_rec = td->rec[0];
+    const uint32_t   s_rec = s->plane_width[0];
+    const uint32_t blk_start = (h_blk * jobnr) / nb_jobs;
+    const uint32_t blk_end = (h_blk * (jobnr+1)) / nb_jobs;
+
+    /* block SSE and perceptual weights of luma, the blocks are independent */
+    for (uint32_t y_blk = blk_start; y_blk < blk_end; y_blk++) {
+        const uint32_t y = y_blk * b;
+        const uint32_t block_height = (y + b > h ? h - y : b);
+        uint32_t idx_blk = y_blk * w_blk;
+
+        for (uint32_t x = 0; x < w; x += b, idx_blk++) {
+            const uint32_t block_width = (x + b > w ? w - x : b);
+            double ms_act = 1.0;
+
+            s->sse_luma[idx_blk] = calc_squared_error_and_weight(s, p_org, s_org,
+                                                                 td->org_m1 /* pixel  */,
+                                                                 td->org_m2 /* memory */,
+                                                                 p_rec, s_rec,
+                                                                 x, y,
+                                                                 block_width, block_height,
+                                                                 s->depth, s->frame_rate, &ms_act);
+            s->weights[idx_blk] = 1.0 / sqrt(ms_act);
+        }
+    }
+
+    /* block SSE of chroma, weighted later on with the final luma weights */
+    for (int c = 1; c < s->num_comps; c++) {
+        const int16_t *pc_org = td->org[c];
+        const uint32_t sc_org = stride_org[c] / s->bpp;
+        const int16_t *pc_rec = td->rec[c];
+        const uint32_t sc_rec = s->plane_width[c];
+        const uint32_t  w_pln = s->plane_width[c];
+        const uint32_t  h_pln = s->plane_height[c];
+        const uint32_t     bx = (b * w_pln) / w;
+        const uint32_t     by = (b * h_pln) / h;  /* up to chroma downsampling by 4 */
+        const uint32_t w_blk_c = (w_pln + bx - 1) / bx;
+        const uint32_t h_blk_c = (h_pln + by - 1) / by;
+        const uint32_t start_c = (h_blk_c * jobnr) / nb_jobs;
+        const uint32_t end_c = (h_blk_c * (jobnr+1)) / nb_jobs;
+
+        for (uint32_t y_blk = start_c; y_blk < end_c; y_blk++) {
+            const uint32_t y = y_blk * by;
+            const uint32_t block_height = (y + by > h_pln ? h_pln - y : by);
+            uint32_t idx_blk = y_blk * w_blk_c;
+
+            for (uint32_t x = 0; x < w_pln; x += bx, idx_blk++) {
+                const uint32_t block_width = (x + bx > w_pln ? w_pln - x : bx);
+
+                s->sse_chroma[c - 1][idx_blk] = (double) calc_squared_error (s, pc_org + y * sc_org + x, sc_org,
+                                                                             pc_rec + y * sc_rec + x, sc_rec,
+                                                                             block_width, block_height);
+            }
+        }
+    }
+
+    return 0;
+}
+
 static int get_wsse(AVFilterContext *ctx, int16_t **org, int16_t *org_m1,
                     int16_t *org_m2, int16_t **rec, uint64_t *const wsse64)
 {
@@ -289,35 +340,31 @@ static int get_wsse(AVFilterContext *ctx, int16_t **org, int16_t *org_m1,
         av_log(ctx, AV_LOG_ERROR, "Error in XPSNR routine: invalid argument(s).\n");
         return AVERROR(EINVAL);
     }
-    if (!weights || (b >= 4 && !sse_luma)) {
+    if (!weights || (b >= 4 && (!sse_luma || (s->num_comps > 1 && !s->sse_chroma[0]) ||
+                                (s->num_comps > 2 && !s->sse_chroma[1])))) {
         av_log(ctx, AV_LOG_ERROR, "Failed to allocate temporary block memory.\n");
         return AVERROR(ENOMEM);
     }
 
     if (b >= 4) {
-        const int16_t *p_org = org[0];
-        const uint32_t s_org = stride_org[0] / s->bpp;
-        const int16_t *p_rec = rec[0];
-        const uint32_t s_rec = s->plane_width[0];
-        double     wsse_luma = 0.0;
+        const uint32_t h_blk = (h + b - 1) / b;
+        ThreadData td = {
+            .org    = org,
+            .org_m1 = org_m1,
+            .org_m2 = org_m2,
+            .rec    = rec,
+            .b      = b,
+        };
+        double wsse_luma = 0.0;
+
+        ff_filter_execute(ctx, blocks_slice, &td, NULL,
+                          FFMIN(h_blk, s->nb_threads));
+
+        if (w * h <= 640 * 480) { /* "min-smoothing" as in paper, in block order */
+            for (y = idx_blk = 0; y < h; y += b) {
+                for (x = 0; x < w; x += b, idx_blk++) {
+                    double ms_act_prev;
 
-        for (y = 0; y < h; y += b) { /* calculate block SSE and perceptual weights */
-            const uint32_t block_height = (y + b > h ? h - y : b);
-
-            for (x = 0; x < w; x += b, idx_blk++) {
-                const uint32_t block_width = (x + b > w ? w - x : b);
-                double ms_act = 1.0, ms_act_prev = 0.0;
-
-                sse_luma[idx_blk] = calc_squared_error_and_weight(s, p_org, s_org,
-                                                                  org_m1 /* pixel  */,
-                                                                  org_m2 /* memory */,
-                                                                  p_rec, s_rec,
-                                                                  x, y,
-                                                                  block_width, block_height,
-                                                                  s->depth, s->frame_rate, &ms_act);
-                weights[idx_blk] = 1.0 / sqrt(ms_act);
-
-                if (w * h <= 640 * 480) { /* in-line "min-smoothing" as in paper */
                     if (x == 0) /* first column */
                         ms_act_prev = (idx_blk > 1 ? weights[idx_blk - 2] : 0);
                     else  /* after first column */
@@ -333,9 +380,9 @@ static int get_wsse(AVFilterContext *ctx, int16_t **org, int16_t *org_m1,
                         if (weights[idx_blk] > ms_act_prev)
                             weights[idx_blk] = ms_act_prev;
                     }
-                }
-            } /* for x */
-        } /* for y */
+                } /* for x */
+            } /* for y */
+        }
 
         for (y = idx_blk = 0; y < h; y += b) { /* calculate sum for luma (Y) XPSNR */
             for (x = 0; x < w; x += b, idx_blk++) {
@@ -360,18 +407,12 @@ static int get_wsse(AVFilterContext *ctx, int16_t **org, int16_t *org_m1,
         else if (c > 0) { /* b >= 4 so Y XPSNR has already been calculated above */
             const uint32_t  bx = (b * w_pln) / w;
             const uint32_t  by = (b * h_pln) / h;  /* up to chroma downsampling by 4 */
+            const double *sse_chroma = s->sse_chroma[c - 1];
             double wsse_chroma = 0.0;
 
             for (y = idx_blk = 0; y < h_pln; y += by) { /* calc chroma (Cb/Cr) XPSNR */
-                const uint32_t block_height = (y + by > h_pln ? h_pln - y : by);
-
-                for (x = 0; x < w_pln; x += bx, idx_blk++) {
-                    const uint32_t block_width = (x + bx > w_pln ? w_pln - x : bx);
-
-                    wsse_chroma += (double) calc_squared_error (s, p_org + y * s_org + x, s_org,
-                                                                p_rec + y * s_rec + x, s_rec,
-                                                                block_width, block_height) * weights[idx_blk];
-                }
+                for (x = 0; x < w_pln; x += bx, idx_blk++)
+                    wsse_chroma += sse_chroma[idx_blk] * weights[idx_blk];
             }
             wsse64[c] = (wsse_chroma <= 0.0 ? 0 : (uint64_t) (wsse_chroma * avg_act + 0.5));
         }
@@ -421,6 +462,14 @@ static int do_xpsnr(FFFrameSync *fs)
         s->sse_luma = av_malloc_array(w_blk * h_blk, sizeof(double));
     if (!s->weights)
         s->weights  = av_malloc_array(w_blk * h_blk, sizeof(double));
+    for (c = 1; c < s->num_comps && b >= 4; c++) {
+        const uint32_t bx = (b * s->plane_width [c]) / w;
+        const uint32_t by = (b * s->plane_height[c]) / h;
+
+        if (!s->sse_chroma[c - 1])
+            s->sse_chroma[c - 1] = av_malloc_array(((s->plane_width [c] + bx - 1) / bx) *
+                                                   ((s->plane_height[c] + by - 1) / by), sizeof(double));
+    }
 
     for (c = 0; c < s->num_comps; c++)  /* create temporal org buffer memory */
         s->line_sizes[c] = master->linesize[c];
@@ -433,26 +482,22 @@ static int do_xpsnr(FFFrameSync *fs)
         s->buf_org_m2 = av_calloc(s->plane_height[0], stride_org_bpp * sizeof(int16_t));
 
     if (s->bpp == 1) { /* 8 bit */
-        for (c = 0; c < s->num_comps; c++) { /* allocate org/rec buffer memory */
-            const int m = s->line_sizes[c];  /* master stride */
-            const int r = ref->linesize[c];  /* ref/c stride */
-            const int o = s->plane_width[c]; /* XPSNR stride */
+        ThreadData td = { .master = master, .ref = ref, .org = porg, .rec = prec };
 
+        for (c = 0; c < s->num_comps; c++) { /* allocate org/rec buffer memory */
             if (!s->buf_org[c])
                 s->buf_org[c] = av_calloc(s->plane_width[c], s->plane_height[c] * sizeof(int16_t));
             if (!s->buf_rec[c])
                 s->buf_rec[c] = av_calloc(s->plane_width[c], s->plane_height[c] * sizeof(int16_t));
+            if (!s->buf_org[c] || !s->buf_rec[c])
+                return AVERROR(ENOMEM);
 
             porg[c] = s->buf_org[c];
             prec[c] = s->buf_rec[c];
-
-            for (int y = 0; y < s->plane_height[c]; y++) {
-                for (int x = 0; x < s->plane_width[c]; x++) {
-                    porg[c][y * o + x] = (int16_t) master->data[c][y * m + x];
-                    prec[c][y * o + x] = (int16_t)    ref->data[c][y * r + x];
-                }
-            }
         }
+
+        ff_filter_execute(ctx, convert_slice, &td, NULL,
+                          FFMIN(s->plane_height[0], s->nb_threads));
     } else {  /* 10, 12, 14 bit */
         for (c = 0; c < s->num_comps; c++) {
             porg[c] = (int16_t *) master->data[c];
@@ -585,11 +630,11 @@ static int config_input_ref(AVFilterLink *inlink)
     s->plane_height[1] = s->plane_height[2] = AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h);
     s->plane_height[0] = s->plane_height[3] = inlink->h;
 
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+
     /* XPSNR always operates with 16-bit internal precision */
     ff_psnr_init(&s->pdsp, 15);
-    s->dsp.highds_func = highds; /* initialize filtering methods */
-    s->dsp.diff1st_func = diff1st;
-    s->dsp.diff2nd_func = diff2nd;
+    ff_xpsnr_init(&s->dsp); /* initialize filtering methods */
 
     return 0;
 }
@@ -681,6 +726,8 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     av_freep(&s->sse_luma);
     av_freep(&s->weights );
+    av_freep(&s->sse_chroma[0]);
+    av_freep(&s->sse_chroma[1]);
 
     av_freep(&s->buf_org_m1);
     av_freep(&s->buf_org_m2);
@@ -714,7 +761,8 @@ const FFFilter ff_vf_xpsnr = {
     .p.name       = "xpsnr",
     .p.description = NULL_IF_CONFIG_SMALL("Calculate the extended perceptually weighted peak signal-to-noise ratio (XPSNR) between two video streams."),
     .p.priv_class = &xpsnr_class,
-    .p.flags      = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_METADATA_ONLY,
+    .p.flags      = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_METADATA_ONLY |
+                    AVFILTER_FLAG_SLICE_THREADS,
     .preinit      = xpsnr_framesync_preinit,
     .init         = init,
     .uninit       = uninit,
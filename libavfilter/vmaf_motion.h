@@ -24,35 +24,53 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include "avfilter.h"
+#include "scene_sad.h"
 #include "video.h"
 
 typedef struct VMAFMotionDSPContext {
-    uint64_t (*sad)(const uint16_t *img1, const uint16_t *img2, int w, int h,
-                    ptrdiff_t img1_stride, ptrdiff_t img2_stride);
-    void (*convolution_x)(const uint16_t *filter, int filt_w, const uint16_t *src,
-                          uint16_t *dst, int w, int h, ptrdiff_t src_stride,
-                          ptrdiff_t dst_stride);
-    void (*convolution_y)(const uint16_t *filter, int filt_w, const uint8_t *src,
-                          uint16_t *dst, int w, int h, ptrdiff_t src_stride,
-                          ptrdiff_t dst_stride);
+    ff_scene_sad_fn sad;
+    /**
+     * Horizontal 5-tap blur of w pixels, reading src[-2] up to src[w + 1].
+     */
+    void (*convolution_x)(const uint16_t *filter, const uint16_t *src,
+                          uint16_t *dst, int w);
+    /**
+     * Vertical 5-tap blur of w pixels, src holds the 5 (possibly mirrored)
+     * source rows.
+     */
+    void (*convolution_y)(const uint16_t *filter, const uint8_t *const src[5],
+                          uint16_t *dst, int w);
 } VMAFMotionDSPContext;
 
-void ff_vmafmotion_init_x86(VMAFMotionDSPContext *dsp);
+void ff_vmafmotion_convolution_x_c(const uint16_t *filter, const uint16_t *src,
+                                   uint16_t *dst, int w);
+void ff_vmafmotion_convolution_y_8bit_c(const uint16_t *filter, const uint8_t *const src[5],
+                                        uint16_t *dst, int w);
+void ff_vmafmotion_convolution_y_10bit_c(const uint16_t *filter, const uint8_t *const src[5],
+                                         uint16_t *dst, int w);
+
+void ff_vmafmotion_init_dsp(VMAFMotionDSPContext *dsp, int bpp);
+void ff_vmafmotion_init_x86(VMAFMotionDSPContext *dsp, int bpp);
 
 typedef struct VMAFMotionData {
     uint16_t filter[5];
     int width;
     int height;
+    int depth;
     ptrdiff_t stride;
     uint16_t *blur_data[2 /* cur, prev */];
-    uint16_t *temp_data;
+    uint16_t *temp_data; /* one row per thread */
+    uint64_t *sad;       /* one per thread */
+    int nb_threads;
     double motion_sum;
     uint64_t nb_frames;
     VMAFMotionDSPContext vmafdsp;
 } VMAFMotionData;
 
-int ff_vmafmotion_init(VMAFMotionData *data, int w, int h, enum AVPixelFormat fmt);
-double ff_vmafmotion_process(VMAFMotionData *data, AVFrame *frame);
+int ff_vmafmotion_init(VMAFMotionData *data, int w, int h, enum AVPixelFormat fmt,
+                       int nb_threads);
+double ff_vmafmotion_process(AVFilterContext *ctx, VMAFMotionData *data, AVFrame *frame);
 double ff_vmafmotion_uninit(VMAFMotionData *data);
 
 #endif /* AVFILTER_VMAF_MOTION_H */
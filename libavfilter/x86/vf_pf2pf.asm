@@ -0,0 +1,444 @@
+;******************************************************************************
+;* SIMD-optimized pixel format conversion functions for the pf2pf filter
+;*
+;* This file is part of Librempeg.
+;*
+;* Librempeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* Librempeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with Librempeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION .text
+
+%if ARCH_X86_64
+
+;-----------------------------------------------------------------------------
+; void ff_pf2pf_shuffle(uint8_t *dst, const uint8_t *src, int len,
+;                       const uint8_t *mask, int block);
+;
+; Every load covers 16 bytes but only the first `block` of them are used, so
+; the vector loop stops once fewer than 16 bytes are left.
+;-----------------------------------------------------------------------------
+%macro SHUFFLE 0
+cglobal pf2pf_shuffle, 5, 7, 2, dst, src, len, mask, block, i, tmp
+    movsxdifnidn    lenq, lend
+    movsxdifnidn    blockq, blockd
+%if mmsize == 32
+    vbroadcasti128  m1, [maskq]
+%else
+    movu            m1, [maskq]
+%endif
+    sub             lenq, 16
+%if mmsize == 32
+    sub             lenq, blockq
+%endif
+    jl .tail
+.loop:
+    movu            xm0, [srcq]
+%if mmsize == 32
+    vinserti128     m0, m0, [srcq + blockq], 1
+%endif
+    pshufb          m0, m1
+    movu            [dstq], xm0
+%if mmsize == 32
+    vextracti128    [dstq + blockq], m0, 1
+    add             srcq, blockq
+    add             dstq, blockq
+    sub             lenq, blockq
+%endif
+    add             srcq, blockq
+    add             dstq, blockq
+    sub             lenq, blockq
+    jge .loop
+.tail:
+    add             lenq, 16
+%if mmsize == 32
+    add             lenq, blockq
+%endif
+    jle .end
+.tail_block:
+    xor             iq, iq
+.tail_loop:
+    movsx           tmpq, byte [maskq + iq]
+    test            tmpq, tmpq
+    js .zero
+    movzx           tmpd, byte [srcq + tmpq]
+    jmp .store
+.zero:
+    xor             tmpd, tmpd
+.store:
+    mov             [dstq + iq], tmpb
+    inc             iq
+    dec             lenq
+    jz .end
+    cmp             iq, blockq
+    jl .tail_loop
+    add             srcq, blockq
+    add             dstq, blockq
+    jmp .tail_block
+.end:
+    RET
+%endmacro
+
+; Number of pixels in %1 to stop before the end of the row, so that 16-byte
+; loads or stores of 4-pixel groups of %2 bytes stay inside it
+%macro GROUP_LIMIT 3 ; dst, w, step
+    xor             %1d, %1d
+    cmp             %3d, 3
+    jg %%done
+    mov             %1d, 2
+    je %%done
+    mov             %1d, 4
+%%done:
+    neg             %1q
+    add             %1q, %2q
+    sub             %1q, 15
+%endmacro
+
+; Transpose the dwords of m0-m3, the result is in m1, m4, m3, m0
+%macro TRANSPOSE_DWORDS 0
+    punpckldq       m4, m0, m1
+    punpckhdq       m0, m1
+    punpckldq       m5, m2, m3
+    punpckhdq       m2, m3
+    punpcklqdq      m1, m4, m5
+    punpckhqdq      m4, m5
+    punpcklqdq      m3, m0, m2
+    punpckhqdq      m0, m2
+%endmacro
+
+%macro DEINTERLEAVE_TAIL 2 ; plane, dst
+    movsx           tmpq, byte [maskq + posq + 4*%1]
+    test            tmpq, tmpq
+    js %%zero
+    movzx           tmpd, byte [srcq + tmpq]
+    jmp %%store
+%%zero:
+    xor             tmpd, tmpd
+%%store:
+    mov             [%2 + xq], tmpb
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void ff_pf2pf_deinterleave(uint8_t *const dst[4], const uint8_t *src, int w,
+;                            const uint8_t *mask, int step, int nb_planes);
+;
+; Each 4-pixel group is shuffled into one dword per plane, and four groups are
+; transposed into 16 pixels per plane. Missing planes alias the last one, and
+; the planes are stored in reverse order so that it ends up with its own data.
+;-----------------------------------------------------------------------------
+INIT_XMM ssse3
+cglobal pf2pf_deinterleave, 6, 13, 7, dstp, src, w, mask, step, nb, d0, d1, d2, d3, x, pos, tmp
+    mov             d0q, [dstpq]
+    mov             d1q, [dstpq + 8]
+    mov             d2q, [dstpq + 16]
+    mov             d3q, [dstpq + 24]
+    cmp             nbd, 2
+    jge .nb2
+    mov             d1q, d0q
+.nb2:
+    cmp             nbd, 3
+    jge .nb3
+    mov             d2q, d1q
+.nb3:
+    cmp             nbd, 4
+    jge .nb4
+    mov             d3q, d2q
+.nb4:
+    movsxdifnidn    wq, wd
+    movsxdifnidn    stepq, stepd
+    movu            m6, [maskq]
+    GROUP_LIMIT     pos, w, step
+    lea             tmpq, [stepq*3]
+    shl             tmpq, 2
+    xor             xq, xq
+    cmp             xq, posq
+    jge .tail
+.loop:
+    movu            m0, [srcq]
+    movu            m1, [srcq + stepq*4]
+    movu            m2, [srcq + stepq*8]
+    movu            m3, [srcq + tmpq]
+    pshufb          m0, m6
+    pshufb          m1, m6
+    pshufb          m2, m6
+    pshufb          m3, m6
+    TRANSPOSE_DWORDS
+    movu            [d3q + xq], m0
+    movu            [d2q + xq], m3
+    movu            [d1q + xq], m4
+    movu            [d0q + xq], m1
+    lea             srcq, [srcq + stepq*8]
+    lea             srcq, [srcq + stepq*8]
+    add             xq, 16
+    cmp             xq, posq
+    jl .loop
+.tail:
+    cmp             xq, wq
+    jge .end
+.tail_loop:
+    mov             posd, xd
+    and             posd, 3
+    DEINTERLEAVE_TAIL 3, d3q
+    DEINTERLEAVE_TAIL 2, d2q
+    DEINTERLEAVE_TAIL 1, d1q
+    DEINTERLEAVE_TAIL 0, d0q
+    inc             xq
+    test            xd, 3
+    jnz .next
+    lea             srcq, [srcq + stepq*4]
+.next:
+    cmp             xq, wq
+    jl .tail_loop
+.end:
+    RET
+
+;-----------------------------------------------------------------------------
+; void ff_pf2pf_interleave(uint8_t *dst, const uint8_t *const src[4], int w,
+;                          const uint8_t *mask, int step, int nb_planes);
+;
+; The inverse of the above. The mask never refers to missing planes, so they
+; just alias the first one.
+;-----------------------------------------------------------------------------
+cglobal pf2pf_interleave, 6, 13, 7, dst, srcp, w, mask, step, nb, s0, s1, s2, s3, x, pos, tmp
+    mov             s0q, [srcpq]
+    mov             s1q, s0q
+    mov             s2q, s0q
+    mov             s3q, s0q
+    cmp             nbd, 2
+    jl .planes_done
+    mov             s1q, [srcpq + 8]
+    cmp             nbd, 3
+    jl .planes_done
+    mov             s2q, [srcpq + 16]
+    cmp             nbd, 4
+    jl .planes_done
+    mov             s3q, [srcpq + 24]
+.planes_done:
+    movsxdifnidn    wq, wd
+    movsxdifnidn    stepq, stepd
+    movu            m6, [maskq]
+    GROUP_LIMIT     pos, w, step
+    lea             tmpq, [stepq*3]
+    shl             tmpq, 2
+    xor             xq, xq
+    cmp             xq, posq
+    jge .tail
+.loop:
+    movu            m0, [s0q + xq]
+    movu            m1, [s1q + xq]
+    movu            m2, [s2q + xq]
+    movu            m3, [s3q + xq]
+    TRANSPOSE_DWORDS
+    pshufb          m1, m6
+    pshufb          m4, m6
+    pshufb          m3, m6
+    pshufb          m0, m6
+    ; the stores overlap, so they have to be done in order
+    movu            [dstq], m1
+    movu            [dstq + stepq*4], m4
+    movu            [dstq + stepq*8], m3
+    movu            [dstq + tmpq], m0
+    lea             dstq, [dstq + stepq*8]
+    lea             dstq, [dstq + stepq*8]
+    add             xq, 16
+    cmp             xq, posq
+    jl .loop
+.tail:
+    cmp             xq, wq
+    jge .end
+.tail_loop:
+    ; bytes [pos, nb) of the current group belong to pixel x
+    mov             posd, xd
+    and             posd, 3
+    imul            posd, stepd
+    mov             nbd, posd
+    add             nbd, stepd
+.byte_loop:
+    movsx           tmpq, byte [maskq + posq]
+    test            tmpq, tmpq
+    js .zero
+    mov             s0q, tmpq
+    shr             s0q, 2
+    mov             s0q, [srcpq + s0q*8]
+    mov             s1q, xq
+    and             s1q, ~3
+    and             tmpq, 3
+    add             s1q, tmpq
+    movzx           tmpd, byte [s0q + s1q]
+    jmp .store
+.zero:
+    xor             tmpd, tmpd
+.store:
+    mov             [dstq + posq], tmpb
+    inc             posq
+    cmp             posq, nbq
+    jl .byte_loop
+    inc             xq
+    test            xd, 3
+    jnz .next
+    lea             dstq, [dstq + stepq*4]
+.next:
+    cmp             xq, wq
+    jl .tail_loop
+.end:
+    RET
+
+;-----------------------------------------------------------------------------
+; void ff_pf2pf_widen(uint16_t *dst, const uint8_t *src, int len, int shift);
+;-----------------------------------------------------------------------------
+%macro WIDEN 0
+cglobal pf2pf_widen, 4, 6, 4, dst, src, len, shift, x, tmp
+    movd            xm2, shiftd
+    pxor            m3, m3
+    movsxdifnidn    lenq, lend
+    xor             xq, xq
+    mov             tmpq, lenq
+    and             tmpq, ~(mmsize - 1)
+    jz .tail
+.loop:
+%if mmsize == 32
+    pmovzxbw        m0, [srcq + xq]
+    pmovzxbw        m1, [srcq + xq + 16]
+%else
+    movu            m1, [srcq + xq]
+    punpcklbw       m0, m1, m3
+    punpckhbw       m1, m3
+%endif
+    psllw           m0, xm2
+    psllw           m1, xm2
+    movu            [dstq + xq*2], m0
+    movu            [dstq + xq*2 + mmsize], m1
+    add             xq, mmsize
+    cmp             xq, tmpq
+    jl .loop
+.tail:
+    cmp             xq, lenq
+    jge .end
+.tail_loop:
+    movzx           tmpd, byte [srcq + xq]
+    movd            xm0, tmpd
+    psllw           xm0, xm2
+    movd            tmpd, xm0
+    mov             [dstq + xq*2], tmpw
+    inc             xq
+    cmp             xq, lenq
+    jl .tail_loop
+.end:
+    RET
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void ff_pf2pf_narrow(uint8_t *dst, const uint16_t *src, int len, int shift);
+;
+; shift is at least 1, so the signed saturation of packuswb does not matter.
+;-----------------------------------------------------------------------------
+%macro NARROW 0
+cglobal pf2pf_narrow, 4, 6, 3, dst, src, len, shift, x, tmp
+    movd            xm2, shiftd
+    movsxdifnidn    lenq, lend
+    xor             xq, xq
+    mov             tmpq, lenq
+    and             tmpq, ~(mmsize - 1)
+    jz .tail
+.loop:
+    movu            m0, [srcq + xq*2]
+    movu            m1, [srcq + xq*2 + mmsize]
+    psrlw           m0, xm2
+    psrlw           m1, xm2
+    packuswb        m0, m1
+%if mmsize == 32
+    vpermq          m0, m0, q3120
+%endif
+    movu            [dstq + xq], m0
+    add             xq, mmsize
+    cmp             xq, tmpq
+    jl .loop
+.tail:
+    cmp             xq, lenq
+    jge .end
+.tail_loop:
+    movzx           tmpd, word [srcq + xq*2]
+    movd            xm0, tmpd
+    psrlw           xm0, xm2
+    packuswb        xm0, xm0
+    movd            tmpd, xm0
+    mov             [dstq + xq], tmpb
+    inc             xq
+    cmp             xq, lenq
+    jl .tail_loop
+.end:
+    RET
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void ff_pf2pf_shift16(uint16_t *dst, const uint16_t *src, int len,
+;                       int lshift, int rshift);
+;-----------------------------------------------------------------------------
+%macro SHIFT16 0
+cglobal pf2pf_shift16, 5, 7, 4, dst, src, len, lshift, rshift, x, tmp
+    movd            xm2, lshiftd
+    movd            xm3, rshiftd
+    movsxdifnidn    lenq, lend
+    xor             xq, xq
+    mov             tmpq, lenq
+    and             tmpq, ~(mmsize - 1)
+    jz .tail
+.loop:
+    movu            m0, [srcq + xq*2]
+    movu            m1, [srcq + xq*2 + mmsize]
+    psrlw           m0, xm3
+    psrlw           m1, xm3
+    psllw           m0, xm2
+    psllw           m1, xm2
+    movu            [dstq + xq*2], m0
+    movu            [dstq + xq*2 + mmsize], m1
+    add             xq, mmsize
+    cmp             xq, tmpq
+    jl .loop
+.tail:
+    cmp             xq, lenq
+    jge .end
+.tail_loop:
+    movzx           tmpd, word [srcq + xq*2]
+    movd            xm0, tmpd
+    psrlw           xm0, xm3
+    psllw           xm0, xm2
+    movd            tmpd, xm0
+    mov             [dstq + xq*2], tmpw
+    inc             xq
+    cmp             xq, lenq
+    jl .tail_loop
+.end:
+    RET
+%endmacro
+
+INIT_XMM sse2
+WIDEN
+NARROW
+SHIFT16
+
+INIT_XMM ssse3
+SHUFFLE
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+SHUFFLE
+WIDEN
+NARROW
+SHIFT16
+%endif
+
+%endif ; ARCH_X86_64
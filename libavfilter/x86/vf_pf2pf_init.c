@@ -0,0 +1,64 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/pf2pf.h"
+
+void ff_pf2pf_shuffle_ssse3(uint8_t *dst, const uint8_t *src, int len,
+                            const uint8_t *mask, int block);
+void ff_pf2pf_shuffle_avx2(uint8_t *dst, const uint8_t *src, int len,
+                           const uint8_t *mask, int block);
+void ff_pf2pf_deinterleave_ssse3(uint8_t *const dst[4], const uint8_t *src, int w,
+                                 const uint8_t *mask, int step, int nb_planes);
+void ff_pf2pf_interleave_ssse3(uint8_t *dst, const uint8_t *const src[4], int w,
+                               const uint8_t *mask, int step, int nb_planes);
+
+#define DEPTH_FUNCS(opt)                                                              \
+void ff_pf2pf_widen_##opt(uint16_t *dst, const uint8_t *src, int len, int shift);     \
+void ff_pf2pf_narrow_##opt(uint8_t *dst, const uint16_t *src, int len, int shift);    \
+void ff_pf2pf_shift16_##opt(uint16_t *dst, const uint16_t *src, int len,              \
+                            int lshift, int rshift);
+
+DEPTH_FUNCS(sse2)
+DEPTH_FUNCS(avx2)
+
+av_cold void ff_pf2pf_dsp_init_x86(PF2PFDSPContext *dsp)
+{
+#if ARCH_X86_64
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSE2(cpu_flags)) {
+        dsp->widen   = ff_pf2pf_widen_sse2;
+        dsp->narrow  = ff_pf2pf_narrow_sse2;
+        dsp->shift16 = ff_pf2pf_shift16_sse2;
+    }
+    if (EXTERNAL_SSSE3(cpu_flags)) {
+        dsp->shuffle      = ff_pf2pf_shuffle_ssse3;
+        dsp->deinterleave = ff_pf2pf_deinterleave_ssse3;
+        dsp->interleave   = ff_pf2pf_interleave_ssse3;
+    }
+    if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+        dsp->shuffle = ff_pf2pf_shuffle_avx2;
+        dsp->widen   = ff_pf2pf_widen_avx2;
+        dsp->narrow  = ff_pf2pf_narrow_avx2;
+        dsp->shift16 = ff_pf2pf_shift16_avx2;
+    }
+#endif
+}
@@ -0,0 +1,178 @@
+;*****************************************************************************
+;* x86-optimized functions for vmafmotion filter
+;*
+;* This file is part of Librempeg.
+;*
+;* Librempeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* Librempeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with Librempeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION .text
+
+; broadcast the tap pairs (f0,f1), (f2,f3) and (f4,0) into m5, m6 and m7
+%macro LOAD_TAPS 1 ; filter
+    movd                  xm5, [%1]
+    movd                  xm6, [%1 + 4]
+    movzx             tmpd, word [%1 + 8]
+    movd                  xm7, tmpd
+%if cpuflag(avx2)
+    vpbroadcastd           m5, xm5
+    vpbroadcastd           m6, xm6
+    vpbroadcastd           m7, xm7
+%else
+    pshufd                 m5, m5, 0
+    pshufd                 m6, m6, 0
+    pshufd                 m7, m7, 0
+%endif
+%endmacro
+
+; m0 (words) = packed (m0:m1 . taps) >> %1 for the unsigned word inputs in
+; m0..m4, with m0/m1, m2/m3 and m4/zero interleaved into tap pairs
+%macro FILTER5 1 ; shift
+    punpckhwd              m8, m0, m1
+    punpcklwd              m0, m1
+    punpckhwd              m9, m2, m3
+    punpcklwd              m2, m3
+    pxor                   m3, m3
+    punpckhwd              m1, m4, m3
+    punpcklwd              m4, m3
+    pmaddwd                m0, m5
+    pmaddwd                m8, m5
+    pmaddwd                m2, m6
+    pmaddwd                m9, m6
+    pmaddwd                m4, m7
+    pmaddwd                m1, m7
+    paddd                  m0, m2
+    paddd                  m8, m9
+    paddd                  m0, m4
+    paddd                  m8, m1
+    psrld                  m0, %1
+    psrld                  m8, %1
+    packssdw               m0, m8
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_vmafmotion_convolution_x(const uint16_t *filter, const uint16_t *src,
+;                                  uint16_t *dst, ptrdiff_t w)
+;
+; w is a multiple of mmsize / 2, src[-2] .. src[w + 1] are read
+;------------------------------------------------------------------------------
+%macro VMAFMOTION_CONVOLUTION_X 0
+cglobal vmafmotion_convolution_x, 4, 5, 10, filter, src, dst, w, tmp
+    LOAD_TAPS filterq
+    add                    wq, wq
+    add                  srcq, wq
+    add                  dstq, wq
+    neg                    wq
+
+.loop:
+    movu                   m0, [srcq + wq - 4]
+    movu                   m1, [srcq + wq - 2]
+    movu                   m2, [srcq + wq]
+    movu                   m3, [srcq + wq + 2]
+    movu                   m4, [srcq + wq + 4]
+    FILTER5 15
+    movu          [dstq + wq], m0
+    add                    wq, mmsize
+    jl .loop
+    RET
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_vmafmotion_convolution_y_<bits>bit(const uint16_t *filter,
+;                                            const uint8_t *const src[5],
+;                                            uint16_t *dst, ptrdiff_t w)
+;
+; w is a multiple of mmsize / 2
+;------------------------------------------------------------------------------
+%macro VMAFMOTION_CONVOLUTION_Y 1 ; bits
+cglobal vmafmotion_convolution_y_%1bit, 4, 10, 10, filter, src, dst, w, tmp, row0, row1, row2, row3, row4
+    LOAD_TAPS filterq
+    mov                 row0q, [srcq]
+    mov                 row1q, [srcq + gprsize]
+    mov                 row2q, [srcq + gprsize * 2]
+    mov                 row3q, [srcq + gprsize * 3]
+    mov                 row4q, [srcq + gprsize * 4]
+%if %1 == 8
+    add                 row0q, wq
+    add                 row1q, wq
+    add                 row2q, wq
+    add                 row3q, wq
+    add                 row4q, wq
+    lea                  dstq, [dstq + wq * 2]
+    neg                    wq
+%else
+    add                    wq, wq
+    add                 row0q, wq
+    add                 row1q, wq
+    add                 row2q, wq
+    add                 row3q, wq
+    add                 row4q, wq
+    add                  dstq, wq
+    neg                    wq
+%endif
+
+.loop:
+%if %1 == 8
+%if cpuflag(avx2)
+    pmovzxbw               m0, [row0q + wq]
+    pmovzxbw               m1, [row1q + wq]
+    pmovzxbw               m2, [row2q + wq]
+    pmovzxbw               m3, [row3q + wq]
+    pmovzxbw               m4, [row4q + wq]
+%else
+    pxor                   m9, m9
+    movh                   m0, [row0q + wq]
+    movh                   m1, [row1q + wq]
+    movh                   m2, [row2q + wq]
+    movh                   m3, [row3q + wq]
+    movh                   m4, [row4q + wq]
+    punpcklbw              m0, m9
+    punpcklbw              m1, m9
+    punpcklbw              m2, m9
+    punpcklbw              m3, m9
+    punpcklbw              m4, m9
+%endif
+    FILTER5 8
+    movu      [dstq + wq * 2], m0
+    add                    wq, mmsize / 2
+%else
+    movu                   m0, [row0q + wq]
+    movu                   m1, [row1q + wq]
+    movu                   m2, [row2q + wq]
+    movu                   m3, [row3q + wq]
+    movu                   m4, [row4q + wq]
+    FILTER5 10
+    movu          [dstq + wq], m0
+    add                    wq, mmsize
+%endif
+    jl .loop
+    RET
+%endmacro
+
+%if ARCH_X86_64
+INIT_XMM sse2
+VMAFMOTION_CONVOLUTION_X
+VMAFMOTION_CONVOLUTION_Y 8
+VMAFMOTION_CONVOLUTION_Y 10
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+VMAFMOTION_CONVOLUTION_X
+VMAFMOTION_CONVOLUTION_Y 8
+VMAFMOTION_CONVOLUTION_Y 10
+%endif
+%endif
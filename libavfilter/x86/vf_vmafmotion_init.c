@@ -0,0 +1,95 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/vmaf_motion.h"
+
+#define VMAFMOTION_FUNCS(opt, MMSIZE)                                                   \
+void ff_vmafmotion_convolution_x_##opt(const uint16_t *filter, const uint16_t *src,   \
+                                       uint16_t *dst, ptrdiff_t w);                    \
+void ff_vmafmotion_convolution_y_8bit_##opt(const uint16_t *filter,                    \
+                                            const uint8_t *const src[5],               \
+                                            uint16_t *dst, ptrdiff_t w);               \
+void ff_vmafmotion_convolution_y_10bit_##opt(const uint16_t *filter,                   \
+                                             const uint8_t *const src[5],              \
+                                             uint16_t *dst, ptrdiff_t w);              \
+                                                                                       \
+static void convolution_x_##opt(const uint16_t *filter, const uint16_t *src,           \
+                                uint16_t *dst, int w)                                  \
+{                                                                                      \
+    const int aw = w & ~(MMSIZE / 2 - 1);                                              \
+                                                                                       \
+    if (aw > 0)                                                                        \
+        ff_vmafmotion_convolution_x_##opt(filter, src, dst, aw);                       \
+    ff_vmafmotion_convolution_x_c(filter, src + aw, dst + aw, w - aw);                 \
+}                                                                                      \
+                                                                                       \
+static void convolution_y_8bit_##opt(const uint16_t *filter,                           \
+                                     const uint8_t *const src[5],                      \
+                                     uint16_t *dst, int w)                             \
+{                                                                                      \
+    const int aw = w & ~(MMSIZE / 2 - 1);                                              \
+    const uint8_t *tail[5];                                                            \
+                                                                                       \
+    if (aw > 0)                                                                        \
+        ff_vmafmotion_convolution_y_8bit_##opt(filter, src, dst, aw);                  \
+    for (int k = 0; k < 5; k++)                                                        \
+        tail[k] = src[k] + aw;                                                         \
+    ff_vmafmotion_convolution_y_8bit_c(filter, tail, dst + aw, w - aw);                \
+}                                                                                      \
+                                                                                       \
+static void convolution_y_10bit_##opt(const uint16_t *filter,                          \
+                                      const uint8_t *const src[5],                     \
+                                      uint16_t *dst, int w)                            \
+{                                                                                      \
+    const int aw = w & ~(MMSIZE / 2 - 1);                                              \
+    const uint8_t *tail[5];                                                            \
+                                                                                       \
+    if (aw > 0)                                                                        \
+        ff_vmafmotion_convolution_y_10bit_##opt(filter, src, dst, aw);                 \
+    for (int k = 0; k < 5; k++)                                                        \
+        tail[k] = src[k] + aw * 2;                                                     \
+    ff_vmafmotion_convolution_y_10bit_c(filter, tail, dst + aw, w - aw);               \
+}
+
+#if HAVE_X86ASM && ARCH_X86_64
+VMAFMOTION_FUNCS(sse2, 16)
+#if HAVE_AVX2_EXTERNAL
+VMAFMOTION_FUNCS(avx2, 32)
+#endif
+#endif
+
+av_cold void ff_vmafmotion_init_x86(VMAFMotionDSPContext *dsp, int bpp)
+{
+#if HAVE_X86ASM && ARCH_X86_64
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSE2(cpu_flags)) {
+        dsp->convolution_x = convolution_x_sse2;
+        dsp->convolution_y = bpp == 10 ? convolution_y_10bit_sse2 : convolution_y_8bit_sse2;
+    }
+#if HAVE_AVX2_EXTERNAL
+    if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+        dsp->convolution_x = convolution_x_avx2;
+        dsp->convolution_y = bpp == 10 ? convolution_y_10bit_avx2 : convolution_y_8bit_avx2;
+    }
+#endif
+#endif
+}
@@ -0,0 +1,245 @@
+;*****************************************************************************
+;* x86-optimized functions for xpsnr filter
+;*
+;* This file is part of Librempeg.
+;*
+;* Librempeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* Librempeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with Librempeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+; Horizontal taps of the downsampled highpass at columns x-2 .. x+3, stored as
+; word pairs so that pmaddwd on loads at x-2, x and x+2 yields one output per
+; dword lane. Each row pair shares the same taps.
+hp_taps_c: times 8 dw  0, -1   ; rows y-2 and y+3
+           times 8 dw -1, -1
+           times 8 dw -1,  0
+hp_taps_b: times 8 dw -1, -2   ; rows y-1 and y+2
+           times 8 dw -3, -3
+           times 8 dw -2, -1
+hp_taps_a: times 8 dw -1, -3   ; rows y and y+1
+           times 8 dw 12, 12
+           times 8 dw -3, -1
+
+pw_1: times 16 dw 1
+
+SECTION .text
+
+; m7 += |m0| as unsigned qwords, m3 must be zero
+%macro ACCUM_ABS 0
+    pabsd                  m0, m0
+    punpckhdq              m1, m0, m3
+    punpckldq              m0, m3
+    paddq                  m7, m0
+    paddq                  m7, m1
+%endmacro
+
+%macro HORIZONTAL_SUMQ 1 ; accumulator
+%if mmsize == 32
+    vextracti128          xm0, m%1, 1
+    paddq                xm%1, xm0
+%endif
+    pshufd                xm0, xm%1, q1032
+    paddq                xm%1, xm0
+%endmacro
+
+; %1 = row address, %2 = taps
+%macro HIGHPASS_ROW 2
+    movu                   m4, [%1 - 4]
+    movu                   m5, [%1]
+    movu                   m6, [%1 + 4]
+    pmaddwd                m4, [%2]
+    pmaddwd                m5, [%2 + 32]
+    pmaddwd                m6, [%2 + 64]
+    paddd                  m0, m4
+    paddd                  m0, m5
+    paddd                  m0, m6
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_xpsnr_highds(const int16_t *src, ptrdiff_t stride, ptrdiff_t width,
+;                      ptrdiff_t height, uint64_t *sum)
+;
+; width is in pixels and a multiple of mmsize / 2, height is the number of
+; output rows (pairs of pixel rows), stride is in pixels
+;------------------------------------------------------------------------------
+%macro XPSNR_HIGHDS 0
+cglobal xpsnr_highds, 5, 8, 8, src, stride, width, height, sum, x, row0, row3
+    add               strideq, strideq
+    add                widthq, widthq
+    pxor                   m3, m3
+    pxor                   m7, m7
+
+.nextrow:
+    mov                  row0q, srcq
+    sub                  row0q, strideq
+    sub                  row0q, strideq
+    lea                  row3q, [srcq + strideq]
+    mov                     xq, widthq
+
+.loop:
+    pxor                   m0, m0
+    HIGHPASS_ROW row0q,               hp_taps_c
+    HIGHPASS_ROW row0q + strideq,     hp_taps_b
+    HIGHPASS_ROW row0q + strideq * 2, hp_taps_a
+    HIGHPASS_ROW row3q,               hp_taps_a
+    HIGHPASS_ROW row3q + strideq,     hp_taps_b
+    HIGHPASS_ROW row3q + strideq * 2, hp_taps_c
+    ACCUM_ABS
+
+    add                  row0q, mmsize
+    add                  row3q, mmsize
+    sub                     xq, mmsize
+    jg .loop
+
+    lea                   srcq, [srcq + strideq * 2]
+    dec                heightq
+    jg .nextrow
+
+    HORIZONTAL_SUMQ 7
+    movq               [sumq], xm7
+    RET
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_xpsnr_diff1st(const int16_t *cur, int16_t *prev1, ptrdiff_t stride,
+;                       ptrdiff_t width, ptrdiff_t height, uint64_t *sum)
+;
+; Sum of absolute 2x2 temporal differences, without the XPSNR_GAMMA factor.
+; prev1 is updated with cur.
+;------------------------------------------------------------------------------
+%macro XPSNR_DIFF1ST 0
+cglobal xpsnr_diff1st, 6, 7, 9, cur, prev1, stride, width, height, sum, x
+    add               strideq, strideq
+    add                widthq, widthq
+    mova                   m8, [pw_1]
+    pxor                   m3, m3
+    pxor                   m7, m7
+
+.nextrow:
+    mov                     xq, widthq
+
+.loop:
+    movu                   m0, [curq]
+    movu                   m1, [curq + strideq]
+    movu                   m4, [prev1q]
+    movu                   m5, [prev1q + strideq]
+    movu         [prev1q], m0
+    movu [prev1q + strideq], m1
+    pmaddwd                m0, m8
+    pmaddwd                m1, m8
+    pmaddwd                m4, m8
+    pmaddwd                m5, m8
+    paddd                  m0, m1
+    paddd                  m4, m5
+    psubd                  m0, m4
+    ACCUM_ABS
+
+    add                  curq, mmsize
+    add                prev1q, mmsize
+    sub                     xq, mmsize
+    jg .loop
+
+    sub                  curq, widthq
+    sub                prev1q, widthq
+    lea                  curq, [curq   + strideq * 2]
+    lea                prev1q, [prev1q + strideq * 2]
+    dec                heightq
+    jg .nextrow
+
+    HORIZONTAL_SUMQ 7
+    movq               [sumq], xm7
+    RET
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_xpsnr_diff2nd(const int16_t *cur, int16_t *prev1, int16_t *prev2,
+;                       ptrdiff_t stride, ptrdiff_t width, ptrdiff_t height,
+;                       uint64_t *sum)
+;
+; Sum of absolute 2x2 second-order temporal differences, without the
+; XPSNR_GAMMA factor. prev2 is updated with prev1 and prev1 with cur.
+;------------------------------------------------------------------------------
+%macro XPSNR_DIFF2ND 0
+cglobal xpsnr_diff2nd, 7, 8, 10, cur, prev1, prev2, stride, width, height, sum, x
+    add               strideq, strideq
+    add                widthq, widthq
+    mova                   m8, [pw_1]
+    pxor                   m3, m3
+    pxor                   m7, m7
+
+.nextrow:
+    mov                     xq, widthq
+
+.loop:
+    movu                   m0, [curq]
+    movu                   m1, [curq + strideq]
+    movu                   m4, [prev1q]
+    movu                   m5, [prev1q + strideq]
+    movu                   m6, [prev2q]
+    movu                   m9, [prev2q + strideq]
+    movu         [prev2q], m4
+    movu [prev2q + strideq], m5
+    movu         [prev1q], m0
+    movu [prev1q + strideq], m1
+    pmaddwd                m0, m8
+    pmaddwd                m1, m8
+    pmaddwd                m4, m8
+    pmaddwd                m5, m8
+    pmaddwd                m6, m8
+    pmaddwd                m9, m8
+    paddd                  m0, m1
+    paddd                  m4, m5
+    paddd                  m6, m9
+    paddd                  m4, m4
+    paddd                  m0, m6
+    psubd                  m0, m4
+    ACCUM_ABS
+
+    add                  curq, mmsize
+    add                prev1q, mmsize
+    add                prev2q, mmsize
+    sub                     xq, mmsize
+    jg .loop
+
+    sub                  curq, widthq
+    sub                prev1q, widthq
+    sub                prev2q, widthq
+    lea                  curq, [curq   + strideq * 2]
+    lea                prev1q, [prev1q + strideq * 2]
+    lea                prev2q, [prev2q + strideq * 2]
+    dec                heightq
+    jg .nextrow
+
+    HORIZONTAL_SUMQ 7
+    movq               [sumq], xm7
+    RET
+%endmacro
+
+%if ARCH_X86_64
+INIT_XMM ssse3
+XPSNR_HIGHDS
+XPSNR_DIFF1ST
+XPSNR_DIFF2ND
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+XPSNR_HIGHDS
+XPSNR_DIFF1ST
+XPSNR_DIFF2ND
+%endif
+%endif
@@ -0,0 +1,95 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/xpsnr.h"
+
+#define XPSNR_FUNCS(opt, MMSIZE)                                                        \
+void ff_xpsnr_highds_##opt(const int16_t *src, ptrdiff_t stride, ptrdiff_t width,     \
+                           ptrdiff_t height, uint64_t *sum);                           \
+void ff_xpsnr_diff1st_##opt(const int16_t *cur, int16_t *prev1, ptrdiff_t stride,      \
+                            ptrdiff_t width, ptrdiff_t height, uint64_t *sum);         \
+void ff_xpsnr_diff2nd_##opt(const int16_t *cur, int16_t *prev1, int16_t *prev2,        \
+                            ptrdiff_t stride, ptrdiff_t width, ptrdiff_t height,       \
+                            uint64_t *sum);                                            \
+                                                                                       \
+static uint64_t highds_##opt(const int x_act, const int y_act, const int w_act,        \
+                             const int h_act, const int16_t *o_m0, const int o)        \
+{                                                                                      \
+    const int w = (w_act - x_act) & ~(MMSIZE / 2 - 1);                                 \
+    uint64_t sum = 0;                                                                  \
+                                                                                       \
+    if (w > 0)                                                                         \
+        ff_xpsnr_highds_##opt(o_m0 + y_act * o + x_act, o, w,                          \
+                              (h_act - y_act + 1) >> 1, &sum);                         \
+    return sum + ff_xpsnr_highds_c(x_act + w, y_act, w_act, h_act, o_m0, o);           \
+}                                                                                      \
+                                                                                       \
+static uint64_t diff1st_##opt(const uint32_t w_act, const uint32_t h_act,              \
+                              const int16_t *o_m0, int16_t *o_m1, const int o)         \
+{                                                                                      \
+    const uint32_t w = w_act & ~(MMSIZE / 2 - 1);                                      \
+    uint64_t sum = 0;                                                                  \
+                                                                                       \
+    if (w > 0 && h_act > 0)                                                            \
+        ff_xpsnr_diff1st_##opt(o_m0, o_m1, o, w, (h_act + 1) >> 1, &sum);              \
+    return sum * XPSNR_GAMMA +                                                         \
+           ff_xpsnr_diff1st_c(w_act - w, h_act, o_m0 + w, o_m1 + w, o);                \
+}                                                                                      \
+                                                                                       \
+static uint64_t diff2nd_##opt(const uint32_t w_act, const uint32_t h_act,              \
+                              const int16_t *o_m0, int16_t *o_m1, int16_t *o_m2,       \
+                              const int o)                                             \
+{                                                                                      \
+    const uint32_t w = w_act & ~(MMSIZE / 2 - 1);                                      \
+    uint64_t sum = 0;                                                                  \
+                                                                                       \
+    if (w > 0 && h_act > 0)                                                            \
+        ff_xpsnr_diff2nd_##opt(o_m0, o_m1, o_m2, o, w, (h_act + 1) >> 1, &sum);        \
+    return sum * XPSNR_GAMMA +                                                         \
+           ff_xpsnr_diff2nd_c(w_act - w, h_act, o_m0 + w, o_m1 + w, o_m2 + w, o);      \
+}
+
+#if HAVE_X86ASM && ARCH_X86_64
+XPSNR_FUNCS(ssse3, 16)
+#if HAVE_AVX2_EXTERNAL
+XPSNR_FUNCS(avx2,  32)
+#endif
+#endif
+
+av_cold void ff_xpsnr_init_x86(XPSNRDSPContext *dsp)
+{
+#if HAVE_X86ASM && ARCH_X86_64
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSSE3(cpu_flags)) {
+        dsp->highds_func  = highds_ssse3;
+        dsp->diff1st_func = diff1st_ssse3;
+        dsp->diff2nd_func = diff2nd_ssse3;
+    }
+#if HAVE_AVX2_EXTERNAL
+    if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+        dsp->highds_func  = highds_avx2;
+        dsp->diff1st_func = diff1st_avx2;
+        dsp->diff2nd_func = diff2nd_avx2;
+    }
+#endif
+#endif
+}
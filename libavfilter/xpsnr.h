@@ -34,6 +34,8 @@
 #include <stdint.h>
 #include "libavutil/x86/cpu.h"
 
+#define XPSNR_GAMMA 2
+
 /* public XPSNR DSP structure definition */
 
 typedef struct XPSNRDSPContext {
@@ -42,4 +44,12 @@ typedef struct XPSNRDSPContext {
     uint64_t (*diff2nd_func)(const uint32_t w_act, const uint32_t h_act, const int16_t *o_m0, int16_t *o_m1, int16_t *o_m2, const int o);
 } XPSNRDSPContext;
 
+/* C reference versions, also used for the tails of the SIMD versions */
+uint64_t ff_xpsnr_highds_c (const int x_act, const int y_act, const int w_act, const int h_act, const int16_t *o_m0, const int o);
+uint64_t ff_xpsnr_diff1st_c(const uint32_t w_act, const uint32_t h_act, const int16_t *o_m0, int16_t *o_m1, const int o);
+uint64_t ff_xpsnr_diff2nd_c(const uint32_t w_act, const uint32_t h_act, const int16_t *o_m0, int16_t *o_m1, int16_t *o_m2, const int o);
+
+void ff_xpsnr_init(XPSNRDSPContext *dsp);
+void ff_xpsnr_init_x86(XPSNRDSPContext *dsp);
+
 #endif /* AVFILTER_XPSNR_H */
@@ -0,0 +1,302 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+
+#include "box.h"
+
+void ff_sws_box_vsum8_c(uint32_t *acc, const uint8_t *src, int w, int weight)
+{
+    for (int x = 0; x < w; x++)
+        acc[x] += src[x] * (uint32_t) weight;
+}
+
+void ff_sws_box_vsum16_c(uint32_t *acc, const uint16_t *src, int w, int weight)
+{
+    for (int x = 0; x < w; x++)
+        acc[x] += src[x] * (uint32_t) weight;
+}
+
+void ff_sws_box_vsumf_c(float *acc, const float *src, int w, float weight)
+{
+    for (int x = 0; x < w; x++)
+        acc[x] += src[x] * weight;
+}
+
+av_cold void ff_sws_box_init_dsp(SwsBoxDSP *dsp)
+{
+    dsp->vsum8  = ff_sws_box_vsum8_c;
+    dsp->vsum16 = ff_sws_box_vsum16_c;
+    dsp->vsumf  = ff_sws_box_vsumf_c;
+
+#if ARCH_X86
+    ff_sws_box_init_dsp_x86(dsp);
+#endif
+}
+
+static int plane_vshift(const AVPixFmtDescriptor *desc, int plane)
+{
+    return (plane == 1 || plane == 2) ? desc->log2_chroma_h : 0;
+}
+
+static int plane_hshift(const AVPixFmtDescriptor *desc, int plane)
+{
+    return (plane == 1 || plane == 2) ? desc->log2_chroma_w : 0;
+}
+
+static bool setup_plane(SwsBoxPlane *pl, int src_w, int src_h, int dst_w, int dst_h,
+                        int depth, bool is_float)
+{
+    const int64_t gx = av_gcd(src_w, dst_w);
+    const int64_t gy = av_gcd(src_h, dst_h);
+
+    pl->src_w  = src_w;
+    pl->src_h  = src_h;
+    pl->dst_w  = dst_w;
+    pl->dst_h  = dst_h;
+    pl->src_xu = src_w / gx;
+    pl->dst_xu = dst_w / gx;
+    pl->src_yu = src_h / gy;
+    pl->dst_yu = dst_h / gy;
+
+    /* Row weights are at most dst_yu and must fit into 16 bits, and the sum
+     * of the weighted rows must fit into 32 bits */
+    if (pl->dst_yu > UINT16_MAX)
+        return false;
+    if (!is_float && ((1LL << depth) - 1) * pl->src_yu > UINT32_MAX)
+        return false;
+    return true;
+}
+
+static bool setup(SwsBox *box, enum AVPixelFormat fmt, int src_w, int src_h,
+                  int dst_w, int dst_h)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+    int depth, planes = 0;
+
+    if (!desc || desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM |
+                                AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BAYER |
+                                AV_PIX_FMT_FLAG_XYZ))
+        return false;
+    if (dst_w > src_w || dst_h > src_h)
+        return false;
+
+    depth = desc->comp[0].depth;
+    box->fmt      = fmt;
+    box->is_float = desc->flags & AV_PIX_FMT_FLAG_FLOAT;
+    box->bytes    = box->is_float ? 4 : depth > 8 ? 2 : 1;
+    if (box->is_float ? depth != 32 : depth > 16)
+        return false;
+    if (box->bytes > 1 && !(desc->flags & AV_PIX_FMT_FLAG_BE) != !HAVE_BIGENDIAN)
+        return false;
+
+    /* every component must be alone in its plane */
+    for (int i = 0; i < desc->nb_components; i++) {
+        const AVComponentDescriptor *comp = &desc->comp[i];
+        if (comp->step != box->bytes || comp->offset || comp->shift ||
+            comp->depth != depth || planes & (1 << comp->plane))
+            return false;
+        planes |= 1 << comp->plane;
+    }
+
+    box->sub_y     = desc->log2_chroma_h;
+    box->nb_planes = desc->nb_components;
+    for (int i = 0; i < box->nb_planes; i++) {
+        const int sx = plane_hshift(desc, i), sy = plane_vshift(desc, i);
+        if (!setup_plane(&box->planes[i],
+                         AV_CEIL_RSHIFT(src_w, sx), AV_CEIL_RSHIFT(src_h, sy),
+                         AV_CEIL_RSHIFT(dst_w, sx), AV_CEIL_RSHIFT(dst_h, sy),
+                         depth, box->is_float))
+            return false;
+    }
+
+    return true;
+}
+
+bool ff_sws_box_supported(enum AVPixelFormat fmt, int src_w, int src_h,
+                          int dst_w, int dst_h)
+{
+    SwsBox box;
+    return setup(&box, fmt, src_w, src_h, dst_w, dst_h);
+}
+
+SwsBox *ff_sws_box_alloc(enum AVPixelFormat fmt, int src_w, int src_h,
+                         int dst_w, int dst_h, int num_slices)
+{
+    SwsBox *box = av_mallocz(sizeof(*box));
+    if (!box)
+        return NULL;
+
+    if (!setup(box, fmt, src_w, src_h, dst_w, dst_h))
+        goto fail;
+
+    box->acc = av_calloc(num_slices, sizeof(*box->acc));
+    if (!box->acc)
+        goto fail;
+    box->num_acc = num_slices;
+    for (int i = 0; i < num_slices; i++) {
+        /* the first plane is always the widest */
+        box->acc[i] = av_malloc_array(FFALIGN(src_w, 16), sizeof(uint32_t));
+        if (!box->acc[i])
+            goto fail;
+    }
+
+    ff_sws_box_init_dsp(&box->dsp);
+    return box;
+
+fail:
+    ff_sws_box_free(&box);
+    return NULL;
+}
+
+void ff_sws_box_free(SwsBox **pbox)
+{
+    SwsBox *box = *pbox;
+    if (!box)
+        return;
+
+    for (int i = 0; i < box->num_acc; i++)
+        av_free(box->acc[i]);
+    av_free(box->acc);
+    av_freep(pbox);
+}
+
+/* Output rows [*y0, *y1) of plane `i` that belong to output rows [y, y + h) */
+static void plane_rows(const SwsBox *box, int i, int y, int h, int *y0, int *y1)
+{
+    const int sub = (i == 1 || i == 2) ? box->sub_y : 0;
+    *y0 = y >> sub;
+    *y1 = y + h == box->planes[0].dst_h ? box->planes[i].dst_h : (y + h) >> sub;
+}
+
+void ff_sws_box_input_range(const SwsBox *box, int y, int h, int *in_y, int *in_h)
+{
+    int first = INT_MAX, last = 0;
+
+    for (int i = 0; i < box->nb_planes; i++) {
+        const SwsBoxPlane *pl = &box->planes[i];
+        const int sub = (i == 1 || i == 2) ? box->sub_y : 0;
+        int y0, y1, r0, r1;
+
+        plane_rows(box, i, y, h, &y0, &y1);
+        if (y0 >= y1)
+            continue;
+        r0 = (int64_t) y0 * pl->src_yu / pl->dst_yu;
+        r1 = ((int64_t) y1 * pl->src_yu + pl->dst_yu - 1) / pl->dst_yu;
+        first = FFMIN(first, r0 << sub);
+        last  = FFMAX(last,  r1 << sub);
+    }
+
+    first = FFMIN(first, box->planes[0].src_h);
+    last  = av_clip(last, first, box->planes[0].src_h);
+    *in_y = first;
+    *in_h = last - first;
+}
+
+static void reduce_int(const SwsBoxPlane *pl, uint8_t *dst, const uint32_t *acc,
+                       int bytes)
+{
+    const uint64_t norm = (uint64_t) pl->src_xu * pl->src_yu;
+
+    for (int x = 0; x < pl->dst_w; x++) {
+        const int64_t end = (int64_t) (x + 1) * pl->src_xu;
+        int64_t pos = end - pl->src_xu;
+        int c = pos / pl->dst_xu;
+        uint64_t sum = 0;
+
+        while (pos < end) {
+            const int64_t next = FFMIN((int64_t) (c + 1) * pl->dst_xu, end);
+            sum += (uint64_t) (next - pos) * acc[c++];
+            pos = next;
+        }
+
+        sum = (sum + (norm >> 1)) / norm;
+        if (bytes == 1)
+            dst[x] = sum;
+        else
+            ((uint16_t *) dst)[x] = sum;
+    }
+}
+
+static void reduce_float(const SwsBoxPlane *pl, float *dst, const float *acc)
+{
+    const float scale = 1.0f / ((float) pl->src_xu * pl->src_yu);
+
+    for (int x = 0; x < pl->dst_w; x++) {
+        const int64_t end = (int64_t) (x + 1) * pl->src_xu;
+        int64_t pos = end - pl->src_xu;
+        int c = pos / pl->dst_xu;
+        float sum = 0.0f;
+
+        while (pos < end) {
+            const int64_t next = FFMIN((int64_t) (c + 1) * pl->dst_xu, end);
+            sum += (next - pos) * acc[c++];
+            pos = next;
+        }
+
+        dst[x] = sum * scale;
+    }
+}
+
+void ff_sws_box_run(const SwsBox *box, uint8_t *const dst[4], const int dst_stride[4],
+                    const uint8_t *const src[4], const int src_stride[4],
+                    int y, int h, int slice)
+{
+    const SwsBoxDSP *dsp = &box->dsp;
+    void *acc = box->acc[slice];
+
+    for (int i = 0; i < box->nb_planes; i++) {
+        const SwsBoxPlane *pl = &box->planes[i];
+        int y0, y1;
+
+        plane_rows(box, i, y, h, &y0, &y1);
+        for (int oy = y0; oy < y1; oy++) {
+            const int64_t end = (int64_t) (oy + 1) * pl->src_yu;
+            int64_t pos = end - pl->src_yu;
+            int r = pos / pl->dst_yu;
+
+            memset(acc, 0, pl->src_w * sizeof(uint32_t));
+            while (pos < end) {
+                const int64_t next = FFMIN((int64_t) (r + 1) * pl->dst_yu, end);
+                const int weight = next - pos;
+                const uint8_t *row = src[i] + r * (ptrdiff_t) src_stride[i];
+
+                if (box->is_float)
+                    dsp->vsumf(acc, (const float *) row, pl->src_w, weight);
+                else if (box->bytes == 2)
+                    dsp->vsum16(acc, (const uint16_t *) row, pl->src_w, weight);
+                else
+                    dsp->vsum8(acc, row, pl->src_w, weight);
+                pos = next;
+                r++;
+            }
+
+            if (box->is_float)
+                reduce_float(pl, (float *) (dst[i] + oy * (ptrdiff_t) dst_stride[i]), acc);
+            else
+                reduce_int(pl, dst[i] + oy * (ptrdiff_t) dst_stride[i], acc, box->bytes);
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SWSCALE_BOX_H
+#define SWSCALE_BOX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libavutil/pixfmt.h"
+
+/**
+ * Exact area-average (box) downscaler for planar formats.
+ *
+ * Each output pixel is the average of the source pixels it covers, weighted
+ * by their overlap with it. Output rows are computed by accumulating the
+ * covered source rows into a row of sums, which is then reduced horizontally.
+ * All weights are kept as integers, so the result is exact up to the final
+ * rounding, for any scaling ratio.
+ */
+
+/**
+ * Vertical reduction kernels: acc[x] += src[x] * weight, for 0 <= x < w.
+ * `acc` must be aligned to 64 bytes.
+ */
+typedef struct SwsBoxDSP {
+    void (*vsum8) (uint32_t *acc, const uint8_t  *src, int w, int weight);
+    void (*vsum16)(uint32_t *acc, const uint16_t *src, int w, int weight);
+    void (*vsumf) (float    *acc, const float    *src, int w, float weight);
+} SwsBoxDSP;
+
+typedef struct SwsBoxPlane {
+    int src_w, src_h;
+    int dst_w, dst_h;
+    /* source and destination pixel sizes, reduced by their common divisor */
+    int src_xu, dst_xu;
+    int src_yu, dst_yu;
+} SwsBoxPlane;
+
+typedef struct SwsBox {
+    SwsBoxDSP dsp;
+    enum AVPixelFormat fmt;
+    int bytes;     /* bytes per sample */
+    bool is_float;
+    int sub_y;     /* log2 vertical chroma subsampling */
+    int nb_planes;
+    SwsBoxPlane planes[4];
+
+    /* one row of sums per slice */
+    void **acc;
+    int num_acc;
+} SwsBox;
+
+/**
+ * Returns true if the box scaler can convert between these dimensions of
+ * the given pixel format.
+ */
+bool ff_sws_box_supported(enum AVPixelFormat fmt, int src_w, int src_h,
+                          int dst_w, int dst_h);
+
+/**
+ * Allocate a box scaler, with state for up to `num_slices` concurrent
+ * slices of output rows. Returns NULL on failure.
+ */
+SwsBox *ff_sws_box_alloc(enum AVPixelFormat fmt, int src_w, int src_h,
+                         int dst_w, int dst_h, int num_slices);
+
+void ff_sws_box_free(SwsBox **box);
+
+/**
+ * Range of source rows [in_y, in_y + in_h) read for output rows [y, y + h).
+ */
+void ff_sws_box_input_range(const SwsBox *box, int y, int h, int *in_y, int *in_h);
+
+/**
+ * Compute output rows [y, y + h), using the state of slice `slice`. `dst`
+ * and `src` point to the start of their respective images.
+ */
+void ff_sws_box_run(const SwsBox *box, uint8_t *const dst[4], const int dst_stride[4],
+                    const uint8_t *const src[4], const int src_stride[4],
+                    int y, int h, int slice);
+
+void ff_sws_box_init_dsp(SwsBoxDSP *dsp);
+void ff_sws_box_init_dsp_x86(SwsBoxDSP *dsp);
+
+void ff_sws_box_vsum8_c (uint32_t *acc, const uint8_t  *src, int w, int weight);
+void ff_sws_box_vsum16_c(uint32_t *acc, const uint16_t *src, int w, int weight);
+void ff_sws_box_vsumf_c (float    *acc, const float    *src, int w, float weight);
+
+#endif /* SWSCALE_BOX_H */
@@ -0,0 +1,258 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/executor.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/thread.h"
+
+#include "swscale.h"
+#include "swscale_internal.h"
+
+/**
+ * Frame-parallel scaling: each frame in flight is scaled by its own
+ * SwsContext, and so by its own graph, on a pool of worker threads. Frames
+ * are returned in submission order, from a ring of at most `nb_jobs` frames.
+ */
+
+typedef struct SwsFrameJob {
+    AVTask task;
+    SwsContext *sws;
+    AVFrame *dst;
+    AVFrame *src;
+    uint64_t seq;
+    int ret;
+    int done;
+} SwsFrameJob;
+
+struct SwsFrameThread {
+    AVExecutor *executor;
+    SwsFrameJob *jobs;
+    int nb_jobs;
+    int first;      /* oldest frame in flight */
+    int nb_queued;  /* number of frames in flight */
+    int draining;
+    uint64_t seq;
+
+    AVMutex lock;
+    AVCond cond;
+};
+
+static int job_priority_higher(const AVTask *a, const AVTask *b)
+{
+    return ((const SwsFrameJob *) a)->seq < ((const SwsFrameJob *) b)->seq;
+}
+
+static int job_ready(const AVTask *t, void *user_data)
+{
+    return 1;
+}
+
+static int job_run(AVTask *t, void *local_context, void *user_data)
+{
+    SwsFrameThread *ft = user_data;
+    SwsFrameJob *job = (SwsFrameJob *) t;
+    int ret;
+
+    ret = sws_scale_frame(job->sws, job->dst, job->src);
+    av_frame_unref(job->src);
+
+    ff_mutex_lock(&ft->lock);
+    job->ret  = ret;
+    job->done = 1;
+    ff_cond_broadcast(&ft->cond);
+    ff_mutex_unlock(&ft->lock);
+    return 0;
+}
+
+void ff_sws_frame_thread_free(SwsInternal *c)
+{
+    SwsFrameThread *ft = c->frame_thread;
+    if (!ft)
+        return;
+
+    /* waits for the frames currently being scaled */
+    av_executor_free(&ft->executor);
+    for (int i = 0; i < ft->nb_jobs; i++) {
+        sws_free_context(&ft->jobs[i].sws);
+        av_frame_free(&ft->jobs[i].dst);
+        av_frame_free(&ft->jobs[i].src);
+    }
+    av_freep(&ft->jobs);
+    ff_cond_destroy(&ft->cond);
+    ff_mutex_destroy(&ft->lock);
+    av_freep(&c->frame_thread);
+}
+
+static int nb_frame_threads(const SwsContext *sws)
+{
+    if (sws->frame_threads)
+        return sws->frame_threads;
+    return av_clip(av_cpu_count(), 1, SWS_MAX_THREADS);
+}
+
+static int frame_thread_init(SwsContext *sws)
+{
+    SwsInternal *c = sws_internal(sws);
+    SwsFrameThread *ft = c->frame_thread;
+    const int nb_jobs = nb_frame_threads(sws);
+    AVTaskCallbacks cb = {
+        .priority_higher = job_priority_higher,
+        .ready           = job_ready,
+        .run             = job_run,
+    };
+    int ret;
+
+    /* the number of frames in flight can only change when there are none */
+    if (ft && (ft->nb_jobs == nb_jobs || ft->nb_queued || ft->draining))
+        return 0;
+    ff_sws_frame_thread_free(c);
+
+    ft = av_mallocz(sizeof(*ft));
+    if (!ft)
+        return AVERROR(ENOMEM);
+    c->frame_thread = ft;
+
+    ret = ff_mutex_init(&ft->lock, NULL);
+    if (ret) {
+        av_freep(&c->frame_thread);
+        return AVERROR(ret);
+    }
+    ret = ff_cond_init(&ft->cond, NULL);
+    if (ret) {
+        ff_mutex_destroy(&ft->lock);
+        av_freep(&c->frame_thread);
+        return AVERROR(ret);
+    }
+
+    ft->jobs = av_calloc(nb_jobs, sizeof(*ft->jobs));
+    if (!ft->jobs)
+        goto fail;
+    ft->nb_jobs = nb_jobs;
+    for (int i = 0; i < nb_jobs; i++) {
+        SwsFrameJob *job = &ft->jobs[i];
+        job->sws = sws_alloc_context();
+        job->dst = av_frame_alloc();
+        job->src = av_frame_alloc();
+        if (!job->sws || !job->dst || !job->src)
+            goto fail;
+    }
+
+    cb.user_data = ft;
+    ft->executor = av_executor_alloc(&cb, nb_jobs);
+    if (!ft->executor)
+        goto fail;
+
+    return 0;
+
+fail:
+    ff_sws_frame_thread_free(c);
+    return AVERROR(ENOMEM);
+}
+
+int sws_send_frame(SwsContext *sws, AVFrame *dst, const AVFrame *src)
+{
+    SwsInternal *c = sws_internal(sws);
+    SwsFrameThread *ft;
+    SwsFrameJob *job;
+    int ret, threads;
+
+    if (!dst != !src)
+        return AVERROR(EINVAL);
+    if (c->frame_src) {
+        av_log(sws, AV_LOG_ERROR, "sws_send_frame() cannot be used on "
+               "explicitly initialized contexts.\n");
+        return AVERROR(EINVAL);
+    }
+
+    ret = frame_thread_init(sws);
+    if (ret < 0)
+        return ret;
+    ft = c->frame_thread;
+
+    if (ft->draining)
+        return AVERROR_EOF;
+    if (!src) {
+        ft->draining = 1;
+        return 0;
+    }
+    if (ft->nb_queued == ft->nb_jobs)
+        return AVERROR(EAGAIN);
+
+    job = &ft->jobs[(ft->first + ft->nb_queued) % ft->nb_jobs];
+    ret = av_opt_copy(job->sws, sws);
+    if (ret < 0)
+        return ret;
+
+    /* share the slice threads between the frames in flight */
+    threads = sws->threads ? sws->threads : av_cpu_count();
+    job->sws->threads = FFMAX(threads / ft->nb_jobs, 1);
+
+    ret = av_frame_ref(job->src, src);
+    if (ret < 0)
+        return ret;
+    av_frame_move_ref(job->dst, dst);
+    job->ret  = 0;
+    job->done = 0;
+    job->seq  = ft->seq++;
+    ft->nb_queued++;
+
+    av_executor_execute(ft->executor, &job->task);
+    return 0;
+}
+
+int sws_receive_frame(SwsContext *sws, AVFrame *dst)
+{
+    SwsInternal *c = sws_internal(sws);
+    SwsFrameThread *ft = c->frame_thread;
+    SwsFrameJob *job;
+    int ret;
+
+    if (!ft || !ft->nb_queued) {
+        if (ft && ft->draining) {
+            ft->draining = 0;
+            return AVERROR_EOF;
+        }
+        return AVERROR(EAGAIN);
+    }
+
+    job = &ft->jobs[ft->first];
+    ff_mutex_lock(&ft->lock);
+    if (!job->done && !ft->draining && ft->nb_queued < ft->nb_jobs) {
+        ff_mutex_unlock(&ft->lock);
+        return AVERROR(EAGAIN);
+    }
+    while (!job->done)
+        ff_cond_wait(&ft->cond, &ft->lock);
+    ff_mutex_unlock(&ft->lock);
+
+    ft->first = (ft->first + 1) % ft->nb_jobs;
+    ft->nb_queued--;
+
+    ret = job->ret;
+    if (ret < 0) {
+        av_frame_unref(job->dst);
+        return ret;
+    }
+
+    av_frame_move_ref(dst, job->dst);
+    return 0;
+}
@@ -30,11 +30,16 @@
 #include "libswscale/swscale.h"
 #include "libswscale/format.h"
 
+#include "box.h"
 #include "cms.h"
 #include "lut3d.h"
 #include "swscale_internal.h"
 #include "graph.h"
 
+/* Approximate amount of intermediate data kept per band of rows when
+ * pipelining passes, chosen to stay within a typical L2 cache */
+#define PIPELINE_BAND_BYTES (512 << 10)
+
 static int pass_alloc_output(SwsPass *pass)
 {
     if (!pass || pass->output.fmt != AV_PIX_FMT_NONE)
@@ -61,12 +66,7 @@ SwsPass *ff_sws_graph_add_pass(SwsGraph *graph, enum AVPixelFormat fmt,
     pass->height = height;
     pass->input  = input;
     pass->output.fmt = AV_PIX_FMT_NONE;
-
-    ret = pass_alloc_output(input);
-    if (ret < 0) {
-        av_free(pass);
-        return NULL;
-    }
+    pass->output_idx = -1;
 
     if (!align) {
         pass->slice_h = pass->height;
@@ -94,6 +94,17 @@ static int pass_append(SwsGraph *graph, enum AVPixelFormat fmt, int w, int h,
     return 0;
 }
 
+/* Same as pass_append(), for stateless passes operating on each row alone */
+static int pass_append_row_local(SwsGraph *graph, enum AVPixelFormat fmt, int w, int h,
+                                 SwsPass **pass, void *priv, sws_filter_run_t run)
+{
+    int ret = pass_append(graph, fmt, w, h, pass, 1, priv, run);
+    if (ret < 0)
+        return ret;
+    (*pass)->row_local = true;
+    return 0;
+}
+
 static void run_copy(const SwsImg *out_base, const SwsImg *in_base,
                      int y, int h, const SwsPass *pass)
 {
@@ -221,6 +232,35 @@ static void run_legacy_swscale(const SwsImg *out_base, const SwsImg *in,
                sws->src_h, out.data, out.linesize, y, h);
 }
 
+static void legacy_swscale_input_range(const SwsPass *pass, int y, int h,
+                                       int *in_y, int *in_h)
+{
+    const SwsContext *sws = pass->priv;
+    const SwsInternal *c = sws_internal(sws);
+    const int chr_dst_sub = c->chrDstVSubSample;
+    const int chr_src_sub = c->chrSrcVSubSample;
+    /* ff_swscale() looks ahead to the end of the chroma row */
+    const int last = FFMIN((y + h - 1) | ((1 << chr_dst_sub) - 1), sws->dst_h - 1);
+    int first_y = INT_MAX, last_y = 0;
+
+    for (int i = y; i <= last; i++) {
+        first_y = FFMIN(first_y, c->vLumFilterPos[i]);
+        last_y  = FFMAX(last_y,  c->vLumFilterPos[i] + c->vLumFilterSize);
+    }
+
+    if (c->vChrFilterPos) {
+        for (int i = y >> chr_dst_sub; i <= last >> chr_dst_sub; i++) {
+            first_y = FFMIN(first_y,  c->vChrFilterPos[i] << chr_src_sub);
+            last_y  = FFMAX(last_y,  (c->vChrFilterPos[i] + c->vChrFilterSize) << chr_src_sub);
+        }
+    }
+
+    first_y = av_clip(first_y, 0, sws->src_h);
+    last_y  = av_clip(last_y,  first_y, sws->src_h);
+    *in_y = first_y;
+    *in_h = last_y - first_y;
+}
+
 static void get_chroma_pos(SwsGraph *graph, int *h_chr_pos, int *v_chr_pos,
                            const SwsFormat *fmt)
 {
@@ -310,13 +350,13 @@ static int init_legacy_subpass(SwsGraph *graph, SwsContext *sws,
         align = 0; /* disable slice threading */
 
     if (c->src0Alpha && !c->dst0Alpha && isALPHA(sws->dst_format)) {
-        ret = pass_append(graph, AV_PIX_FMT_RGBA, src_w, src_h, &input, 1, c, run_rgb0);
+        ret = pass_append_row_local(graph, AV_PIX_FMT_RGBA, src_w, src_h, &input, c, run_rgb0);
         if (ret < 0)
             return ret;
     }
 
     if (c->srcXYZ && !(c->dstXYZ && unscaled)) {
-        ret = pass_append(graph, AV_PIX_FMT_RGB48, src_w, src_h, &input, 1, c, run_xyz2rgb);
+        ret = pass_append_row_local(graph, AV_PIX_FMT_RGB48, src_w, src_h, &input, c, run_xyz2rgb);
         if (ret < 0)
             return ret;
     }
@@ -327,6 +367,8 @@ static int init_legacy_subpass(SwsGraph *graph, SwsContext *sws,
         return AVERROR(ENOMEM);
     pass->setup = setup_legacy_swscale;
     pass->free = free_legacy_swscale;
+    if (!c->convert_unscaled)
+        pass->input_range = legacy_swscale_input_range;
 
     /**
      * For slice threading, we need to create sub contexts, similar to how
@@ -372,7 +414,7 @@ static int init_legacy_subpass(SwsGraph *graph, SwsContext *sws,
     }
 
     if (c->dstXYZ && !(c->srcXYZ && unscaled)) {
-        ret = pass_append(graph, AV_PIX_FMT_RGB48, dst_w, dst_h, &pass, 1, c, run_rgb2xyz);
+        ret = pass_append_row_local(graph, AV_PIX_FMT_RGB48, dst_w, dst_h, &pass, c, run_rgb2xyz);
         if (ret < 0)
             return ret;
     }
@@ -453,6 +495,53 @@ static int add_legacy_sws_pass(SwsGraph *graph, SwsFormat src, SwsFormat dst,
     return 0;
 }
 
+/****************************
+ * Area-average downscaling *
+ ****************************/
+
+static void free_box(void *priv)
+{
+    SwsBox *box = priv;
+    ff_sws_box_free(&box);
+}
+
+static void run_box(const SwsImg *out, const SwsImg *in, int y, int h,
+                    const SwsPass *pass)
+{
+    ff_sws_box_run(pass->priv, out->data, out->linesize,
+                   (const uint8_t *const *) in->data, in->linesize,
+                   y, h, y / pass->slice_h);
+}
+
+static void box_input_range(const SwsPass *pass, int y, int h, int *in_y, int *in_h)
+{
+    ff_sws_box_input_range(pass->priv, y, h, in_y, in_h);
+}
+
+static int add_box_pass(SwsGraph *graph, SwsFormat src, SwsFormat dst,
+                        SwsPass *input, SwsPass **output)
+{
+    SwsBox *box;
+    SwsPass *pass;
+
+    pass = ff_sws_graph_add_pass(graph, dst.format, dst.width, dst.height,
+                                 input, ff_fmt_align(dst.format), NULL, run_box);
+    if (!pass)
+        return AVERROR(ENOMEM);
+
+    box = ff_sws_box_alloc(dst.format, src.width, src.height,
+                           dst.width, dst.height, pass->num_slices);
+    if (!box)
+        return AVERROR(ENOMEM);
+
+    pass->priv = box;
+    pass->free = free_box;
+    pass->input_range = box_input_range;
+
+    *output = pass;
+    return 0;
+}
+
 /**************************
  * Gamut and tone mapping *
  **************************/
@@ -522,6 +611,7 @@ static int adapt_colors(SwsGraph *graph, SwsFormat src, SwsFormat dst,
     if (fmt_in != src.format) {
         SwsFormat tmp = src;
         tmp.format = fmt_in;
+        tmp.desc   = av_pix_fmt_desc_get(fmt_in);
         ret = add_legacy_sws_pass(graph, src, tmp, input, &input);
         if (ret < 0)
             return ret;
@@ -541,6 +631,7 @@ static int adapt_colors(SwsGraph *graph, SwsFormat src, SwsFormat dst,
     }
     pass->setup = setup_lut3d;
     pass->free = free_lut3d;
+    pass->row_local = true;
 
     *output = pass;
     return 0;
@@ -550,18 +641,41 @@ static int adapt_colors(SwsGraph *graph, SwsFormat src, SwsFormat dst,
  * Main filter graph construction code *
  ***************************************/
 
-static int init_passes(SwsGraph *graph)
+/* Output of adapt_colors() as seen by the following passes */
+static SwsFormat color_mapped_fmt(SwsFormat src, const SwsFormat *dst,
+                                  const SwsPass *pass)
 {
-    SwsFormat src = graph->src;
-    SwsFormat dst = graph->dst;
-    SwsPass *pass = NULL; /* read from main input image */
+    src.format = pass ? pass->format : src.format;
+    src.desc   = av_pix_fmt_desc_get(src.format);
+    src.color  = dst->color;
+    return src;
+}
+
+/**
+ * Add the passes converting `src`, the output of `input`, to the destination
+ * `idx`. The last of them, returned in `output`, writes to the destination
+ * image.
+ */
+static int init_branch(SwsGraph *graph, SwsFormat src, SwsPass *input, int idx,
+                       SwsPass **output)
+{
+    const SwsFormat dst = graph->dsts[idx];
+    SwsPass *pass = input;
     int ret;
 
-    ret = adapt_colors(graph, src, dst, pass, &pass);
-    if (ret < 0)
-        return ret;
-    src.format = pass ? pass->format : src.format;
-    src.color  = dst.color;
+    if ((graph->ctx->flags & SWS_BOX) &&
+        (src.width != dst.width || src.height != dst.height) &&
+        ff_sws_box_supported(src.format, src.width, src.height,
+                             dst.width, dst.height)) {
+        /* downscale first, any format conversion runs on the smaller image */
+        SwsFormat tmp = src;
+        tmp.width  = dst.width;
+        tmp.height = dst.height;
+        ret = add_box_pass(graph, src, tmp, pass, &pass);
+        if (ret < 0)
+            return ret;
+        src = tmp;
+    }
 
     if (!ff_fmt_equal(&src, &dst)) {
         ret = add_legacy_sws_pass(graph, src, dst, pass, &pass);
@@ -569,17 +683,334 @@ static int init_passes(SwsGraph *graph)
             return ret;
     }
 
-    if (!pass) {
+    if (pass == input) {
         /* No passes were added, so no operations were necessary */
-        graph->noop = 1;
+        graph->noop = !input && graph->num_dsts == 1;
 
         /* Add threaded memcpy pass */
         pass = ff_sws_graph_add_pass(graph, dst.format, dst.width, dst.height,
-                                     pass, 1, NULL, run_copy);
+                                     input, 1, NULL, run_copy);
         if (!pass)
             return AVERROR(ENOMEM);
     }
 
+    pass->output_idx = idx;
+    *output = pass;
+    return 0;
+}
+
+static int init_passes(SwsGraph *graph)
+{
+    SwsPass *pass = NULL; /* read from main input image */
+    int ret;
+
+    ret = adapt_colors(graph, graph->src, graph->dst, pass, &pass);
+    if (ret < 0)
+        return ret;
+
+    return init_branch(graph, color_mapped_fmt(graph->src, &graph->dst, pass),
+                       pass, 0, &pass);
+}
+
+/* Returns true if adapt_colors() gives the same result for both destinations */
+static bool same_color_map(const SwsFormat *dst1, const SwsFormat *dst2)
+{
+    if (isGray(dst1->format) || isGray(dst2->format))
+        return isGray(dst1->format) && isGray(dst2->format);
+
+    return ff_color_equal(&dst1->color, &dst2->color) &&
+           ff_sws_lut3d_pick_pixfmt(*dst1, 1) == ff_sws_lut3d_pick_pixfmt(*dst2, 1);
+}
+
+/**
+ * Picks the smallest destination built so far that the n-th largest
+ * destination can be scaled from instead of from the source, or -1.
+ */
+static int pick_cascade(const SwsGraph *graph, const int *order, int n)
+{
+    const SwsFormat *dst = &graph->dsts[order[n]];
+    int best = -1;
+
+    for (int m = 0; m < n; m++) {
+        const SwsFormat *prev = &graph->dsts[order[m]];
+        if (!ff_props_equal(prev, dst) ||
+            prev->width > graph->src.width || prev->height > graph->src.height ||
+            2 * prev->width  < 3 * dst->width ||
+            2 * prev->height < 3 * dst->height)
+            continue;
+
+        if (best < 0 || (int64_t) prev->width * prev->height <
+                        (int64_t) graph->dsts[best].width * graph->dsts[best].height)
+            best = order[m];
+    }
+
+    return best;
+}
+
+static int init_passes_multi(SwsGraph *graph)
+{
+    SwsPass **mapped, **last;
+    int *order, ret = 0;
+
+    order  = av_malloc_array(graph->num_dsts, sizeof(*order));
+    mapped = av_calloc(graph->num_dsts, sizeof(*mapped));
+    last   = av_calloc(graph->num_dsts, sizeof(*last));
+    if (!order || !mapped || !last) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    /* largest destinations first, so they are available for cascading */
+    for (int i = 0; i < graph->num_dsts; i++) {
+        const int64_t area = (int64_t) graph->dsts[i].width * graph->dsts[i].height;
+        int n = i;
+        for (; n > 0; n--) {
+            const SwsFormat *prev = &graph->dsts[order[n - 1]];
+            if ((int64_t) prev->width * prev->height >= area)
+                break;
+            order[n] = order[n - 1];
+        }
+        order[n] = i;
+    }
+
+    for (int n = 0; n < graph->num_dsts; n++) {
+        const int idx = order[n];
+        const SwsFormat *dst = &graph->dsts[idx];
+        const int prev = graph->ctx->flags & SWS_CASCADE ? pick_cascade(graph, order, n) : -1;
+        int shared = -1;
+
+        if (prev >= 0) {
+            /* same properties, so also the same colour mapping */
+            mapped[idx] = mapped[prev];
+            ret = init_branch(graph, graph->dsts[prev], last[prev], idx, &last[idx]);
+            if (ret < 0)
+                goto end;
+            continue;
+        }
+
+        for (int m = 0; m < n && shared < 0; m++) {
+            if (same_color_map(&graph->dsts[order[m]], dst))
+                shared = order[m];
+        }
+
+        if (shared >= 0) {
+            mapped[idx] = mapped[shared];
+        } else {
+            ret = adapt_colors(graph, graph->src, *dst, NULL, &mapped[idx]);
+            if (ret < 0)
+                goto end;
+        }
+
+        ret = init_branch(graph, color_mapped_fmt(graph->src, dst, mapped[idx]),
+                          mapped[idx], idx, &last[idx]);
+        if (ret < 0)
+            goto end;
+    }
+
+end:
+    av_free(order);
+    av_free(mapped);
+    av_free(last);
+    return ret;
+}
+
+/**********************
+ * Pipelined execution *
+ **********************/
+
+/**
+ * Row-local passes are not run over the full image. Instead, the pass reading
+ * from them pulls their output in bands of rows, which are computed on demand
+ * into a small window per slice. Consecutive bands of a slice only compute the
+ * rows not already held, so the overlap needed by vertical filters is kept
+ * around rather than recomputed.
+ */
+
+static int pass_num_consumers(const SwsGraph *graph, const SwsPass *pass)
+{
+    int num = 0;
+    for (int i = 0; i < graph->num_passes; i++)
+        num += graph->passes[i]->input == pass;
+    return num;
+}
+
+/* Full output image of a pass which is not fused */
+static const SwsImg *pass_output_img(const SwsGraph *graph, const SwsPass *pass)
+{
+    if (!pass)
+        return &graph->exec.input;
+    if (pass->output_idx >= 0)
+        return &graph->exec.output[pass->output_idx];
+    return &pass->output;
+}
+
+static int pass_row_align(const SwsPass *pass)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(pass->format);
+    return 1 << desc->log2_chroma_h;
+}
+
+static void pass_input_range(const SwsPass *pass, int y, int h, int *in_y, int *in_h)
+{
+    if (pass->input_range) {
+        pass->input_range(pass, y, h, in_y, in_h);
+    } else {
+        *in_y = y;
+        *in_h = h;
+    }
+}
+
+/* Image view of a window, such that row y of the pass is at data + y * linesize */
+static SwsImg window_img(const SwsPassWindow *win)
+{
+    SwsImg img = win->img;
+    for (int i = 0; i < 4 && img.data[i]; i++)
+        img.data[i] -= (win->y >> ff_fmt_vshift(img.fmt, i)) * img.linesize[i];
+    return img;
+}
+
+/* Drop the first n rows of a window */
+static void window_shift(SwsPassWindow *win, int n)
+{
+    for (int i = 0; i < 4 && win->img.data[i]; i++) {
+        const int sub = ff_fmt_vshift(win->img.fmt, i);
+        const int skip = n >> sub;
+        const int end  = (win->y + win->h + (1 << sub) - 1) >> sub;
+        const int keep = end - ((win->y + n) >> sub);
+        if (keep > 0) {
+            memmove(win->img.data[i], win->img.data[i] + skip * win->img.linesize[i],
+                    keep * win->img.linesize[i]);
+        }
+    }
+    win->y += n;
+    win->h -= n;
+}
+
+/**
+ * Get an image holding at least rows [y, y+h) of the output of `pass`,
+ * running it first if it is fused into its consumer.
+ */
+static void pipeline_get_rows(const SwsGraph *graph, const SwsPass *pass,
+                              int job, int y, int h, SwsImg *img)
+{
+    SwsPassWindow *win;
+    int y0, y1, end;
+
+    if (!pass || !pass->fused) {
+        *img = *pass_output_img(graph, pass);
+        return;
+    }
+
+    win = &pass->windows[job];
+    y0  = y & ~(pass_row_align(pass) - 1);
+    y1  = FFMIN(FFALIGN(y + h, pass_row_align(pass)), pass->height);
+    end = win->y + win->h;
+
+    if (y0 < win->y || y0 > end) {
+        /* disjoint from the rows held, start over */
+        win->y = y0;
+        win->h = 0;
+        end = y0;
+    } else if (y0 > win->y) {
+        window_shift(win, y0 - win->y);
+    }
+
+    if (y1 > end) {
+        SwsImg in, out;
+        av_assert0(y1 - win->y <= pass->window_h);
+        pipeline_get_rows(graph, pass->input, job, end, y1 - end, &in);
+        out = window_img(win);
+        pass->run(&out, &in, end, y1 - end, pass);
+        win->h = y1 - win->y;
+    }
+
+    *img = window_img(win);
+}
+
+static int init_pipeline_consumer(SwsGraph *graph, SwsPass *pass)
+{
+    const double ratio = (double) pass->input->height / pass->height;
+    size_t row_bytes = 0;
+    int band_h, window_h = 0, align = 1;
+
+    for (const SwsPass *p = pass->input; p && p->fused; p = p->input) {
+        int linesize[4];
+        int ret = av_image_fill_linesizes(linesize, p->format, p->width);
+        if (ret < 0)
+            return ret;
+        for (int i = 0; i < 4; i++)
+            row_bytes += linesize[i];
+        align = FFMAX(align, pass_row_align(p));
+    }
+
+    band_h = PIPELINE_BAND_BYTES / FFMAX(row_bytes * ratio, 1);
+    band_h = FFALIGN(FFMAX(band_h, 16), 16);
+    band_h = FFMIN(band_h, pass->slice_h);
+
+    /* find the largest range of input rows read by a band */
+    for (int j = 0; j < pass->num_slices; j++) {
+        const int slice_y = j * pass->slice_h;
+        const int slice_end = FFMIN(slice_y + pass->slice_h, pass->height);
+        for (int y = slice_y; y < slice_end; y += band_h) {
+            int in_y, in_h;
+            pass_input_range(pass, y, FFMIN(band_h, slice_end - y), &in_y, &in_h);
+            window_h = FFMAX(window_h, in_h);
+        }
+    }
+    window_h += 2 * align;
+
+    for (SwsPass *p = (SwsPass *) pass->input; p && p->fused; p = (SwsPass *) p->input) {
+        p->window_h = FFMIN(window_h, p->height + align);
+        p->windows  = av_calloc(pass->num_slices, sizeof(*p->windows));
+        if (!p->windows)
+            return AVERROR(ENOMEM);
+        p->num_windows = pass->num_slices;
+        for (int j = 0; j < p->num_windows; j++) {
+            SwsPassWindow *win = &p->windows[j];
+            int ret = av_image_alloc(win->img.data, win->img.linesize, p->width,
+                                     p->window_h, p->format, 64);
+            if (ret < 0)
+                return ret;
+            win->img.fmt = p->format;
+        }
+    }
+
+    pass->band_h = band_h;
+    return 0;
+}
+
+/* Set up pipelined execution, or plain pass-by-pass execution if !fuse */
+static int init_pipeline(SwsGraph *graph, bool fuse)
+{
+    int ret;
+
+    /* passes writing to a destination, or read by several branches of a
+     * multi-output graph, keep their full output image */
+    for (int i = 0; i < graph->num_passes; i++) {
+        SwsPass *pass = graph->passes[i];
+        pass->fused = fuse && pass->row_local && pass->output_idx < 0 &&
+                      pass_num_consumers(graph, pass) == 1;
+    }
+
+    for (int i = 0; i < graph->num_passes; i++) {
+        SwsPass *pass = graph->passes[i];
+        if (pass->fused || !pass->input || !pass->input->fused)
+            continue;
+        ret = init_pipeline_consumer(graph, pass);
+        if (ret < 0)
+            return ret;
+    }
+
+    /* passes which are not fused need a full image for their consumers */
+    for (int i = 0; i < graph->num_passes; i++) {
+        SwsPass *pass = graph->passes[i];
+        if (pass->fused || pass->output_idx >= 0 || !pass_num_consumers(graph, pass))
+            continue;
+        ret = pass_alloc_output(pass);
+        if (ret < 0)
+            return ret;
+    }
+
     return 0;
 }
 
@@ -588,41 +1019,83 @@ static void sws_graph_worker(void *priv, int jobnr, int threadnr, int nb_jobs,
 {
     SwsGraph *graph = priv;
     const SwsPass *pass = graph->exec.pass;
-    const SwsImg *input  = pass->input ? &pass->input->output : &graph->exec.input;
-    const SwsImg *output = pass->output.fmt != AV_PIX_FMT_NONE ? &pass->output : &graph->exec.output;
+    const SwsImg *output = pass_output_img(graph, pass);
     const int slice_y = jobnr * pass->slice_h;
     const int slice_h = FFMIN(pass->slice_h, pass->height - slice_y);
 
-    pass->run(output, input, slice_y, slice_h, pass);
+    if (pass->band_h) {
+        for (int y = slice_y; y < slice_y + slice_h; y += pass->band_h) {
+            const int h = FFMIN(pass->band_h, slice_y + slice_h - y);
+            SwsImg input;
+            int in_y, in_h;
+
+            pass_input_range(pass, y, h, &in_y, &in_h);
+            pipeline_get_rows(graph, pass->input, jobnr, in_y, in_h, &input);
+            pass->run(output, &input, y, h, pass);
+        }
+    } else {
+        pass->run(output, pass_output_img(graph, pass->input), slice_y, slice_h, pass);
+    }
 }
 
-int ff_sws_graph_create(SwsContext *ctx, const SwsFormat *dst, const SwsFormat *src,
-                        int field, SwsGraph **out_graph)
+static int init_threads(SwsGraph *graph, int nb_threads)
+{
+    int ret = avpriv_slicethread_create(&graph->slicethread, (void *) graph,
+                                        sws_graph_worker, NULL, nb_threads);
+    if (ret == AVERROR(ENOSYS))
+        graph->num_threads = 1;
+    else if (ret < 0)
+        return ret;
+    else
+        graph->num_threads = ret;
+    return 0;
+}
+
+static SwsGraph *graph_alloc(SwsContext *ctx, const SwsFormat *dsts, int num_dsts,
+                             const SwsFormat *src, int field)
 {
-    int ret;
     SwsGraph *graph = av_mallocz(sizeof(*graph));
     if (!graph)
-        return AVERROR(ENOMEM);
+        return NULL;
 
     graph->ctx = ctx;
     graph->src = *src;
-    graph->dst = *dst;
+    graph->dst = dsts[0];
     graph->field = field;
     graph->opts_copy = *ctx;
 
-    graph->exec.input.fmt  = src->format;
-    graph->exec.output.fmt = dst->format;
+    graph->dsts = av_memdup(dsts, num_dsts * sizeof(*dsts));
+    graph->exec.output = av_calloc(num_dsts, sizeof(*graph->exec.output));
+    if (!graph->dsts || !graph->exec.output) {
+        ff_sws_graph_free(&graph);
+        return NULL;
+    }
+    graph->num_dsts = num_dsts;
 
-    ret = avpriv_slicethread_create(&graph->slicethread, (void *) graph,
-                                    sws_graph_worker, NULL, ctx->threads);
-    if (ret == AVERROR(ENOSYS))
-        graph->num_threads = 1;
-    else if (ret < 0)
+    graph->exec.input.fmt = src->format;
+    for (int i = 0; i < num_dsts; i++)
+        graph->exec.output[i].fmt = dsts[i].format;
+
+    return graph;
+}
+
+static int graph_create(SwsContext *ctx, const SwsFormat *dsts, int num_dsts,
+                        const SwsFormat *src, int field, SwsGraph **out_graph)
+{
+    int ret;
+    SwsGraph *graph = graph_alloc(ctx, dsts, num_dsts, src, field);
+    if (!graph)
+        return AVERROR(ENOMEM);
+
+    ret = init_threads(graph, ctx->threads);
+    if (ret < 0)
         goto error;
-    else
-        graph->num_threads = ret;
 
-    ret = init_passes(graph);
+    ret = num_dsts > 1 ? init_passes_multi(graph) : init_passes(graph);
+    if (ret < 0)
+        goto error;
+
+    ret = init_pipeline(graph, true);
     if (ret < 0)
         goto error;
 
@@ -634,6 +1107,19 @@ error:
     return ret;
 }
 
+int ff_sws_graph_create(SwsContext *ctx, const SwsFormat *dst, const SwsFormat *src,
+                        int field, SwsGraph **out_graph)
+{
+    return graph_create(ctx, dst, 1, src, field, out_graph);
+}
+
+int ff_sws_graph_create_multi(SwsContext *ctx, const SwsFormat *dsts, int num_dsts,
+                              const SwsFormat *src, SwsGraph **out_graph)
+{
+    av_assert0(num_dsts > 0);
+    return graph_create(ctx, dsts, num_dsts, src, 0, out_graph);
+}
+
 void ff_sws_graph_free(SwsGraph **pgraph)
 {
     SwsGraph *graph = *pgraph;
@@ -648,9 +1134,14 @@ void ff_sws_graph_free(SwsGraph **pgraph)
             pass->free(pass->priv);
         if (pass->output.fmt != AV_PIX_FMT_NONE)
             av_free(pass->output.data[0]);
+        for (int j = 0; j < pass->num_windows; j++)
+            av_free(pass->windows[j].img.data[0]);
+        av_free(pass->windows);
         av_free(pass);
     }
     av_free(graph->passes);
+    av_free(graph->dsts);
+    av_free(graph->exec.output);
 
     av_free(graph);
     *pgraph = NULL;
@@ -673,22 +1164,137 @@ static int opts_equal(const SwsContext *c1, const SwsContext *c2)
 
 }
 
+static bool graph_matches(const SwsGraph *graph, const SwsContext *ctx,
+                          const SwsFormat *dsts, int num_dsts,
+                          const SwsFormat *src, int field)
+{
+    if (graph->field != field || graph->num_dsts != num_dsts ||
+        !ff_fmt_equal(&graph->src, src) || !opts_equal(ctx, &graph->opts_copy))
+        return false;
+
+    for (int i = 0; i < num_dsts; i++) {
+        if (!ff_fmt_equal(&graph->dsts[i], &dsts[i]))
+            return false;
+    }
+    return true;
+}
+
+/* Removes and returns the cached graph matching the given signature, if any */
+static SwsGraph *cache_take(SwsContext *ctx, const SwsFormat *dst,
+                            const SwsFormat *src, int field)
+{
+    SwsInternal *c = sws_internal(ctx);
+    for (int i = 0; i < c->nb_graph_cache; i++) {
+        SwsGraph *graph = c->graph_cache[i];
+        if (graph_matches(graph, ctx, dst, 1, src, field)) {
+            memmove(&c->graph_cache[i], &c->graph_cache[i + 1],
+                    (c->nb_graph_cache - i - 1) * sizeof(*c->graph_cache));
+            c->nb_graph_cache--;
+
+            /* Threads are released while cached, the slice layout of the
+             * passes depends on getting the same number back */
+            if (init_threads(graph, graph->num_threads) < 0) {
+                ff_sws_graph_free(&graph);
+                return NULL;
+            }
+            return graph;
+        }
+    }
+
+    return NULL;
+}
+
+/* Inserts a graph as the most recently used entry, evicting the oldest ones */
+static void cache_put(SwsContext *ctx, SwsGraph **pgraph)
+{
+    SwsInternal *c = sws_internal(ctx);
+    const int size = av_clip(ctx->graph_cache_size, 0, SWS_MAX_GRAPH_CACHE);
+    if (!*pgraph)
+        return;
+
+    while (c->nb_graph_cache && c->nb_graph_cache >= size)
+        ff_sws_graph_free(&c->graph_cache[--c->nb_graph_cache]);
+
+    if (!size) {
+        ff_sws_graph_free(pgraph);
+        return;
+    }
+
+    /* Don't keep idle worker threads around for every cached graph */
+    avpriv_slicethread_free(&(*pgraph)->slicethread);
+
+    memmove(&c->graph_cache[1], &c->graph_cache[0],
+            c->nb_graph_cache * sizeof(*c->graph_cache));
+    c->graph_cache[0] = *pgraph;
+    c->nb_graph_cache++;
+    *pgraph = NULL;
+}
+
 int ff_sws_graph_reinit(SwsContext *ctx, const SwsFormat *dst, const SwsFormat *src,
                         int field, SwsGraph **out_graph)
 {
     SwsGraph *graph = *out_graph;
-    if (graph && ff_fmt_equal(&graph->src, src) &&
-                 ff_fmt_equal(&graph->dst, dst) &&
-                 opts_equal(ctx, &graph->opts_copy))
-    {
+    if (graph && graph_matches(graph, ctx, dst, 1, src, field)) {
         ff_sws_graph_update_metadata(graph, &src->color);
         return 0;
     }
 
-    ff_sws_graph_free(out_graph);
+    graph = cache_take(ctx, dst, src, field);
+    cache_put(ctx, out_graph);
+    if (graph) {
+        ff_sws_graph_update_metadata(graph, &src->color);
+        *out_graph = graph;
+        return 0;
+    }
+
     return ff_sws_graph_create(ctx, dst, src, field, out_graph);
 }
 
+int ff_sws_graph_reinit_multi(SwsContext *ctx, const SwsFormat *dsts, int num_dsts,
+                              const SwsFormat *src, SwsGraph **out_graph)
+{
+    SwsGraph *graph = *out_graph;
+    if (graph && graph_matches(graph, ctx, dsts, num_dsts, src, 0)) {
+        ff_sws_graph_update_metadata(graph, &src->color);
+        return 0;
+    }
+
+    ff_sws_graph_free(out_graph);
+    return ff_sws_graph_create_multi(ctx, dsts, num_dsts, src, out_graph);
+}
+
+int ff_sws_graph_prewarm(SwsContext *ctx, const SwsFormat *dst, const SwsFormat *src,
+                         int field, bool *incomplete)
+{
+    SwsInternal *c = sws_internal(ctx);
+    SwsGraph *graph = c->graph[field];
+    int ret;
+
+    if (graph && graph_matches(graph, ctx, dst, 1, src, field)) {
+        *incomplete = graph->incomplete;
+        return 0;
+    }
+
+    graph = cache_take(ctx, dst, src, field);
+    if (!graph) {
+        ret = ff_sws_graph_create(ctx, dst, src, field, &graph);
+        if (ret < 0)
+            return ret;
+    }
+
+    *incomplete = graph->incomplete;
+    cache_put(ctx, &graph);
+    return 0;
+}
+
+void ff_sws_graph_cache_free(SwsContext *ctx)
+{
+    SwsInternal *c = sws_internal(ctx);
+    for (int i = 0; i < c->nb_graph_cache; i++)
+        ff_sws_graph_free(&c->graph_cache[i]);
+    c->nb_graph_cache = 0;
+}
+
 void ff_sws_graph_update_metadata(SwsGraph *graph, const SwsColor *color)
 {
     if (!color)
@@ -697,23 +1303,47 @@ void ff_sws_graph_update_metadata(SwsGraph *graph, const SwsColor *color)
     ff_color_update_dynamic(&graph->src.color, color);
 }
 
+static void graph_run(SwsGraph *graph)
+{
+    const SwsImg *in = &graph->exec.input;
+
+    for (int i = 0; i < graph->num_passes; i++) {
+        const SwsPass *pass = graph->passes[i];
+        graph->exec.pass = pass;
+        if (pass->setup)
+            pass->setup(&graph->exec.output[FFMAX(pass->output_idx, 0)], in, pass);
+        if (pass->fused) {
+            /* computed on demand by the consumer */
+            for (int j = 0; j < pass->num_windows; j++)
+                pass->windows[j].h = 0;
+            continue;
+        }
+        avpriv_slicethread_execute(graph->slicethread, pass->num_slices, 0);
+    }
+}
+
 void ff_sws_graph_run(SwsGraph *graph, uint8_t *const out_data[4],
                       const int out_linesize[4],
                       const uint8_t *const in_data[4],
                       const int in_linesize[4])
 {
-    SwsImg *out = &graph->exec.output;
+    SwsImg *out = &graph->exec.output[0];
     SwsImg *in  = &graph->exec.input;
+    av_assert1(graph->num_dsts == 1);
     memcpy(out->data,     out_data,     sizeof(out->data));
     memcpy(out->linesize, out_linesize, sizeof(out->linesize));
     memcpy(in->data,      in_data,      sizeof(in->data));
     memcpy(in->linesize,  in_linesize,  sizeof(in->linesize));
+    graph_run(graph);
+}
 
-    for (int i = 0; i < graph->num_passes; i++) {
-        const SwsPass *pass = graph->passes[i];
-        graph->exec.pass = pass;
-        if (pass->setup)
-            pass->setup(out, in, pass);
-        avpriv_slicethread_execute(graph->slicethread, pass->num_slices, 0);
+void ff_sws_graph_run_multi(SwsGraph *graph, const SwsImg *out, const SwsImg *in)
+{
+    for (int i = 0; i < graph->num_dsts; i++) {
+        av_assert1(out[i].fmt == graph->exec.output[i].fmt);
+        graph->exec.output[i] = out[i];
     }
+    av_assert1(in->fmt == graph->exec.input.fmt);
+    graph->exec.input = *in;
+    graph_run(graph);
 }
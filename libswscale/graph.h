@@ -53,6 +53,14 @@ static av_const inline SwsImg ff_sws_img_shift(const SwsImg *base, const int y)
 typedef struct SwsPass  SwsPass;
 typedef struct SwsGraph SwsGraph;
 
+/**
+ * Band of rows of a pass output, used for pipelined execution.
+ */
+typedef struct SwsPassWindow {
+    SwsImg img; /* buffer, points to row `y` */
+    int y, h;   /* rows currently held */
+} SwsPassWindow;
+
 /**
  * Output `h` lines of filtered data. `out` and `in` point to the
  * start of the image buffer for this pass.
@@ -90,10 +98,43 @@ struct SwsPass {
      */
     SwsImg output;
 
+    /**
+     * Index of the destination image written by this pass, or -1 if it
+     * writes to its own output buffer.
+     */
+    int output_idx;
+
+    /**
+     * Set if output rows [y, y+h) only depend on the same rows of the input,
+     * and `run` keeps no state of its own, so that the pass can be run on any
+     * range of rows from any thread. Such passes are pipelined into the pass
+     * reading from them instead of being run over the full image.
+     */
+    bool row_local;
+
+    /**
+     * Range of input rows read to output rows [y, y+h). Optional, if NULL
+     * the same input rows [y, y+h) are read.
+     */
+    void (*input_range)(const SwsPass *pass, int y, int h, int *in_y, int *in_h);
+
+    /**
+     * Pipelined execution state, set up by the graph. A `fused` pass has no
+     * full output image; its rows are computed on demand, into one window of
+     * `window_h` rows per slice of the pass ultimately consuming them. That
+     * pass then runs over bands of `band_h` rows.
+     */
+    bool fused;
+    int window_h;
+    int num_windows;
+    SwsPassWindow *windows;
+    int band_h;
+
     /**
      * Called once from the main thread before running the filter. Optional.
      * `out` and `in` always point to the main image input/output, regardless
-     * of `input` and `output` fields.
+     * of `input` and `output` fields. For multi-output graphs, `out` is the
+     * destination written by the pass, or the first one.
      */
     void (*setup)(const SwsImg *out, const SwsImg *in, const SwsPass *pass);
 
@@ -125,16 +166,20 @@ typedef struct SwsGraph {
     SwsContext opts_copy;
 
     /**
-     * Currently active format and processing parameters.
+     * Currently active format and processing parameters. `dst` is the first
+     * of the `num_dsts` destinations in `dsts`, of which there is more than
+     * one for graphs created by ff_sws_graph_create_multi().
      */
     SwsFormat src, dst;
+    SwsFormat *dsts;
+    int num_dsts;
     int field;
 
     /** Temporary execution state inside ff_sws_graph_run */
     struct {
         const SwsPass *pass; /* current filter pass */
         SwsImg input;
-        SwsImg output;
+        SwsImg *output; /* one per destination */
     } exec;
 } SwsGraph;
 
@@ -145,6 +190,17 @@ int ff_sws_graph_create(SwsContext *ctx, const SwsFormat *dst, const SwsFormat *
                         int field, SwsGraph **out_graph);
 
 
+/**
+ * Allocate and initialize a filter graph converting a progressive source
+ * into `num_dsts` progressive destinations. The colour mapping passes are
+ * shared by all destinations with the same target colour space, and each
+ * destination then has its own branch of passes. With SWS_CASCADE, the
+ * branch of a destination may start from a larger destination instead.
+ * Returns 0 or a negative error.
+ */
+int ff_sws_graph_create_multi(SwsContext *ctx, const SwsFormat *dsts, int num_dsts,
+                              const SwsFormat *src, SwsGraph **out_graph);
+
 /**
  * Allocate and add a new pass to the filter graph.
  *
@@ -174,13 +230,37 @@ void ff_sws_graph_update_metadata(SwsGraph *graph, const SwsColor *color);
 
 /**
  * Wrapper around ff_sws_graph_create() that reuses the existing graph if the
- * format is compatible. This will also update dynamic per-frame metadata.
+ * format is compatible, or else a matching graph from the cache of previously
+ * used graphs, into which the existing graph is then moved. The cache is kept
+ * in the SwsContext and bounded by SwsContext.graph_cache_size. Cached graphs
+ * do not hold any threads. This will also update dynamic per-frame metadata.
  * Must be called after changing any of the fields in `ctx`, or else they will
  * have no effect.
  */
 int ff_sws_graph_reinit(SwsContext *ctx, const SwsFormat *dst, const SwsFormat *src,
                         int field, SwsGraph **graph);
 
+/**
+ * Same as ff_sws_graph_reinit() for graphs created by
+ * ff_sws_graph_create_multi(), which are not cached.
+ */
+int ff_sws_graph_reinit_multi(SwsContext *ctx, const SwsFormat *dsts, int num_dsts,
+                              const SwsFormat *src, SwsGraph **graph);
+
+/**
+ * Make sure a graph for the given formats exists, either as the currently
+ * active graph for `field` or in the cache of previously used graphs, so
+ * that a later ff_sws_graph_reinit() to these formats is cheap. Sets
+ * `incomplete` to the value of SwsGraph.incomplete for that graph.
+ */
+int ff_sws_graph_prewarm(SwsContext *ctx, const SwsFormat *dst, const SwsFormat *src,
+                         int field, bool *incomplete);
+
+/**
+ * Free all graphs held in the cache of previously used graphs.
+ */
+void ff_sws_graph_cache_free(SwsContext *ctx);
+
 /**
  * Dispatch the filter graph on a single field. Internally threaded.
  */
@@ -189,4 +269,10 @@ void ff_sws_graph_run(SwsGraph *graph, uint8_t *const out_data[4],
                       const uint8_t *const in_data[4],
                       const int in_linesize[4]);
 
+/**
+ * Dispatch a graph created by ff_sws_graph_create_multi(), with one output
+ * image per destination. Internally threaded.
+ */
+void ff_sws_graph_run_multi(SwsGraph *graph, const SwsImg *out, const SwsImg *in);
+
 #endif /* SWSCALE_GRAPH_H */
@@ -21,6 +21,7 @@
 #include <assert.h>
 #include <string.h>
 
+#include "config.h"
 #include "libavutil/attributes.h"
 #include "libavutil/avassert.h"
 #include "libavutil/mem.h"
@@ -36,6 +37,7 @@ SwsLut3D *ff_sws_lut3d_alloc(void)
         return NULL;
 
     lut3d->dynamic = false;
+    ff_sws_lut3d_init_dsp(&lut3d->dsp);
     return lut3d;
 }
 
@@ -78,48 +80,50 @@ v3u16_t barycentric(int shift, int x, int y, int z,
 }
 
 static av_always_inline
-v3u16_t tetrahedral(const SwsLut3D *lut3d, int Rx, int Gx, int Bx,
-                    int Rf, int Gf, int Bf)
+v3u16_t tetrahedral(const v3u16_t lut[][INPUT_LUT_SIZE][INPUT_LUT_SIZE],
+                    int Rx, int Gx, int Bx, int Rf, int Gf, int Bf)
 {
     const int shift = 16 - INPUT_LUT_BITS;
     const int Rn = FFMIN(Rx + 1, INPUT_LUT_SIZE - 1);
     const int Gn = FFMIN(Gx + 1, INPUT_LUT_SIZE - 1);
     const int Bn = FFMIN(Bx + 1, INPUT_LUT_SIZE - 1);
 
-    const v3u16_t c000 = lut3d->input[Bx][Gx][Rx];
-    const v3u16_t c111 = lut3d->input[Bn][Gn][Rn];
+    const v3u16_t c000 = lut[Bx][Gx][Rx];
+    const v3u16_t c111 = lut[Bn][Gn][Rn];
     if (Rf > Gf) {
         if (Gf > Bf) {
-            const v3u16_t c100 = lut3d->input[Bx][Gx][Rn];
-            const v3u16_t c110 = lut3d->input[Bx][Gn][Rn];
+            const v3u16_t c100 = lut[Bx][Gx][Rn];
+            const v3u16_t c110 = lut[Bx][Gn][Rn];
             return barycentric(shift, Rf, Gf, Bf, c000, c100, c110, c111);
         } else if (Rf > Bf) {
-            const v3u16_t c100 = lut3d->input[Bx][Gx][Rn];
-            const v3u16_t c101 = lut3d->input[Bn][Gx][Rn];
+            const v3u16_t c100 = lut[Bx][Gx][Rn];
+            const v3u16_t c101 = lut[Bn][Gx][Rn];
             return barycentric(shift, Rf, Bf, Gf, c000, c100, c101, c111);
         } else {
-            const v3u16_t c001 = lut3d->input[Bn][Gx][Rx];
-            const v3u16_t c101 = lut3d->input[Bn][Gx][Rn];
+            const v3u16_t c001 = lut[Bn][Gx][Rx];
+            const v3u16_t c101 = lut[Bn][Gx][Rn];
             return barycentric(shift, Bf, Rf, Gf, c000, c001, c101, c111);
         }
     } else {
         if (Bf > Gf) {
-            const v3u16_t c001 = lut3d->input[Bn][Gx][Rx];
-            const v3u16_t c011 = lut3d->input[Bn][Gn][Rx];
+            const v3u16_t c001 = lut[Bn][Gx][Rx];
+            const v3u16_t c011 = lut[Bn][Gn][Rx];
             return barycentric(shift, Bf, Gf, Rf, c000, c001, c011, c111);
         } else if (Bf > Rf) {
-            const v3u16_t c010 = lut3d->input[Bx][Gn][Rx];
-            const v3u16_t c011 = lut3d->input[Bn][Gn][Rx];
+            const v3u16_t c010 = lut[Bx][Gn][Rx];
+            const v3u16_t c011 = lut[Bn][Gn][Rx];
             return barycentric(shift, Gf, Bf, Rf, c000, c010, c011, c111);
         } else {
-            const v3u16_t c010 = lut3d->input[Bx][Gn][Rx];
-            const v3u16_t c110 = lut3d->input[Bx][Gn][Rn];
+            const v3u16_t c010 = lut[Bx][Gn][Rx];
+            const v3u16_t c110 = lut[Bx][Gn][Rn];
             return barycentric(shift, Gf, Rf, Bf, c000, c010, c110, c111);
         }
     }
 }
 
-static av_always_inline v3u16_t lookup_input16(const SwsLut3D *lut3d, v3u16_t rgb)
+static av_always_inline
+v3u16_t lookup_input16(const v3u16_t lut[][INPUT_LUT_SIZE][INPUT_LUT_SIZE],
+                       v3u16_t rgb)
 {
     const int shift = 16 - INPUT_LUT_BITS;
     const int Rx = rgb.x >> shift;
@@ -128,7 +132,7 @@ static av_always_inline v3u16_t lookup_input16(const SwsLut3D *lut3d, v3u16_t rg
     const int Rf = rgb.x & ((1 << shift) - 1);
     const int Gf = rgb.y & ((1 << shift) - 1);
     const int Bf = rgb.z & ((1 << shift) - 1);
-    return tetrahedral(lut3d, Rx, Gx, Bx, Rf, Gf, Bf);
+    return tetrahedral(lut, Rx, Gx, Bx, Rf, Gf, Bf);
 }
 
 /**
@@ -157,7 +161,9 @@ static av_always_inline v3u16_t lerp3u16(v3u16_t a, v3u16_t b, int x, int shift)
     };
 }
 
-static av_always_inline v3u16_t lookup_output(const SwsLut3D *lut3d, v3u16_t ipt)
+static av_always_inline
+v3u16_t lookup_output(const v3u16_t lut[][OUTPUT_LUT_SIZE_PT][OUTPUT_LUT_SIZE_I],
+                      v3u16_t ipt)
 {
     const int Ishift = 16 - OUTPUT_LUT_BITS_I;
     const int Cshift = 16 - OUTPUT_LUT_BITS_PT;
@@ -172,14 +178,14 @@ static av_always_inline v3u16_t lookup_output(const SwsLut3D *lut3d, v3u16_t ipt
     const int Tn = FFMIN(Tx + 1, OUTPUT_LUT_SIZE_PT - 1);
 
     /* Trilinear interpolation */
-    const v3u16_t c000 = lut3d->output[Tx][Px][Ix];
-    const v3u16_t c001 = lut3d->output[Tx][Px][In];
-    const v3u16_t c010 = lut3d->output[Tx][Pn][Ix];
-    const v3u16_t c011 = lut3d->output[Tx][Pn][In];
-    const v3u16_t c100 = lut3d->output[Tn][Px][Ix];
-    const v3u16_t c101 = lut3d->output[Tn][Px][In];
-    const v3u16_t c110 = lut3d->output[Tn][Pn][Ix];
-    const v3u16_t c111 = lut3d->output[Tn][Pn][In];
+    const v3u16_t c000 = lut[Tx][Px][Ix];
+    const v3u16_t c001 = lut[Tx][Px][In];
+    const v3u16_t c010 = lut[Tx][Pn][Ix];
+    const v3u16_t c011 = lut[Tx][Pn][In];
+    const v3u16_t c100 = lut[Tn][Px][Ix];
+    const v3u16_t c101 = lut[Tn][Px][In];
+    const v3u16_t c110 = lut[Tn][Pn][Ix];
+    const v3u16_t c111 = lut[Tn][Pn][In];
     const v3u16_t c00  = lerp3u16(c000, c100, Tf, Cshift);
     const v3u16_t c10  = lerp3u16(c010, c110, Tf, Cshift);
     const v3u16_t c01  = lerp3u16(c001, c101, Tf, Cshift);
@@ -190,15 +196,16 @@ static av_always_inline v3u16_t lookup_output(const SwsLut3D *lut3d, v3u16_t ipt
     return c;
 }
 
-static av_always_inline v3u16_t apply_tone_map(const SwsLut3D *lut3d, v3u16_t ipt)
+static av_always_inline
+v3u16_t apply_tone_map(const v2u16_t lut[TONE_LUT_SIZE], v3u16_t ipt)
 {
     const int shift = 16 - TONE_LUT_BITS;
     const int Ix = ipt.x >> shift;
     const int If = ipt.x & ((1 << shift) - 1);
     const int In = FFMIN(Ix + 1, TONE_LUT_SIZE - 1);
 
-    const v2u16_t w0 = lut3d->tone_map[Ix];
-    const v2u16_t w1 = lut3d->tone_map[In];
+    const v2u16_t w0 = lut[Ix];
+    const v2u16_t w1 = lut[In];
     const v2u16_t w  = lerp2u16(w0, w1, If, shift);
     const int base   = (1 << 15) - w.y;
 
@@ -208,6 +215,59 @@ static av_always_inline v3u16_t apply_tone_map(const SwsLut3D *lut3d, v3u16_t ip
     return ipt;
 }
 
+void ff_sws_lut3d_lookup_input_c(uint16_t *dst, const uint16_t *src,
+                                 const v3u16_t lut[][INPUT_LUT_SIZE][INPUT_LUT_SIZE],
+                                 int w)
+{
+    for (int x = 0; x < w; x++) {
+        v3u16_t c = { src[0], src[1], src[2] };
+        c = lookup_input16(lut, c);
+        dst[0] = c.x;
+        dst[1] = c.y;
+        dst[2] = c.z;
+        dst[3] = src[3];
+        src += 4;
+        dst += 4;
+    }
+}
+
+void ff_sws_lut3d_tone_map_c(uint16_t *buf, const v2u16_t lut[TONE_LUT_SIZE], int w)
+{
+    for (int x = 0; x < w; x++) {
+        v3u16_t c = { buf[0], buf[1], buf[2] };
+        c = apply_tone_map(lut, c);
+        buf[0] = c.x;
+        buf[1] = c.y;
+        buf[2] = c.z;
+        buf += 4;
+    }
+}
+
+void ff_sws_lut3d_lookup_output_c(uint16_t *buf,
+                                  const v3u16_t lut[][OUTPUT_LUT_SIZE_PT][OUTPUT_LUT_SIZE_I],
+                                  int w)
+{
+    for (int x = 0; x < w; x++) {
+        v3u16_t c = { buf[0], buf[1], buf[2] };
+        c = lookup_output(lut, c);
+        buf[0] = c.x;
+        buf[1] = c.y;
+        buf[2] = c.z;
+        buf += 4;
+    }
+}
+
+av_cold void ff_sws_lut3d_init_dsp(SwsLut3DDSP *dsp)
+{
+    dsp->lookup_input  = ff_sws_lut3d_lookup_input_c;
+    dsp->tone_map      = ff_sws_lut3d_tone_map_c;
+    dsp->lookup_output = ff_sws_lut3d_lookup_output_c;
+
+#if ARCH_X86
+    ff_sws_lut3d_init_dsp_x86(dsp);
+#endif
+}
+
 int ff_sws_lut3d_generate(SwsLut3D *lut3d, enum AVPixelFormat fmt_in,
                           enum AVPixelFormat fmt_out, const SwsColorMap *map)
 {
@@ -250,25 +310,16 @@ void ff_sws_lut3d_update(SwsLut3D *lut3d, const SwsColor *new_src)
 void ff_sws_lut3d_apply(const SwsLut3D *lut3d, const uint8_t *in, int in_stride,
                         uint8_t *out, int out_stride, int w, int h)
 {
+    const SwsLut3DDSP *dsp = &lut3d->dsp;
+
     while (h--) {
         const uint16_t *in16 = (const uint16_t *) in;
         uint16_t *out16 = (uint16_t *) out;
 
-        for (int x = 0; x < w; x++) {
-            v3u16_t c = { in16[0], in16[1], in16[2] };
-            c = lookup_input16(lut3d, c);
-
-            if (lut3d->dynamic) {
-                c = apply_tone_map(lut3d, c);
-                c = lookup_output(lut3d, c);
-            }
-
-            out16[0] = c.x;
-            out16[1] = c.y;
-            out16[2] = c.z;
-            out16[3] = in16[3];
-            in16  += 4;
-            out16 += 4;
+        dsp->lookup_input(out16, in16, lut3d->input, w);
+        if (lut3d->dynamic) {
+            dsp->tone_map(out16, lut3d->tone_map, w);
+            dsp->lookup_output(out16, lut3d->output, w);
         }
 
         in  += in_stride;
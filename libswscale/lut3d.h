@@ -47,9 +47,29 @@ enum {
     OUTPUT_LUT_SIZE_PT = (1 << OUTPUT_LUT_BITS_PT) + 1,
 };
 
+/**
+ * Per-row kernels operating on packed RGBA64 pixels. The LUT tables may be
+ * over-read by up to 2 bytes past their last entry.
+ */
+typedef struct SwsLut3DDSP {
+    /* Tetrahedral interpolation through the input 3DLUT, alpha is copied */
+    void (*lookup_input)(uint16_t *dst, const uint16_t *src,
+                         const v3u16_t lut[][INPUT_LUT_SIZE][INPUT_LUT_SIZE],
+                         int w);
+
+    /* Apply the split tone mapping LUT in-place, alpha is left untouched */
+    void (*tone_map)(uint16_t *buf, const v2u16_t lut[TONE_LUT_SIZE], int w);
+
+    /* Trilinear interpolation through the output LUT in-place */
+    void (*lookup_output)(uint16_t *buf,
+                          const v3u16_t lut[][OUTPUT_LUT_SIZE_PT][OUTPUT_LUT_SIZE_I],
+                          int w);
+} SwsLut3DDSP;
+
 typedef struct SwsLut3D {
     SwsColorMap map;
     bool dynamic;
+    SwsLut3DDSP dsp;
 
     /* Gamut mapping 3DLUT(s) */
     v3u16_t  input[INPUT_LUT_SIZE][INPUT_LUT_SIZE][INPUT_LUT_SIZE];
@@ -95,4 +115,16 @@ void ff_sws_lut3d_update(SwsLut3D *lut3d, const SwsColor *new_src);
 void ff_sws_lut3d_apply(const SwsLut3D *lut3d, const uint8_t *in, int in_stride,
                         uint8_t *out, int out_stride, int w, int h);
 
+void ff_sws_lut3d_init_dsp(SwsLut3DDSP *dsp);
+void ff_sws_lut3d_init_dsp_x86(SwsLut3DDSP *dsp);
+
+/* C implementations, for use by the tails of the SIMD versions */
+void ff_sws_lut3d_lookup_input_c(uint16_t *dst, const uint16_t *src,
+                                 const v3u16_t lut[][INPUT_LUT_SIZE][INPUT_LUT_SIZE],
+                                 int w);
+void ff_sws_lut3d_tone_map_c(uint16_t *buf, const v2u16_t lut[TONE_LUT_SIZE], int w);
+void ff_sws_lut3d_lookup_output_c(uint16_t *buf,
+                                  const v3u16_t lut[][OUTPUT_LUT_SIZE_PT][OUTPUT_LUT_SIZE_I],
+                                  int w);
+
 #endif /* SWSCALE_LUT3D_H */
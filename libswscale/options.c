@@ -49,6 +49,8 @@ static const AVOption swscale_options[] = {
         { "full_chroma_int", "full chroma interpolation",     0,  AV_OPT_TYPE_CONST, { .i64 = SWS_FULL_CHR_H_INT }, .flags = VE, .unit = "sws_flags" },
         { "full_chroma_inp", "full chroma input",             0,  AV_OPT_TYPE_CONST, { .i64 = SWS_FULL_CHR_H_INP }, .flags = VE, .unit = "sws_flags" },
         { "bitexact",        "bit-exact mode",                0,  AV_OPT_TYPE_CONST, { .i64 = SWS_BITEXACT       }, .flags = VE, .unit = "sws_flags" },
+        { "cascade",         "cascade downscales",            0,  AV_OPT_TYPE_CONST, { .i64 = SWS_CASCADE        }, .flags = VE, .unit = "sws_flags" },
+        { "box",             "exact area averaging",          0,  AV_OPT_TYPE_CONST, { .i64 = SWS_BOX            }, .flags = VE, .unit = "sws_flags" },
         { "error_diffusion", "error diffusion dither",        0,  AV_OPT_TYPE_CONST, { .i64 = SWS_ERROR_DIFFUSION}, .flags = VE, .unit = "sws_flags" },
 
     { "param0",          "scaler param 0", OFFSET(scaler_params[0]), AV_OPT_TYPE_DOUBLE, { .dbl = SWS_PARAM_DEFAULT  }, INT_MIN, INT_MAX, VE },
@@ -84,6 +86,8 @@ static const AVOption swscale_options[] = {
 
     { "threads",         "number of threads",             OFFSET(threads),   AV_OPT_TYPE_INT,   {.i64 = 1 }, .flags = VE, .unit = "threads", .max = INT_MAX },
         { "auto",        "automatic selection",           0,                 AV_OPT_TYPE_CONST, {.i64 = 0 }, .flags = VE, .unit = "threads" },
+    { "frame_threads",   "number of frames to scale in parallel", OFFSET(frame_threads), AV_OPT_TYPE_INT, {.i64 = 1 }, .flags = VE, .unit = "frame_threads", .max = SWS_MAX_THREADS },
+        { "auto",        "automatic selection",           0,                 AV_OPT_TYPE_CONST, {.i64 = 0 }, .flags = VE, .unit = "frame_threads" },
 
     { "intent",          "color mapping intent",        OFFSET(intent), AV_OPT_TYPE_INT,    { .i64 = SWS_INTENT_RELATIVE_COLORIMETRIC }, .flags = VE, .unit = "intent", .max = SWS_INTENT_NB - 1 },
         { "perceptual",            "perceptual tone mapping",        0, AV_OPT_TYPE_CONST,  { .i64 = SWS_INTENT_PERCEPTUAL            }, .flags = VE, .unit = "intent" },
@@ -91,6 +95,8 @@ static const AVOption swscale_options[] = {
         { "saturation",            "saturation mapping",             0, AV_OPT_TYPE_CONST,  { .i64 = SWS_INTENT_SATURATION            }, .flags = VE, .unit = "intent" },
         { "absolute_colorimetric", "absolute colorimetric clipping", 0, AV_OPT_TYPE_CONST,  { .i64 = SWS_INTENT_ABSOLUTE_COLORIMETRIC }, .flags = VE, .unit = "intent" },
 
+    { "graph_cache_size", "number of previously used scaling graphs to keep", OFFSET(graph_cache_size), AV_OPT_TYPE_INT, { .i64 = 4 }, 0, SWS_MAX_GRAPH_CACHE, VE },
+
     { NULL }
 };
 
@@ -30,8 +30,11 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
 #include "libavutil/mem_internal.h"
+#include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "config.h"
+#include "cms.h"
+#include "lut3d.h"
 #include "swscale_internal.h"
 #include "swscale.h"
 
@@ -1428,10 +1431,24 @@ static int validate_params(SwsContext *ctx)
     return 0;
 }
 
-int sws_frame_setup(SwsContext *ctx, const AVFrame *dst, const AVFrame *src)
+static void log_setup_error(SwsContext *ctx, const char *err_msg, int ret,
+                            const SwsFormat *src_fmt, const SwsFormat *dst_fmt)
+{
+    av_log(ctx, AV_LOG_ERROR, "%s (%s): fmt:%s csp:%s prim:%s trc:%s ->"
+                                      " fmt:%s csp:%s prim:%s trc:%s\n",
+           err_msg, av_err2str(ret),
+           av_get_pix_fmt_name(src_fmt->format), av_color_space_name(src_fmt->csp),
+           av_color_primaries_name(src_fmt->color.prim), av_color_transfer_name(src_fmt->color.trc),
+           av_get_pix_fmt_name(dst_fmt->format), av_color_space_name(dst_fmt->csp),
+           av_color_primaries_name(dst_fmt->color.prim), av_color_transfer_name(dst_fmt->color.trc));
+}
+
+static int frame_setup(SwsContext *ctx, const AVFrame *dst, const AVFrame *src,
+                       int prewarm)
 {
     SwsInternal *s = sws_internal(ctx);
     const char *err_msg;
+    bool incomplete;
     int ret;
 
     if (!src || !dst)
@@ -1458,35 +1475,35 @@ int sws_frame_setup(SwsContext *ctx, const AVFrame *dst, const AVFrame *src)
             goto fail;
         }
 
-        ret = ff_sws_graph_reinit(ctx, &dst_fmt, &src_fmt, field, &s->graph[field]);
+        if (prewarm) {
+            ret = ff_sws_graph_prewarm(ctx, &dst_fmt, &src_fmt, field, &incomplete);
+        } else {
+            ret = ff_sws_graph_reinit(ctx, &dst_fmt, &src_fmt, field, &s->graph[field]);
+            incomplete = ret >= 0 && s->graph[field]->incomplete;
+        }
         if (ret < 0) {
             err_msg = "Failed initializing scaling graph";
             goto fail;
         }
 
-        if (s->graph[field]->incomplete && ctx->flags & SWS_STRICT) {
+        if (incomplete && ctx->flags & SWS_STRICT) {
             err_msg = "Incomplete scaling graph";
             ret = AVERROR(EINVAL);
             goto fail;
         }
 
         if (!src_fmt.interlaced) {
-            ff_sws_graph_free(&s->graph[FIELD_BOTTOM]);
+            if (!prewarm)
+                ff_sws_graph_free(&s->graph[FIELD_BOTTOM]);
             break;
         }
 
         continue;
 
     fail:
-        av_log(ctx, AV_LOG_ERROR, "%s (%s): fmt:%s csp:%s prim:%s trc:%s ->"
-                                          " fmt:%s csp:%s prim:%s trc:%s\n",
-               err_msg, av_err2str(ret),
-               av_get_pix_fmt_name(src_fmt.format), av_color_space_name(src_fmt.csp),
-               av_color_primaries_name(src_fmt.color.prim), av_color_transfer_name(src_fmt.color.trc),
-               av_get_pix_fmt_name(dst_fmt.format), av_color_space_name(dst_fmt.csp),
-               av_color_primaries_name(dst_fmt.color.prim), av_color_transfer_name(dst_fmt.color.trc));
-
-        for (int i = 0; i < FF_ARRAY_ELEMS(s->graph); i++)
+        log_setup_error(ctx, err_msg, ret, &src_fmt, &dst_fmt);
+
+        for (int i = 0; i < FF_ARRAY_ELEMS(s->graph) && !prewarm; i++)
             ff_sws_graph_free(&s->graph[i]);
 
         return ret;
@@ -1495,6 +1512,128 @@ int sws_frame_setup(SwsContext *ctx, const AVFrame *dst, const AVFrame *src)
     return 0;
 }
 
+int sws_frame_setup(SwsContext *ctx, const AVFrame *dst, const AVFrame *src)
+{
+    return frame_setup(ctx, dst, src, 0);
+}
+
+int sws_frame_prewarm(SwsContext *ctx, const AVFrame *dst, const AVFrame *src)
+{
+    return frame_setup(ctx, dst, src, 1);
+}
+
+/* Same as frame_setup(), for all destinations of sws_scale_frames() at once */
+static int multi_setup(SwsContext *ctx, AVFrame *const *dst, int nb_dst,
+                       const AVFrame *src)
+{
+    SwsInternal *s = sws_internal(ctx);
+    const SwsFormat src_fmt = ff_fmt_from_frame(src, 0);
+    const int src_ok = ff_test_fmt(&src_fmt, 0);
+    SwsFormat *dst_fmt;
+    int ret;
+
+    if ((ret = validate_params(ctx)) < 0)
+        return ret;
+
+    dst_fmt = av_fast_realloc(s->multi_fmts, &s->multi_fmts_size,
+                              nb_dst * sizeof(*dst_fmt));
+    if (!dst_fmt)
+        return AVERROR(ENOMEM);
+    s->multi_fmts = dst_fmt;
+
+    for (int i = 0; i < nb_dst; i++) {
+        dst_fmt[i] = ff_fmt_from_frame(dst[i], 0);
+        if ((!src_ok || !ff_test_fmt(&dst_fmt[i], 1)) &&
+            !ff_props_equal(&src_fmt, &dst_fmt[i])) {
+            ret = AVERROR(ENOTSUP);
+            log_setup_error(ctx, src_ok ? "Unsupported output" : "Unsupported input",
+                            ret, &src_fmt, &dst_fmt[i]);
+            return ret;
+        }
+    }
+
+    ret = ff_sws_graph_reinit_multi(ctx, dst_fmt, nb_dst, &src_fmt, &s->graph_multi);
+    if (ret < 0) {
+        log_setup_error(ctx, "Failed initializing scaling graph", ret,
+                        &src_fmt, &dst_fmt[0]);
+        return ret;
+    }
+
+    if (s->graph_multi->incomplete && ctx->flags & SWS_STRICT) {
+        ret = AVERROR(EINVAL);
+        log_setup_error(ctx, "Incomplete scaling graph", ret, &src_fmt, &dst_fmt[0]);
+        ff_sws_graph_free(&s->graph_multi);
+        return ret;
+    }
+
+    return 0;
+}
+
+int sws_scale_frames(SwsContext *sws, AVFrame *const *dst, int nb_dst,
+                     const AVFrame *src)
+{
+    SwsInternal *c = sws_internal(sws);
+    int ret, interlaced;
+    SwsImg in, *out;
+
+    if (!src || !dst || nb_dst < 0)
+        return AVERROR(EINVAL);
+    for (int i = 0; i < nb_dst; i++) {
+        if (!dst[i])
+            return AVERROR(EINVAL);
+    }
+
+    if (c->frame_src) {
+        av_log(sws, AV_LOG_ERROR, "sws_scale_frames() cannot be used on "
+               "explicitly initialized contexts.\n");
+        return AVERROR(EINVAL);
+    }
+
+    interlaced = src->flags & AV_FRAME_FLAG_INTERLACED;
+    for (int i = 0; i < nb_dst; i++)
+        interlaced |= dst[i]->flags & AV_FRAME_FLAG_INTERLACED;
+
+    /* Fields are scaled one destination at a time */
+    if (nb_dst <= 1 || interlaced) {
+        for (int i = 0; i < nb_dst; i++) {
+            ret = sws_scale_frame(sws, dst[i], src);
+            if (ret < 0)
+                return ret;
+        }
+        return 0;
+    }
+
+    ret = multi_setup(sws, dst, nb_dst, src);
+    if (ret < 0)
+        return ret;
+
+    if (!src->data[0])
+        return 0;
+
+    out = av_fast_realloc(c->multi_imgs, &c->multi_imgs_size, nb_dst * sizeof(*out));
+    if (!out)
+        return AVERROR(ENOMEM);
+    c->multi_imgs = out;
+
+    for (int i = 0; i < nb_dst; i++) {
+        if (!dst[i]->data[0]) {
+            ret = av_frame_get_buffer(dst[i], 0);
+            if (ret < 0)
+                return ret;
+        }
+        out[i].fmt = dst[i]->format;
+        memcpy(out[i].data,     dst[i]->data,     sizeof(out[i].data));
+        memcpy(out[i].linesize, dst[i]->linesize, sizeof(out[i].linesize));
+    }
+
+    in.fmt = src->format;
+    memcpy(in.data,     src->data,     sizeof(in.data));
+    memcpy(in.linesize, src->linesize, sizeof(in.linesize));
+    ff_sws_graph_run_multi(c->graph_multi, out, &in);
+
+    return 0;
+}
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
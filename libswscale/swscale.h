@@ -155,6 +155,25 @@ typedef enum SwsFlags {
     SWS_ACCURATE_RND   = 1 << 18,
     SWS_BITEXACT       = 1 << 19,
 
+    /**
+     * Allow sws_scale_frames() to scale a destination from another, already
+     * downscaled destination instead of from the source, if that destination
+     * has the same format and is at least 1.5 times as large in both
+     * dimensions. This trades a small amount of sharpness for a large
+     * reduction in work when producing resolution ladders.
+     */
+    SWS_CASCADE        = 1 << 20,
+
+    /**
+     * Downscale by averaging each output pixel over the exact area of the
+     * source it covers, in a single pass over the source. Only used when
+     * downscaling planar formats, and otherwise treated like SWS_AREA. Any
+     * pixel format conversion is done after downscaling. Much faster than
+     * the other scalers for large ratios, such as when generating thumbnails.
+     * Chroma siting is not taken into account.
+     */
+    SWS_BOX            = 1 << 21,
+
     /**
      * Deprecated flags.
      */
@@ -239,6 +258,24 @@ typedef struct SwsContext {
      */
     int intent;
 
+    /**
+     * Maximum number of previously used scaling graphs to keep around, so
+     * that switching back to a recently seen combination of frame properties
+     * does not require reinitialization. Each cached graph holds on to its
+     * buffers and lookup tables. Does not affect the output. See also
+     * `sws_frame_prewarm()`.
+     */
+    int graph_cache_size;
+
+    /**
+     * How many frames `sws_send_frame()` may scale in parallel, or 0 for
+     * automatic selection. Each frame in flight is processed independently,
+     * and the `threads` are shared between them for slice threading. This
+     * keeps all threads busy on frames that are too small to be split into
+     * many slices.
+     */
+    int frame_threads;
+
     /* Remember to add new fields to graph.c:opts_equal() */
 } SwsContext;
 
@@ -321,6 +358,21 @@ int sws_test_frame(const AVFrame *frame, int output);
  */
 int sws_frame_setup(SwsContext *ctx, const AVFrame *dst, const AVFrame *src);
 
+/**
+ * Like `sws_frame_setup`, but without changing the currently active state.
+ * The internal state required to convert between the given frame properties
+ * is instead prepared ahead of time and kept in the graph cache, so that a
+ * later call to `sws_scale_frame` with such frames can switch to it without
+ * reinitialization. At most `SwsContext.graph_cache_size` such states are
+ * kept; prewarming more than that evicts the least recently used ones.
+ *
+ * @param ctx   The scaling context.
+ * @param dst   The destination frame to consider.
+ * @param src   The source frame to consider.
+ * @return 0 on success, a negative AVERROR code on failure.
+ */
+int sws_frame_prewarm(SwsContext *ctx, const AVFrame *dst, const AVFrame *src);
+
 /********************
  * Main scaling API *
  ********************/
@@ -355,6 +407,76 @@ int sws_is_noop(const AVFrame *dst, const AVFrame *src);
  */
 int sws_scale_frame(SwsContext *c, AVFrame *dst, const AVFrame *src);
 
+/**
+ * Scale source data from `src` into several destinations at once.
+ *
+ * The result is the same as calling `sws_scale_frame` on `src` once per
+ * destination, except that work common to several destinations is shared:
+ * all destinations are produced by a single scaling graph, in which the
+ * colour mapping of the source is done once for all destinations requiring
+ * the same color space conversion, and, if SWS_CASCADE is set, smaller
+ * destinations may be scaled from larger ones (see SWS_CASCADE). Interlaced
+ * frames are scaled one destination at a time.
+ *
+ * Destinations are processed from largest to smallest. The graph is rebuilt
+ * whenever the properties of any destination change.
+ *
+ * This function may only be used on contexts that have not been explicitly
+ * initialized with `sws_init_context()`.
+ *
+ * @param ctx    The scaling context.
+ * @param dst    Array of `nb_dst` distinct destination frames, with the same
+ *               semantics as the `dst` argument of `sws_scale_frame`.
+ * @param nb_dst Number of destination frames.
+ * @param src    The source frame.
+ * @return >= 0 on success, a negative AVERROR code on failure.
+ */
+int sws_scale_frames(SwsContext *ctx, AVFrame *const *dst, int nb_dst,
+                     const AVFrame *src);
+
+/**
+ * Submit a frame for scaling, which may be done concurrently with up to
+ * `SwsContext.frame_threads` - 1 previously submitted frames. The results
+ * are retrieved in submission order with `sws_receive_frame()`, and are
+ * the same as those of `sws_scale_frame()`.
+ *
+ * This function may only be used on contexts that have not been explicitly
+ * initialized with `sws_init_context()`, and must not be mixed with other
+ * scaling calls on the same context while frames are in flight. Option
+ * changes take effect for the frames submitted after them.
+ *
+ * @param ctx   The scaling context.
+ * @param dst   The destination frame, with the same semantics as the `dst`
+ *              argument of `sws_scale_frame`. On success, its contents are
+ *              taken over by the scaler, and it is reset.
+ * @param src   The source frame. A new reference to it is created. If NULL,
+ *              together with `dst`, this signals the end of the stream: all
+ *              frames in flight can then be retrieved with
+ *              `sws_receive_frame()`, until it returns AVERROR_EOF.
+ * @return 0 on success, AVERROR(EAGAIN) if the maximum number of frames
+ *         are in flight and one must be retrieved first, AVERROR_EOF after
+ *         the end of the stream was signalled, or another negative AVERROR
+ *         code on failure.
+ */
+int sws_send_frame(SwsContext *ctx, AVFrame *dst, const AVFrame *src);
+
+/**
+ * Retrieve the oldest frame submitted with `sws_send_frame()`.
+ *
+ * If it is still being scaled, this waits for it when the maximum number of
+ * frames are in flight or the end of the stream was signalled, and returns
+ * AVERROR(EAGAIN) otherwise.
+ *
+ * @param ctx   The scaling context.
+ * @param dst   An unreferenced frame, which is set to the scaled frame.
+ * @return 0 on success, AVERROR(EAGAIN) if no frame is available and more
+ *         must be submitted, AVERROR_EOF once all frames have been returned
+ *         after the end of the stream, after which new frames may be
+ *         submitted, or the negative AVERROR code returned by scaling the
+ *         frame, which is then dropped.
+ */
+int sws_receive_frame(SwsContext *ctx, AVFrame *dst);
+
 /*************************
  * Legacy (stateful) API *
  *************************/
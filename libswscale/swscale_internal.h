@@ -50,6 +50,7 @@
 #define MAX_FILTER_SIZE SWS_MAX_FILTER_SIZE
 
 #define SWS_MAX_THREADS 8192 /* sanity clamp */
+#define SWS_MAX_GRAPH_CACHE 32
 
 #if HAVE_BIGENDIAN
 #define ALT32_CORR (-1)
@@ -89,6 +90,9 @@ typedef struct RangeList {
 
 int ff_range_add(RangeList *r, unsigned int start, unsigned int len);
 
+/* State of sws_send_frame() and sws_receive_frame(), see frame_thread.c */
+typedef struct SwsFrameThread SwsFrameThread;
+
 typedef int (*SwsFunc)(SwsInternal *c, const uint8_t *const src[],
                        const int srcStride[], int srcSliceY, int srcSliceH,
                        uint8_t *const dst[], const int dstStride[]);
@@ -690,6 +694,21 @@ struct SwsInternal {
     int          color_conversion_warned;
 
     Half2FloatTables *h2f_tables;
+
+    /* Scaling graph of sws_scale_frames(), and its destination formats
+     * and images */
+    SwsGraph  *graph_multi;
+    SwsFormat *multi_fmts;
+    unsigned int multi_fmts_size;
+    SwsImg    *multi_imgs;
+    unsigned int multi_imgs_size;
+
+    /* Previously used scaling graphs, most recently used first */
+    SwsGraph *graph_cache[SWS_MAX_GRAPH_CACHE];
+    int    nb_graph_cache;
+
+    /* Frames in flight for sws_send_frame() and sws_receive_frame() */
+    SwsFrameThread *frame_thread;
 };
 //FIXME check init (where 0)
 
@@ -985,6 +1004,8 @@ extern const AVClass ff_sws_context_class;
 int ff_sws_init_single_context(SwsContext *sws, SwsFilter *srcFilter,
                                SwsFilter *dstFilter);
 
+void ff_sws_frame_thread_free(SwsInternal *c);
+
 /**
  * Set c->convert_unscaled to an unscaled converter if one exists for the
  * specific source and destination formats, bit depths, flags, etc.
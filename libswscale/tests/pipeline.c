@@ -0,0 +1,190 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Check that pipelined graph execution, where row-local passes are fused
+ * into their consumer, gives the same output as running every pass over
+ * the full image.
+ */
+
+#include "libswscale/graph.c"
+
+#include <stdio.h>
+
+#include "libavutil/cpu.h"
+#include "libavutil/frame.h"
+#include "libavutil/lfg.h"
+
+static const struct {
+    enum AVPixelFormat src_fmt, dst_fmt;
+    enum AVColorPrimaries src_prim, dst_prim;
+    int src_w, src_h, dst_w, dst_h;
+    int threads;
+} tests[] = {
+    /* lut3d color adaptation, slow to set up so only tested once */
+    { AV_PIX_FMT_YUV420P,  AV_PIX_FMT_YUV420P,  AVCOL_PRI_BT709, AVCOL_PRI_BT2020,
+      1920, 1080,  640,  360, 4 },
+    /* rgb0 alpha fill */
+    { AV_PIX_FMT_RGB0,     AV_PIX_FMT_YUVA420P, AVCOL_PRI_BT709, AVCOL_PRI_BT709,
+      1280,  720,  854,  480, 1 },
+    { AV_PIX_FMT_RGB0,     AV_PIX_FMT_YUVA420P, AVCOL_PRI_BT709, AVCOL_PRI_BT709,
+      1280,  720,  854,  480, 4 },
+    { AV_PIX_FMT_RGB0,     AV_PIX_FMT_YUVA444P, AVCOL_PRI_BT709, AVCOL_PRI_BT709,
+       333,  201,  500,  301, 3 },
+    /* xyz to rgb, before the scaler */
+    { AV_PIX_FMT_XYZ12LE,  AV_PIX_FMT_XYZ12LE,  AVCOL_PRI_BT709, AVCOL_PRI_BT709,
+       720,  576, 1280,  720, 1 },
+    { AV_PIX_FMT_XYZ12LE,  AV_PIX_FMT_XYZ12LE,  AVCOL_PRI_BT709, AVCOL_PRI_BT709,
+      1921, 1081,  640,  361, 4 },
+};
+
+static AVFrame *alloc_frame(enum AVPixelFormat fmt, int w, int h,
+                            enum AVColorPrimaries prim)
+{
+    AVFrame *frame = av_frame_alloc();
+    if (!frame)
+        return NULL;
+    frame->format          = fmt;
+    frame->width           = w;
+    frame->height          = h;
+    frame->color_primaries = prim;
+    frame->color_trc       = AVCOL_TRC_BT709;
+    frame->colorspace      = prim == AVCOL_PRI_BT2020 ? AVCOL_SPC_BT2020_NCL : AVCOL_SPC_BT709;
+    frame->color_range     = AVCOL_RANGE_MPEG;
+    if (av_frame_get_buffer(frame, 0) < 0)
+        av_frame_free(&frame);
+    return frame;
+}
+
+/* Same as ff_sws_graph_create(), without pipelining */
+static int graph_create_serial(SwsContext *ctx, const SwsFormat *dst,
+                               const SwsFormat *src, SwsGraph **out_graph)
+{
+    int ret;
+    SwsGraph *graph = graph_alloc(ctx, dst, 1, src, 0);
+    if (!graph)
+        return AVERROR(ENOMEM);
+
+    if ((ret = init_threads(graph, ctx->threads)) < 0 ||
+        (ret = init_passes(graph)) < 0 ||
+        (ret = init_pipeline(graph, false)) < 0) {
+        ff_sws_graph_free(&graph);
+        return ret;
+    }
+
+    *out_graph = graph;
+    return 0;
+}
+
+static int frames_equal(const AVFrame *a, const AVFrame *b)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(a->format);
+    int linesize[4];
+
+    av_image_fill_linesizes(linesize, a->format, a->width);
+    for (int p = 0; p < 4 && a->data[p]; p++) {
+        const int h = p == 1 || p == 2 ? AV_CEIL_RSHIFT(a->height, desc->log2_chroma_h)
+                                       : a->height;
+        for (int y = 0; y < h; y++) {
+            if (memcmp(a->data[p] + y * a->linesize[p],
+                       b->data[p] + y * b->linesize[p], linesize[p]))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static int run_test(int idx, AVLFG *lfg)
+{
+    AVFrame *src = NULL, *out_pipe = NULL, *out_serial = NULL;
+    SwsGraph *pipe = NULL, *serial = NULL;
+    SwsFormat src_fmt, dst_fmt;
+    int ret, num_fused = 0;
+    SwsContext *ctx = sws_alloc_context();
+    if (!ctx)
+        return AVERROR(ENOMEM);
+    ctx->threads = tests[idx].threads;
+
+    src        = alloc_frame(tests[idx].src_fmt, tests[idx].src_w, tests[idx].src_h,
+                             tests[idx].src_prim);
+    out_pipe   = alloc_frame(tests[idx].dst_fmt, tests[idx].dst_w, tests[idx].dst_h,
+                             tests[idx].dst_prim);
+    out_serial = alloc_frame(tests[idx].dst_fmt, tests[idx].dst_w, tests[idx].dst_h,
+                             tests[idx].dst_prim);
+    if (!src || !out_pipe || !out_serial) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    for (int p = 0; p < 4 && src->buf[p]; p++) {
+        for (size_t i = 0; i < src->buf[p]->size; i++)
+            src->buf[p]->data[i] = av_lfg_get(lfg);
+    }
+
+    src_fmt = ff_fmt_from_frame(src, 0);
+    dst_fmt = ff_fmt_from_frame(out_pipe, 0);
+    if ((ret = ff_sws_graph_create(ctx, &dst_fmt, &src_fmt, 0, &pipe)) < 0 ||
+        (ret = graph_create_serial(ctx, &dst_fmt, &src_fmt, &serial)) < 0)
+        goto end;
+
+    for (int i = 0; i < pipe->num_passes; i++)
+        num_fused += pipe->passes[i]->fused;
+
+    ff_sws_graph_run(pipe, out_pipe->data, out_pipe->linesize,
+                     (const uint8_t **) src->data, src->linesize);
+    ff_sws_graph_run(serial, out_serial->data, out_serial->linesize,
+                     (const uint8_t **) src->data, src->linesize);
+
+    printf("%s %dx%d -> %s %dx%d, threads %d: %d fused, %s\n",
+           av_get_pix_fmt_name(tests[idx].src_fmt), tests[idx].src_w, tests[idx].src_h,
+           av_get_pix_fmt_name(tests[idx].dst_fmt), tests[idx].dst_w, tests[idx].dst_h,
+           tests[idx].threads, num_fused,
+           frames_equal(out_pipe, out_serial) ? "identical" : "MISMATCH");
+    ret = num_fused && frames_equal(out_pipe, out_serial) ? 0 : 1;
+
+end:
+    ff_sws_graph_free(&pipe);
+    ff_sws_graph_free(&serial);
+    av_frame_free(&src);
+    av_frame_free(&out_pipe);
+    av_frame_free(&out_serial);
+    sws_free_context(&ctx);
+    return ret;
+}
+
+int main(void)
+{
+    AVLFG lfg;
+    int ret = 0;
+
+    /* The output of the legacy x86 scaling code can differ between two
+     * otherwise identical contexts, only compare the C code. */
+    av_force_cpu_flags(0);
+    av_lfg_init(&lfg, 0xdeadbeef);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        int err = run_test(i, &lfg);
+        if (err < 0) {
+            fprintf(stderr, "test %d failed: %s\n", i, av_err2str(err));
+            return 1;
+        }
+        ret |= err;
+    }
+
+    return ret;
+}
@@ -177,6 +177,7 @@ typedef struct {
 
 static const ScaleAlgorithm scale_algorithms[] = {
     { SWS_AREA,          "area averaging",                  1 /* downscale only, for upscale it is bilinear */ },
+    { SWS_BOX,           "exact area averaging",            1 /* graph pass only, area averaging otherwise */ },
     { SWS_BICUBIC,       "bicubic",                         4 },
     { SWS_BICUBLIN,      "luma bicubic / chroma bilinear", -1 },
     { SWS_BILINEAR,      "bilinear",                        2 },
@@ -236,7 +237,7 @@ static av_cold int initFilter(int16_t **outFilter, int32_t **filterPos,
             filter[i]       = fone;
             xDstInSrc      += xInc;
         }
-    } else if ((xInc <= (1 << 16) && (flags & SWS_AREA)) ||
+    } else if ((xInc <= (1 << 16) && (flags & (SWS_AREA | SWS_BOX))) ||
                (flags & SWS_FAST_BILINEAR)) { // bilinear upscale
         int i;
         int64_t xDstInSrc;
@@ -332,7 +333,7 @@ static av_cold int initFilter(int16_t **outFilter, int32_t **filterPos,
                     else
                         c = pow(c, A);
                     coeff = (c * 0.5 + 0.5) * fone;
-                } else if (flags & SWS_AREA) {
+                } else if (flags & (SWS_AREA | SWS_BOX)) {
                     int64_t d2 = d - (1 << 29);
                     if (d2 * xInc < -(1LL << (29 + 16)))
                         coeff = 1.0 * (1LL << (30 + 16));
@@ -1165,6 +1166,7 @@ av_cold int ff_sws_init_single_context(SwsContext *sws, SwsFilter *srcFilter,
 
     i = flags & (SWS_POINT         |
                  SWS_AREA          |
+                 SWS_BOX           |
                  SWS_BILINEAR      |
                  SWS_FAST_BILINEAR |
                  SWS_BICUBIC       |
@@ -2250,6 +2252,11 @@ void sws_freeContext(SwsContext *sws)
 
     for (i = 0; i < FF_ARRAY_ELEMS(c->graph); i++)
         ff_sws_graph_free(&c->graph[i]);
+    ff_sws_graph_cache_free(sws);
+    ff_sws_graph_free(&c->graph_multi);
+    av_freep(&c->multi_fmts);
+    av_freep(&c->multi_imgs);
+    ff_sws_frame_thread_free(c);
 
     for (i = 0; i < c->nb_slice_ctx; i++)
         sws_freeContext(c->slice_ctx[i]);
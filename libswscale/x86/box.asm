@@ -0,0 +1,143 @@
+;******************************************************************************
+;* x86-optimized area-average downscaling functions for swscale
+;*
+;* This file is part of Librempeg.
+;*
+;* Librempeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* Librempeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with Librempeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION .text
+
+;-----------------------------------------------------------------------------
+; void ff_sws_box_vsum{8,16}(uint32_t *acc, const uint{8,16}_t *src, int w,
+;                            int weight);
+;
+; The 32-bit products of the 16-bit pixels and weights are assembled from
+; their low and high halves.
+;-----------------------------------------------------------------------------
+%macro BOX_VSUM_INT 1 ; bits
+cglobal sws_box_vsum%1, 4, 6, 5, acc, src, w, weight, x, tmp
+    movsxdifnidn    wq, wd
+    movd            xm3, weightd
+    SPLATW          m3, xm3
+%if %1 == 8 && mmsize == 16
+    pxor            m4, m4
+%endif
+    xor             xq, xq
+    mov             tmpq, wq
+    and             tmpq, ~(mmsize/2 - 1)
+    jz .tail
+.loop:
+%if %1 == 8 && mmsize == 32
+    pmovzxbw        m0, [srcq + xq]
+%elif %1 == 8
+    movq            m0, [srcq + xq]
+    punpcklbw       m0, m4
+%else
+    movu            m0, [srcq + xq*2]
+%endif
+%if mmsize == 32
+    ; interleave the lanes, so that unpacking gives pixels in order
+    vpermq          m0, m0, q3120
+%endif
+    pmullw          m1, m0, m3
+    pmulhuw         m0, m3
+    punpckhwd       m2, m1, m0
+    punpcklwd       m1, m0
+    paddd           m1, [accq + xq*4]
+    paddd           m2, [accq + xq*4 + mmsize]
+    movu            [accq + xq*4], m1
+    movu            [accq + xq*4 + mmsize], m2
+    add             xq, mmsize/2
+    cmp             xq, tmpq
+    jl .loop
+.tail:
+    cmp             xq, wq
+    jge .end
+.tail_loop:
+%if %1 == 8
+    movzx           tmpd, byte [srcq + xq]
+%else
+    movzx           tmpd, word [srcq + xq*2]
+%endif
+    imul            tmpd, weightd
+    add             [accq + xq*4], tmpd
+    inc             xq
+    cmp             xq, wq
+    jl .tail_loop
+.end:
+    RET
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void ff_sws_box_vsumf(float *acc, const float *src, int w, float weight);
+;-----------------------------------------------------------------------------
+%macro BOX_VSUM_FLOAT 0
+%if UNIX64
+cglobal sws_box_vsumf, 3, 5, 2, acc, src, w, x, tmp
+%else
+cglobal sws_box_vsumf, 4, 6, 4, acc, src, w, weight, x, tmp
+%endif
+%if ARCH_X86_32
+    movss           xm0, weightm
+%elif WIN64
+    SWAP 0, 3
+%endif
+%if mmsize == 32
+    vbroadcastss    m0, xm0
+%else
+    shufps          m0, m0, 0
+%endif
+    movsxdifnidn    wq, wd
+    xor             xq, xq
+    mov             tmpq, wq
+    and             tmpq, ~(mmsize/4 - 1)
+    jz .tail
+.loop:
+    movu            m1, [srcq + xq*4]
+    mulps           m1, m0
+    addps           m1, [accq + xq*4]
+    movu            [accq + xq*4], m1
+    add             xq, mmsize/4
+    cmp             xq, tmpq
+    jl .loop
+.tail:
+    cmp             xq, wq
+    jge .end
+.tail_loop:
+    movss           xm1, [srcq + xq*4]
+    mulss           xm1, xm0
+    addss           xm1, [accq + xq*4]
+    movss           [accq + xq*4], xm1
+    inc             xq
+    cmp             xq, wq
+    jl .tail_loop
+.end:
+    RET
+%endmacro
+
+INIT_XMM sse2
+BOX_VSUM_INT 8
+BOX_VSUM_INT 16
+BOX_VSUM_FLOAT
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+BOX_VSUM_INT 8
+BOX_VSUM_INT 16
+BOX_VSUM_FLOAT
+%endif
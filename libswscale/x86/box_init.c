@@ -0,0 +1,46 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libswscale/box.h"
+
+#define BOX_FUNCS(opt)                                                          \
+void ff_sws_box_vsum8_##opt (uint32_t *acc, const uint8_t  *src, int w, int weight); \
+void ff_sws_box_vsum16_##opt(uint32_t *acc, const uint16_t *src, int w, int weight); \
+void ff_sws_box_vsumf_##opt (float    *acc, const float    *src, int w, float weight);
+
+BOX_FUNCS(sse2)
+BOX_FUNCS(avx2)
+
+av_cold void ff_sws_box_init_dsp_x86(SwsBoxDSP *dsp)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSE2(cpu_flags)) {
+        dsp->vsum8  = ff_sws_box_vsum8_sse2;
+        dsp->vsum16 = ff_sws_box_vsum16_sse2;
+        dsp->vsumf  = ff_sws_box_vsumf_sse2;
+    }
+    if (EXTERNAL_AVX2_FAST(cpu_flags)) {
+        dsp->vsum8  = ff_sws_box_vsum8_avx2;
+        dsp->vsum16 = ff_sws_box_vsum16_avx2;
+        dsp->vsumf  = ff_sws_box_vsumf_avx2;
+    }
+}
@@ -0,0 +1,317 @@
+;******************************************************************************
+;* x86-optimized 3DLUT functions for swscale
+;*
+;* This file is part of Librempeg.
+;*
+;* Librempeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* Librempeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with Librempeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 64
+
+; distance between neighbouring entries of the input LUT along R, G and B,
+; in units of uint16_t
+input_strides:  dd 3, 195, 12675, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+pd_ffff:        times 16 dd 0xffff
+pd_ffff0000:    times 16 dd 0xffff0000
+pd_frac_key:    times 16 dd 1023 << 4
+pd_1:           times 16 dd 1
+pd_2:           times 16 dd 2
+pd_255:         times 16 dd 255
+pd_511:         times 16 dd 511
+pd_1023:        times 16 dd 1023
+pd_1024:        times 16 dd 1024
+pd_12873:       times 16 dd 12873 ; input_strides summed, i.e. the opposite corner
+pd_32768:       times 16 dd 32768
+
+; distance between neighbouring T planes of the output LUT, in bytes
+%define OUTPUT_T_OFF (129 * 65 * 6)
+
+SECTION .text
+
+; %1: destination, %2: address, %3: mask register (AVX2 only, clobbered)
+%macro GATHERD 3
+%if mmsize == 64
+    kxnorw          k1, k1, k1
+    vpgatherdd      %1{k1}, %2
+%else
+    pcmpeqd         %3, %3
+    vpgatherdd      %1, %2, %3
+%endif
+%endmacro
+
+; %1 += (%2 - %1) * %3 >> %4, clobbers %2
+%macro LERP 4
+    psubd           %2, %1
+    pmulld          %2, %3
+    psrad           %2, %4
+    paddd           %1, %2
+%endmacro
+
+; Split the packed RGBA64 pixels at [%1] into the first two (%2) and last two
+; (%3) components of each pixel, one pixel per dword. %4-%5 are clobbered.
+%macro LOAD_PIXELS 5
+    movu            %4, [%1]
+    movu            %5, [%1 + mmsize]
+    shufps          %2, %4, %5, q2020
+    shufps          %3, %4, %5, q3131
+%endmacro
+
+; Accumulate one vertex of the tetrahedron, weighted by %2, into m12/m13/m15
+%macro TETRA_VERTEX 2-3 0 ; vertex, weight, first
+    GATHERD         m10, [lutq + %1*2], m9
+    GATHERD         m11, [lutq + %1*2 + 4], m9
+    pand            m9, m10, m14
+    psrld           m10, 16
+    pand            m11, m14
+%if %3
+    pmulld          m12, m9, %2
+    pmulld          m13, m10, %2
+    pmulld          m15, m11, %2
+%else
+    pmulld          m9, %2
+    pmulld          m10, %2
+    pmulld          m11, %2
+    paddd           m12, m9
+    paddd           m13, m10
+    paddd           m15, m11
+%endif
+%endmacro
+
+; Interpolate between two T planes of the output LUT for one (P, I) corner
+; %1-%3: output x, y, z, %4-%5: temporaries, %6: byte offset of the corner
+%macro LERP_T 6
+    GATHERD         %1, [lutq + m4*2 + %6], %2
+    GATHERD         %3, [lutq + m4*2 + %6 + 4], %2
+    GATHERD         %4, [lutq + m4*2 + %6 + OUTPUT_T_OFF], %2
+    GATHERD         %5, [lutq + m4*2 + %6 + OUTPUT_T_OFF + 4], %2
+    pand            %3, m14
+    pand            %5, m14
+    LERP            %3, %5, m2, 9
+    psrld           %2, %1, 16
+    pand            %1, m14
+    psrld           %5, %4, 16
+    pand            %4, m14
+    LERP            %1, %4, m2, 9
+    LERP            %2, %5, m2, 9
+%endmacro
+
+%macro LUT3D_FNS 0
+;-----------------------------------------------------------------------------
+; void ff_sws_lut3d_lookup_input(uint16_t *dst, const uint16_t *src,
+;                                const v3u16_t lut[][65][65], int w);
+;
+; The tetrahedron is picked by sorting the fractional parts, each tagged with
+; its axis in the low bits so that the strides for the corners can be looked
+; up with vpermd. Ties give the ambiguous corner a weight of zero, so this
+; matches the branchy C version exactly.
+;-----------------------------------------------------------------------------
+cglobal sws_lut3d_lookup_input, 4, 4, 16, dst, src, lut, w
+    movsxdifnidn    wq, wd
+    shl             wq, 3
+    add             dstq, wq
+    add             srcq, wq
+    neg             wq
+    mova            m14, [pd_ffff]
+.loop:
+    LOAD_PIXELS     srcq + wq, m2, m3, m0, m1 ; RG, BA
+    pand            m0, m2, m14             ; R
+    psrld           m1, m2, 16              ; G
+    pand            m2, m3, m14             ; B
+
+    ; index of the base vertex, in units of uint16_t
+    psrld           m4, m2, 10
+    psrld           m5, m1, 10
+    pslld           m6, m4, 6
+    paddd           m4, m6
+    paddd           m4, m5                  ; Bx * 65 + Gx
+    psrld           m5, m0, 10
+    pslld           m6, m4, 6
+    paddd           m4, m6
+    paddd           m4, m5                  ; (Bx * 65 + Gx) * 65 + Rx
+    paddd           m5, m4, m4
+    paddd           m4, m5
+
+    ; the axis tag takes 4 bits, as vpermd with zmm indexes 16 dwords
+    pslld           m0, 4
+    pslld           m1, 4
+    pslld           m2, 4
+    pand            m0, [pd_frac_key]
+    pand            m1, [pd_frac_key]
+    pand            m2, [pd_frac_key]
+    por             m1, [pd_1]
+    por             m2, [pd_2]
+    pmaxud          m5, m0, m1
+    pmaxud          m5, m2                  ; x
+    pminud          m6, m0, m1
+    pminud          m6, m2                  ; z
+    paddd           m0, m1
+    paddd           m0, m2
+    psubd           m0, m5
+    psubd           m0, m6                  ; y
+    vpermd          m1, m5, [input_strides]
+    vpermd          m2, m6, [input_strides]
+    psrld           m5, 4
+    psrld           m0, 4
+    psrld           m6, 4                   ; d = z
+    paddd           m1, m4                  ; v1 = v0 + step along x
+    paddd           m7, m4, [pd_12873]      ; v3
+    psubd           m2, m7, m2              ; v2 = v3 - step along z
+    psubd           m8, m5, m0              ; b = x - y
+    psubd           m0, m6                  ; c = y - z
+    mova            m9, [pd_1024]
+    psubd           m5, m9, m5              ; a = 1024 - x
+
+    TETRA_VERTEX    m4, m5, 1
+    TETRA_VERTEX    m1, m8
+    TETRA_VERTEX    m2, m0
+    TETRA_VERTEX    m7, m6
+
+    psrld           m12, 10
+    psrld           m13, 10
+    psrld           m15, 10
+    pslld           m13, 16
+    por             m12, m13
+    pand            m3, [pd_ffff0000]
+    por             m15, m3
+    punpckldq       m0, m12, m15
+    punpckhdq       m12, m15
+    movu            [dstq + wq], m0
+    movu            [dstq + wq + mmsize], m12
+    add             wq, mmsize * 2
+    jl .loop
+    RET
+
+;-----------------------------------------------------------------------------
+; void ff_sws_lut3d_tone_map(uint16_t *buf, const v2u16_t lut[257], int w);
+;-----------------------------------------------------------------------------
+cglobal sws_lut3d_tone_map, 3, 3, 11, buf, lut, w
+    movsxdifnidn    wq, wd
+    shl             wq, 3
+    add             bufq, wq
+    neg             wq
+    mova            m10, [pd_ffff]
+.loop:
+    LOAD_PIXELS     bufq + wq, m2, m3, m0, m1 ; IP, TA
+    pand            m0, m2, m10             ; I
+    psrld           m1, m2, 16              ; P
+    psrld           m4, m0, 8
+    pand            m0, [pd_255]
+    GATHERD         m5, [lutq + m4*4], m6
+    GATHERD         m7, [lutq + m4*4 + 4], m6
+    pand            m8, m5, m10
+    psrld           m5, 16
+    pand            m9, m7, m10
+    psrld           m7, 16
+    LERP            m8, m9, m0, 8           ; new I
+    LERP            m5, m7, m0, 8           ; desaturation
+    pand            m4, m3, m10             ; T
+    pmulld          m1, m5
+    pmulld          m4, m5
+    psrld           m1, 15
+    psrld           m4, 15
+    psubd           m1, m5
+    psubd           m4, m5
+    paddd           m1, [pd_32768]
+    paddd           m4, [pd_32768]
+
+    pslld           m1, 16
+    por             m8, m1
+    pand            m4, m10
+    pand            m3, [pd_ffff0000]
+    por             m4, m3
+    punpckldq       m0, m8, m4
+    punpckhdq       m8, m4
+    movu            [bufq + wq], m0
+    movu            [bufq + wq + mmsize], m8
+    add             wq, mmsize * 2
+    jl .loop
+    RET
+
+;-----------------------------------------------------------------------------
+; void ff_sws_lut3d_lookup_output(uint16_t *buf, const v3u16_t lut[][129][65],
+;                                 int w);
+;-----------------------------------------------------------------------------
+cglobal sws_lut3d_lookup_output, 3, 3, 16, buf, lut, w
+    movsxdifnidn    wq, wd
+    shl             wq, 3
+    add             bufq, wq
+    neg             wq
+    mova            m14, [pd_ffff]
+.loop:
+    LOAD_PIXELS     bufq + wq, m2, m3, m0, m1 ; IP, TA
+    pand            m0, m2, m14             ; I
+    psrld           m1, m2, 16              ; P
+    pand            m2, m3, m14             ; T
+
+    ; index of the base corner, in units of uint16_t
+    psrld           m4, m2, 9
+    psrld           m5, m1, 9
+    pslld           m6, m4, 7
+    paddd           m4, m6
+    paddd           m4, m5                  ; Tx * 129 + Px
+    psrld           m5, m0, 10
+    pslld           m6, m4, 6
+    paddd           m4, m6
+    paddd           m4, m5                  ; (Tx * 129 + Px) * 65 + Ix
+    paddd           m5, m4, m4
+    paddd           m4, m5
+    pand            m0, [pd_1023]
+    pand            m1, [pd_511]
+    pand            m2, [pd_511]
+
+    LERP_T          m5, m6, m7, m8, m9, 0
+    LERP_T          m8, m9, m10, m11, m12, 390
+    LERP            m5, m8, m1, 9
+    LERP            m6, m9, m1, 9
+    LERP            m7, m10, m1, 9
+    LERP_T          m8, m9, m10, m11, m12, 6
+    LERP_T          m11, m12, m13, m15, m3, 396
+    LERP            m8, m11, m1, 9
+    LERP            m9, m12, m1, 9
+    LERP            m10, m13, m1, 9
+    LERP            m5, m8, m0, 10
+    LERP            m6, m9, m0, 10
+    LERP            m7, m10, m0, 10
+
+    ; m3 was needed as a temporary, so reload the alpha channel
+    movu            m8, [bufq + wq]
+    shufps          m8, m8, [bufq + wq + mmsize], q3131
+    pslld           m6, 16
+    por             m5, m6
+    pand            m7, m14
+    pand            m8, [pd_ffff0000]
+    por             m7, m8
+    punpckldq       m8, m5, m7
+    punpckhdq       m5, m7
+    movu            [bufq + wq], m8
+    movu            [bufq + wq + mmsize], m5
+    add             wq, mmsize * 2
+    jl .loop
+    RET
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+LUT3D_FNS
+%endif
+
+%if HAVE_AVX512_EXTERNAL
+INIT_ZMM avx512
+LUT3D_FNS
+%endif
+%endif
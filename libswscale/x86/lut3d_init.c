@@ -0,0 +1,89 @@
+/*
+ * This file is part of Librempeg.
+ *
+ * Librempeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Librempeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libswscale/lut3d.h"
+
+/* The assembly only handles whole blocks, the remainder is done in C */
+#define LUT3D_FUNCS(opt, block)                                                 \
+void ff_sws_lut3d_lookup_input_##opt(uint16_t *dst, const uint16_t *src,       \
+                                     const v3u16_t lut[][INPUT_LUT_SIZE][INPUT_LUT_SIZE], \
+                                     int w);                                    \
+void ff_sws_lut3d_tone_map_##opt(uint16_t *buf, const v2u16_t lut[TONE_LUT_SIZE], \
+                                 int w);                                        \
+void ff_sws_lut3d_lookup_output_##opt(uint16_t *buf,                           \
+                                      const v3u16_t lut[][OUTPUT_LUT_SIZE_PT][OUTPUT_LUT_SIZE_I], \
+                                      int w);                                   \
+                                                                                \
+static void lookup_input_##opt(uint16_t *dst, const uint16_t *src,             \
+                               const v3u16_t lut[][INPUT_LUT_SIZE][INPUT_LUT_SIZE], \
+                               int w)                                           \
+{                                                                               \
+    const int w_simd = w & ~(block - 1);                                        \
+    if (w_simd)                                                                 \
+        ff_sws_lut3d_lookup_input_##opt(dst, src, lut, w_simd);                 \
+    if (w > w_simd)                                                             \
+        ff_sws_lut3d_lookup_input_c(dst + 4 * w_simd, src + 4 * w_simd, lut,    \
+                                    w - w_simd);                                \
+}                                                                               \
+                                                                                \
+static void tone_map_##opt(uint16_t *buf, const v2u16_t lut[TONE_LUT_SIZE], int w) \
+{                                                                               \
+    const int w_simd = w & ~(block - 1);                                        \
+    if (w_simd)                                                                 \
+        ff_sws_lut3d_tone_map_##opt(buf, lut, w_simd);                          \
+    if (w > w_simd)                                                             \
+        ff_sws_lut3d_tone_map_c(buf + 4 * w_simd, lut, w - w_simd);             \
+}                                                                               \
+                                                                                \
+static void lookup_output_##opt(uint16_t *buf,                                 \
+                                const v3u16_t lut[][OUTPUT_LUT_SIZE_PT][OUTPUT_LUT_SIZE_I], \
+                                int w)                                          \
+{                                                                               \
+    const int w_simd = w & ~(block - 1);                                        \
+    if (w_simd)                                                                 \
+        ff_sws_lut3d_lookup_output_##opt(buf, lut, w_simd);                     \
+    if (w > w_simd)                                                             \
+        ff_sws_lut3d_lookup_output_c(buf + 4 * w_simd, lut, w - w_simd);        \
+}
+
+#define LUT3D_INIT(opt) do {                                                    \
+    dsp->lookup_input  = lookup_input_##opt;                                    \
+    dsp->tone_map      = tone_map_##opt;                                        \
+    dsp->lookup_output = lookup_output_##opt;                                   \
+} while (0)
+
+#if ARCH_X86_64
+LUT3D_FUNCS(avx2, 8)
+LUT3D_FUNCS(avx512, 16)
+#endif
+
+av_cold void ff_sws_lut3d_init_dsp_x86(SwsLut3DDSP *dsp)
+{
+#if ARCH_X86_64
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_AVX2_FAST(cpu_flags) && !(cpu_flags & AV_CPU_FLAG_SLOW_GATHER))
+        LUT3D_INIT(avx2);
+    if (EXTERNAL_AVX512(cpu_flags))
+        LUT3D_INIT(avx512);
+#endif
+}
@@ -27,8 +27,12 @@ SECTION_RODATA 32
 
 minshort:      times 8 dw 0x8000
 yuv2yuvX_16_start:  times 4 dd 0x4000 - 0x40000000
+yuv2yuvX_14_start:  times 4 dd 0x1000
+yuv2yuvX_12_start:  times 4 dd 0x4000
 yuv2yuvX_10_start:  times 4 dd 0x10000
 yuv2yuvX_9_start:   times 4 dd 0x20000
+yuv2yuvX_14_upper:  times 8 dw 0x3fff
+yuv2yuvX_12_upper:  times 8 dw 0xfff
 yuv2yuvX_10_upper:  times 8 dw 0x3ff
 yuv2yuvX_9_upper:   times 8 dw 0x1ff
 pd_4:          times 4 dd 4
@@ -39,6 +43,9 @@ pd_255:        times 8 dd 255
 pw_512:        times 8 dw 512
 pw_1024:       times 8 dw 1024
 pd_65535_invf:             times 8 dd 0x37800080 ;1.0/65535.0
+pd_32767:                  times 8 dd  32767
+pd_m32768:                 times 8 dd -32768
+pq_pack_perm:              dq 0, 2, 4, 6, 1, 3, 5, 7
 pd_yuv2gbrp16_start:       times 8 dd -0x40000000
 pd_yuv2gbrp_y_start:       times 8 dd  (1 << 9)
 pd_yuv2gbrp_uv_start:      times 8 dd  ((1 << 9) - (128 << 19))
@@ -458,6 +465,262 @@ yuv2plane1_fn 16, 5, 3
 
 %undef movsx
 
+;-----------------------------------------------------------------------------
+; AVX2 and AVX-512 vertical scaling to 9 to 16-bit and float planar output,
+; in native endianness. Unlike the versions above, these are exact and write
+; nothing past the end of the row, so that the C code is not needed to finish
+; the last pixels.
+;
+; void yuv2planeX_<output_size>_<opt>(const int16_t *filter, int filterSize,
+;                                     const int16_t **src, uint8_t *dst,
+;                                     int dstW, const uint8_t *dither,
+;                                     int offset)
+;
+; void yuv2plane1_<output_size>_<opt>(const int16_t *src, uint8_t *dst,
+;                                     int dstW, const uint8_t *dither,
+;                                     int offset)
+;-----------------------------------------------------------------------------
+
+; Store the first %3 elements of m%2 to [%1], where %3 is smaller than the
+; number of %4-byte elements in m%2. %1 and %5 are clobbered.
+%macro STORE_PARTIAL 5 ; dst, src, count, element size, temporary
+%if mmsize == 64
+    mov             %5d, -1
+    bzhi            %5d, %5d, %3d
+    kmovd           k1, %5d
+%if %4 == 2
+    vmovdqu16       [%1]{k1}, m%2
+%else
+    vmovdqu32       [%1]{k1}, m%2
+%endif
+%else
+    test            %3d, 16 / %4
+    jz %%half
+    movu            [%1], xm%2
+    vextracti128    xm%2, m%2, 1
+    add             %1, 16
+%%half:
+    test            %3d, 8 / %4
+    jz %%quarter
+    movq            [%1], xm%2
+    psrldq          xm%2, 8
+    add             %1, 8
+%%quarter:
+    test            %3d, 4 / %4
+    jz %%end
+    movd            [%1], xm%2
+%if %4 == 2
+    psrldq          xm%2, 4
+    add             %1, 4
+%%end:
+    test            %3d, 1
+    jz %%done
+    pextrw          [%1], xm%2, 0
+%%done:
+%else
+%%end:
+%endif
+%endif
+%endmacro
+
+; %1: output size, %2: bits per output sample (32 for float)
+%macro yuv2planeX_hbd_fn 2
+%if %2 == 32
+cglobal yuv2planeX_%1, 5, 9, 11, filter, fltsize, src, dst, w, x, cntr, src0, src1
+%else
+cglobal yuv2planeX_%1, 5, 9, 9, filter, fltsize, src, dst, w, x, cntr, src0, src1
+%endif
+    movsxdifnidn    fltsizeq, fltsized
+    movsxdifnidn    wq, wd
+%if %2 <= 14
+%assign hbd_pixels mmsize / 2
+%assign hbd_size 2
+    vpbroadcastd    m6, [yuv2yuvX_%2_start]
+    vpbroadcastd    m7, [yuv2yuvX_%2_upper]
+%elif %2 == 16
+%assign hbd_pixels mmsize / 2
+%assign hbd_size 2
+    vpbroadcastd    m6, [yuv2yuvX_16_start]
+    vpbroadcastd    m7, [minshort]
+%if mmsize == 64
+    movu            m8, [pq_pack_perm]
+%endif
+%else
+%assign hbd_pixels mmsize / 4
+%assign hbd_size 4
+    vpbroadcastd    m6, [yuv2yuvX_16_start]
+    vpbroadcastd    m7, [pd_m32768]
+    vpbroadcastd    m8, [pd_32767]
+    vpbroadcastd    m9, [pd_yuv2gbrp_debias]
+    vpbroadcastd    m10, [pd_65535_invf]
+%endif
+    xor             xq, xq
+.pixelloop:
+    mova            m1, m6
+%if %2 <= 16
+    mova            m2, m6
+%endif
+    mov             cntrq, fltsizeq
+.filterloop:
+    ; two source rows at a time, with their coefficients in one dword
+    mov             src0q, [srcq + cntrq*8 - 16]
+    mov             src1q, [srcq + cntrq*8 - 8]
+    vpbroadcastd    m0, [filterq + cntrq*2 - 4]
+%if %2 <= 14
+    movu            m3, [src0q + xq*2]
+    movu            m4, [src1q + xq*2]
+    punpcklwd       m5, m3, m4
+    punpckhwd       m3, m4
+    pmaddwd         m5, m0
+    pmaddwd         m3, m0
+    paddd           m1, m5
+    paddd           m2, m3
+%else
+    pslld           m5, m0, 16
+    psrad           m5, 16
+    psrad           m0, 16
+    pmulld          m3, m5, [src0q + xq*4]
+    pmulld          m4, m0, [src1q + xq*4]
+    paddd           m1, m3
+    paddd           m1, m4
+%if %2 == 16
+    pmulld          m5, [src0q + xq*4 + mmsize]
+    pmulld          m0, [src1q + xq*4 + mmsize]
+    paddd           m2, m5
+    paddd           m2, m0
+%endif
+%endif
+    sub             cntrq, 2
+    jg .filterloop
+
+%if %2 <= 14
+    ; packing in-lane undoes the in-lane unpacking above
+    psrad           m1, 27 - %2
+    psrad           m2, 27 - %2
+    packusdw        m1, m2
+    pminuw          m1, m7
+%elif %2 == 16
+    psrad           m1, 15
+    psrad           m2, 15
+    packssdw        m1, m2
+%if mmsize == 64
+    vpermq          m1, m8, m1
+%else
+    vpermq          m1, m1, q3120
+%endif
+    paddw           m1, m7
+%else
+    psrad           m1, 15
+    pmaxsd          m1, m7
+    pminsd          m1, m8
+    paddd           m1, m9
+    cvtdq2ps        m1, m1
+    mulps           m1, m10
+%endif
+    sub             wq, hbd_pixels
+    jl .partial
+    movu            [dstq + xq*hbd_size], m1
+    add             xq, hbd_pixels
+    test            wq, wq
+    jg .pixelloop
+    RET
+.partial:
+    add             wq, hbd_pixels
+    lea             src0q, [dstq + xq*hbd_size]
+    STORE_PARTIAL   src0q, 1, w, hbd_size, src1
+    RET
+%endmacro
+
+%macro yuv2plane1_hbd_fn 2
+cglobal yuv2plane1_%1, 3, 5, 6, src, dst, w, x, tmp
+    movsxdifnidn    wq, wd
+%if %2 <= 14
+%assign hbd_pixels mmsize / 2
+%assign hbd_size 2
+    mov             tmpd, (1 << (14 - %2)) * 0x10001
+    movd            xm2, tmpd
+    vpbroadcastd    m2, xm2
+%elif %2 == 16
+%assign hbd_pixels mmsize / 2
+%assign hbd_size 2
+    vpbroadcastd    m2, [pd_4]
+%if mmsize == 64
+    movu            m3, [pq_pack_perm]
+%endif
+%else
+%assign hbd_pixels mmsize / 4
+%assign hbd_size 4
+    vpbroadcastd    m2, [pd_4]
+    vpbroadcastd    m3, [pd_yuv2gbrp16_upper16]
+    vpbroadcastd    m5, [pd_65535_invf]
+%endif
+    pxor            m4, m4
+    xor             xq, xq
+.loop:
+%if %2 <= 14
+    ; saturating at 32767 gives the same result as clipping afterwards
+    paddsw          m0, m2, [srcq + xq*2]
+    psraw           m0, 15 - %2
+    pmaxsw          m0, m4
+%elif %2 == 16
+    paddd           m0, m2, [srcq + xq*4]
+    paddd           m1, m2, [srcq + xq*4 + mmsize]
+    psrad           m0, 3
+    psrad           m1, 3
+    packusdw        m0, m1
+%if mmsize == 64
+    vpermq          m0, m3, m0
+%else
+    vpermq          m0, m0, q3120
+%endif
+%else
+    paddd           m0, m2, [srcq + xq*4]
+    psrad           m0, 3
+    pmaxsd          m0, m4
+    pminsd          m0, m3
+    cvtdq2ps        m0, m0
+    mulps           m0, m5
+%endif
+    sub             wq, hbd_pixels
+    jl .partial
+    movu            [dstq + xq*hbd_size], m0
+    add             xq, hbd_pixels
+    test            wq, wq
+    jg .loop
+    RET
+.partial:
+    add             wq, hbd_pixels
+    lea             tmpq, [dstq + xq*hbd_size]
+    STORE_PARTIAL   tmpq, 0, w, hbd_size, x
+    RET
+%endmacro
+
+%macro yuv2plane_hbd_fns 0
+yuv2planeX_hbd_fn 9, 9
+yuv2planeX_hbd_fn 10, 10
+yuv2planeX_hbd_fn 12, 12
+yuv2planeX_hbd_fn 14, 14
+yuv2planeX_hbd_fn 16, 16
+yuv2planeX_hbd_fn float, 32
+yuv2plane1_hbd_fn 9, 9
+yuv2plane1_hbd_fn 10, 10
+yuv2plane1_hbd_fn 12, 12
+yuv2plane1_hbd_fn 14, 14
+yuv2plane1_hbd_fn 16, 16
+yuv2plane1_hbd_fn float, 32
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+yuv2plane_hbd_fns
+%endif
+%if HAVE_AVX512_EXTERNAL
+INIT_ZMM avx512
+yuv2plane_hbd_fns
+%endif
+%endif
+
 ;-----------------------------------------------------------------------------
 ; AVX2 yuv2nv12cX implementation
 ;
@@ -273,6 +273,17 @@ VSCALEX_FUNCS(sse4);
 VSCALEX_FUNC(16, sse4);
 VSCALEX_FUNCS(avx);
 
+#define VSCALEX_HBD_FUNCS(opt) \
+    VSCALEX_FUNC(9,     opt); \
+    VSCALEX_FUNC(10,    opt); \
+    VSCALEX_FUNC(12,    opt); \
+    VSCALEX_FUNC(14,    opt); \
+    VSCALEX_FUNC(16,    opt); \
+    VSCALEX_FUNC(float, opt)
+
+VSCALEX_HBD_FUNCS(avx2);
+VSCALEX_HBD_FUNCS(avx512);
+
 #define VSCALE_FUNC(size, opt) \
 void ff_yuv2plane1_ ## size ## _ ## opt(const int16_t *src, uint8_t *dst, int dstW, \
                                         const uint8_t *dither, int offset)
@@ -286,6 +297,17 @@ VSCALE_FUNCS(sse2, sse2);
 VSCALE_FUNC(16, sse4);
 VSCALE_FUNCS(avx, avx);
 
+#define VSCALE_HBD_FUNCS(opt) \
+    VSCALE_FUNC(9,     opt); \
+    VSCALE_FUNC(10,    opt); \
+    VSCALE_FUNC(12,    opt); \
+    VSCALE_FUNC(14,    opt); \
+    VSCALE_FUNC(16,    opt); \
+    VSCALE_FUNC(float, opt)
+
+VSCALE_HBD_FUNCS(avx2);
+VSCALE_HBD_FUNCS(avx512);
+
 #define INPUT_Y_FUNC(fmt, opt) \
 void ff_ ## fmt ## ToY_  ## opt(uint8_t *dst, const uint8_t *src, \
                                 const uint8_t *unused1, const uint8_t *unused2, \
@@ -666,6 +688,29 @@ switch(c->dstBpc){ \
              break; \
     }
 
+/* 9 to 14-bit, 16-bit and float output, in native endianness */
+#define ASSIGN_VSCALE_HBD_FUNCS(opt) do { \
+    enum AVPixelFormat dst_format = c->opts.dst_format; \
+    if (dst_format == AV_PIX_FMT_GRAYF32) { \
+        c->yuv2planeX = ff_yuv2planeX_float_ ## opt; \
+        c->yuv2plane1 = ff_yuv2plane1_float_ ## opt; \
+    } else if (!isBE(dst_format) && !isSemiPlanarYUV(dst_format) && \
+               !isDataInHighBits(dst_format) && !isFloat(dst_format)) { \
+        switch (c->dstBpc) { \
+        case 9:  c->yuv2planeX = ff_yuv2planeX_9_  ## opt; \
+                 c->yuv2plane1 = ff_yuv2plane1_9_  ## opt; break; \
+        case 10: c->yuv2planeX = ff_yuv2planeX_10_ ## opt; \
+                 c->yuv2plane1 = ff_yuv2plane1_10_ ## opt; break; \
+        case 12: c->yuv2planeX = ff_yuv2planeX_12_ ## opt; \
+                 c->yuv2plane1 = ff_yuv2plane1_12_ ## opt; break; \
+        case 14: c->yuv2planeX = ff_yuv2planeX_14_ ## opt; \
+                 c->yuv2plane1 = ff_yuv2plane1_14_ ## opt; break; \
+        case 16: c->yuv2planeX = ff_yuv2planeX_16_ ## opt; \
+                 c->yuv2plane1 = ff_yuv2plane1_16_ ## opt; break; \
+        } \
+    } \
+} while (0)
+
     if (EXTERNAL_AVX2_FAST(cpu_flags) && !(cpu_flags & AV_CPU_FLAG_SLOW_GATHER)) {
         if ((c->srcBpc == 8) && (c->dstBpc <= 14)) {
             ASSIGN_AVX2_SCALE_FUNC(c->hcScale, c->hChrFilterSize);
@@ -673,6 +718,12 @@ switch(c->dstBpc){ \
         }
     }
 
+    if (EXTERNAL_AVX2_FAST(cpu_flags))
+        ASSIGN_VSCALE_HBD_FUNCS(avx2);
+
+    if (EXTERNAL_AVX512(cpu_flags))
+        ASSIGN_VSCALE_HBD_FUNCS(avx512);
+
     if (EXTERNAL_AVX2_FAST(cpu_flags)) {
         if (ARCH_X86_64)
             switch (c->opts.src_format) {
@@ -255,6 +255,9 @@ static const struct {
     #endif
     #if CONFIG_VVC_DECODER
         { "vvc_alf", checkasm_check_vvc_alf },
+        { "vvc_deblock", checkasm_check_vvc_deblock },
+        { "vvc_intra", checkasm_check_vvc_intra },
+        { "vvc_itx", checkasm_check_vvc_itx },
         { "vvc_mc",  checkasm_check_vvc_mc  },
         { "vvc_sao", checkasm_check_vvc_sao },
     #endif
@@ -293,15 +296,29 @@ static const struct {
     #if CONFIG_NLMEANS_FILTER
         { "vf_nlmeans", checkasm_check_nlmeans },
     #endif
+    #if CONFIG_PF2PF_FILTER
+        { "vf_pf2pf", checkasm_check_vf_pf2pf },
+    #endif
     #if CONFIG_THRESHOLD_FILTER
         { "vf_threshold", checkasm_check_vf_threshold },
     #endif
     #if CONFIG_SOBEL_FILTER
         { "vf_sobel", checkasm_check_vf_sobel },
     #endif
+    #if CONFIG_SSIM360_FILTER
+        { "vf_ssim360", checkasm_check_ssim360 },
+    #endif
+    #if CONFIG_VMAFMOTION_FILTER
+        { "vf_vmafmotion", checkasm_check_vmafmotion },
+    #endif
+    #if CONFIG_XPSNR_FILTER
+        { "vf_xpsnr", checkasm_check_xpsnr },
+    #endif
 #endif
 #if CONFIG_SWSCALE
+    { "sw_box", checkasm_check_sw_box },
     { "sw_gbrp", checkasm_check_sw_gbrp },
+    { "sw_lut3d", checkasm_check_sw_lut3d },
     { "sw_range_convert", checkasm_check_sw_range_convert },
     { "sw_rgb", checkasm_check_sw_rgb },
     { "sw_scale", checkasm_check_sw_scale },
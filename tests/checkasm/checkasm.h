@@ -127,9 +127,12 @@ void checkasm_check_sbrdsp(void);
 void checkasm_check_rv34dsp(void);
 void checkasm_check_rv40dsp(void);
 void checkasm_check_scene_sad(void);
+void checkasm_check_ssim360(void);
 void checkasm_check_svq1enc(void);
 void checkasm_check_synth_filter(void);
+void checkasm_check_sw_box(void);
 void checkasm_check_sw_gbrp(void);
+void checkasm_check_sw_lut3d(void);
 void checkasm_check_sw_range_convert(void);
 void checkasm_check_sw_rgb(void);
 void checkasm_check_sw_scale(void);
@@ -144,15 +147,21 @@ void checkasm_check_vf_bwdif(void);
 void checkasm_check_vf_eq(void);
 void checkasm_check_vf_gblur(void);
 void checkasm_check_vf_hflip(void);
+void checkasm_check_vf_pf2pf(void);
 void checkasm_check_vf_threshold(void);
 void checkasm_check_vf_sobel(void);
+void checkasm_check_vmafmotion(void);
 void checkasm_check_vp8dsp(void);
 void checkasm_check_vp9dsp(void);
 void checkasm_check_videodsp(void);
 void checkasm_check_vorbisdsp(void);
 void checkasm_check_vvc_alf(void);
+void checkasm_check_vvc_deblock(void);
+void checkasm_check_vvc_intra(void);
+void checkasm_check_vvc_itx(void);
 void checkasm_check_vvc_mc(void);
 void checkasm_check_vvc_sao(void);
+void checkasm_check_xpsnr(void);
 
 struct CheckasmPerf;
 
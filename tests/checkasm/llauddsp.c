@@ -57,12 +57,15 @@ static void check_scalarproduct_and_madd_int16(LLAudDSPContext *c)
         LOCAL_ALIGNED_16(int16_t, dst1, [BUF_SIZE]);
         int ref, val;
 
-        memcpy(dst0, v1, sizeof (*dst0) * BUF_SIZE);
-        memcpy(dst1, v1, sizeof (*dst1) * BUF_SIZE);
-        ref = call_ref(dst0, v2, v3, BUF_SIZE, mul);
-        val = call_new(dst1, v2, v3, BUF_SIZE, mul);
-        if (memcmp(dst0, dst1, sizeof (*dst0) * BUF_SIZE) != 0 || ref != val)
-            fail();
+        /* also an odd multiple of 16, for the widest versions */
+        for (int len = BUF_SIZE; len >= BUF_SIZE - 16; len -= 16) {
+            memcpy(dst0, v1, sizeof (*dst0) * BUF_SIZE);
+            memcpy(dst1, v1, sizeof (*dst1) * BUF_SIZE);
+            ref = call_ref(dst0, v2, v3, len, mul);
+            val = call_new(dst1, v2, v3, len, mul);
+            if (memcmp(dst0, dst1, sizeof (*dst0) * BUF_SIZE) != 0 || ref != val)
+                fail();
+        }
 
         bench_new(v1, v2, v3, BUF_SIZE, mul);
     }
@@ -92,12 +95,15 @@ static void check_scalarproduct_and_madd_int32(LLAudDSPContext *c)
         LOCAL_ALIGNED_16(int16_t, dst1, [BUF_SIZE]);
         int ref, val;
 
-        memcpy(dst0, v1, sizeof (*dst0) * BUF_SIZE);
-        memcpy(dst1, v1, sizeof (*dst1) * BUF_SIZE);
-        ref = call_ref(dst0, v2, v3, BUF_SIZE, mul);
-        val = call_new(dst1, v2, v3, BUF_SIZE, mul);
-        if (memcmp(dst0, dst1, sizeof (*dst0) * BUF_SIZE) != 0 || ref != val)
-            fail();
+        /* also an odd multiple of 16, for the widest versions */
+        for (int len = BUF_SIZE; len >= BUF_SIZE - 16; len -= 16) {
+            memcpy(dst0, v1, sizeof (*dst0) * BUF_SIZE);
+            memcpy(dst1, v1, sizeof (*dst1) * BUF_SIZE);
+            ref = call_ref(dst0, v2, v3, len, mul);
+            val = call_new(dst1, v2, v3, len, mul);
+            if (memcmp(dst0, dst1, sizeof (*dst0) * BUF_SIZE) != 0 || ref != val)
+                fail();
+        }
 
         bench_new(v1, v2, v3, BUF_SIZE, mul);
     }
@@ -0,0 +1,101 @@
+/*
+ * This file is part of Librempeg.
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem_internal.h"
+
+#include "libswscale/box.h"
+
+#include "checkasm.h"
+
+#define LARGEST_INPUT_SIZE 1920
+static const int input_sizes[] = {8, 31, 67, LARGEST_INPUT_SIZE};
+
+static void check_vsum_int(const SwsBoxDSP *dsp, int bits)
+{
+    LOCAL_ALIGNED_32(uint16_t, src,  [LARGEST_INPUT_SIZE]);
+    LOCAL_ALIGNED_32(uint32_t, acc0, [LARGEST_INPUT_SIZE]);
+    LOCAL_ALIGNED_32(uint32_t, acc1, [LARGEST_INPUT_SIZE]);
+    const int mask = (1 << bits) - 1;
+
+    declare_func(void, uint32_t *acc, const void *src, int w, int weight);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(input_sizes); i++) {
+        const int width = input_sizes[i];
+        void *func = bits == 8 ? (void *) dsp->vsum8 : (void *) dsp->vsum16;
+        if (check_func(func, "box_vsum%d_%d", bits, width)) {
+            const int weight = (i & 1) ? 0xFFFF : rnd() & 0xFFFF;
+            for (int j = 0; j < LARGEST_INPUT_SIZE; j++) {
+                if (bits == 8)
+                    ((uint8_t *) src)[j] = rnd();
+                else
+                    src[j] = rnd() & mask;
+                acc0[j] = acc1[j] = rnd() & 0xFFFF;
+            }
+            call_ref(acc0, src, width, weight);
+            call_new(acc1, src, width, weight);
+            if (memcmp(acc0, acc1, LARGEST_INPUT_SIZE * sizeof(*acc0)))
+                fail();
+            if (width == LARGEST_INPUT_SIZE)
+                bench_new(acc1, src, width, weight);
+        }
+    }
+}
+
+static void check_vsumf(const SwsBoxDSP *dsp)
+{
+    LOCAL_ALIGNED_32(float, src,  [LARGEST_INPUT_SIZE]);
+    LOCAL_ALIGNED_32(float, acc0, [LARGEST_INPUT_SIZE]);
+    LOCAL_ALIGNED_32(float, acc1, [LARGEST_INPUT_SIZE]);
+
+    declare_func(void, float *acc, const float *src, int w, float weight);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(input_sizes); i++) {
+        const int width = input_sizes[i];
+        if (check_func(dsp->vsumf, "box_vsumf_%d", width)) {
+            const float weight = 1 + (rnd() & 0xFFFF);
+            for (int j = 0; j < LARGEST_INPUT_SIZE; j++) {
+                src[j] = (rnd() & 0xFFFFFF) / (float) 0xFFFFFF;
+                acc0[j] = acc1[j] = (rnd() & 0xFFFF) / 4.0f;
+            }
+            call_ref(acc0, src, width, weight);
+            call_new(acc1, src, width, weight);
+            if (!float_near_ulp_array(acc0, acc1, 1, LARGEST_INPUT_SIZE))
+                fail();
+            if (width == LARGEST_INPUT_SIZE)
+                bench_new(acc1, src, width, weight);
+        }
+    }
+}
+
+void checkasm_check_sw_box(void)
+{
+    SwsBoxDSP dsp;
+    ff_sws_box_init_dsp(&dsp);
+
+    check_vsum_int(&dsp, 8);
+    report("vsum8");
+
+    check_vsum_int(&dsp, 16);
+    report("vsum16");
+
+    check_vsumf(&dsp);
+    report("vsumf");
+}
@@ -0,0 +1,145 @@
+/*
+ * This file is part of Librempeg.
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem_internal.h"
+
+#include "libswscale/lut3d.h"
+
+#include "checkasm.h"
+
+#define LARGEST_INPUT_SIZE 1920
+static const int input_sizes[] = {8, 31, LARGEST_INPUT_SIZE};
+
+static void randomize_buffer(uint16_t *buf, int size)
+{
+    for (int i = 0; i < size; i++)
+        buf[i] = rnd();
+}
+
+static void randomize_luts(SwsLut3D *lut3d)
+{
+    v3u16_t *input  = &lut3d->input[0][0][0];
+    v3u16_t *output = &lut3d->output[0][0][0];
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(lut3d->input) * INPUT_LUT_SIZE * INPUT_LUT_SIZE; i++)
+        input[i] = (v3u16_t) { rnd(), rnd(), rnd() };
+    for (int i = 0; i < FF_ARRAY_ELEMS(lut3d->output) * OUTPUT_LUT_SIZE_PT * OUTPUT_LUT_SIZE_I; i++)
+        output[i] = (v3u16_t) { rnd(), rnd(), rnd() };
+    for (int i = 0; i < TONE_LUT_SIZE; i++)
+        lut3d->tone_map[i] = (v2u16_t) { rnd(), rnd() % ((1 << 15) + 1) };
+}
+
+static void check_lookup_input(const SwsLut3D *lut3d)
+{
+    LOCAL_ALIGNED_32(uint16_t, src,  [LARGEST_INPUT_SIZE * 4]);
+    LOCAL_ALIGNED_32(uint16_t, dst0, [LARGEST_INPUT_SIZE * 4]);
+    LOCAL_ALIGNED_32(uint16_t, dst1, [LARGEST_INPUT_SIZE * 4]);
+
+    declare_func(void, uint16_t *dst, const uint16_t *src,
+                       const v3u16_t lut[][INPUT_LUT_SIZE][INPUT_LUT_SIZE], int w);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(input_sizes); i++) {
+        const int width = input_sizes[i];
+        if (check_func(lut3d->dsp.lookup_input, "lut3d_lookup_input_%d", width)) {
+            randomize_buffer(src, width * 4);
+            /* exercise ties between the fractional parts */
+            src[0] = src[1] = src[2] = 0;
+            src[4] = src[5] = 0x1234;
+            src[8] = src[10] = 0xFFFF;
+            memset(dst0, 0, width * 8);
+            memset(dst1, 0, width * 8);
+            call_ref(dst0, src, lut3d->input, width);
+            call_new(dst1, src, lut3d->input, width);
+            if (memcmp(dst0, dst1, width * 8))
+                fail();
+            if (width == LARGEST_INPUT_SIZE)
+                bench_new(dst1, src, lut3d->input, width);
+        }
+    }
+}
+
+static void check_tone_map(const SwsLut3D *lut3d)
+{
+    LOCAL_ALIGNED_32(uint16_t, buf0, [LARGEST_INPUT_SIZE * 4]);
+    LOCAL_ALIGNED_32(uint16_t, buf1, [LARGEST_INPUT_SIZE * 4]);
+
+    declare_func(void, uint16_t *buf, const v2u16_t lut[TONE_LUT_SIZE], int w);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(input_sizes); i++) {
+        const int width = input_sizes[i];
+        if (check_func(lut3d->dsp.tone_map, "lut3d_tone_map_%d", width)) {
+            randomize_buffer(buf0, width * 4);
+            memcpy(buf1, buf0, width * 8);
+            call_ref(buf0, lut3d->tone_map, width);
+            call_new(buf1, lut3d->tone_map, width);
+            if (memcmp(buf0, buf1, width * 8))
+                fail();
+            if (width == LARGEST_INPUT_SIZE)
+                bench_new(buf1, lut3d->tone_map, width);
+        }
+    }
+}
+
+static void check_lookup_output(const SwsLut3D *lut3d)
+{
+    LOCAL_ALIGNED_32(uint16_t, buf0, [LARGEST_INPUT_SIZE * 4]);
+    LOCAL_ALIGNED_32(uint16_t, buf1, [LARGEST_INPUT_SIZE * 4]);
+
+    declare_func(void, uint16_t *buf,
+                       const v3u16_t lut[][OUTPUT_LUT_SIZE_PT][OUTPUT_LUT_SIZE_I], int w);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(input_sizes); i++) {
+        const int width = input_sizes[i];
+        if (check_func(lut3d->dsp.lookup_output, "lut3d_lookup_output_%d", width)) {
+            randomize_buffer(buf0, width * 4);
+            buf0[0] = buf0[1] = buf0[2] = 0xFFFF;
+            memcpy(buf1, buf0, width * 8);
+            call_ref(buf0, lut3d->output, width);
+            call_new(buf1, lut3d->output, width);
+            if (memcmp(buf0, buf1, width * 8))
+                fail();
+            if (width == LARGEST_INPUT_SIZE)
+                bench_new(buf1, lut3d->output, width);
+        }
+    }
+}
+
+void checkasm_check_sw_lut3d(void)
+{
+    SwsLut3D *lut3d = ff_sws_lut3d_alloc();
+    if (!lut3d) {
+        fail();
+        return;
+    }
+
+    randomize_luts(lut3d);
+
+    check_lookup_input(lut3d);
+    report("lookup_input");
+
+    check_tone_map(lut3d);
+    report("tone_map");
+
+    check_lookup_output(lut3d);
+    report("lookup_output");
+
+    ff_sws_lut3d_free(&lut3d);
+}
@@ -279,6 +279,98 @@ static void check_yuv2yuvX(int accurate, int bit_depth, int dst_pix_format)
 #undef FILTER_SIZES
 }
 
+static void check_yuv2yuv_hbd(int dst_pix_format)
+{
+    SwsContext *sws;
+    SwsInternal *c;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(dst_pix_format);
+    const int depth = desc->comp[0].depth;
+    // 16-bit and float output is scaled from 19-bit intermediates
+    const int src_size = depth > 14 ? 4 : 2;
+    const int dst_size = depth > 8 && depth <= 16 ? 2 : 4;
+#define LARGEST_FILTER 16
+    static const int filter_sizes[] = {2, 4, 8, 16};
+#define LARGEST_INPUT_SIZE 512
+    static const int input_sizes[] = {8, 13, 24, 128, 144, 255, 512};
+    const int16_t *src[LARGEST_FILTER];
+    LOCAL_ALIGNED_32(int32_t, src_pixels, [LARGEST_FILTER * LARGEST_INPUT_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, filter_coeff, [LARGEST_FILTER]);
+    LOCAL_ALIGNED_32(uint32_t, dst0, [LARGEST_INPUT_SIZE]);
+    LOCAL_ALIGNED_32(uint32_t, dst1, [LARGEST_INPUT_SIZE]);
+    LOCAL_ALIGNED_8(uint8_t, dither, [8]);
+
+    if (src_size == 4) {
+        for (int i = 0; i < LARGEST_FILTER * LARGEST_INPUT_SIZE; i++)
+            src_pixels[i] = (int32_t) (rnd() & 0xfffff) - (1 << 18);
+    } else {
+        randomize_buffers((uint8_t *) src_pixels, LARGEST_FILTER * LARGEST_INPUT_SIZE * 2);
+    }
+    for (int i = 0; i < LARGEST_FILTER; i++)
+        src[i] = (const int16_t *) ((uint8_t *) src_pixels + i * LARGEST_INPUT_SIZE * src_size);
+    memset(dither, 0, 8);
+
+    sws = sws_alloc_context();
+    sws->dst_format = dst_pix_format;
+    if (sws_init_context(sws, NULL, NULL) < 0)
+        fail();
+
+    c = sws_internal(sws);
+    ff_sws_init_scale(c);
+    for (int isi = 0; isi < FF_ARRAY_ELEMS(input_sizes); isi++) {
+        const int dstW = input_sizes[isi];
+        {
+            declare_func(void, const int16_t *src, uint8_t *dest,
+                         int dstW, const uint8_t *dither, int offset);
+
+            if (check_func(c->yuv2plane1, "yuv2yuv1_%s_%d", desc->name, dstW)) {
+                memset(dst0, 0, LARGEST_INPUT_SIZE * sizeof(dst0[0]));
+                memset(dst1, 0, LARGEST_INPUT_SIZE * sizeof(dst1[0]));
+
+                call_ref(src[0], (uint8_t *) dst0, dstW, dither, 0);
+                call_new(src[0], (uint8_t *) dst1, dstW, dither, 0);
+                if (memcmp(dst0, dst1, dstW * dst_size)) {
+                    fail();
+                    printf("failed: yuv2yuv1_%s_%d\n", desc->name, dstW);
+                    if (dst_size == 2)
+                        show_differences_16((uint16_t *) dst0, (uint16_t *) dst1, dstW);
+                }
+                if (dstW == LARGEST_INPUT_SIZE)
+                    bench_new(src[0], (uint8_t *) dst1, dstW, dither, 0);
+            }
+        }
+
+        for (int fsi = 0; fsi < FF_ARRAY_ELEMS(filter_sizes); fsi++) {
+            const int filter_size = filter_sizes[fsi];
+            declare_func(void, const int16_t *filter, int filterSize,
+                         const int16_t **src, uint8_t *dest, int dstW,
+                         const uint8_t *dither, int offset);
+
+            for (int i = 0; i < filter_size; i++)
+                filter_coeff[i] = -((1 << 12) / (filter_size - 1));
+            filter_coeff[rnd() % filter_size] = (1 << 13) - 1;
+
+            if (check_func(c->yuv2planeX, "yuv2yuvX_%s_%d_%d", desc->name, filter_size, dstW)) {
+                memset(dst0, 0, LARGEST_INPUT_SIZE * sizeof(dst0[0]));
+                memset(dst1, 0, LARGEST_INPUT_SIZE * sizeof(dst1[0]));
+
+                call_ref(filter_coeff, filter_size, src, (uint8_t *) dst0, dstW, dither, 0);
+                call_new(filter_coeff, filter_size, src, (uint8_t *) dst1, dstW, dither, 0);
+                if (memcmp(dst0, dst1, dstW * dst_size)) {
+                    fail();
+                    printf("failed: yuv2yuvX_%s_%d_%d\n", desc->name, filter_size, dstW);
+                    if (dst_size == 2)
+                        show_differences_16((uint16_t *) dst0, (uint16_t *) dst1, dstW);
+                }
+                if (dstW == LARGEST_INPUT_SIZE)
+                    bench_new(filter_coeff, filter_size, src, (uint8_t *) dst1, dstW, dither, 0);
+            }
+        }
+    }
+    sws_freeContext(sws);
+}
+#undef LARGEST_FILTER
+#undef LARGEST_INPUT_SIZE
+
 static void check_yuv2nv12cX(int accurate)
 {
     SwsContext *sws;
@@ -359,10 +451,29 @@ static void check_hscale(void)
 #define FILTER_SIZES 6
     static const int filter_sizes[FILTER_SIZES] = { 4, 8, 12, 16, 32, 40 };
 
-#define HSCALE_PAIRS 2
+#define HSCALE_PAIRS 12
     static const int hscale_pairs[HSCALE_PAIRS][2] = {
         { 8, 14 },
         { 8, 18 },
+        { 9, 14 },
+        { 9, 18 },
+        { 10, 14 },
+        { 10, 18 },
+        { 12, 14 },
+        { 12, 18 },
+        { 14, 14 },
+        { 14, 18 },
+        { 16, 14 },
+        { 16, 18 },
+    };
+    // source formats, for the bit depth used by the C versions
+    static const enum AVPixelFormat hscale_formats[17] = {
+        [8]  = AV_PIX_FMT_YUV420P,
+        [9]  = AV_PIX_FMT_YUV420P9,
+        [10] = AV_PIX_FMT_YUV420P10,
+        [12] = AV_PIX_FMT_YUV420P12,
+        [14] = AV_PIX_FMT_YUV420P14,
+        [16] = AV_PIX_FMT_YUV420P16,
     };
 
 #define LARGEST_INPUT_SIZE 512
@@ -372,8 +483,9 @@ static void check_hscale(void)
     SwsContext *sws;
     SwsInternal *c;
 
-    // padded
-    LOCAL_ALIGNED_32(uint8_t, src, [FFALIGN(SRC_PIXELS + MAX_FILTER_WIDTH - 1, 4)]);
+    // padded, and large enough for 16-bit input
+    LOCAL_ALIGNED_32(uint16_t, src16, [FFALIGN(SRC_PIXELS + MAX_FILTER_WIDTH - 1, 4)]);
+    const uint8_t *src = (const uint8_t *)src16;
     LOCAL_ALIGNED_32(uint32_t, dst0, [SRC_PIXELS]);
     LOCAL_ALIGNED_32(uint32_t, dst1, [SRC_PIXELS]);
 
@@ -394,9 +506,14 @@ static void check_hscale(void)
         fail();
 
     c = sws_internal(sws);
-    randomize_buffers(src, SRC_PIXELS + MAX_FILTER_WIDTH - 1);
 
     for (hpi = 0; hpi < HSCALE_PAIRS; hpi++) {
+        randomize_buffers((uint8_t *)src16, 2 * (SRC_PIXELS + MAX_FILTER_WIDTH - 1));
+        if (hscale_pairs[hpi][0] > 8) {
+            for (i = 0; i < SRC_PIXELS + MAX_FILTER_WIDTH - 1; i++)
+                src16[i] &= (1 << hscale_pairs[hpi][0]) - 1;
+        }
+        sws->src_format = hscale_formats[hscale_pairs[hpi][0]];
         for (fsi = 0; fsi < FILTER_SIZES; fsi++) {
             for (dstWi = 0; dstWi < FF_ARRAY_ELEMS(input_sizes); dstWi++) {
                 width = filter_sizes[fsi];
@@ -420,12 +537,15 @@ static void check_hscale(void)
                     //   at (1<<15) - 1
                     //
                     // The coefficients sum to the 1.0 point for the hscale
-                    // functions (1 << 14).
+                    // functions (1 << 14) exactly. The x86 hscale16to* versions
+                    // used for the 9 to 16-bit pairs bias the input by 0x8000
+                    // and remove it again with unicoeff, which only matches
+                    // the C output for that sum.
 
                     for (j = 0; j < width; j++) {
                         filter[i * width + j] = -((1 << 14) / (width - 1));
                     }
-                    filter[i * width + (rnd() % width)] = ((1 << 15) - 1);
+                    filter[i * width + (rnd() % width)] = (1 << 14) + (width - 1) * ((1 << 14) / (width - 1));
                 }
 
                 for (i = 0; i < MAX_FILTER_WIDTH; i++) {
@@ -445,11 +565,11 @@ static void check_hscale(void)
                     memset(dst0, 0, SRC_PIXELS * sizeof(dst0[0]));
                     memset(dst1, 0, SRC_PIXELS * sizeof(dst1[0]));
 
-                    call_ref(NULL, (int16_t *)dst0, sws->dst_w, src, filter, filterPos, width);
-                    call_new(NULL, (int16_t *)dst1, sws->dst_w, src, filterAvx2, filterPosAvx, width);
+                    call_ref(c, (int16_t *)dst0, sws->dst_w, src, filter, filterPos, width);
+                    call_new(c, (int16_t *)dst1, sws->dst_w, src, filterAvx2, filterPosAvx, width);
                     if (memcmp(dst0, dst1, sws->dst_w * sizeof(dst0[0])))
                         fail();
-                    bench_new(NULL, (int16_t *)dst0, sws->dst_w, src, filter, filterPosAvx, width);
+                    bench_new(c, (int16_t *)dst0, sws->dst_w, src, filter, filterPosAvx, width);
                 }
             }
         }
@@ -491,6 +611,13 @@ void checkasm_check_sw_scale(void)
     check_yuv2yuvX(0, 14, AV_PIX_FMT_YUV420P14BE);
     check_yuv2yuvX(1, 14, AV_PIX_FMT_YUV420P14BE);
     report("yuv2yuvX_14BE");
+    check_yuv2yuv_hbd(AV_PIX_FMT_YUV420P9);
+    check_yuv2yuv_hbd(AV_PIX_FMT_YUV420P10);
+    check_yuv2yuv_hbd(AV_PIX_FMT_YUV420P12);
+    check_yuv2yuv_hbd(AV_PIX_FMT_YUV420P14);
+    check_yuv2yuv_hbd(AV_PIX_FMT_YUV420P16);
+    check_yuv2yuv_hbd(AV_PIX_FMT_GRAYF32);
+    report("yuv2yuv_hbd");
     check_yuv2nv12cX(0);
     check_yuv2nv12cX(1);
     report("yuv2nv12cX");
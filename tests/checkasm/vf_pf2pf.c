@@ -0,0 +1,236 @@
+/*
+ * This file is part of Librempeg.
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/mem_internal.h"
+
+#include "libavfilter/pf2pf.h"
+#include "libavfilter/vf_pf2pf_init.h"
+
+#include "checkasm.h"
+
+#define MAX_WIDTH 1920
+static const int widths[] = {1, 15, 33, 67, MAX_WIDTH};
+
+#define randomize_buffer(buf, size)          \
+    do {                                     \
+        for (int j = 0; j < size; j++)       \
+            ((uint8_t *)buf)[j] = rnd();     \
+    } while (0)
+
+/* pixel size, shuffle of the first pixel */
+static const struct {
+    int step;
+    uint8_t order[16];
+} shuffles[] = {
+    { 2, { 1, 0 } },                        /* 16-bit endian swap */
+    { 4, { 3, 2, 1, 0 } },                  /* 32-bit endian swap */
+    { 3, { 2, 1, 0 } },                     /* rgb24 <-> bgr24 */
+    { 4, { 2, 1, 0, 3 } },                  /* rgba <-> bgra */
+    { 4, { 0x80, 0, 1, 2 } },               /* rgb0 -> 0rgb */
+    { 6, { 5, 4, 3, 2, 1, 0 } },            /* rgb48le <-> bgr48be */
+    { 8, { 4, 5, 2, 3, 0, 1, 6, 7 } },      /* rgba64 <-> bgra64 */
+};
+
+static void check_shuffle(const PF2PFDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(uint8_t, src,  [MAX_WIDTH * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [MAX_WIDTH * 8]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [MAX_WIDTH * 8]);
+
+    declare_func(void, uint8_t *dst, const uint8_t *src, int len,
+                 const uint8_t *mask, int block);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(shuffles); i++) {
+        const int step = shuffles[i].step;
+        const int block = 16 % step ? 12 : 16;
+        uint8_t mask[16];
+
+        memset(mask, 0x80, sizeof(mask));
+        for (int p = 0; p < block; p += step) {
+            for (int b = 0; b < step; b++)
+                mask[p + b] = shuffles[i].order[b] & 0x80 ? 0x80 : p + shuffles[i].order[b];
+        }
+
+        for (int j = 0; j < FF_ARRAY_ELEMS(widths); j++) {
+            const int len = widths[j] * step;
+            if (check_func(dsp->shuffle, "pf2pf_shuffle_%d_%d", i, widths[j])) {
+                randomize_buffer(src, len);
+                memset(dst0, 0xAA, MAX_WIDTH * 8);
+                memset(dst1, 0xAA, MAX_WIDTH * 8);
+                call_ref(dst0, src, len, mask, block);
+                call_new(dst1, src, len, mask, block);
+                if (memcmp(dst0, dst1, MAX_WIDTH * 8))
+                    fail();
+                if (widths[j] == MAX_WIDTH)
+                    bench_new(dst1, src, len, mask, block);
+            }
+        }
+    }
+}
+
+static void check_interleave(const PF2PFDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(uint8_t, packed0, [MAX_WIDTH * 4]);
+    LOCAL_ALIGNED_32(uint8_t, packed1, [MAX_WIDTH * 4]);
+    LOCAL_ALIGNED_32(uint8_t, planes0, [4 * MAX_WIDTH]);
+    LOCAL_ALIGNED_32(uint8_t, planes1, [4 * MAX_WIDTH]);
+
+    for (int step = 2; step <= 4; step++) {
+        for (int n = 1; n <= step; n++) {
+            uint8_t mask[16];
+            uint8_t *dst0[4] = { NULL }, *dst1[4] = { NULL };
+            const uint8_t *src[4] = { NULL };
+
+            /* plane k from byte (k + 1) % step, the remaining bytes are zero */
+            memset(mask, 0x80, sizeof(mask));
+            for (int k = 0; k < n; k++) {
+                dst0[k] = planes0 + k * MAX_WIDTH;
+                dst1[k] = planes1 + k * MAX_WIDTH;
+                src[k]  = planes0 + k * MAX_WIDTH;
+            }
+
+            for (int j = 0; j < FF_ARRAY_ELEMS(widths); j++) {
+                const int w = widths[j];
+                {
+                    declare_func(void, uint8_t *const dst[4], const uint8_t *src, int w,
+                                 const uint8_t *mask, int step, int nb_planes);
+
+                    memset(mask, 0x80, sizeof(mask));
+                    for (int k = 0; k < n; k++) {
+                        for (int p = 0; p < 4; p++)
+                            mask[4 * k + p] = p * step + (k + 1) % step;
+                    }
+
+                    if (check_func(dsp->deinterleave, "pf2pf_deinterleave_%d_%d_%d", step, n, w)) {
+                        randomize_buffer(packed0, w * step);
+                        memset(planes0, 0xAA, 4 * MAX_WIDTH);
+                        memset(planes1, 0xAA, 4 * MAX_WIDTH);
+                        call_ref(dst0, packed0, w, mask, step, n);
+                        call_new(dst1, packed0, w, mask, step, n);
+                        for (int k = 0; k < n; k++) {
+                            if (memcmp(dst0[k], dst1[k], w))
+                                fail();
+                        }
+                        if (w == MAX_WIDTH)
+                            bench_new(dst1, packed0, w, mask, step, n);
+                    }
+                }
+                {
+                    declare_func(void, uint8_t *dst, const uint8_t *const src[4], int w,
+                                 const uint8_t *mask, int step, int nb_planes);
+
+                    memset(mask, 0x80, sizeof(mask));
+                    for (int k = 0; k < n; k++) {
+                        for (int p = 0; p < 4; p++)
+                            mask[p * step + (k + 1) % step] = 4 * k + p;
+                    }
+
+                    if (check_func(dsp->interleave, "pf2pf_interleave_%d_%d_%d", step, n, w)) {
+                        randomize_buffer(planes0, 4 * MAX_WIDTH);
+                        memset(packed0, 0xAA, MAX_WIDTH * 4);
+                        memset(packed1, 0xAA, MAX_WIDTH * 4);
+                        call_ref(packed0, src, w, mask, step, n);
+                        call_new(packed1, src, w, mask, step, n);
+                        if (memcmp(packed0, packed1, MAX_WIDTH * 4))
+                            fail();
+                        if (w == MAX_WIDTH)
+                            bench_new(packed1, src, w, mask, step, n);
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void check_depth(const PF2PFDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(uint16_t, src,  [MAX_WIDTH]);
+    LOCAL_ALIGNED_32(uint16_t, dst0, [MAX_WIDTH]);
+    LOCAL_ALIGNED_32(uint16_t, dst1, [MAX_WIDTH]);
+
+    for (int j = 0; j < FF_ARRAY_ELEMS(widths); j++) {
+        const int w = widths[j];
+        const int shift = 1 + rnd() % 8;
+        {
+            declare_func(void, uint16_t *dst, const uint8_t *src, int len, int shift);
+
+            if (check_func(dsp->widen, "pf2pf_widen_%d", w)) {
+                randomize_buffer(src, w);
+                memset(dst0, 0xAA, MAX_WIDTH * 2);
+                memset(dst1, 0xAA, MAX_WIDTH * 2);
+                call_ref(dst0, (const uint8_t *)src, w, shift);
+                call_new(dst1, (const uint8_t *)src, w, shift);
+                if (memcmp(dst0, dst1, MAX_WIDTH * 2))
+                    fail();
+                if (w == MAX_WIDTH)
+                    bench_new(dst1, (const uint8_t *)src, w, shift);
+            }
+        }
+        {
+            declare_func(void, uint8_t *dst, const uint16_t *src, int len, int shift);
+
+            if (check_func(dsp->narrow, "pf2pf_narrow_%d", w)) {
+                for (int i = 0; i < w; i++)
+                    src[i] = rnd() & ((256 << shift) - 1);
+                memset(dst0, 0xAA, MAX_WIDTH * 2);
+                memset(dst1, 0xAA, MAX_WIDTH * 2);
+                call_ref((uint8_t *)dst0, src, w, shift);
+                call_new((uint8_t *)dst1, src, w, shift);
+                if (memcmp(dst0, dst1, MAX_WIDTH * 2))
+                    fail();
+                if (w == MAX_WIDTH)
+                    bench_new((uint8_t *)dst1, src, w, shift);
+            }
+        }
+        {
+            const int lshift = rnd() % 8, rshift = rnd() % 8;
+
+            declare_func(void, uint16_t *dst, const uint16_t *src, int len,
+                         int lshift, int rshift);
+
+            if (check_func(dsp->shift16, "pf2pf_shift16_%d", w)) {
+                randomize_buffer(src, w * 2);
+                memset(dst0, 0xAA, MAX_WIDTH * 2);
+                memset(dst1, 0xAA, MAX_WIDTH * 2);
+                call_ref(dst0, src, w, lshift, rshift);
+                call_new(dst1, src, w, lshift, rshift);
+                if (memcmp(dst0, dst1, MAX_WIDTH * 2))
+                    fail();
+                if (w == MAX_WIDTH)
+                    bench_new(dst1, src, w, lshift, rshift);
+            }
+        }
+    }
+}
+
+void checkasm_check_vf_pf2pf(void)
+{
+    PF2PFDSPContext dsp;
+    ff_pf2pf_dsp_init(&dsp);
+
+    check_shuffle(&dsp);
+    report("shuffle");
+
+    check_interleave(&dsp);
+    report("interleave");
+
+    check_depth(&dsp);
+    report("depth");
+}
@@ -0,0 +1,93 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+
+#include "libavfilter/ssim360.h"
+#include "libavutil/mem_internal.h"
+
+#define BLOCKS 63
+#define STRIDE (BLOCKS * 4 + 32)
+
+static void check_ssim_4x4_line(const SSIM360DSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf, [STRIDE * 4]);
+    LOCAL_ALIGNED_32(uint8_t, ref, [STRIDE * 4]);
+    LOCAL_ALIGNED_16(int, sums_ref, [BLOCKS + 1], [4]);
+    LOCAL_ALIGNED_16(int, sums_new, [BLOCKS + 1], [4]);
+    declare_func(void, const uint8_t *buf, ptrdiff_t buf_stride,
+                 const uint8_t *ref, ptrdiff_t ref_stride,
+                 int (*sums)[4], int w);
+
+    for (int i = 0; i < STRIDE * 4; i++) {
+        buf[i] = rnd();
+        ref[i] = rnd();
+    }
+
+    if (check_func(dsp->ssim_4x4_line, "ssim360_4x4_line")) {
+        call_ref(buf, STRIDE, ref, STRIDE, sums_ref, BLOCKS);
+        call_new(buf, STRIDE, ref, STRIDE, sums_new, BLOCKS);
+        if (memcmp(sums_ref, sums_new, sizeof(*sums_ref) * BLOCKS))
+            fail();
+        bench_new(buf, STRIDE, ref, STRIDE, sums_new, BLOCKS);
+    }
+}
+
+static void check_ssim_end_line(const SSIM360DSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf, [STRIDE * 8]);
+    LOCAL_ALIGNED_32(uint8_t, ref, [STRIDE * 8]);
+    LOCAL_ALIGNED_16(int, sum0, [BLOCKS + 4], [4]);
+    LOCAL_ALIGNED_16(int, sum1, [BLOCKS + 4], [4]);
+    LOCAL_ALIGNED_16(float, ssim_ref, [BLOCKS + 3]);
+    LOCAL_ALIGNED_16(float, ssim_new, [BLOCKS + 3]);
+    declare_func(void, const int (*sum0)[4], const int (*sum1)[4],
+                 float *ssim, int w);
+
+    for (int i = 0; i < STRIDE * 8; i++) {
+        buf[i] = rnd();
+        ref[i] = rnd();
+    }
+    /* neighbouring blocks share pixels, so derive the sums from real data */
+    memset(sum0, 0, sizeof(*sum0) * (BLOCKS + 4));
+    memset(sum1, 0, sizeof(*sum1) * (BLOCKS + 4));
+    dsp->ssim_4x4_line(buf,              STRIDE, ref,              STRIDE, sum0, BLOCKS);
+    dsp->ssim_4x4_line(buf + 4 * STRIDE, STRIDE, ref + 4 * STRIDE, STRIDE, sum1, BLOCKS);
+
+    if (check_func(dsp->ssim_end_line, "ssim360_end_line")) {
+        call_ref((const int (*)[4])sum0, (const int (*)[4])sum1, ssim_ref, BLOCKS - 1);
+        call_new((const int (*)[4])sum0, (const int (*)[4])sum1, ssim_new, BLOCKS - 1);
+        if (!float_near_ulp_array(ssim_ref, ssim_new, 1, BLOCKS - 1))
+            fail();
+        bench_new((const int (*)[4])sum0, (const int (*)[4])sum1, ssim_new, BLOCKS - 1);
+    }
+}
+
+void checkasm_check_ssim360(void)
+{
+    SSIM360DSPContext dsp;
+
+    ff_ssim360_init(&dsp);
+
+    check_ssim_4x4_line(&dsp);
+    report("ssim_4x4_line");
+
+    check_ssim_end_line(&dsp);
+    report("ssim_end_line");
+}
@@ -0,0 +1,102 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+
+#include "libavfilter/vmaf_motion.h"
+#include "libavutil/mem_internal.h"
+
+#define WIDTH 256
+
+static void check_convolution_x(const VMAFMotionDSPContext *dsp,
+                                const uint16_t *filter)
+{
+    LOCAL_ALIGNED_32(uint16_t, src,     [WIDTH + 4]);
+    LOCAL_ALIGNED_32(uint16_t, dst_ref, [WIDTH]);
+    LOCAL_ALIGNED_32(uint16_t, dst_new, [WIDTH]);
+    declare_func(void, const uint16_t *filter, const uint16_t *src,
+                 uint16_t *dst, int w);
+
+    for (int i = 0; i < WIDTH + 4; i++)
+        src[i] = rnd() & 0x7FFF;
+    memset(dst_ref, 0, sizeof(*dst_ref) * WIDTH);
+    memset(dst_new, 0, sizeof(*dst_new) * WIDTH);
+
+    if (check_func(dsp->convolution_x, "vmafmotion_convolution_x")) {
+        /* odd width exercises the C tail */
+        call_ref(filter, src + 2, dst_ref, WIDTH - 3);
+        call_new(filter, src + 2, dst_new, WIDTH - 3);
+        if (memcmp(dst_ref, dst_new, sizeof(*dst_ref) * WIDTH))
+            fail();
+        bench_new(filter, src + 2, dst_new, WIDTH);
+    }
+}
+
+static void check_convolution_y(const VMAFMotionDSPContext *dsp,
+                                const uint16_t *filter, int bpp)
+{
+    LOCAL_ALIGNED_32(uint8_t, src, [5 * WIDTH * 2]);
+    LOCAL_ALIGNED_32(uint16_t, dst_ref, [WIDTH]);
+    LOCAL_ALIGNED_32(uint16_t, dst_new, [WIDTH]);
+    const uint8_t *rows[5];
+    declare_func(void, const uint16_t *filter, const uint8_t *const src[5],
+                 uint16_t *dst, int w);
+
+    for (int i = 0; i < 5 * WIDTH; i++) {
+        if (bpp == 10)
+            ((uint16_t *)src)[i] = rnd() & 0x3FF;
+        else
+            src[i] = rnd();
+    }
+    /* mirrored rows at the frame edges alias each other */
+    rows[0] = src + 2 * WIDTH * (bpp == 10 ? 2 : 1);
+    for (int k = 1; k < 5; k++)
+        rows[k] = src + k * WIDTH * (bpp == 10 ? 2 : 1);
+    memset(dst_ref, 0, sizeof(*dst_ref) * WIDTH);
+    memset(dst_new, 0, sizeof(*dst_new) * WIDTH);
+
+    if (check_func(dsp->convolution_y, "vmafmotion_convolution_y_%dbit", bpp)) {
+        call_ref(filter, rows, dst_ref, WIDTH - 3);
+        call_new(filter, rows, dst_new, WIDTH - 3);
+        if (memcmp(dst_ref, dst_new, sizeof(*dst_ref) * WIDTH))
+            fail();
+        bench_new(filter, rows, dst_new, WIDTH);
+    }
+}
+
+void checkasm_check_vmafmotion(void)
+{
+    static const int bpps[] = { 8, 10 };
+    uint16_t filter[5];
+    VMAFMotionDSPContext dsp;
+
+    /* the taps of the real filter sum up to 1 << 15 */
+    for (int i = 0; i < 5; i++)
+        filter[i] = rnd() % 6554;
+
+    ff_vmafmotion_init_dsp(&dsp, 8);
+    check_convolution_x(&dsp, filter);
+    report("convolution_x");
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(bpps); i++) {
+        ff_vmafmotion_init_dsp(&dsp, bpps[i]);
+        check_convolution_y(&dsp, filter, bpps[i]);
+    }
+    report("convolution_y");
+}
@@ -0,0 +1,126 @@
+/*
+ * This file is part of Librempeg
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+
+#include "libavfilter/xpsnr.h"
+#include "libavutil/mem_internal.h"
+
+#define WIDTH  64
+#define HEIGHT 32
+#define STRIDE (WIDTH + 8)
+#define BUF_SIZE (STRIDE * (HEIGHT + 4))
+
+#define randomize_buffer(buf)                        \
+    do {                                             \
+        for (int j = 0; j < BUF_SIZE; j++)           \
+            buf[j] = rnd() & 0x3FF;                  \
+    } while (0)
+
+static void check_highds(const XPSNRDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(int16_t, buf, [BUF_SIZE]);
+    declare_func(uint64_t, const int x_act, const int y_act, const int w_act,
+                 const int h_act, const int16_t *o_m0, const int o);
+
+    randomize_buffer(buf);
+
+    if (check_func(dsp->highds_func, "xpsnr_highds")) {
+        /* odd block sizes exercise the C tail */
+        uint64_t sum_ref = call_ref(2, 2, WIDTH - 4, HEIGHT - 2, buf, STRIDE);
+        uint64_t sum_new = call_new(2, 2, WIDTH - 4, HEIGHT - 2, buf, STRIDE);
+        if (sum_ref != sum_new) {
+            fprintf(stderr, "xpsnr_highds: sum mismatch: %llu != %llu\n",
+                    (unsigned long long) sum_ref, (unsigned long long) sum_new);
+            fail();
+        }
+        bench_new(2, 2, WIDTH + 2, HEIGHT + 2, buf, STRIDE);
+    }
+}
+
+static void check_diff1st(const XPSNRDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(int16_t, cur,       [BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, prev1_ref, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, prev1_new, [BUF_SIZE]);
+    declare_func(uint64_t, const uint32_t w_act, const uint32_t h_act,
+                 const int16_t *o_m0, int16_t *o_m1, const int o);
+
+    randomize_buffer(cur);
+    randomize_buffer(prev1_ref);
+    memcpy(prev1_new, prev1_ref, sizeof(*prev1_ref) * BUF_SIZE);
+
+    if (check_func(dsp->diff1st_func, "xpsnr_diff1st")) {
+        uint64_t sum_ref = call_ref(WIDTH - 6, HEIGHT, cur, prev1_ref, STRIDE);
+        uint64_t sum_new = call_new(WIDTH - 6, HEIGHT, cur, prev1_new, STRIDE);
+        if (sum_ref != sum_new ||
+            memcmp(prev1_ref, prev1_new, sizeof(*prev1_ref) * BUF_SIZE)) {
+            fprintf(stderr, "xpsnr_diff1st: mismatch: %llu != %llu\n",
+                    (unsigned long long) sum_ref, (unsigned long long) sum_new);
+            fail();
+        }
+        bench_new(WIDTH, HEIGHT, cur, prev1_new, STRIDE);
+    }
+}
+
+static void check_diff2nd(const XPSNRDSPContext *dsp)
+{
+    LOCAL_ALIGNED_32(int16_t, cur,       [BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, prev1_ref, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, prev1_new, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, prev2_ref, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, prev2_new, [BUF_SIZE]);
+    declare_func(uint64_t, const uint32_t w_act, const uint32_t h_act,
+                 const int16_t *o_m0, int16_t *o_m1, int16_t *o_m2, const int o);
+
+    randomize_buffer(cur);
+    randomize_buffer(prev1_ref);
+    randomize_buffer(prev2_ref);
+    memcpy(prev1_new, prev1_ref, sizeof(*prev1_ref) * BUF_SIZE);
+    memcpy(prev2_new, prev2_ref, sizeof(*prev2_ref) * BUF_SIZE);
+
+    if (check_func(dsp->diff2nd_func, "xpsnr_diff2nd")) {
+        uint64_t sum_ref = call_ref(WIDTH - 6, HEIGHT, cur, prev1_ref, prev2_ref, STRIDE);
+        uint64_t sum_new = call_new(WIDTH - 6, HEIGHT, cur, prev1_new, prev2_new, STRIDE);
+        if (sum_ref != sum_new ||
+            memcmp(prev1_ref, prev1_new, sizeof(*prev1_ref) * BUF_SIZE) ||
+            memcmp(prev2_ref, prev2_new, sizeof(*prev2_ref) * BUF_SIZE)) {
+            fprintf(stderr, "xpsnr_diff2nd: mismatch: %llu != %llu\n",
+                    (unsigned long long) sum_ref, (unsigned long long) sum_new);
+            fail();
+        }
+        bench_new(WIDTH, HEIGHT, cur, prev1_new, prev2_new, STRIDE);
+    }
+}
+
+void checkasm_check_xpsnr(void)
+{
+    XPSNRDSPContext dsp;
+
+    ff_xpsnr_init(&dsp);
+
+    check_highds(&dsp);
+    report("highds");
+
+    check_diff1st(&dsp);
+    report("diff1st");
+
+    check_diff2nd(&dsp);
+    report("diff2nd");
+}
@@ -0,0 +1,149 @@
+/*
+ * This file is part of Librempeg.
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/intreadwrite.h"
+#include "libavutil/macros.h"
+#include "libavutil/mem_internal.h"
+
+#include "libavcodec/vvc/dsp.h"
+
+#include "checkasm.h"
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define BUF_LINES    32
+#define BUF_STRIDE   (BUF_LINES * 2)
+#define BUF_SIZE     (BUF_STRIDE * BUF_LINES)
+#define BUF_OFFSET   (BUF_LINES / 2 * BUF_STRIDE + BUF_LINES / 2 * SIZEOF_PIXEL)
+#define ITERATIONS   64
+
+/* the max filter lengths derived by the decoder */
+static const uint8_t luma_max_len[][2] = {
+    { 1, 1 }, { 2, 2 }, { 3, 3 }, { 3, 5 }, { 3, 7 }, { 5, 3 },
+    { 5, 5 }, { 5, 7 }, { 7, 3 }, { 7, 5 }, { 7, 7 },
+};
+
+static const uint8_t chroma_max_len[][2] = {
+    { 3, 3 }, { 1, 3 }, { 0, 0 }, { 1, 1 },
+};
+
+// smooth areas with a step at the edge, so that all the filters are taken
+static void randomize_buffers(uint8_t *buf0, uint8_t *buf1, int vertical, int bit_depth)
+{
+    const int pixel_max = (1 << bit_depth) - 1;
+    const int base      = rnd() & pixel_max;
+    const int step      = ((int)(rnd() % 64) - 32) << (bit_depth - 8);
+    const int noise     = (rnd() % 8 + 1) << (bit_depth - 8);
+
+    for (int y = 0; y < BUF_LINES; y++) {
+        for (int x = 0; x < BUF_LINES; x++) {
+            const int pos = vertical ? x : y;
+            int v = base + (pos >= BUF_LINES / 2 ? step : 0) + rnd() % noise - noise / 2;
+
+            if (!(rnd() % 64))
+                v = rnd();
+            v = av_clip(v, 0, pixel_max);
+            if (bit_depth > 8)
+                AV_WN16A(buf0 + y * BUF_STRIDE + x * 2, v);
+            else
+                buf0[y * BUF_STRIDE + x] = v;
+        }
+    }
+    memcpy(buf1, buf0, BUF_SIZE);
+}
+
+static void randomize_params(int32_t *beta, int32_t *tc, uint8_t *no_p, uint8_t *no_q,
+    uint8_t *max_len_p, uint8_t *max_len_q, const uint8_t (*max_len)[2], int nb_max_len)
+{
+    for (int i = 0; i < 4; i++) {
+        const int idx = rnd() % nb_max_len;
+
+        // see TC_CALC and betatable[] in vvc/filter.c
+        tc[i]        = rnd() & 3 ? rnd() % 396 : rnd() % 8;
+        beta[i]      = rnd() % 89;
+        no_p[i]      = !(rnd() & 7);
+        no_q[i]      = !(rnd() & 7);
+        max_len_p[i] = max_len[idx][0];
+        max_len_q[i] = max_len[idx][1];
+        if (!(rnd() & 7))
+            tc[i] = 0;
+    }
+}
+
+static void check_deblock(VVCDSPContext *c, int bit_depth, int chroma)
+{
+    int32_t beta[4], tc[4];
+    uint8_t no_p[4], no_q[4], max_len_p[4], max_len_q[4];
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BUF_SIZE]);
+
+    declare_func(void, uint8_t *pix, ptrdiff_t stride, const int32_t *beta, const int32_t *tc,
+        const uint8_t *no_p, const uint8_t *no_q, const uint8_t *max_len_p, const uint8_t *max_len_q, int);
+
+    for (int vertical = 0; vertical < 2; vertical++) {
+        if (check_func(chroma ? c->lf.filter_chroma[vertical] : c->lf.filter_luma[vertical],
+                "vvc_%s_loop_filter_%s_%d", vertical ? "v" : "h", chroma ? "chroma" : "luma", bit_depth)) {
+            for (int i = 0; i < ITERATIONS; i++) {
+                // hor_ctu_edge for luma, the chroma shift for chroma
+                const int flag = rnd() & 1;
+
+                if (chroma)
+                    randomize_params(beta, tc, no_p, no_q, max_len_p, max_len_q,
+                        chroma_max_len, FF_ARRAY_ELEMS(chroma_max_len));
+                else
+                    randomize_params(beta, tc, no_p, no_q, max_len_p, max_len_q,
+                        luma_max_len, FF_ARRAY_ELEMS(luma_max_len));
+                randomize_buffers(buf0, buf1, vertical, bit_depth);
+
+                call_ref(buf0 + BUF_OFFSET, BUF_STRIDE, beta, tc, no_p, no_q, max_len_p, max_len_q, flag);
+                call_new(buf1 + BUF_OFFSET, BUF_STRIDE, beta, tc, no_p, no_q, max_len_p, max_len_q, flag);
+                if (memcmp(buf0, buf1, BUF_SIZE))
+                    fail();
+            }
+            // all the segments filtered
+            randomize_buffers(buf0, buf1, vertical, bit_depth);
+            for (int i = 0; i < 4; i++) {
+                beta[i] = 64;
+                tc[i]   = 8 + rnd() % 32;
+                no_p[i] = no_q[i] = 0;
+                max_len_p[i] = max_len_q[i] = 3;
+            }
+            bench_new(buf1 + BUF_OFFSET, BUF_STRIDE, beta, tc, no_p, no_q, max_len_p, max_len_q, 0);
+        }
+    }
+}
+
+void checkasm_check_vvc_deblock(void)
+{
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        VVCDSPContext c;
+
+        ff_vvc_dsp_init(&c, bit_depth);
+        check_deblock(&c, bit_depth, 0);
+    }
+    report("luma");
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        VVCDSPContext c;
+
+        ff_vvc_dsp_init(&c, bit_depth);
+        check_deblock(&c, bit_depth, 1);
+    }
+    report("chroma");
+}
@@ -0,0 +1,176 @@
+/*
+ * This file is part of Librempeg.
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+
+#include "libavcodec/vvc/ctu.h"
+#include "libavcodec/vvc/dsp.h"
+#include "libavcodec/vvc/intra.h"
+
+/* same layout as the edge arrays of the intra prediction */
+#define EDGE_SIZE   (6 * MAX_TB_SIZE + 5)
+#define EDGE_OFFSET (MAX_TB_SIZE + 3)
+
+static void randomize_edge(uint16_t *edge, int bit_depth)
+{
+    const int pixel_max = (1 << bit_depth) - 1;
+
+    for (int i = 0; i < EDGE_SIZE; i++) {
+        if (bit_depth > 8)
+            AV_WN16A(edge + i, rnd() & pixel_max);
+        else
+            ((uint8_t *)edge)[i] = rnd();
+    }
+}
+
+#define EDGE_PTR(edge) ((uint8_t *)(edge) + EDGE_OFFSET * ((bit_depth + 7) / 8))
+/* the prediction functions take the stride in pixels */
+#define PIXELS(stride) ((stride) / ((bit_depth + 7) / 8))
+
+static void check_pred_dc_planar(VVCDSPContext *c, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint16_t, top,  [EDGE_SIZE]);
+    LOCAL_ALIGNED_32(uint16_t, left, [EDGE_SIZE]);
+    PIXEL_RECT(dst0, MAX_TB_SIZE, MAX_TB_SIZE);
+    PIXEL_RECT(dst1, MAX_TB_SIZE, MAX_TB_SIZE);
+
+    declare_func(void, uint8_t *src, const uint8_t *top, const uint8_t *left, int w, int h, ptrdiff_t stride);
+
+    for (int planar = 0; planar < 2; planar++) {
+        for (int w = 4; w <= MAX_TB_SIZE; w <<= 1) {
+            for (int h = 1; h <= MAX_TB_SIZE; h <<= 1) {
+                if (check_func(planar ? c->intra.pred_planar : c->intra.pred_dc,
+                        "vvc_pred_%s_%dx%d_%d", planar ? "planar" : "dc", w, h, bit_depth)) {
+                    randomize_edge(top,  bit_depth);
+                    randomize_edge(left, bit_depth);
+                    CLEAR_PIXEL_RECT(dst0);
+                    CLEAR_PIXEL_RECT(dst1);
+
+                    call_ref(dst0, EDGE_PTR(top), EDGE_PTR(left), w, h, PIXELS(dst0_stride));
+                    call_new(dst1, EDGE_PTR(top), EDGE_PTR(left), w, h, PIXELS(dst1_stride));
+                    checkasm_check_pixel_padded(dst0, dst0_stride, dst1, dst1_stride, w, h, "dst");
+                    bench_new(dst1, EDGE_PTR(top), EDGE_PTR(left), w, h, PIXELS(dst1_stride));
+                }
+            }
+        }
+    }
+}
+
+static void check_pred_v_h(VVCDSPContext *c, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint16_t, edge, [EDGE_SIZE]);
+    PIXEL_RECT(dst0, MAX_TB_SIZE, MAX_TB_SIZE);
+    PIXEL_RECT(dst1, MAX_TB_SIZE, MAX_TB_SIZE);
+
+    declare_func(void, uint8_t *src, const uint8_t *edge, int w, int h, ptrdiff_t stride);
+
+    for (int hor = 0; hor < 2; hor++) {
+        for (int w = 4; w <= MAX_TB_SIZE; w <<= 1) {
+            for (int h = 1; h <= MAX_TB_SIZE; h <<= 1) {
+                if (check_func(hor ? c->intra.pred_h : c->intra.pred_v,
+                        "vvc_pred_%s_%dx%d_%d", hor ? "h" : "v", w, h, bit_depth)) {
+                    randomize_edge(edge, bit_depth);
+                    CLEAR_PIXEL_RECT(dst0);
+                    CLEAR_PIXEL_RECT(dst1);
+
+                    call_ref(dst0, EDGE_PTR(edge), w, h, PIXELS(dst0_stride));
+                    call_new(dst1, EDGE_PTR(edge), w, h, PIXELS(dst1_stride));
+                    checkasm_check_pixel_padded(dst0, dst0_stride, dst1, dst1_stride, w, h, "dst");
+                    bench_new(dst1, EDGE_PTR(edge), w, h, PIXELS(dst1_stride));
+                }
+            }
+        }
+    }
+}
+
+static void check_pred_angular_v(VVCDSPContext *c, int bit_depth)
+{
+    static const int ref_idxs[] = { 0, 1, 3 };
+    LOCAL_ALIGNED_32(uint16_t, top,  [EDGE_SIZE]);
+    LOCAL_ALIGNED_32(uint16_t, left, [EDGE_SIZE]);
+    PIXEL_RECT(dst0, MAX_TB_SIZE, MAX_TB_SIZE);
+    PIXEL_RECT(dst1, MAX_TB_SIZE, MAX_TB_SIZE);
+
+    declare_func(void, uint8_t *src, const uint8_t *top, const uint8_t *left, int w, int h, ptrdiff_t stride,
+        int c_idx, int mode, int ref_idx, int filter_flag, int need_pdpc);
+
+    for (int w = 4; w <= MAX_TB_SIZE; w <<= 1) {
+        for (int h = 1; h <= MAX_TB_SIZE; h <<= 1) {
+            /* the modes kept by the wide angle mapping, and the wide angles up to INTRA_ANGULAR80 */
+            const int wh_ratio = FFABS(av_log2(w) - av_log2(h));
+            const int max_mode = w > h ? FFMIN(72 + 2 * wh_ratio, 80) : (h > w ? 60 - 2 * wh_ratio : 66);
+
+            if (check_func(c->intra.pred_angular_v, "vvc_pred_angular_v_%dx%d_%d", w, h, bit_depth)) {
+                for (int mode = INTRA_DIAG; mode <= max_mode; mode++) {
+                    const int c_idx       = rnd() % 3;
+                    const int ref_idx     = c_idx ? 0 : ref_idxs[rnd() % FF_ARRAY_ELEMS(ref_idxs)];
+                    const int filter_flag = c_idx ? 0 : rnd() & 1;
+                    int need_pdpc;
+
+                    if (mode == INTRA_VERT)
+                        continue;
+                    need_pdpc = ff_vvc_need_pdpc(w, h, 0, mode, ref_idx);
+
+                    randomize_edge(top,  bit_depth);
+                    randomize_edge(left, bit_depth);
+                    CLEAR_PIXEL_RECT(dst0);
+                    CLEAR_PIXEL_RECT(dst1);
+
+                    call_ref(dst0, EDGE_PTR(top), EDGE_PTR(left), w, h, PIXELS(dst0_stride),
+                        c_idx, mode, ref_idx, filter_flag, need_pdpc);
+                    call_new(dst1, EDGE_PTR(top), EDGE_PTR(left), w, h, PIXELS(dst1_stride),
+                        c_idx, mode, ref_idx, filter_flag, need_pdpc);
+                    checkasm_check_pixel_padded(dst0, dst0_stride, dst1, dst1_stride, w, h, "dst");
+                }
+                bench_new(dst1, EDGE_PTR(top), EDGE_PTR(left), w, h, PIXELS(dst1_stride),
+                    0, INTRA_DIAG + 8, 0, 1, 0);
+            }
+        }
+    }
+}
+
+void checkasm_check_vvc_intra(void)
+{
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        VVCDSPContext c;
+
+        ff_vvc_dsp_init(&c, bit_depth);
+        check_pred_dc_planar(&c, bit_depth);
+    }
+    report("pred_dc_planar");
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        VVCDSPContext c;
+
+        ff_vvc_dsp_init(&c, bit_depth);
+        check_pred_v_h(&c, bit_depth);
+    }
+    report("pred_v_h");
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        VVCDSPContext c;
+
+        ff_vvc_dsp_init(&c, bit_depth);
+        check_pred_angular_v(&c, bit_depth);
+    }
+    report("pred_angular_v");
+}
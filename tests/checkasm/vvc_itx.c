@@ -0,0 +1,137 @@
+/*
+ * This file is part of Librempeg.
+ *
+ * Librempeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Librempeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Librempeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+
+#include "libavcodec/vvc/ctu.h"
+#include "libavcodec/vvc/dsp.h"
+
+/* coefficients outside of the top-left 32x32, or 16x16 for MTS, are zeroed out */
+#define MAX_DCT2_NZ 32
+#define MAX_MTS_NZ  16
+
+static void randomize_pixels(uint8_t *buf, ptrdiff_t stride, int w, int h, int bit_depth)
+{
+    const int pixel_max = (1 << bit_depth) - 1;
+
+    for (int y = 0; y < h; y++, buf += stride) {
+        for (int x = 0; x < w; x++) {
+            if (bit_depth > 8)
+                AV_WN16A(buf + 2 * x, rnd() & pixel_max);
+            else
+                buf[x] = rnd();
+        }
+    }
+}
+
+static void randomize_residuals(int *res, int size, int bit_depth)
+{
+    for (int i = 0; i < size; i++) {
+        /* mostly in-range residuals, with some that overflow int16_t */
+        if (rnd() & 7)
+            res[i] = (int)(rnd() % (4U << bit_depth)) - (2 << bit_depth);
+        else
+            res[i] = (int)rnd() >> (rnd() & 15);
+    }
+}
+
+static void check_add_residual(VVCDSPContext *c, int bit_depth)
+{
+    PIXEL_RECT(dst0, MAX_TB_SIZE, MAX_TB_SIZE);
+    PIXEL_RECT(dst1, MAX_TB_SIZE, MAX_TB_SIZE);
+    LOCAL_ALIGNED_32(int, res, [MAX_TB_SIZE * MAX_TB_SIZE]);
+
+    declare_func(void, uint8_t *dst, const int *res, int width, int height, ptrdiff_t stride);
+
+    for (int w = 1; w <= MAX_TB_SIZE; w <<= 1) {
+        for (int h = 1; h <= MAX_TB_SIZE; h <<= 1) {
+            if (check_func(c->itx.add_residual, "vvc_add_residual_%dx%d_%d", w, h, bit_depth)) {
+                CLEAR_PIXEL_RECT(dst0);
+                randomize_pixels(dst0, dst0_stride, w, h, bit_depth);
+                memcpy(dst1_buf, dst0_buf, dst0_stride * dst0_buf_h + 64);
+                randomize_residuals(res, w * h, bit_depth);
+
+                call_ref(dst0, res, w, h, dst0_stride);
+                call_new(dst1, res, w, h, dst1_stride);
+                checkasm_check_pixel_padded(dst0, dst0_stride, dst1, dst1_stride, w, h, "dst");
+                bench_new(dst1, res, w, h, dst1_stride);
+            }
+        }
+    }
+}
+
+static void check_itx(VVCDSPContext *c, int bit_depth)
+{
+    static const char *const tx_names[VVC_N_TX_TYPE] = { "dct2", "dst7", "dct8" };
+    LOCAL_ALIGNED_32(int, coeffs0, [MAX_TB_SIZE * MAX_TB_SIZE]);
+    LOCAL_ALIGNED_32(int, coeffs1, [MAX_TB_SIZE * MAX_TB_SIZE]);
+
+    declare_func(void, int *coeffs, ptrdiff_t stride, size_t nz);
+
+    for (int type = VVC_DCT2; type < VVC_N_TX_TYPE; type++) {
+        const int max_size = type == VVC_DCT2 ? VVC_TX_SIZE_64 : VVC_TX_SIZE_32;
+        const int max_nz   = type == VVC_DCT2 ? MAX_DCT2_NZ : MAX_MTS_NZ;
+
+        for (int tx_size = VVC_TX_SIZE_4; tx_size <= max_size; tx_size++) {
+            const int size = 2 << tx_size;
+
+            if (check_func(c->itx.itx[type][tx_size], "vvc_inv_%s_%d_%d", tx_names[type], size, bit_depth)) {
+                /* a row of the horizontal pass and a column of the vertical one */
+                for (ptrdiff_t stride = 1; stride <= MAX_TB_SIZE; stride *= MAX_TB_SIZE) {
+                    for (size_t nz = 1; nz <= FFMIN(size, max_nz); nz++) {
+                        for (int i = 0; i < MAX_TB_SIZE * MAX_TB_SIZE; i++)
+                            coeffs0[i] = (int16_t)rnd();
+                        /* the DCT-2 butterflies read the zeroed inputs past nz */
+                        for (int i = nz; i < size; i++)
+                            coeffs0[i * stride] = 0;
+                        memcpy(coeffs1, coeffs0, sizeof(*coeffs0) * MAX_TB_SIZE * MAX_TB_SIZE);
+
+                        call_ref(coeffs0, stride, nz);
+                        call_new(coeffs1, stride, nz);
+                        if (memcmp(coeffs0, coeffs1, sizeof(*coeffs0) * MAX_TB_SIZE * MAX_TB_SIZE))
+                            fail();
+                    }
+                }
+                bench_new(coeffs1, 1, FFMIN(size, max_nz));
+            }
+        }
+    }
+}
+
+void checkasm_check_vvc_itx(void)
+{
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        VVCDSPContext c;
+
+        ff_vvc_dsp_init(&c, bit_depth);
+        check_add_residual(&c, bit_depth);
+    }
+    report("add_residual");
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        VVCDSPContext c;
+
+        ff_vvc_dsp_init(&c, bit_depth);
+        check_itx(&c, bit_depth);
+    }
+    report("itx");
+}
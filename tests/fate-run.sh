@@ -589,6 +589,24 @@ pixfmts(){
     test=$outertest
 }
 
+signature_index(){
+    index="${outdir}/${test}.lvsi"
+    cleanfiles="$cleanfiles $index"
+    tindex=$(target_path $index)
+    clip1="testsrc2=size=320x240:rate=25:duration=10,format=gray"
+    clip2="smptehdbars=size=320x240:rate=25:duration=10,format=yuv420p,noise=alls=60:allf=t+u,extractplanes=y"
+    rm -f $index
+
+    # build the catalogue with one clip, then append a second one
+    for clip in testsrc2 bars; do
+        [ $clip = bars ] && src=$clip2 || src=$clip1
+        ffmpeg -lavfi "$src,signature=index=$tindex:indexmode=build:clipname=$clip" \
+            -f null - 2>&1 | sed -n 's/^.*\] index .* has /has /p'
+    done
+    ffmpeg -lavfi "$clip1,trim=start=2[a];$clip2,trim=start=1[b];[a][b]signature=nb_inputs=2:index=$tindex:indexmode=lookup" \
+        -f null - 2>&1 | sed -n 's/^\[Parsed_signature[^]]*\] //p'
+}
+
 gapless(){
     sample=$(target_path $1)
     extra_args=$2
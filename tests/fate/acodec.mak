@@ -136,6 +136,13 @@ fate-acodec-flac: CODEC = flac -compression_level 2
 fate-acodec-flac-exact-rice: FMT = flac
 fate-acodec-flac-exact-rice: CODEC = flac -compression_level 2 -exact_rice_parameters 1
 
+# The threaded encodes must be identical to the single-threaded one
+FATE_ACODEC-$(call ENCDEC, FLAC, FLAC) += fate-acodec-flac-lpc fate-acodec-flac-lpc-threads fate-acodec-flac-lpc-frame-batch
+fate-acodec-flac-lpc fate-acodec-flac-lpc-threads fate-acodec-flac-lpc-frame-batch: FMT = flac
+fate-acodec-flac-lpc: CODEC = flac -compression_level 12
+fate-acodec-flac-lpc-threads: CODEC = flac -compression_level 12 -threads 4
+fate-acodec-flac-lpc-frame-batch: CODEC = flac -compression_level 12 -threads 4 -frame_batch 1
+
 FATE_ACODEC-$(call ENCDEC, G723_1, G723_1, ARESAMPLE_FILTER) += fate-acodec-g723_1
 fate-acodec-g723_1: tests/data/asynth-8000-1.wav
 fate-acodec-g723_1: SRC = tests/data/asynth-8000-1.wav
@@ -45,7 +45,9 @@ FATE_CHECKASM = fate-checkasm-aacencdsp                                 \
                 fate-checkasm-scene_sad                                 \
                 fate-checkasm-svq1enc                                   \
                 fate-checkasm-synth_filter                              \
+                fate-checkasm-sw_box                                    \
                 fate-checkasm-sw_gbrp                                   \
+                fate-checkasm-sw_lut3d                                  \
                 fate-checkasm-sw_range_convert                          \
                 fate-checkasm-sw_rgb                                    \
                 fate-checkasm-sw_scale                                  \
@@ -65,13 +67,20 @@ FATE_CHECKASM = fate-checkasm-aacencdsp                                 \
                 fate-checkasm-vf_gblur                                  \
                 fate-checkasm-vf_hflip                                  \
                 fate-checkasm-vf_nlmeans                                \
+                fate-checkasm-vf_pf2pf                                  \
                 fate-checkasm-vf_threshold                              \
                 fate-checkasm-vf_sobel                                  \
+                fate-checkasm-vf_ssim360                                \
+                fate-checkasm-vf_vmafmotion                             \
+                fate-checkasm-vf_xpsnr                                  \
                 fate-checkasm-videodsp                                  \
                 fate-checkasm-vorbisdsp                                 \
                 fate-checkasm-vp8dsp                                    \
                 fate-checkasm-vp9dsp                                    \
                 fate-checkasm-vvc_alf                                   \
+                fate-checkasm-vvc_deblock                               \
+                fate-checkasm-vvc_intra                                 \
+                fate-checkasm-vvc_itx                                   \
                 fate-checkasm-vvc_mc                                    \
 
 $(FATE_CHECKASM): tests/checkasm/checkasm$(EXESUF)
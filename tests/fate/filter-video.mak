@@ -271,6 +271,15 @@ FATE_FILTER_VSYNTH_PGMYUV-$(CONFIG_VSTACK_FILTER) += fate-filter-vstack
 fate-filter-vstack: tests/data/filtergraphs/vstack
 fate-filter-vstack: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/vstack
 
+# multiscale must give the same output as scaling every size separately
+FATE_FILTER_MULTISCALE-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER MULTISCALE_FILTER FRAMEMD5_MUXER PIPE_PROTOCOL) += fate-filter-multiscale fate-filter-multiscale-cascade
+FATE_FILTER_MULTISCALE-$(call ALLYES, TESTSRC2_FILTER FORMAT_FILTER SPLIT_FILTER SCALE_FILTER FRAMEMD5_MUXER PIPE_PROTOCOL) += fate-filter-multiscale-split
+FATE_FILTER_MULTISCALE := $(FATE_FILTER_MULTISCALE-yes)
+$(FATE_FILTER_MULTISCALE): fate-filter-%: tests/data/filtergraphs/%
+$(FATE_FILTER_MULTISCALE): CMD = framemd5 -/filter_complex $(TARGET_PATH)/tests/data/filtergraphs/$(@:fate-filter-%=%) -map "[a]" -map "[b]" -map "[c]"
+fate-filter-multiscale-split: REF = $(SRC_PATH)/tests/ref/fate/filter-multiscale
+FATE_FILTER-yes += $(FATE_FILTER_MULTISCALE)
+
 FATE_FILTER_OVERLAY-$(call FILTERDEMDEC, SCALE OVERLAY, IMAGE2, PGMYUV) += fate-filter-overlay
 fate-filter-overlay: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -/filter_complex $(FILTERGRAPH)
 
@@ -805,6 +814,15 @@ fate-filter-refcmp-xpsnr-rgb: CMD = refcmp_metadata xpsnr rgb24 0.002
 FATE_FILTER_REFCMP_METADATA-$(CONFIG_XPSNR_FILTER) += fate-filter-refcmp-xpsnr-yuv
 fate-filter-refcmp-xpsnr-yuv: CMD = refcmp_metadata xpsnr yuv422p 0.0015
 
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER SMPTEHDBARS_FILTER FORMAT_FILTER NOISE_FILTER \
+                           EXTRACTPLANES_FILTER TRIM_FILTER SIGNATURE_FILTER NULL_MUXER) += fate-filter-signature-index
+fate-filter-signature-index: CMD = signature_index
+
+FATE_FILTER-$(CONFIG_PF2PF_FILTER) += fate-filter-pf2pf-kernels
+fate-filter-pf2pf-kernels: libavfilter/tests/pf2pf$(EXESUF)
+fate-filter-pf2pf-kernels: CMD = run libavfilter/tests/pf2pf$(EXESUF)
+fate-filter-pf2pf-kernels: CMP = null
+
 FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER SPLIT_FILTER AVGBLUR_FILTER        \
                            METADATA_FILTER WRAPPED_AVFRAME_ENCODER NULL_MUXER \
                            PIPE_PROTOCOL) += $(FATE_FILTER_REFCMP_METADATA-yes)
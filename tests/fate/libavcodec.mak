@@ -38,6 +38,11 @@ fate-codec_desc: libavcodec/tests/codec_desc$(EXESUF)
 fate-codec_desc: CMD = run libavcodec/tests/codec_desc$(EXESUF)
 fate-codec_desc: CMP = null
 
+FATE_LIBAVCODEC-yes += fate-deflate
+fate-deflate: libavcodec/tests/deflate$(EXESUF)
+fate-deflate: CMD = run libavcodec/tests/deflate$(EXESUF)
+fate-deflate: CMP = null
+
 FATE_LIBAVCODEC-$(CONFIG_GOLOMB) += fate-golomb
 fate-golomb: libavcodec/tests/golomb$(EXESUF)
 fate-golomb: CMD = run libavcodec/tests/golomb$(EXESUF)